@@ -0,0 +1,55 @@
+#ifndef HQTS_CORE_ADAPTIVE_BURST_H_
+#define HQTS_CORE_ADAPTIVE_BURST_H_
+
+#include <cstddef> // For size_t
+#include <stdexcept> // For std::invalid_argument
+
+namespace hqts {
+namespace core {
+
+/**
+ * @brief Burst size of a polling loop that follows the load.
+ *
+ * A loop asks for up to current() items per poll and reports how many it got. A full
+ * poll means items are waiting, so the size doubles, up to the maximum, to amortise
+ * per-burst costs over more packets. A poll returning less than a quarter of the size
+ * means the queue is nearly drained, so the size halves, down to the minimum, and
+ * each burst is forwarded sooner instead of metered as a whole before it moves on.
+ * The gap between the two thresholds keeps the size from oscillating at a steady rate.
+ */
+class AdaptiveBurstSize {
+public:
+    /**
+     * @brief Starts at `min_size`.
+     * @throws std::invalid_argument if min_size is 0 or exceeds max_size.
+     */
+    AdaptiveBurstSize(size_t min_size, size_t max_size)
+        : min_size_(min_size), max_size_(max_size), current_(min_size) {
+        if (min_size == 0 || min_size > max_size) {
+            throw std::invalid_argument("AdaptiveBurstSize: sizes must satisfy 0 < min_size <= max_size.");
+        }
+    }
+
+    size_t current() const { return current_; }
+    size_t min_size() const { return min_size_; }
+    size_t max_size() const { return max_size_; }
+
+    /** @brief Adapts the size to a poll that returned `count` of current() items. */
+    void record(size_t count) {
+        if (count >= current_) {
+            current_ = current_ > max_size_ / 2 ? max_size_ : current_ * 2;
+        } else if (count < current_ / 4) {
+            current_ = current_ / 2 < min_size_ ? min_size_ : current_ / 2;
+        }
+    }
+
+private:
+    size_t min_size_;
+    size_t max_size_;
+    size_t current_;
+};
+
+} // namespace core
+} // namespace hqts
+
+#endif // HQTS_CORE_ADAPTIVE_BURST_H_
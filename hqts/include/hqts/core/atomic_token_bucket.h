@@ -0,0 +1,143 @@
+#ifndef HQTS_CORE_ATOMIC_TOKEN_BUCKET_H_
+#define HQTS_CORE_ATOMIC_TOKEN_BUCKET_H_
+
+#include "hqts/core/time_source.h" // For TimestampNs
+
+#include <atomic>
+#include <cstdint>
+
+namespace hqts {
+namespace core {
+
+/**
+ * @brief Lock-free token bucket that many threads can charge concurrently.
+ *
+ * The whole bucket state is one 64-bit word updated with compare-and-swap: the
+ * theoretical arrival time (TAT) of the generic cell rate algorithm, i.e. the time at
+ * which the bucket will be full again. Token count and refill timestamp are both
+ * implied by it (tokens = (burst time - (TAT - now)) * rate), so a refill and a charge
+ * are a single CAS and there is no separate timestamp to keep consistent.
+ *
+ * Time is kept in ticks of 1/65536 ns so per-byte costs of 100G+ rates stay precise;
+ * the cost per byte is rounded up, so the bucket never admits more than its rate.
+ * Tick arithmetic is modular: a bucket untouched for a multiple of about 78 hours
+ * sees its idle time wrap around, which is detected (and treated as a full bucket)
+ * unless the wrap lands within the burst time plus MAX_CLOCK_SKEW_NS.
+ *
+ * Threads may pass slightly different timestamps (each core reads its own clock);
+ * a timestamp older than the TAT's reference is simply judged against the newer
+ * state, as long as the skew stays below MAX_CLOCK_SKEW_NS.
+ *
+ * Rate and capacity are fixed at construction; to reconfigure, build a new bucket.
+ * Non-conforming requests do not write the shared word, so dropping traffic at
+ * line rate does not bounce the cache line between cores.
+ */
+class AtomicTokenBucket {
+public:
+    static constexpr uint64_t TICKS_PER_NS = 65536;
+    static constexpr uint64_t MAX_CLOCK_SKEW_NS = 1000000000; // 1 s
+
+    /**
+     * @brief Constructs a full bucket.
+     * @param rate_bps Refill rate in bits per second (> 0).
+     * @param capacity_bytes Burst capacity in bytes.
+     * @param now_ns Creation time on the clock later passed to consume().
+     * @throws std::invalid_argument if rate_bps is 0, or if the burst time
+     *         (capacity_bytes at rate_bps) does not fit the tick range.
+     */
+    AtomicTokenBucket(uint64_t rate_bps, uint64_t capacity_bytes, TimestampNs now_ns);
+
+    /// As above, created at steady_now_ns().
+    AtomicTokenBucket(uint64_t rate_bps, uint64_t capacity_bytes);
+
+    // The atomic state is shared by address.
+    AtomicTokenBucket(const AtomicTokenBucket&) = delete;
+    AtomicTokenBucket& operator=(const AtomicTokenBucket&) = delete;
+
+    /**
+     * @brief Takes tokens if enough are available at now_ns. Thread-safe.
+     * @return True if the tokens were taken; false leaves the bucket unchanged.
+     */
+    bool consume(uint64_t tokens_to_consume, TimestampNs now_ns);
+
+    /**
+     * @brief Returns previously consumed tokens (e.g. credit a LocalTokenCache did not
+     *        use). The bucket never exceeds its capacity. Thread-safe.
+     */
+    void refund(uint64_t tokens, TimestampNs now_ns);
+
+    /**
+     * @brief Tokens available at now_ns (a snapshot; other threads may change it). Thread-safe.
+     */
+    uint64_t available_tokens(TimestampNs now_ns) const;
+
+    uint64_t rate_bps() const { return rate_bps_; }
+    uint64_t capacity_bytes() const { return capacity_bytes_; }
+
+private:
+    static uint64_t to_ticks(TimestampNs now_ns) { return now_ns * TICKS_PER_NS; }
+
+    /**
+     * @brief Signed distance TAT - now in ticks, with wrapped idle time mapped to 0 (full).
+     * Positive values are the debt in ticks that has not been paid back yet.
+     */
+    int64_t debt_ticks(uint64_t tat, uint64_t now_ticks) const;
+
+    const uint64_t rate_bps_;
+    const uint64_t capacity_bytes_;
+    const uint64_t cost_per_byte_ticks_; // ceil(8e9 * TICKS_PER_NS / rate_bps)
+    const int64_t burst_ticks_;          // capacity_bytes * cost_per_byte_ticks_
+    alignas(64) std::atomic<uint64_t> tat_ticks_;
+};
+
+/**
+ * @brief Per-thread credit cache in front of a shared AtomicTokenBucket.
+ *
+ * Borrows tokens from the shared bucket in batches and serves consume() from the
+ * local credit, so a heavily shared aggregate is touched once per batch instead of
+ * once per packet. When the shared bucket cannot cover a whole batch the cache falls
+ * back to borrowing exactly what the packet needs, so near the limit it behaves like
+ * the shared bucket itself.
+ *
+ * The long-term rate is exact (every cached token was granted by the shared bucket),
+ * but up to batch_bytes per cache may be granted early, so the aggregate can burst by
+ * (number of caches x batch_bytes) above the shared capacity over short intervals.
+ * Keep batches small relative to the capacity, and flush() idle caches.
+ *
+ * Not thread-safe: one cache per thread.
+ */
+class LocalTokenCache {
+public:
+    /**
+     * @param shared The shared bucket; must outlive the cache.
+     * @param batch_bytes Tokens borrowed per refill of the cache.
+     */
+    LocalTokenCache(AtomicTokenBucket& shared, uint64_t batch_bytes);
+
+    LocalTokenCache(const LocalTokenCache&) = delete;
+    LocalTokenCache& operator=(const LocalTokenCache&) = delete;
+
+    /**
+     * @brief Takes tokens from the local credit, borrowing from the shared bucket as needed.
+     * @return True if the tokens were taken.
+     */
+    bool consume(uint64_t tokens_to_consume, TimestampNs now_ns);
+
+    /**
+     * @brief Returns the unused local credit to the shared bucket. Credit still held
+     *        when the cache is destroyed is not returned.
+     */
+    void flush(TimestampNs now_ns);
+
+    uint64_t cached_tokens() const { return cached_tokens_; }
+
+private:
+    AtomicTokenBucket& shared_;
+    const uint64_t batch_bytes_;
+    uint64_t cached_tokens_;
+};
+
+} // namespace core
+} // namespace hqts
+
+#endif // HQTS_CORE_ATOMIC_TOKEN_BUCKET_H_
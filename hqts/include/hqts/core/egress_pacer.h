@@ -0,0 +1,112 @@
+#ifndef HQTS_CORE_EGRESS_PACER_H_
+#define HQTS_CORE_EGRESS_PACER_H_
+
+#include "hqts/core/time_source.h"            // For TimestampNs
+#include "hqts/scheduler/packet_descriptor.h" // For scheduler::PacketDescriptor
+#include "hqts/scheduler/service_curve.h"     // For scheduler::CurveSlope
+
+#include <cstddef> // For size_t
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace hqts {
+namespace core {
+
+/**
+ * @brief How an EgressPacer computes departure times.
+ */
+struct EgressPacingConfig {
+    // Pace packets back to back at this rate. 0: follow the scheduler's link clock
+    // (PacketDescriptor::transmit_time_ns as set by HfscScheduler), so departures honour
+    // its real-time curves.
+    uint64_t rate_bps = 0;
+    // Packets are handed out at most this long before they depart; a NIC with
+    // timestamp-based transmit (SO_TXTIME, the ETF qdisc) holds them until then.
+    TimestampNs horizon_ns = 2000000;
+};
+
+/**
+ * @brief Egress stage that gives every packet a steady-clock departure time and hands
+ *        out the packets due within a horizon, for NICs that transmit at a timestamp.
+ *
+ * With a rate, a packet departs when the previous one has finished at that rate, or now
+ * if the port went idle. Without one, the scheduler's link clock is mapped onto the
+ * steady clock: a packet departs at its link time plus an offset, and the offset is
+ * re-anchored whenever the link clock has fallen behind real time (the port idled), so
+ * the gaps HFSC leaves for its real-time curves are kept while idle periods are not
+ * made up for.
+ *
+ * A dequeued packet departing beyond the horizon is held in the pacer until it is due,
+ * so one core can serve many ports by calling get_packets_due() on each, sleeping until
+ * the earliest next_due_ns(), instead of busy-waiting on each port's rate.
+ * Not thread-safe: one pacer per port, used by the thread that drains its scheduler.
+ */
+class EgressPacer {
+public:
+    explicit EgressPacer(EgressPacingConfig config = EgressPacingConfig());
+
+    /**
+     * @brief Computes the departure time of the next packet sent and stores it in
+     *        packet.transmit_time_ns.
+     * @param now_ns Current steady-clock time in nanoseconds.
+     * @return The departure time (never before now_ns).
+     */
+    TimestampNs stamp(scheduler::PacketDescriptor& packet, TimestampNs now_ns);
+
+    /**
+     * @brief Appends to `out` up to max_packets packets departing by now_ns plus the
+     *        horizon, in departure order, each stamped by stamp().
+     * @tparam Scheduler Provides SchedulerInterface's try_dequeue().
+     * @return Number of packets appended.
+     */
+    template <typename Scheduler>
+    size_t get_packets_due(Scheduler& scheduler, std::vector<scheduler::PacketDescriptor>& out,
+                           size_t max_packets, TimestampNs now_ns);
+
+    /**
+     * @brief When get_packets_due() can next hand out a packet: when the packet held
+     *        back comes within the horizon, or now_ns if none is held (the scheduler may
+     *        have packets due).
+     */
+    TimestampNs next_due_ns(TimestampNs now_ns) const;
+
+    bool has_held_packet() const { return held_.has_value(); }
+    const EgressPacingConfig& config() const { return config_; }
+
+private:
+    EgressPacingConfig config_;
+    scheduler::CurveSlope rate_;
+    TimestampNs next_free_ns_ = 0;   // Rate mode: when the last packet handed out has been sent
+    int64_t link_offset_ns_ = 0;     // Link-clock mode: steady time minus link time
+    bool anchored_ = false;          // Link-clock mode: link_offset_ns_ is set
+    std::optional<scheduler::PacketDescriptor> held_; // Dequeued and stamped, beyond the horizon
+};
+
+template <typename Scheduler>
+size_t EgressPacer::get_packets_due(Scheduler& scheduler, std::vector<scheduler::PacketDescriptor>& out,
+                                    size_t max_packets, TimestampNs now_ns) {
+    const TimestampNs limit = now_ns + config_.horizon_ns;
+    size_t added = 0;
+    while (added < max_packets) {
+        if (!held_) {
+            held_ = scheduler.try_dequeue();
+            if (!held_) {
+                break;
+            }
+            stamp(*held_, now_ns);
+        }
+        if (held_->transmit_time_ns > limit) {
+            break; // Later packets depart later still
+        }
+        out.push_back(*held_);
+        held_.reset();
+        ++added;
+    }
+    return added;
+}
+
+} // namespace core
+} // namespace hqts
+
+#endif // HQTS_CORE_EGRESS_PACER_H_
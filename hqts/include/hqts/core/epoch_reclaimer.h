@@ -0,0 +1,84 @@
+#ifndef HQTS_CORE_EPOCH_RECLAIMER_H_
+#define HQTS_CORE_EPOCH_RECLAIMER_H_
+
+#include <atomic>
+#include <cstddef> // For size_t
+#include <cstdint>
+#include <memory>  // For std::unique_ptr
+
+namespace hqts {
+namespace core {
+
+/**
+ * @brief Quiescent-state epoch tracking for reclaiming objects readers may still use.
+ *
+ * A writer that unpublishes an object calls advance() and tags the object with the
+ * returned epoch; it may free the object once passed(tag) holds. Each reader owns a
+ * slot and, at a point where it holds no reference to an unpublished object, calls
+ * quiescent() with an epoch() it read before loading the pointers it now holds. That
+ * is one load and one store, with no locked instruction, so a data-path thread can
+ * announce a quiescent point every burst. Writers never wait for readers: an object
+ * whose readers have not yet moved on simply stays allocated a little longer.
+ *
+ * Readers that are not registered hold nothing and never delay reclamation.
+ */
+class EpochReclaimer {
+public:
+    /**
+     * @param max_readers Number of reader slots.
+     * @throws std::invalid_argument if `max_readers` is 0.
+     */
+    explicit EpochReclaimer(size_t max_readers);
+
+    EpochReclaimer(const EpochReclaimer&) = delete;
+    EpochReclaimer& operator=(const EpochReclaimer&) = delete;
+
+    size_t max_readers() const { return max_readers_; }
+
+    /**
+     * @brief Claims a reader slot, quiescent at the current epoch.
+     * @throws std::length_error if every slot is taken.
+     */
+    size_t register_reader();
+
+    /** @brief Releases a slot; its reader must no longer hold any protected object. */
+    void unregister_reader(size_t reader);
+
+    /** @brief The current epoch. Readers load it before the pointers they will hold. */
+    uint64_t epoch() const { return epoch_.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Announces that `reader` holds nothing unpublished before `observed_epoch`.
+     *
+     * Only the thread owning the slot may call this.
+     */
+    void quiescent(size_t reader, uint64_t observed_epoch) {
+        slots_[reader].epoch.store(observed_epoch, std::memory_order_release);
+    }
+
+    /**
+     * @brief Starts a new epoch. Call after unpublishing an object.
+     * @return The epoch to tag the unpublished object with.
+     */
+    uint64_t advance() { return epoch_.fetch_add(1, std::memory_order_acq_rel) + 1; }
+
+    /** @brief True once every registered reader has announced `tag` or a later epoch. */
+    bool passed(uint64_t tag) const;
+
+private:
+    /// ReaderSlot::epoch of a slot no reader owns.
+    static constexpr uint64_t FREE_SLOT = UINT64_MAX;
+
+    struct alignas(64) ReaderSlot { // One cache line per reader: no false sharing between them
+        std::atomic<uint64_t> epoch{FREE_SLOT};
+    };
+
+    size_t max_readers_;
+    std::unique_ptr<ReaderSlot[]> slots_;
+    std::atomic<uint64_t> epoch_{1};
+};
+
+} // namespace core
+} // namespace hqts
+
+#endif // HQTS_CORE_EPOCH_RECLAIMER_H_
@@ -8,6 +8,10 @@
 #include <string> // Currently not used by FlowId, but kept for potential future use
 
 namespace hqts {
+namespace policy {
+struct RuntimePolicy; // Defined in runtime_policy_table.h, which includes this header
+} // namespace policy
+
 namespace core {
 
 // For now, FlowId is a simple type.
@@ -17,12 +21,14 @@ using FlowId = uint64_t;
 
 using QueueId = uint32_t;
 
-enum class DropPolicy {
+enum class DropPolicy : uint8_t {
     TAIL_DROP, // Simple tail drop when queue is full
     RED,       // Random Early Detection
     WRED       // Weighted Random Early Detection
 };
 
+// Cold per-flow state: updated or read off the per-packet fast path (accounting,
+// rate measurement), so the FlowTable keeps it in a separate array from FlowContext.
 struct FlowStatistics {
     uint64_t bytes_processed = 0;
     uint64_t packets_processed = 0;
@@ -31,35 +37,41 @@ struct FlowStatistics {
     std::chrono::steady_clock::time_point first_packet_time;
     std::chrono::steady_clock::time_point last_packet_time;
 
+    // Rate measurement (illustrative)
+    uint64_t current_rate_bps = 0;          // Current observed rate of the flow (e.g., calculated periodically)
+    uint64_t accumulated_bytes_in_period = 0; // Bytes seen since last rate calculation period start
+
     FlowStatistics() : first_packet_time(std::chrono::steady_clock::time_point::min()), // Or some other indicator of not-yet-seen
                        last_packet_time(std::chrono::steady_clock::time_point::min()) {}
 };
 
-enum class SLAStatus {
+enum class SLAStatus : uint8_t {
     CONFORMING,
     NON_CONFORMING,
     UNKNOWN
 };
 
+// Hot per-flow state, read for every packet of the flow. Stored inline in the
+// FlowTable slot next to the flow's key, so keep it small: cold data belongs in
+// FlowStatistics.
 struct FlowContext {
     FlowId flow_id;
     policy::PolicyId policy_id; // ID of the ShapingPolicy applied to this flow
 
-    // Current shaping/policing state indicators (illustrative)
-    uint64_t current_rate_bps = 0;          // Current observed rate of the flow (e.g., calculated periodically)
-    uint64_t accumulated_bytes_in_period = 0; // Bytes seen since last rate calculation period start
+    // The policy's record in the compiled policy snapshot, cached by the TrafficShaper
+    // on the flow's first packet so later packets skip the lookup. Valid while
+    // policy_generation is the snapshot's version and the record's id is policy_id.
+    mutable policy::RuntimePolicy* policy = nullptr;
 
     // Queue management
     QueueId queue_id;                           // Queue this flow is mapped to
     uint32_t current_queue_depth_bytes = 0;    // Current depth of the assigned queue
+    mutable uint32_t policy_generation = 0;     // 0: `policy` not resolved yet
     DropPolicy drop_policy = DropPolicy::TAIL_DROP;
 
-    // Statistics & SLA
-    FlowStatistics stats;
+    // SLA
     SLAStatus sla_status = SLAStatus::UNKNOWN;
 
-    std::chrono::steady_clock::time_point last_packet_processing_time; // Timestamp of the last packet processed for this flow
-
     // Constructors
     FlowContext() = default; // Allow default construction
 
@@ -0,0 +1,135 @@
+#ifndef HQTS_CORE_MPSC_RING_H_
+#define HQTS_CORE_MPSC_RING_H_
+
+#include <atomic>
+#include <cstddef>   // For size_t
+#include <memory>    // For std::unique_ptr
+#include <stdexcept> // For std::invalid_argument
+#include <thread>    // For std::this_thread::yield
+
+namespace hqts {
+namespace core {
+
+/**
+ * @brief Bounded lock-free ring from any number of producer threads to one consumer.
+ *
+ * Producers reserve a run of slots with one CAS on the reservation index, copy their
+ * elements in and then publish the run in reservation order (rte_ring style): a
+ * producer whose run follows one still being written waits for it, so the consumer
+ * only ever sees complete bursts and never inspects individual slots. Bulk pushes
+ * therefore cost one CAS and one release store per burst rather than per element.
+ * The price is that a producer preempted between reserving and publishing stalls
+ * the producers behind it; give producers dedicated cores.
+ *
+ * Capacity is rounded up to a power of two. The producer and consumer indexes live on
+ * separate cache lines. T must be default constructible and copy assignable.
+ */
+template <typename T>
+class MpscRing {
+public:
+    /**
+     * @param capacity Minimum number of elements the ring holds.
+     * @throws std::invalid_argument if capacity is 0 or larger than SIZE_MAX / 2.
+     */
+    explicit MpscRing(size_t capacity) : mask_(round_up_to_power_of_two(capacity) - 1),
+                                         slots_(new T[mask_ + 1]) {}
+
+    MpscRing(const MpscRing&) = delete;
+    MpscRing& operator=(const MpscRing&) = delete;
+
+    size_t capacity() const { return mask_ + 1; }
+
+    /** @brief Number of published elements; exact only when no thread is active. */
+    size_t size() const {
+        return published_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+    bool empty() const { return size() == 0; }
+
+    // --- Producer side (any thread) ---
+
+    /** @brief Appends `item`; returns false if the ring is full. */
+    bool try_push(const T& item) {
+        return push_burst(&item, 1) == 1;
+    }
+
+    /**
+     * @brief Appends up to `count` elements from `items` as one contiguous run.
+     * @return The number of elements appended: all of them unless the ring filled up.
+     */
+    size_t push_burst(const T* items, size_t count) {
+        size_t start = reserved_.load(std::memory_order_relaxed);
+        size_t pushed;
+        do {
+            const size_t free_slots = capacity() - (start - head_.load(std::memory_order_acquire));
+            pushed = free_slots < count ? free_slots : count;
+            if (pushed == 0) {
+                return 0;
+            }
+        } while (!reserved_.compare_exchange_weak(start, start + pushed, std::memory_order_acquire,
+                                                  std::memory_order_relaxed));
+
+        for (size_t i = 0; i < pushed; ++i) {
+            slots_[(start + i) & mask_] = items[i];
+        }
+        // Publish in reservation order: wait for the runs reserved before this one.
+        while (published_.load(std::memory_order_acquire) != start) {
+            std::this_thread::yield();
+        }
+        published_.store(start + pushed, std::memory_order_release);
+        return pushed;
+    }
+
+    // --- Consumer side (one thread) ---
+
+    /** @brief Removes the oldest element into `out`; returns false if the ring is empty. */
+    bool try_pop(T& out) {
+        return pop_burst(&out, 1) == 1;
+    }
+
+    /**
+     * @brief Removes up to `max_items` elements, oldest first, into `out`.
+     * @return The number of elements removed.
+     */
+    size_t pop_burst(T* out, size_t max_items) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        const size_t available = published_.load(std::memory_order_acquire) - head;
+        const size_t count = available < max_items ? available : max_items;
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = slots_[(head + i) & mask_];
+        }
+        if (count != 0) {
+            head_.store(head + count, std::memory_order_release); // Frees the slots for producers
+        }
+        return count;
+    }
+
+private:
+    static size_t round_up_to_power_of_two(size_t capacity) {
+        if (capacity == 0 || capacity > (static_cast<size_t>(-1) >> 1)) {
+            throw std::invalid_argument("MpscRing: capacity must be between 1 and SIZE_MAX / 2.");
+        }
+        size_t rounded = 1;
+        while (rounded < capacity) {
+            rounded <<= 1;
+        }
+        return rounded;
+    }
+
+    const size_t mask_;
+    const std::unique_ptr<T[]> slots_;
+
+    // Producer lines: next slot to reserve, and end of the published runs.
+    alignas(64) std::atomic<size_t> reserved_{0};
+    alignas(64) std::atomic<size_t> published_{0};
+
+    // Consumer line.
+    alignas(64) std::atomic<size_t> head_{0};
+
+    // Keep whatever follows the ring off the consumer's line.
+    alignas(64) char end_padding_[1] = {};
+};
+
+} // namespace core
+} // namespace hqts
+
+#endif // HQTS_CORE_MPSC_RING_H_
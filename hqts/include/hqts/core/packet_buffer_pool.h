@@ -0,0 +1,147 @@
+#ifndef HQTS_CORE_PACKET_BUFFER_POOL_H_
+#define HQTS_CORE_PACKET_BUFFER_POOL_H_
+
+#include "hqts/core/mpsc_ring.h" // For MpscRing
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef> // For std::byte, size_t
+#include <thread>  // For std::thread::id
+#include <vector>
+
+namespace hqts {
+namespace core {
+
+/**
+ * @brief Opaque reference to a buffer owned by a PacketBufferPool.
+ *
+ * The upper 8 bits identify the owning pool, the lower 24 bits the buffer within it,
+ * so a handle can be released without knowing which pool it came from (like an mbuf
+ * pointing back to its mempool). Zero is never a valid handle.
+ */
+using PacketBufferHandle = uint32_t;
+
+constexpr PacketBufferHandle INVALID_PACKET_BUFFER = 0;
+
+/**
+ * @brief Fixed-size pool of reference-counted packet buffers (mbuf-style).
+ *
+ * All buffer memory is allocated once at construction, so allocate()/release() never
+ * touch the heap. Payload bytes are written once at ingress and read in place at
+ * transmit; everything in between only passes the 32-bit handle around.
+ *
+ * A handle stored in a PacketDescriptor represents one reference. Copying the
+ * descriptor does not add a reference; call retain() when a packet is duplicated
+ * (e.g. mirrored) and release() once per reference when done with it.
+ *
+ * allocate() and the metadata setters belong to the pool's owner thread: the one that
+ * constructed it, or that last called bind_to_current_thread(). Any thread may retain()
+ * and release() references, so packets can be dropped or transmitted on other cores:
+ * a buffer whose last reference another thread drops is handed back through a
+ * lock-free return ring, which the owner drains into the free list when it runs out
+ * of buffers or calls reclaim_remote_releases().
+ */
+class PacketBufferPool {
+public:
+    static constexpr size_t MAX_BUFFERS_PER_POOL = (1u << 24) - 1;
+    static constexpr size_t MAX_POOLS = 255;
+
+    /**
+     * @brief Constructs a pool and registers it so its handles can be released globally.
+     * @param num_buffers Number of buffers in the pool (1 .. MAX_BUFFERS_PER_POOL).
+     * @param buffer_size_bytes Size of each buffer in bytes (> 0).
+     * @throws std::invalid_argument if a parameter is out of range.
+     * @throws std::runtime_error if MAX_POOLS pools are already registered.
+     */
+    PacketBufferPool(size_t num_buffers, uint32_t buffer_size_bytes);
+    ~PacketBufferPool();
+
+    // The pool is registered by address, so it must stay put.
+    PacketBufferPool(const PacketBufferPool&) = delete;
+    PacketBufferPool& operator=(const PacketBufferPool&) = delete;
+    PacketBufferPool(PacketBufferPool&&) = delete;
+    PacketBufferPool& operator=(PacketBufferPool&&) = delete;
+
+    /**
+     * @brief Takes a buffer from the pool with a reference count of one and no data.
+     *        Owner thread only.
+     * @return The buffer's handle, or INVALID_PACKET_BUFFER if the pool is exhausted.
+     */
+    PacketBufferHandle allocate();
+
+    /**
+     * @brief Makes the calling thread the owner, e.g. the RX thread of a pool built by the
+     *        control plane. Call before handles are passed to other threads.
+     */
+    void bind_to_current_thread() { owner_thread_ = std::this_thread::get_id(); }
+
+    /**
+     * @brief Moves buffers other threads released back to the free list. Owner thread only.
+     * @return The number of buffers reclaimed.
+     */
+    size_t reclaim_remote_releases();
+
+    /**
+     * @brief Adds a reference to an allocated buffer.
+     * @throws std::invalid_argument if the handle does not refer to an allocated buffer of this pool.
+     */
+    void retain(PacketBufferHandle handle);
+
+    /**
+     * @brief Drops a reference; the buffer returns to the pool when the last one is dropped,
+     *        through the return ring if that happens on a thread other than the owner.
+     * @throws std::invalid_argument if the handle does not refer to an allocated buffer of this pool.
+     */
+    void release(PacketBufferHandle handle);
+
+    std::byte* data(PacketBufferHandle handle);
+    const std::byte* data(PacketBufferHandle handle) const;
+
+    uint32_t data_length(PacketBufferHandle handle) const;
+
+    /**
+     * @brief Sets the number of valid payload bytes in the buffer.
+     * @throws std::invalid_argument if length exceeds buffer_size().
+     */
+    void set_data_length(PacketBufferHandle handle, uint32_t length);
+
+    uint32_t ref_count(PacketBufferHandle handle) const;
+
+    uint32_t buffer_size() const { return buffer_size_; }
+    size_t capacity() const { return data_lengths_.size(); }
+
+    /** @brief Free buffers, including those awaiting reclaim; exact only when no other thread releases. */
+    size_t available() const { return free_list_.size() + remote_returns_.size(); }
+
+    /**
+     * @brief Finds the pool that issued a handle.
+     * @return The owning pool, or nullptr for INVALID_PACKET_BUFFER or an unknown pool.
+     */
+    static PacketBufferPool* owner_of(PacketBufferHandle handle);
+
+    /**
+     * @brief Releases a handle through its owning pool, from any thread. No-op for
+     *        INVALID_PACKET_BUFFER, so components that drop packets can call it unconditionally.
+     */
+    static void release_any(PacketBufferHandle handle);
+
+private:
+    // Maps a handle to its buffer index, validating that it belongs to this pool
+    // and is currently allocated.
+    uint32_t checked_index(PacketBufferHandle handle) const;
+
+    uint32_t pool_slot_;
+    uint32_t buffer_size_;
+    std::vector<std::byte> storage_;
+    std::vector<std::atomic<uint32_t>> ref_counts_; // Updated by any thread holding a reference
+    std::vector<uint32_t> data_lengths_;
+    std::vector<uint32_t> free_list_; // LIFO of free buffer indices, keeps recently used buffers cache-warm
+    std::thread::id owner_thread_;
+    // Indices whose last reference was dropped off the owner thread; holds every buffer, so never fills.
+    MpscRing<uint32_t> remote_returns_;
+};
+
+} // namespace core
+} // namespace hqts
+
+#endif // HQTS_CORE_PACKET_BUFFER_POOL_H_
@@ -3,15 +3,26 @@
 
 #include "hqts/dataplane/flow_identifier.h"   // For dataplane::FiveTuple
 #include "hqts/scheduler/packet_descriptor.h" // For scheduler::PacketDescriptor
+#include "hqts/core/packet_buffer_pool.h"     // For core::PacketBufferHandle
+#include "hqts/core/time_source.h"            // For core::TimestampNs
+#include "hqts/core/timing_wheel.h"           // For TimingWheel, used by the inline member definitions
+#include "hqts/core/egress_pacer.h"           // For EgressPacer, used by the inline member definitions
+#include "hqts/core/stage_profiler.h"         // For HQTS_PROFILE_STAGE
 
 #include <vector>   // For std::vector
-#include <cstddef>  // For std::byte
+#include <cstddef>  // For std::byte, size_t
+#include <cstdint>  // For uint32_t
+#include <cstring>  // For std::memcpy
+#include <stdexcept> // For std::logic_error, std::invalid_argument
+#include <string>   // For std::to_string
+#include <utility>  // For std::move
 // memory for std::unique_ptr or shared_ptr is not used in this header's declarations
 
-// Forward declarations to minimize header include dependencies
+// Forward declarations to minimize header include dependencies: the default
+// instantiation (PacketPipeline) is compiled once, in packet_pipeline.cpp.
 namespace hqts {
 namespace dataplane { class FlowClassifier; }
-namespace core { class TrafficShaper; } // TrafficShaper is in hqts::core
+namespace core { class TrafficShaper; } // In hqts::core
 namespace scheduler { class SchedulerInterface; }
 } // namespace hqts
 
@@ -19,25 +30,68 @@ namespace scheduler { class SchedulerInterface; }
 namespace hqts {
 namespace core {
 
-class PacketPipeline {
+/**
+ * @brief One entry of an ingress burst handed to PacketPipeline::handle_incoming_burst.
+ */
+struct IncomingPacket {
+    dataplane::FiveTuple five_tuple;
+    uint32_t packet_length_bytes = 0;
+    // Optional payload already written into a PacketBufferPool buffer; ownership of
+    // this reference passes to the pipeline.
+    PacketBufferHandle buffer = INVALID_PACKET_BUFFER;
+
+    IncomingPacket() = default;
+    IncomingPacket(const dataplane::FiveTuple& tuple, uint32_t length,
+                   PacketBufferHandle buffer_handle = INVALID_PACKET_BUFFER)
+        : five_tuple(tuple), packet_length_bytes(length), buffer(buffer_handle) {}
+};
+
+/**
+ * @brief Ingress-to-scheduler data path: classify, meter, enqueue; and the dequeue side.
+ *
+ * The stages are template parameters so a configuration known at compile time can be
+ * inlined end to end: with a scheduler::StaticScheduler hierarchy as Scheduler no call
+ * on the packet path is virtual. PacketPipeline is the instantiation over the runtime
+ * types (a SchedulerInterface chosen and configured at run time).
+ *
+ * Built with HQTS_ENABLE_PROFILING, the enqueue and dequeue calls (and, inside the
+ * shaper and queues, classify, meter and AQM) add their cycles to the StageCycleCounters
+ * the calling thread has bound with bind_stage_counters().
+ *
+ * @tparam Classifier The flow classifier type (dataplane::FlowClassifier).
+ * @tparam Shaper Provides TrafficShaper's process_packet() and process_burst().
+ * @tparam Scheduler Provides SchedulerInterface's enqueue(), try_dequeue(),
+ *         enqueue_burst() and dequeue_burst(), virtual or not.
+ */
+template <typename Classifier, typename Shaper, typename Scheduler>
+class BasicPacketPipeline {
 public:
     /**
      * @brief Constructor for PacketPipeline.
      * @param classifier Reference to the FlowClassifier instance.
      * @param shaper Reference to the TrafficShaper instance.
-     * @param scheduler Reference to the SchedulerInterface instance.
+     * @param scheduler Reference to the scheduler instance.
+     * @param buffer_pool Optional pool that payloads passed as byte vectors are copied into.
+     *                    Not needed when callers hand over PacketBufferHandles directly.
+     * @param shaping_wheel Optional wheel holding packets that policies with shape_to_cir
+     *                      delay. Without one such packets are policed (RED) instead.
+     *                      Its clock must be the one passed as now_ns to the pipeline.
+     * @param egress_pacer Optional pacer that get_packets_due() stamps departure times with.
      */
-    PacketPipeline(
-        dataplane::FlowClassifier& classifier,
-        TrafficShaper& shaper, // TrafficShaper is in hqts::core
-        scheduler::SchedulerInterface& scheduler);
+    BasicPacketPipeline(
+        Classifier& classifier,
+        Shaper& shaper,
+        Scheduler& scheduler,
+        PacketBufferPool* buffer_pool = nullptr,
+        TimingWheel* shaping_wheel = nullptr,
+        EgressPacer* egress_pacer = nullptr);
 
     // PacketPipeline is stateful via its references, make it non-copyable/non-movable
     // if it's intended to be a long-lived service object.
-    PacketPipeline(const PacketPipeline&) = delete;
-    PacketPipeline& operator=(const PacketPipeline&) = delete;
-    PacketPipeline(PacketPipeline&&) = delete;
-    PacketPipeline& operator=(PacketPipeline&&) = delete;
+    BasicPacketPipeline(const BasicPacketPipeline&) = delete;
+    BasicPacketPipeline& operator=(const BasicPacketPipeline&) = delete;
+    BasicPacketPipeline(BasicPacketPipeline&&) = delete;
+    BasicPacketPipeline& operator=(BasicPacketPipeline&&) = delete;
 
 
     /**
@@ -46,25 +100,362 @@ public:
      * and if the packet is not dropped by the shaper, enqueues it into the scheduler.
      * @param five_tuple The 5-tuple identifying the packet's flow.
      * @param packet_length_bytes The total length of the packet in bytes.
-     * @param payload Optional payload data for the packet.
+     * @param payload Optional payload data for the packet. A non-empty payload is copied
+     *                once into a buffer from the pipeline's pool; if the pool is exhausted
+     *                the packet is dropped.
+     * @throws std::logic_error if a payload is given but no buffer pool was configured.
+     * @throws std::invalid_argument if the payload does not fit into a pool buffer.
      */
     void handle_incoming_packet(const dataplane::FiveTuple& five_tuple,
                                 uint32_t packet_length_bytes,
                                 const std::vector<std::byte>& payload = {});
 
+    /**
+     * @brief Zero-copy variant: the payload already lives in a PacketBufferPool buffer.
+     * The pipeline takes over the caller's reference; it is released if the packet is
+     * dropped, otherwise it travels with the descriptor to the transmit side.
+     * @param five_tuple The 5-tuple identifying the packet's flow.
+     * @param packet_length_bytes The total length of the packet in bytes.
+     * @param buffer Handle of the buffer holding the payload.
+     */
+    void handle_incoming_packet(const dataplane::FiveTuple& five_tuple,
+                                uint32_t packet_length_bytes,
+                                PacketBufferHandle buffer);
+
+    /**
+     * @brief As the zero-copy handle_incoming_packet(), with the packet's arrival time
+     *        supplied by the caller (e.g. a NIC RX timestamp) instead of read from the clock.
+     * @param now_ns Arrival time in nanoseconds (see TimestampNs).
+     */
+    void handle_incoming_packet(const dataplane::FiveTuple& five_tuple,
+                                uint32_t packet_length_bytes,
+                                PacketBufferHandle buffer,
+                                TimestampNs now_ns);
+
     /**
      * @brief Retrieves the next packet to be "transmitted" from the scheduler.
+     * The caller takes over the packet's buffer reference and releases it once the
+     * payload has been transmitted.
      * @return A PacketDescriptor for the next packet. If the scheduler is empty,
      *         a default-constructed (e.g., invalid) PacketDescriptor is returned.
      */
     scheduler::PacketDescriptor get_next_packet_to_transmit();
 
+    /**
+     * @brief As get_next_packet_to_transmit(), first moving the packets the shaping wheel
+     *        releases by now_ns into the scheduler.
+     * @param now_ns Current time in nanoseconds (see TimestampNs).
+     */
+    scheduler::PacketDescriptor get_next_packet_to_transmit(TimestampNs now_ns);
+
+    /**
+     * @brief Handles a burst of incoming packets (typically 32-256 per call).
+     *
+     * Equivalent to calling handle_incoming_packet() for each entry in order, but the
+     * work is done in stages over the whole burst: classification (one flow-table probe per packet),
+     * metering (through each flow's cached policy handle) and enqueueing
+     * (one scheduler call).
+     *
+     * @param burst The packets to handle, in arrival order.
+     * @return The number of packets enqueued or held by the shaping wheel; the rest
+     *         were dropped.
+     */
+    size_t handle_incoming_burst(const std::vector<IncomingPacket>& burst);
+
+    /**
+     * @brief As handle_incoming_burst(), with one caller-supplied arrival time for the
+     *        whole burst; the clock is otherwise read once per burst.
+     * @param now_ns Arrival time of the burst in nanoseconds (see TimestampNs).
+     */
+    size_t handle_incoming_burst(const std::vector<IncomingPacket>& burst, TimestampNs now_ns);
+
+    /**
+     * @brief Retrieves up to max_packets packets to be "transmitted", in scheduling order.
+     * @param out Vector the dequeued packets are appended to.
+     * @param max_packets Maximum number of packets to retrieve.
+     * @return The number of packets appended to `out`; fewer than max_packets only
+     *         if the scheduler ran empty.
+     */
+    size_t get_next_burst(std::vector<scheduler::PacketDescriptor>& out, size_t max_packets);
+
+    /**
+     * @brief As get_next_burst(), first moving the packets the shaping wheel releases by
+     *        now_ns into the scheduler.
+     * @param now_ns Current time in nanoseconds (see TimestampNs).
+     */
+    size_t get_next_burst(std::vector<scheduler::PacketDescriptor>& out, size_t max_packets,
+                          TimestampNs now_ns);
+
+    /**
+     * @brief Retrieves up to max_packets packets that depart within the egress pacer's
+     *        horizon of now_ns, each with its departure time in transmit_time_ns, for a
+     *        NIC with timestamp-based transmit (see EgressPacer).
+     *
+     * Moves the packets the shaping wheel releases by now_ns into the scheduler first.
+     * Fewer than max_packets are returned if the scheduler ran empty or the next packet
+     * departs later; EgressPacer::next_due_ns() tells when to call again.
+     *
+     * @param now_ns Current time in nanoseconds (see TimestampNs).
+     * @return The number of packets appended to `out`.
+     * @throws std::logic_error if no egress pacer was configured.
+     */
+    size_t get_packets_due(std::vector<scheduler::PacketDescriptor>& out, size_t max_packets,
+                           TimestampNs now_ns);
+
 private:
-    dataplane::FlowClassifier& classifier_;
-    TrafficShaper& shaper_; // TrafficShaper is in hqts::core
-    scheduler::SchedulerInterface& scheduler_;
+    /**
+     * @brief Hands a metered packet to the scheduler, or to the shaping wheel if its
+     *        release time lies after now_ns. Returns false if it had to be dropped.
+     */
+    bool admit(scheduler::PacketDescriptor& packet, TimestampNs release_ns, TimestampNs now_ns);
+
+    /** @brief Enqueues every packet the shaping wheel has released by now_ns. */
+    void release_shaped(TimestampNs now_ns);
+
+    Classifier& classifier_;
+    Shaper& shaper_;
+    Scheduler& scheduler_;
+    PacketBufferPool* buffer_pool_;
+    TimingWheel* shaping_wheel_;
+    EgressPacer* egress_pacer_;
+
+    // Scratch storage reused across bursts.
+    std::vector<scheduler::PacketDescriptor> burst_packets_;
+    std::vector<dataplane::FiveTuple> burst_five_tuples_;
+    std::vector<TimestampNs> burst_release_ns_;
 };
 
+/// The pipeline over the runtime-configured stages.
+using PacketPipeline = BasicPacketPipeline<dataplane::FlowClassifier, TrafficShaper, scheduler::SchedulerInterface>;
+
+// --- Member definitions ---
+
+template <typename Classifier, typename Shaper, typename Scheduler>
+BasicPacketPipeline<Classifier, Shaper, Scheduler>::BasicPacketPipeline(
+    Classifier& classifier,
+    Shaper& shaper,
+    Scheduler& scheduler,
+    PacketBufferPool* buffer_pool,
+    TimingWheel* shaping_wheel,
+    EgressPacer* egress_pacer)
+    : classifier_(classifier), shaper_(shaper), scheduler_(scheduler), buffer_pool_(buffer_pool),
+      shaping_wheel_(shaping_wheel), egress_pacer_(egress_pacer) {
+    // Constructor body, if any initialization beyond member list is needed
+}
+
+template <typename Classifier, typename Shaper, typename Scheduler>
+void BasicPacketPipeline<Classifier, Shaper, Scheduler>::handle_incoming_packet(
+    const dataplane::FiveTuple& five_tuple,
+    uint32_t packet_length_bytes,
+    const std::vector<std::byte>& payload) {
+
+    PacketBufferHandle buffer = INVALID_PACKET_BUFFER;
+    if (!payload.empty()) {
+        if (buffer_pool_ == nullptr) {
+            throw std::logic_error("PacketPipeline: payload given but no PacketBufferPool configured.");
+        }
+        if (payload.size() > buffer_pool_->buffer_size()) {
+            throw std::invalid_argument("PacketPipeline: payload of " + std::to_string(payload.size()) +
+                                        " bytes exceeds pool buffer size " +
+                                        std::to_string(buffer_pool_->buffer_size()));
+        }
+        buffer = buffer_pool_->allocate();
+        if (buffer == INVALID_PACKET_BUFFER) {
+            return; // Pool exhausted: drop at ingress, like a NIC out of RX descriptors.
+        }
+        // The only copy of the payload: into the pool buffer, where it stays until transmit.
+        std::memcpy(buffer_pool_->data(buffer), payload.data(), payload.size());
+        buffer_pool_->set_data_length(buffer, static_cast<uint32_t>(payload.size()));
+    }
+    handle_incoming_packet(five_tuple, packet_length_bytes, buffer);
+}
+
+template <typename Classifier, typename Shaper, typename Scheduler>
+void BasicPacketPipeline<Classifier, Shaper, Scheduler>::handle_incoming_packet(
+    const dataplane::FiveTuple& five_tuple,
+    uint32_t packet_length_bytes,
+    PacketBufferHandle buffer) {
+    handle_incoming_packet(five_tuple, packet_length_bytes, buffer, steady_now_ns());
+}
+
+template <typename Classifier, typename Shaper, typename Scheduler>
+void BasicPacketPipeline<Classifier, Shaper, Scheduler>::handle_incoming_packet(
+    const dataplane::FiveTuple& five_tuple,
+    uint32_t packet_length_bytes,
+    PacketBufferHandle buffer,
+    TimestampNs now_ns) {
+
+    // 1. Create a PacketDescriptor.
+    // Initial FlowId and priority are set to dummy values (e.g., 0).
+    // TrafficShaper will set the correct packet.flow_id after classification
+    // and packet.priority based on policy and conformance.
+    scheduler::PacketDescriptor packet(
+        0, // Initial dummy flow_id
+        packet_length_bytes,
+        0, // Initial dummy priority
+        buffer // Payload reference travels with the descriptor
+    );
+
+    // 2. Process through TrafficShaper.
+    // TrafficShaper::process_packet will:
+    //   a. Use FlowClassifier to get/create FlowId and associated FlowContext.
+    //   b. Set packet.flow_id.
+    //   c. Apply token buckets from the policy.
+    //   d. Set packet.conformance (GREEN, YELLOW, RED).
+    //   e. Set packet.priority based on conformance and policy targets.
+    //   f. Return true if packet should be enqueued, false if dropped by policy.
+    //   g. With a shaping wheel, report when a shaped packet may be sent.
+    TimestampNs release_ns = now_ns;
+    bool should_enqueue = shaper_.process_packet(packet, five_tuple, now_ns,
+                                                 shaping_wheel_ != nullptr ? &release_ns : nullptr);
+
+    // 3. Enqueue (or hold until its release time) if not dropped. The scheduler releases
+    //    the buffers of packets its queues drop.
+    if (!should_enqueue || !admit(packet, release_ns, now_ns)) {
+        // Packet was dropped by the shaper (due to policy, e.g., RED and drop_on_red=true)
+        // or the shaping wheel is full.
+        // Action: Log, increment drop counter, etc. (Not implemented here)
+        PacketBufferPool::release_any(packet.buffer);
+    }
+}
+
+template <typename Classifier, typename Shaper, typename Scheduler>
+bool BasicPacketPipeline<Classifier, Shaper, Scheduler>::admit(scheduler::PacketDescriptor& packet, TimestampNs release_ns, TimestampNs now_ns) {
+    if (release_ns > now_ns) {
+        return shaping_wheel_->schedule(packet, release_ns); // Only shaped packets have later times
+    }
+    HQTS_PROFILE_STAGE(ProfileStage::ENQUEUE);
+    scheduler_.enqueue(std::move(packet)); // Takes the packet whatever the result
+    return true;
+}
+
+template <typename Classifier, typename Shaper, typename Scheduler>
+void BasicPacketPipeline<Classifier, Shaper, Scheduler>::release_shaped(TimestampNs now_ns) {
+    if (shaping_wheel_->advance(now_ns) == 0) {
+        return;
+    }
+    burst_packets_.clear();
+    while (shaping_wheel_->has_ready()) {
+        burst_packets_.push_back(shaping_wheel_->pop_ready());
+    }
+    HQTS_PROFILE_STAGE(ProfileStage::ENQUEUE, burst_packets_.size());
+    scheduler_.enqueue_burst(burst_packets_.data(), burst_packets_.size());
+}
+
+template <typename Classifier, typename Shaper, typename Scheduler>
+scheduler::PacketDescriptor BasicPacketPipeline<Classifier, Shaper, Scheduler>::get_next_packet_to_transmit() {
+    if (shaping_wheel_ != nullptr) {
+        return get_next_packet_to_transmit(steady_now_ns());
+    }
+    // Return a default-constructed PacketDescriptor if the scheduler is empty.
+    // The default PacketDescriptor constructor sets flow_id=0, length=0, etc.
+    // which can be checked by the caller to see if it's a valid packet.
+    HQTS_PROFILE_STAGE(ProfileStage::DEQUEUE);
+    return scheduler_.try_dequeue().value_or(scheduler::PacketDescriptor());
+}
+
+template <typename Classifier, typename Shaper, typename Scheduler>
+scheduler::PacketDescriptor BasicPacketPipeline<Classifier, Shaper, Scheduler>::get_next_packet_to_transmit(TimestampNs now_ns) {
+    if (shaping_wheel_ != nullptr) {
+        release_shaped(now_ns);
+    }
+    HQTS_PROFILE_STAGE(ProfileStage::DEQUEUE);
+    return scheduler_.try_dequeue().value_or(scheduler::PacketDescriptor());
+}
+
+template <typename Classifier, typename Shaper, typename Scheduler>
+size_t BasicPacketPipeline<Classifier, Shaper, Scheduler>::handle_incoming_burst(const std::vector<IncomingPacket>& burst) {
+    return handle_incoming_burst(burst, steady_now_ns());
+}
+
+template <typename Classifier, typename Shaper, typename Scheduler>
+size_t BasicPacketPipeline<Classifier, Shaper, Scheduler>::handle_incoming_burst(const std::vector<IncomingPacket>& burst, TimestampNs now_ns) {
+    if (burst.empty()) {
+        return 0;
+    }
+
+    // 1. Build descriptors and the matching tuple array for the whole burst.
+    burst_packets_.clear();
+    burst_five_tuples_.clear();
+    burst_packets_.reserve(burst.size());
+    burst_five_tuples_.reserve(burst.size());
+    for (const IncomingPacket& incoming : burst) {
+        burst_packets_.emplace_back(0, incoming.packet_length_bytes, 0, incoming.buffer);
+        burst_five_tuples_.push_back(incoming.five_tuple);
+    }
+
+    // 2. Classify and meter the burst; kept packets are compacted to the front.
+    TimestampNs* release_ns = nullptr;
+    if (shaping_wheel_ != nullptr) {
+        burst_release_ns_.resize(burst.size());
+        release_ns = burst_release_ns_.data();
+    }
+    size_t accepted = shaper_.process_burst(burst_packets_.data(), burst_five_tuples_.data(),
+                                            burst_packets_.size(), now_ns, release_ns);
+    for (size_t i = accepted; i < burst_packets_.size(); ++i) {
+        PacketBufferPool::release_any(burst_packets_[i].buffer); // Shaper drops
+    }
+
+    if (release_ns != nullptr) {
+        // Packets to be sent later go to the wheel; the rest stay compacted at the front.
+        size_t immediate = 0;
+        size_t admitted = 0; // Held by the wheel
+        for (size_t i = 0; i < accepted; ++i) {
+            if (release_ns[i] <= now_ns) {
+                burst_packets_[immediate++] = burst_packets_[i];
+            } else if (shaping_wheel_->schedule(burst_packets_[i], release_ns[i])) {
+                ++admitted;
+            } else {
+                PacketBufferPool::release_any(burst_packets_[i].buffer); // Wheel full
+            }
+        }
+        HQTS_PROFILE_STAGE(ProfileStage::ENQUEUE, immediate);
+        return admitted + scheduler_.enqueue_burst(burst_packets_.data(), immediate);
+    }
+
+    // 3. Hand the survivors to the scheduler in one call.
+    HQTS_PROFILE_STAGE(ProfileStage::ENQUEUE, accepted);
+    return scheduler_.enqueue_burst(burst_packets_.data(), accepted);
+}
+
+template <typename Classifier, typename Shaper, typename Scheduler>
+size_t BasicPacketPipeline<Classifier, Shaper, Scheduler>::get_next_burst(std::vector<scheduler::PacketDescriptor>& out, size_t max_packets) {
+    if (shaping_wheel_ != nullptr) {
+        return get_next_burst(out, max_packets, steady_now_ns());
+    }
+    size_t dequeued = 0;
+    HQTS_PROFILE_STAGE_RESULT(ProfileStage::DEQUEUE, dequeued);
+    dequeued = scheduler_.dequeue_burst(out, max_packets);
+    return dequeued;
+}
+
+template <typename Classifier, typename Shaper, typename Scheduler>
+size_t BasicPacketPipeline<Classifier, Shaper, Scheduler>::get_next_burst(std::vector<scheduler::PacketDescriptor>& out, size_t max_packets,
+                                      TimestampNs now_ns) {
+    if (shaping_wheel_ != nullptr) {
+        release_shaped(now_ns);
+    }
+    size_t dequeued = 0;
+    HQTS_PROFILE_STAGE_RESULT(ProfileStage::DEQUEUE, dequeued);
+    dequeued = scheduler_.dequeue_burst(out, max_packets);
+    return dequeued;
+}
+
+template <typename Classifier, typename Shaper, typename Scheduler>
+size_t BasicPacketPipeline<Classifier, Shaper, Scheduler>::get_packets_due(std::vector<scheduler::PacketDescriptor>& out,
+                                                                           size_t max_packets, TimestampNs now_ns) {
+    if (egress_pacer_ == nullptr) {
+        throw std::logic_error("PacketPipeline: get_packets_due() needs an EgressPacer.");
+    }
+    if (shaping_wheel_ != nullptr) {
+        release_shaped(now_ns);
+    }
+    return egress_pacer_->get_packets_due(scheduler_, out, max_packets, now_ns);
+}
+
+// Compiled once in packet_pipeline.cpp.
+extern template class BasicPacketPipeline<dataplane::FlowClassifier, TrafficShaper, scheduler::SchedulerInterface>;
+
 } // namespace core
 } // namespace hqts
 
@@ -0,0 +1,132 @@
+#ifndef HQTS_CORE_PER_CORE_STATISTICS_H_
+#define HQTS_CORE_PER_CORE_STATISTICS_H_
+
+#include "hqts/core/prefetch.h"               // For prefetch_for_write
+#include "hqts/core/shaping_policy.h"         // For PolicyStatistics
+#include "hqts/core/single_writer.h"          // For single_writer_add
+#include "hqts/policy/policy_types.h"         // For PolicyId
+#include "hqts/scheduler/packet_descriptor.h" // For ConformanceLevel
+
+#include <array>
+#include <atomic>
+#include <cstddef> // For size_t
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <utility> // For std::pair
+#include <vector>
+
+namespace hqts {
+namespace core {
+
+/**
+ * @brief One core's counters for one policy: a cache line only that core writes.
+ */
+struct alignas(64) PolicyCounterBlock {
+    std::atomic<uint64_t> packets_processed{0};
+    std::atomic<uint64_t> bytes_processed{0};
+    std::atomic<uint64_t> packets_dropped{0};
+    std::atomic<uint64_t> bytes_dropped{0};
+    std::array<std::atomic<uint64_t>, 3> packets_by_conformance{}; // Indexed by ConformanceLevel
+};
+
+/**
+ * @brief Per-policy traffic counters with one block per core, folded on read.
+ *
+ * Each data-path core (a ShardedRuntime worker, or the one thread of a
+ * PacketPipeline) writes only its own PolicyCounterBlock of a policy with
+ * single_writer_add(), so counting a packet never takes a lock or bounces a cache
+ * line between cores, however many cores meter the same policy. Readers (monitoring,
+ * the control plane) fold a policy's blocks across cores with read() or read_all() at
+ * any time; a fold taken while packets are flowing is not a consistent cut across
+ * cores, but every counter is monotonic.
+ *
+ * Policies are given dense slots on first use with slot_of(), which data-path users
+ * call when they see a new policy snapshot rather than per packet. Capacity is fixed
+ * at construction: the blocks never move, so writers need no synchronization with
+ * readers.
+ */
+class PerCorePolicyStatistics {
+public:
+    /// slot_of() result once max_policies slots are in use; record() ignores it.
+    static constexpr uint32_t NO_SLOT = UINT32_MAX;
+
+    /**
+     * @param num_cores Number of writers; each passes its index (0 .. num_cores-1) to record().
+     * @param max_policies Number of distinct policies that can be counted.
+     * @throws std::invalid_argument if num_cores or max_policies is 0.
+     */
+    PerCorePolicyStatistics(size_t num_cores, size_t max_policies);
+
+    PerCorePolicyStatistics(const PerCorePolicyStatistics&) = delete;
+    PerCorePolicyStatistics& operator=(const PerCorePolicyStatistics&) = delete;
+
+    size_t num_cores() const { return num_cores_; }
+    size_t max_policies() const { return max_policies_; }
+
+    /**
+     * @brief The slot of policy `id`, assigning the next free one on its first call.
+     *
+     * Takes a mutex: call it when a policy is first seen, not per packet.
+     *
+     * @return The slot, or NO_SLOT if the policy is new and all slots are in use.
+     */
+    uint32_t slot_of(policy::PolicyId id);
+
+    /**
+     * @brief Counts one packet of the policy in `slot` on core `core`.
+     *
+     * Only core `core` may call this with its index. Dropped packets count as processed
+     * too, and by the conformance they were marked with.
+     *
+     * @param core Index of the calling core; must be below num_cores().
+     * @param slot Result of slot_of(); NO_SLOT counts nothing.
+     */
+    void record(size_t core, uint32_t slot, scheduler::ConformanceLevel conformance, uint32_t length_bytes,
+                bool dropped) {
+        if (slot == NO_SLOT) {
+            return;
+        }
+        PolicyCounterBlock& block = blocks_[core * max_policies_ + slot];
+        single_writer_add(block.packets_processed, 1);
+        single_writer_add(block.bytes_processed, length_bytes);
+        single_writer_add(block.packets_by_conformance[static_cast<size_t>(conformance)], 1);
+        if (dropped) {
+            single_writer_add(block.packets_dropped, 1);
+            single_writer_add(block.bytes_dropped, length_bytes);
+        }
+    }
+
+    /** @brief Prefetches the counters record() will write for `slot` on core `core`. */
+    void prefetch(size_t core, uint32_t slot) const {
+        if (slot != NO_SLOT) {
+            prefetch_for_write(&blocks_[core * max_policies_ + slot]);
+        }
+    }
+
+    /**
+     * @brief Totals of policy `id` over all cores; all zero if it was never given a slot.
+     */
+    PolicyStatistics read(policy::PolicyId id) const;
+
+    /**
+     * @brief Totals of every policy with a slot, in slot order.
+     */
+    std::vector<std::pair<policy::PolicyId, PolicyStatistics>> read_all() const;
+
+private:
+    PolicyStatistics fold(uint32_t slot) const;
+
+    size_t num_cores_;
+    size_t max_policies_;
+    std::vector<PolicyCounterBlock> blocks_; // Core-major: core c's blocks are [c * max_policies_, ...)
+
+    mutable std::mutex slots_mutex_; // Guards the two members below (control plane and snapshot changes)
+    std::unordered_map<policy::PolicyId, uint32_t> slots_;
+    std::vector<policy::PolicyId> slot_ids_; // slot -> policy
+};
+
+} // namespace core
+} // namespace hqts
+
+#endif // HQTS_CORE_PER_CORE_STATISTICS_H_
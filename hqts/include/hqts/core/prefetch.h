@@ -0,0 +1,38 @@
+#ifndef HQTS_CORE_PREFETCH_H_
+#define HQTS_CORE_PREFETCH_H_
+
+namespace hqts {
+namespace core {
+
+/**
+ * @brief Burst loops touch the data of the packet this many places ahead while working
+ *        on the current one: far enough for a DRAM miss to complete behind the work on
+ *        the packets in between, near enough that the lines are still cached when used.
+ */
+constexpr unsigned PREFETCH_DISTANCE = 4;
+
+/** @brief Hints that the cache line of `address` is about to be read. No-op without GCC builtins. */
+inline void prefetch_for_read(const void* address) {
+#if defined(__GNUC__)
+    __builtin_prefetch(address, 0, 3);
+#else
+    (void)address;
+#endif
+}
+
+/**
+ * @brief Hints that the cache line of `address` is about to be written, so it is fetched
+ *        in exclusive state. Never faults: a stale or null pointer only wastes the hint.
+ */
+inline void prefetch_for_write(const void* address) {
+#if defined(__GNUC__)
+    __builtin_prefetch(address, 1, 3);
+#else
+    (void)address;
+#endif
+}
+
+} // namespace core
+} // namespace hqts
+
+#endif // HQTS_CORE_PREFETCH_H_
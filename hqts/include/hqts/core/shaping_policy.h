@@ -5,6 +5,7 @@
 #include "hqts/core/token_bucket.h"
 #include "hqts/core/flow_context.h" // For core::QueueId
 
+#include <array>
 #include <cstdint>
 #include <vector>
 #include <string>
@@ -18,6 +19,7 @@ struct PolicyStatistics {
     uint64_t packets_processed = 0;
     uint64_t bytes_dropped = 0;
     uint64_t packets_dropped = 0;
+    std::array<uint64_t, 3> packets_by_conformance{}; // Indexed by scheduler::ConformanceLevel
     // Potentially add more detailed stats like:
     // uint64_t conforming_bytes = 0;
     // uint64_t excess_bytes = 0;
@@ -51,6 +53,13 @@ struct ShapingPolicy {
     core::QueueId target_queue_id_red;    // Target scheduler QueueId for RED packets (if not dropped)
     // DSCP values could also be added here if needed: uint8_t dscp_green, dscp_yellow, dscp_red;
 
+    // Shaping: with shape_to_cir set, traffic above the CIR is delayed to the CIR (by a
+    // caller that can hold packets, see PacketPipeline's shaping wheel) rather than
+    // marked YELLOW/RED; the PIR bucket is not used. Packets that would wait longer
+    // than max_shaping_delay_ns are RED.
+    bool shape_to_cir = false;
+    TimestampNs max_shaping_delay_ns = 10000000; // 10 ms
+
 
     // Token bucket state
     TokenBucket cir_bucket;
@@ -82,6 +91,29 @@ struct ShapingPolicy {
         core::QueueId qid_r = 0
     );
 
+    // As above with every parameter given and an explicit last_updated, so bulk loads
+    // read the clock once instead of once per policy.
+    ShapingPolicy(
+        policy::PolicyId p_id,
+        policy::PolicyId p_parent_id,
+        std::string p_name,
+        uint64_t p_committed_rate_bps,
+        uint64_t p_peak_rate_bps,
+        uint64_t p_committed_burst_bytes,
+        uint64_t p_excess_burst_bytes,
+        policy::SchedulingAlgorithm p_algorithm,
+        uint32_t p_weight,
+        policy::Priority p_priority_level,
+        bool p_drop_on_red,
+        uint8_t prio_g,
+        uint8_t prio_y,
+        uint8_t prio_r,
+        core::QueueId qid_g,
+        core::QueueId qid_y,
+        core::QueueId qid_r,
+        std::chrono::steady_clock::time_point p_last_updated
+    );
+
     // Default constructor might be needed by Boost.MultiIndex if not all members are initialized by the main constructor
     ShapingPolicy() = default; // Add default constructor if needed by multi_index_container
 };
@@ -0,0 +1,286 @@
+#ifndef HQTS_CORE_SHARDED_RUNTIME_H_
+#define HQTS_CORE_SHARDED_RUNTIME_H_
+
+#include "hqts/core/packet_pipeline.h"        // For IncomingPacket
+#include "hqts/core/mpsc_ring.h"              // For MpscRing
+#include "hqts/core/per_core_statistics.h"    // For PerCorePolicyStatistics
+#include "hqts/core/spsc_ring.h"              // For SpscRing
+#include "hqts/core/stage_profiler.h"         // For StageCycleCounters
+#include "hqts/core/traffic_shaper.h"         // For TrafficShaper
+#include "hqts/dataplane/flow_classifier.h"   // For FlowClassifier
+#include "hqts/dataplane/flow_table.h"        // For core::FlowTable
+#include "hqts/monitor/stats_segment.h"       // For StatsSegmentWriter
+#include "hqts/policy/runtime_policy_table.h" // For RuntimePolicyTable
+#include "hqts/scheduler/packet_descriptor.h" // For PacketDescriptor
+#include "hqts/scheduler/scheduler_interface.h" // For SchedulerInterface
+
+#include <atomic>
+#include <cstddef> // For size_t
+#include <cstdint>
+#include <functional> // For std::function
+#include <memory>     // For std::unique_ptr
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace hqts {
+namespace core {
+
+/**
+ * @brief Configuration of a ShardedRuntime.
+ */
+struct ShardedRuntimeConfig {
+    size_t num_workers = 1;
+    // CPU each worker thread is pinned to, by worker index. Empty, or -1 for a worker,
+    // leaves the thread unpinned. Pinning is best effort and a no-op outside Linux.
+    std::vector<int> worker_cpus;
+    int egress_cpu = -1;                     // CPU of the egress thread, -1 for unpinned
+    size_t ingress_ring_capacity = 4096;     // Per worker, rounded up to a power of two
+    size_t egress_ring_capacity = 4096;      // Shared by all workers, rounded up to a power of two
+    size_t burst_size = 32;                  // Packets moved per ring operation, at most
+    // Smallest burst: each thread's burst grows from here towards burst_size while its
+    // input stays full and shrinks back as it drains (see AdaptiveBurstSize). 0, or
+    // burst_size, keeps every burst at burst_size.
+    size_t min_burst_size = 0;
+    size_t flows_per_worker = FlowTable::DEFAULT_MAX_FLOWS;
+    // Aging and full-table policy of each worker's FlowTable. Workers call age() while
+    // idle and every aging_interval_bursts bursts while busy (0: only while idle).
+    FlowAgingConfig flow_aging;
+    size_t aging_interval_bursts = 64;
+    policy::PolicyId default_policy_id = 0;  // Policy of flows first seen by a worker
+    size_t max_counted_policies = 1024;      // Distinct policies policy_statistics() can count
+    // POSIX shared-memory name the egress thread publishes statistics to (see
+    // monitor::StatsSegmentWriter), e.g. "/hqts-stats"; empty publishes nothing.
+    std::string stats_segment_name;
+    monitor::StatsSegmentLayout stats_layout;
+    TimestampNs stats_interval_ns = 100000000; // 100 ms between stats segment updates
+};
+
+/**
+ * @brief Per-worker counters; written only by the worker (relaxed), readable at any time.
+ */
+struct alignas(64) WorkerCounters {
+    std::atomic<uint64_t> packets_received{0}; // Popped from the ingress ring
+    std::atomic<uint64_t> packets_dropped{0};  // Dropped by the worker's shaper
+    std::atomic<uint64_t> packets_forwarded{0}; // Pushed to the egress ring
+    std::atomic<uint64_t> burst_size{0};        // Current adaptive burst size
+    std::atomic<uint64_t> flows_expired{0};     // Idle flows aged out of the worker's FlowTable
+#if defined(HQTS_PROFILING)
+    StageCycleCounters stage_cycles;            // Classify, meter and AQM cycles of this worker
+#endif
+};
+
+/**
+ * @brief Multi-core run-to-completion data path: N worker shards behind RSS-style dispatch.
+ *
+ * Each worker owns a FlowTable, FlowClassifier and TrafficShaper metering against its
+ * own RuntimePolicyTable, and is the only thread touching them: flows are spread across
+ * workers by their FiveTuple hash, so all packets of a flow meet the same shard and
+ * the data path takes no locks. Threads only meet at lock-free rings:
+ *
+ *   RX thread --dispatch()--> SPSC ingress ring[w] --> worker w: classify + meter
+ *             --> MPSC egress ring --> egress thread: drain_ring() + dequeue --> transmit
+ *
+ * The egress thread owns the port's scheduler, drains the egress ring all workers
+ * push to into it (SchedulerInterface::drain_ring()) and hands what it dequeues to
+ * the transmit callback. Each worker pushes its bursts in order, so packets of a flow
+ * leave the ring in arrival order.
+ *
+ * Consequences of sharding the policers: policy rates apply per worker (a policy of
+ * 10 Mbit/s lets each worker pass 10 Mbit/s of the flows it owns), and FlowIds are only
+ * unique within a worker. The shaping wheel is not used: delayed (shape_to_cir) packets
+ * exceeding the CIR are policed as without a wheel in PacketPipeline.
+ *
+ * Per-policy counters are kept per worker (see PerCorePolicyStatistics) and folded
+ * across workers by policy_statistics(), so policies metered on every worker cost no
+ * shared writes. With a stats_segment_name configured, the egress thread folds them,
+ * together with the WorkerCounters and the port scheduler's collect_queue_stats(),
+ * into a shared-memory segment every stats_interval_ns, so other processes can scrape
+ * them (monitor::StatsSegmentReader) without touching the workers.
+ *
+ * Memory is placed on the NUMA node of the thread using it by first touch: each worker's
+ * rings, FlowTable and compiled policies are built, and publish_policies() compiles its
+ * snapshots, on a thread pinned to the worker's CPU, and the SchedulerFactory
+ * constructor builds the port scheduler (its queues and descriptor pools) on the
+ * egress CPU. Placement is best effort: unpinned threads allocate where they run, and
+ * the allocator may hand out pages another node touched first.
+ *
+ * With a min_burst_size, burst sizes adapt to the load: an idle worker pops small
+ * bursts, so a lone packet is not held back for a large one, and a loaded worker
+ * grows its bursts to amortise ring and metering costs. The egress thread does the same
+ * with its scheduler dequeues.
+ *
+ * Built with HQTS_ENABLE_PROFILING, every worker binds its WorkerCounters::stage_cycles
+ * and the egress thread egress_stage_cycles() (see bind_stage_counters()), so stage
+ * cycles are counted per core without shared writes.
+ *
+ * Buffers of packets a shaper drops are released on that worker's thread, those the
+ * port scheduler's AQM drops on the egress thread; those of transmitted packets pass to
+ * the transmit callback. Neither thread owns the pool, so the buffers go back through
+ * its return ring (see PacketBufferPool::release()) for the RX thread to reuse.
+ */
+class ShardedRuntime {
+public:
+    using TransmitFunction = std::function<void(const scheduler::PacketDescriptor&)>;
+    using SchedulerFactory = std::function<std::unique_ptr<scheduler::SchedulerInterface>()>;
+
+    /**
+     * @param config Worker count, rings, pinning and flow table sizing.
+     * @param policies Compiled once per worker at construction (see publish_policies()).
+     * @param port_scheduler Scheduler of the egress port, owned by the egress thread.
+     * @param transmit Called on the egress thread for every dequeued packet.
+     * @throws std::invalid_argument if num_workers, burst_size or max_counted_policies is 0,
+     *         min_burst_size exceeds burst_size, worker_cpus has more entries than workers,
+     *         port_scheduler or transmit is empty, or the policy tree's parent links form a cycle.
+     * @throws std::system_error if the stats segment cannot be created.
+     */
+    ShardedRuntime(const ShardedRuntimeConfig& config,
+                   const policy::PolicyTree& policies,
+                   std::unique_ptr<scheduler::SchedulerInterface> port_scheduler,
+                   TransmitFunction transmit);
+
+    /**
+     * @brief As above, but builds the port scheduler by calling `make_scheduler` on a
+     *        thread pinned to config.egress_cpu, so its memory is local to the egress thread.
+     * @throws std::invalid_argument also if make_scheduler is empty or returns null;
+     *         rethrows what make_scheduler throws.
+     */
+    ShardedRuntime(const ShardedRuntimeConfig& config,
+                   const policy::PolicyTree& policies,
+                   const SchedulerFactory& make_scheduler,
+                   TransmitFunction transmit);
+
+    /** @brief Stops the runtime if it is running (see stop()). */
+    ~ShardedRuntime();
+
+    ShardedRuntime(const ShardedRuntime&) = delete;
+    ShardedRuntime& operator=(const ShardedRuntime&) = delete;
+
+    /**
+     * @brief Starts the worker and egress threads.
+     * @throws std::logic_error if the runtime is already running.
+     */
+    void start();
+
+    /**
+     * @brief Processes everything already dispatched, then joins all threads.
+     *
+     * Workers finish their ingress rings, then the egress thread drains the egress ring
+     * and the scheduler. dispatch() must not be called concurrently with stop().
+     */
+    void stop();
+
+    bool is_running() const { return running_; }
+
+    size_t num_workers() const { return workers_.size(); }
+
+    /**
+     * @brief The worker owning the flow of `five_tuple`.
+     *
+     * Uses hash bits the FlowTable does not use for its shard, tag or (below 2^21 slots)
+     * home slot, so the keys one worker sees still spread evenly over its table.
+     */
+    size_t worker_for(const dataplane::FiveTuple& five_tuple) const;
+
+    /**
+     * @brief Hands a packet to the worker owning its flow. Call from one RX thread only.
+     * @return False if that worker's ingress ring is full; the packet is not queued and
+     *         its buffer still belongs to the caller.
+     */
+    bool dispatch(const IncomingPacket& packet);
+
+    /**
+     * @brief dispatch() for `count` packets.
+     * @return The number of packets queued; the others were refused as by dispatch().
+     */
+    size_t dispatch_burst(const IncomingPacket* packets, size_t count);
+
+    /**
+     * @brief Compiles `tree` and publishes it to every worker, which picks it up with its
+     *        next burst or idle poll. Call from the control plane; never stalls a worker.
+     *
+     * Each worker's snapshot is compiled on a thread pinned to that worker's CPU, if it
+     * has one. Buckets of policies whose rates and capacities are unchanged keep their state;
+     * the others restart as in the tree. Each worker's previous snapshot is freed by a
+     * later publish once the worker has moved past it.
+     * @throws std::invalid_argument if the tree's parent links form a cycle; no worker's
+     *         snapshot is replaced in that case.
+     */
+    void publish_policies(const policy::PolicyTree& tree);
+
+    /**
+     * @brief Counters of worker `worker`.
+     * @throws std::out_of_range if `worker` is not below num_workers().
+     */
+    const WorkerCounters& worker_counters(size_t worker) const;
+
+    /**
+     * @brief Per-policy counters of all workers; read() and read_all() fold them on demand.
+     *
+     * Counts what the workers' shapers metered; packets later refused by the scheduler
+     * are not counted as dropped here.
+     */
+    const PerCorePolicyStatistics& policy_statistics() const { return policy_statistics_; }
+
+    /** @brief The stats segment the egress thread publishes to, or nullptr if none is configured. */
+    const monitor::StatsSegmentWriter* stats_segment() const { return stats_writer_.get(); }
+
+    /** @brief Packets refused by dispatch() because an ingress ring was full. */
+    uint64_t packets_refused() const { return packets_refused_.load(std::memory_order_relaxed); }
+
+    /** @brief Packets handed to the transmit callback. */
+    uint64_t packets_transmitted() const { return packets_transmitted_.load(std::memory_order_relaxed); }
+
+#if defined(HQTS_PROFILING)
+    /** @brief Enqueue, AQM and dequeue cycles of the egress thread. */
+    const StageCycleCounters& egress_stage_cycles() const { return egress_stage_cycles_; }
+#endif
+
+private:
+    struct Worker {
+        Worker(const ShardedRuntimeConfig& config, const policy::PolicyTree& policies);
+
+        SpscRing<IncomingPacket> ingress; // RX thread -> worker
+        FlowTable flow_table;
+        dataplane::FlowClassifier classifier;
+        policy::RuntimePolicyTable policies;
+        TrafficShaper shaper;
+        WorkerCounters counters;
+        std::thread thread;
+    };
+
+    int worker_cpu(size_t worker) const; // -1 if unpinned
+    void worker_loop(Worker& worker, int cpu);
+    void egress_loop();
+    void publish_stats(TimestampNs now_ns); // Egress thread only
+
+    ShardedRuntimeConfig config_;
+    PerCorePolicyStatistics policy_statistics_; // Worker i writes as core i
+    std::vector<std::unique_ptr<Worker>> workers_;
+    MpscRing<scheduler::PacketDescriptor> egress_ring_; // Workers -> egress thread
+    std::unique_ptr<scheduler::SchedulerInterface> scheduler_;
+    TransmitFunction transmit_;
+    std::thread egress_thread_;
+    bool running_ = false; // Control-plane state, only touched by start()/stop()
+
+    std::atomic<bool> stop_workers_{false}; // Workers exit once their ingress ring is empty
+    std::atomic<bool> stop_egress_{false};  // Set after the workers have been joined
+    std::atomic<uint64_t> packets_refused_{0};   // Written by the RX thread
+    std::atomic<uint64_t> packets_transmitted_{0}; // Written by the egress thread
+#if defined(HQTS_PROFILING)
+    StageCycleCounters egress_stage_cycles_; // Bound by the egress thread
+#endif
+
+    // Stats export, touched only by the egress thread once running. The record vectors
+    // are kept to reuse their storage across updates.
+    std::unique_ptr<monitor::StatsSegmentWriter> stats_writer_;
+    std::vector<scheduler::QueueStatsSample> queue_samples_;
+    std::vector<monitor::PolicyStatsRecord> policy_records_;
+    std::vector<monitor::QueueStatsRecord> queue_records_;
+    std::vector<monitor::WorkerStatsRecord> worker_records_;
+};
+
+} // namespace core
+} // namespace hqts
+
+#endif // HQTS_CORE_SHARDED_RUNTIME_H_
@@ -0,0 +1,24 @@
+#ifndef HQTS_CORE_SINGLE_WRITER_H_
+#define HQTS_CORE_SINGLE_WRITER_H_
+
+#include <atomic>
+#include <cstdint>
+
+namespace hqts {
+namespace core {
+
+/**
+ * @brief Adds `delta` to a counter that only the calling thread writes.
+ *
+ * A relaxed load and store rather than fetch_add: no locked read-modify-write, so the
+ * update costs what a plain `+=` does, while readers on other threads still see whole
+ * values. Concurrent writers would lose updates; give each its own counter.
+ */
+inline void single_writer_add(std::atomic<uint64_t>& counter, uint64_t delta) {
+    counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+} // namespace core
+} // namespace hqts
+
+#endif // HQTS_CORE_SINGLE_WRITER_H_
@@ -0,0 +1,129 @@
+#ifndef HQTS_CORE_SPSC_RING_H_
+#define HQTS_CORE_SPSC_RING_H_
+
+#include <atomic>
+#include <cstddef> // For size_t
+#include <memory>  // For std::unique_ptr
+#include <stdexcept> // For std::invalid_argument
+
+namespace hqts {
+namespace core {
+
+/**
+ * @brief Bounded lock-free ring between exactly one producer and one consumer thread.
+ *
+ * The capacity is rounded up to a power of two. Producer and consumer indexes live on
+ * separate cache lines, and each side keeps a cached copy of the other's index, so
+ * the shared lines are only touched when the cached view says the ring is full
+ * (producer) or empty (consumer). T is copied in and out; it must be default
+ * constructible and copy assignable (descriptors and handles, not owning objects).
+ * See MpscRing for several producers.
+ */
+template <typename T>
+class SpscRing {
+public:
+    /**
+     * @param capacity Minimum number of elements the ring holds.
+     * @throws std::invalid_argument if capacity is 0 or larger than SIZE_MAX / 2.
+     */
+    explicit SpscRing(size_t capacity) : mask_(round_up_to_power_of_two(capacity) - 1),
+                                         slots_(new T[mask_ + 1]) {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    size_t capacity() const { return mask_ + 1; }
+
+    /** @brief Number of queued elements; exact only when neither side is active. */
+    size_t size() const {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+    bool empty() const { return size() == 0; }
+
+    // --- Producer side ---
+
+    /** @brief Appends `item`; returns false if the ring is full. */
+    bool try_push(const T& item) {
+        return push_burst(&item, 1) == 1;
+    }
+
+    /**
+     * @brief Appends up to `count` elements from `items`, in order.
+     * @return The number of elements appended: all of them unless the ring filled up.
+     */
+    size_t push_burst(const T* items, size_t count) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t free_slots = capacity() - (tail - producer_cached_head_);
+        if (free_slots < count) {
+            producer_cached_head_ = head_.load(std::memory_order_acquire);
+            free_slots = capacity() - (tail - producer_cached_head_);
+        }
+        const size_t pushed = free_slots < count ? free_slots : count;
+        for (size_t i = 0; i < pushed; ++i) {
+            slots_[(tail + i) & mask_] = items[i];
+        }
+        if (pushed != 0) {
+            tail_.store(tail + pushed, std::memory_order_release); // Publishes the whole burst
+        }
+        return pushed;
+    }
+
+    // --- Consumer side ---
+
+    /** @brief Removes the oldest element into `out`; returns false if the ring is empty. */
+    bool try_pop(T& out) {
+        return pop_burst(&out, 1) == 1;
+    }
+
+    /**
+     * @brief Removes up to `max_items` elements, oldest first, into `out`.
+     * @return The number of elements removed.
+     */
+    size_t pop_burst(T* out, size_t max_items) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        size_t available = consumer_cached_tail_ - head;
+        if (available < max_items) {
+            consumer_cached_tail_ = tail_.load(std::memory_order_acquire);
+            available = consumer_cached_tail_ - head;
+        }
+        const size_t count = available < max_items ? available : max_items;
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = slots_[(head + i) & mask_];
+        }
+        if (count != 0) {
+            head_.store(head + count, std::memory_order_release); // Frees the slots for the producer
+        }
+        return count;
+    }
+
+private:
+    static size_t round_up_to_power_of_two(size_t capacity) {
+        if (capacity == 0 || capacity > (static_cast<size_t>(-1) >> 1)) {
+            throw std::invalid_argument("SpscRing: capacity must be between 1 and SIZE_MAX / 2.");
+        }
+        size_t rounded = 1;
+        while (rounded < capacity) {
+            rounded <<= 1;
+        }
+        return rounded;
+    }
+
+    const size_t mask_;
+    const std::unique_ptr<T[]> slots_;
+
+    // Consumer line: its index and its view of the producer's.
+    alignas(64) std::atomic<size_t> head_{0};
+    size_t consumer_cached_tail_ = 0;
+
+    // Producer line: its index and its view of the consumer's.
+    alignas(64) std::atomic<size_t> tail_{0};
+    size_t producer_cached_head_ = 0;
+
+    // Keep whatever follows the ring off the producer's line.
+    alignas(64) char end_padding_[1] = {};
+};
+
+} // namespace core
+} // namespace hqts
+
+#endif // HQTS_CORE_SPSC_RING_H_
@@ -0,0 +1,180 @@
+#ifndef HQTS_CORE_STAGE_PROFILER_H_
+#define HQTS_CORE_STAGE_PROFILER_H_
+
+#include "hqts/core/single_writer.h" // For single_writer_add
+#include "hqts/core/time_source.h"   // For steady_now_ns
+
+#include <array>
+#include <atomic>
+#include <cstddef> // For size_t
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h> // For __rdtsc
+#endif
+
+#if defined(HQTS_PROFILING) && defined(HQTS_HAVE_SDT)
+#include <sys/sdt.h> // For DTRACE_PROBE2
+#endif
+
+namespace hqts {
+namespace core {
+
+/**
+ * @brief Data-path stages whose cycles the HQTS_ENABLE_PROFILING build counts.
+ */
+enum class ProfileStage : uint8_t {
+    CLASSIFY = 0, // FlowClassifier lookups in TrafficShaper
+    METER,        // Policy resolution and token buckets in TrafficShaper
+    AQM,          // RED admission and CoDel's dequeue-time drop decisions
+    ENQUEUE,      // Handing packets to the scheduler (includes AQM)
+    DEQUEUE,      // Taking packets from the scheduler
+    COUNT
+};
+
+constexpr size_t PROFILE_STAGE_COUNT = static_cast<size_t>(ProfileStage::COUNT);
+
+/** @brief Name of a stage, e.g. for benchmark counters. */
+inline const char* profile_stage_name(ProfileStage stage) {
+    switch (stage) {
+        case ProfileStage::CLASSIFY: return "classify";
+        case ProfileStage::METER: return "meter";
+        case ProfileStage::AQM: return "aqm";
+        case ProfileStage::ENQUEUE: return "enqueue";
+        case ProfileStage::DEQUEUE: return "dequeue";
+        case ProfileStage::COUNT: break;
+    }
+    return "unknown";
+}
+
+/**
+ * @brief Cycle counter of the CPU: the TSC on x86, the steady clock in nanoseconds
+ *        elsewhere. Not serializing, so it costs a few cycles and times whole stages,
+ *        not single instructions.
+ */
+inline uint64_t read_cycle_counter() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return steady_now_ns();
+#endif
+}
+
+/**
+ * @brief Per-stage totals of one thread: timed sections, packets and cycles.
+ *
+ * Written only by the thread the block is bound to (bind_stage_counters()), with
+ * relaxed single-writer updates, so another thread may read it at any time.
+ */
+struct StageCycleCounters {
+    std::array<std::atomic<uint64_t>, PROFILE_STAGE_COUNT> sections{};
+    std::array<std::atomic<uint64_t>, PROFILE_STAGE_COUNT> packets{};
+    std::array<std::atomic<uint64_t>, PROFILE_STAGE_COUNT> cycles{};
+
+    /** @brief Cycles per packet of `stage`, 0 if it processed none. */
+    double cycles_per_packet(ProfileStage stage) const {
+        const size_t i = static_cast<size_t>(stage);
+        uint64_t count = packets[i].load(std::memory_order_relaxed);
+        return count == 0 ? 0.0
+                          : static_cast<double>(cycles[i].load(std::memory_order_relaxed)) /
+                                static_cast<double>(count);
+    }
+
+    /** @brief Zeroes every counter; only from the thread the block is bound to. */
+    void reset() {
+        for (size_t i = 0; i < PROFILE_STAGE_COUNT; ++i) {
+            sections[i].store(0, std::memory_order_relaxed);
+            packets[i].store(0, std::memory_order_relaxed);
+            cycles[i].store(0, std::memory_order_relaxed);
+        }
+    }
+};
+
+namespace detail {
+inline StageCycleCounters*& bound_stage_counters() {
+    thread_local StageCycleCounters* counters = nullptr;
+    return counters;
+}
+} // namespace detail
+
+/**
+ * @brief Directs the calling thread's stage timings to `counters` (nullptr: discard them).
+ * @return The block bound before, to restore when done.
+ */
+inline StageCycleCounters* bind_stage_counters(StageCycleCounters* counters) {
+    StageCycleCounters* previous = detail::bound_stage_counters();
+    detail::bound_stage_counters() = counters;
+    return previous;
+}
+
+/** @brief The calling thread's bound block, or nullptr. */
+inline StageCycleCounters* bound_stage_counters() {
+    return detail::bound_stage_counters();
+}
+
+/**
+ * @brief Times its scope as one section of `stage` covering `packets` packets, adding
+ *        to the calling thread's bound StageCycleCounters; costs one thread-local load
+ *        when none is bound. With HQTS_HAVE_SDT it also fires the USDT probe
+ *        hqts:stage(stage, cycles) for perf or bpftrace.
+ *
+ * Use it through HQTS_PROFILE_STAGE or HQTS_PROFILE_STAGE_RESULT, which compile out
+ * without HQTS_PROFILING.
+ */
+class StageTimer {
+public:
+    explicit StageTimer(ProfileStage stage, size_t packets = 1)
+        : counters_(bound_stage_counters()), stage_(stage), packets_(packets),
+          start_(counters_ != nullptr ? read_cycle_counter() : 0) {}
+
+    /** @brief Counts `*packets` as read when the scope ends, e.g. a dequeue's result. */
+    StageTimer(ProfileStage stage, const size_t* packets)
+        : counters_(bound_stage_counters()), stage_(stage), packets_(0), packets_result_(packets),
+          start_(counters_ != nullptr ? read_cycle_counter() : 0) {}
+
+    ~StageTimer() {
+        if (counters_ == nullptr) {
+            return;
+        }
+        const uint64_t elapsed = read_cycle_counter() - start_;
+        const size_t i = static_cast<size_t>(stage_);
+        single_writer_add(counters_->sections[i], 1);
+        single_writer_add(counters_->packets[i], packets_result_ != nullptr ? *packets_result_ : packets_);
+        single_writer_add(counters_->cycles[i], elapsed);
+#if defined(HQTS_PROFILING) && defined(HQTS_HAVE_SDT)
+        DTRACE_PROBE2(hqts, stage, static_cast<unsigned>(stage_), elapsed);
+#endif
+    }
+
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+
+private:
+    StageCycleCounters* counters_;
+    ProfileStage stage_;
+    size_t packets_;
+    const size_t* packets_result_ = nullptr;
+    uint64_t start_;
+};
+
+} // namespace core
+} // namespace hqts
+
+// HQTS_PROFILE_STAGE(stage[, packets]) times the rest of the enclosing scope as `packets`
+// packets (default 1); HQTS_PROFILE_STAGE_RESULT(stage, count) counts the value of the
+// size_t `count` when the scope ends. HQTS_PROFILING is defined by the
+// HQTS_ENABLE_PROFILING CMake option; without it both expand to nothing, so a default
+// build has no timing code on the data path.
+#if defined(HQTS_PROFILING)
+#define HQTS_PROFILE_CONCAT_INNER(a, b) a##b
+#define HQTS_PROFILE_CONCAT(a, b) HQTS_PROFILE_CONCAT_INNER(a, b)
+#define HQTS_PROFILE_STAGE(...) \
+    ::hqts::core::StageTimer HQTS_PROFILE_CONCAT(hqts_stage_timer_, __LINE__)(__VA_ARGS__)
+#define HQTS_PROFILE_STAGE_RESULT(stage, count) \
+    ::hqts::core::StageTimer HQTS_PROFILE_CONCAT(hqts_stage_timer_, __LINE__)(stage, &(count))
+#else
+#define HQTS_PROFILE_STAGE(...) static_cast<void>(0)
+#define HQTS_PROFILE_STAGE_RESULT(stage, count) static_cast<void>(0)
+#endif
+
+#endif // HQTS_CORE_STAGE_PROFILER_H_
@@ -0,0 +1,33 @@
+#ifndef HQTS_CORE_TIME_SOURCE_H_
+#define HQTS_CORE_TIME_SOURCE_H_
+
+#include <chrono>
+#include <cstdint>
+
+namespace hqts {
+namespace core {
+
+/**
+ * @brief Point in time in nanoseconds, as used by the data path.
+ *
+ * Timestamps are taken once per packet or per burst by the caller and passed down
+ * (PacketPipeline -> TrafficShaper -> TokenBucket), instead of every component reading
+ * the clock itself. Any monotonic source works as long as one pipeline uses a single
+ * source consistently: the steady clock (steady_now_ns()), a TSC-derived clock, NIC
+ * hardware timestamps, or virtual time in tests and trace replay.
+ */
+using TimestampNs = uint64_t;
+
+/**
+ * @brief Current std::chrono::steady_clock time in nanoseconds since its epoch.
+ * Used by the convenience overloads that do not take a timestamp.
+ */
+inline TimestampNs steady_now_ns() {
+    return static_cast<TimestampNs>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+} // namespace core
+} // namespace hqts
+
+#endif // HQTS_CORE_TIME_SOURCE_H_
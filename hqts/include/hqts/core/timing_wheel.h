@@ -0,0 +1,126 @@
+#ifndef HQTS_CORE_TIMING_WHEEL_H_
+#define HQTS_CORE_TIMING_WHEEL_H_
+
+#include "hqts/core/time_source.h"            // For TimestampNs
+#include "hqts/scheduler/packet_descriptor.h" // For scheduler::PacketDescriptor
+
+#include <array>
+#include <cstddef> // For size_t
+#include <cstdint>
+#include <vector>
+
+namespace hqts {
+namespace core {
+
+/**
+ * @brief Hierarchical timing wheel holding packets until their release time.
+ *
+ * Time is divided into ticks of tick_ns. Four levels of 256 slots each cover 2^32 ticks
+ * ahead of the wheel's current tick; a packet goes into the level of the highest tick
+ * digit (base 256) in which its release tick differs from the current one, and a
+ * packet further out waits in an overflow list. As time advances, a slot is cascaded
+ * into the lower levels when the current tick enters it, so every packet is moved at
+ * most once per level: schedule() and the release of a packet are O(1), independent of
+ * how many packets are waiting. Per-level occupancy bitmaps let advance() jump straight
+ * to the next occupied slot, so idle stretches cost nothing.
+ *
+ * Packets due in the same tick are released in the order they were scheduled. Storage
+ * is a fixed node arena sized at construction; schedule() never allocates.
+ *
+ * Not thread-safe: a wheel belongs to the egress path of one pipeline.
+ */
+class TimingWheel {
+public:
+    static constexpr unsigned LEVELS = 4;
+    static constexpr unsigned SLOT_BITS = 8;
+    static constexpr size_t SLOTS = size_t{1} << SLOT_BITS;
+    static constexpr TimestampNs DEFAULT_TICK_NS = 1000;
+
+    /**
+     * @param capacity Maximum number of packets held (scheduled plus ready).
+     * @param tick_ns Release-time granularity in nanoseconds.
+     * @param start_ns Time the wheel starts at (the clock later passed to advance()).
+     * @throws std::invalid_argument if capacity or tick_ns is 0, or capacity does not fit
+     *         the 32-bit node index.
+     */
+    explicit TimingWheel(size_t capacity, TimestampNs tick_ns = DEFAULT_TICK_NS, TimestampNs start_ns = 0);
+
+    TimingWheel(const TimingWheel&) = delete;
+    TimingWheel& operator=(const TimingWheel&) = delete;
+
+    /**
+     * @brief Holds `packet` until release_ns. A release time that has already passed
+     *        makes the packet ready at once.
+     * @return False if the wheel is full (the packet is not stored).
+     */
+    bool schedule(const scheduler::PacketDescriptor& packet, TimestampNs release_ns);
+
+    /**
+     * @brief Advances the wheel to now_ns, moving every packet due by then to the ready list.
+     *        A time earlier than the current one is ignored.
+     * @return Number of ready packets.
+     */
+    size_t advance(TimestampNs now_ns);
+
+    bool has_ready() const { return ready_.head != NIL; }
+    size_t ready_count() const { return ready_count_; }
+
+    /**
+     * @brief Removes and returns the oldest ready packet. Precondition: has_ready().
+     */
+    scheduler::PacketDescriptor pop_ready();
+
+    /**
+     * @brief Earliest time at which advance() may make another packet ready: now if one
+     *        is ready already, UINT64_MAX if the wheel is empty. No packet becomes due
+     *        earlier, so an egress loop can sleep until then.
+     */
+    TimestampNs next_event_ns() const;
+
+    size_t size() const { return size_; }
+    size_t capacity() const { return nodes_.size(); }
+    bool empty() const { return size_ == 0; }
+    TimestampNs tick_ns() const { return tick_ns_; }
+
+private:
+    static constexpr uint32_t NIL = UINT32_MAX;
+    static constexpr uint64_t NO_TICK = UINT64_MAX;
+    static constexpr size_t BITMAP_WORDS = SLOTS / 64;
+
+    struct Node {
+        scheduler::PacketDescriptor packet;
+        uint64_t tick = 0;
+        uint32_t next = NIL;
+    };
+
+    struct List {
+        uint32_t head = NIL;
+        uint32_t tail = NIL;
+    };
+
+    void append(List& list, uint32_t index);
+    void place(uint32_t index);
+    void reinsert(List list);
+    uint64_t next_event_tick() const;
+    void process_event(uint64_t event_tick);
+
+    static unsigned digit(uint64_t tick, unsigned level) {
+        return static_cast<unsigned>((tick >> (level * SLOT_BITS)) & (SLOTS - 1));
+    }
+
+    std::vector<Node> nodes_;
+    uint32_t free_head_ = NIL;
+    std::array<std::array<List, SLOTS>, LEVELS> slots_;
+    std::array<std::array<uint64_t, BITMAP_WORDS>, LEVELS> occupied_{};
+    List overflow_;
+    List ready_;
+    size_t size_ = 0;
+    size_t ready_count_ = 0;
+    TimestampNs tick_ns_;
+    uint64_t current_tick_; // Every packet due at or before this tick is ready
+};
+
+} // namespace core
+} // namespace hqts
+
+#endif // HQTS_CORE_TIMING_WHEEL_H_
@@ -1,30 +1,110 @@
 #ifndef HQTS_CORE_TOKEN_BUCKET_H_
 #define HQTS_CORE_TOKEN_BUCKET_H_
 
+#include "hqts/core/time_source.h" // For TimestampNs
+
 #include <cstdint>
-#include <chrono>
 
 namespace hqts {
 namespace core {
 
+/**
+ * @brief Token bucket metering bytes at a fixed rate up to a burst capacity.
+ *
+ * Every operation refills the bucket for the time elapsed since the previous refill.
+ * The overloads taking a TimestampNs use the caller's time, so a caller that handles a
+ * burst of packets reads the clock once and passes the same timestamp to every bucket;
+ * the overloads without one read steady_now_ns() themselves. A timestamp older than
+ * the last refill adds no tokens (time never runs backwards for a bucket), and the
+ * first refill of a bucket built without a timestamp only establishes its time base,
+ * so buckets created on the steady clock can be driven by virtual time.
+ *
+ * Credit is kept in fixed point, in units of 1/8e9 byte (CREDIT_PER_BYTE per byte), so
+ * one nanosecond at rate_bps adds exactly rate_bps units: the per-nanosecond increment
+ * is the rate itself, a refill is one multiply, and fractions of a byte carry over to
+ * the next refill instead of being rounded away. The elapsed time is clamped to the
+ * time it takes to fill the bucket from empty, which keeps the multiply from
+ * overflowing after long idle periods at high rates.
+ */
 class TokenBucket {
 public:
+    /// Credit units per byte: 8 bits x 1e9 nanoseconds per second.
+    static constexpr uint64_t CREDIT_PER_BYTE = 8ULL * 1000000000ULL;
+    /// Largest supported burst capacity (about 576 MB); larger capacities are clamped.
+    static constexpr uint64_t MAX_CAPACITY_BYTES = UINT64_MAX / 4 / CREDIT_PER_BYTE;
+    /// Returned by reserve() when the tokens cannot be granted within the allowed delay.
+    static constexpr TimestampNs NEVER = UINT64_MAX;
+
+    /**
+     * @brief Constructs a full bucket whose time base is set by its first refill.
+     * @param rate_bps Refill rate in bits per second.
+     * @param capacity_bytes Burst capacity in bytes.
+     */
     TokenBucket(uint64_t rate_bps, uint64_t capacity_bytes);
 
+    /**
+     * @brief Constructs a full bucket with an explicit time base.
+     * @param now_ns Creation time on the clock later passed to the timestamped overloads.
+     */
+    TokenBucket(uint64_t rate_bps, uint64_t capacity_bytes, TimestampNs now_ns);
+
     bool consume(uint64_t tokens_to_consume);
+    bool consume(uint64_t tokens_to_consume, TimestampNs now_ns);
+
+    /**
+     * @brief Books `tokens` for the earliest time they are available, for shaping.
+     *
+     * Tokens available now are consumed as by consume(). Otherwise the bucket is charged
+     * ahead: its refill time moves to the moment the missing tokens will have accrued,
+     * and that moment is returned. Later reservations queue behind it, so a shaper that
+     * releases each packet at its returned time sends at exactly rate_bps.
+     *
+     * @param max_delay_ns Longest acceptable wait after now_ns.
+     * @return Time at which the tokens are granted (now_ns or later), or NEVER, without
+     *         charging the bucket, if that would exceed max_delay_ns, the tokens exceed
+     *         the capacity, or the rate is 0.
+     */
+    TimestampNs reserve(uint64_t tokens, TimestampNs now_ns, TimestampNs max_delay_ns);
+
+    /**
+     * @brief The time reserve() would grant `tokens` at, without charging the bucket:
+     *        for checking several buckets before booking any of them.
+     * @return As reserve() with an unlimited delay.
+     */
+    TimestampNs grant_time(uint64_t tokens, TimestampNs now_ns) const;
+
+    /**
+     * @brief Removes `tokens`, or all there are if fewer: usage that has already been
+     *        admitted elsewhere and must be accounted for here regardless.
+     */
+    void drain(uint64_t tokens, TimestampNs now_ns);
+
     uint64_t available_tokens() const;
+    uint64_t available_tokens(TimestampNs now_ns) const;
+
     bool is_conforming(uint64_t packet_size_bytes) const;
+    bool is_conforming(uint64_t packet_size_bytes, TimestampNs now_ns) const;
+
+    uint64_t rate_bps() const { return rate_bps_; }
+    uint64_t capacity_bytes() const { return capacity_bytes_; }
 
     void set_rate(uint64_t rate_bps);
+    void set_rate(uint64_t rate_bps, TimestampNs now_ns);
+
     void set_capacity(uint64_t capacity_bytes);
+    void set_capacity(uint64_t capacity_bytes, TimestampNs now_ns);
 
 private:
-    void refill() const;
+    void refill(TimestampNs now_ns) const;
+    void update_derived_limits();
 
     uint64_t capacity_bytes_;
-    mutable uint64_t tokens_bytes_;
+    uint64_t capacity_credit_; // capacity_bytes_ * CREDIT_PER_BYTE
+    mutable uint64_t credit_;  // Available tokens in 1/CREDIT_PER_BYTE byte units
     uint64_t rate_bps_;
-    mutable std::chrono::steady_clock::time_point last_refill_time_;
+    uint64_t fill_time_ns_;    // Elapsed time beyond which a refill fills the bucket
+    mutable TimestampNs last_refill_time_ns_;
+    mutable bool has_refill_time_;
 };
 
 } // namespace core
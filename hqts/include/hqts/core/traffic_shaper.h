@@ -3,14 +3,19 @@
 
 // #include "hqts/core/flow_context.h"        // No longer needed here directly
 #include "hqts/core/shaping_policy.h"      // Includes TokenBucket
+#include "hqts/core/per_core_statistics.h" // For PerCorePolicyStatistics
 #include "hqts/policy/policy_tree.h"       // For PolicyTree
+#include "hqts/policy/runtime_policy_table.h" // For RuntimePolicyTable, CompiledPolicies
 #include "hqts/scheduler/packet_descriptor.h"// For PacketDescriptor
 #include "hqts/dataplane/flow_classifier.h"// For FlowClassifier
 #include "hqts/dataplane/flow_identifier.h"// For FiveTuple
 #include "hqts/dataplane/flow_table.h"     // For core::FlowTable definition
+#include "hqts/core/time_source.h"         // For TimestampNs
 
 #include <memory>
 #include <map>    // For potential scheduler_map_ if used later
+#include <vector> // For per-burst scratch storage
+#include <cstddef> // For size_t
 
 // No forward declaration for core::FlowTable needed as it's now included.
 
@@ -20,20 +25,46 @@ namespace core {
 class TrafficShaper {
 public:
     /**
-     * @brief Constructor for TrafficShaper.
-     * @param policy_tree A non-const reference to the policy tree for policy lookups.
+     * @brief Constructs a TrafficShaper that compiles `policy_tree` for itself.
+     *
+     * The shaper meters against its own compiled snapshot of the tree (see
+     * RuntimePolicyTable), recompiled when a flow's policy is missing from it but present
+     * in the tree, or when invalidate_policy_cache() is called. The tree's
+     * own buckets are only the initial state of the compiled ones.
+     *
+     * @param policy_tree The policy tree to compile; must outlive the shaper.
      * @param flow_classifier A reference to the flow classifier for FlowId retrieval/creation.
-     * @param flow_table A reference to the flow table for accessing FlowContext.
+     * @param flow_table A reference to the flow table holding the FlowContexts the classifier returns.
+     * @throws std::invalid_argument if the tree's parent links form a cycle.
      */
     explicit TrafficShaper(policy::PolicyTree& policy_tree,
                            dataplane::FlowClassifier& flow_classifier,
                            core::FlowTable& flow_table);
 
-    // TrafficShaper is stateful (via references) and unique in its role.
+    /**
+     * @brief Constructs a TrafficShaper metering against snapshots published to
+     *        `runtime_policies` by the control plane.
+     *
+     * A newly published snapshot is picked up by the next packet or burst processed, or
+     * by refresh_policies(); the shaper never blocks on publishing. The shaper registers
+     * as a reader of `runtime_policies` (see RuntimePolicyTable::register_reader()) for
+     * its lifetime. Each table must be metered by one shaper.
+     *
+     * @throws std::length_error if the table has no free reader slot.
+     */
+    explicit TrafficShaper(policy::RuntimePolicyTable& runtime_policies,
+                           dataplane::FlowClassifier& flow_classifier,
+                           core::FlowTable& flow_table);
+
+    /** @brief Unregisters from the RuntimePolicyTable. */
+    ~TrafficShaper();
+
+    // TrafficShaper is stateful (via references) and unique in its role; as a
+    // registered reader of its RuntimePolicyTable it is not movable either.
     TrafficShaper(const TrafficShaper&) = delete;
     TrafficShaper& operator=(const TrafficShaper&) = delete;
-    TrafficShaper(TrafficShaper&&) = default;
-    TrafficShaper& operator=(TrafficShaper&&) = default;
+    TrafficShaper(TrafficShaper&&) = delete;
+    TrafficShaper& operator=(TrafficShaper&&) = delete;
 
     /**
      * @brief Processes a packet against its flow's shaping policy.
@@ -47,18 +78,148 @@ public:
      * by the shaper based on policy rules like 'drop_on_red'). False means the shaper
      * determined the packet should be dropped.
      *
-     * @param packet The packet descriptor to process. Modified by reference (flow_id, conformance, priority).
+     * @param packet The packet descriptor to process. Modified by reference (flow_id, policy_id, conformance, priority).
      * @param five_tuple The 5-tuple used to classify the packet and find/create its flow context.
      * @return True if the packet is to be enqueued, false if it should be dropped.
      * @throws std::runtime_error if policy or flow context issues occur.
      */
     bool process_packet(scheduler::PacketDescriptor& packet, const dataplane::FiveTuple& five_tuple);
 
+    /**
+     * @brief As process_packet(), metering against the caller's timestamp.
+     *
+     * The same timestamp refills the CIR and PIR buckets and is recorded as the flow's
+     * last-seen time, so the shaper itself never reads the clock.
+     *
+     * @param now_ns Arrival time of the packet in nanoseconds (see TimestampNs).
+     */
+    bool process_packet(scheduler::PacketDescriptor& packet, const dataplane::FiveTuple& five_tuple,
+                        TimestampNs now_ns);
+
+    /**
+     * @brief As process_packet() with a timestamp, for a caller able to delay packets.
+     *
+     * For a policy with shape_to_cir set, a packet exceeding the CIR is not marked down
+     * but booked against the CIR bucket for the time its tokens accrue (see
+     * TokenBucket::reserve()), and against the PIR of every capped ancestor (see
+     * reserve_hierarchical()); that time is stored in *release_ns and the packet is
+     * GREEN. A packet that would wait longer than the policy's max_shaping_delay_ns is
+     * RED. Packets of other policies, and shaped packets sent at once, get
+     * *release_ns = now_ns.
+     *
+     * @param release_ns Receives the time the packet may be sent if it is to be enqueued.
+     *                   With nullptr, a packet that would have to wait is RED instead.
+     */
+    bool process_packet(scheduler::PacketDescriptor& packet, const dataplane::FiveTuple& five_tuple,
+                        TimestampNs now_ns, TimestampNs* release_ns);
+
+    /**
+     * @brief Processes a burst of packets against their flows' shaping policies.
+     *
+     * Produces the same per-packet results as calling process_packet() for each packet
+     * in order, but classifies the whole burst in one pass before metering it.
+     *
+     * Packets that should be enqueued are compacted, in their original relative order,
+     * into the front of the `packets` array; dropped packets end up, in unspecified
+     * order, in packets[return value .. count) so the caller can release their buffers.
+     *
+     * @param packets Pointer to the first of `count` packet descriptors. Modified in place.
+     * @param five_tuples Pointer to `count` 5-tuples; five_tuples[i] classifies packets[i].
+     * @param count Number of packets in the burst.
+     * @return The number of packets to enqueue, i.e. packets[0 .. return value).
+     * @throws std::runtime_error if policy or flow context issues occur.
+     */
+    size_t process_burst(scheduler::PacketDescriptor* packets,
+                         const dataplane::FiveTuple* five_tuples,
+                         size_t count);
+
+    /**
+     * @brief As process_burst(), with one caller-supplied timestamp for the whole burst.
+     * @param now_ns Arrival time of the burst in nanoseconds (see TimestampNs).
+     */
+    size_t process_burst(scheduler::PacketDescriptor* packets,
+                         const dataplane::FiveTuple* five_tuples,
+                         size_t count,
+                         TimestampNs now_ns);
+
+    /**
+     * @brief As process_burst() with a timestamp, also reporting release times.
+     * @param release_ns Array of `count` entries; release_ns[i] receives the release
+     *                   time (see the process_packet() overload taking one) of the
+     *                   packet compacted into packets[i], for i < return value.
+     */
+    size_t process_burst(scheduler::PacketDescriptor* packets,
+                         const dataplane::FiveTuple* five_tuples,
+                         size_t count,
+                         TimestampNs now_ns,
+                         TimestampNs* release_ns);
+
+    /**
+     * @brief Recompiles the policy tree the shaper was constructed with and drops every
+     *        flow's cached policy handle.
+     *
+     * Flows cache a pointer to their policy's compiled record, re-resolved when the
+     * flow's policy_id changes. Policies inserted into the tree are found without this
+     * call; call it after erasing, replacing or re-configuring a policy. Buckets keep
+     * their state if the policy's rates and capacities are unchanged, and otherwise
+     * start again from their state in the tree. No effect on a shaper constructed from a
+     * RuntimePolicyTable, whose publish() serves the same purpose.
+     *
+     * @throws std::invalid_argument if the tree's parent links form a cycle.
+     */
+    void invalidate_policy_cache();
+
+    /**
+     * @brief Moves to the latest published snapshot if there is one, and passes a
+     *        quiescent point for the RuntimePolicyTable.
+     *
+     * Processing a packet or burst does this too; a thread that may go without traffic
+     * for a while calls it when idle, so that snapshots it no longer uses can be freed.
+     * Costs one atomic load when nothing was published.
+     */
+    void refresh_policies() { current_policies(); }
+
+    /**
+     * @brief Counts every packet the shaper meters in `statistics`, as core `core`.
+     *
+     * Each metered packet is recorded against its policy with its conformance and
+     * whether the shaper dropped it; packets dropped before metering (no flow context,
+     * unknown policy) are not. Policies get their slots in `statistics` when the shaper
+     * picks up a snapshot, so the per-packet cost is a few unlocked stores to a cache
+     * line only this shaper writes.
+     *
+     * @param statistics Must outlive the shaper; nullptr stops counting.
+     * @param core Index the shaper writes as; no other writer of `statistics` may use it.
+     * @throws std::out_of_range if `core` is not below statistics->num_cores().
+     */
+    void attach_statistics(PerCorePolicyStatistics* statistics, size_t core);
+
 private:
-    policy::PolicyTree& policy_tree_;
+    policy::PolicyTree* policy_tree_; // The tree compiled into owned_policies_, or null
+    std::unique_ptr<policy::RuntimePolicyTable> owned_policies_;
+    policy::RuntimePolicyTable* runtime_policies_;
+    size_t policy_reader_;                                // Reader slot in *runtime_policies_
+    policy::CompiledPolicies* policies_ = nullptr;        // Snapshot being metered against
     dataplane::FlowClassifier& flow_classifier_;
     core::FlowTable& flow_table_;
 
+    // Scratch storage reused across bursts to keep process_burst allocation-free
+    // once it has seen its largest burst.
+    std::vector<core::FlowContext*> burst_contexts_;
+
+    PerCorePolicyStatistics* statistics_ = nullptr; // Optional, see attach_statistics()
+    size_t statistics_core_ = 0;
+
+    // The flow's cached record if it belongs to the current snapshot (safe to read),
+    // else null: burst prefetches only follow handles that need no resolving.
+    const policy::RuntimePolicy* cached_policy(const core::FlowContext* flow_context) const {
+        if (flow_context == nullptr || policies_ == nullptr ||
+            flow_context->policy_generation != policies_->version()) {
+            return nullptr;
+        }
+        return flow_context->policy;
+    }
+
     // Example for future scheduler interaction (not used in this subtask):
     // scheduler::SchedulerInterface* target_scheduler_;
     // std::map<core::QueueId, scheduler::SchedulerInterface*> scheduler_map_;
@@ -66,16 +227,79 @@ private:
     /**
      * @brief Applies token buckets from the given policy to the packet.
      *
-     * Modifies the state of the token buckets within the policy.
+     * Modifies the state of the token buckets within the policy and, for a policy with
+     * a parent, within its ancestors (see apply_hierarchical_token_buckets()).
      *
      * @param packet The packet descriptor (its length is used).
-     * @param policy The ShapingPolicy to apply (non-const, its token buckets will be modified).
+     * @param policy The policy record to apply (non-const, its token buckets will be modified).
+     * @param now_ns Time the buckets are refilled to.
      * @return The determined ConformanceLevel for the packet.
      */
     scheduler::ConformanceLevel apply_token_buckets(
         const scheduler::PacketDescriptor& packet, // Packet itself is not changed here, only its length used
-        ShapingPolicy& policy                     // Policy's token buckets are modified
+        policy::RuntimePolicy& policy,            // Policy's token buckets are modified
+        TimestampNs now_ns
     );
+
+    /**
+     * @brief apply_token_buckets() for a policy with ancestors.
+     *
+     * Walks the precompiled parent chain twice (check, then charge), so the cost is
+     * proportional to the depth of the tree. A packet is GREEN within the leaf's CIR
+     * or, borrowing, within the spare CIR of its nearest ancestor that has some (and
+     * within the leaf's PIR if it has a peak rate); otherwise YELLOW within the leaf's PIR. It is RED beyond that, or if an ancestor
+     * with a peak rate has reached it: an aggregate's PIR caps the sum of its children.
+     */
+    scheduler::ConformanceLevel apply_hierarchical_token_buckets(
+        const scheduler::PacketDescriptor& packet,
+        policy::RuntimePolicy& leaf,
+        TimestampNs now_ns);
+
+    /**
+     * @brief TokenBucket::reserve() on the CIR of a shaped policy with ancestors.
+     *
+     * The packet is released once the leaf's CIR and the PIR of every ancestor with a
+     * peak rate have its tokens, so shaped children together stay within an aggregate's
+     * cap; each of those buckets is booked, and every ancestor's CIR drained, as for
+     * unshaped children. Nothing is charged if the release would come later than
+     * max_delay_ns after now_ns.
+     * @return The release time, or TokenBucket::NEVER.
+     */
+    TimestampNs reserve_hierarchical(uint64_t length, policy::RuntimePolicy& leaf, TimestampNs now_ns,
+                                     TimestampNs max_delay_ns);
+
+    /**
+     * @brief The latest published snapshot: one atomic load unless it changed.
+     */
+    policy::CompiledPolicies& current_policies();
+
+    /**
+     * @brief Sets the stats_slot of the records of the snapshot being metered (policies_).
+     * @param missing_only Only records without a slot, e.g. policies added by an update.
+     */
+    void assign_statistics_slots(bool missing_only);
+
+    /**
+     * @brief The policy of `flow_context`, from its cached handle or, if that is stale,
+     *        a snapshot lookup that refreshes the handle.
+     * @return The policy, or nullptr if the flow's policy_id is not compiled.
+     */
+    policy::RuntimePolicy* resolve_policy(const core::FlowContext& flow_context);
+
+    /**
+     * @brief Meters a single packet against an already-resolved policy.
+     *
+     * Sets the packet's policy_id and conformance and, unless the packet is to be dropped, its priority.
+     *
+     * @param packet The packet descriptor to meter. Modified by reference.
+     * @param policy The policy record whose token buckets are charged.
+     * @param now_ns Time the buckets are refilled to.
+     * @param release_ns If not null, receives the packet's release time and allows a
+     *                   shaping policy to delay the packet.
+     * @return True if the packet is to be enqueued, false if it should be dropped.
+     */
+    bool meter_packet(scheduler::PacketDescriptor& packet, policy::RuntimePolicy& policy, TimestampNs now_ns,
+                      TimestampNs* release_ns);
 };
 
 } // namespace core
@@ -0,0 +1,88 @@
+#ifndef HQTS_DATAPLANE_ADDRESS_INTERNER_H_
+#define HQTS_DATAPLANE_ADDRESS_INTERNER_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef> // For size_t
+#include <cstdint>
+#include <memory>       // For std::unique_ptr
+#include <shared_mutex> // For std::shared_mutex
+#include <vector>
+
+namespace hqts {
+namespace dataplane {
+
+/**
+ * @brief Gives each (segment, 128-bit address) pair in use a 32-bit handle.
+ *
+ * A segment separates address spaces, e.g. a VLAN id and VXLAN network identifier, so
+ * the same address in two tenants' segments gets two handles. Handles index a
+ * pre-sized open-addressing table and stay fixed while their entry lives; two pairs
+ * never share a handle at the same time.
+ *
+ * Every intern() stamps the entry with the caller's timestamp. reclaim() frees entries
+ * not used since a cutoff, so a handle may only be reused once nothing keyed by it is
+ * alive any more; DualStackFlowClassifier derives that cutoff from its table's aging.
+ *
+ * Safe to use from several threads: known addresses take a shared lock, new addresses
+ * and reclaim() an exclusive one.
+ */
+class AddressInterner {
+public:
+    /// Returned by intern() when the table is full.
+    static constexpr uint32_t NO_HANDLE = UINT32_MAX;
+
+    /**
+     * @param max_addresses Number of pairs that can be interned at once (> 0).
+     * @throws std::invalid_argument if max_addresses is 0 or too large for 32-bit handles.
+     */
+    explicit AddressInterner(size_t max_addresses);
+
+    AddressInterner(const AddressInterner&) = delete;
+    AddressInterner& operator=(const AddressInterner&) = delete;
+
+    /**
+     * @brief The handle of (`segment`, `address`), interning the pair if it is new.
+     * @param now_ns Recorded as the entry's last use, on the clock passed to reclaim().
+     * @return The handle, or NO_HANDLE if the pair is new and the table is full.
+     */
+    uint32_t intern(uint64_t segment, const std::array<uint8_t, 16>& address, uint64_t now_ns);
+
+    /**
+     * @brief Frees every entry last used before `cutoff_ns`; their handles may be reused.
+     * @return Number of entries freed.
+     */
+    size_t reclaim(uint64_t cutoff_ns);
+
+    /** @brief Frees every entry. */
+    void clear();
+
+    size_t size() const { return size_.load(std::memory_order_relaxed); }
+    size_t max_addresses() const { return max_addresses_; }
+
+private:
+    static constexpr uint8_t CTRL_EMPTY = 0;
+    static constexpr uint8_t CTRL_FULL = 1;
+    static constexpr uint8_t CTRL_DELETED = 2;
+
+    struct Entry {
+        std::array<uint8_t, 16> address{};
+        uint64_t segment = 0;
+        std::atomic<uint64_t> last_used_ns{0}; // Stamped under the shared lock
+    };
+
+    // Slot of the pair, or SIZE_MAX. Caller holds the lock.
+    size_t find_locked(size_t home, uint64_t segment, const std::array<uint8_t, 16>& address) const;
+
+    size_t max_addresses_;
+    size_t mask_;
+    std::unique_ptr<Entry[]> entries_;
+    std::vector<uint8_t> ctrl_;
+    std::atomic<size_t> size_{0};
+    mutable std::shared_mutex mutex_;
+};
+
+} // namespace dataplane
+} // namespace hqts
+
+#endif // HQTS_DATAPLANE_ADDRESS_INTERNER_H_
@@ -0,0 +1,99 @@
+#ifndef HQTS_DATAPLANE_DUAL_STACK_CLASSIFIER_H_
+#define HQTS_DATAPLANE_DUAL_STACK_CLASSIFIER_H_
+
+#include "hqts/dataplane/address_interner.h" // For AddressInterner
+#include "hqts/dataplane/flow_classifier.h"  // For FlowClassifier
+#include "hqts/dataplane/flow_identifier.h"  // For FiveTuple, ExtendedFlowKey
+#include "hqts/dataplane/flow_table.h"       // For core::FlowTable
+
+#include <cstddef> // For size_t
+#include <cstdint>
+#include <mutex>
+
+namespace hqts {
+namespace dataplane {
+
+/**
+ * @brief Classifies IPv4, IPv6, VLAN-tagged and VXLAN-tunnelled flows into two tables
+ *        of compact 16-byte keys.
+ *
+ * Plain IPv4 flows go to the IPv4 table through a FlowClassifier, exactly as without
+ * this class. Every other flow is keyed in a separate extended table by a FiveTuple
+ * whose addresses are AddressInterner handles of (VLAN + VNI segment, 128-bit address)
+ * pairs, so a flow costs one cache-line slot in either table and a widened key never
+ * slows the IPv4 path. Picking the table is one test of the key's header type.
+ *
+ * Interned addresses are reclaimed by age_flows(): after each complete aging pass over
+ * the extended table, every address not used since the pass started minus the table's
+ * idle timeout is freed. No flow still in the table can refer to such an address. With
+ * aging disabled in the extended table's FlowAgingConfig, addresses are never
+ * reclaimed and new extended flows fail once the interner is full.
+ *
+ * Rules apply to IPv4 flows; extended flows get the default policy. FlowIds are per
+ * table, so the two tables may hand out the same id.
+ */
+class DualStackFlowClassifier {
+public:
+    /**
+     * @param ipv4_table Table for plain IPv4 flows.
+     * @param extended_table Table for all other flows; must not be shared with another
+     *                       classifier, since its keys are handles of this one's interner.
+     * @param max_addresses Addresses the interner holds at once.
+     * @param rules Optional rules for IPv4 flows (see FlowClassifier). Must outlive the classifier.
+     * @throws std::invalid_argument if the tables are the same or max_addresses is invalid.
+     */
+    DualStackFlowClassifier(core::FlowTable& ipv4_table, core::FlowTable& extended_table, size_t max_addresses,
+                            policy::PolicyId default_policy_id, const RuleClassifier* rules = nullptr);
+
+    DualStackFlowClassifier(const DualStackFlowClassifier&) = delete;
+    DualStackFlowClassifier& operator=(const DualStackFlowClassifier&) = delete;
+
+    /** @brief IPv4 fast path: FlowClassifier::classify() on the IPv4 table. */
+    core::FlowContext* classify(const FiveTuple& five_tuple, uint64_t now_ns) {
+        return ipv4_.classify(five_tuple, now_ns);
+    }
+
+    /**
+     * @brief Looks up or creates the flow of `key` in the table for its header type.
+     * @return The flow's context, or nullptr if the flow is new and its table (or, for an
+     *         extended flow, the interner) is full.
+     */
+    core::FlowContext* classify(const ExtendedFlowKey& key, uint64_t now_ns);
+
+    /**
+     * @brief Burst variant of classify(): the keys of each group of
+     *        core::FlowTable::LOOKUP_BATCH are split by table and looked up with one
+     *        find_or_insert_burst() per table.
+     */
+    void classify_burst(const ExtendedFlowKey* keys, size_t count, uint64_t now_ns,
+                        core::FlowContext** contexts_out);
+
+    /**
+     * @brief One bounded aging sweep of each table, reclaiming interned addresses at the
+     *        end of each complete pass over the extended table.
+     * @return The number of idle flows expired.
+     */
+    size_t age_flows(uint64_t now_ns);
+
+    FlowClassifier& ipv4_classifier() { return ipv4_; }
+    const AddressInterner& addresses() const { return addresses_; }
+
+private:
+    // Key of an extended flow in the extended table; false if the interner is full.
+    bool compress(const ExtendedFlowKey& key, uint64_t now_ns, FiveTuple& out);
+
+    FlowClassifier ipv4_;
+    core::FlowTable& ipv4_table_;
+    core::FlowTable& extended_table_;
+    policy::PolicyId default_policy_id_;
+    AddressInterner addresses_;
+
+    std::mutex aging_mutex_;    // Guards the pass bookkeeping below
+    size_t sweeps_in_pass_ = 0; // Sweeps of the extended table since pass_start_ns_
+    uint64_t pass_start_ns_ = 0;
+};
+
+} // namespace dataplane
+} // namespace hqts
+
+#endif // HQTS_DATAPLANE_DUAL_STACK_CLASSIFIER_H_
@@ -0,0 +1,166 @@
+#ifndef HQTS_DATAPLANE_FLOW_CHECKPOINT_H_
+#define HQTS_DATAPLANE_FLOW_CHECKPOINT_H_
+
+#include "hqts/dataplane/flow_table.h"              // For FlowTable, FlowRecord
+#include "hqts/policy/runtime_policy_table.h"       // For policy::CompiledPolicies
+#include "hqts/core/time_source.h"                  // For TimestampNs
+
+#include <atomic>
+#include <cstddef> // For size_t
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace hqts {
+namespace core {
+
+/// FlowCheckpointHeader::magic: "HQTSFLCK" in little-endian byte order.
+constexpr uint64_t FLOW_CHECKPOINT_MAGIC = 0x4b434c4653545148ull;
+/// Bumped whenever the layout of the header or of a record changes.
+constexpr uint32_t FLOW_CHECKPOINT_FORMAT_VERSION = 1;
+
+/**
+ * @brief One flow table slot in a checkpoint file.
+ *
+ * `sequence` is a per-record seqlock, odd while the record is rewritten: a record torn
+ * by a crash mid-write is recognised and skipped on restore.
+ */
+struct FlowCheckpointRecord {
+    std::atomic<uint64_t> sequence;
+    FlowRecord flow;
+};
+
+/** @brief Bucket levels of one policy in a checkpoint file. */
+struct PolicyBucketRecord {
+    uint64_t policy_id;
+    uint64_t cir_tokens; // Bytes available at the time of the save
+    uint64_t pir_tokens;
+};
+
+/**
+ * @brief First bytes of a checkpoint file. Records follow at fixed offsets.
+ *
+ * slot_count flow records, one per slot of the checkpointed table, start at
+ * flows_offset; up to max_policies bucket records start at policies_offset, of which
+ * the first num_policies are valid. The policy section is rewritten as a whole under
+ * the `policies_sequence` seqlock. Multi-byte fields are in the writer's byte order.
+ */
+struct FlowCheckpointHeader {
+    uint64_t magic;
+    uint32_t format_version;
+    uint32_t record_bytes; // sizeof(FlowCheckpointRecord)
+    uint64_t file_bytes;
+    uint64_t slot_count;
+    uint64_t flows_offset;
+    uint64_t policies_offset;
+    uint32_t max_policies;
+    uint32_t num_policies;
+    std::atomic<uint64_t> completed_passes; // Full walks of the flow table so far
+    std::atomic<uint64_t> policies_sequence;
+    TimestampNs policies_saved_ns;
+};
+
+/**
+ * @brief Streams a FlowTable and policy bucket levels into a memory-mapped file, for a
+ *        warm restart with restore_flow_checkpoint().
+ *
+ * The file mirrors the table slot by slot. save_flows() walks the table incrementally,
+ * a bounded number of slots per call under one shard lock at a time, and rewrites only
+ * the records whose flow changed, so keeping a checkpoint current costs a background
+ * trickle of copies rather than a stop-the-world dump, and the kernel writes back only
+ * the pages that changed. A record reflects its slot as of the last pass over it.
+ *
+ * A new checkpoint is built as `path` + ".tmp" and renamed over `path` once its first
+ * pass completes, after syncing it, so a crash before then leaves the previous
+ * checkpoint in place. Later passes update the published file in place; per-record
+ * sequence numbers let restore_flow_checkpoint() skip records torn by a crash.
+ *
+ * save_policies() reads bucket state without synchronisation, so it must run on the
+ * thread metering the snapshot, between bursts.
+ */
+class FlowCheckpointWriter {
+public:
+    /**
+     * @brief Starts a new checkpoint for `table`, to replace `path` once complete.
+     *        Restore an earlier checkpoint from `path` before creating its writer.
+     * @param table Must outlive the writer.
+     * @param max_policies Bucket records the file has room for.
+     * @throws std::system_error if the file cannot be created or mapped.
+     */
+    FlowCheckpointWriter(const std::string& path, const FlowTable& table, size_t max_policies);
+
+    ~FlowCheckpointWriter();
+
+    FlowCheckpointWriter(const FlowCheckpointWriter&) = delete;
+    FlowCheckpointWriter& operator=(const FlowCheckpointWriter&) = delete;
+
+    /**
+     * @brief Checkpoints the next `max_slots` slots after the previous call's, wrapping
+     *        around at the end of the table.
+     * @return Number of records rewritten because their slot changed.
+     * @throws std::system_error if completing the first pass fails to publish the file.
+     */
+    size_t save_flows(size_t max_slots);
+
+    /** @brief One complete pass over the table. @return As save_flows(). */
+    size_t save_all_flows();
+
+    /**
+     * @brief Saves the bucket levels of every policy of `policies` at `now_ns`; policies
+     *        beyond max_policies are left out.
+     * @return Number of policies saved.
+     */
+    size_t save_policies(const policy::CompiledPolicies& policies, TimestampNs now_ns);
+
+    /**
+     * @brief Writes the mapped file back to storage and waits for it.
+     * @throws std::system_error on failure.
+     */
+    void sync();
+
+    /** @brief Complete passes over the flow table so far. */
+    uint64_t completed_passes() const;
+
+private:
+    // Syncs the temporary file, renames it to path_ and syncs the directory.
+    void publish();
+
+    const FlowTable& table_;
+    std::string path_;
+    std::string temporary_path_; // Where the file is built until its first pass completes
+    bool published_ = false;
+    void* mapping_ = nullptr;
+    size_t mapping_bytes_ = 0;
+    size_t cursor_ = 0;               // Next slot save_flows() checkpoints
+    std::vector<FlowRecord> scratch_; // Reused by save_flows()
+};
+
+/** @brief What restore_flow_checkpoint() brought back. */
+struct FlowRestoreResult {
+    size_t flows_restored = 0;
+    size_t flows_rejected = 0; // Torn records, or the table was full
+    size_t policies_restored = 0;
+};
+
+/**
+ * @brief Re-creates the flows and bucket levels saved in the checkpoint file `path`.
+ *
+ * One pass over the file: each saved flow is inserted into `table` with its policy,
+ * queue, drop policy and SLA status (FlowTable::import_flow()), so the first packets
+ * after a restart are classified as before instead of re-learning every flow on the
+ * default policy. Last-seen times later than `now_ns` are clamped to it. FlowIds are
+ * assigned afresh.
+ *
+ * If `policies` is given, each saved policy it holds gets the bucket levels it had,
+ * capped at its current capacities; its buckets must not have been metered yet.
+ *
+ * @throws std::system_error if the file cannot be opened or mapped.
+ * @throws std::runtime_error if it is not a checkpoint of this format version.
+ */
+FlowRestoreResult restore_flow_checkpoint(const std::string& path, FlowTable& table,
+                                          policy::CompiledPolicies* policies, TimestampNs now_ns);
+
+} // namespace core
+} // namespace hqts
+
+#endif // HQTS_DATAPLANE_FLOW_CHECKPOINT_H_
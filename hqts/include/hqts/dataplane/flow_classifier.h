@@ -5,24 +5,40 @@
 #include "hqts/policy/policy_types.h"      // For policy::PolicyId
 #include "hqts/core/flow_context.h"        // For core::FlowId
 #include "hqts/dataplane/flow_table.h"     // For core::FlowTable definition
-// #include <cstdint>                      // No longer needed directly, FlowId from flow_context.h
-#include <unordered_map>
-#include <mutex>    // For std::mutex and std::lock_guard
-#include <memory>   // For std::shared_ptr (not used here, but often in similar contexts)
+#include "hqts/dataplane/rule_classifier.h" // For RuleClassifier
+
+#include <cstddef> // For size_t
+#include <cstdint>
 
 // No forward declarations needed here now due to direct includes
 
 namespace hqts {
 namespace dataplane {
 
+/**
+ * @brief Maps 5-tuples to flows, creating FlowContexts for new flows.
+ *
+ * The FlowTable is keyed by the 5-tuple itself, so classification is a single
+ * open-addressing lookup that yields the FlowContext directly. Safe to call
+ * concurrently from several RX threads: known flows only take a shared lock on one
+ * table shard (see core::FlowTable).
+ *
+ * A new flow is assigned the policy of the first matching rule of an optional
+ * RuleClassifier, or the default policy. The rule set is searched once per flow, when
+ * it is created; the policy is then kept in the flow's context.
+ */
 class FlowClassifier {
 public:
     /**
      * @brief Constructor for FlowClassifier.
      * @param flow_table A reference to the application's main FlowTable where FlowContexts are stored.
-     * @param default_policy_id The PolicyId to assign to newly identified flows.
+     * @param default_policy_id The PolicyId to assign to newly identified flows that
+     *                          match no rule.
+     * @param rules Rules assigning policies to new flows, or nullptr to give every new
+     *              flow the default policy. Must outlive the classifier.
      */
-    FlowClassifier(core::FlowTable& flow_table, policy::PolicyId default_policy_id);
+    FlowClassifier(core::FlowTable& flow_table, policy::PolicyId default_policy_id,
+                   const RuleClassifier* rules = nullptr);
 
     // FlowClassifier might be stateful and potentially shared, so manage copy/move carefully.
     // For now, make it non-copyable and non-movable to simplify.
@@ -33,27 +49,69 @@ public:
 
     /**
      * @brief Gets the FlowId for a given FiveTuple.
-     * If the flow is new, it creates a FlowId, adds a corresponding FlowContext
-     * to the FlowTable using the default_policy_id, and maps the FiveTuple to the new FlowId.
+     * If the flow is new, a FlowContext using its rule's policy (or the default_policy_id)
+     * is added to the FlowTable.
      * @param five_tuple The 5-tuple identifying the flow.
      * @return The core::FlowId associated with this flow.
+     * @throws std::runtime_error if the flow is new and the FlowTable is full.
      */
     core::FlowId get_or_create_flow(const FiveTuple& five_tuple);
 
+    /**
+     * @brief Resolves the FlowIds for a whole burst of packets.
+     * Equivalent to calling get_or_create_flow() for each tuple in order.
+     * @param five_tuples Pointer to the first of `count` 5-tuples.
+     * @param count Number of tuples in the burst.
+     * @param flow_ids_out Pointer to storage for `count` FlowIds; entry i receives the
+     *                     FlowId for five_tuples[i].
+     * @throws std::runtime_error if a new flow does not fit into the FlowTable.
+     */
+    void get_or_create_flows(const FiveTuple* five_tuples, size_t count, core::FlowId* flow_ids_out);
+
+    /**
+     * @brief Data-path variant of get_or_create_flow() that returns the flow's context.
+     * @param five_tuple The 5-tuple identifying the flow.
+     * @return The flow's FlowContext (owned by the FlowTable), or nullptr if the flow is
+     *         new and the FlowTable is full.
+     */
+    core::FlowContext* classify(const FiveTuple& five_tuple);
+
+    /**
+     * @brief As classify(), with the caller's packet timestamp recorded as the flow's
+     *        last-seen time (see core::FlowTable::age()).
+     * @param now_ns Current time in nanoseconds on the steady clock.
+     */
+    core::FlowContext* classify(const FiveTuple& five_tuple, uint64_t now_ns);
+
+    /**
+     * @brief Burst variant of classify(). The clock is read once for the whole burst and
+     *        the keys are looked up with FlowTable::find_or_insert_burst().
+     * @param contexts_out Pointer to storage for `count` pointers; entry i receives the
+     *                     context for five_tuples[i] (nullptr if it did not fit).
+     */
+    void classify_burst(const FiveTuple* five_tuples, size_t count, core::FlowContext** contexts_out);
+
+    /**
+     * @brief As classify_burst(), with the caller's burst timestamp instead of a clock read.
+     * @param now_ns Arrival time of the burst in nanoseconds (see core::TimestampNs).
+     */
+    void classify_burst(const FiveTuple* five_tuples, size_t count, uint64_t now_ns,
+                        core::FlowContext** contexts_out);
+
+    /**
+     * @brief Runs one bounded aging sweep of the FlowTable at the current steady-clock time.
+     * @return The number of idle flows expired.
+     */
+    size_t age_flows();
+
     // Convenience overload for PacketDescriptor might be added later if PacketDescriptor is enhanced
     // to easily provide a FiveTuple or if parsing logic is integrated here.
     // core::FlowId get_or_create_flow(const scheduler::PacketDescriptor& packet);
 
 private:
     core::FlowTable& flow_table_; // Reference to the global flow table (stores FlowContext)
-
-    // Internal map to quickly find an existing FlowId for a given FlowKey (FiveTuple)
-    std::unordered_map<FlowKey, core::FlowId> flow_key_to_flow_id_map_;
-
-    core::FlowId next_flow_id_ = 1; // Monotonically increasing counter for new FlowIds
-    policy::PolicyId default_policy_id_; // Policy to assign to new flows
-
-    std::mutex mutex_; // Mutex to protect access to flow_key_to_flow_id_map_ and next_flow_id_
+    policy::PolicyId default_policy_id_; // Policy to assign to new flows that match no rule
+    const RuleClassifier* rules_;        // Optional; consulted only for new flows
 };
 
 } // namespace dataplane
@@ -0,0 +1,51 @@
+#ifndef HQTS_DATAPLANE_FLOW_HASH_H_
+#define HQTS_DATAPLANE_FLOW_HASH_H_
+
+#include <cstdint>
+
+#if defined(__SSE4_2__)
+#include <nmmintrin.h> // For _mm_crc32_u64
+#endif
+
+namespace hqts {
+namespace dataplane {
+
+// True when flow keys are hashed with the SSE4.2 CRC32C instruction. Controlled by the
+// HQTS_ENABLE_SSE42 CMake option, which compiles hqts_core and its consumers with -msse4.2.
+#if defined(__SSE4_2__)
+constexpr bool FLOW_HASH_USES_CRC32C = true;
+#else
+constexpr bool FLOW_HASH_USES_CRC32C = false;
+#endif
+
+/**
+ * @brief Hashes a 16-byte flow key given as two 64-bit words.
+ *
+ * With SSE4.2 this is two CRC32C instructions (3-cycle latency, one per cycle
+ * throughput, so hashing a batch of keys back to back overlaps them) folded into 64
+ * bits with one multiply. Without it, a portable multiply/xor-shift mix is used. Both
+ * spread keys that differ only in a few address bits over all output bits.
+ * Values differ between the two variants; they are never persisted.
+ */
+inline uint64_t hash_key_words(uint64_t w0, uint64_t w1) {
+#if defined(__SSE4_2__)
+    uint64_t crc = _mm_crc32_u64(0x9E3779B9u, w0);
+    crc = _mm_crc32_u64(crc, w1);
+    // CRC32C is only 32 bits wide; the multiply makes the upper bits (used for shard and
+    // tag selection) depend on every CRC bit.
+    return (crc | (crc << 32)) * 0x9E3779B97F4A7C15ull;
+#else
+    uint64_t h = w0 * 0x9E3779B97F4A7C15ull;
+    uint64_t m = w1 * 0xC2B2AE3D27D4EB4Full;
+    h ^= (m << 31) | (m >> 33);
+    h ^= h >> 32;
+    h *= 0xD6E8FEB86659FD93ull;
+    h ^= h >> 32;
+    return h;
+#endif
+}
+
+} // namespace dataplane
+} // namespace hqts
+
+#endif // HQTS_DATAPLANE_FLOW_HASH_H_
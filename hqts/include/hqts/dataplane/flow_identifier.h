@@ -1,9 +1,14 @@
 #ifndef HQTS_DATAPLANE_FLOW_IDENTIFIER_H_
 #define HQTS_DATAPLANE_FLOW_IDENTIFIER_H_
 
+#include "hqts/dataplane/flow_hash.h" // For hash_key_words
+
+#include <array>
 #include <cstdint>
+#include <cstring>    // For std::memcmp, std::memcpy
 #include <string>     // For potential future use (e.g. string IPs if needed, though not current)
 #include <functional> // For std::hash
+#include <type_traits> // For std::has_unique_object_representations
 #include <utility>    // For std::pair (not directly used here, but often with hashing)
 
 // Forward declaration of core::FlowId is not strictly necessary here as this file
@@ -16,27 +21,30 @@ namespace dataplane {
 // Basic 5-tuple structure for flow identification.
 // In a real system, IP addresses might be represented by more complex types
 // (e.g., from a networking library, or structs that handle IPv4/IPv6).
+//
+// The 13 key bytes are laid out without implicit padding and followed by 3 explicit,
+// always-zero padding bytes, so a key is exactly 16 bytes that can be compared with
+// one memcmp and hashed as two 64-bit words (see flow_hash.h).
 struct FiveTuple {
     uint32_t source_ip;      // IPv4 source address
     uint32_t dest_ip;        // IPv4 destination address
     uint16_t source_port;    // Source port (TCP/UDP)
     uint16_t dest_port;      // Destination port (TCP/UDP)
     uint8_t protocol;       // IP protocol (e.g., IPPROTO_TCP, IPPROTO_UDP from netinet/in.h)
+    uint8_t padding[3];     // Always zero; part of the key's byte representation
 
     // Constructor with default values
     FiveTuple(uint32_t s_ip = 0, uint32_t d_ip = 0,
               uint16_t s_port = 0, uint16_t d_port = 0,
               uint8_t proto = 0)
         : source_ip(s_ip), dest_ip(d_ip),
-          source_port(s_port), dest_port(d_port), protocol(proto) {}
+          source_port(s_port), dest_port(d_port), protocol(proto), padding{0, 0, 0} {}
 
     // Equality operator: crucial for std::unordered_map to handle hash collisions.
+    // Valid as a byte compare because the struct has no implicit padding and the
+    // explicit padding is always zero.
     bool operator==(const FiveTuple& other) const {
-        return source_ip == other.source_ip &&
-               dest_ip == other.dest_ip &&
-               source_port == other.source_port &&
-               dest_port == other.dest_port &&
-               protocol == other.protocol;
+        return std::memcmp(this, &other, sizeof(FiveTuple)) == 0;
     }
 
     // Optional: A less-than operator can be useful for ordered maps or sets,
@@ -50,9 +58,82 @@ struct FiveTuple {
     }
 };
 
+static_assert(sizeof(FiveTuple) == 16, "FiveTuple must be a packed 16-byte key");
+static_assert(std::has_unique_object_representations<FiveTuple>::value,
+              "FiveTuple must not contain implicit padding");
+
 // FlowKey is defined as the FiveTuple for identifying flows based on packet headers.
 using FlowKey = FiveTuple;
 
+/**
+ * @brief 64-bit hash of a 5-tuple (CRC32C when built with SSE4.2, see flow_hash.h).
+ */
+inline uint64_t hash_five_tuple(const FiveTuple& key) {
+    uint64_t words[2];
+    std::memcpy(words, &key, sizeof(words));
+    return hash_key_words(words[0], words[1]);
+}
+
+/**
+ * @brief Flow key of a packet that a FiveTuple cannot describe: IPv6 addresses, or a
+ *        flow inside a VLAN or a VXLAN tunnel.
+ *
+ * IPv4 addresses are stored IPv4-mapped (::ffff:a.b.c.d). Such keys are not stored in a
+ * FlowTable as they are: DualStackFlowClassifier sends plain IPv4 keys to the IPv4
+ * table and compresses the others to a FiveTuple with an AddressInterner, so neither
+ * table's slots grow.
+ */
+struct ExtendedFlowKey {
+    std::array<uint8_t, 16> source_ip{}; // Network byte order
+    std::array<uint8_t, 16> dest_ip{};
+    uint16_t source_port = 0;
+    uint16_t dest_port = 0;
+    uint8_t protocol = 0;
+    uint16_t vlan_id = 0; // 802.1Q VLAN id; 0 if untagged
+    uint32_t vni = 0;     // 24-bit VXLAN network identifier; 0 if not tunnelled
+
+    /** @brief Key of an IPv4 flow, optionally inside VLAN `vlan` / VXLAN segment `vxlan_vni`. */
+    static ExtendedFlowKey from_ipv4(const FiveTuple& tuple, uint16_t vlan = 0, uint32_t vxlan_vni = 0) {
+        ExtendedFlowKey key;
+        map_ipv4(tuple.source_ip, key.source_ip);
+        map_ipv4(tuple.dest_ip, key.dest_ip);
+        key.source_port = tuple.source_port;
+        key.dest_port = tuple.dest_port;
+        key.protocol = tuple.protocol;
+        key.vlan_id = vlan;
+        key.vni = vxlan_vni;
+        return key;
+    }
+
+    /** @brief True if both addresses are IPv4-mapped. */
+    bool is_ipv4() const { return is_mapped_ipv4(source_ip) && is_mapped_ipv4(dest_ip); }
+
+    /** @brief True for an untagged, untunnelled IPv4 flow: one a FiveTuple describes. */
+    bool is_plain_ipv4() const { return vlan_id == 0 && vni == 0 && is_ipv4(); }
+
+    /** @brief The 5-tuple of an IPv4 flow (is_ipv4() must hold); VLAN and VNI are dropped. */
+    FiveTuple to_ipv4() const {
+        return FiveTuple(unmap_ipv4(source_ip), unmap_ipv4(dest_ip), source_port, dest_port, protocol);
+    }
+
+private:
+    static void map_ipv4(uint32_t address, std::array<uint8_t, 16>& out) {
+        out = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff,
+               static_cast<uint8_t>(address >> 24), static_cast<uint8_t>(address >> 16),
+               static_cast<uint8_t>(address >> 8), static_cast<uint8_t>(address)};
+    }
+
+    static bool is_mapped_ipv4(const std::array<uint8_t, 16>& address) {
+        static const uint8_t prefix[12] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff};
+        return std::memcmp(address.data(), prefix, sizeof(prefix)) == 0;
+    }
+
+    static uint32_t unmap_ipv4(const std::array<uint8_t, 16>& address) {
+        return (uint32_t{address[12]} << 24) | (uint32_t{address[13]} << 16) | (uint32_t{address[14]} << 8) |
+               uint32_t{address[15]};
+    }
+};
+
 // Note: The core::FlowId (defined in hqts/core/flow_context.h as uint64_t)
 // will be the actual identifier used as the key in the FlowTable.
 // A FlowClassifier component will be responsible for mapping a FlowKey (FiveTuple)
@@ -64,20 +145,12 @@ using FlowKey = FiveTuple;
 
 // Specialization of std::hash for hqts::dataplane::FiveTuple.
 // This allows hqts::dataplane::FiveTuple (and thus FlowKey) to be used as a key
-// in std::unordered_map and std::unordered_set.
+// in std::unordered_map and std::unordered_set. Uses the same hash as the FlowTable.
 namespace std {
 template <>
 struct hash<hqts::dataplane::FiveTuple> {
     size_t operator()(const hqts::dataplane::FiveTuple& k) const {
-        // A common way to combine hashes for multiple fields.
-        // This specific sequence is often used (similar to Boost's hash_combine).
-        size_t seed = 0;
-        seed ^= std::hash<uint32_t>{}(k.source_ip) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
-        seed ^= std::hash<uint32_t>{}(k.dest_ip) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
-        seed ^= std::hash<uint16_t>{}(k.source_port) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
-        seed ^= std::hash<uint16_t>{}(k.dest_port) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
-        seed ^= std::hash<uint8_t>{}(k.protocol) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
-        return seed;
+        return static_cast<size_t>(hqts::dataplane::hash_five_tuple(k));
     }
 };
 } // namespace std
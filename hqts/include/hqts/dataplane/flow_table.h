@@ -1,15 +1,359 @@
 #ifndef HQTS_DATAPLANE_FLOW_TABLE_H_
 #define HQTS_DATAPLANE_FLOW_TABLE_H_
 
-#include "hqts/core/flow_context.h" // For core::FlowId and core::FlowContext
-#include <unordered_map>
+#include "hqts/core/flow_context.h"         // For core::FlowId and core::FlowContext
+#include "hqts/dataplane/flow_identifier.h" // For dataplane::FiveTuple
+
+#include <array>
+#include <atomic>       // For std::atomic
+#include <cstddef>      // For size_t
+#include <cstdint>
+#include <memory>       // For std::unique_ptr
+#include <shared_mutex> // For std::shared_mutex (per-shard reader/writer lock)
+#include <utility>      // For std::pair
+#include <vector>
 
 namespace hqts {
+namespace dataplane {
+class RuleClassifier;
+} // namespace dataplane
+
 namespace core { // Definition should be in namespace hqts::core
 
-// FlowTable maps a unique FlowId to its context.
-// Note: core::FlowId and core::FlowContext are defined in "hqts/core/flow_context.h"
-using FlowTable = std::unordered_map<FlowId, FlowContext>;
+/**
+ * @brief What FlowTable::find_or_insert() does with a new flow when the table is full.
+ */
+enum class FlowTableFullPolicy {
+    REJECT,   // The new flow is not inserted
+    EVICT_LRU // The least recently seen of a small sample of flows is evicted to make room
+};
+
+/**
+ * @brief Idle-flow aging and capacity behaviour of a FlowTable.
+ */
+struct FlowAgingConfig {
+    uint64_t idle_timeout_ns = 0;   // Flows idle for at least this long are expired by age(); 0 disables aging
+    size_t slots_per_sweep = 1024;  // Slots examined by each age() call, bounding its cost
+    FlowTableFullPolicy full_policy = FlowTableFullPolicy::REJECT;
+};
+
+/**
+ * @brief The persistent state of one flow: what a checkpoint keeps across a restart.
+ *
+ * FlowIds are not part of it: they name table slots, and a restored flow gets a new one.
+ */
+struct FlowRecord {
+    dataplane::FiveTuple key;
+    policy::PolicyId policy_id = 0;
+    QueueId queue_id = 0;
+    DropPolicy drop_policy = DropPolicy::TAIL_DROP;
+    SLAStatus sla_status = SLAStatus::UNKNOWN;
+    bool live = false;     // False for a free slot (see FlowTable::export_slots())
+    uint64_t last_seen_ns = 0;
+};
+
+/**
+ * @brief Open-addressing flow table keyed directly by the 5-tuple.
+ *
+ * Each slot is one cache line holding the flow's key and its hot FlowContext, so a
+ * lookup that hits its home slot touches a single line of slot memory. Probing is
+ * guided by a parallel array of one-byte control words (empty, deleted, or 7 bits of
+ * the key's hash), which keeps probe sequences off the slot lines. Cold per-flow
+ * statistics live in a separate array indexed like the slots.
+ *
+ * The table is pre-sized at construction and never rehashes, and entries never move,
+ * so FlowContext/FlowStatistics pointers stay valid until their flow is erased, expired,
+ * evicted, or the table is cleared. A FlowId encodes the flow's slot plus a per-slot
+ * generation, which makes lookups by id a direct index and lets stale ids be detected
+ * after the slot is reused.
+ *
+ * Slots are split into NUM_SHARDS shards selected by the key hash, each guarded by its
+ * own reader/writer lock: lookups of existing flows take one shard's shared lock, and
+ * only inserts and erases take it exclusively. The table does not synchronize access
+ * to the contents of a FlowContext it has handed out.
+ *
+ * Every lookup through find_or_insert() records the caller's timestamp as the flow's
+ * last-seen time. age() expires idle flows incrementally: each call examines the next
+ * slots_per_sweep slots after a shared cursor, so with one call every T nanoseconds a
+ * flow is removed at most idle_timeout_ns + sweeps_per_pass() * T after its last packet.
+ * Erasing a flow leaves a tombstone wherever a later key's probe sequence may run
+ * through its slot. Churn would let tombstones take the place of free slots and make
+ * every miss scan its whole shard, so once a shard has gathered slots_per_shard / 8
+ * new tombstones it clears all those no live key's probe sequence crosses. Flows are
+ * never moved for this, so pointers stay valid.
+ *
+ * Because expiry and eviction recycle slots, a caller that keeps FlowContext pointers
+ * across calls must not run age() (or fill the table under EVICT_LRU) concurrently with
+ * its use of them.
+ */
+class FlowTable {
+public:
+    static constexpr size_t DEFAULT_MAX_FLOWS = 16384;
+    static constexpr size_t NUM_SHARDS = 16; // Must be a power of two
+    static constexpr size_t LOOKUP_BATCH = 16; // Keys hashed and prefetched together by the burst lookups
+
+    /**
+     * @brief Constructs an empty table able to hold `max_flows` flows.
+     * @param max_flows Maximum number of live flows (> 0).
+     * @param aging Idle timeout, sweep size and behaviour when the table is full.
+     * @throws std::invalid_argument if max_flows is 0 or too large to index, or if
+     *         aging.slots_per_sweep is 0.
+     */
+    explicit FlowTable(size_t max_flows = DEFAULT_MAX_FLOWS, FlowAgingConfig aging = FlowAgingConfig());
+
+    FlowTable(const FlowTable&) = delete;
+    FlowTable& operator=(const FlowTable&) = delete;
+    FlowTable(FlowTable&&) = delete;
+    FlowTable& operator=(FlowTable&&) = delete;
+
+    /**
+     * @brief Looks up the flow for a 5-tuple.
+     * @return The flow's context, or nullptr if the flow is not in the table.
+     */
+    FlowContext* find(const dataplane::FiveTuple& key);
+    const FlowContext* find(const dataplane::FiveTuple& key) const;
+
+    /**
+     * @brief Looks up the flow for a 5-tuple, inserting it if it is missing, and marks
+     *        it as seen at `now_ns`.
+     *
+     * A new flow gets a fresh FlowId and a FlowContext built from the given policy,
+     * queue and drop policy; its statistics are reset. If the table is full, the
+     * configured FlowTableFullPolicy decides whether an old flow makes room. EVICT_LRU
+     * examines a bounded number of slots after the shard's eviction cursor; if none of
+     * them holds a flow it may evict, the insert fails as under REJECT.
+     *
+     * @param now_ns Current time in nanoseconds on the clock used for age().
+     * @param rules If given, a new flow gets rules->classify(key, policy_id) instead of
+     *              `policy_id`. The rules are consulted only when the flow is missing,
+     *              outside the shard lock; lookups of known flows never see them.
+     * @return The flow's context (nullptr if the flow had to be inserted but the table
+     *         is full) and whether it was inserted by this call.
+     */
+    std::pair<FlowContext*, bool> find_or_insert(const dataplane::FiveTuple& key,
+                                                 policy::PolicyId policy_id,
+                                                 QueueId queue_id,
+                                                 DropPolicy drop_policy,
+                                                 uint64_t now_ns,
+                                                 const dataplane::RuleClassifier* rules = nullptr);
+
+    /**
+     * @brief Looks up a burst of 5-tuples.
+     *
+     * Same results as calling find() for each key, but processed in groups of
+     * LOOKUP_BATCH: all keys of a group are hashed first, then the home control byte and
+     * slot line of every key are prefetched, and only then are the keys probed, so the
+     * cache misses of a group overlap instead of being taken one after another.
+     *
+     * @param contexts_out Pointer to storage for `count` pointers; entry i receives the
+     *                     context for keys[i], or nullptr if it is not in the table.
+     */
+    void lookup_burst(const dataplane::FiveTuple* keys, size_t count, FlowContext** contexts_out);
+
+    /**
+     * @brief Burst variant of find_or_insert(), batched like lookup_burst().
+     * @param contexts_out Receives the context for keys[i] (nullptr if it had to be
+     *                     inserted but the table is full). Under EVICT_LRU, inserts of
+     *                     later keys never evict the flows already returned for earlier
+     *                     ones; a key finding only such flows to evict gets nullptr.
+     */
+    void find_or_insert_burst(const dataplane::FiveTuple* keys, size_t count,
+                              policy::PolicyId policy_id, QueueId queue_id, DropPolicy drop_policy,
+                              uint64_t now_ns, FlowContext** contexts_out,
+                              const dataplane::RuleClassifier* rules = nullptr);
+
+    /**
+     * @brief Removes the flow for a 5-tuple.
+     * @return True if a flow was removed.
+     */
+    bool erase(const dataplane::FiveTuple& key);
+
+    /**
+     * @brief Looks up a flow by the FlowId the table assigned to it.
+     * @return The flow's context, or nullptr if the id is unknown or its flow was erased.
+     */
+    FlowContext* find_by_id(FlowId flow_id);
+    const FlowContext* find_by_id(FlowId flow_id) const;
+
+    /**
+     * @brief Cold statistics of a flow, by FlowId.
+     * @return The flow's statistics, or nullptr if the id is unknown or its flow was erased.
+     */
+    FlowStatistics* statistics_by_id(FlowId flow_id);
+    const FlowStatistics* statistics_by_id(FlowId flow_id) const;
+
+    /**
+     * @brief The 5-tuple of a flow, by FlowId.
+     * @return A pointer to the key, or nullptr if the id is unknown or its flow was erased.
+     */
+    const dataplane::FiveTuple* key_by_id(FlowId flow_id) const;
+
+    /**
+     * @brief Removes a flow by FlowId.
+     * @return True if a flow was removed.
+     */
+    bool erase_by_id(FlowId flow_id);
+
+    /**
+     * @brief The time a flow was last seen through find_or_insert(), by FlowId.
+     * @return The timestamp in nanoseconds, or 0 if the id is unknown or its flow was erased.
+     */
+    uint64_t last_seen_ns_by_id(FlowId flow_id) const;
+
+    /**
+     * @brief Runs one bounded aging sweep over the next slots_per_sweep slots.
+     *
+     * Expires every flow in those slots that has been idle for at least the configured
+     * idle timeout. Does nothing if aging is disabled. Safe to call from any thread;
+     * concurrent calls sweep disjoint slot ranges.
+     *
+     * @param now_ns Current time in nanoseconds, on the clock passed to find_or_insert().
+     * @return The number of flows expired by this call.
+     */
+    size_t age(uint64_t now_ns);
+
+    /**
+     * @brief Number of age() calls that together visit every slot once.
+     */
+    size_t sweeps_per_pass() const;
+
+    /**
+     * @brief Removes all flows. FlowIds issued before the call are no longer valid.
+     */
+    void clear();
+
+    /**
+     * @brief Copies the flows of slots [first_slot, first_slot + count) into `out`.
+     *
+     * out[i] describes slot first_slot + i, with `live` false if it holds no flow. Each
+     * shard's slots are copied under its shared lock, so a large table can be walked in
+     * bounded steps alongside the data path (see FlowCheckpointWriter).
+     *
+     * @return Number of live flows copied.
+     * @throws std::out_of_range if the range extends past slot_count().
+     */
+    size_t export_slots(size_t first_slot, size_t count, FlowRecord* out) const;
+
+    /**
+     * @brief Inserts a flow with the state of `record`, as find_or_insert() would at
+     *        record.last_seen_ns, and sets its SLA status.
+     *
+     * An existing flow with the same key keeps its policy, queue and SLA status.
+     *
+     * @return As find_or_insert().
+     */
+    std::pair<FlowContext*, bool> import_flow(const FlowRecord& record);
+
+    uint64_t expired_flow_count() const { return expired_flows_.load(std::memory_order_relaxed); }
+    uint64_t evicted_flow_count() const { return evicted_flows_.load(std::memory_order_relaxed); }
+    const FlowAgingConfig& aging_config() const { return aging_; }
+
+    size_t size() const { return size_.load(std::memory_order_relaxed); }
+    bool empty() const { return size() == 0; }
+    size_t max_flows() const { return max_flows_; }
+
+    // Total number of slots (capacity including the load-factor headroom).
+    size_t slot_count() const { return slot_count_; }
+
+    /**
+     * @brief Number of deleted slots still marked as tombstones, i.e. lengthening probes.
+     */
+    size_t tombstone_count() const;
+
+    /**
+     * @brief Number of slots a lookup of `key` examines: up to its flow's slot, or for
+     *        an absent key up to the first EMPTY slot. For diagnostics and tests.
+     */
+    size_t probe_length(const dataplane::FiveTuple& key) const;
+
+private:
+    // Control byte values. A full slot stores 7 bits of its key's hash (< 0x80).
+    static constexpr uint8_t CTRL_EMPTY = 0x80;
+    static constexpr uint8_t CTRL_DELETED = 0xFE;
+
+    struct alignas(64) Slot {
+        dataplane::FiveTuple key;
+        FlowContext context;
+        // Written by every packet of the flow, possibly from several threads at once.
+        std::atomic<uint64_t> last_seen_ns{0};
+    };
+    static_assert(sizeof(Slot) == 64, "FlowTable slot must occupy exactly one cache line");
+
+    struct alignas(64) Shard {
+        mutable std::shared_mutex mutex;
+        size_t eviction_cursor = 0; // Where the next LRU sample starts; guarded by `mutex`
+        size_t tombstones = 0;      // CTRL_DELETED slots; guarded by `mutex`
+        size_t purge_at = 0;        // Tombstone count that triggers the next purge; guarded by `mutex`
+    };
+
+    struct HashParts {
+        size_t shard;    // Which shard the key lives in
+        size_t home;     // Home slot index within the shard
+        uint8_t tag;     // 7-bit hash fragment stored in the control byte
+    };
+
+    HashParts hash_key(const dataplane::FiveTuple& key) const;
+
+    // Issues prefetches for the home control byte and slot of a hashed key.
+    void prefetch_home(const HashParts& parts) const;
+
+    std::pair<FlowContext*, bool> find_or_insert_hashed(const HashParts& parts, const dataplane::FiveTuple& key,
+                                                        policy::PolicyId policy_id, QueueId queue_id,
+                                                        DropPolicy drop_policy, uint64_t now_ns,
+                                                        const dataplane::RuleClassifier* rules,
+                                                        FlowContext* const* pinned = nullptr,
+                                                        size_t pinned_count = 0);
+
+    // Probes `shard` for `key`; returns the global slot index or SIZE_MAX. Caller holds the shard lock.
+    size_t find_slot_locked(const HashParts& parts, const dataplane::FiveTuple& key) const;
+
+    // Probes for `key` and, if it is absent, picks the first reusable slot of its probe
+    // sequence. Returns the key's slot (found = true), the insert slot, or SIZE_MAX when
+    // the shard has no free slot. Caller holds the shard lock.
+    size_t find_or_reserve_slot_locked(const HashParts& parts, const dataplane::FiveTuple& key,
+                                       bool& found) const;
+
+    // Frees a full slot and fixes up the control bytes. Caller holds the shard lock exclusively.
+    void erase_slot_locked(size_t slot_index);
+
+    // Turns every tombstone of `shard` that no live key's probe sequence runs through
+    // back into EMPTY, without moving any flow. Caller holds the shard lock exclusively.
+    void purge_tombstones_locked(size_t shard);
+
+    // Evicts the least recently seen of up to LRU_SAMPLE_SIZE live flows among the next
+    // LRU_MAX_PROBES slots of `shard`, skipping the `pinned_count` contexts of `pinned`
+    // (handed out earlier in the same burst). Returns false if those slots hold no other
+    // flow. Caller holds the shard lock exclusively.
+    bool evict_lru_locked(size_t shard, FlowContext* const* pinned, size_t pinned_count);
+
+    // Expires idle flows in [begin, end) of one shard.
+    size_t age_range(size_t shard, size_t begin, size_t end, uint64_t now_ns);
+
+    // Maps a FlowId to its slot index if the id is currently live; SIZE_MAX otherwise.
+    // Caller holds the owning shard's lock.
+    size_t live_slot_for_id_locked(FlowId flow_id) const;
+
+    // Shard owning a FlowId's slot (SIZE_MAX for ids that cannot be valid).
+    size_t shard_for_id(FlowId flow_id) const;
+
+    static constexpr size_t LRU_SAMPLE_SIZE = 8;
+    static constexpr size_t LRU_MAX_PROBES = 8 * LRU_SAMPLE_SIZE; // Bounds an eviction's work
+
+    size_t max_flows_;
+    FlowAgingConfig aging_;
+    size_t slots_per_shard_; // Power of two
+    size_t shard_slot_mask_;
+    size_t slot_count_;
+    std::atomic<size_t> size_{0};
+    std::atomic<size_t> age_cursor_{0};  // Next slot to be swept (modulo slot_count_)
+    std::atomic<uint64_t> expired_flows_{0};
+    std::atomic<uint64_t> evicted_flows_{0};
+
+    std::unique_ptr<Slot[]> slots_;     // NUM_SHARDS contiguous ranges of slots_per_shard_
+    std::vector<uint8_t> ctrl_;         // One control byte per slot
+    std::vector<FlowStatistics> cold_;  // Cold per-flow state, indexed like slots_
+    std::array<Shard, NUM_SHARDS> shards_;
+};
 
 } // namespace core
 } // namespace hqts
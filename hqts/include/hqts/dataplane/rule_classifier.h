@@ -0,0 +1,105 @@
+#ifndef HQTS_DATAPLANE_RULE_CLASSIFIER_H_
+#define HQTS_DATAPLANE_RULE_CLASSIFIER_H_
+
+#include "hqts/dataplane/flow_identifier.h" // For FiveTuple
+#include "hqts/policy/policy_types.h"      // For policy::PolicyId
+
+#include <cstddef> // For size_t
+#include <cstdint>
+#include <vector>
+
+namespace hqts {
+namespace dataplane {
+
+/**
+ * @brief One ACL-style rule: a flow matching every field is assigned `policy_id`.
+ *
+ * Addresses match on a prefix (length 0 matches any address), ports on an inclusive
+ * range, and the protocol exactly unless `any_protocol` is set.
+ */
+struct ClassificationRule {
+    uint32_t source_ip = 0;
+    uint8_t source_prefix_length = 0; // 0..32
+    uint32_t dest_ip = 0;
+    uint8_t dest_prefix_length = 0;   // 0..32
+    uint16_t source_port_min = 0;
+    uint16_t source_port_max = UINT16_MAX;
+    uint16_t dest_port_min = 0;
+    uint16_t dest_port_max = UINT16_MAX;
+    uint8_t protocol = 0;
+    bool any_protocol = true;
+    policy::PolicyId policy_id = 0;
+};
+
+/**
+ * @brief Maps 5-tuples to policies with an immutable, ordered rule set.
+ *
+ * The first matching rule in rule-set order wins, as in an ACL. Lookups use tuple
+ * space search: rules are grouped by the shape of their mask (source and destination
+ * prefix lengths, whether the protocol is exact, whether the destination port is a
+ * single port), and each group is an open-addressing hash table keyed by the masked
+ * header fields. A lookup masks the tuple once per group and probes that group's
+ * table; the rules found there only need their port ranges checked. Groups are
+ * visited in order of their best rule, so the search stops at the first group that
+ * cannot beat the match found so far. Thousands of tenants' rules typically collapse
+ * into a few dozen groups.
+ *
+ * Lookups are const and need no synchronisation. FlowClassifier runs one only when a
+ * flow is created; the result is kept in the flow's context, so packets of known flows
+ * never reach the rule set.
+ */
+class RuleClassifier {
+public:
+    /**
+     * @brief Builds the lookup structure for `rules`, in priority order.
+     * @throws std::invalid_argument if a prefix length exceeds 32 or a port range is empty.
+     * @throws std::length_error if there are 2^32 - 1 rules or more.
+     */
+    explicit RuleClassifier(std::vector<ClassificationRule> rules);
+
+    /** @brief Policy of the first rule matching `key`, or `default_policy_id` if none does. */
+    policy::PolicyId classify(const FiveTuple& key, policy::PolicyId default_policy_id) const;
+
+    /**
+     * @brief Index of the first rule matching `key`.
+     * @return Its position in the rule set, or rule_count() if no rule matches.
+     */
+    size_t match(const FiveTuple& key) const;
+
+    size_t rule_count() const { return rules_.size(); }
+
+    /** @brief Number of mask shapes (hash tables) a lookup may probe. */
+    size_t tuple_count() const { return tuples_.size(); }
+
+    const ClassificationRule& rule(size_t index) const { return rules_[index]; }
+
+private:
+    /// A mask shape and the hash table of the rules sharing it.
+    struct Tuple {
+        uint32_t source_mask = 0;
+        uint32_t dest_mask = 0;
+        bool exact_protocol = false;
+        bool exact_dest_port = false;
+        uint32_t best_rule = 0;       // Smallest rule index in the group
+        size_t bucket_mask = 0;       // Buckets in [first_bucket, first_bucket + bucket_mask]
+        size_t first_bucket = 0;      // Into buckets_
+    };
+
+    /// Masked header fields shared by one or more rules of a tuple.
+    struct Bucket {
+        uint64_t key_high = 0;  // Masked source and destination address
+        uint64_t key_low = 0;   // Masked protocol and destination port, plus an occupied bit
+        uint32_t first_rule = 0; // Into bucket_rules_
+        uint32_t rule_count = 0;
+    };
+
+    std::vector<ClassificationRule> rules_;
+    std::vector<Tuple> tuples_;          // Sorted by best_rule
+    std::vector<Bucket> buckets_;        // The hash tables of all tuples, back to back
+    std::vector<uint32_t> bucket_rules_; // Rule indices of each bucket, ascending
+};
+
+} // namespace dataplane
+} // namespace hqts
+
+#endif // HQTS_DATAPLANE_RULE_CLASSIFIER_H_
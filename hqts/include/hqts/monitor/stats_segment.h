@@ -0,0 +1,197 @@
+#ifndef HQTS_MONITOR_STATS_SEGMENT_H_
+#define HQTS_MONITOR_STATS_SEGMENT_H_
+
+#include "hqts/core/time_source.h" // For TimestampNs
+
+#include <atomic>
+#include <cstddef> // For size_t
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace hqts {
+namespace monitor {
+
+/// StatsSegmentHeader::magic: "HQTSSTAT" in little-endian byte order.
+constexpr uint64_t STATS_SEGMENT_MAGIC = 0x5441545353545148ull;
+/// Bumped whenever the layout of the header or of a record changes.
+constexpr uint32_t STATS_SEGMENT_LAYOUT_VERSION = 1;
+
+/** @brief Counters of one metering policy, folded over all cores. */
+struct PolicyStatsRecord {
+    uint64_t policy_id;
+    uint64_t packets_processed;
+    uint64_t bytes_processed;
+    uint64_t packets_dropped;
+    uint64_t bytes_dropped;
+    uint64_t packets_by_conformance[3]; // Indexed by scheduler::ConformanceLevel
+};
+
+/** @brief Depth and sojourn times of one scheduler queue (see scheduler::QueueStatsSample). */
+struct QueueStatsRecord {
+    uint64_t queue_id;
+    uint64_t packets_queued;
+    uint64_t bytes_queued;
+    uint64_t latency_samples;
+    uint64_t latency_mean_ns;
+    uint64_t latency_p50_ns;
+    uint64_t latency_p99_ns;
+    uint64_t latency_p999_ns;
+    uint64_t latency_max_ns;
+};
+
+/** @brief Counters of one data-path worker. */
+struct WorkerStatsRecord {
+    uint64_t packets_received;
+    uint64_t packets_dropped;
+    uint64_t packets_forwarded;
+    uint64_t active_flows; // Flows in the worker's FlowTable
+};
+
+/**
+ * @brief First bytes of a stats segment. Records follow at fixed offsets.
+ *
+ * `sequence` is a seqlock: odd while the writer is updating the segment, advanced by
+ * two per update. The arrays start at policies_offset, queues_offset and workers_offset
+ * bytes from the start of the segment and hold max_* records each, of which the first
+ * num_* are valid. All fields other than the counts and update_time_ns are fixed when
+ * the segment is created.
+ */
+struct StatsSegmentHeader {
+    uint64_t magic;
+    uint32_t layout_version;
+    uint32_t header_bytes;
+    uint64_t segment_bytes;
+    uint32_t max_policies;
+    uint32_t max_queues;
+    uint32_t max_workers;
+    uint32_t reserved;
+    uint64_t policies_offset;
+    uint64_t queues_offset;
+    uint64_t workers_offset;
+    std::atomic<uint64_t> sequence;
+    core::TimestampNs update_time_ns; // Writer's clock at the last update
+    uint32_t num_policies;
+    uint32_t num_queues;
+    uint32_t num_workers;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "The stats segment seqlock must be lock-free to be shared between processes");
+
+/**
+ * @brief A consistent copy of a stats segment's contents.
+ */
+struct StatsView {
+    uint64_t sequence = 0; // Seqlock value the copy was taken at; grows with every update
+    core::TimestampNs update_time_ns = 0;
+    std::vector<PolicyStatsRecord> policies;
+    std::vector<QueueStatsRecord> queues;
+    std::vector<WorkerStatsRecord> workers;
+};
+
+/**
+ * @brief Sizes of the record arrays of a stats segment.
+ */
+struct StatsSegmentLayout {
+    uint32_t max_policies = 1024;
+    uint32_t max_queues = 256;
+    uint32_t max_workers = 64;
+};
+
+/**
+ * @brief Writer side of a POSIX shared-memory stats segment (shm_open + mmap).
+ *
+ * One thread owns the writer and updates the whole segment at its own pace from
+ * counters it can read without disturbing the data path (PerCorePolicyStatistics,
+ * WorkerCounters, a scheduler's collect_queue_stats() on its owning thread). Readers
+ * in other processes map the segment read-only (StatsSegmentReader) and never block
+ * or slow the writer: an update is a seqlock-bracketed copy into the mapping, and a
+ * reader that overlapped one simply retries.
+ *
+ * The segment is unlinked when the writer is destroyed, unless another writer has
+ * replaced it by then; mapped readers keep their view of the last update.
+ */
+class StatsSegmentWriter {
+public:
+    /**
+     * @brief Creates the segment `name`.
+     *
+     * An existing segment of that name, e.g. one left behind by a writer that died, is
+     * unlinked first and a new one created exclusively: readers of the old segment keep
+     * their view of it and must reopen the name to see this writer.
+     *
+     * @param name POSIX shared-memory name, e.g. "/hqts-stats".
+     * @throws std::invalid_argument if a layout maximum is 0.
+     * @throws std::system_error if the segment cannot be created or mapped.
+     */
+    StatsSegmentWriter(const std::string& name, const StatsSegmentLayout& layout);
+
+    ~StatsSegmentWriter();
+
+    StatsSegmentWriter(const StatsSegmentWriter&) = delete;
+    StatsSegmentWriter& operator=(const StatsSegmentWriter&) = delete;
+
+    const std::string& name() const { return name_; }
+    const StatsSegmentLayout& layout() const { return layout_; }
+
+    /**
+     * @brief Publishes a complete set of records as one update.
+     *
+     * Records beyond the layout's maxima are left out.
+     */
+    void update(core::TimestampNs now_ns,
+                const std::vector<PolicyStatsRecord>& policies,
+                const std::vector<QueueStatsRecord>& queues,
+                const std::vector<WorkerStatsRecord>& workers);
+
+    /** @brief Number of update() calls so far. */
+    uint64_t updates() const { return updates_; }
+
+private:
+    std::string name_;
+    StatsSegmentLayout layout_;
+    void* mapping_ = nullptr;
+    size_t mapping_bytes_ = 0;
+    uint64_t segment_device_ = 0; // Identify the segment created, so the destructor
+    uint64_t segment_inode_ = 0;  // never unlinks one that replaced it
+    uint64_t updates_ = 0;
+};
+
+/**
+ * @brief Reader side of a stats segment; may live in any process.
+ */
+class StatsSegmentReader {
+public:
+    /**
+     * @brief Maps the segment `name` read-only.
+     * @throws std::system_error if the segment does not exist or cannot be mapped.
+     * @throws std::runtime_error if it is not a stats segment of this layout version, or
+     *         its header places a record array outside the segment.
+     */
+    explicit StatsSegmentReader(const std::string& name);
+
+    ~StatsSegmentReader();
+
+    StatsSegmentReader(const StatsSegmentReader&) = delete;
+    StatsSegmentReader& operator=(const StatsSegmentReader&) = delete;
+
+    /**
+     * @brief Copies the segment into `view` once no update overlaps the copy.
+     *
+     * Lock-free for the writer; retries while an update is in progress, at most
+     * `max_attempts` times.
+     *
+     * @return False if every attempt overlapped an update; `view` is then unspecified.
+     */
+    bool read(StatsView& view, unsigned max_attempts = 1000) const;
+
+private:
+    const void* mapping_ = nullptr;
+    size_t mapping_bytes_ = 0;
+};
+
+} // namespace monitor
+} // namespace hqts
+
+#endif // HQTS_MONITOR_STATS_SEGMENT_H_
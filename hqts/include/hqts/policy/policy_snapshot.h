@@ -0,0 +1,130 @@
+#ifndef HQTS_POLICY_POLICY_SNAPSHOT_H_
+#define HQTS_POLICY_POLICY_SNAPSHOT_H_
+
+#include "hqts/policy/policy_tree.h" // For PolicyTree
+#include "hqts/core/flow_context.h"  // For core::QueueId
+
+#include <chrono>
+#include <cstddef> // For size_t
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace hqts {
+namespace policy {
+
+/// PolicySnapshotHeader::magic: "HQTSPOLS" in little-endian byte order.
+constexpr uint64_t POLICY_SNAPSHOT_MAGIC = 0x534c4f5053545148ull;
+/// Bumped whenever the layout of the header or of a record changes.
+constexpr uint32_t POLICY_SNAPSHOT_FORMAT_VERSION = 1;
+
+/**
+ * @brief Configuration of one ShapingPolicy as stored in a snapshot file.
+ *
+ * Fixed size, so a mapped file is an array of records. Bucket state and statistics
+ * are not stored: buckets start full, as for a newly constructed policy.
+ */
+struct PolicySnapshotRecord {
+    uint64_t id;
+    uint64_t parent_id;
+    uint64_t committed_rate_bps;
+    uint64_t peak_rate_bps;
+    uint64_t committed_burst_bytes;
+    uint64_t excess_burst_bytes;
+    uint64_t max_shaping_delay_ns;
+    uint32_t name_offset; // Into the name table
+    uint32_t name_length;
+    uint32_t weight;
+    core::QueueId target_queue_id_green;
+    core::QueueId target_queue_id_yellow;
+    core::QueueId target_queue_id_red;
+    uint8_t algorithm;    // SchedulingAlgorithm
+    uint8_t priority_level;
+    uint8_t target_priority_green;
+    uint8_t target_priority_yellow;
+    uint8_t target_priority_red;
+    uint8_t drop_on_red;
+    uint8_t shape_to_cir;
+    uint8_t reserved;
+};
+
+/**
+ * @brief First bytes of a snapshot file.
+ *
+ * `count` records, sorted by strictly ascending id, start at records_offset; the
+ * names they refer to are packed, without terminators, in names_bytes bytes at
+ * names_offset. Multi-byte fields are in the writer's byte order.
+ */
+struct PolicySnapshotHeader {
+    uint64_t magic;
+    uint32_t format_version;
+    uint32_t record_bytes; // sizeof(PolicySnapshotRecord)
+    uint64_t count;
+    uint64_t records_offset;
+    uint64_t names_offset;
+    uint64_t names_bytes;
+};
+
+/**
+ * @brief A policy snapshot file mapped read-only.
+ *
+ * write() saves a PolicyTree's configuration in a compact binary form; constructing a
+ * PolicySnapshot maps the file and validates it in one linear pass, after which the
+ * records are read in place. to_tree() rebuilds a PolicyTree with bulk_insert(), and
+ * CompiledPolicies / RuntimePolicyTable compile the records directly, without a tree,
+ * so a restart with 100k+ policies costs a map and a few linear passes.
+ */
+class PolicySnapshot {
+public:
+    /**
+     * @brief Saves the configuration of every policy in `tree` to `path`.
+     *
+     * Written to a temporary file next to `path`, synced to disk and renamed over it,
+     * then the directory is synced: a reader, even after a crash, sees either the
+     * previous snapshot or the complete new one.
+     *
+     * @throws std::length_error if the names exceed the 4 GB name table.
+     * @throws std::system_error if the file cannot be written.
+     */
+    static void write(const PolicyTree& tree, const std::string& path);
+
+    /**
+     * @brief Maps and validates the snapshot file `path`.
+     * @throws std::system_error if the file cannot be opened or mapped.
+     * @throws std::runtime_error if it is not a valid snapshot of this format version.
+     */
+    explicit PolicySnapshot(const std::string& path);
+
+    ~PolicySnapshot();
+
+    PolicySnapshot(const PolicySnapshot&) = delete;
+    PolicySnapshot& operator=(const PolicySnapshot&) = delete;
+
+    size_t size() const { return count_; }
+
+    /** @brief Record `index`; records are sorted by ascending id. */
+    const PolicySnapshotRecord& operator[](size_t index) const { return records_[index]; }
+
+    /** @brief Name of record `index`, pointing into the mapping. */
+    std::string_view name(size_t index) const {
+        return std::string_view(names_ + records_[index].name_offset, records_[index].name_length);
+    }
+
+    /** @brief The ShapingPolicy record `index` was written from, stamped `last_updated`. */
+    core::ShapingPolicy to_policy(size_t index, std::chrono::steady_clock::time_point last_updated) const;
+
+    /** @brief A PolicyTree holding every policy of the snapshot, built with bulk_insert(). */
+    PolicyTree to_tree() const;
+
+private:
+    const void* mapping_ = nullptr;
+    size_t mapping_bytes_ = 0;
+    const PolicySnapshotRecord* records_ = nullptr;
+    const char* names_ = nullptr;
+    size_t count_ = 0;
+};
+
+} // namespace policy
+} // namespace hqts
+
+#endif // HQTS_POLICY_POLICY_SNAPSHOT_H_
@@ -8,7 +8,9 @@
 #include <boost/multi_index/ordered_index.hpp>
 #include <boost/multi_index/member.hpp>
 #include <boost/multi_index/tag.hpp>
+#include <cstddef> // For size_t
 #include <string> // For std::string in by_name index
+#include <vector>
 
 namespace hqts {
 namespace policy {
@@ -46,6 +48,19 @@ using PolicyTree = boost::multi_index::multi_index_container<
     >
 >;
 
+/**
+ * @brief Inserts many policies at once, e.g. at startup.
+ *
+ * The policies are sorted by id once and appended to the id index with an end hint,
+ * which costs amortized constant time per policy when their ids are above those
+ * already in the tree (always, for an empty tree) instead of a search per insert; the
+ * other indexes are updated as by insert(). A policy whose id is already in the tree,
+ * or repeats an earlier one in `policies`, is skipped, as insert() would.
+ *
+ * @return Number of policies inserted.
+ */
+size_t bulk_insert(PolicyTree& tree, std::vector<core::ShapingPolicy> policies);
+
 // Example Usage (Conceptual - actual management class would encapsulate this)
 /*
 void example_policy_tree_usage() {
@@ -0,0 +1,232 @@
+#ifndef HQTS_POLICY_RUNTIME_POLICY_TABLE_H_
+#define HQTS_POLICY_RUNTIME_POLICY_TABLE_H_
+
+#include "hqts/policy/policy_tree.h"   // For PolicyTree (the control-plane source)
+#include "hqts/policy/policy_snapshot.h" // For PolicySnapshot, PolicySnapshotRecord
+#include "hqts/core/token_bucket.h"    // For core::TokenBucket
+#include "hqts/core/flow_context.h"    // For core::QueueId
+#include "hqts/core/epoch_reclaimer.h" // For core::EpochReclaimer
+
+#include <atomic>
+#include <cstddef> // For size_t
+#include <cstdint>
+#include <memory>  // For std::unique_ptr
+#include <mutex>
+#include <vector>
+
+namespace hqts {
+namespace policy {
+
+/// RuntimePolicy::parent_index of a root policy.
+constexpr uint32_t NO_POLICY_INDEX = UINT32_MAX;
+
+/**
+ * @brief Data-path record of one ShapingPolicy: only what metering and marking touch.
+ *
+ * Names, children_ids and the scheduling parameters stay in the PolicyTree; a record
+ * is the bucket state, the colour-to-priority/queue mapping and the index of the
+ * parent record, padded to whole cache lines so neighbouring policies metered by
+ * different flows never share a line. Following parent_index from a leaf visits its
+ * ancestors in order, so charging the whole chain costs one record per level.
+ */
+struct alignas(64) RuntimePolicy {
+    core::TokenBucket cir_bucket;
+    core::TokenBucket pir_bucket;
+    PolicyId id;
+    uint32_t parent_index; // Record of the parent policy, NO_POLICY_INDEX for roots
+    core::QueueId target_queue_id_green;
+    core::QueueId target_queue_id_yellow;
+    core::QueueId target_queue_id_red;
+    core::TimestampNs max_shaping_delay_ns;
+    uint8_t target_priority_green;
+    uint8_t target_priority_yellow;
+    uint8_t target_priority_red;
+    bool drop_on_red;
+    bool shape_to_cir;
+    bool has_peak_rate;   // peak_rate_bps > 0: the PIR bucket caps an aggregate
+    uint32_t stats_slot;  // Slot in the metering shaper's PerCorePolicyStatistics, UINT32_MAX if none
+
+    explicit RuntimePolicy(const core::ShapingPolicy& policy);
+
+    /** @brief A record with full buckets configured as `record`. */
+    explicit RuntimePolicy(const PolicySnapshotRecord& record);
+
+    /** @brief True if both records' buckets are configured alike (rates and capacities). */
+    bool same_buckets(const RuntimePolicy& other) const;
+};
+
+/**
+ * @brief One compiled, immutable-layout snapshot of a PolicyTree.
+ *
+ * Records are stored densely, sorted by PolicyId; a parallel array of the ids keeps
+ * lookups to a binary search over a few cache lines. Only the buckets inside the
+ * records change after compilation, and only from the data path metering them.
+ */
+class CompiledPolicies {
+public:
+    /**
+     * @brief Compiles `tree` into a snapshot. Buckets are copied from the tree's
+     *        ShapingPolicy objects, so they start as configured there.
+     * @param version Version tag of the snapshot (see RuntimePolicyTable::version()).
+     * @throws std::invalid_argument if the parent links of `tree` form a cycle.
+     */
+    CompiledPolicies(const PolicyTree& tree, uint32_t version);
+
+    /**
+     * @brief Compiles the records of `snapshot` directly, without building a PolicyTree.
+     *        Buckets start full.
+     * @throws std::invalid_argument if the parent links form a cycle.
+     */
+    CompiledPolicies(const PolicySnapshot& snapshot, uint32_t version);
+
+    CompiledPolicies(const CompiledPolicies&) = delete;
+    CompiledPolicies& operator=(const CompiledPolicies&) = delete;
+
+    uint32_t version() const { return version_; }
+    size_t size() const { return records_.size(); }
+
+    /** @brief Index of the record of `id`, or NO_POLICY_INDEX if it was not compiled. */
+    uint32_t index_of(PolicyId id) const;
+
+    /** @brief The record of `id`, or nullptr if it was not compiled. */
+    RuntimePolicy* find(PolicyId id);
+
+    /**
+     * @brief Takes over the data-path state of `previous` for the policies both hold.
+     *
+     * Each record whose policy is in `previous` gets its stats_slot; if its buckets are
+     * also configured as there, it gets their state too, so a policy left unchanged by
+     * an update keeps metering where it was instead of starting from a full bucket. One
+     * merge over both id arrays: linear in the sizes of the two snapshots.
+     *
+     * Only the thread metering `previous` may call this, before metering this snapshot.
+     *
+     * @return Number of records whose buckets were carried over.
+     */
+    size_t carry_state_from(const CompiledPolicies& previous);
+
+    RuntimePolicy& operator[](uint32_t index) { return records_[index]; }
+    const RuntimePolicy& operator[](uint32_t index) const { return records_[index]; }
+
+private:
+    // Sets each record's parent_index from parent_ids (parallel to records_) and rejects cycles.
+    void link_parents(const std::vector<PolicyId>& parent_ids);
+
+    std::vector<PolicyId> ids_;          // ids_[i] == records_[i].id, ascending
+    std::vector<RuntimePolicy> records_;
+    uint32_t version_;
+};
+
+/**
+ * @brief Publishes compiled policy snapshots to the data path, RCU-style.
+ *
+ * The control plane compiles a new snapshot off to the side and swaps it in with
+ * publish(), one atomic pointer exchange; the data path polls version() (one atomic
+ * load) and moves to the new snapshot with refresh() only when the version changed.
+ * A replaced snapshot is retired, and freed by a later publish() or reclaim() once
+ * every registered reader has passed a quiescent point (refresh()) after the swap:
+ * epoch-based reclamation (core::EpochReclaimer), so neither side ever waits for the
+ * other and readers touch no lock and no reference count.
+ *
+ * Each snapshot's buckets are metered without synchronisation: one data-path thread
+ * per table, as with TrafficShaper. That thread carries bucket state over from the
+ * snapshot it leaves (CompiledPolicies::carry_state_from()), so an update restarts
+ * only the buckets of the policies it reconfigures.
+ */
+class RuntimePolicyTable {
+public:
+    /// Reader slots of a table (see register_reader()).
+    static constexpr size_t MAX_READERS = 16;
+
+    /** @brief Constructs a table publishing an empty snapshot. */
+    RuntimePolicyTable();
+
+    /** @brief Constructs a table publishing a snapshot of `tree`. */
+    explicit RuntimePolicyTable(const PolicyTree& tree);
+
+    /** @brief Constructs a table publishing the policies of a snapshot file. */
+    explicit RuntimePolicyTable(const PolicySnapshot& snapshot);
+
+    /** @brief Frees every snapshot; no reader may still hold one. */
+    ~RuntimePolicyTable();
+
+    RuntimePolicyTable(const RuntimePolicyTable&) = delete;
+    RuntimePolicyTable& operator=(const RuntimePolicyTable&) = delete;
+
+    /**
+     * @brief Compiles `tree` and swaps the snapshot in, then frees the retired snapshots
+     *        no reader can hold any more.
+     *
+     * The new snapshot's buckets start as configured in the tree; the metering thread
+     * carries the state of unchanged policies over when it picks the snapshot up.
+     *
+     * @return The version of the new snapshot.
+     * @throws std::invalid_argument as CompiledPolicies; the current snapshot is kept.
+     */
+    uint32_t publish(const PolicyTree& tree);
+
+    /** @brief publish() for the policies of a snapshot file, compiled without a tree. */
+    uint32_t publish(const PolicySnapshot& snapshot);
+
+    /** @brief Version of the latest snapshot; never 0, changes with every publish(). */
+    uint32_t version() const { return version_.load(std::memory_order_acquire); }
+
+    /**
+     * @brief The latest snapshot, for a caller that is not a registered reader: it stays
+     *        valid only until the next publish() or reclaim().
+     */
+    CompiledPolicies* current() const { return current_.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Registers a reader: snapshots it holds are not freed until it moves on.
+     * @throws std::length_error if MAX_READERS readers are registered.
+     */
+    size_t register_reader() { return epochs_.register_reader(); }
+
+    /** @brief Unregisters `reader`, which must no longer use any snapshot. */
+    void unregister_reader(size_t reader) { epochs_.unregister_reader(reader); }
+
+    /**
+     * @brief The latest snapshot for registered `reader`, which stops using `held`.
+     *
+     * A quiescent point: snapshots retired before this call may be freed once every
+     * other reader has passed one as well. If the latest snapshot is not `held`, it
+     * first takes over `held`'s bucket state (CompiledPolicies::carry_state_from()).
+     *
+     * @param held The snapshot the reader used so far, or nullptr. Only the metering
+     *             thread of `held` may pass it.
+     */
+    CompiledPolicies* refresh(size_t reader, CompiledPolicies* held);
+
+    /**
+     * @brief Frees the retired snapshots every registered reader has moved past.
+     * @return Number of snapshots freed.
+     */
+    size_t reclaim();
+
+    /** @brief Replaced snapshots not freed yet. */
+    size_t retired_snapshots() const;
+
+private:
+    struct RetiredSnapshot {
+        uint64_t epoch; // Freed once every reader has passed it
+        std::unique_ptr<CompiledPolicies> snapshot;
+    };
+
+    // With publish_mutex_ held: the version the next snapshot gets.
+    uint32_t next_version() const;
+    // With publish_mutex_ held: swaps `compiled` in and retires the snapshot it replaces.
+    uint32_t swap_in(std::unique_ptr<CompiledPolicies> compiled);
+    size_t reclaim_locked();
+
+    mutable std::mutex publish_mutex_; // Serializes publishers and reclaim(); guards retired_
+    std::atomic<CompiledPolicies*> current_;
+    std::atomic<uint32_t> version_;
+    core::EpochReclaimer epochs_;
+    std::vector<RetiredSnapshot> retired_;
+};
+
+} // namespace policy
+} // namespace hqts
+
+#endif // HQTS_POLICY_RUNTIME_POLICY_TABLE_H_
@@ -0,0 +1,166 @@
+#ifndef HQTS_SCHEDULER_ANY_AQM_QUEUE_H_
+#define HQTS_SCHEDULER_ANY_AQM_QUEUE_H_
+
+#include "hqts/scheduler/aqm_queue.h"   // For RedAqmQueue, RedAqmParameters
+#include "hqts/scheduler/codel_queue.h" // For CoDelQueue, FqCoDelQueue and their parameters
+#include "hqts/scheduler/latency_histogram.h" // For LatencyHistogram
+#include "hqts/scheduler/queue_stats.h" // For QueueStatsSample
+#include "hqts/core/time_source.h"      // For steady_now_ns
+
+#include <cstddef> // For size_t
+#include <cstdint>
+#include <memory>  // For std::shared_ptr, std::unique_ptr
+#include <type_traits> // For std::decay_t, std::is_same_v
+#include <utility> // For std::in_place_type, std::move
+#include <variant> // For std::variant, std::visit
+#include <vector>
+
+namespace hqts {
+namespace scheduler {
+
+/**
+ * @brief Configuration of one scheduler queue's AQM: RED/WRED, CoDel or FQ-CoDel.
+ *
+ * Converts implicitly from each parameter type, so queue configurations written for
+ * RedAqmParameters keep working.
+ */
+using AqmParameters = std::variant<RedAqmParameters, CoDelParameters, FqCoDelParameters>;
+
+/** @brief Physical byte capacity of the queue `params` describes. */
+inline uint32_t aqm_queue_capacity_bytes(const AqmParameters& params) {
+    return std::visit([](const auto& p) -> uint32_t {
+        using P = std::decay_t<decltype(p)>;
+        if constexpr (std::is_same_v<P, RedAqmParameters>) {
+            return p.queue_capacity_bytes;
+        } else if constexpr (std::is_same_v<P, CoDelParameters>) {
+            return p.queue_capacity_bytes;
+        } else {
+            return p.codel.queue_capacity_bytes;
+        }
+    }, params);
+}
+
+/** @brief Wraps each RedAqmParameters of `red_params` as AqmParameters. */
+inline std::vector<AqmParameters> to_aqm_parameters(const std::vector<RedAqmParameters>& red_params) {
+    return std::vector<AqmParameters>(red_params.begin(), red_params.end());
+}
+
+/**
+ * @brief A scheduler queue with whichever AQM its AqmParameters select.
+ *
+ * Holds the queue by value (no allocation, no virtual calls); each operation is one
+ * switch on the AQM kind. Exposes the surface the schedulers use, which the three
+ * queue types share. For CoDel queues dequeue() may drop packets queued ahead of the one
+ * it returns, so callers tracking packet counts should re-read get_current_packet_count().
+ *
+ * With enable_latency_histogram(), every enqueued packet is stamped with
+ * PacketDescriptor::enqueue_time_ns and every dequeue records its sojourn time; both
+ * read steady_now_ns() once, which CoDel then reuses instead of reading the clock itself.
+ * Without it the queue reads no clock beyond what its AQM needs.
+ */
+class AqmQueue {
+public:
+    explicit AqmQueue(const AqmParameters& params,
+                      std::shared_ptr<PacketDescriptorPool> descriptor_pool = nullptr)
+        : queue_(make_queue(params, std::move(descriptor_pool))) {}
+
+    AqmQueue(AqmQueue&&) = default;
+    AqmQueue& operator=(AqmQueue&&) = default;
+
+    bool enqueue(PacketDescriptor packet) {
+        if (latency_) {
+            core::TimestampNs now_ns = core::steady_now_ns();
+            packet.enqueue_time_ns = now_ns;
+            return std::visit([&](auto& queue) {
+                if constexpr (std::is_same_v<std::decay_t<decltype(queue)>, RedAqmQueue>) {
+                    return queue.enqueue(packet);
+                } else {
+                    return queue.enqueue(packet, now_ns);
+                }
+            }, queue_);
+        }
+        return std::visit([&](auto& queue) { return queue.enqueue(packet); }, queue_);
+    }
+
+    PacketDescriptor dequeue() {
+        if (latency_) {
+            core::TimestampNs now_ns = core::steady_now_ns();
+            PacketDescriptor packet = std::visit([&](auto& queue) {
+                if constexpr (std::is_same_v<std::decay_t<decltype(queue)>, RedAqmQueue>) {
+                    return queue.dequeue();
+                } else {
+                    return queue.dequeue(now_ns);
+                }
+            }, queue_);
+            latency_->record(now_ns > packet.enqueue_time_ns ? now_ns - packet.enqueue_time_ns : 0);
+            return packet;
+        }
+        return std::visit([](auto& queue) { return queue.dequeue(); }, queue_);
+    }
+
+    /**
+     * @brief Starts recording the sojourn time of every packet dequeued from now on.
+     *
+     * Packets already queued count from the time they were stamped, if ever. Call from
+     * the thread that owns the queue; no effect if already enabled.
+     */
+    void enable_latency_histogram() {
+        if (!latency_) {
+            latency_ = std::make_unique<LatencyHistogram>();
+        }
+    }
+
+    /** @brief The sojourn-time histogram, or nullptr if it was never enabled. */
+    const LatencyHistogram* latency_histogram() const { return latency_.get(); }
+
+    /** @brief The queue's depth and latency summary, reported as queue `queue_id`. */
+    QueueStatsSample stats_sample(uint64_t queue_id) const {
+        QueueStatsSample sample;
+        sample.queue_id = queue_id;
+        sample.packets_queued = get_current_packet_count();
+        sample.bytes_queued = get_current_byte_size();
+        fill_latency_fields(sample, latency_.get());
+        return sample;
+    }
+
+    bool is_empty() const {
+        return std::visit([](const auto& queue) { return queue.is_empty(); }, queue_);
+    }
+
+    size_t get_current_packet_count() const {
+        return std::visit([](const auto& queue) { return queue.get_current_packet_count(); }, queue_);
+    }
+
+    uint32_t get_current_byte_size() const {
+        return std::visit([](const auto& queue) { return queue.get_current_byte_size(); }, queue_);
+    }
+
+    const PacketDescriptor& front() const {
+        return std::visit([](const auto& queue) -> const PacketDescriptor& { return queue.front(); }, queue_);
+    }
+
+    /** @brief The underlying queue if it is of type Q, else nullptr. */
+    template <typename Q>
+    const Q* get_if() const { return std::get_if<Q>(&queue_); }
+
+private:
+    using QueueVariant = std::variant<RedAqmQueue, CoDelQueue, FqCoDelQueue>;
+
+    static QueueVariant make_queue(const AqmParameters& params, std::shared_ptr<PacketDescriptorPool> pool) {
+        if (const auto* red = std::get_if<RedAqmParameters>(&params)) {
+            return QueueVariant(std::in_place_type<RedAqmQueue>, *red, std::move(pool));
+        }
+        if (const auto* codel = std::get_if<CoDelParameters>(&params)) {
+            return QueueVariant(std::in_place_type<CoDelQueue>, *codel, std::move(pool));
+        }
+        return QueueVariant(std::in_place_type<FqCoDelQueue>, std::get<FqCoDelParameters>(params), std::move(pool));
+    }
+
+    QueueVariant queue_;
+    std::unique_ptr<LatencyHistogram> latency_; // Optional, see enable_latency_histogram()
+};
+
+} // namespace scheduler
+} // namespace hqts
+
+#endif // HQTS_SCHEDULER_ANY_AQM_QUEUE_H_
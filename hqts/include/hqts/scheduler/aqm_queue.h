@@ -2,25 +2,41 @@
 #define HQTS_SCHEDULER_AQM_QUEUE_H_
 
 #include "hqts/scheduler/packet_descriptor.h"
-#include "hqts/scheduler/queue_types.h" // For PacketQueue (std::queue<PacketDescriptor>)
+#include "hqts/scheduler/queue_types.h" // For PacketQueue (intrusive FIFO over a PacketDescriptorPool)
 #include <cstdint>
-#include <deque> // std::deque is often more suitable for average queue size tracking than std::queue
+#include <memory> // For std::shared_ptr
 #include <string> // For potential error messages
 #include <stdexcept> // For exceptions
-#include <chrono> // For time if needed for EWMA weight calculation or stats
-#include <random> // For std::mt19937, std::uniform_real_distribution
+#include <array>  // For per-color drop profiles
+#include <cstddef> // For size_t
 
 namespace hqts {
 namespace scheduler {
 
+// Early-drop thresholds applied to packets of one conformance color.
+struct RedDropProfile {
+    uint32_t min_threshold_bytes = 0; // Average queue size below which no packet is dropped early
+    uint32_t max_threshold_bytes = 0; // Average queue size at which drop probability reaches max_probability
+    double max_probability = 0.0;
+};
+
 // Parameters for RED AQM
 struct RedAqmParameters {
+    static constexpr size_t COLOR_COUNT = 3; // One RedDropProfile per ConformanceLevel
+    static constexpr uint64_t DEFAULT_RANDOM_SEED = 0x9E3779B97F4A7C15ULL;
+
     uint32_t min_threshold_bytes;  // Minimum average queue size before any drops
     uint32_t max_threshold_bytes;  // Average queue size at which drop probability reaches max_p
     double max_probability;        // Maximum drop probability (e.g., 0.1 for 10%)
-    double ewma_weight;            // Weight for EWMA average queue size calculation (e.g., 0.002)
+    double ewma_weight;            // Weight for EWMA average queue size calculation (e.g., 0.002);
+                                   // applied as the nearest power of two 2^-n
     uint32_t queue_capacity_bytes; // Physical capacity of the queue
 
+    // WRED: thresholds per ConformanceLevel, indexed by its value. All three start out as
+    // the thresholds above (plain RED); set_color_profile() gives a color its own.
+    std::array<RedDropProfile, COLOR_COUNT> color_profiles;
+    uint64_t random_seed = DEFAULT_RANDOM_SEED; // Seed of the queue's drop-decision generator
+
     // Constructor for sensible defaults or specific settings
     RedAqmParameters(uint32_t min_t, uint32_t max_t, double max_p, double weight, uint32_t capacity)
         : min_threshold_bytes(min_t), max_threshold_bytes(max_t),
@@ -29,6 +45,24 @@ struct RedAqmParameters {
             // Consider more specific error messages for each condition if desired
             throw std::invalid_argument("Invalid RED AQM parameters provided to constructor.");
         }
+        color_profiles.fill(RedDropProfile{min_t, max_t, max_p});
+    }
+
+    /**
+     * @brief Gives packets of one color their own thresholds (WRED), typically lower ones
+     *        for YELLOW and RED so that out-of-profile traffic is dropped first.
+     * @throws std::invalid_argument under the same rules as the constructor's thresholds.
+     */
+    RedAqmParameters& set_color_profile(ConformanceLevel color, uint32_t min_t, uint32_t max_t, double max_p) {
+        if (min_t == 0 || min_t >= max_t || max_t > queue_capacity_bytes || max_p <= 0.0 || max_p > 1.0) {
+            throw std::invalid_argument("Invalid WRED color profile provided to set_color_profile.");
+        }
+        color_profiles[static_cast<size_t>(color)] = RedDropProfile{min_t, max_t, max_p};
+        return *this;
+    }
+
+    const RedDropProfile& profile_for(ConformanceLevel color) const {
+        return color_profiles[static_cast<size_t>(color)];
     }
 };
 
@@ -37,10 +71,23 @@ struct RedAqmParameters {
 
 class RedAqmQueue {
 public:
-    explicit RedAqmQueue(const RedAqmParameters& params);
+    /**
+     * @brief Constructs a RED queue.
+     * @param params RED parameters.
+     * @param descriptor_pool Pool shared with other queues that packet descriptors are
+     *        drawn from. If null, the queue creates a private pool with one descriptor per
+     *        PacketDescriptorPool::DEFAULT_MIN_PACKET_BYTES of queue_capacity_bytes, as the
+     *        schedulers do. An enqueue finding the pool exhausted (e.g. by runts) is tail-dropped.
+     */
+    explicit RedAqmQueue(const RedAqmParameters& params,
+                         std::shared_ptr<PacketDescriptorPool> descriptor_pool = nullptr);
+
+    RedAqmQueue(RedAqmQueue&&) = default;
+    RedAqmQueue& operator=(RedAqmQueue&&) = default;
 
     // Attempts to enqueue a packet. Returns true on success, false if dropped by RED or if queue is at physical capacity.
-    // The packet is consumed (moved or copied) only if successfully enqueued.
+    // A dropped packet's payload buffer (if any) is released back to its pool; the caller
+    // must not use the buffer handle after a false return.
     bool enqueue(PacketDescriptor packet);
 
     // Dequeues a packet. Throws std::runtime_error if empty.
@@ -58,6 +105,9 @@ public:
     // Returns the current calculated average queue size in bytes.
     double get_average_queue_size_bytes() const;
 
+    // Returns n for the EWMA weight 2^-n actually applied (ewma_weight rounded to a power of two).
+    unsigned get_ewma_weight_shift() const { return ewma_shift_; }
+
     // Gets the configured RED parameters.
     const RedAqmParameters& get_parameters() const;
 
@@ -65,36 +115,41 @@ public:
     const PacketDescriptor& front() const;
 
 private:
-    // Calculates the current drop probability based on average queue size.
-    double calculate_drop_probability() const;
-
-    // Updates the EWMA average queue size.
-    // Takes current physical queue size in bytes.
-    // 'queue_was_idle' helps in one EWMA variant: avg = (1-w) * avg + w * current OR avg = current if idle.
-    // For RED, typically avg = (1-w)*avg + w*current_physical_size always when queue is sampled (e.g. on packet arrival).
+    // Fixed-point scales: the average is kept in 1/2^AVG_SHIFT bytes, probabilities in
+    // 1/2^32 (PROBABILITY_ONE is 1.0), so a drop decision needs no floating point.
+    static constexpr unsigned AVG_SHIFT = 16;
+    static constexpr uint64_t PROBABILITY_ONE = uint64_t{1} << 32;
+
+    // A RedDropProfile in the units the per-packet path works in, computed once.
+    struct CompiledProfile {
+        uint64_t min_avg = 0;     // min_threshold_bytes << AVG_SHIFT
+        uint64_t max_avg = 0;     // max_threshold_bytes << AVG_SHIFT
+        uint64_t max_p = 0;       // max_probability * PROBABILITY_ONE
+        uint64_t p_per_avg = 0;   // Probability gained per average unit above min_avg, << 32
+    };
+
+    // Updates the EWMA average queue size from the current physical queue size in bytes.
+    // RED samples it as seen by an arriving packet and again after each departure.
     void update_average_queue_size();
 
+    // Decides whether an arriving packet of the given profile is dropped early.
+    bool early_drop(const CompiledProfile& profile);
+
+    // xorshift64*: a uniform 32-bit value for the drop decision.
+    uint32_t next_random();
 
-    std::deque<PacketDescriptor> packet_buffer_; // Using std::deque for efficient front/back access
+    PacketQueue packet_buffer_; // Intrusive FIFO; nodes live in the (possibly shared) descriptor pool
     RedAqmParameters params_;
-    double average_queue_size_bytes_ = 0.0;
+    std::array<CompiledProfile, RedAqmParameters::COLOR_COUNT> profiles_;
+    unsigned ewma_shift_ = 0;
+    uint64_t average_queue_size_ = 0;  // In 1/2^AVG_SHIFT bytes
     uint32_t current_total_bytes_ = 0; // Current actual total bytes in queue
 
     // For RED's count since last drop (used to smooth drop probability over time)
     // This makes RED less bursty in its drops.
-    int packets_since_last_drop_ = 0;
-
-    // Random number generation for probabilistic drop (to be added in .cpp)
-    // Needs to be mutable if used in const calculate_drop_probability, or make that non-const.
-    // For now, keep calculate_drop_probability const, implying random generation is handled carefully.
-    // A common approach is to have a non-const "should_drop_packet" method that uses it.
-    // Or, pass a random generator reference.
-    // For simplicity in header, we omit its declaration here, will be in .cpp.
-    // mutable std::mt19937 random_generator_;  // Now declared below
-    // mutable std::uniform_real_distribution<double> probability_distribution_; // Now declared below
-
-    std::mt19937 random_generator_;
-    std::uniform_real_distribution<double> probability_distribution_;
+    uint32_t packets_since_last_drop_ = 0;
+
+    uint64_t random_state_;
 };
 
 } // namespace scheduler
@@ -0,0 +1,217 @@
+#ifndef HQTS_SCHEDULER_CODEL_QUEUE_H_
+#define HQTS_SCHEDULER_CODEL_QUEUE_H_
+
+#include "hqts/scheduler/packet_descriptor.h"
+#include "hqts/scheduler/queue_types.h" // For PacketQueue (intrusive FIFO over a PacketDescriptorPool)
+#include "hqts/core/time_source.h"      // For core::TimestampNs
+
+#include <cstddef> // For size_t
+#include <cstdint>
+#include <memory>  // For std::shared_ptr
+#include <stdexcept> // For std::invalid_argument
+#include <vector>
+
+namespace hqts {
+namespace scheduler {
+
+// Parameters for CoDel (RFC 8289). The defaults suit links from 1 Mbps up; unlike RED
+// thresholds they rarely need per-link tuning.
+struct CoDelParameters {
+    static constexpr core::TimestampNs DEFAULT_TARGET_NS = 5000000;     // 5 ms
+    static constexpr core::TimestampNs DEFAULT_INTERVAL_NS = 100000000; // 100 ms
+
+    uint32_t queue_capacity_bytes;  // Physical capacity of the queue (tail drop beyond)
+    core::TimestampNs target_ns;    // Acceptable standing queue delay
+    core::TimestampNs interval_ns;  // Window over which the delay must stay above target
+
+    CoDelParameters(uint32_t capacity, core::TimestampNs target = DEFAULT_TARGET_NS,
+                    core::TimestampNs interval = DEFAULT_INTERVAL_NS)
+        : queue_capacity_bytes(capacity), target_ns(target), interval_ns(interval) {
+        if (capacity == 0 || target == 0 || interval == 0 || target >= interval || interval > (1ULL << 32)) {
+            throw std::invalid_argument("Invalid CoDel parameters provided to constructor.");
+        }
+    }
+};
+
+/**
+ * @brief Per-queue CoDel state machine: decides at dequeue time which head packets to
+ *        drop because their sojourn time stayed above target for an interval.
+ *
+ * Shared by CoDelQueue and the sub-queues of FqCoDelQueue. Drops follow the control
+ * law interval / sqrt(count), with 1/sqrt(count) kept in Q0.32 fixed point and
+ * refined by one Newton step per drop, so the drop path has no division or sqrt.
+ */
+class CoDelControl {
+public:
+    /**
+     * @brief Removes the next packet to transmit from `fifo`, dropping (and releasing
+     *        the buffers of) head packets as the control law requires.
+     *
+     * Never drops the last packet: a drop needs more than max_packet_bytes still queued,
+     * so a non-empty fifo always yields a packet. Precondition: !fifo.empty().
+     *
+     * @param queue_bytes Bytes queued in `fifo`; updated for every packet removed.
+     * @param dropped Incremented once per packet dropped.
+     */
+    PacketDescriptor dequeue(PacketQueue& fifo, uint32_t& queue_bytes, core::TimestampNs now_ns,
+                             const CoDelParameters& params, uint32_t max_packet_bytes, uint64_t& dropped);
+
+    bool is_dropping() const { return dropping_; }
+    uint32_t drop_count() const { return count_; }
+
+private:
+    // Removes the head packet and reports whether its sojourn time allows a drop.
+    PacketDescriptor pop_head(PacketQueue& fifo, uint32_t& queue_bytes, core::TimestampNs now_ns,
+                              const CoDelParameters& params, uint32_t max_packet_bytes, bool& ok_to_drop);
+    core::TimestampNs control_law(core::TimestampNs t, const CoDelParameters& params) const;
+    void newton_step();
+
+    core::TimestampNs first_above_time_ns_ = 0; // 0: sojourn time below target
+    core::TimestampNs drop_next_ns_ = 0;
+    uint32_t count_ = 0;      // Drops in the current dropping state
+    uint32_t last_count_ = 0;
+    uint64_t rec_inv_sqrt_ = 0; // 1/sqrt(count_) in Q0.32
+    bool dropping_ = false;
+};
+
+/**
+ * @brief FIFO managed by CoDel. Same enqueue/dequeue/byte-count surface as RedAqmQueue.
+ *
+ * Packets are stamped with their enqueue time (PacketDescriptor::enqueue_time_ns); at
+ * dequeue, CoDel drops from the head while the sojourn time has stayed above
+ * target_ns for interval_ns. The overloads without a timestamp read steady_now_ns().
+ */
+class CoDelQueue {
+public:
+    /**
+     * @param descriptor_pool Pool shared with other queues; if null, a private pool with
+     *        one descriptor per DEFAULT_MIN_PACKET_BYTES of queue_capacity_bytes is created
+     *        (as RedAqmQueue).
+     */
+    explicit CoDelQueue(const CoDelParameters& params,
+                        std::shared_ptr<PacketDescriptorPool> descriptor_pool = nullptr);
+
+    CoDelQueue(CoDelQueue&&) = default;
+    CoDelQueue& operator=(CoDelQueue&&) = default;
+
+    // Returns false (releasing the packet's buffer) if the queue or descriptor pool is full.
+    bool enqueue(PacketDescriptor packet);
+    bool enqueue(PacketDescriptor packet, core::TimestampNs now_ns);
+
+    // Dequeues the next packet, possibly dropping older ones. Throws std::runtime_error if empty.
+    PacketDescriptor dequeue();
+    PacketDescriptor dequeue(core::TimestampNs now_ns);
+
+    bool is_empty() const { return packet_buffer_.empty(); }
+    size_t get_current_packet_count() const { return packet_buffer_.size(); }
+    uint32_t get_current_byte_size() const { return current_total_bytes_; }
+    uint64_t get_dropped_packet_count() const { return dropped_packets_; }
+    const CoDelParameters& get_parameters() const { return params_; }
+    const CoDelControl& control() const { return control_; }
+
+    // Peeks at the front packet without removing it. Throws std::runtime_error if empty.
+    const PacketDescriptor& front() const;
+
+private:
+    PacketQueue packet_buffer_;
+    CoDelParameters params_;
+    CoDelControl control_;
+    uint32_t current_total_bytes_ = 0;
+    uint32_t max_packet_bytes_ = 0; // Largest packet seen; a queue this small is never dropped from
+    uint64_t dropped_packets_ = 0;  // CoDel drops plus tail drops
+};
+
+// Parameters for FQ-CoDel (RFC 8290).
+struct FqCoDelParameters {
+    static constexpr uint32_t DEFAULT_FLOW_QUEUES = 1024;
+    static constexpr uint32_t DEFAULT_QUANTUM_BYTES = 1514;
+
+    CoDelParameters codel;     // Applied to every flow queue; capacity is the total
+    uint32_t flow_queues;      // Sub-queues flows are hashed to
+    uint32_t quantum_bytes;    // Bytes a flow queue may send per round
+
+    explicit FqCoDelParameters(const CoDelParameters& codel_params, uint32_t flows = DEFAULT_FLOW_QUEUES,
+                               uint32_t quantum = DEFAULT_QUANTUM_BYTES)
+        : codel(codel_params), flow_queues(flows), quantum_bytes(quantum) {
+        if (flows == 0 || quantum == 0) {
+            throw std::invalid_argument("Invalid FQ-CoDel parameters provided to constructor.");
+        }
+    }
+};
+
+/**
+ * @brief Flow-queuing CoDel: flows are hashed by flow_id to sub-queues, each managed by
+ *        CoDel and served by deficit round robin, with newly active flows served first.
+ *
+ * Same surface as CoDelQueue. The sub-queue the next dequeue() serves is selected as
+ * soon as the queue changes, so front() is the packet dequeue() returns unless CoDel
+ * drops it. When the queue is full, the arriving packet is accepted and the head of the
+ * longest sub-queue is dropped instead, so that a single flow cannot starve the rest.
+ */
+class FqCoDelQueue {
+public:
+    /**
+     * @param descriptor_pool Pool shared with other queues; if null, a private pool with
+     *        one descriptor per DEFAULT_MIN_PACKET_BYTES of the total capacity is created.
+     */
+    explicit FqCoDelQueue(const FqCoDelParameters& params,
+                          std::shared_ptr<PacketDescriptorPool> descriptor_pool = nullptr);
+
+    FqCoDelQueue(FqCoDelQueue&&) = default;
+    FqCoDelQueue& operator=(FqCoDelQueue&&) = default;
+
+    bool enqueue(PacketDescriptor packet);
+    bool enqueue(PacketDescriptor packet, core::TimestampNs now_ns);
+
+    PacketDescriptor dequeue();
+    PacketDescriptor dequeue(core::TimestampNs now_ns);
+
+    bool is_empty() const { return total_packets_ == 0; }
+    size_t get_current_packet_count() const { return total_packets_; }
+    uint32_t get_current_byte_size() const { return current_total_bytes_; }
+    uint64_t get_dropped_packet_count() const { return dropped_packets_; }
+    const FqCoDelParameters& get_parameters() const { return params_; }
+
+    /** @brief The sub-queue packets of `flow_id` are hashed to. */
+    size_t flow_queue_index(core::FlowId flow_id) const;
+
+    const PacketDescriptor& front() const;
+
+private:
+    static constexpr uint32_t NO_FLOW = UINT32_MAX;
+
+    struct FlowQueue {
+        PacketQueue packets;
+        CoDelControl control;
+        uint32_t bytes = 0;
+        int64_t deficit = 0;
+        uint32_t next = NO_FLOW;
+        uint8_t list = 0; // Which list the queue is linked into (NONE, NEW_FLOWS or OLD_FLOWS)
+    };
+
+    struct FlowList {
+        uint32_t head = NO_FLOW;
+        uint32_t tail = NO_FLOW;
+        bool empty() const { return head == NO_FLOW; }
+    };
+
+    void push_tail(FlowList& list, uint8_t list_id, uint32_t index);
+    uint32_t pop_head(FlowList& list);
+    // Rotates the lists until the head queue has packets and a positive deficit.
+    void select_next();
+    void drop_from_longest();
+
+    FqCoDelParameters params_;
+    std::vector<FlowQueue> flows_;
+    FlowList new_flows_;
+    FlowList old_flows_;
+    size_t total_packets_ = 0;
+    uint32_t current_total_bytes_ = 0;
+    uint32_t max_packet_bytes_ = 0;
+    uint64_t dropped_packets_ = 0;
+};
+
+} // namespace scheduler
+} // namespace hqts
+
+#endif // HQTS_SCHEDULER_CODEL_QUEUE_H_
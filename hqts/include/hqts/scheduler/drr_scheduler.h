@@ -3,9 +3,10 @@
 
 #include "hqts/scheduler/scheduler_interface.h"
 // #include "hqts/scheduler/queue_types.h" // No longer directly used for PacketQueue
-#include "hqts/scheduler/aqm_queue.h"     // For RedAqmQueue and RedAqmParameters
+#include "hqts/scheduler/any_aqm_queue.h" // For AqmQueue and AqmParameters (RED, CoDel, FQ-CoDel)
 #include "hqts/core/flow_context.h"     // For core::QueueId
 
+#include <array>
 #include <vector>
 #include <map>
 #include <stdexcept> // For std::out_of_range, std::invalid_argument, std::runtime_error, std::logic_error
@@ -19,10 +20,17 @@ namespace scheduler {
  * @brief Implements a Deficit Round Robin (DRR) Scheduler.
  *
  * This scheduler serves a configured set of queues. Each queue has a quantum (in bytes).
- * Queues are visited in a round-robin fashion. When a queue is visited, its deficit
- * counter is incremented by its quantum. It can then send packets as long as its
- * deficit is sufficient for the packet size. The deficit is reduced by the size of
- * each sent packet.
+ * Only backlogged queues are visited: they sit in a FIFO active list (Shreedhar and
+ * Varghese). At the start of its turn the queue at the head of the list has its
+ * deficit counter incremented by its quantum; it then sends packets, one per
+ * dequeue() call, as long as its deficit covers the front packet. When the deficit
+ * no longer covers the front packet the queue moves to the tail of the list, keeping
+ * its deficit for the next round. A queue that empties leaves the list and its deficit
+ * is reset, so idle queues cannot hoard credit.
+ *
+ * Empty queues are never visited, so dequeue() is O(1) amortized regardless of the
+ * number of configured queues (as long as quanta are at least the maximum packet size,
+ * a turn never ends without sending).
  *
  * Note: For this implementation, PacketDescriptor::priority is used as the
  * core::QueueId to determine which queue to enqueue into. This is a simplification.
@@ -32,19 +40,22 @@ public:
     struct QueueConfig {
         core::QueueId id;        // User-defined ID for the queue
         uint32_t quantum_bytes; // Quantum in bytes for this queue (must be > 0)
-        RedAqmParameters aqm_params; // AQM parameters for this queue
+        AqmParameters aqm_params; // AQM parameters for this queue (RED/WRED, CoDel or FQ-CoDel)
 
         // Updated constructor
-        QueueConfig(core::QueueId q_id, uint32_t q_bytes, RedAqmParameters aqm_p)
+        QueueConfig(core::QueueId q_id, uint32_t q_bytes, AqmParameters aqm_p)
             : id(q_id), quantum_bytes(q_bytes), aqm_params(std::move(aqm_p)) {}
     };
 
     /**
      * @brief Constructs a DrrScheduler.
      * @param queue_configs A vector of QueueConfig structs.
+     * @param descriptor_pool Optional pool shared by all queues (and possibly other schedulers).
+     *                        If null, one is sized from the queues' aggregate queue_capacity_bytes.
      * @throws std::invalid_argument if queue_configs is empty or any queue has quantum_bytes = 0 or duplicate IDs.
      */
-    explicit DrrScheduler(const std::vector<QueueConfig>& queue_configs);
+    explicit DrrScheduler(const std::vector<QueueConfig>& queue_configs,
+                          std::shared_ptr<PacketDescriptorPool> descriptor_pool = nullptr);
 
     ~DrrScheduler() override = default;
 
@@ -56,66 +67,101 @@ public:
     /**
      * @brief Enqueues a packet. PacketDescriptor::priority is used as core::QueueId.
      * @param packet The packet to enqueue.
-     * @throws std::logic_error if scheduler is not configured.
-     * @throws std::out_of_range if packet.priority (as QueueId) is not a configured queue.
+     * @return DROPPED_NO_QUEUE if packet.priority (as QueueId) is not a configured queue,
+     *         DROPPED_BY_QUEUE if the queue's AQM refused it, else ENQUEUED.
      */
-    void enqueue(PacketDescriptor packet) override;
+    EnqueueResult enqueue(PacketDescriptor packet) override;
 
     /**
      * @brief Dequeues a packet according to DRR discipline.
-     * @return The dequeued PacketDescriptor.
-     * @throws std::runtime_error if the scheduler is empty.
-     * @throws std::logic_error if scheduler is not configured or in an inconsistent state.
+     * @return The dequeued PacketDescriptor, or std::nullopt if the scheduler is empty.
      */
-    PacketDescriptor dequeue() override;
+    std::optional<PacketDescriptor> try_dequeue() override;
 
     /**
      * @brief Checks if the scheduler is empty.
      * @return True if all queues are empty, false otherwise.
-     * @throws std::logic_error if scheduler is not configured.
      */
     bool is_empty() const override;
 
+    /**
+     * @brief Enqueues a burst of packets with a single virtual dispatch.
+     * @see SchedulerInterface::enqueue_burst
+     */
+    size_t enqueue_burst(PacketDescriptor* packets, size_t count) override;
+
+    /**
+     * @brief Dequeues up to max_packets packets with a single virtual dispatch.
+     * @see SchedulerInterface::dequeue_burst
+     */
+    size_t dequeue_burst(std::vector<PacketDescriptor>& out, size_t max_packets) override;
+
     /**
      * @brief Gets the current number of packets in a specific queue.
      * @param queue_id The external ID of the queue.
      * @return The number of packets in that queue.
      * @throws std::out_of_range if queue_id is not a configured queue.
-     * @throws std::logic_error if scheduler is not configured.
      */
     size_t get_queue_size(core::QueueId queue_id) const;
 
+    /**
+     * @brief Starts recording the sojourn time of every packet in every queue
+     *        (see AqmQueue::enable_latency_histogram()). Call from the thread that owns
+     *        the scheduler; costs one clock read per enqueue and per dequeue.
+     */
+    void enable_latency_histograms();
+
+    /**
+     * @brief Snapshot of a queue's sojourn-time histogram; empty until
+     *        enable_latency_histograms() is called. Callable from any thread.
+     * @throws std::out_of_range if queue_id is not a configured queue.
+     */
+    LatencySnapshot get_queue_latency(core::QueueId queue_id) const;
+
+    /**
+     * @brief Appends one sample per configured queue, keyed by its QueueId.
+     * @see SchedulerInterface::collect_queue_stats
+     */
+    size_t collect_queue_stats(std::vector<QueueStatsSample>& out) const override;
+
     /**
      * @brief Gets the number of configured queues.
      * @return The number of queues.
-     * @throws std::logic_error if scheduler is not configured.
      */
     size_t get_num_queues() const;
 
 private:
     struct InternalQueueState {
-        RedAqmQueue packet_queue; // Changed type
+        AqmQueue packet_queue;
         uint32_t quantum_bytes;
         int64_t deficit_counter;
         core::QueueId external_id;
+        size_t next_active;     // Next queue in the active list (NO_QUEUE at the tail)
+        bool is_active;         // Queue is backlogged and linked into the active list
+        bool quantum_granted;   // Quantum already added for the current turn
 
         // Updated constructor
-        InternalQueueState(core::QueueId ext_id, uint32_t q_bytes, const RedAqmParameters& aqm_p)
-            : packet_queue(aqm_p), quantum_bytes(q_bytes), deficit_counter(0), external_id(ext_id) {}
+        InternalQueueState(core::QueueId ext_id, uint32_t q_bytes, const AqmParameters& aqm_p,
+                           std::shared_ptr<PacketDescriptorPool> pool)
+            : packet_queue(aqm_p, std::move(pool)), quantum_bytes(q_bytes), deficit_counter(0), external_id(ext_id),
+              next_active(NO_QUEUE), is_active(false), quantum_granted(false) {}
     };
 
+    static constexpr size_t NO_QUEUE = static_cast<size_t>(-1);
+
+    /// Appends a queue that just became backlogged to the tail of the active list.
+    void push_active(size_t internal_idx);
+    /// Unlinks the queue at the head of the active list.
+    size_t pop_active();
+
     std::vector<InternalQueueState> queues_;
     std::map<core::QueueId, size_t> queue_id_to_index_;
+    std::array<size_t, 256> index_by_priority_; // Queues with ids 0..255, NO_QUEUE elsewhere
 
-    size_t current_queue_index_ = 0; // Index for the next queue to consider in the round-robin scheme
+    // Intrusive FIFO of backlogged queues, linked through InternalQueueState::next_active.
+    size_t active_head_ = NO_QUEUE;
+    size_t active_tail_ = NO_QUEUE;
     size_t total_packets_ = 0;
-    bool is_configured_ = false;
-
-    // Optional: To keep track of queues that are non-empty and thus part of the "active round".
-    // This can optimize dequeue by not iterating over empty queues repeatedly.
-    // std::vector<size_t> active_queue_indices_;
-    // void update_active_list_on_enqueue(size_t internal_idx);
-    // void update_active_list_on_dequeue(size_t internal_idx);
 };
 
 } // namespace scheduler
@@ -3,82 +3,81 @@
 
 #include "hqts/scheduler/scheduler_interface.h"
 #include "hqts/scheduler/queue_types.h" // For PacketQueue
+#include "hqts/scheduler/service_curve.h" // For ServiceCurve, RuntimeCurve
+#include "hqts/scheduler/latency_histogram.h" // For LatencyHistogram, LatencySnapshot
 #include "hqts/core/flow_context.h"     // For core::FlowId
 
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>       // For size_t
 #include <vector>
-#include <map>
-#include <chrono>    // For time calculations if needed (e.g. real time for virtual clock updates)
-#include <stdexcept> // For std::out_of_range, std::invalid_argument, std::logic_error
-#include <string>    // Potentially for error messages
-#include <queue>     // For std::priority_queue
+#include <unordered_map> // For the FlowId -> class index map
+#include <stdexcept>     // For std::out_of_range, std::invalid_argument, std::logic_error
+#include <string>        // Potentially for error messages
+#include <memory>        // For std::shared_ptr
 
 namespace hqts {
 namespace scheduler {
 
-struct ServiceCurve {
-    uint64_t rate_bps;   // Service rate in bits per second (0 means not set or infinite if used as upper limit)
-    uint64_t delay_us;   // Initial delay in microseconds (relevant for real-time curve)
-
-    // Default constructor
-    ServiceCurve(uint64_t r = 0, uint64_t d = 0) : rate_bps(r), delay_us(d) {}
-};
-
-struct HfscFlowState {
-    core::FlowId flow_id;
-    PacketQueue packet_queue; // Each flow has its own packet queue
-
-    // Service curves
-    ServiceCurve real_time_sc;    // For real-time guarantees
-    ServiceCurve link_share_sc;   // For fair link sharing
-    ServiceCurve upper_limit_sc;  // To cap the service rate
-
-    // HFSC internal state variables (times are typically in a virtual domain)
-    uint64_t virtual_start_time = 0;  // Becomes eligible_time based on real-time curve
-    uint64_t virtual_finish_time = 0; // Used for link-sharing curve scheduling (or chosen RT/LS VFT)
-    uint64_t eligible_time = 0;       // Earliest time this flow can be serviced based on RT/LS and UL curves
-                                      // This could be actual time (e.g. nanoseconds from epoch) or virtual time
-    uint64_t virtual_finish_time_ul = 0; // Tracks the VFT based on UL curve for the last packet of this flow
-
-    core::FlowId parent_id = 0; // 0 or a special constant for no parent
-    std::vector<core::FlowId> children_ids; // List of child flow/class IDs
-
-    // Statistics or other per-flow state can be added here
-    // uint64_t current_bytes_in_queue = 0;
-
-    // Constructor
-    explicit HfscFlowState(core::FlowId id = 0, core::FlowId p_id = 0) : flow_id(id), parent_id(p_id) {}
-};
-
 /**
- * @brief Basic structure for a Hierarchical Fair Service Curve (HFSC) Scheduler.
+ * @brief Hierarchical Fair Service Curve (HFSC) Scheduler.
  *
- * This is a placeholder implementation focusing on the structure.
- * The actual HFSC logic (virtual time calculations, event management) is complex
- * and will be implemented in later phases.
+ * Classes form a tree of arbitrary depth under an implicit root that stands for the link.
+ * Only leaf classes hold packets. Two criteria decide which leaf sends next:
+ *  - Real-time (RT): among leaves whose eligible time has passed, the one with the earliest
+ *    deadline. Eligible/deadline times come from the leaf's RT curve.
+ *  - Link-share (LS): otherwise, descend from the root, picking at every level the active
+ *    child with the smallest virtual time. Virtual times come from LS curves, are charged
+ *    for every byte a class (or any descendant) sends, and are propagated up the whole
+ *    path of the served leaf. An upper-limit (UL) curve keeps a class out of link-sharing
+ *    until its fit time.
  *
- * Note: For this implementation, PacketDescriptor::priority is used as the
- * core::FlowId to determine which flow's queue to enqueue into.
+ * Class state lives in a dense vector; RT candidates and each parent's active children are
+ * kept in indexed binary heaps, so enqueue and dequeue cost O(depth * log n).
+ *
+ * Times are measured on a link clock in nanoseconds: each dequeue advances it by the
+ * transmission time of the packet at total_link_bandwidth_bps, and when no class may be
+ * served yet it jumps to the next eligible or fit time, modelling an idle link. Each
+ * dequeued packet carries the link time its transmission starts at in
+ * PacketDescriptor::transmit_time_ns, which core::EgressPacer turns into a departure time.
+ *
+ * Note: enqueue() uses PacketDescriptor::priority as the core::FlowId of the target leaf
+ * (so it reaches ids 0-255); enqueue_to_class() addresses any configured leaf.
  */
 class HfscScheduler : public SchedulerInterface {
 public:
+    static constexpr uint32_t DEFAULT_QUEUE_CAPACITY_BYTES = 1000000;
+
     struct FlowConfig {
         core::FlowId id;
         core::FlowId parent_id; // 0 for root, or ID of parent class
-        ServiceCurve real_time_sc;
+        ServiceCurve real_time_sc;    // Only meaningful on leaf classes
         ServiceCurve link_share_sc;   // Optional, defaults to 0 if not specified
         ServiceCurve upper_limit_sc;  // Optional, defaults to 0 (no limit) if not specified
+        uint32_t queue_capacity_bytes; // Per-flow queue limit; packets beyond it are tail-dropped
 
         FlowConfig(core::FlowId flow_id, core::FlowId p_id, ServiceCurve rt_sc,
-                   ServiceCurve ls_sc = {}, ServiceCurve ul_sc = {})
-            : id(flow_id), parent_id(p_id), real_time_sc(rt_sc), link_share_sc(ls_sc), upper_limit_sc(ul_sc) {}
+                   ServiceCurve ls_sc = {}, ServiceCurve ul_sc = {},
+                   uint32_t capacity_bytes = DEFAULT_QUEUE_CAPACITY_BYTES)
+            : id(flow_id), parent_id(p_id), real_time_sc(rt_sc), link_share_sc(ls_sc), upper_limit_sc(ul_sc),
+              queue_capacity_bytes(capacity_bytes) {}
     };
 
     /**
      * @brief Constructs an HfscScheduler.
-     * @param flow_configs Vector of FlowConfig defining per-flow service curves.
+     * @param flow_configs Vector of FlowConfig defining the class tree and its service curves.
+     *                     An interior class without a link-share curve shares its parent's
+     *                     bandwidth with its siblings in proportion to bytes at link rate.
      * @param total_link_bandwidth_bps Total bandwidth of the link this scheduler operates on.
+     * @param descriptor_pool Optional pool shared by all leaf queues (and possibly other schedulers).
+     *                        If null, one is sized from the leaves' aggregate queue_capacity_bytes.
+     * @throws std::invalid_argument if flow_configs is empty, on duplicate ids, a class
+     *         parenting itself, a missing parent, a cycle in the parent links, or a leaf
+     *         with neither a real-time nor a link-share curve.
      */
-    explicit HfscScheduler(const std::vector<FlowConfig>& flow_configs, uint64_t total_link_bandwidth_bps);
+    explicit HfscScheduler(const std::vector<FlowConfig>& flow_configs, uint64_t total_link_bandwidth_bps,
+                           std::shared_ptr<PacketDescriptorPool> descriptor_pool = nullptr);
 
     ~HfscScheduler() override = default;
 
@@ -88,21 +87,26 @@ public:
     HfscScheduler& operator=(HfscScheduler&&) = default;
 
     /**
-     * @brief Enqueues a packet. (Placeholder - actual HFSC logic is more complex)
-     * PacketDescriptor::priority is used as core::FlowId.
+     * @brief Enqueues a packet into the leaf whose FlowId is PacketDescriptor::priority.
+     * A packet that would exceed the leaf's queue_capacity_bytes, or finds the descriptor
+     * pool exhausted, is tail-dropped.
      * @param packet The packet to enqueue.
-     * @throws std::logic_error if scheduler is not configured.
-     * @throws std::out_of_range if Flow ID from packet is not found.
+     * @return DROPPED_NO_QUEUE if the Flow ID from the packet is not a configured leaf,
+     *         DROPPED_BY_QUEUE on a tail drop, else ENQUEUED.
      */
-    void enqueue(PacketDescriptor packet) override;
+    EnqueueResult enqueue(PacketDescriptor packet) override;
 
     /**
-     * @brief Dequeues a packet. (Placeholder - actual HFSC logic is far more complex)
-     * @return The dequeued PacketDescriptor.
-     * @throws std::logic_error if scheduler is not configured or internal error.
-     * @throws std::runtime_error if the scheduler is empty.
+     * @brief Enqueues a packet into the leaf class `class_id`, which may be any configured id.
+     * @return As enqueue().
      */
-    PacketDescriptor dequeue() override;
+    EnqueueResult enqueue_to_class(core::FlowId class_id, PacketDescriptor packet);
+
+    /**
+     * @brief Dequeues the packet chosen by the RT criterion, or else by link-sharing.
+     * @return The dequeued PacketDescriptor, or std::nullopt if the scheduler is empty.
+     */
+    std::optional<PacketDescriptor> try_dequeue() override;
 
     /**
      * @brief Checks if the scheduler is empty.
@@ -110,42 +114,229 @@ public:
      */
     bool is_empty() const override;
 
+    /**
+     * @brief Enqueues a burst of packets with a single virtual dispatch.
+     * @see SchedulerInterface::enqueue_burst
+     */
+    size_t enqueue_burst(PacketDescriptor* packets, size_t count) override;
+
+    /**
+     * @brief Dequeues up to max_packets packets with a single virtual dispatch.
+     * @see SchedulerInterface::dequeue_burst
+     */
+    size_t dequeue_burst(std::vector<PacketDescriptor>& out, size_t max_packets) override;
+
     // Optional: Additional inspection methods
     size_t get_num_configured_flows() const;
     size_t get_flow_queue_size(core::FlowId flow_id) const;
 
+    /**
+     * @brief Starts recording, for every leaf, each packet's sojourn time and each
+     *        real-time deadline the leaf misses.
+     *
+     * Both are measured on the link clock, the scheduler's own time base: a packet's
+     * sojourn runs from the link time it was enqueued at to the link time its
+     * transmission starts, and an RT-served packet misses its deadline when its
+     * transmission ends after the leaf's deadline time. No clock is read. Call from the
+     * thread that owns the scheduler.
+     */
+    void enable_latency_histograms();
+
+    /**
+     * @brief Snapshot of a class's sojourn-time histogram; empty for interior classes
+     *        and until enable_latency_histograms() is called. Callable from any thread.
+     * @throws std::out_of_range if flow_id is not a configured class.
+     */
+    LatencySnapshot get_flow_latency(core::FlowId flow_id) const;
+
+    /**
+     * @brief Packets of a class served by the real-time criterion after their deadline
+     *        (see enable_latency_histograms()): its RT curve was not honoured.
+     * @throws std::out_of_range if flow_id is not a configured class.
+     */
+    uint64_t get_rt_deadline_misses(core::FlowId flow_id) const;
+
+    /**
+     * @brief Appends one sample per leaf class, keyed by its class id; latencies are in
+     *        link-clock nanoseconds.
+     * @see SchedulerInterface::collect_queue_stats
+     */
+    size_t collect_queue_stats(std::vector<QueueStatsSample>& out) const override;
+
+    /**
+     * @brief Current value of the link clock in nanoseconds (see class comment).
+     */
+    uint64_t get_link_time_ns() const { return link_time_ns_; }
+
 private:
-    std::map<core::FlowId, HfscFlowState> flow_states_; // Stores state for each configured flow
-    uint64_t total_link_bandwidth_bps_;
-    uint64_t current_virtual_time_ = 0; // System virtual time, crucial for HFSC
-    size_t total_packets_ = 0;
-    bool is_configured_ = false;
-
-    // Placeholder for actual HFSC internal functions like:
-    // void update_flow_eligibility(HfscFlowState& flow_state, const PacketDescriptor& packet); // Old name
-    // void update_virtual_times(HfscFlowState& flow_state, const PacketDescriptor& packet); // Old name
-    // HfscFlowState* select_next_flow_to_service();
-    uint64_t calculate_packet_service_time_us(uint32_t packet_length_bytes, const ServiceCurve& sc) const;
-    void update_flow_schedule(core::FlowId flow_id, bool is_newly_active);
-
-
-    // Nested struct for managing eligible flows in the priority queue
-    struct EligibleFlow {
-        uint64_t virtual_finish_time; // The time used for ordering in the eligible set
-        core::FlowId flow_id;
-
-        // Comparator for min-heap (smallest virtual_finish_time has highest priority)
-        // std::priority_queue is a max-heap by default, so std::greater makes it a min-heap.
-        bool operator>(const EligibleFlow& other) const {
-            if (virtual_finish_time != other.virtual_finish_time) {
-                return virtual_finish_time > other.virtual_finish_time;
+    static constexpr uint32_t ROOT_INDEX = 0;          // classes_[0] is the implicit root
+    static constexpr uint32_t NO_CLASS = UINT32_MAX;
+    static constexpr size_t NOT_IN_HEAP = static_cast<size_t>(-1);
+
+    // Per-leaf latency counters, written by the dequeuing thread and read by anyone.
+    struct ClassLatency {
+        LatencyHistogram sojourn;                     // In link-clock nanoseconds
+        std::atomic<uint64_t> rt_deadline_misses{0};
+    };
+
+    struct ClassState {
+        core::FlowId id = 0;
+        uint32_t parent = NO_CLASS;
+        uint32_t num_children = 0;
+        uint32_t active_children = 0; // Children currently taking part in link-sharing
+
+        PacketQueue packet_queue;          // Used by leaf classes only
+        uint32_t queue_capacity_bytes = 0; // Tail-drop limit for packet_queue
+        uint64_t queued_bytes = 0;         // Bytes currently in packet_queue
+        std::unique_ptr<ClassLatency> latency; // Leaves only, see enable_latency_histograms()
+
+        ServiceCurve real_time_sc;
+        ServiceCurve link_share_sc; // Implicit link-rate curve for interior classes without one
+        ServiceCurve upper_limit_sc;
+        InternalServiceCurve real_time_isc; // Fixed-point forms of the three curves
+        InternalServiceCurve link_share_isc;
+        InternalServiceCurve upper_limit_isc;
+        bool has_rt = false;
+        bool has_ls = false;
+        bool has_ul = false;
+
+        RuntimeCurve deadline_curve;
+        RuntimeCurve eligible_curve;
+        RuntimeCurve virtual_curve;
+        RuntimeCurve upper_limit_curve;
+        bool rt_curves_initialized = false;
+        bool ls_curves_initialized = false;
+
+        uint64_t cumul_bytes = 0; // Bytes served by the RT criterion
+        uint64_t total_bytes = 0; // Bytes served by any criterion, here or in a descendant
+        uint64_t eligible_ns = 0;
+        uint64_t deadline_ns = 0;
+        uint64_t vt = 0;             // Virtual time (link-sharing)
+        uint64_t fit_time_ns = 0;    // Earliest link time the UL curve allows link-sharing
+        uint64_t child_vt_clock = 0; // Virtual time at which a child was last served (start point for new ones)
+
+        bool ls_active = false; // Backlogged and taking part in link-sharing
+        bool rt_ready = false;  // In ready_rt_ (else in pending_rt_ when rt_heap_pos is set)
+        size_t rt_heap_pos = NOT_IN_HEAP;
+        size_t ls_heap_pos = NOT_IN_HEAP; // Position in the parent's children_by_vt_ heap
+        size_t ul_heap_pos = NOT_IN_HEAP;
+
+        bool is_leaf() const { return num_children == 0; }
+    };
+
+    // Indexed binary min-heap of class indices ordered by ClassState::*Key (ties by index);
+    // each class records its position in ClassState::*Pos, so erase/update are O(log n).
+    template <uint64_t ClassState::*Key, size_t ClassState::*Pos>
+    class ClassHeap {
+    public:
+        bool empty() const { return items_.empty(); }
+        uint32_t top() const { return items_.front(); }
+
+        void push(std::vector<ClassState>& classes, uint32_t index) {
+            items_.push_back(index);
+            classes[index].*Pos = items_.size() - 1;
+            sift_up(classes, items_.size() - 1);
+        }
+
+        void erase(std::vector<ClassState>& classes, uint32_t index) {
+            size_t pos = classes[index].*Pos;
+            classes[index].*Pos = NOT_IN_HEAP;
+            uint32_t last = items_.back();
+            items_.pop_back();
+            if (pos == items_.size()) {
+                return;
             }
-            // Tie-breaking for stability or consistent ordering if VFTs are equal
-            return flow_id > other.flow_id;
+            items_[pos] = last;
+            classes[last].*Pos = pos;
+            update(classes, last);
         }
+
+        // Restores heap order after the key of `index` changed.
+        void update(std::vector<ClassState>& classes, uint32_t index) {
+            size_t pos = classes[index].*Pos;
+            if (pos > 0 && less(classes, index, items_[(pos - 1) / 2])) {
+                sift_up(classes, pos);
+            } else {
+                sift_down(classes, pos);
+            }
+        }
+
+    private:
+        static bool less(const std::vector<ClassState>& classes, uint32_t a, uint32_t b) {
+            uint64_t key_a = classes[a].*Key;
+            uint64_t key_b = classes[b].*Key;
+            return key_a != key_b ? key_a < key_b : a < b;
+        }
+
+        void place(std::vector<ClassState>& classes, size_t pos, uint32_t index) {
+            items_[pos] = index;
+            classes[index].*Pos = pos;
+        }
+
+        void sift_up(std::vector<ClassState>& classes, size_t pos) {
+            uint32_t index = items_[pos];
+            while (pos > 0) {
+                size_t parent = (pos - 1) / 2;
+                if (!less(classes, index, items_[parent])) {
+                    break;
+                }
+                place(classes, pos, items_[parent]);
+                pos = parent;
+            }
+            place(classes, pos, index);
+        }
+
+        void sift_down(std::vector<ClassState>& classes, size_t pos) {
+            uint32_t index = items_[pos];
+            const size_t size = items_.size();
+            for (;;) {
+                size_t child = 2 * pos + 1;
+                if (child >= size) {
+                    break;
+                }
+                if (child + 1 < size && less(classes, items_[child + 1], items_[child])) {
+                    ++child;
+                }
+                if (!less(classes, items_[child], index)) {
+                    break;
+                }
+                place(classes, pos, items_[child]);
+                pos = child;
+            }
+            place(classes, pos, index);
+        }
+
+        std::vector<uint32_t> items_;
     };
 
-    std::priority_queue<EligibleFlow, std::vector<EligibleFlow>, std::greater<EligibleFlow>> eligible_set_;
+    using EligibleHeap = ClassHeap<&ClassState::eligible_ns, &ClassState::rt_heap_pos>;
+    using DeadlineHeap = ClassHeap<&ClassState::deadline_ns, &ClassState::rt_heap_pos>;
+    using VirtualTimeHeap = ClassHeap<&ClassState::vt, &ClassState::ls_heap_pos>;
+    using FitTimeHeap = ClassHeap<&ClassState::fit_time_ns, &ClassState::ul_heap_pos>;
+
+    uint32_t find_class_index(core::FlowId class_id) const;
+    EnqueueResult enqueue_to_index(uint32_t index, PacketDescriptor&& packet); // NO_CLASS: dropped
+    void activate(uint32_t leaf, uint32_t packet_length_bytes);
+    void update_real_time(uint32_t leaf, bool served_by_rt);
+    void charge_path(uint32_t leaf, uint32_t packet_length_bytes);
+    void deactivate_path(uint32_t leaf);
+    bool sync_link_share(uint32_t index);
+    void sync_path(uint32_t index);
+    void wake_fitting_classes();
+    void promote_eligible_classes();
+    uint64_t transmission_time_ns(uint32_t packet_length_bytes) const;
+
+    std::vector<ClassState> classes_;                     // Dense; index 0 is the root
+    std::vector<VirtualTimeHeap> children_by_vt_;         // Per class: link-sharing children
+    std::unordered_map<core::FlowId, uint32_t> index_by_id_;
+    std::array<uint32_t, 256> leaf_by_priority_;          // enqueue(): priority -> leaf index, or NO_CLASS
+    EligibleHeap pending_rt_; // Backlogged RT leaves not yet eligible, by eligible time
+    DeadlineHeap ready_rt_;   // Eligible RT leaves, by deadline
+    FitTimeHeap ul_wait_;     // Link-sharing classes held back by their UL curve, by fit time
+    uint64_t total_link_bandwidth_bps_;
+    CurveSlope link_slope_; // total_link_bandwidth_bps_ in fixed point
+    uint64_t link_time_ns_ = 0;
+    size_t total_packets_ = 0;
 };
 
 } // namespace scheduler
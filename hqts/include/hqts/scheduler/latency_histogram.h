@@ -0,0 +1,101 @@
+#ifndef HQTS_SCHEDULER_LATENCY_HISTOGRAM_H_
+#define HQTS_SCHEDULER_LATENCY_HISTOGRAM_H_
+
+#include "hqts/core/single_writer.h" // For single_writer_add
+
+#include <array>
+#include <atomic>
+#include <cstddef> // For size_t
+#include <cstdint>
+#include <vector>
+
+namespace hqts {
+namespace scheduler {
+
+/**
+ * @brief A point-in-time copy of a LatencyHistogram, safe to keep and inspect anywhere.
+ */
+struct LatencySnapshot {
+    uint64_t count = 0;  // Samples recorded
+    uint64_t sum_ns = 0;
+    uint64_t max_ns = 0;
+    std::vector<uint64_t> buckets; // Samples per LatencyHistogram bucket; empty if nothing was recorded
+
+    uint64_t mean_ns() const { return count == 0 ? 0 : sum_ns / count; }
+
+    /**
+     * @brief The latency at or below which `fraction` (0.0 .. 1.0) of the samples lie.
+     *
+     * Reported as the highest value of the bucket holding that sample, capped at max_ns,
+     * so it is never below the true percentile and at most one bucket width
+     * (1/16 of the value) above it. 0 if no samples were recorded.
+     */
+    uint64_t percentile_ns(double fraction) const;
+};
+
+/**
+ * @brief Log-linear (HDR-style) histogram of queueing delays in nanoseconds.
+ *
+ * Every power of two is split into 16 equal buckets, so a sample is located with one
+ * count-leading-zeros and a shift and its bucket is accurate to 1/16 of the value at
+ * every scale, from nanoseconds up to MAX_VALUE_BITS (about 18 minutes; longer delays
+ * land in the last bucket). record() costs a handful of instructions and no locked ones.
+ *
+ * One thread records (the one dequeuing from the queue the histogram belongs to);
+ * snapshot() may be called from any thread at any time. A snapshot taken while samples
+ * are being recorded is not an exact cut, but no sample is ever torn.
+ */
+class LatencyHistogram {
+public:
+    static constexpr unsigned SUB_BUCKET_BITS = 4;  // 16 buckets per power of two
+    static constexpr unsigned MAX_VALUE_BITS = 40;  // Samples of 2^40 ns and above are clamped
+    static constexpr size_t NUM_BUCKETS = size_t{MAX_VALUE_BITS - SUB_BUCKET_BITS + 1} << SUB_BUCKET_BITS;
+
+    /** @brief Index of the bucket holding `ns`. */
+    static size_t bucket_of(uint64_t ns) {
+        constexpr uint64_t max_value = (uint64_t{1} << MAX_VALUE_BITS) - 1;
+        if (ns > max_value) {
+            ns = max_value;
+        }
+        if (ns < (uint64_t{1} << (SUB_BUCKET_BITS + 1))) {
+            return static_cast<size_t>(ns); // Exact below 32 ns
+        }
+        unsigned shift = 63u - static_cast<unsigned>(__builtin_clzll(ns)) - SUB_BUCKET_BITS;
+        return (size_t{shift} << SUB_BUCKET_BITS) + static_cast<size_t>(ns >> shift);
+    }
+
+    /** @brief Smallest value in bucket `bucket`. */
+    static uint64_t bucket_lower_bound(size_t bucket);
+
+    /** @brief Largest value in bucket `bucket`. */
+    static uint64_t bucket_upper_bound(size_t bucket);
+
+    /** @brief Adds one sample. Only the histogram's writer thread may call this. */
+    void record(uint64_t ns) {
+        core::single_writer_add(buckets_[bucket_of(ns)], 1);
+        core::single_writer_add(count_, 1);
+        core::single_writer_add(sum_ns_, ns);
+        if (ns > max_ns_.load(std::memory_order_relaxed)) {
+            max_ns_.store(ns, std::memory_order_relaxed);
+        }
+    }
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+
+    /** @brief Copies the current counts. */
+    LatencySnapshot snapshot() const;
+
+    /** @brief Clears all samples. Only the writer thread may call this. */
+    void reset();
+
+private:
+    std::array<std::atomic<uint64_t>, NUM_BUCKETS> buckets_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_ns_{0};
+    std::atomic<uint64_t> max_ns_{0};
+};
+
+} // namespace scheduler
+} // namespace hqts
+
+#endif // HQTS_SCHEDULER_LATENCY_HISTOGRAM_H_
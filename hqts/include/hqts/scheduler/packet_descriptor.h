@@ -1,21 +1,13 @@
 #ifndef HQTS_SCHEDULER_PACKET_DESCRIPTOR_H_
 #define HQTS_SCHEDULER_PACKET_DESCRIPTOR_H_
 
-#include "hqts/core/flow_context.h" // For hqts::core::FlowId
+#include "hqts/core/flow_context.h"       // For hqts::core::FlowId
+#include "hqts/core/packet_buffer_pool.h" // For hqts::core::PacketBufferHandle
+#include "hqts/core/time_source.h"        // For hqts::core::TimestampNs
+#include "hqts/policy/policy_types.h"     // For hqts::policy::PolicyId
 
 #include <cstdint>
-#include <vector>
-#include <cstddef> // For std::byte (if C++17) or alternative
-
-// Ensure std::byte is available (C++17 and later)
-#if __cplusplus >= 201703L
-#include <cstddef> // For std::byte
-#else
-// Basic fallback for pre-C++17, not a perfect polyfill but enough for opaque data
-namespace std {
-enum class byte : unsigned char {};
-}
-#endif
+#include <type_traits> // For std::is_trivially_copyable
 
 
 namespace hqts {
@@ -35,24 +27,38 @@ struct PacketDescriptor {
                       // Schedulers (like StrictPriority or WRR using priority as QueueId) will use this.
     ConformanceLevel conformance; // Set by the shaper/policer
 
-    // Optional: Represents the packet payload or a reference to it.
-    std::vector<std::byte> payload;
+    // Optional reference to the payload bytes in a core::PacketBufferPool.
+    // The bytes themselves are never copied while the packet moves through the system.
+    core::PacketBufferHandle buffer;
+
+    // Time the packet entered its current queue; set by queues that manage sojourn
+    // time (CoDelQueue, FqCoDelQueue), 0 otherwise.
+    core::TimestampNs enqueue_time_ns;
+
+    // Policy the shaper metered the packet against (NO_PARENT_POLICY_ID until then).
+    // SchedulerTree queues the packet at this policy's node.
+    policy::PolicyId policy_id;
+
+    // Departure time: set to the start of the packet's transmission on the scheduler's
+    // link clock by schedulers that keep one (HfscScheduler), then to a steady-clock
+    // transmit time by core::EgressPacer. 0 otherwise.
+    core::TimestampNs transmit_time_ns;
 
     // Constructor
     PacketDescriptor(
         core::FlowId f_id,
         uint32_t len,
         uint8_t prio_val = 0, // Default priority, to be overwritten by shaper
-        size_t actual_payload_to_copy_size = 0,
+        core::PacketBufferHandle buffer_handle = core::INVALID_PACKET_BUFFER,
         ConformanceLevel conf = ConformanceLevel::GREEN // Default conformance
     ) : flow_id(f_id),
         packet_length_bytes(len),
         priority(prio_val),
-        conformance(conf) {
-        if (actual_payload_to_copy_size > 0) {
-            payload.resize(actual_payload_to_copy_size);
-        }
-    }
+        conformance(conf),
+        buffer(buffer_handle),
+        enqueue_time_ns(0),
+        policy_id(policy::NO_PARENT_POLICY_ID),
+        transmit_time_ns(0) {}
 
     // Default constructor for cases where it might be needed
     PacketDescriptor()
@@ -60,9 +66,16 @@ struct PacketDescriptor {
         packet_length_bytes(0),
         priority(0),
         conformance(ConformanceLevel::GREEN),
-        payload{} {}
+        buffer(core::INVALID_PACKET_BUFFER),
+        enqueue_time_ns(0),
+        policy_id(policy::NO_PARENT_POLICY_ID),
+        transmit_time_ns(0) {}
 };
 
+// Descriptors are copied freely between queues; keep them plain data.
+static_assert(std::is_trivially_copyable<PacketDescriptor>::value,
+              "PacketDescriptor must stay trivially copyable");
+
 } // namespace scheduler
 } // namespace hqts
 
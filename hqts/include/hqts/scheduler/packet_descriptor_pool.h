@@ -0,0 +1,205 @@
+#ifndef HQTS_SCHEDULER_PACKET_DESCRIPTOR_POOL_H_
+#define HQTS_SCHEDULER_PACKET_DESCRIPTOR_POOL_H_
+
+#include "hqts/scheduler/packet_descriptor.h" // For PacketDescriptor
+
+#include <cstdint>
+#include <cstddef> // For size_t
+#include <memory>  // For std::shared_ptr
+#include <utility> // For std::move
+#include <vector>
+
+namespace hqts {
+namespace scheduler {
+
+/**
+ * @brief Fixed-capacity arena of PacketDescriptor nodes shared by scheduler queues.
+ *
+ * All nodes are allocated once at construction. Queues link nodes into intrusive
+ * FIFOs (see PacketFifo) and free nodes form an intrusive free list, so enqueue and
+ * dequeue never allocate. A pool is typically sized from the aggregate byte capacity
+ * of the queues drawing from it (see capacity_for_bytes()).
+ *
+ * Not thread-safe: a pool belongs to the scheduler (or core) that owns its queues.
+ */
+class PacketDescriptorPool {
+public:
+    using Index = uint32_t;
+    static constexpr Index NIL = UINT32_MAX;
+
+    // Smallest frame we budget a descriptor for when sizing from bytes (Ethernet minimum).
+    static constexpr uint32_t DEFAULT_MIN_PACKET_BYTES = 64;
+
+    /**
+     * @brief Constructs a pool with a fixed number of descriptor nodes.
+     * @param capacity Number of descriptors (1 .. NIL - 1).
+     * @throws std::invalid_argument if capacity is out of range.
+     */
+    explicit PacketDescriptorPool(size_t capacity);
+
+    PacketDescriptorPool(const PacketDescriptorPool&) = delete;
+    PacketDescriptorPool& operator=(const PacketDescriptorPool&) = delete;
+    PacketDescriptorPool(PacketDescriptorPool&&) = delete;
+    PacketDescriptorPool& operator=(PacketDescriptorPool&&) = delete;
+
+    /**
+     * @brief Number of descriptors needed to fill `total_capacity_bytes` of queue space
+     *        with packets of at least `min_packet_bytes` each (rounded up, at least 1).
+     */
+    static size_t capacity_for_bytes(uint64_t total_capacity_bytes,
+                                     uint32_t min_packet_bytes = DEFAULT_MIN_PACKET_BYTES);
+
+    /**
+     * @brief Convenience factory for pools shared between several queues.
+     */
+    static std::shared_ptr<PacketDescriptorPool> create_for_bytes(
+        uint64_t total_capacity_bytes, uint32_t min_packet_bytes = DEFAULT_MIN_PACKET_BYTES);
+
+    /**
+     * @brief Takes a node from the free list and stores `packet` in it.
+     * @return The node index, or NIL if the pool is exhausted.
+     */
+    Index allocate(const PacketDescriptor& packet) {
+        Index index = free_head_;
+        if (index == NIL) {
+            return NIL;
+        }
+        Node& node = nodes_[index];
+        free_head_ = node.next;
+        node.descriptor = packet;
+        node.next = NIL;
+        --available_;
+        return index;
+    }
+
+    /**
+     * @brief Returns a node to the free list. The index must have come from allocate().
+     */
+    void free(Index index) {
+        nodes_[index].next = free_head_;
+        free_head_ = index;
+        ++available_;
+    }
+
+    PacketDescriptor& descriptor(Index index) { return nodes_[index].descriptor; }
+    const PacketDescriptor& descriptor(Index index) const { return nodes_[index].descriptor; }
+
+    Index next(Index index) const { return nodes_[index].next; }
+    void set_next(Index index, Index next_index) { nodes_[index].next = next_index; }
+
+    size_t capacity() const { return nodes_.size(); }
+    size_t available() const { return available_; }
+
+private:
+    struct Node {
+        PacketDescriptor descriptor;
+        Index next = NIL; // FIFO successor while queued, free-list successor while free
+    };
+
+    std::vector<Node> nodes_;
+    Index free_head_ = NIL;
+    size_t available_ = 0;
+};
+
+/**
+ * @brief Intrusive FIFO of PacketDescriptors stored in a PacketDescriptorPool.
+ *
+ * Holds only head/tail indices and a count; the links live in the pool nodes.
+ * Nodes still queued when the FIFO is destroyed or cleared are returned to the pool.
+ */
+class PacketFifo {
+public:
+    PacketFifo() = default;
+    explicit PacketFifo(std::shared_ptr<PacketDescriptorPool> pool) : pool_(std::move(pool)) {}
+    ~PacketFifo() { clear(); }
+
+    PacketFifo(const PacketFifo&) = delete;
+    PacketFifo& operator=(const PacketFifo&) = delete;
+
+    PacketFifo(PacketFifo&& other) noexcept
+        : pool_(std::move(other.pool_)), head_(other.head_), tail_(other.tail_), size_(other.size_) {
+        other.head_ = other.tail_ = PacketDescriptorPool::NIL;
+        other.size_ = 0;
+    }
+
+    PacketFifo& operator=(PacketFifo&& other) noexcept {
+        if (this != &other) {
+            clear();
+            pool_ = std::move(other.pool_);
+            head_ = other.head_;
+            tail_ = other.tail_;
+            size_ = other.size_;
+            other.head_ = other.tail_ = PacketDescriptorPool::NIL;
+            other.size_ = 0;
+        }
+        return *this;
+    }
+
+    bool empty() const { return size_ == 0; }
+    size_t size() const { return size_; }
+
+    /**
+     * @brief Appends a packet.
+     * @return False if the pool has no free descriptor left (the packet is not queued).
+     */
+    bool push_back(const PacketDescriptor& packet) {
+        PacketDescriptorPool::Index index = pool_->allocate(packet);
+        if (index == PacketDescriptorPool::NIL) {
+            return false;
+        }
+        if (tail_ == PacketDescriptorPool::NIL) {
+            head_ = index;
+        } else {
+            pool_->set_next(tail_, index);
+        }
+        tail_ = index;
+        ++size_;
+        return true;
+    }
+
+    /**
+     * @brief Removes and returns the oldest packet. Precondition: !empty().
+     */
+    PacketDescriptor pop_front() {
+        PacketDescriptorPool::Index index = head_;
+        PacketDescriptor packet = pool_->descriptor(index);
+        head_ = pool_->next(index);
+        if (head_ == PacketDescriptorPool::NIL) {
+            tail_ = PacketDescriptorPool::NIL;
+        }
+        pool_->free(index);
+        --size_;
+        return packet;
+    }
+
+    /**
+     * @brief The oldest packet. Precondition: !empty().
+     */
+    const PacketDescriptor& front() const { return pool_->descriptor(head_); }
+
+    /**
+     * @brief Returns all queued nodes to the pool (payload buffers are not released).
+     */
+    void clear() {
+        while (head_ != PacketDescriptorPool::NIL) {
+            PacketDescriptorPool::Index next = pool_->next(head_);
+            pool_->free(head_);
+            head_ = next;
+        }
+        tail_ = PacketDescriptorPool::NIL;
+        size_ = 0;
+    }
+
+    const std::shared_ptr<PacketDescriptorPool>& pool() const { return pool_; }
+
+private:
+    std::shared_ptr<PacketDescriptorPool> pool_;
+    PacketDescriptorPool::Index head_ = PacketDescriptorPool::NIL;
+    PacketDescriptorPool::Index tail_ = PacketDescriptorPool::NIL;
+    size_t size_ = 0;
+};
+
+} // namespace scheduler
+} // namespace hqts
+
+#endif // HQTS_SCHEDULER_PACKET_DESCRIPTOR_POOL_H_
@@ -0,0 +1,95 @@
+#ifndef HQTS_SCHEDULER_PRIORITY_BITMAP_H_
+#define HQTS_SCHEDULER_PRIORITY_BITMAP_H_
+
+#include <cstddef> // For size_t
+#include <cstdint>
+#include <stdexcept> // For std::invalid_argument
+#include <string>    // For std::to_string
+#include <vector>
+
+namespace hqts {
+namespace scheduler {
+
+/**
+ * @brief Highest set bit of a non-zero 64-bit word.
+ */
+inline unsigned highest_set_bit(uint64_t word) {
+#if defined(__GNUC__)
+    return 63u - static_cast<unsigned>(__builtin_clzll(word));
+#else
+    unsigned bit = 0;
+    while (word >>= 1) {
+        ++bit;
+    }
+    return bit;
+#endif
+}
+
+/**
+ * @brief Two-level bitmap of non-empty levels with O(1) highest-level lookup.
+ *
+ * Level i is bit (i % 64) of leaf word i / 64; bit w of the summary word is set
+ * whenever leaf word w is non-zero. Finding the highest non-empty level is two
+ * count-leading-zeros instructions, independent of the number of levels (up to
+ * MAX_LEVELS). Schedulers export it so a parent can check a child's backlog, or its
+ * best level, without asking every queue.
+ */
+class PriorityBitmap {
+public:
+    static constexpr size_t MAX_LEVELS = 64 * 64;
+    static constexpr size_t NO_LEVEL = static_cast<size_t>(-1);
+
+    /**
+     * @param num_levels Number of levels tracked (1 .. MAX_LEVELS).
+     * @throws std::invalid_argument if num_levels is out of range.
+     */
+    explicit PriorityBitmap(size_t num_levels)
+        : num_levels_(num_levels), summary_(0), leaves_((num_levels + 63) / 64, 0) {
+        if (num_levels == 0 || num_levels > MAX_LEVELS) {
+            throw std::invalid_argument("PriorityBitmap: num_levels " + std::to_string(num_levels) +
+                                        " must be in 1.." + std::to_string(MAX_LEVELS) + ".");
+        }
+    }
+
+    void set(size_t level) {
+        leaves_[level >> 6] |= uint64_t{1} << (level & 63);
+        summary_ |= uint64_t{1} << (level >> 6);
+    }
+
+    void clear(size_t level) {
+        uint64_t& leaf = leaves_[level >> 6];
+        leaf &= ~(uint64_t{1} << (level & 63));
+        if (leaf == 0) {
+            summary_ &= ~(uint64_t{1} << (level >> 6));
+        }
+    }
+
+    bool test(size_t level) const {
+        return (leaves_[level >> 6] >> (level & 63)) & 1u;
+    }
+
+    bool any() const { return summary_ != 0; }
+
+    /**
+     * @brief The highest set level, or NO_LEVEL if none is set.
+     */
+    size_t highest() const {
+        if (summary_ == 0) {
+            return NO_LEVEL;
+        }
+        size_t word = highest_set_bit(summary_);
+        return (word << 6) | highest_set_bit(leaves_[word]);
+    }
+
+    size_t num_levels() const { return num_levels_; }
+
+private:
+    size_t num_levels_;
+    uint64_t summary_;
+    std::vector<uint64_t> leaves_;
+};
+
+} // namespace scheduler
+} // namespace hqts
+
+#endif // HQTS_SCHEDULER_PRIORITY_BITMAP_H_
@@ -0,0 +1,47 @@
+#ifndef HQTS_SCHEDULER_QUEUE_STATS_H_
+#define HQTS_SCHEDULER_QUEUE_STATS_H_
+
+#include "hqts/scheduler/latency_histogram.h" // For LatencyHistogram, LatencySnapshot
+
+#include <cstdint>
+
+namespace hqts {
+namespace scheduler {
+
+/**
+ * @brief Depth and sojourn-time summary of one scheduler queue at one moment.
+ *
+ * Filled by SchedulerInterface::collect_queue_stats() on the thread owning the
+ * scheduler, for export (see monitor::StatsSegment). Latency fields are 0 unless the
+ * scheduler's latency histograms are enabled.
+ */
+struct QueueStatsSample {
+    uint64_t queue_id = 0;        // QueueId, priority level or HFSC class id, per scheduler
+    uint64_t packets_queued = 0;
+    uint64_t bytes_queued = 0;
+    uint64_t latency_samples = 0;
+    uint64_t latency_mean_ns = 0;
+    uint64_t latency_p50_ns = 0;
+    uint64_t latency_p99_ns = 0;
+    uint64_t latency_p999_ns = 0;
+    uint64_t latency_max_ns = 0;
+};
+
+/** @brief Copies the summary of `histogram` (may be null) into `sample`'s latency fields. */
+inline void fill_latency_fields(QueueStatsSample& sample, const LatencyHistogram* histogram) {
+    if (histogram == nullptr || histogram->count() == 0) {
+        return;
+    }
+    LatencySnapshot snapshot = histogram->snapshot();
+    sample.latency_samples = snapshot.count;
+    sample.latency_mean_ns = snapshot.mean_ns();
+    sample.latency_p50_ns = snapshot.percentile_ns(0.5);
+    sample.latency_p99_ns = snapshot.percentile_ns(0.99);
+    sample.latency_p999_ns = snapshot.percentile_ns(0.999);
+    sample.latency_max_ns = snapshot.max_ns;
+}
+
+} // namespace scheduler
+} // namespace hqts
+
+#endif // HQTS_SCHEDULER_QUEUE_STATS_H_
@@ -1,23 +1,15 @@
 #ifndef HQTS_SCHEDULER_QUEUE_TYPES_H_
 #define HQTS_SCHEDULER_QUEUE_TYPES_H_
 
-#include "hqts/scheduler/packet_descriptor.h" // For PacketDescriptor
-
-#include <queue>    // For std::queue
-#include <deque>    // std::queue is often implemented using std::deque by default
-#include <vector>   // Can also be used as std::queue's underlying container
-#include <list>     // Can also be used as std::queue's underlying container
+#include "hqts/scheduler/packet_descriptor.h"      // For PacketDescriptor
+#include "hqts/scheduler/packet_descriptor_pool.h" // For PacketFifo, PacketDescriptorPool
 
 namespace hqts {
 namespace scheduler {
 
-// Basic packet queue type using std::queue with std::deque as the underlying container.
-// std::deque is generally a good default for std::queue.
-using PacketQueue = std::queue<PacketDescriptor>;
-
-// Alternative queue types could be defined here if needed, for example:
-// using PriorityPacketQueue = std::priority_queue<PacketDescriptor, std::vector<PacketDescriptor>, SomeComparator>;
-// using BoundedPacketQueue = ... (would require a custom bounded queue implementation)
+// Basic packet queue type: an intrusive FIFO whose nodes come from a shared,
+// pre-sized PacketDescriptorPool, so queue operations never allocate.
+using PacketQueue = PacketFifo;
 
 } // namespace scheduler
 } // namespace hqts
@@ -2,13 +2,31 @@
 #define HQTS_SCHEDULER_SCHEDULER_INTERFACE_H_
 
 #include "hqts/scheduler/packet_descriptor.h" // For PacketDescriptor
+#include "hqts/scheduler/queue_stats.h"       // For QueueStatsSample
 #include "hqts/core/flow_context.h"          // For core::QueueId (though not used in current commented-out methods)
 
-#include <cstdint> // For uint32_t in commented-out methods
+#include <cstdint> // For uint8_t, uint32_t in commented-out methods
+#include <cstddef> // For size_t
+#include <optional>  // For std::optional in try_dequeue
+#include <stdexcept> // For std::runtime_error in dequeue
+#include <utility> // For std::move
+#include <vector>  // For std::vector in dequeue_burst
 
 namespace hqts {
 namespace scheduler {
 
+/**
+ * @brief Outcome of SchedulerInterface::enqueue().
+ *
+ * A packet that is not ENQUEUED has been dropped by the scheduler, which has released
+ * its buffer (see PacketBufferPool::release_any()); callers only count the reason.
+ */
+enum class EnqueueResult : uint8_t {
+    ENQUEUED = 0,
+    DROPPED_BY_QUEUE, // Refused by the queue's AQM, byte limit or an exhausted descriptor pool
+    DROPPED_NO_QUEUE  // The packet addresses no configured queue (level, queue id or leaf class)
+};
+
 class SchedulerInterface {
 public:
     virtual ~SchedulerInterface() = default;
@@ -17,24 +35,38 @@ public:
      * @brief Enqueues a packet into the scheduler.
      *
      * The scheduler implementation will determine how and where this packet is stored
-     * based on its internal logic (e.g., flow ID, priority).
+     * based on its internal logic (e.g., flow ID, priority). Never throws: every outcome,
+     * including a packet no queue is configured for, is reported in the result.
      *
      * @param packet The packet descriptor to enqueue.
+     * @return ENQUEUED, or why the packet was dropped.
+     */
+    virtual EnqueueResult enqueue(PacketDescriptor packet) = 0;
+
+    /**
+     * @brief Dequeues the packet the scheduling discipline selects next.
+     *
+     * The data-path form of dequeue(): never throws and never allocates.
+     *
+     * @return The packet, or std::nullopt if the scheduler is empty.
      */
-    virtual void enqueue(PacketDescriptor packet) = 0;
+    virtual std::optional<PacketDescriptor> try_dequeue() = 0;
 
     /**
      * @brief Dequeues a packet from the scheduler according to its scheduling discipline.
      *
-     * The returned packet is the one selected by the scheduler to be processed next.
-     * If the scheduler is empty and no packet can be dequeued, the behavior might
-     * depend on the implementation (e.g., throw an exception, or return a PacketDescriptor
-     * with a special state, though the latter is less common for dequeue).
-     * For simplicity, assume it blocks or throws if empty, or users check is_empty() first.
+     * Convenience form of try_dequeue() for callers that have checked is_empty().
      *
      * @return PacketDescriptor The packet descriptor dequeued.
+     * @throws std::runtime_error if the scheduler is empty.
      */
-    virtual PacketDescriptor dequeue() = 0;
+    PacketDescriptor dequeue() {
+        std::optional<PacketDescriptor> packet = try_dequeue();
+        if (!packet) {
+            throw std::runtime_error("SchedulerInterface: Scheduler is empty, cannot dequeue.");
+        }
+        return *packet;
+    }
 
     /**
      * @brief Checks if the scheduler is currently empty.
@@ -45,6 +77,94 @@ public:
      */
     virtual bool is_empty() const = 0;
 
+    /**
+     * @brief Enqueues a burst of packets.
+     *
+     * Semantically identical to calling enqueue() for each packet in order. The default
+     * implementation does exactly that; concrete schedulers override it so that the
+     * virtual dispatch happens once per burst rather than once per packet.
+     *
+     * @param packets Pointer to the first of `count` packets. Packets are moved from.
+     * @param count Number of packets in the burst.
+     * @return The number of packets enqueued; the other `count - return value` were dropped.
+     */
+    virtual size_t enqueue_burst(PacketDescriptor* packets, size_t count) {
+        size_t enqueued = 0;
+        for (size_t i = 0; i < count; ++i) {
+            if (enqueue(std::move(packets[i])) == EnqueueResult::ENQUEUED) {
+                ++enqueued;
+            }
+        }
+        return enqueued;
+    }
+
+    /**
+     * @brief Dequeues up to max_packets packets in scheduling order.
+     *
+     * Semantically identical to calling try_dequeue() until it returns std::nullopt,
+     * at most max_packets times. Dequeued packets are appended to `out`.
+     *
+     * @param out Vector the dequeued packets are appended to.
+     * @param max_packets Maximum number of packets to dequeue.
+     * @return The number of packets appended to `out`.
+     */
+    virtual size_t dequeue_burst(std::vector<PacketDescriptor>& out, size_t max_packets) {
+        size_t dequeued = 0;
+        while (dequeued < max_packets) {
+            std::optional<PacketDescriptor> packet = try_dequeue();
+            if (!packet) {
+                break;
+            }
+            out.push_back(*packet);
+            ++dequeued;
+        }
+        return dequeued;
+    }
+
+    /**
+     * @brief Moves up to max_packets packets from a handoff ring into the scheduler.
+     *
+     * The step the core owning a scheduler runs to take in descriptors other cores
+     * pushed to an SpscRing or MpscRing (see hqts/core/spsc_ring.h, mpsc_ring.h): the
+     * ring is popped in bursts of up to DRAIN_BURST_SIZE and each burst goes through a
+     * single enqueue_burst() call. Call it only from the ring's consumer thread.
+     *
+     * @param ring Any ring with `size_t pop_burst(PacketDescriptor*, size_t)`.
+     * @param max_packets Maximum number of packets to move.
+     * @return The number of packets moved from the ring, enqueued or dropped alike.
+     */
+    template <typename Ring>
+    size_t drain_ring(Ring& ring, size_t max_packets) {
+        PacketDescriptor burst[DRAIN_BURST_SIZE];
+        size_t drained = 0;
+        while (drained < max_packets) {
+            size_t wanted = max_packets - drained < DRAIN_BURST_SIZE ? max_packets - drained : DRAIN_BURST_SIZE;
+            size_t count = ring.pop_burst(burst, wanted);
+            if (count == 0) {
+                break;
+            }
+            enqueue_burst(burst, count);
+            drained += count;
+        }
+        return drained;
+    }
+
+    /// Largest burst drain_ring() moves per enqueue_burst() call (stack-allocated).
+    static constexpr size_t DRAIN_BURST_SIZE = 32;
+
+    /**
+     * @brief Appends a QueueStatsSample for every queue of the scheduler to `out`.
+     *
+     * For periodic export; call it from the thread that owns the scheduler, like every
+     * other method. The default implementation appends nothing.
+     *
+     * @return The number of samples appended.
+     */
+    virtual size_t collect_queue_stats(std::vector<QueueStatsSample>& out) const {
+        (void)out;
+        return 0;
+    }
+
     /**
      * @brief Gets the number of packets currently held by the scheduler.
      * @return The total number of packets across all internal queues.
@@ -0,0 +1,175 @@
+#ifndef HQTS_SCHEDULER_SCHEDULER_TREE_H_
+#define HQTS_SCHEDULER_SCHEDULER_TREE_H_
+
+#include "hqts/scheduler/scheduler_interface.h"
+#include "hqts/scheduler/any_aqm_queue.h"   // For AqmQueue and AqmParameters
+#include "hqts/scheduler/priority_bitmap.h" // For PriorityBitmap
+#include "hqts/policy/policy_tree.h"        // For PolicyTree, SchedulingAlgorithm
+
+#include <cstddef> // For size_t
+#include <cstdint>
+#include <memory>  // For std::shared_ptr, std::unique_ptr
+#include <optional>
+#include <utility> // For std::pair
+#include <vector>
+
+namespace hqts {
+namespace scheduler {
+
+/**
+ * @brief Hierarchical scheduler whose shape is the PolicyTree: one node per policy.
+ *
+ * Policies without children are leaves holding one AQM queue each; every other policy
+ * is an interior node that runs its own SchedulingAlgorithm over its children. The
+ * root policies are the children of a port node with its own algorithm, so a tree
+ * such as port -> tenant -> class -> queue is scheduled level by level rather than
+ * by one flat scheduler. The child parameters each discipline reads are the child
+ * policy's:
+ *
+ *   STRICT_PRIORITY  priority_level; higher is served first, ties by lower PolicyId.
+ *   DRR              weight: the quantum is weight * quantum_bytes_per_weight.
+ *   WRR              weight: packets per round.
+ *   WFQ              weight: start-time fair queueing over the children's shares.
+ *   HFSC             committed_rate_bps as the link-sharing share (fair queueing over
+ *                    rates); the real-time criterion is HfscScheduler's.
+ *
+ * Packets are queued at the leaf of PacketDescriptor::policy_id, which TrafficShaper
+ * sets; PacketDescriptor::priority is not interpreted. Every node caches the number of
+ * packets queued below it, and a parent only keeps backlogged children in its
+ * discipline's active set, so idle subtrees cost nothing. One enqueue or dequeue
+ * touches each level between the leaf and the port once; neither allocates.
+ *
+ * DRR turns are charged after sending (the deficit may go negative, as in fq_codel),
+ * so an interior child never has to be asked for the length of its next packet.
+ */
+class SchedulerTree : public SchedulerInterface {
+public:
+    /// Quantum per unit of DRR weight: weight 100, the common default, is one 1500-byte MTU.
+    static constexpr uint32_t DEFAULT_QUANTUM_BYTES_PER_WEIGHT = 15;
+
+    /**
+     * @brief Builds the tree from `policies`.
+     * @param policies Policy hierarchy; parent_id links define the tree.
+     * @param leaf_queue_params AQM parameters of every leaf queue.
+     * @param port_algorithm Discipline of the port node over the root policies.
+     * @param quantum_bytes_per_weight DRR quantum per unit of weight.
+     * @param descriptor_pool Optional pool shared by all leaf queues. If null, one is sized
+     *                        from the leaves' aggregate capacity.
+     * @throws std::invalid_argument if `policies` is empty, uses PolicyId 0, has a policy
+     *         whose parent is missing or a parent cycle, a child with weight 0 under
+     *         DRR/WRR/WFQ or committed rate 0 under HFSC, more than
+     *         PriorityBitmap::MAX_LEVELS children under STRICT_PRIORITY, or if
+     *         quantum_bytes_per_weight is 0.
+     */
+    SchedulerTree(const policy::PolicyTree& policies, const AqmParameters& leaf_queue_params,
+                  policy::SchedulingAlgorithm port_algorithm = policy::SchedulingAlgorithm::DRR,
+                  uint32_t quantum_bytes_per_weight = DEFAULT_QUANTUM_BYTES_PER_WEIGHT,
+                  std::shared_ptr<PacketDescriptorPool> descriptor_pool = nullptr);
+
+    ~SchedulerTree() override = default;
+
+    SchedulerTree(const SchedulerTree&) = delete;
+    SchedulerTree& operator=(const SchedulerTree&) = delete;
+
+    /**
+     * @brief Queues the packet at the leaf of packet.policy_id.
+     * @return DROPPED_NO_QUEUE if policy_id is not a leaf policy, DROPPED_BY_QUEUE if the
+     *         leaf's AQM refused it, else ENQUEUED.
+     */
+    EnqueueResult enqueue(PacketDescriptor packet) override;
+
+    /**
+     * @brief Dequeues the packet each level's discipline selects, from the port down.
+     * @return The packet, or std::nullopt if the tree is empty.
+     */
+    std::optional<PacketDescriptor> try_dequeue() override;
+
+    bool is_empty() const override;
+
+    /**
+     * @brief SchedulerInterface::enqueue_burst, pipelined for trees of many policies.
+     *
+     * Packets are taken in groups of ENQUEUE_BATCH: the leaf of every packet in the group
+     * is looked up and its node prefetched, then each packet is enqueued while the leaf
+     * queue of the packet PREFETCH_DISTANCE places ahead, whose node has arrived, is
+     * prefetched. With thousands of policies the node and queue misses of a burst
+     * overlap instead of being taken one after another.
+     */
+    size_t enqueue_burst(PacketDescriptor* packets, size_t count) override;
+
+    /// Packets whose leaves enqueue_burst() looks up and prefetches together.
+    static constexpr size_t ENQUEUE_BATCH = 32;
+
+    /** @see SchedulerInterface::dequeue_burst */
+    size_t dequeue_burst(std::vector<PacketDescriptor>& out, size_t max_packets) override;
+
+    /**
+     * @brief Packets queued in the subtree of a policy (its queue, for a leaf).
+     * @throws std::out_of_range if `id` is not in the tree.
+     */
+    size_t get_backlog(policy::PolicyId id) const;
+
+    /** @brief Whether `id` is a leaf, i.e. packets can be queued for it. */
+    bool is_leaf(policy::PolicyId id) const;
+
+    /** @brief Number of policy nodes (the port node not counted). */
+    size_t get_num_nodes() const { return nodes_.size() - 1; }
+
+private:
+    static constexpr uint32_t NO_NODE = UINT32_MAX;
+    static constexpr uint32_t PORT_NODE = 0;
+
+    struct Node {
+        policy::PolicyId id;
+        uint32_t parent;                  // NO_NODE for the port
+        policy::SchedulingAlgorithm algorithm; // Discipline over the children
+        size_t backlog = 0;               // Packets queued in this subtree
+        std::vector<uint32_t> children;
+        std::unique_ptr<AqmQueue> queue;  // Leaves only
+
+        // Scheduling state of this node as a child of its parent.
+        uint32_t rank = 0;                // STRICT_PRIORITY: level in the parent's bitmap
+        uint32_t weight = 0;              // WRR packets per round
+        uint64_t share = 1;               // WFQ/HFSC share
+        int64_t quantum = 0;              // DRR
+        int64_t deficit = 0;              // DRR
+        uint32_t sent_in_turn = 0;        // WRR
+        uint64_t finish_tag = 0;          // WFQ/HFSC: virtual finish time of the last packet sent
+        uint32_t next_active = NO_NODE;   // DRR/WRR active list link
+
+        // Discipline state over the children (interior nodes).
+        PriorityBitmap backlogged_ranks{1};      // STRICT_PRIORITY
+        std::vector<uint32_t> child_by_rank;     // STRICT_PRIORITY
+        uint32_t active_head = NO_NODE;          // DRR/WRR
+        uint32_t active_tail = NO_NODE;          // DRR/WRR
+        std::vector<std::pair<uint64_t, uint32_t>> tag_heap; // WFQ/HFSC min-heap of (start tag, child)
+        uint64_t virtual_time = 0;               // WFQ/HFSC: start tag of the last packet sent
+
+        Node(policy::PolicyId node_id, uint32_t parent_index, policy::SchedulingAlgorithm discipline)
+            : id(node_id), parent(parent_index), algorithm(discipline) {}
+    };
+
+    /// Index of the node of `id`, or NO_NODE.
+    uint32_t find_node(policy::PolicyId id) const;
+
+    /// enqueue() once the packet's leaf node (or NO_NODE) has been looked up.
+    EnqueueResult enqueue_at(uint32_t leaf, PacketDescriptor packet);
+
+    /// Adds a child that just became backlogged to its parent's active set.
+    void activate(Node& parent, uint32_t child);
+    /// The child the parent's discipline serves next; the parent is backlogged.
+    uint32_t select(Node& parent);
+    /// Charges the child the parent just served `length_bytes` and retires it if idle.
+    void account(Node& parent, uint32_t child, uint32_t length_bytes);
+
+    void push_active(Node& parent, uint32_t child);
+    void pop_active(Node& parent);
+
+    std::vector<Node> nodes_;                  // nodes_[PORT_NODE] is the port, then by PolicyId
+    std::vector<policy::PolicyId> sorted_ids_; // Ascending: sorted_ids_[i] is the id of nodes_[i + 1]
+};
+
+} // namespace scheduler
+} // namespace hqts
+
+#endif // HQTS_SCHEDULER_SCHEDULER_TREE_H_
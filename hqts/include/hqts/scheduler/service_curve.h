@@ -0,0 +1,228 @@
+#ifndef HQTS_SCHEDULER_SERVICE_CURVE_H_
+#define HQTS_SCHEDULER_SERVICE_CURVE_H_
+
+#include <cstdint>
+#include <limits> // For std::numeric_limits
+
+namespace hqts {
+namespace scheduler {
+
+#if defined(__SIZEOF_INT128__)
+// 128-bit intermediate of the exact rate conversions; __extension__ keeps -Wpedantic quiet.
+__extension__ typedef unsigned __int128 u128;
+#endif
+
+/**
+ * @brief Two-piece linear service curve.
+ *
+ * The curve rises at initial_rate_bps for the first delay_us microseconds and at rate_bps
+ * afterwards. With initial_rate_bps == 0 (the default) delay_us is a pure delay before the
+ * rate applies; initial_rate_bps > rate_bps describes a concave curve that grants a burst.
+ * A curve with rate_bps == 0 is "not set".
+ */
+struct ServiceCurve {
+    uint64_t rate_bps;         // Long-term service rate in bits per second (0 means not set)
+    uint64_t delay_us;         // Length of the first segment in microseconds
+    uint64_t initial_rate_bps; // Slope of the first segment in bits per second
+
+    // Default constructor
+    ServiceCurve(uint64_t r = 0, uint64_t d = 0, uint64_t initial_r = 0)
+        : rate_bps(r), delay_us(d), initial_rate_bps(initial_r) {}
+};
+
+/**
+ * @brief Rate of one curve segment as two fixed-point factors, so converting between
+ *        nanoseconds and bytes is a multiply and a shift instead of a 64-bit division.
+ *
+ * Both factors are computed once from rate_bps (the only divisions). bytes_in() is exact
+ * to within one byte per 2^BYTES_SHIFT / (bytes per ns) of input, time_for() to a relative
+ * error below 2^-TIME_SHIFT / (ns per byte); see test_service_curve.cpp for the bounds
+ * checked against exact division.
+ */
+class CurveSlope {
+public:
+    static constexpr unsigned BYTES_SHIFT = 48; // bytes/ns scale; rates up to ~500 Tbps fit
+    static constexpr unsigned TIME_SHIFT = 32;  // ns/byte scale; rates down to 2 bps fit
+    static constexpr uint64_t INFINITE = std::numeric_limits<uint64_t>::max();
+    static constexpr uint64_t BIT_NS_PER_BYTE_SECOND = 8ULL * 1000000000ULL; // bits/byte * ns/s
+
+    CurveSlope() = default;
+
+    explicit CurveSlope(uint64_t rate_bps)
+        : bytes_per_ns_(scaled_ratio(rate_bps, BYTES_SHIFT, BIT_NS_PER_BYTE_SECOND)),
+          ns_per_byte_(rate_bps == 0 ? INFINITE : scaled_ratio(BIT_NS_PER_BYTE_SECOND, TIME_SHIFT, rate_bps)) {}
+
+    bool is_zero() const { return bytes_per_ns_ == 0; }
+
+    /** @brief Bytes served in duration_ns at this rate (rounded down, saturating). */
+    uint64_t bytes_in(uint64_t duration_ns) const { return mul_shift(duration_ns, bytes_per_ns_, BYTES_SHIFT); }
+
+    /** @brief Nanoseconds needed to serve `bytes` at this rate; INFINITE for a zero rate. */
+    uint64_t time_for(uint64_t bytes) const {
+        if (ns_per_byte_ == INFINITE) {
+            return bytes == 0 ? 0 : INFINITE;
+        }
+        return mul_shift(bytes, ns_per_byte_, TIME_SHIFT);
+    }
+
+    /** @brief bytes_in() by exact division, for values fixed at configuration time. */
+    static uint64_t exact_bytes_in(uint64_t duration_ns, uint64_t rate_bps) {
+#if defined(__SIZEOF_INT128__)
+        u128 result = static_cast<u128>(duration_ns) * rate_bps / BIT_NS_PER_BYTE_SECOND;
+        return result > INFINITE ? INFINITE : static_cast<uint64_t>(result);
+#else
+        long double result = static_cast<long double>(duration_ns) * rate_bps / BIT_NS_PER_BYTE_SECOND;
+        return result >= static_cast<long double>(INFINITE) ? INFINITE : static_cast<uint64_t>(result);
+#endif
+    }
+
+private:
+    // (a << shift) / b, saturating. Construction only.
+    static uint64_t scaled_ratio(uint64_t a, unsigned shift, uint64_t b) {
+#if defined(__SIZEOF_INT128__)
+        u128 result = (static_cast<u128>(a) << shift) / b;
+        return result > INFINITE - 1 ? INFINITE - 1 : static_cast<uint64_t>(result);
+#else
+        long double result = static_cast<long double>(a) * static_cast<long double>(uint64_t{1} << shift) / b;
+        return result >= static_cast<long double>(INFINITE - 1) ? INFINITE - 1 : static_cast<uint64_t>(result);
+#endif
+    }
+
+    // (a * factor) >> shift, saturating.
+    static uint64_t mul_shift(uint64_t a, uint64_t factor, unsigned shift) {
+#if defined(__SIZEOF_INT128__)
+        u128 result = (static_cast<u128>(a) * factor) >> shift;
+        return result > INFINITE ? INFINITE : static_cast<uint64_t>(result);
+#else
+        long double result = static_cast<long double>(a) * factor / static_cast<long double>(uint64_t{1} << shift);
+        return result >= static_cast<long double>(INFINITE) ? INFINITE : static_cast<uint64_t>(result);
+#endif
+    }
+
+    uint64_t bytes_per_ns_ = 0; // rate / 8e9 << BYTES_SHIFT
+    uint64_t ns_per_byte_ = INFINITE; // 8e9 / rate << TIME_SHIFT
+};
+
+inline uint64_t saturating_add(uint64_t a, uint64_t b) {
+    return a > CurveSlope::INFINITE - b ? CurveSlope::INFINITE : a + b;
+}
+
+/**
+ * @brief A ServiceCurve converted once into fixed-point slopes and segment lengths.
+ */
+struct InternalServiceCurve {
+    CurveSlope m1;
+    CurveSlope m2;
+    CurveSlope m1_minus_m2; // Concave curves only: closing speed used by RuntimeCurve::min_with
+    uint64_t dx_ns = 0;
+    uint64_t dy_bytes = 0;
+    bool concave = false;
+
+    InternalServiceCurve() = default;
+
+    explicit InternalServiceCurve(const ServiceCurve& sc)
+        : m1(sc.initial_rate_bps),
+          m2(sc.rate_bps),
+          m1_minus_m2(sc.initial_rate_bps > sc.rate_bps ? sc.initial_rate_bps - sc.rate_bps : 0),
+          dx_ns(sc.delay_us * 1000),
+          dy_bytes(CurveSlope::exact_bytes_in(sc.delay_us * 1000, sc.initial_rate_bps)),
+          concave(sc.initial_rate_bps > sc.rate_bps) {}
+};
+
+/**
+ * @brief Service curve anchored at (x_ns, y_bytes): the runtime form HFSC keeps per class.
+ *
+ * Curves whose first segment is empty (dx_ns == 0, the common zero-delay case) take a
+ * single-segment path in x2y()/y2x().
+ */
+struct RuntimeCurve {
+    uint64_t x_ns = 0;
+    uint64_t y_bytes = 0;
+    uint64_t dx_ns = 0;    // Length of the first segment
+    uint64_t dy_bytes = 0; // Bytes served over the first segment
+    CurveSlope m1;
+    CurveSlope m2;
+
+    void init(const InternalServiceCurve& sc, uint64_t x, uint64_t y) {
+        x_ns = x;
+        y_bytes = y;
+        dx_ns = sc.dx_ns;
+        dy_bytes = sc.dy_bytes;
+        m1 = sc.m1;
+        m2 = sc.m2;
+    }
+
+    /** @brief Bytes the curve has delivered by time x. */
+    uint64_t x2y(uint64_t x) const {
+        if (x <= x_ns) {
+            return y_bytes;
+        }
+        uint64_t elapsed = x - x_ns;
+        if (dx_ns == 0) {
+            return saturating_add(y_bytes, m2.bytes_in(elapsed));
+        }
+        if (elapsed <= dx_ns) {
+            return y_bytes + m1.bytes_in(elapsed);
+        }
+        return saturating_add(y_bytes + dy_bytes, m2.bytes_in(elapsed - dx_ns));
+    }
+
+    /** @brief Time at which the curve has delivered y bytes; INFINITE if it never does. */
+    uint64_t y2x(uint64_t y) const {
+        if (y < y_bytes) {
+            return x_ns;
+        }
+        if (dx_ns == 0) {
+            return saturating_add(x_ns, m2.time_for(y - y_bytes));
+        }
+        if (y == y_bytes) {
+            // A flat first segment (pure delay) is crossed before the curve moves past y.
+            return dy_bytes == 0 ? saturating_add(x_ns, dx_ns) : x_ns;
+        }
+        uint64_t served = y - y_bytes;
+        if (served <= dy_bytes) { // dy_bytes > 0 implies a non-zero m1
+            return saturating_add(x_ns, m1.time_for(served));
+        }
+        return saturating_add(saturating_add(x_ns, dx_ns), m2.time_for(served - dy_bytes));
+    }
+
+    /** @brief Replaces this curve by its pointwise minimum with `sc` anchored at (x, y). */
+    void min_with(const InternalServiceCurve& sc, uint64_t x, uint64_t y) {
+        if (!sc.concave) {
+            // Convex curve: the minimum is whichever curve is lower at x.
+            if (x2y(x) < y) {
+                return;
+            }
+            x_ns = x;
+            y_bytes = y;
+            return;
+        }
+
+        uint64_t y1 = x2y(x);
+        if (y1 <= y) {
+            return; // This curve is below the new one
+        }
+        uint64_t y2 = x2y(saturating_add(x, sc.dx_ns));
+        if (y2 >= y + sc.dy_bytes) {
+            init(sc, x, y); // This curve is above the new one
+            return;
+        }
+
+        // The curves intersect inside the new curve's first segment.
+        uint64_t dx = sc.m1_minus_m2.time_for(y1 - y);
+        if (x_ns + dx_ns > x) {
+            dx += x_ns + dx_ns - x;
+        }
+        x_ns = x;
+        y_bytes = y;
+        dx_ns = dx;
+        dy_bytes = sc.m1.bytes_in(dx);
+        m1 = sc.m1;
+        m2 = sc.m2;
+    }
+};
+
+} // namespace scheduler
+} // namespace hqts
+
+#endif // HQTS_SCHEDULER_SERVICE_CURVE_H_
@@ -0,0 +1,420 @@
+#ifndef HQTS_SCHEDULER_STATIC_SCHEDULER_H_
+#define HQTS_SCHEDULER_STATIC_SCHEDULER_H_
+
+#include "hqts/scheduler/scheduler_interface.h"
+#include "hqts/scheduler/any_aqm_queue.h"          // For AqmQueue, the AQM queues and their parameters
+#include "hqts/scheduler/packet_descriptor_pool.h" // For PacketDescriptorPool
+#include "hqts/scheduler/priority_bitmap.h"        // For highest_set_bit
+#include "hqts/core/packet_buffer_pool.h"          // For PacketBufferPool::release_any
+
+#include <array>
+#include <cstddef>   // For size_t
+#include <cstdint>
+#include <memory>    // For std::shared_ptr
+#include <optional>
+#include <stdexcept> // For std::invalid_argument, std::runtime_error
+#include <utility>   // For std::index_sequence, std::move
+#include <vector>
+
+namespace hqts {
+namespace scheduler {
+
+// Statically composed scheduler hierarchies.
+//
+// The runtime schedulers (StrictPriorityScheduler, DrrScheduler, ...) are chosen and
+// configured at run time and reached through SchedulerInterface. When the shape of the
+// hierarchy is known at compile time it can instead be spelled as a type, e.g.
+//
+//   using Port = StaticScheduler<StaticDrr<StaticStrictPriority<StaticQueue<RedAqmQueue>, 4,
+//                                                                PriorityBits<0, 2>>,
+//                                          8, PriorityBits<2, 3>>>;
+//
+// (8 DRR classes, each with 4 strict-priority RED queues, the class taken from priority
+// bits 2..4 and the level from bits 0..1). Every level calls its children directly, so the
+// compiler can inline enqueue and dequeue end to end; there are no virtual calls. A level
+// ("node") provides:
+//
+//   using Config = ...;                                         // Per-node configuration
+//   Node(const Config&, const std::shared_ptr<PacketDescriptorPool>&);
+//   static uint64_t capacity_bytes(const Config&);              // Aggregate queue capacity
+//   EnqueueResult enqueue(PacketDescriptor);                    // Releases dropped buffers
+//   std::optional<PacketDescriptor> try_dequeue();
+//   bool is_empty() const;
+//   uint32_t front_length() const;                              // Only if !is_empty()
+//
+// StaticScheduler wraps the root node with the burst calls PacketPipeline uses, and
+// StaticSchedulerAdapter puts one behind SchedulerInterface where a virtual scheduler is
+// required (e.g. ShardedRuntime).
+
+/**
+ * @brief Child selector: field [Shift, Shift + Width) of PacketDescriptor::priority.
+ */
+template <unsigned Shift, unsigned Width>
+struct PriorityBits {
+    static_assert(Width >= 1 && Shift + Width <= 8, "PriorityBits: the field must lie within the 8-bit priority.");
+
+    static size_t select(const PacketDescriptor& packet) {
+        return (static_cast<size_t>(packet.priority) >> Shift) & ((size_t{1} << Width) - 1);
+    }
+};
+
+/** @brief Parameter type of each queue StaticQueue can hold. */
+template <typename Queue>
+struct StaticQueueTraits;
+
+template <>
+struct StaticQueueTraits<RedAqmQueue> { using Parameters = RedAqmParameters; };
+template <>
+struct StaticQueueTraits<CoDelQueue> { using Parameters = CoDelParameters; };
+template <>
+struct StaticQueueTraits<FqCoDelQueue> { using Parameters = FqCoDelParameters; };
+template <>
+struct StaticQueueTraits<AqmQueue> { using Parameters = AqmParameters; };
+
+/**
+ * @brief Leaf node: one AQM queue (RedAqmQueue, CoDelQueue, FqCoDelQueue or AqmQueue).
+ */
+template <typename Queue>
+class StaticQueue {
+public:
+    using Config = typename StaticQueueTraits<Queue>::Parameters;
+
+    StaticQueue(const Config& config, const std::shared_ptr<PacketDescriptorPool>& descriptor_pool)
+        : queue_(config, descriptor_pool) {}
+
+    static uint64_t capacity_bytes(const Config& config) { return aqm_queue_capacity_bytes(config); }
+
+    EnqueueResult enqueue(PacketDescriptor packet) {
+        // The queue releases the buffer of a packet it refuses.
+        return queue_.enqueue(std::move(packet)) ? EnqueueResult::ENQUEUED : EnqueueResult::DROPPED_BY_QUEUE;
+    }
+
+    std::optional<PacketDescriptor> try_dequeue() {
+        if (queue_.is_empty()) {
+            return std::nullopt;
+        }
+        return queue_.dequeue(); // CoDel may drop packets ahead of the one returned
+    }
+
+    bool is_empty() const { return queue_.is_empty(); }
+    uint32_t front_length() const { return queue_.front().packet_length_bytes; }
+
+    const Queue& queue() const { return queue_; }
+
+private:
+    Queue queue_;
+};
+
+namespace static_scheduler_detail {
+
+// Builds the children in place (no copies or moves) from their configurations.
+template <typename Child, size_t N, typename ChildConfigs, size_t... I>
+std::array<Child, N> make_children(const ChildConfigs& configs,
+                                   const std::shared_ptr<PacketDescriptorPool>& descriptor_pool,
+                                   std::index_sequence<I...>) {
+    return {{Child(configs[I], descriptor_pool)...}};
+}
+
+template <typename Child, size_t N, typename ChildConfigs>
+uint64_t sum_capacity_bytes(const ChildConfigs& configs) {
+    uint64_t total = 0;
+    for (const auto& config : configs) {
+        total += Child::capacity_bytes(config);
+    }
+    return total;
+}
+
+} // namespace static_scheduler_detail
+
+/**
+ * @brief Strict priority over N children; the highest-indexed backlogged child is served.
+ *
+ * As StrictPriorityScheduler, numerically higher indexes have higher priority. Selector
+ * maps a packet to its child; a packet whose index is N or more is dropped.
+ */
+template <typename Child, size_t N, typename Selector = PriorityBits<0, 8>>
+class StaticStrictPriority {
+    static_assert(N >= 1 && N <= 64, "StaticStrictPriority: 1 to 64 children (one backlog word).");
+
+public:
+    using Config = std::array<typename Child::Config, N>;
+
+    StaticStrictPriority(const Config& config, const std::shared_ptr<PacketDescriptorPool>& descriptor_pool)
+        : children_(static_scheduler_detail::make_children<Child, N>(config, descriptor_pool,
+                                                                     std::make_index_sequence<N>{})) {}
+
+    static uint64_t capacity_bytes(const Config& config) {
+        return static_scheduler_detail::sum_capacity_bytes<Child, N>(config);
+    }
+
+    EnqueueResult enqueue(PacketDescriptor packet) {
+        const size_t index = Selector::select(packet);
+        if (index >= N) {
+            core::PacketBufferPool::release_any(packet.buffer);
+            return EnqueueResult::DROPPED_NO_QUEUE;
+        }
+        EnqueueResult result = children_[index].enqueue(std::move(packet));
+        if (result == EnqueueResult::ENQUEUED) {
+            backlog_ |= uint64_t{1} << index;
+        }
+        return result;
+    }
+
+    std::optional<PacketDescriptor> try_dequeue() {
+        if (backlog_ == 0) {
+            return std::nullopt;
+        }
+        const size_t index = highest_set_bit(backlog_);
+        Child& child = children_[index];
+        std::optional<PacketDescriptor> packet = child.try_dequeue();
+        if (child.is_empty()) {
+            backlog_ &= ~(uint64_t{1} << index);
+        }
+        return packet;
+    }
+
+    bool is_empty() const { return backlog_ == 0; }
+    uint32_t front_length() const { return children_[highest_set_bit(backlog_)].front_length(); }
+
+    /** @throws std::out_of_range if index >= N. */
+    const Child& child(size_t index) const { return children_.at(index); }
+
+private:
+    std::array<Child, N> children_;
+    uint64_t backlog_ = 0; // Bit i set while child i is non-empty
+};
+
+/**
+ * @brief Deficit round robin over N children, as DrrScheduler does over its queues.
+ *
+ * A child's turn lasts while its deficit covers its front_length(); when the child is
+ * itself a scheduler the packet it then sends may differ from the one it reported, and
+ * the actual length is charged. Selector maps a packet to its child; a packet whose index
+ * is N or more is dropped.
+ */
+template <typename Child, size_t N, typename Selector = PriorityBits<0, 8>>
+class StaticDrr {
+    static_assert(N >= 1, "StaticDrr: at least one child.");
+
+public:
+    struct Config {
+        std::array<uint32_t, N> quantum_bytes;
+        std::array<typename Child::Config, N> children;
+    };
+
+    /**
+     * @throws std::invalid_argument if any quantum_bytes is 0.
+     */
+    StaticDrr(const Config& config, const std::shared_ptr<PacketDescriptorPool>& descriptor_pool)
+        : children_(static_scheduler_detail::make_children<Child, N>(config.children, descriptor_pool,
+                                                                     std::make_index_sequence<N>{})) {
+        for (size_t i = 0; i < N; ++i) {
+            if (config.quantum_bytes[i] == 0) {
+                throw std::invalid_argument("StaticDrr: quantum_bytes must be greater than 0 for every child.");
+            }
+            slots_[i].quantum_bytes = config.quantum_bytes[i];
+        }
+    }
+
+    static uint64_t capacity_bytes(const Config& config) {
+        return static_scheduler_detail::sum_capacity_bytes<Child, N>(config.children);
+    }
+
+    EnqueueResult enqueue(PacketDescriptor packet) {
+        const size_t index = Selector::select(packet);
+        if (index >= N) {
+            core::PacketBufferPool::release_any(packet.buffer);
+            return EnqueueResult::DROPPED_NO_QUEUE;
+        }
+        EnqueueResult result = children_[index].enqueue(std::move(packet));
+        if (result == EnqueueResult::ENQUEUED && !slots_[index].is_active) {
+            push_active(index);
+        }
+        return result;
+    }
+
+    std::optional<PacketDescriptor> try_dequeue() {
+        if (active_head_ == NO_CHILD) {
+            return std::nullopt;
+        }
+        // Every active child is backlogged, so each iteration sends or ends a turn.
+        for (;;) {
+            const size_t index = active_head_;
+            Slot& slot = slots_[index];
+            if (!slot.quantum_granted) {
+                slot.deficit += slot.quantum_bytes;
+                slot.quantum_granted = true;
+            }
+            Child& child = children_[index];
+            if (slot.deficit >= static_cast<int64_t>(child.front_length())) {
+                std::optional<PacketDescriptor> packet = child.try_dequeue();
+                slot.deficit -= packet->packet_length_bytes;
+                if (child.is_empty()) {
+                    pop_active();
+                    slot.deficit = 0; // An idle child does not keep its unused deficit
+                }
+                return packet;
+            }
+            pop_active(); // End of turn, deficit carries over
+            push_active(index);
+        }
+    }
+
+    bool is_empty() const { return active_head_ == NO_CHILD; }
+    uint32_t front_length() const { return children_[active_head_].front_length(); }
+
+    /** @throws std::out_of_range if index >= N. */
+    const Child& child(size_t index) const { return children_.at(index); }
+
+private:
+    static constexpr size_t NO_CHILD = static_cast<size_t>(-1);
+
+    struct Slot {
+        int64_t deficit = 0;
+        uint32_t quantum_bytes = 0;
+        size_t next_active = NO_CHILD; // Next child in the active list (NO_CHILD at the tail)
+        bool is_active = false;
+        bool quantum_granted = false;  // Quantum already added for the current turn
+    };
+
+    void push_active(size_t index) {
+        Slot& slot = slots_[index];
+        slot.next_active = NO_CHILD;
+        slot.is_active = true;
+        slot.quantum_granted = false;
+        if (active_tail_ == NO_CHILD) {
+            active_head_ = index;
+        } else {
+            slots_[active_tail_].next_active = index;
+        }
+        active_tail_ = index;
+    }
+
+    void pop_active() {
+        Slot& slot = slots_[active_head_];
+        active_head_ = slot.next_active;
+        if (active_head_ == NO_CHILD) {
+            active_tail_ = NO_CHILD;
+        }
+        slot.is_active = false;
+    }
+
+    std::array<Child, N> children_;
+    std::array<Slot, N> slots_{};
+    size_t active_head_ = NO_CHILD;
+    size_t active_tail_ = NO_CHILD;
+};
+
+/**
+ * @brief Root of a static hierarchy: owns the descriptor pool its queues share and offers
+ *        the same enqueue/dequeue surface as SchedulerInterface, without virtual calls.
+ *
+ * Usable as the Scheduler type of BasicPacketPipeline.
+ */
+template <typename Root>
+class StaticScheduler {
+public:
+    using Config = typename Root::Config;
+
+    /**
+     * @param config Configuration of the root node.
+     * @param descriptor_pool Optional pool shared by all queues. If null, one is sized from
+     *                        the queues' aggregate capacity.
+     */
+    explicit StaticScheduler(const Config& config, std::shared_ptr<PacketDescriptorPool> descriptor_pool = nullptr)
+        : descriptor_pool_(descriptor_pool ? std::move(descriptor_pool)
+                                           : PacketDescriptorPool::create_for_bytes(Root::capacity_bytes(config))),
+          root_(config, descriptor_pool_) {}
+
+    StaticScheduler(const StaticScheduler&) = delete;
+    StaticScheduler& operator=(const StaticScheduler&) = delete;
+
+    /** @see SchedulerInterface::enqueue */
+    EnqueueResult enqueue(PacketDescriptor packet) { return root_.enqueue(std::move(packet)); }
+
+    /** @see SchedulerInterface::try_dequeue */
+    std::optional<PacketDescriptor> try_dequeue() { return root_.try_dequeue(); }
+
+    /**
+     * @brief Dequeues the next packet.
+     * @throws std::runtime_error if the scheduler is empty.
+     */
+    PacketDescriptor dequeue() {
+        std::optional<PacketDescriptor> packet = root_.try_dequeue();
+        if (!packet) {
+            throw std::runtime_error("StaticScheduler: Scheduler is empty, cannot dequeue.");
+        }
+        return *packet;
+    }
+
+    bool is_empty() const { return root_.is_empty(); }
+
+    /** @see SchedulerInterface::enqueue_burst */
+    size_t enqueue_burst(PacketDescriptor* packets, size_t count) {
+        size_t enqueued = 0;
+        for (size_t i = 0; i < count; ++i) {
+            if (root_.enqueue(std::move(packets[i])) == EnqueueResult::ENQUEUED) {
+                ++enqueued;
+            }
+        }
+        return enqueued;
+    }
+
+    /** @see SchedulerInterface::dequeue_burst */
+    size_t dequeue_burst(std::vector<PacketDescriptor>& out, size_t max_packets) {
+        size_t dequeued = 0;
+        while (dequeued < max_packets) {
+            std::optional<PacketDescriptor> packet = root_.try_dequeue();
+            if (!packet) {
+                break;
+            }
+            out.push_back(*packet);
+            ++dequeued;
+        }
+        return dequeued;
+    }
+
+    Root& root() { return root_; }
+    const Root& root() const { return root_; }
+
+private:
+    std::shared_ptr<PacketDescriptorPool> descriptor_pool_;
+    Root root_;
+};
+
+/**
+ * @brief A static hierarchy behind SchedulerInterface, for components that take a runtime
+ *        scheduler. The hierarchy itself is still inlined: calls are virtual once per
+ *        packet (or burst) at the adapter, never between levels.
+ */
+template <typename Root>
+class StaticSchedulerAdapter final : public SchedulerInterface {
+public:
+    /** @see StaticScheduler::StaticScheduler */
+    explicit StaticSchedulerAdapter(const typename Root::Config& config,
+                                    std::shared_ptr<PacketDescriptorPool> descriptor_pool = nullptr)
+        : scheduler_(config, std::move(descriptor_pool)) {}
+
+    EnqueueResult enqueue(PacketDescriptor packet) override { return scheduler_.enqueue(std::move(packet)); }
+    std::optional<PacketDescriptor> try_dequeue() override { return scheduler_.try_dequeue(); }
+    bool is_empty() const override { return scheduler_.is_empty(); }
+
+    size_t enqueue_burst(PacketDescriptor* packets, size_t count) override {
+        return scheduler_.enqueue_burst(packets, count);
+    }
+
+    size_t dequeue_burst(std::vector<PacketDescriptor>& out, size_t max_packets) override {
+        return scheduler_.dequeue_burst(out, max_packets);
+    }
+
+    StaticScheduler<Root>& scheduler() { return scheduler_; }
+    const StaticScheduler<Root>& scheduler() const { return scheduler_; }
+
+private:
+    StaticScheduler<Root> scheduler_;
+};
+
+} // namespace scheduler
+} // namespace hqts
+
+#endif // HQTS_SCHEDULER_STATIC_SCHEDULER_H_
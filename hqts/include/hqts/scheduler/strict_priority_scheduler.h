@@ -3,7 +3,8 @@
 
 #include "hqts/scheduler/scheduler_interface.h"
 // #include "hqts/scheduler/queue_types.h" // PacketQueue no longer directly used
-#include "hqts/scheduler/aqm_queue.h"     // For RedAqmQueue and RedAqmParameters
+#include "hqts/scheduler/any_aqm_queue.h" // For AqmQueue and AqmParameters (RED, CoDel, FQ-CoDel)
+#include "hqts/scheduler/priority_bitmap.h" // For PriorityBitmap
 
 #include <vector>
 #include <stdexcept> // For std::out_of_range, std::invalid_argument, std::runtime_error
@@ -19,16 +20,31 @@ namespace scheduler {
  * This scheduler manages multiple priority queues. Packets are always dequeued
  * from the highest-priority non-empty queue. Numerically higher priority values
  * are treated as higher scheduling priority (e.g., priority 7 is served before priority 0).
+ *
+ * A PriorityBitmap of non-empty levels is kept up to date on enqueue and dequeue, so
+ * selecting the level to serve is O(1) for any number of levels (up to the 256 that
+ * PacketDescriptor::priority can address).
  */
 class StrictPriorityScheduler : public SchedulerInterface {
 public:
     /**
      * @brief Constructs a StrictPriorityScheduler with AQM-enabled queues.
-     * @param queue_params_list A vector of RedAqmParameters, one for each priority queue.
-     *                          The number of elements determines the number of priority levels.
-     * @throws std::invalid_argument if queue_params_list is empty.
+     * @param queue_params_list AQM parameters (RED/WRED, CoDel or FQ-CoDel), one for each
+     *                          priority queue. The number of elements determines the number
+     *                          of priority levels.
+     * @param descriptor_pool Optional pool shared by all levels (and possibly other schedulers).
+     *                        If null, one is sized from the levels' aggregate queue_capacity_bytes.
+     * @throws std::invalid_argument if queue_params_list is empty or has more than 256 levels.
+     */
+    explicit StrictPriorityScheduler(const std::vector<AqmParameters>& queue_params_list,
+                                     std::shared_ptr<PacketDescriptorPool> descriptor_pool = nullptr);
+
+    /**
+     * @brief Constructs a StrictPriorityScheduler whose levels all use RED.
+     * @see StrictPriorityScheduler(const std::vector<AqmParameters>&, std::shared_ptr<PacketDescriptorPool>)
      */
-    explicit StrictPriorityScheduler(const std::vector<RedAqmParameters>& queue_params_list);
+    explicit StrictPriorityScheduler(const std::vector<RedAqmParameters>& queue_params_list,
+                                     std::shared_ptr<PacketDescriptorPool> descriptor_pool = nullptr);
 
     ~StrictPriorityScheduler() override = default;
 
@@ -42,16 +58,16 @@ public:
     /**
      * @brief Enqueues a packet based on its priority.
      * @param packet The packet to enqueue. packet.priority determines the queue.
-     * @throws std::out_of_range if packet.priority is >= num_priority_levels.
+     * @return DROPPED_NO_QUEUE if packet.priority is >= num_priority_levels,
+     *         DROPPED_BY_QUEUE if the level's AQM refused it, else ENQUEUED.
      */
-    void enqueue(PacketDescriptor packet) override;
+    EnqueueResult enqueue(PacketDescriptor packet) override;
 
     /**
      * @brief Dequeues a packet from the highest-priority non-empty queue.
-     * @return The dequeued PacketDescriptor.
-     * @throws std::runtime_error if the scheduler is empty.
+     * @return The dequeued PacketDescriptor, or std::nullopt if the scheduler is empty.
      */
-    PacketDescriptor dequeue() override;
+    std::optional<PacketDescriptor> try_dequeue() override;
 
     /**
      * @brief Checks if the scheduler is empty (no packets in any queue).
@@ -59,6 +75,18 @@ public:
      */
     bool is_empty() const override;
 
+    /**
+     * @brief Enqueues a burst of packets with a single virtual dispatch.
+     * @see SchedulerInterface::enqueue_burst
+     */
+    size_t enqueue_burst(PacketDescriptor* packets, size_t count) override;
+
+    /**
+     * @brief Dequeues up to max_packets packets with a single virtual dispatch.
+     * @see SchedulerInterface::dequeue_burst
+     */
+    size_t dequeue_burst(std::vector<PacketDescriptor>& out, size_t max_packets) override;
+
     /**
      * @brief Gets the configured number of priority levels.
      * @return The number of priority levels.
@@ -73,9 +101,42 @@ public:
      */
     size_t get_queue_size(uint8_t priority_level) const;
 
+    /**
+     * @brief Starts recording the sojourn time of every packet at every level
+     *        (see AqmQueue::enable_latency_histogram()). Call from the thread that owns
+     *        the scheduler; costs one clock read per enqueue and per dequeue.
+     */
+    void enable_latency_histograms();
+
+    /**
+     * @brief Snapshot of a level's sojourn-time histogram; empty until
+     *        enable_latency_histograms() is called. Callable from any thread.
+     * @throws std::out_of_range if priority_level is >= num_priority_levels.
+     */
+    LatencySnapshot get_queue_latency(uint8_t priority_level) const;
+
+    /**
+     * @brief Appends one sample per priority level, keyed by the level.
+     * @see SchedulerInterface::collect_queue_stats
+     */
+    size_t collect_queue_stats(std::vector<QueueStatsSample>& out) const override;
+
+    /**
+     * @brief Bitmap of the currently non-empty priority levels, for parent schedulers
+     *        that need to check this scheduler's backlog without dequeuing.
+     */
+    const PriorityBitmap& backlog_bitmap() const { return backlogged_levels_; }
+
+    /**
+     * @brief The priority level the next try_dequeue() will serve.
+     * @return The level, or PriorityBitmap::NO_LEVEL if the scheduler is empty.
+     */
+    size_t highest_backlogged_level() const { return backlogged_levels_.highest(); }
+
 private:
-    std::vector<RedAqmQueue> priority_queues_; // Now a vector of RedAqmQueues
+    std::vector<AqmQueue> priority_queues_;
     const size_t num_levels_;
+    PriorityBitmap backlogged_levels_; // Bit set while the level's queue is non-empty
     size_t total_packets_ = 0; // Total number of packets successfully enqueued across all AQM queues
 };
 
@@ -0,0 +1,192 @@
+#ifndef HQTS_SCHEDULER_WFQ_SCHEDULER_H_
+#define HQTS_SCHEDULER_WFQ_SCHEDULER_H_
+
+#include "hqts/scheduler/scheduler_interface.h"
+#include "hqts/scheduler/any_aqm_queue.h" // For AqmQueue and AqmParameters (RED, CoDel or FQ-CoDel)
+#include "hqts/core/flow_context.h"       // For core::QueueId
+
+#include <array>
+#include <cstddef> // For size_t
+#include <cstdint>
+#include <map>
+#include <memory>  // For std::shared_ptr
+#include <optional>
+#include <vector>
+
+namespace hqts {
+namespace scheduler {
+
+/**
+ * @brief Implements a Worst-case Fair Weighted Fair Queueing (WF²Q+) Scheduler.
+ *
+ * Each backlogged queue carries the virtual start and finish tags of its head packet:
+ * S = max(V, F_previous) when the queue becomes backlogged, S = F_previous while it stays
+ * backlogged, and F = S + length / weight. A queue is eligible once S <= V, and each
+ * dequeue serves the eligible queue with the smallest F (Bennett and Zhang). Serving only
+ * eligible queues keeps a heavy queue from sending its packets back to back ahead of the
+ * lighter ones, so every queue stays within one packet of its GPS (fluid) service, a
+ * tighter bound than DRR's one quantum. After each packet V advances by
+ * length / (sum of backlogged weights), and never lags the smallest start tag.
+ *
+ * Backlogged queues sit in one of two binary min-heaps: eligible queues keyed by finish
+ * tag, ineligible ones keyed by start tag. A queue is in exactly one heap while it is
+ * backlogged and only heap tops are ever removed, so enqueue and dequeue are O(log n) in
+ * the number of backlogged queues; idle queues cost nothing. Both heaps are reserved for
+ * every queue at construction, so steady-state operation does not allocate.
+ *
+ * Tags are fixed point (TAG_SHIFT fractional bits) and compared modulo 2^64, as in Linux
+ * QFQ, so the virtual clock may wrap.
+ *
+ * Note: As in DrrScheduler, enqueue() uses PacketDescriptor::priority as the core::QueueId
+ * (so it reaches ids 0-255); enqueue_to_queue() addresses any configured queue.
+ */
+class WfqScheduler : public SchedulerInterface {
+public:
+    /// Fractional bits of virtual time: one byte at weight 1 is 2^TAG_SHIFT.
+    static constexpr uint32_t TAG_SHIFT = 24;
+
+    struct QueueConfig {
+        core::QueueId id;         // User-defined ID for the queue
+        uint32_t weight;          // Share of the link relative to other queues (must be > 0)
+        AqmParameters aqm_params; // AQM parameters for this queue (RED/WRED, CoDel or FQ-CoDel)
+
+        QueueConfig(core::QueueId q_id, uint32_t q_weight, AqmParameters aqm_p)
+            : id(q_id), weight(q_weight), aqm_params(std::move(aqm_p)) {}
+    };
+
+    /**
+     * @brief Constructs a WfqScheduler.
+     * @param queue_configs A vector of QueueConfig structs.
+     * @param descriptor_pool Optional pool shared by all queues (and possibly other schedulers).
+     *                        If null, one is sized from the queues' aggregate queue_capacity_bytes.
+     * @throws std::invalid_argument if queue_configs is empty or any queue has weight = 0 or duplicate IDs.
+     */
+    explicit WfqScheduler(const std::vector<QueueConfig>& queue_configs,
+                          std::shared_ptr<PacketDescriptorPool> descriptor_pool = nullptr);
+
+    ~WfqScheduler() override = default;
+
+    WfqScheduler(const WfqScheduler&) = delete;
+    WfqScheduler& operator=(const WfqScheduler&) = delete;
+    WfqScheduler(WfqScheduler&&) = default;
+    WfqScheduler& operator=(WfqScheduler&&) = default;
+
+    /**
+     * @brief Enqueues a packet. PacketDescriptor::priority is used as core::QueueId.
+     * @param packet The packet to enqueue.
+     * @return DROPPED_NO_QUEUE if packet.priority (as QueueId) is not a configured queue,
+     *         DROPPED_BY_QUEUE if the queue's AQM refused it, else ENQUEUED.
+     */
+    EnqueueResult enqueue(PacketDescriptor packet) override;
+
+    /**
+     * @brief Enqueues a packet into the queue `queue_id`, which may be any configured id.
+     * @return As enqueue().
+     */
+    EnqueueResult enqueue_to_queue(core::QueueId queue_id, PacketDescriptor packet);
+
+    /**
+     * @brief Dequeues the head packet of the eligible queue with the smallest finish tag.
+     * @return The dequeued PacketDescriptor, or std::nullopt if the scheduler is empty.
+     */
+    std::optional<PacketDescriptor> try_dequeue() override;
+
+    /**
+     * @brief Checks if the scheduler is empty.
+     * @return True if all queues are empty, false otherwise.
+     */
+    bool is_empty() const override;
+
+    /**
+     * @brief Enqueues a burst of packets with a single virtual dispatch.
+     * @see SchedulerInterface::enqueue_burst
+     */
+    size_t enqueue_burst(PacketDescriptor* packets, size_t count) override;
+
+    /**
+     * @brief Dequeues up to max_packets packets with a single virtual dispatch.
+     * @see SchedulerInterface::dequeue_burst
+     */
+    size_t dequeue_burst(std::vector<PacketDescriptor>& out, size_t max_packets) override;
+
+    /**
+     * @brief Gets the current number of packets in a specific queue.
+     * @param queue_id The external ID of the queue.
+     * @return The number of packets in that queue.
+     * @throws std::out_of_range if queue_id is not a configured queue.
+     */
+    size_t get_queue_size(core::QueueId queue_id) const;
+
+    /**
+     * @brief Starts recording the sojourn time of every packet in every queue
+     *        (see AqmQueue::enable_latency_histogram()). Call from the thread that owns
+     *        the scheduler; costs one clock read per enqueue and per dequeue.
+     */
+    void enable_latency_histograms();
+
+    /**
+     * @brief Snapshot of a queue's sojourn-time histogram; empty until
+     *        enable_latency_histograms() is called. Callable from any thread.
+     * @throws std::out_of_range if queue_id is not a configured queue.
+     */
+    LatencySnapshot get_queue_latency(core::QueueId queue_id) const;
+
+    /**
+     * @brief Appends one sample per configured queue, keyed by its QueueId.
+     * @see SchedulerInterface::collect_queue_stats
+     */
+    size_t collect_queue_stats(std::vector<QueueStatsSample>& out) const override;
+
+    /**
+     * @brief Gets the number of configured queues.
+     * @return The number of queues.
+     */
+    size_t get_num_queues() const;
+
+    /** @brief The current virtual time V, in 2^-TAG_SHIFT byte units. */
+    uint64_t get_virtual_time() const { return virtual_time_; }
+
+private:
+    struct InternalQueueState {
+        AqmQueue packet_queue;
+        uint32_t weight;
+        core::QueueId external_id;
+        uint64_t start_tag;  // S of the head packet (while backlogged)
+        uint64_t finish_tag; // F of the head packet; kept when the queue empties
+
+        InternalQueueState(core::QueueId ext_id, uint32_t q_weight, const AqmParameters& aqm_p,
+                           std::shared_ptr<PacketDescriptorPool> pool)
+            : packet_queue(aqm_p, std::move(pool)), weight(q_weight), external_id(ext_id),
+              start_tag(0), finish_tag(0) {}
+    };
+
+    struct HeapEntry {
+        uint64_t tag;
+        size_t queue; // Internal index
+    };
+
+    static constexpr size_t NO_QUEUE = static_cast<size_t>(-1);
+
+    /// Heap order: `a` is served after `b` (std heaps keep the greatest element on top).
+    static bool heap_later(const HeapEntry& a, const HeapEntry& b);
+
+    /// Enqueues into the queue at `index` (a valid internal index).
+    EnqueueResult enqueue_at(size_t index, PacketDescriptor packet);
+    /// Sets the queue's finish tag for its new head packet and files it in the right heap.
+    void schedule_head(size_t index);
+
+    std::vector<InternalQueueState> queues_;
+    std::map<core::QueueId, size_t> queue_id_to_index_;
+    std::array<size_t, 256> index_by_priority_; // Queues with ids 0..255, NO_QUEUE elsewhere
+
+    std::vector<HeapEntry> eligible_;   // Min-heap by finish tag: S <= V
+    std::vector<HeapEntry> ineligible_; // Min-heap by start tag: S > V
+    uint64_t virtual_time_ = 0;
+    uint64_t backlogged_weight_ = 0;    // Sum of the weights of backlogged queues
+    size_t total_packets_ = 0;
+};
+
+} // namespace scheduler
+} // namespace hqts
+
+#endif // HQTS_SCHEDULER_WFQ_SCHEDULER_H_
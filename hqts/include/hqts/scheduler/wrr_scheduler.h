@@ -3,9 +3,10 @@
 
 #include "hqts/scheduler/scheduler_interface.h"
 // #include "hqts/scheduler/queue_types.h" // No longer directly used for PacketQueue
-#include "hqts/scheduler/aqm_queue.h"     // For RedAqmQueue and RedAqmParameters
+#include "hqts/scheduler/any_aqm_queue.h" // For AqmQueue and AqmParameters (RED, CoDel, FQ-CoDel)
 #include "hqts/core/flow_context.h"     // For core::QueueId
 
+#include <array>
 #include <vector>
 #include <map>
 #include <stdexcept> // For std::out_of_range, std::invalid_argument, std::runtime_error, std::logic_error
@@ -17,12 +18,32 @@ namespace hqts {
 namespace scheduler {
 
 /**
- * @brief Implements a packet-based Weighted Round Robin (WRR) Scheduler.
+ * @brief How a WrrScheduler turns weights into service.
+ */
+enum class WrrMode {
+    PACKET,      ///< A turn sends up to `weight` packets back to back (classic WRR).
+    BYTE,        ///< A turn sends up to `weight * bytes_per_weight` bytes; deficit carries over (DRR-style).
+    INTERLEAVED  ///< Each round is `max weight` passes; a queue sends one packet per pass
+                 ///< while it has turns left in the round (interleaved WRR), so its
+                 ///< packets are spread across the round instead of sent in one burst.
+};
+
+/**
+ * @brief WrrScheduler tuning.
+ */
+struct WrrOptions {
+    WrrMode mode = WrrMode::PACKET;
+    uint32_t bytes_per_weight = 1500; ///< BYTE mode: bytes credited per unit of weight and turn (> 0)
+};
+
+/**
+ * @brief Implements a Weighted Round Robin (WRR) Scheduler.
  *
- * This scheduler serves a configured set of queues. Each queue has a weight.
- * In each round, queues are visited. A queue can dequeue a number of packets
- * proportional to its weight (in this simple packet WRR, it means it gets
- * 'weight' chances to send one packet if its deficit allows).
+ * This scheduler serves a configured set of queues. Each queue has a weight that
+ * sets its share of service per round (in packets, or in bytes in WrrMode::BYTE).
+ * Only backlogged queues are visited: they are linked into an active list when their
+ * first packet arrives and leave it when they run empty, so dequeue() is O(1)
+ * amortized however many queues are configured.
  *
  * Note: For this implementation, PacketDescriptor::priority is used as the
  * core::QueueId to determine which queue to enqueue into. This is a simplification.
@@ -32,18 +53,30 @@ public:
     struct QueueConfig {
         core::QueueId id; // User-defined ID for the queue
         uint32_t weight;  // Weight for this queue (must be > 0)
-        RedAqmParameters aqm_params; // New member
+        AqmParameters aqm_params; // AQM parameters for this queue (RED/WRED, CoDel or FQ-CoDel)
 
-        QueueConfig(core::QueueId q_id, uint32_t w, RedAqmParameters aqm_p)
+        QueueConfig(core::QueueId q_id, uint32_t w, AqmParameters aqm_p)
             : id(q_id), weight(w), aqm_params(std::move(aqm_p)) {}
     };
 
     /**
      * @brief Constructs a WrrScheduler.
      * @param queue_configs A vector of QueueConfig structs defining the queues and their weights.
+     * @param descriptor_pool Optional pool shared by all queues (and possibly other schedulers).
+     *                        If null, one is sized from the queues' aggregate queue_capacity_bytes.
      * @throws std::invalid_argument if queue_configs is empty or any queue has weight 0.
      */
-    explicit WrrScheduler(const std::vector<QueueConfig>& queue_configs);
+    explicit WrrScheduler(const std::vector<QueueConfig>& queue_configs,
+                          std::shared_ptr<PacketDescriptorPool> descriptor_pool = nullptr);
+
+    /**
+     * @brief Constructs a WrrScheduler with an explicit service mode.
+     * @param options Mode and byte-mode credit.
+     * @throws std::invalid_argument as above, or if options.bytes_per_weight is 0.
+     */
+    WrrScheduler(const std::vector<QueueConfig>& queue_configs,
+                 const WrrOptions& options,
+                 std::shared_ptr<PacketDescriptorPool> descriptor_pool = nullptr);
 
     ~WrrScheduler() override = default;
 
@@ -56,26 +89,35 @@ public:
     /**
      * @brief Enqueues a packet. PacketDescriptor::priority is used as core::QueueId.
      * @param packet The packet to enqueue.
-     * @throws std::logic_error if scheduler is not configured.
-     * @throws std::out_of_range if packet.priority (as QueueId) is not a configured queue.
+     * @return DROPPED_NO_QUEUE if packet.priority (as QueueId) is not a configured queue,
+     *         DROPPED_BY_QUEUE if the queue's AQM refused it, else ENQUEUED.
      */
-    void enqueue(PacketDescriptor packet) override;
+    EnqueueResult enqueue(PacketDescriptor packet) override;
 
     /**
      * @brief Dequeues a packet according to WRR discipline.
-     * @return The dequeued PacketDescriptor.
-     * @throws std::runtime_error if the scheduler is empty.
-     * @throws std::logic_error if scheduler is not configured or in an inconsistent state.
+     * @return The dequeued PacketDescriptor, or std::nullopt if the scheduler is empty.
      */
-    PacketDescriptor dequeue() override;
+    std::optional<PacketDescriptor> try_dequeue() override;
 
     /**
      * @brief Checks if the scheduler is empty (no packets in any queue).
      * @return True if all queues are empty, false otherwise.
-     * @throws std::logic_error if scheduler is not configured.
      */
     bool is_empty() const override;
 
+    /**
+     * @brief Enqueues a burst of packets with a single virtual dispatch.
+     * @see SchedulerInterface::enqueue_burst
+     */
+    size_t enqueue_burst(PacketDescriptor* packets, size_t count) override;
+
+    /**
+     * @brief Dequeues up to max_packets packets with a single virtual dispatch.
+     * @see SchedulerInterface::dequeue_burst
+     */
+    size_t dequeue_burst(std::vector<PacketDescriptor>& out, size_t max_packets) override;
+
     // Optional: Additional inspection methods
     /**
      * @brief Gets the current number of packets in a specific queue.
@@ -85,33 +127,78 @@ public:
      */
     size_t get_queue_size(core::QueueId queue_id) const;
 
+    /**
+     * @brief Starts recording the sojourn time of every packet in every queue
+     *        (see AqmQueue::enable_latency_histogram()). Call from the thread that owns
+     *        the scheduler; costs one clock read per enqueue and per dequeue.
+     */
+    void enable_latency_histograms();
+
+    /**
+     * @brief Snapshot of a queue's sojourn-time histogram; empty until
+     *        enable_latency_histograms() is called. Callable from any thread.
+     * @throws std::out_of_range if queue_id is not a configured queue.
+     */
+    LatencySnapshot get_queue_latency(core::QueueId queue_id) const;
+
+    /**
+     * @brief Appends one sample per configured queue, keyed by its QueueId.
+     * @see SchedulerInterface::collect_queue_stats
+     */
+    size_t collect_queue_stats(std::vector<QueueStatsSample>& out) const override;
+
     /**
      * @brief Gets the number of configured queues.
      * @return The number of queues.
      */
     size_t get_num_queues() const;
 
+    /**
+     * @brief Gets the service mode the scheduler was built with.
+     */
+    WrrMode get_mode() const { return options_.mode; }
+
 
 private:
+    static constexpr size_t NO_QUEUE = static_cast<size_t>(-1);
+
     struct InternalQueueState {
-        RedAqmQueue packet_queue; // Changed type
+        AqmQueue packet_queue;
         uint32_t weight;
-        int32_t current_deficit;
+        int64_t current_deficit;   // Packets (PACKET, INTERLEAVED) or bytes (BYTE) left in this turn
         core::QueueId external_id; // User-facing ID
+        size_t next_active;        // Next queue in its active list (NO_QUEUE at the tail)
+        bool is_active;            // Backlogged and linked into an active list
+        bool turn_started;         // Credit for the current turn already granted
+
+        InternalQueueState(core::QueueId ext_id, uint32_t w, const AqmParameters& aqm_p,
+                           std::shared_ptr<PacketDescriptorPool> pool)
+            : packet_queue(aqm_p, std::move(pool)), weight(w), current_deficit(0), external_id(ext_id),
+              next_active(NO_QUEUE), is_active(false), turn_started(false) {}
+    };
 
-        InternalQueueState(core::QueueId ext_id, uint32_t w, const RedAqmParameters& aqm_p)
-            : packet_queue(aqm_p), weight(w), current_deficit(static_cast<int32_t>(w)), external_id(ext_id) {}
+    // Intrusive FIFO of queue indices linked through InternalQueueState::next_active.
+    struct ActiveList {
+        size_t head = NO_QUEUE;
+        size_t tail = NO_QUEUE;
+        bool empty() const { return head == NO_QUEUE; }
     };
 
+    void push_active(ActiveList& list, size_t internal_idx);
+    size_t pop_active(ActiveList& list);
+
+    PacketDescriptor dequeue_packet_mode();
+    PacketDescriptor dequeue_byte_mode();
+    PacketDescriptor dequeue_interleaved_mode();
+
     std::vector<InternalQueueState> queues_;
     std::map<core::QueueId, size_t> queue_id_to_index_; // Maps external QueueId to index in queues_ vector
+    std::array<size_t, 256> index_by_priority_; // Queues with ids 0..255, NO_QUEUE elsewhere
 
-    size_t current_queue_index_ = 0; // Index for the next queue to consider in the round-robin scheme
+    WrrOptions options_;
+    ActiveList active_;      // Queues taking turns in the current round
+    ActiveList next_round_;  // INTERLEAVED: queues that used up their turns in this round
     size_t total_packets_ = 0;       // Total packets across all queues
-    bool is_configured_ = false;     // Tracks if constructor successfully configured queues
-
-    // Helper to replenish deficits for all queues if a full round yields no serviceable queue.
-    void replenish_all_deficits();
 };
 
 } // namespace scheduler
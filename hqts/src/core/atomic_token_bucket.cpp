@@ -0,0 +1,127 @@
+#include "hqts/core/atomic_token_bucket.h"
+
+#include <algorithm> // For std::max, std::min
+#include <stdexcept> // For std::invalid_argument
+#include <string>    // For std::to_string
+
+namespace hqts {
+namespace core {
+
+namespace {
+
+constexpr uint64_t TICKS_PER_SECOND = 1000000000ULL * AtomicTokenBucket::TICKS_PER_NS;
+// Debt plus skew must stay well inside the signed range for modular comparisons.
+constexpr uint64_t MAX_BURST_TICKS = uint64_t{1} << 61;
+
+uint64_t cost_per_byte_ticks_for(uint64_t rate_bps) {
+    if (rate_bps == 0) {
+        throw std::invalid_argument("AtomicTokenBucket: rate_bps must be greater than 0.");
+    }
+    // Bytes take 8 bits; round up so the bucket never runs faster than its rate.
+    return (8 * TICKS_PER_SECOND + rate_bps - 1) / rate_bps;
+}
+
+int64_t burst_ticks_for(uint64_t capacity_bytes, uint64_t cost_per_byte_ticks) {
+    if (capacity_bytes > MAX_BURST_TICKS / cost_per_byte_ticks) {
+        throw std::invalid_argument("AtomicTokenBucket: capacity of " + std::to_string(capacity_bytes) +
+                                    " bytes is too large for the configured rate.");
+    }
+    return static_cast<int64_t>(capacity_bytes * cost_per_byte_ticks);
+}
+
+} // namespace
+
+AtomicTokenBucket::AtomicTokenBucket(uint64_t rate_bps, uint64_t capacity_bytes, TimestampNs now_ns)
+    : rate_bps_(rate_bps),
+      capacity_bytes_(capacity_bytes),
+      cost_per_byte_ticks_(cost_per_byte_ticks_for(rate_bps)),
+      burst_ticks_(burst_ticks_for(capacity_bytes, cost_per_byte_ticks_)),
+      tat_ticks_(to_ticks(now_ns)) {} // TAT == now: initially full
+
+AtomicTokenBucket::AtomicTokenBucket(uint64_t rate_bps, uint64_t capacity_bytes)
+    : AtomicTokenBucket(rate_bps, capacity_bytes, steady_now_ns()) {}
+
+int64_t AtomicTokenBucket::debt_ticks(uint64_t tat, uint64_t now_ticks) const {
+    int64_t debt = static_cast<int64_t>(tat - now_ticks);
+    if (debt <= 0) {
+        return 0; // TAT in the past: the bucket is full
+    }
+    if (debt > burst_ticks_ + static_cast<int64_t>(MAX_CLOCK_SKEW_NS * TICKS_PER_NS)) {
+        return 0; // Beyond any reachable state: the idle time wrapped around the tick range
+    }
+    return debt;
+}
+
+bool AtomicTokenBucket::consume(uint64_t tokens_to_consume, TimestampNs now_ns) {
+    if (tokens_to_consume > capacity_bytes_) {
+        return false; // Can never conform; also keeps the cost multiply in range
+    }
+    const uint64_t now_ticks = to_ticks(now_ns);
+    const int64_t cost = static_cast<int64_t>(tokens_to_consume * cost_per_byte_ticks_);
+    uint64_t tat = tat_ticks_.load(std::memory_order_relaxed);
+    for (;;) {
+        int64_t new_debt = debt_ticks(tat, now_ticks) + cost;
+        if (new_debt > burst_ticks_) {
+            return false; // Not enough tokens; the shared word is left untouched
+        }
+        uint64_t new_tat = now_ticks + static_cast<uint64_t>(new_debt);
+        if (tat_ticks_.compare_exchange_weak(tat, new_tat, std::memory_order_relaxed)) {
+            return true;
+        }
+        // tat now holds the value another thread installed; re-evaluate against it.
+    }
+}
+
+void AtomicTokenBucket::refund(uint64_t tokens, TimestampNs now_ns) {
+    if (tokens == 0) {
+        return;
+    }
+    const uint64_t now_ticks = to_ticks(now_ns);
+    const int64_t credit = static_cast<int64_t>(std::min(tokens, capacity_bytes_) * cost_per_byte_ticks_);
+    uint64_t tat = tat_ticks_.load(std::memory_order_relaxed);
+    for (;;) {
+        int64_t debt = debt_ticks(tat, now_ticks);
+        if (debt == 0) {
+            return; // Already full
+        }
+        uint64_t new_tat = now_ticks + static_cast<uint64_t>(debt > credit ? debt - credit : 0);
+        if (tat_ticks_.compare_exchange_weak(tat, new_tat, std::memory_order_relaxed)) {
+            return;
+        }
+    }
+}
+
+uint64_t AtomicTokenBucket::available_tokens(TimestampNs now_ns) const {
+    int64_t debt = debt_ticks(tat_ticks_.load(std::memory_order_relaxed), to_ticks(now_ns));
+    if (debt >= burst_ticks_) {
+        return 0;
+    }
+    return static_cast<uint64_t>(burst_ticks_ - debt) / cost_per_byte_ticks_;
+}
+
+LocalTokenCache::LocalTokenCache(AtomicTokenBucket& shared, uint64_t batch_bytes)
+    : shared_(shared), batch_bytes_(batch_bytes), cached_tokens_(0) {}
+
+bool LocalTokenCache::consume(uint64_t tokens_to_consume, TimestampNs now_ns) {
+    if (cached_tokens_ < tokens_to_consume) {
+        uint64_t shortfall = tokens_to_consume - cached_tokens_;
+        uint64_t borrow = std::max(shortfall, batch_bytes_);
+        if (shared_.consume(borrow, now_ns)) {
+            cached_tokens_ += borrow;
+        } else if (borrow > shortfall && shared_.consume(shortfall, now_ns)) {
+            cached_tokens_ += shortfall; // Near the limit: borrow only what this packet needs
+        } else {
+            return false;
+        }
+    }
+    cached_tokens_ -= tokens_to_consume;
+    return true;
+}
+
+void LocalTokenCache::flush(TimestampNs now_ns) {
+    shared_.refund(cached_tokens_, now_ns);
+    cached_tokens_ = 0;
+}
+
+} // namespace core
+} // namespace hqts
@@ -0,0 +1,35 @@
+#include "hqts/core/egress_pacer.h"
+
+namespace hqts {
+namespace core {
+
+EgressPacer::EgressPacer(EgressPacingConfig config) : config_(config), rate_(config.rate_bps) {}
+
+TimestampNs EgressPacer::stamp(scheduler::PacketDescriptor& packet, TimestampNs now_ns) {
+    TimestampNs departure;
+    if (config_.rate_bps != 0) {
+        departure = next_free_ns_ > now_ns ? next_free_ns_ : now_ns;
+        next_free_ns_ = scheduler::saturating_add(departure, rate_.time_for(packet.packet_length_bytes));
+    } else {
+        const int64_t link_ns = static_cast<int64_t>(packet.transmit_time_ns);
+        const int64_t now = static_cast<int64_t>(now_ns);
+        if (!anchored_ || link_ns + link_offset_ns_ < now) {
+            // First packet, or the link clock fell behind: the port was idle. Resume from now.
+            link_offset_ns_ = now - link_ns;
+            anchored_ = true;
+        }
+        departure = static_cast<TimestampNs>(link_ns + link_offset_ns_);
+    }
+    packet.transmit_time_ns = departure;
+    return departure;
+}
+
+TimestampNs EgressPacer::next_due_ns(TimestampNs now_ns) const {
+    if (!held_ || held_->transmit_time_ns <= now_ns + config_.horizon_ns) {
+        return now_ns;
+    }
+    return held_->transmit_time_ns - config_.horizon_ns;
+}
+
+} // namespace core
+} // namespace hqts
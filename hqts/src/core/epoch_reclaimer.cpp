@@ -0,0 +1,47 @@
+#include "hqts/core/epoch_reclaimer.h"
+
+#include <stdexcept> // For std::invalid_argument, std::length_error, std::out_of_range
+#include <string>    // For std::to_string in error messages
+
+namespace hqts {
+namespace core {
+
+EpochReclaimer::EpochReclaimer(size_t max_readers)
+    : max_readers_(max_readers), slots_(std::make_unique<ReaderSlot[]>(max_readers)) {
+    if (max_readers == 0) {
+        throw std::invalid_argument("EpochReclaimer: max_readers must be at least 1.");
+    }
+}
+
+size_t EpochReclaimer::register_reader() {
+    for (size_t reader = 0; reader < max_readers_; ++reader) {
+        uint64_t expected = FREE_SLOT;
+        // Sequentially consistent, as are the loads in passed(): either the writer sees
+        // the new reader, or the reader's first pointer load sees what the writer published.
+        if (slots_[reader].epoch.compare_exchange_strong(expected, epoch())) {
+            return reader;
+        }
+    }
+    throw std::length_error("EpochReclaimer: all " + std::to_string(max_readers_) +
+                            " reader slots are in use.");
+}
+
+void EpochReclaimer::unregister_reader(size_t reader) {
+    if (reader >= max_readers_) {
+        throw std::out_of_range("EpochReclaimer: reader " + std::to_string(reader) + " does not exist.");
+    }
+    slots_[reader].epoch.store(FREE_SLOT, std::memory_order_release);
+}
+
+bool EpochReclaimer::passed(uint64_t tag) const {
+    for (size_t reader = 0; reader < max_readers_; ++reader) {
+        uint64_t announced = slots_[reader].epoch.load();
+        if (announced != FREE_SLOT && announced < tag) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace core
+} // namespace hqts
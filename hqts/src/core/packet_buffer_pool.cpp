@@ -0,0 +1,153 @@
+#include "hqts/core/packet_buffer_pool.h"
+
+#include <array>     // For the pool registry
+#include <atomic>    // For std::atomic
+#include <stdexcept> // For std::invalid_argument, std::runtime_error
+#include <string>    // For std::to_string
+
+namespace hqts {
+namespace core {
+
+namespace {
+
+constexpr uint32_t INDEX_BITS = 24;
+constexpr uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+
+// Registry slot i holds the pool whose handles carry (i + 1) in their upper bits.
+std::array<std::atomic<PacketBufferPool*>, PacketBufferPool::MAX_POOLS> g_pool_registry{};
+
+// Validates the constructor's arguments before any member is sized from them.
+size_t validated_count(size_t num_buffers, uint32_t buffer_size_bytes) {
+    if (num_buffers == 0 || num_buffers > PacketBufferPool::MAX_BUFFERS_PER_POOL) {
+        throw std::invalid_argument("PacketBufferPool: num_buffers must be in [1, " +
+                                    std::to_string(PacketBufferPool::MAX_BUFFERS_PER_POOL) + "], got " +
+                                    std::to_string(num_buffers));
+    }
+    if (buffer_size_bytes == 0) {
+        throw std::invalid_argument("PacketBufferPool: buffer_size_bytes must be greater than 0.");
+    }
+    return num_buffers;
+}
+
+} // namespace
+
+PacketBufferPool::PacketBufferPool(size_t num_buffers, uint32_t buffer_size_bytes)
+    : pool_slot_(0), buffer_size_(buffer_size_bytes), ref_counts_(validated_count(num_buffers, buffer_size_bytes)),
+      data_lengths_(num_buffers), owner_thread_(std::this_thread::get_id()), remote_returns_(num_buffers) {
+    storage_.resize(num_buffers * buffer_size_bytes);
+    free_list_.reserve(num_buffers);
+    // Push in reverse so the first allocations hand out the lowest indices.
+    for (size_t i = num_buffers; i > 0; --i) {
+        free_list_.push_back(static_cast<uint32_t>(i - 1));
+    }
+
+    for (size_t slot = 0; slot < MAX_POOLS; ++slot) {
+        PacketBufferPool* expected = nullptr;
+        if (g_pool_registry[slot].compare_exchange_strong(expected, this)) {
+            pool_slot_ = static_cast<uint32_t>(slot + 1);
+            return;
+        }
+    }
+    throw std::runtime_error("PacketBufferPool: too many pools, at most " +
+                             std::to_string(MAX_POOLS) + " may exist at once.");
+}
+
+PacketBufferPool::~PacketBufferPool() {
+    g_pool_registry[pool_slot_ - 1].store(nullptr);
+}
+
+PacketBufferHandle PacketBufferPool::allocate() {
+    if (free_list_.empty() && reclaim_remote_releases() == 0) {
+        return INVALID_PACKET_BUFFER;
+    }
+    uint32_t index = free_list_.back();
+    free_list_.pop_back();
+    ref_counts_[index].store(1, std::memory_order_relaxed);
+    data_lengths_[index] = 0;
+    return (pool_slot_ << INDEX_BITS) | index;
+}
+
+size_t PacketBufferPool::reclaim_remote_releases() {
+    size_t reclaimed = 0;
+    uint32_t index;
+    while (remote_returns_.try_pop(index)) {
+        free_list_.push_back(index);
+        ++reclaimed;
+    }
+    return reclaimed;
+}
+
+void PacketBufferPool::retain(PacketBufferHandle handle) {
+    ref_counts_[checked_index(handle)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void PacketBufferPool::release(PacketBufferHandle handle) {
+    uint32_t index = checked_index(handle);
+    // acq_rel: whoever frees the buffer sees every other holder's last use of it.
+    if (ref_counts_[index].fetch_sub(1, std::memory_order_acq_rel) != 1) {
+        return;
+    }
+    if (std::this_thread::get_id() == owner_thread_) {
+        free_list_.push_back(index);
+    } else {
+        remote_returns_.try_push(index); // Room for every buffer: cannot fail
+    }
+}
+
+std::byte* PacketBufferPool::data(PacketBufferHandle handle) {
+    return storage_.data() + static_cast<size_t>(checked_index(handle)) * buffer_size_;
+}
+
+const std::byte* PacketBufferPool::data(PacketBufferHandle handle) const {
+    return storage_.data() + static_cast<size_t>(checked_index(handle)) * buffer_size_;
+}
+
+uint32_t PacketBufferPool::data_length(PacketBufferHandle handle) const {
+    return data_lengths_[checked_index(handle)];
+}
+
+void PacketBufferPool::set_data_length(PacketBufferHandle handle, uint32_t length) {
+    uint32_t index = checked_index(handle);
+    if (length > buffer_size_) {
+        throw std::invalid_argument("PacketBufferPool: data length " + std::to_string(length) +
+                                    " exceeds buffer size " + std::to_string(buffer_size_));
+    }
+    data_lengths_[index] = length;
+}
+
+uint32_t PacketBufferPool::ref_count(PacketBufferHandle handle) const {
+    return ref_counts_[checked_index(handle)].load(std::memory_order_relaxed);
+}
+
+PacketBufferPool* PacketBufferPool::owner_of(PacketBufferHandle handle) {
+    uint32_t slot = handle >> INDEX_BITS;
+    if (slot == 0) {
+        return nullptr;
+    }
+    return g_pool_registry[slot - 1].load(std::memory_order_acquire);
+}
+
+void PacketBufferPool::release_any(PacketBufferHandle handle) {
+    if (handle == INVALID_PACKET_BUFFER) {
+        return;
+    }
+    PacketBufferPool* pool = owner_of(handle);
+    if (pool == nullptr) {
+        throw std::invalid_argument("PacketBufferPool: handle " + std::to_string(handle) +
+                                    " does not belong to a live pool.");
+    }
+    pool->release(handle);
+}
+
+uint32_t PacketBufferPool::checked_index(PacketBufferHandle handle) const {
+    uint32_t index = handle & INDEX_MASK;
+    if ((handle >> INDEX_BITS) != pool_slot_ || index >= ref_counts_.size() ||
+        ref_counts_[index].load(std::memory_order_relaxed) == 0) {
+        throw std::invalid_argument("PacketBufferPool: handle " + std::to_string(handle) +
+                                    " does not refer to an allocated buffer of this pool.");
+    }
+    return index;
+}
+
+} // namespace core
+} // namespace hqts
@@ -0,0 +1,78 @@
+#include "hqts/core/per_core_statistics.h"
+
+#include <stdexcept> // For std::invalid_argument
+
+namespace hqts {
+namespace core {
+
+PerCorePolicyStatistics::PerCorePolicyStatistics(size_t num_cores, size_t max_policies)
+    : num_cores_(num_cores), max_policies_(max_policies) {
+    if (num_cores == 0 || max_policies == 0) {
+        throw std::invalid_argument("PerCorePolicyStatistics: num_cores and max_policies must be at least 1.");
+    }
+    if (max_policies >= NO_SLOT) {
+        throw std::invalid_argument("PerCorePolicyStatistics: max_policies is too large.");
+    }
+    blocks_ = std::vector<PolicyCounterBlock>(num_cores * max_policies);
+    slot_ids_.reserve(max_policies);
+}
+
+uint32_t PerCorePolicyStatistics::slot_of(policy::PolicyId id) {
+    std::lock_guard<std::mutex> lock(slots_mutex_);
+    auto it = slots_.find(id);
+    if (it != slots_.end()) {
+        return it->second;
+    }
+    if (slot_ids_.size() == max_policies_) {
+        return NO_SLOT;
+    }
+    uint32_t slot = static_cast<uint32_t>(slot_ids_.size());
+    slots_.emplace(id, slot);
+    slot_ids_.push_back(id);
+    return slot;
+}
+
+PolicyStatistics PerCorePolicyStatistics::fold(uint32_t slot) const {
+    PolicyStatistics totals;
+    for (size_t core = 0; core < num_cores_; ++core) {
+        const PolicyCounterBlock& block = blocks_[core * max_policies_ + slot];
+        totals.packets_processed += block.packets_processed.load(std::memory_order_relaxed);
+        totals.bytes_processed += block.bytes_processed.load(std::memory_order_relaxed);
+        totals.packets_dropped += block.packets_dropped.load(std::memory_order_relaxed);
+        totals.bytes_dropped += block.bytes_dropped.load(std::memory_order_relaxed);
+        for (size_t level = 0; level < totals.packets_by_conformance.size(); ++level) {
+            totals.packets_by_conformance[level] += block.packets_by_conformance[level].load(std::memory_order_relaxed);
+        }
+    }
+    return totals;
+}
+
+PolicyStatistics PerCorePolicyStatistics::read(policy::PolicyId id) const {
+    uint32_t slot;
+    {
+        std::lock_guard<std::mutex> lock(slots_mutex_);
+        auto it = slots_.find(id);
+        if (it == slots_.end()) {
+            return PolicyStatistics();
+        }
+        slot = it->second;
+    }
+    return fold(slot);
+}
+
+std::vector<std::pair<policy::PolicyId, PolicyStatistics>> PerCorePolicyStatistics::read_all() const {
+    std::vector<policy::PolicyId> ids;
+    {
+        std::lock_guard<std::mutex> lock(slots_mutex_);
+        ids = slot_ids_;
+    }
+    std::vector<std::pair<policy::PolicyId, PolicyStatistics>> result;
+    result.reserve(ids.size());
+    for (size_t slot = 0; slot < ids.size(); ++slot) {
+        result.emplace_back(ids[slot], fold(static_cast<uint32_t>(slot)));
+    }
+    return result;
+}
+
+} // namespace core
+} // namespace hqts
@@ -1,6 +1,7 @@
 #include "hqts/core/shaping_policy.h"
 
-#include <chrono> // For std::chrono::steady_clock
+#include <chrono>  // For std::chrono::steady_clock
+#include <utility> // For std::move
 
 namespace hqts {
 namespace core {
@@ -24,6 +25,30 @@ ShapingPolicy::ShapingPolicy(
     core::QueueId qid_g,
     core::QueueId qid_y,
     core::QueueId qid_r
+) : ShapingPolicy(p_id, p_parent_id, std::move(p_name), p_committed_rate_bps, p_peak_rate_bps,
+                  p_committed_burst_bytes, p_excess_burst_bytes, p_algorithm, p_weight,
+                  p_priority_level, p_drop_on_red, prio_g, prio_y, prio_r, qid_g, qid_y, qid_r,
+                  std::chrono::steady_clock::now()) {}
+
+ShapingPolicy::ShapingPolicy(
+    policy::PolicyId p_id,
+    policy::PolicyId p_parent_id,
+    std::string p_name,
+    uint64_t p_committed_rate_bps,
+    uint64_t p_peak_rate_bps,
+    uint64_t p_committed_burst_bytes,
+    uint64_t p_excess_burst_bytes,
+    policy::SchedulingAlgorithm p_algorithm,
+    uint32_t p_weight,
+    policy::Priority p_priority_level,
+    bool p_drop_on_red,
+    uint8_t prio_g,
+    uint8_t prio_y,
+    uint8_t prio_r,
+    core::QueueId qid_g,
+    core::QueueId qid_y,
+    core::QueueId qid_r,
+    std::chrono::steady_clock::time_point p_last_updated
 ) : id(p_id),
     parent_id(p_parent_id),
     // children_ids is intentionally left empty on construction, to be populated later
@@ -45,7 +70,7 @@ ShapingPolicy::ShapingPolicy(
     cir_bucket(p_committed_rate_bps, p_committed_burst_bytes),
     pir_bucket(p_peak_rate_bps, p_excess_burst_bytes),
     // stats members are default initialized to 0 (as per struct definition in .h)
-    last_updated(std::chrono::steady_clock::now())
+    last_updated(p_last_updated)
 {
     // children_ids is initialized by default (empty vector) via its default constructor
     // stats is initialized by default (all members to 0)
@@ -0,0 +1,374 @@
+#include "hqts/core/sharded_runtime.h"
+#include "hqts/core/adaptive_burst.h"     // For AdaptiveBurstSize
+#include "hqts/core/packet_buffer_pool.h" // For PacketBufferPool::release_any
+#include "hqts/core/time_source.h"        // For steady_now_ns
+#include "hqts/dataplane/flow_identifier.h" // For hash_five_tuple
+
+#include <algorithm> // For std::max
+#include <exception> // For std::exception_ptr
+#include <stdexcept> // For std::invalid_argument, std::logic_error, std::out_of_range
+#include <string>    // For std::to_string
+
+#ifdef __linux__
+#include <pthread.h> // For pthread_setaffinity_np
+#include <sched.h>   // For cpu_set_t
+#endif
+
+namespace hqts {
+namespace core {
+
+namespace {
+
+// Best effort: a thread that cannot be pinned (CPU offline, restricted cpuset) still runs.
+void pin_current_thread(int cpu) {
+#ifdef __linux__
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+        return;
+    }
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(static_cast<size_t>(cpu), &cpus);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+#else
+    (void)cpu;
+#endif
+}
+
+// Runs `fn` on a thread pinned to `cpu`, so what it allocates and first touches is placed
+// on that CPU's NUMA node, and rethrows what it throws. Runs it inline if cpu is -1.
+template <typename Function>
+void run_pinned(int cpu, Function&& fn) {
+    if (cpu < 0) {
+        fn();
+        return;
+    }
+    std::exception_ptr error;
+    std::thread thread([cpu, &fn, &error] {
+        pin_current_thread(cpu);
+        try {
+            fn();
+        } catch (...) {
+            error = std::current_exception();
+        }
+    });
+    thread.join();
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+std::unique_ptr<scheduler::SchedulerInterface> make_scheduler_on(
+    int cpu, const ShardedRuntime::SchedulerFactory& make_scheduler) {
+    if (!make_scheduler) {
+        throw std::invalid_argument("ShardedRuntime: scheduler factory must not be empty.");
+    }
+    std::unique_ptr<scheduler::SchedulerInterface> port_scheduler;
+    run_pinned(cpu, [&] { port_scheduler = make_scheduler(); });
+    return port_scheduler;
+}
+
+// Pushes all `count` descriptors, waiting for the consumer while the ring is full:
+// back-pressure instead of dropping packets the shaper has already accepted.
+void push_all(MpscRing<scheduler::PacketDescriptor>& ring, const scheduler::PacketDescriptor* packets,
+              size_t count) {
+    size_t pushed = 0;
+    while (pushed < count) {
+        size_t n = ring.push_burst(packets + pushed, count - pushed);
+        if (n == 0) {
+            std::this_thread::yield();
+        }
+        pushed += n;
+    }
+}
+
+} // namespace
+
+ShardedRuntime::Worker::Worker(const ShardedRuntimeConfig& config, const policy::PolicyTree& policy_tree)
+    : ingress(config.ingress_ring_capacity),
+      flow_table(config.flows_per_worker, config.flow_aging),
+      classifier(flow_table, config.default_policy_id),
+      policies(policy_tree),
+      shaper(policies, classifier, flow_table) {}
+
+ShardedRuntime::ShardedRuntime(const ShardedRuntimeConfig& config,
+                               const policy::PolicyTree& policies,
+                               std::unique_ptr<scheduler::SchedulerInterface> port_scheduler,
+                               TransmitFunction transmit)
+    : config_(config),
+      policy_statistics_(std::max<size_t>(config.num_workers, 1), std::max<size_t>(config.max_counted_policies, 1)),
+      egress_ring_(config.egress_ring_capacity),
+      scheduler_(std::move(port_scheduler)), transmit_(std::move(transmit)) {
+    if (config_.num_workers == 0) {
+        throw std::invalid_argument("ShardedRuntime: num_workers must be at least 1.");
+    }
+    if (config_.max_counted_policies == 0) {
+        throw std::invalid_argument("ShardedRuntime: max_counted_policies must be at least 1.");
+    }
+    if (config_.burst_size == 0) {
+        throw std::invalid_argument("ShardedRuntime: burst_size must be at least 1.");
+    }
+    if (config_.min_burst_size > config_.burst_size) {
+        throw std::invalid_argument("ShardedRuntime: min_burst_size " + std::to_string(config_.min_burst_size) +
+                                    " exceeds burst_size " + std::to_string(config_.burst_size) + ".");
+    }
+    if (config_.worker_cpus.size() > config_.num_workers) {
+        throw std::invalid_argument("ShardedRuntime: " + std::to_string(config_.worker_cpus.size()) +
+                                    " worker CPUs given for " + std::to_string(config_.num_workers) +
+                                    " workers.");
+    }
+    if (!scheduler_) {
+        throw std::invalid_argument("ShardedRuntime: port scheduler must not be null.");
+    }
+    if (!transmit_) {
+        throw std::invalid_argument("ShardedRuntime: transmit function must not be empty.");
+    }
+
+    workers_.reserve(config_.num_workers);
+    for (size_t i = 0; i < config_.num_workers; ++i) {
+        std::unique_ptr<Worker> worker;
+        run_pinned(worker_cpu(i), [&] { worker = std::make_unique<Worker>(config_, policies); });
+        workers_.push_back(std::move(worker));
+        workers_.back()->shaper.attach_statistics(&policy_statistics_, i);
+    }
+    if (!config_.stats_segment_name.empty()) {
+        stats_writer_ = std::make_unique<monitor::StatsSegmentWriter>(config_.stats_segment_name,
+                                                                      config_.stats_layout);
+    }
+}
+
+ShardedRuntime::ShardedRuntime(const ShardedRuntimeConfig& config,
+                               const policy::PolicyTree& policies,
+                               const SchedulerFactory& make_scheduler,
+                               TransmitFunction transmit)
+    : ShardedRuntime(config, policies, make_scheduler_on(config.egress_cpu, make_scheduler), std::move(transmit)) {}
+
+ShardedRuntime::~ShardedRuntime() {
+    stop();
+}
+
+void ShardedRuntime::start() {
+    if (running_) {
+        throw std::logic_error("ShardedRuntime: already running.");
+    }
+    stop_workers_.store(false, std::memory_order_relaxed);
+    stop_egress_.store(false, std::memory_order_relaxed);
+    running_ = true;
+
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        int cpu = worker_cpu(i);
+        Worker& worker = *workers_[i];
+        worker.thread = std::thread([this, &worker, cpu] { worker_loop(worker, cpu); });
+    }
+    egress_thread_ = std::thread([this] { egress_loop(); });
+}
+
+void ShardedRuntime::stop() {
+    if (!running_) {
+        return;
+    }
+    // Workers first, so everything they forward is in the egress ring before the
+    // egress thread is told to finish.
+    stop_workers_.store(true, std::memory_order_release);
+    for (auto& worker : workers_) {
+        worker->thread.join();
+    }
+    stop_egress_.store(true, std::memory_order_release);
+    egress_thread_.join();
+    running_ = false;
+}
+
+size_t ShardedRuntime::worker_for(const dataplane::FiveTuple& five_tuple) const {
+    // Bits 21..52 of the hash: FlowTable takes its shard and tag from bits 53..63 and
+    // its home slot from the low bits. Multiply-shift maps them onto [0, num_workers).
+    uint64_t spread = static_cast<uint32_t>(dataplane::hash_five_tuple(five_tuple) >> 21);
+    return static_cast<size_t>((spread * workers_.size()) >> 32);
+}
+
+bool ShardedRuntime::dispatch(const IncomingPacket& packet) {
+    if (workers_[worker_for(packet.five_tuple)]->ingress.try_push(packet)) {
+        return true;
+    }
+    packets_refused_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+size_t ShardedRuntime::dispatch_burst(const IncomingPacket* packets, size_t count) {
+    size_t queued = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (dispatch(packets[i])) {
+            ++queued;
+        }
+    }
+    return queued;
+}
+
+void ShardedRuntime::publish_policies(const policy::PolicyTree& tree) {
+    policy::CompiledPolicies validated(tree, 1); // Throws before any worker is touched
+    (void)validated;
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        Worker& worker = *workers_[i];
+        run_pinned(worker_cpu(i), [&worker, &tree] { worker.policies.publish(tree); });
+    }
+}
+
+const WorkerCounters& ShardedRuntime::worker_counters(size_t worker) const {
+    if (worker >= workers_.size()) {
+        throw std::out_of_range("ShardedRuntime: worker " + std::to_string(worker) + " does not exist.");
+    }
+    return workers_[worker]->counters;
+}
+
+int ShardedRuntime::worker_cpu(size_t worker) const {
+    return worker < config_.worker_cpus.size() ? config_.worker_cpus[worker] : -1;
+}
+
+void ShardedRuntime::worker_loop(Worker& worker, int cpu) {
+    pin_current_thread(cpu);
+#if defined(HQTS_PROFILING)
+    bind_stage_counters(&worker.counters.stage_cycles);
+#endif
+
+    const size_t burst_size = config_.burst_size;
+    AdaptiveBurstSize burst(config_.min_burst_size == 0 ? burst_size : config_.min_burst_size, burst_size);
+    std::vector<IncomingPacket> incoming(burst_size);
+    std::vector<scheduler::PacketDescriptor> packets;
+    std::vector<dataplane::FiveTuple> five_tuples;
+    packets.reserve(burst_size);
+    five_tuples.reserve(burst_size);
+    size_t bursts_since_aging = 0;
+    auto age_flows = [&worker, &bursts_since_aging] {
+        bursts_since_aging = 0;
+        single_writer_add(worker.counters.flows_expired, worker.flow_table.age(steady_now_ns()));
+    };
+
+    for (;;) {
+        // Read the flag before polling, so a ring found empty after the flag was set
+        // really is drained: the RX thread has stopped dispatching by then.
+        bool stopping = stop_workers_.load(std::memory_order_acquire);
+        size_t count = worker.ingress.pop_burst(incoming.data(), burst.current());
+        burst.record(count);
+        worker.counters.burst_size.store(burst.current(), std::memory_order_relaxed);
+        if (count == 0) {
+            if (stopping) {
+                return;
+            }
+            worker.shaper.refresh_policies(); // Quiescent point: retired snapshots can be freed
+            age_flows();
+            std::this_thread::yield();
+            continue;
+        }
+
+        packets.clear();
+        five_tuples.clear();
+        for (size_t i = 0; i < count; ++i) {
+            packets.emplace_back(0, incoming[i].packet_length_bytes, 0, incoming[i].buffer);
+            five_tuples.push_back(incoming[i].five_tuple);
+        }
+        size_t accepted = worker.shaper.process_burst(packets.data(), five_tuples.data(), count,
+                                                      steady_now_ns());
+        for (size_t i = accepted; i < count; ++i) {
+            PacketBufferPool::release_any(packets[i].buffer); // Shaper drops
+        }
+        push_all(egress_ring_, packets.data(), accepted);
+
+        single_writer_add(worker.counters.packets_received, count);
+        single_writer_add(worker.counters.packets_dropped, count - accepted);
+        single_writer_add(worker.counters.packets_forwarded, accepted);
+        // A busy worker never idles, so it ages as it goes or a full table would
+        // refuse new flows for good.
+        if (config_.aging_interval_bursts != 0 && ++bursts_since_aging >= config_.aging_interval_bursts) {
+            age_flows();
+        }
+    }
+}
+
+void ShardedRuntime::egress_loop() {
+    pin_current_thread(config_.egress_cpu);
+#if defined(HQTS_PROFILING)
+    bind_stage_counters(&egress_stage_cycles_);
+#endif
+
+    const size_t burst_size = config_.burst_size;
+    AdaptiveBurstSize burst(config_.min_burst_size == 0 ? burst_size : config_.min_burst_size, burst_size);
+    std::vector<scheduler::PacketDescriptor> outgoing;
+    outgoing.reserve(burst_size);
+    TimestampNs next_stats_ns = 0;
+
+    for (;;) {
+        if (stats_writer_) {
+            TimestampNs now_ns = steady_now_ns();
+            if (now_ns >= next_stats_ns) {
+                publish_stats(now_ns);
+                next_stats_ns = now_ns + config_.stats_interval_ns;
+            }
+        }
+        bool stopping = stop_egress_.load(std::memory_order_acquire);
+        size_t moved = 0;
+        {
+            HQTS_PROFILE_STAGE_RESULT(ProfileStage::ENQUEUE, moved);
+            // One burst per worker per round
+            moved = scheduler_->drain_ring(egress_ring_, burst.current() * workers_.size());
+        }
+
+        outgoing.clear();
+        size_t sent = 0;
+        {
+            HQTS_PROFILE_STAGE_RESULT(ProfileStage::DEQUEUE, sent);
+            sent = scheduler_->dequeue_burst(outgoing, burst.current());
+        }
+        burst.record(sent);
+        for (const scheduler::PacketDescriptor& packet : outgoing) {
+            transmit_(packet);
+        }
+        packets_transmitted_.fetch_add(sent, std::memory_order_relaxed);
+
+        if (moved == 0 && sent == 0) {
+            if (stopping && scheduler_->is_empty()) {
+                if (stats_writer_) {
+                    publish_stats(steady_now_ns()); // Final counts
+                }
+                return; // Workers joined, ring and scheduler empty
+            }
+            std::this_thread::yield();
+        }
+    }
+}
+
+void ShardedRuntime::publish_stats(TimestampNs now_ns) {
+    policy_records_.clear();
+    for (const auto& entry : policy_statistics_.read_all()) {
+        const PolicyStatistics& stats = entry.second;
+        monitor::PolicyStatsRecord record{};
+        record.policy_id = entry.first;
+        record.packets_processed = stats.packets_processed;
+        record.bytes_processed = stats.bytes_processed;
+        record.packets_dropped = stats.packets_dropped;
+        record.bytes_dropped = stats.bytes_dropped;
+        for (size_t level = 0; level < stats.packets_by_conformance.size(); ++level) {
+            record.packets_by_conformance[level] = stats.packets_by_conformance[level];
+        }
+        policy_records_.push_back(record);
+    }
+
+    queue_samples_.clear();
+    scheduler_->collect_queue_stats(queue_samples_);
+    queue_records_.clear();
+    for (const scheduler::QueueStatsSample& sample : queue_samples_) {
+        queue_records_.push_back({sample.queue_id, sample.packets_queued, sample.bytes_queued,
+                                  sample.latency_samples, sample.latency_mean_ns, sample.latency_p50_ns,
+                                  sample.latency_p99_ns, sample.latency_p999_ns, sample.latency_max_ns});
+    }
+
+    worker_records_.clear();
+    for (const auto& worker : workers_) {
+        worker_records_.push_back({worker->counters.packets_received.load(std::memory_order_relaxed),
+                                   worker->counters.packets_dropped.load(std::memory_order_relaxed),
+                                   worker->counters.packets_forwarded.load(std::memory_order_relaxed),
+                                   worker->flow_table.size()});
+    }
+
+    stats_writer_->update(now_ns, policy_records_, queue_records_, worker_records_);
+}
+
+} // namespace core
+} // namespace hqts
@@ -0,0 +1,184 @@
+#include "hqts/core/timing_wheel.h"
+
+#include "hqts/scheduler/priority_bitmap.h" // For scheduler::highest_set_bit
+
+#include <stdexcept> // For std::invalid_argument
+#include <string>    // For std::to_string
+
+namespace hqts {
+namespace core {
+
+namespace {
+
+unsigned lowest_set_bit(uint64_t word) {
+#if defined(__GNUC__)
+    return static_cast<unsigned>(__builtin_ctzll(word));
+#else
+    unsigned bit = 0;
+    while ((word & 1) == 0) {
+        word >>= 1;
+        ++bit;
+    }
+    return bit;
+#endif
+}
+
+} // namespace
+
+TimingWheel::TimingWheel(size_t capacity, TimestampNs tick_ns, TimestampNs start_ns)
+    : tick_ns_(tick_ns), current_tick_(0) {
+    if (capacity == 0 || capacity >= NIL) {
+        throw std::invalid_argument("TimingWheel: capacity must be in [1, " + std::to_string(NIL - 1) +
+                                    "], got " + std::to_string(capacity));
+    }
+    if (tick_ns == 0) {
+        throw std::invalid_argument("TimingWheel: tick_ns must be greater than 0.");
+    }
+    current_tick_ = start_ns / tick_ns;
+
+    nodes_.resize(capacity);
+    for (size_t i = 0; i + 1 < capacity; ++i) {
+        nodes_[i].next = static_cast<uint32_t>(i + 1);
+    }
+    free_head_ = 0;
+}
+
+void TimingWheel::append(List& list, uint32_t index) {
+    nodes_[index].next = NIL;
+    if (list.tail == NIL) {
+        list.head = index;
+    } else {
+        nodes_[list.tail].next = index;
+    }
+    list.tail = index;
+}
+
+void TimingWheel::place(uint32_t index) {
+    const uint64_t tick = nodes_[index].tick;
+    if (tick <= current_tick_) {
+        append(ready_, index);
+        ++ready_count_;
+        return;
+    }
+    // The highest base-256 digit in which the release tick differs from now picks the level.
+    unsigned level = scheduler::highest_set_bit(tick ^ current_tick_) / SLOT_BITS;
+    if (level >= LEVELS) {
+        append(overflow_, index);
+        return;
+    }
+    unsigned slot = digit(tick, level);
+    append(slots_[level][slot], index);
+    occupied_[level][slot / 64] |= uint64_t{1} << (slot % 64);
+}
+
+void TimingWheel::reinsert(List list) {
+    uint32_t index = list.head;
+    while (index != NIL) {
+        uint32_t next = nodes_[index].next;
+        place(index);
+        index = next;
+    }
+}
+
+bool TimingWheel::schedule(const scheduler::PacketDescriptor& packet, TimestampNs release_ns) {
+    uint32_t index = free_head_;
+    if (index == NIL) {
+        return false;
+    }
+    free_head_ = nodes_[index].next;
+    nodes_[index].packet = packet;
+    nodes_[index].tick = release_ns / tick_ns_;
+    ++size_;
+    place(index);
+    return true;
+}
+
+uint64_t TimingWheel::next_event_tick() const {
+    // An occupied slot above the current digit of a level starts an event; lower levels
+    // come first, since their slots all lie before the next slot of the level above.
+    for (unsigned level = 0; level < LEVELS; ++level) {
+        unsigned from = digit(current_tick_, level) + 1;
+        for (unsigned word = from / 64; word < BITMAP_WORDS && from < SLOTS; ++word) {
+            uint64_t bits = occupied_[level][word];
+            if (word == from / 64) {
+                bits &= ~uint64_t{0} << (from % 64);
+            }
+            if (bits != 0) {
+                uint64_t slot = word * 64 + lowest_set_bit(bits);
+                unsigned shift = level * SLOT_BITS;
+                uint64_t above = (current_tick_ >> (shift + SLOT_BITS)) << (shift + SLOT_BITS);
+                return above | (slot << shift);
+            }
+        }
+    }
+    if (overflow_.head != NIL) {
+        return ((current_tick_ >> (LEVELS * SLOT_BITS)) + 1) << (LEVELS * SLOT_BITS);
+    }
+    return NO_TICK;
+}
+
+void TimingWheel::process_event(uint64_t event_tick) {
+    const uint64_t previous_tick = current_tick_;
+    current_tick_ = event_tick;
+    unsigned level = scheduler::highest_set_bit(previous_tick ^ event_tick) / SLOT_BITS;
+    if (level >= LEVELS) {
+        List list = overflow_;
+        overflow_ = List();
+        reinsert(list);
+        return;
+    }
+    // Entering this slot: its packets are re-placed relative to the new tick. Those due
+    // now go to the ready list, the rest into lower levels.
+    unsigned slot = digit(event_tick, level);
+    List list = slots_[level][slot];
+    slots_[level][slot] = List();
+    occupied_[level][slot / 64] &= ~(uint64_t{1} << (slot % 64));
+    reinsert(list);
+}
+
+size_t TimingWheel::advance(TimestampNs now_ns) {
+    const uint64_t target_tick = now_ns / tick_ns_;
+    if (target_tick <= current_tick_) {
+        return ready_count_;
+    }
+    if (size_ == ready_count_) {
+        current_tick_ = target_tick; // Nothing scheduled: skip ahead in one step
+        return ready_count_;
+    }
+    for (;;) {
+        uint64_t event_tick = next_event_tick();
+        if (event_tick > target_tick) {
+            current_tick_ = target_tick;
+            break;
+        }
+        process_event(event_tick);
+    }
+    return ready_count_;
+}
+
+scheduler::PacketDescriptor TimingWheel::pop_ready() {
+    uint32_t index = ready_.head;
+    ready_.head = nodes_[index].next;
+    if (ready_.head == NIL) {
+        ready_.tail = NIL;
+    }
+    --ready_count_;
+    --size_;
+    nodes_[index].next = free_head_;
+    free_head_ = index;
+    return nodes_[index].packet;
+}
+
+TimestampNs TimingWheel::next_event_ns() const {
+    if (ready_count_ > 0) {
+        return current_tick_ * tick_ns_;
+    }
+    uint64_t event_tick = next_event_tick();
+    if (event_tick == NO_TICK || event_tick > UINT64_MAX / tick_ns_) {
+        return UINT64_MAX;
+    }
+    return event_tick * tick_ns_;
+}
+
+} // namespace core
+} // namespace hqts
@@ -1,60 +1,149 @@
 #include "hqts/core/token_bucket.h"
 
-#include <algorithm> // For std::min
-#include <chrono>    // For std::chrono
+#include <algorithm> // For std::min, std::max
 
 namespace hqts {
 namespace core {
 
 TokenBucket::TokenBucket(uint64_t rate_bps, uint64_t capacity_bytes)
-    : capacity_bytes_(capacity_bytes),
-      tokens_bytes_(capacity_bytes), // Initially full
+    : TokenBucket(rate_bps, capacity_bytes, 0) {
+    has_refill_time_ = false; // Time base is set by the first refill
+}
+
+TokenBucket::TokenBucket(uint64_t rate_bps, uint64_t capacity_bytes, TimestampNs now_ns)
+    : capacity_bytes_(std::min(capacity_bytes, MAX_CAPACITY_BYTES)),
+      capacity_credit_(0),
+      credit_(0),
       rate_bps_(rate_bps),
-      last_refill_time_(std::chrono::steady_clock::now()) {}
+      fill_time_ns_(0),
+      last_refill_time_ns_(now_ns),
+      has_refill_time_(true) {
+    update_derived_limits();
+    credit_ = capacity_credit_; // Initially full
+}
 
-void TokenBucket::refill() const {
-    auto now = std::chrono::steady_clock::now();
-    auto elapsed_microseconds = std::chrono::duration_cast<std::chrono::microseconds>(now - last_refill_time_).count();
+void TokenBucket::update_derived_limits() {
+    capacity_credit_ = capacity_bytes_ * CREDIT_PER_BYTE;
+    // With elapsed <= fill_time_ns_, elapsed * rate_bps_ <= capacity_credit_ + rate_bps_.
+    fill_time_ns_ = (rate_bps_ == 0) ? 0 : capacity_credit_ / rate_bps_ + 1;
+}
 
-    // Calculate new tokens: (elapsed_microseconds * rate_bps_) / (bits_in_byte * microseconds_in_second)
-    // (elapsed_microseconds * rate_bps_) / (8 * 1000000)
-    if (elapsed_microseconds > 0) { // Avoid division by zero or negative time
-        uint64_t new_tokens = (static_cast<uint64_t>(elapsed_microseconds) * rate_bps_) / (8 * 1000000);
-        if (new_tokens > 0) {
-            tokens_bytes_ = std::min(capacity_bytes_, tokens_bytes_ + new_tokens);
-        }
+void TokenBucket::refill(TimestampNs now_ns) const {
+    if (!has_refill_time_) {
+        // A full bucket can't gain tokens, so nothing is lost by starting the clock here.
+        last_refill_time_ns_ = now_ns;
+        has_refill_time_ = true;
+        return;
     }
-    last_refill_time_ = now;
+    if (now_ns <= last_refill_time_ns_) {
+        return; // No time has passed (or a caller's timestamp is slightly stale)
+    }
+    uint64_t elapsed_ns = std::min(now_ns - last_refill_time_ns_, fill_time_ns_);
+    // Exact: one nanosecond adds rate_bps_ credit units, so sub-byte amounts accumulate.
+    credit_ = std::min(capacity_credit_, credit_ + elapsed_ns * rate_bps_);
+    last_refill_time_ns_ = now_ns;
 }
 
 bool TokenBucket::consume(uint64_t tokens_to_consume) {
-    refill();
-    if (tokens_bytes_ >= tokens_to_consume) {
-        tokens_bytes_ -= tokens_to_consume;
+    return consume(tokens_to_consume, steady_now_ns());
+}
+
+bool TokenBucket::consume(uint64_t tokens_to_consume, TimestampNs now_ns) {
+    refill(now_ns);
+    if (tokens_to_consume > capacity_bytes_) {
+        return false; // Can never conform; also keeps the multiply below in range
+    }
+    uint64_t needed_credit = tokens_to_consume * CREDIT_PER_BYTE;
+    if (credit_ >= needed_credit) {
+        credit_ -= needed_credit;
         return true;
     }
     return false;
 }
 
+TimestampNs TokenBucket::grant_time(uint64_t tokens, TimestampNs now_ns) const {
+    refill(now_ns);
+    if (tokens > capacity_bytes_) {
+        return NEVER;
+    }
+    // After an earlier reservation the refill time lies ahead of now_ns and credit_ is
+    // what remains at that time, so this reservation starts from there.
+    TimestampNs base_ns = std::max(now_ns, last_refill_time_ns_);
+    uint64_t needed_credit = tokens * CREDIT_PER_BYTE;
+    if (credit_ >= needed_credit) {
+        return base_ns;
+    }
+    if (rate_bps_ == 0) {
+        return NEVER;
+    }
+    uint64_t wait_ns = (needed_credit - credit_ + rate_bps_ - 1) / rate_bps_;
+    TimestampNs release_ns = base_ns + wait_ns;
+    return release_ns < base_ns ? NEVER : release_ns;
+}
+
+TimestampNs TokenBucket::reserve(uint64_t tokens, TimestampNs now_ns, TimestampNs max_delay_ns) {
+    TimestampNs release_ns = grant_time(tokens, now_ns); // Refills
+    if (release_ns == NEVER || release_ns - now_ns > max_delay_ns) {
+        return NEVER;
+    }
+    uint64_t needed_credit = tokens * CREDIT_PER_BYTE;
+    if (credit_ >= needed_credit) {
+        credit_ -= needed_credit;
+        return release_ns;
+    }
+    TimestampNs base_ns = std::max(now_ns, last_refill_time_ns_);
+    credit_ = credit_ + (release_ns - base_ns) * rate_bps_ - needed_credit; // Sub-byte remainder carries over
+    last_refill_time_ns_ = release_ns;
+    return release_ns;
+}
+
+void TokenBucket::drain(uint64_t tokens, TimestampNs now_ns) {
+    refill(now_ns);
+    if (tokens > capacity_bytes_) {
+        credit_ = 0; // More than could ever be held; also keeps the multiply below in range
+        return;
+    }
+    uint64_t drained_credit = tokens * CREDIT_PER_BYTE;
+    credit_ = (credit_ > drained_credit) ? credit_ - drained_credit : 0;
+}
+
 uint64_t TokenBucket::available_tokens() const {
-    refill();
-    return tokens_bytes_;
+    return available_tokens(steady_now_ns());
+}
+
+uint64_t TokenBucket::available_tokens(TimestampNs now_ns) const {
+    refill(now_ns);
+    return credit_ / CREDIT_PER_BYTE;
 }
 
 bool TokenBucket::is_conforming(uint64_t packet_size_bytes) const {
-    refill();
-    return tokens_bytes_ >= packet_size_bytes;
+    return is_conforming(packet_size_bytes, steady_now_ns());
+}
+
+bool TokenBucket::is_conforming(uint64_t packet_size_bytes, TimestampNs now_ns) const {
+    refill(now_ns);
+    return packet_size_bytes <= capacity_bytes_ && credit_ >= packet_size_bytes * CREDIT_PER_BYTE;
 }
 
 void TokenBucket::set_rate(uint64_t rate_bps) {
-    refill(); // Update tokens based on the old rate before changing it
+    set_rate(rate_bps, steady_now_ns());
+}
+
+void TokenBucket::set_rate(uint64_t rate_bps, TimestampNs now_ns) {
+    refill(now_ns); // Update tokens based on the old rate before changing it
     rate_bps_ = rate_bps;
+    update_derived_limits();
 }
 
 void TokenBucket::set_capacity(uint64_t capacity_bytes) {
-    refill(); // Update tokens based on current state
-    capacity_bytes_ = capacity_bytes;
-    tokens_bytes_ = std::min(tokens_bytes_, capacity_bytes_); // Ensure tokens do not exceed new capacity
+    set_capacity(capacity_bytes, steady_now_ns());
+}
+
+void TokenBucket::set_capacity(uint64_t capacity_bytes, TimestampNs now_ns) {
+    refill(now_ns); // Update tokens based on current state
+    capacity_bytes_ = std::min(capacity_bytes, MAX_CAPACITY_BYTES);
+    update_derived_limits();
+    credit_ = std::min(credit_, capacity_credit_); // Ensure tokens do not exceed new capacity
 }
 
 } // namespace core
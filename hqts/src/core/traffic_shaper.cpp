@@ -1,36 +1,117 @@
 #include "hqts/core/traffic_shaper.h"
+#include "hqts/core/prefetch.h"       // For prefetch_for_write, PREFETCH_DISTANCE
+#include "hqts/core/stage_profiler.h" // For HQTS_PROFILE_STAGE
 // Other necessary direct includes for .cpp specific types if any, were already added/verified.
 // flow_classifier.h, flow_identifier.h, flow_context.h, flow_table.h should be
 // transitively included via traffic_shaper.h now.
-#include <stdexcept> // For std::runtime_error
-#include <string>    // For std::to_string in error messages
+#include <algorithm> // For std::max
+#include <memory>    // For std::make_unique
+#include <stdexcept> // For std::out_of_range
+#include <string>    // For std::to_string
+#include <utility>   // For std::swap
 
 namespace hqts {
 namespace core {
 
 TrafficShaper::TrafficShaper(policy::PolicyTree& pt, dataplane::FlowClassifier& fc, core::FlowTable& ft)
-    : policy_tree_(pt), flow_classifier_(fc), flow_table_(ft) {
-    // Constructor body
+    : policy_tree_(&pt),
+      owned_policies_(std::make_unique<policy::RuntimePolicyTable>(pt)),
+      runtime_policies_(owned_policies_.get()),
+      policy_reader_(runtime_policies_->register_reader()),
+      flow_classifier_(fc),
+      flow_table_(ft) {}
+
+TrafficShaper::TrafficShaper(policy::RuntimePolicyTable& rpt, dataplane::FlowClassifier& fc, core::FlowTable& ft)
+    : policy_tree_(nullptr),
+      runtime_policies_(&rpt),
+      policy_reader_(rpt.register_reader()),
+      flow_classifier_(fc),
+      flow_table_(ft) {}
+
+TrafficShaper::~TrafficShaper() {
+    runtime_policies_->unregister_reader(policy_reader_);
+}
+
+void TrafficShaper::invalidate_policy_cache() {
+    if (policy_tree_ != nullptr) {
+        owned_policies_->publish(*policy_tree_); // New version: every cached handle is stale
+    }
+}
+
+policy::CompiledPolicies& TrafficShaper::current_policies() {
+    if (policies_ == nullptr || policies_->version() != runtime_policies_->version()) {
+        // Only after a publish(): carries bucket state and statistics slots over.
+        policies_ = runtime_policies_->refresh(policy_reader_, policies_);
+        assign_statistics_slots(true);
+    }
+    return *policies_;
+}
+
+void TrafficShaper::attach_statistics(PerCorePolicyStatistics* statistics, size_t core) {
+    if (statistics != nullptr && core >= statistics->num_cores()) {
+        throw std::out_of_range("TrafficShaper: statistics core " + std::to_string(core) + " does not exist.");
+    }
+    statistics_ = statistics;
+    statistics_core_ = core;
+    if (policies_ != nullptr) {
+        assign_statistics_slots(false); // Otherwise done when the first snapshot is picked up
+    }
+}
+
+void TrafficShaper::assign_statistics_slots(bool missing_only) {
+    policy::CompiledPolicies& policies = *policies_;
+    for (uint32_t index = 0; index < policies.size(); ++index) {
+        policy::RuntimePolicy& record = policies[index];
+        if (missing_only && record.stats_slot != PerCorePolicyStatistics::NO_SLOT) {
+            continue;
+        }
+        record.stats_slot = (statistics_ != nullptr) ? statistics_->slot_of(record.id)
+                                                     : PerCorePolicyStatistics::NO_SLOT;
+    }
+}
+
+policy::RuntimePolicy* TrafficShaper::resolve_policy(const core::FlowContext& flow_context) {
+    policy::CompiledPolicies& policies = current_policies();
+    if (flow_context.policy_generation == policies.version() &&
+        flow_context.policy->id == flow_context.policy_id) {
+        return flow_context.policy; // The record is read by metering anyway: checking its id is free
+    }
+    policy::RuntimePolicy* record = policies.find(flow_context.policy_id);
+    if (record == nullptr) {
+        // Compare contents, not sizes: erasing one policy and adding another keeps the size.
+        if (policy_tree_ == nullptr || policy_tree_->find(flow_context.policy_id) == policy_tree_->end()) {
+            return nullptr; // Not cached: the policy may be published later
+        }
+        // The policy was added to the tree since it was compiled.
+        owned_policies_->publish(*policy_tree_);
+        return resolve_policy(flow_context);
+    }
+    flow_context.policy = record;
+    flow_context.policy_generation = policies.version();
+    return record;
 }
 
 // Private helper method implementation
 scheduler::ConformanceLevel TrafficShaper::apply_token_buckets(
     const scheduler::PacketDescriptor& packet,
-    ShapingPolicy& policy) { // Policy is non-const as its token buckets are modified
+    policy::RuntimePolicy& policy, // Policy is non-const as its token buckets are modified
+    TimestampNs now_ns) {
 
-    // TokenBucket::consume is const but modifies mutable members.
-    bool conforms_to_cir = policy.cir_bucket.consume(packet.packet_length_bytes);
+    if (policy.parent_index != policy::NO_POLICY_INDEX) {
+        return apply_hierarchical_token_buckets(packet, policy, now_ns);
+    }
+    bool conforms_to_cir = policy.cir_bucket.consume(packet.packet_length_bytes, now_ns);
 
     if (conforms_to_cir) {
         // If it conforms to CIR, it's GREEN.
         // For srTCM-like behavior, green packets also consume from PIR bucket.
         // If PIR bucket is only for yellow, this consume might be conditional or different.
         // Assuming for now that PIR bucket tracks all traffic that has passed CIR.
-        policy.pir_bucket.consume(packet.packet_length_bytes);
+        policy.pir_bucket.consume(packet.packet_length_bytes, now_ns);
         return scheduler::ConformanceLevel::GREEN;
     } else {
         // Failed CIR, try PIR for YELLOW
-        bool conforms_to_pir = policy.pir_bucket.consume(packet.packet_length_bytes);
+        bool conforms_to_pir = policy.pir_bucket.consume(packet.packet_length_bytes, now_ns);
         if (conforms_to_pir) {
             return scheduler::ConformanceLevel::YELLOW;
         } else {
@@ -39,72 +120,272 @@ scheduler::ConformanceLevel TrafficShaper::apply_token_buckets(
     }
 }
 
+scheduler::ConformanceLevel TrafficShaper::apply_hierarchical_token_buckets(
+    const scheduler::PacketDescriptor& packet,
+    policy::RuntimePolicy& leaf,
+    TimestampNs now_ns) {
+    const uint64_t length = packet.packet_length_bytes;
+    policy::CompiledPolicies& policies = *policies_; // The snapshot `leaf` belongs to
+
+    // Check pass, leaf to root: nothing is charged for a packet that turns out RED.
+    // The lender is the lowest level with committed tokens to spare; a leaf over its
+    // own CIR borrows from an ancestor as an HTB class borrows from its parent.
+    policy::RuntimePolicy* lender = leaf.cir_bucket.is_conforming(length, now_ns) ? &leaf : nullptr;
+    // The leaf's peak rate is its ceiling for borrowing.
+    bool may_borrow = !leaf.has_peak_rate || leaf.pir_bucket.is_conforming(length, now_ns);
+    for (uint32_t index = leaf.parent_index; index != policy::NO_POLICY_INDEX;
+         index = policies[index].parent_index) {
+        policy::RuntimePolicy& ancestor = policies[index];
+        if (ancestor.has_peak_rate && !ancestor.pir_bucket.is_conforming(length, now_ns)) {
+            return scheduler::ConformanceLevel::RED; // The aggregate is at its cap
+        }
+        if (lender == nullptr && may_borrow && ancestor.cir_bucket.is_conforming(length, now_ns)) {
+            lender = &ancestor;
+        }
+    }
+
+    scheduler::ConformanceLevel conformance = scheduler::ConformanceLevel::GREEN;
+    if (lender == nullptr) {
+        // Nothing to borrow: the leaf's own PIR decides, as for a root policy.
+        if (!leaf.pir_bucket.is_conforming(length, now_ns)) {
+            return scheduler::ConformanceLevel::RED;
+        }
+        conformance = scheduler::ConformanceLevel::YELLOW;
+    }
+
+    // Charge pass: every level's PIR sees all its subtree's traffic, and committed
+    // tokens are used up from the lender to the root, so an ancestor lends only what
+    // its descendants leave unused. Levels below the lender have no committed tokens left.
+    leaf.pir_bucket.consume(length, now_ns); // As for a root policy, even if it falls short
+    bool above_lender = (lender == &leaf);
+    if (above_lender) {
+        leaf.cir_bucket.consume(length, now_ns);
+    }
+    for (uint32_t index = leaf.parent_index; index != policy::NO_POLICY_INDEX;
+         index = policies[index].parent_index) {
+        policy::RuntimePolicy& ancestor = policies[index];
+        if (ancestor.has_peak_rate) {
+            ancestor.pir_bucket.consume(length, now_ns);
+        }
+        above_lender = above_lender || (lender == &ancestor);
+        if (above_lender) {
+            ancestor.cir_bucket.drain(length, now_ns);
+        }
+    }
+    return conformance;
+}
+
+TimestampNs TrafficShaper::reserve_hierarchical(uint64_t length, policy::RuntimePolicy& leaf,
+                                                TimestampNs now_ns, TimestampNs max_delay_ns) {
+    policy::CompiledPolicies& policies = *policies_; // The snapshot `leaf` belongs to
+
+    // Check pass: the packet leaves when the leaf's CIR and every capped ancestor's PIR
+    // have its tokens; nothing is booked if that is too late.
+    TimestampNs release_ns = leaf.cir_bucket.grant_time(length, now_ns);
+    for (uint32_t index = leaf.parent_index; index != policy::NO_POLICY_INDEX && release_ns != TokenBucket::NEVER;
+         index = policies[index].parent_index) {
+        const policy::RuntimePolicy& ancestor = policies[index];
+        if (ancestor.has_peak_rate) {
+            release_ns = std::max(release_ns, ancestor.pir_bucket.grant_time(length, now_ns));
+        }
+    }
+    if (release_ns == TokenBucket::NEVER || release_ns - now_ns > max_delay_ns) {
+        return TokenBucket::NEVER;
+    }
+
+    // Book pass: each bucket grants by release_ns, so none of these fails. Ancestors'
+    // committed tokens are used up as by an unshaped child's traffic.
+    leaf.cir_bucket.reserve(length, now_ns, max_delay_ns);
+    for (uint32_t index = leaf.parent_index; index != policy::NO_POLICY_INDEX;
+         index = policies[index].parent_index) {
+        policy::RuntimePolicy& ancestor = policies[index];
+        if (ancestor.has_peak_rate) {
+            ancestor.pir_bucket.reserve(length, now_ns, max_delay_ns);
+        }
+        ancestor.cir_bucket.drain(length, now_ns);
+    }
+    return release_ns;
+}
+
+bool TrafficShaper::meter_packet(scheduler::PacketDescriptor& packet, policy::RuntimePolicy& policy,
+                                 TimestampNs now_ns, TimestampNs* release_ns) {
+    packet.policy_id = policy.id; // Lets a SchedulerTree queue it at the policy's node
+    scheduler::ConformanceLevel conformance_level;
+    if (release_ns != nullptr) {
+        *release_ns = now_ns;
+    }
+    if (policy.shape_to_cir) {
+        // Shaping: excess traffic waits for CIR tokens instead of being marked down.
+        TimestampNs max_delay_ns = (release_ns != nullptr) ? policy.max_shaping_delay_ns : 0;
+        TimestampNs granted_ns =
+            policy.parent_index == policy::NO_POLICY_INDEX
+                ? policy.cir_bucket.reserve(packet.packet_length_bytes, now_ns, max_delay_ns)
+                : reserve_hierarchical(packet.packet_length_bytes, policy, now_ns, max_delay_ns);
+        if (granted_ns == TokenBucket::NEVER) {
+            conformance_level = scheduler::ConformanceLevel::RED;
+        } else {
+            conformance_level = scheduler::ConformanceLevel::GREEN;
+            if (release_ns != nullptr) {
+                *release_ns = granted_ns;
+            }
+        }
+    } else {
+        conformance_level = apply_token_buckets(packet, policy, now_ns);
+    }
+    packet.conformance = conformance_level;
+
+    bool dropped = (conformance_level == scheduler::ConformanceLevel::RED && policy.drop_on_red);
+    if (statistics_ != nullptr) {
+        statistics_->record(statistics_core_, policy.stats_slot, conformance_level,
+                            packet.packet_length_bytes, dropped);
+    }
+    if (dropped) {
+        return false;
+    }
+
+    // Set packet priority based on conformance and policy targets
+    switch (conformance_level) {
+        case scheduler::ConformanceLevel::GREEN:
+            packet.priority = policy.target_priority_green;
+            break;
+        case scheduler::ConformanceLevel::YELLOW:
+            packet.priority = policy.target_priority_yellow;
+            break;
+        case scheduler::ConformanceLevel::RED: // Not dropped by policy.drop_on_red
+            packet.priority = policy.target_priority_red;
+            break;
+    }
+    return true;
+}
+
 bool TrafficShaper::process_packet(
-    scheduler::PacketDescriptor& packet, // Packet is modified (flow_id, conformance, priority)
+    scheduler::PacketDescriptor& packet,
     const dataplane::FiveTuple& five_tuple) {
+    return process_packet(packet, five_tuple, steady_now_ns()); // One clock read per packet
+}
 
-    // 1. Classify and get FlowId, ensuring FlowContext exists
-    core::FlowId flow_id = flow_classifier_.get_or_create_flow(five_tuple);
-    packet.flow_id = flow_id; // Set the flow_id on the packet
+bool TrafficShaper::process_packet(
+    scheduler::PacketDescriptor& packet, // Packet is modified (flow_id, conformance, priority)
+    const dataplane::FiveTuple& five_tuple,
+    TimestampNs now_ns) {
+    return process_packet(packet, five_tuple, now_ns, nullptr);
+}
 
-    // Retrieve the FlowContext
-    auto fc_it = flow_table_.find(flow_id);
-    if (fc_it == flow_table_.end()) {
-        // This should ideally not happen if get_or_create_flow ensures context creation.
-        throw std::runtime_error("TrafficShaper: FlowContext not found in table for flow_id: " + std::to_string(flow_id));
-    }
-    const core::FlowContext& flow_context = fc_it->second;
+bool TrafficShaper::process_packet(
+    scheduler::PacketDescriptor& packet,
+    const dataplane::FiveTuple& five_tuple,
+    TimestampNs now_ns,
+    TimestampNs* release_ns) {
 
-    // 2. Retrieve ShapingPolicy for the flow using policy_id from FlowContext
-    auto& policy_id_index = policy_tree_.get<policy::by_id>();
-    auto policy_it = policy_id_index.find(flow_context.policy_id);
+    // 1. Classify: a single FlowTable probe yields the flow's context (created if new)
+    const core::FlowContext* flow_context_ptr;
+    {
+        HQTS_PROFILE_STAGE(ProfileStage::CLASSIFY);
+        flow_context_ptr = flow_classifier_.classify(five_tuple, now_ns);
+    }
+    HQTS_PROFILE_STAGE(ProfileStage::METER);
+    if (flow_context_ptr == nullptr) {
+        // FlowTable is full and this is a new flow: it has no state to be shaped with.
+        packet.conformance = scheduler::ConformanceLevel::RED;
+        return false;
+    }
+    const core::FlowContext& flow_context = *flow_context_ptr;
+    packet.flow_id = flow_context.flow_id; // Set the flow_id on the packet
 
-    if (policy_it == policy_id_index.end()) {
+    // 2. Retrieve the flow's compiled policy: a cached handle after its first packet
+    policy::RuntimePolicy* policy = resolve_policy(flow_context);
+    if (policy == nullptr) {
         packet.conformance = scheduler::ConformanceLevel::RED;
         // Consider logging this event: Policy ID from FlowContext not found in PolicyTree.
         return false; // Drop if policy referenced by flow context is not found
     }
 
-    // Variables to be set by the modifier lambda (which modifies policy's token buckets)
-    scheduler::ConformanceLevel conformance_level;
-    bool drop_this_packet = false;
+    return meter_packet(packet, *policy, now_ns, release_ns);
+}
 
-    // Use policy_tree_.modify to get non-const access to the policy object
-    // and update its token buckets.
-    bool modified_successfully = policy_tree_.modify(policy_it,
-        [&](ShapingPolicy& modifiable_policy) { // modifiable_policy is non-const
+size_t TrafficShaper::process_burst(
+    scheduler::PacketDescriptor* packets,
+    const dataplane::FiveTuple* five_tuples,
+    size_t count) {
+    return process_burst(packets, five_tuples, count, steady_now_ns()); // One clock read per burst
+}
 
-        conformance_level = this->apply_token_buckets(packet, modifiable_policy); // packet is const here
-        packet.conformance = conformance_level; // Modify the packet passed by reference to process_packet
+size_t TrafficShaper::process_burst(
+    scheduler::PacketDescriptor* packets,
+    const dataplane::FiveTuple* five_tuples,
+    size_t count,
+    TimestampNs now_ns) {
+    return process_burst(packets, five_tuples, count, now_ns, nullptr);
+}
 
-        if (conformance_level == scheduler::ConformanceLevel::RED && modifiable_policy.drop_on_red) {
-            drop_this_packet = true;
-        } else {
-            drop_this_packet = false;
-            // Set packet priority based on conformance and policy targets
-            switch (conformance_level) {
-                case scheduler::ConformanceLevel::GREEN:
-                    packet.priority = modifiable_policy.target_priority_green;
-                    break;
-                case scheduler::ConformanceLevel::YELLOW:
-                    packet.priority = modifiable_policy.target_priority_yellow;
-                    break;
-                case scheduler::ConformanceLevel::RED: // Not dropped by policy.drop_on_red
-                    packet.priority = modifiable_policy.target_priority_red;
-                    break;
+size_t TrafficShaper::process_burst(
+    scheduler::PacketDescriptor* packets,
+    const dataplane::FiveTuple* five_tuples,
+    size_t count,
+    TimestampNs now_ns,
+    TimestampNs* release_ns) {
+
+    if (count == 0) {
+        return 0;
+    }
+
+    // Stage 1: classify the whole burst.
+    burst_contexts_.resize(count);
+    {
+        HQTS_PROFILE_STAGE(ProfileStage::CLASSIFY, count);
+        flow_classifier_.classify_burst(five_tuples, count, now_ns, burst_contexts_.data());
+    }
+    HQTS_PROFILE_STAGE(ProfileStage::METER, count);
+
+    // Stage 2: meter each packet against its flow's policy, compacting kept packets
+    // to the front. Pipelined so the misses of later packets overlap the metering of
+    // this one: the policy record of packet i + 2d is prefetched, then the statistics
+    // counters of packet i + d, whose record has arrived by then (d = PREFETCH_DISTANCE).
+    current_policies(); // cached_policy() compares against the latest snapshot
+    const size_t distance = PREFETCH_DISTANCE;
+    for (size_t i = 0; i < count && i < 2 * distance; ++i) {
+        if (const policy::RuntimePolicy* policy = cached_policy(burst_contexts_[i])) {
+            prefetch_for_write(policy);
+        }
+    }
+    size_t kept = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (i + 2 * distance < count) {
+            if (const policy::RuntimePolicy* ahead = cached_policy(burst_contexts_[i + 2 * distance])) {
+                prefetch_for_write(ahead);
             }
         }
-    });
-
-    if (!modified_successfully) {
-        // This implies policy_it was invalid (e.g. points to end() or was erased concurrently),
-        // though the find() check above should prevent this for valid policy_id.
-        throw std::runtime_error("TrafficShaper: Failed to modify policy tree for policy_id: " +
-                                 std::to_string(flow_context.policy_id) +
-                                 ". Policy iterator may be invalid.");
+        if (statistics_ != nullptr && i + distance < count) {
+            if (const policy::RuntimePolicy* ahead = cached_policy(burst_contexts_[i + distance])) {
+                statistics_->prefetch(statistics_core_, ahead->stats_slot);
+            }
+        }
+        const core::FlowContext* flow_context = burst_contexts_[i];
+        if (flow_context == nullptr) {
+            // Same treatment as process_packet: a new flow that did not fit is RED and dropped.
+            packets[i].conformance = scheduler::ConformanceLevel::RED;
+            continue;
+        }
+        packets[i].flow_id = flow_context->flow_id;
+        policy::RuntimePolicy* policy = resolve_policy(*flow_context);
+        if (policy == nullptr) {
+            // Same treatment as process_packet: unknown policy means RED and dropped.
+            packets[i].conformance = scheduler::ConformanceLevel::RED;
+            continue;
+        }
+        TimestampNs* packet_release_ns = (release_ns != nullptr) ? &release_ns[i] : nullptr;
+        if (meter_packet(packets[i], *policy, now_ns, packet_release_ns)) {
+            if (kept != i) {
+                std::swap(packets[kept], packets[i]); // Dropped packets collect at the back
+                if (release_ns != nullptr) {
+                    release_ns[kept] = release_ns[i];
+                }
+            }
+            ++kept;
+        }
     }
 
-    return !drop_this_packet;
+    return kept;
 }
 
 } // namespace core
@@ -0,0 +1,132 @@
+#include "hqts/dataplane/address_interner.h"
+#include "hqts/dataplane/flow_hash.h" // For hash_key_words
+
+#include <algorithm> // For std::fill
+#include <cstring>   // For std::memcpy
+#include <mutex>     // For std::unique_lock
+#include <stdexcept> // For std::invalid_argument
+#include <string>    // For std::to_string in error messages
+
+namespace hqts {
+namespace dataplane {
+
+namespace {
+
+constexpr size_t NOT_FOUND = SIZE_MAX;
+
+size_t next_power_of_two(size_t n) {
+    size_t p = 1;
+    while (p < n) {
+        p <<= 1;
+    }
+    return p;
+}
+
+uint64_t hash_address(uint64_t segment, const std::array<uint8_t, 16>& address) {
+    uint64_t words[2];
+    std::memcpy(words, address.data(), sizeof(words));
+    return hash_key_words(words[0] ^ (segment * 0x9E3779B97F4A7C15ull), words[1]);
+}
+
+} // namespace
+
+AddressInterner::AddressInterner(size_t max_addresses) : max_addresses_(max_addresses) {
+    // At most half the slots are used, so probe sequences stay short and end at a free slot.
+    size_t slots = next_power_of_two(max_addresses * 2);
+    if (max_addresses == 0 || max_addresses > SIZE_MAX / 2 || slots > NO_HANDLE) {
+        throw std::invalid_argument("AddressInterner: max_addresses " + std::to_string(max_addresses) +
+                                    " must be greater than 0 and fit 32-bit handles.");
+    }
+    mask_ = slots - 1;
+    entries_.reset(new Entry[slots]);
+    ctrl_.assign(slots, CTRL_EMPTY);
+}
+
+size_t AddressInterner::find_locked(size_t home, uint64_t segment, const std::array<uint8_t, 16>& address) const {
+    size_t index = home;
+    for (size_t probes = 0; probes <= mask_; ++probes) {
+        if (ctrl_[index] == CTRL_EMPTY) {
+            return NOT_FOUND;
+        }
+        if (ctrl_[index] == CTRL_FULL && entries_[index].segment == segment && entries_[index].address == address) {
+            return index;
+        }
+        index = (index + 1) & mask_;
+    }
+    return NOT_FOUND;
+}
+
+uint32_t AddressInterner::intern(uint64_t segment, const std::array<uint8_t, 16>& address, uint64_t now_ns) {
+    const size_t home = hash_address(segment, address) & mask_;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_); // Fast path: known address
+        size_t index = find_locked(home, segment, address);
+        if (index != NOT_FOUND) {
+            std::atomic<uint64_t>& last_used = entries_[index].last_used_ns;
+            // Only move the stamp forward, and skip the store when it is current, so that
+            // threads sharing an address don't keep stealing its line from each other.
+            if (last_used.load(std::memory_order_relaxed) < now_ns) {
+                last_used.store(now_ns, std::memory_order_relaxed);
+            }
+            return static_cast<uint32_t>(index);
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    // Probe again: another thread may have interned the pair between the two locks.
+    size_t index = find_locked(home, segment, address);
+    if (index == NOT_FOUND) {
+        if (size_.load(std::memory_order_relaxed) >= max_addresses_) {
+            return NO_HANDLE;
+        }
+        index = home;
+        while (ctrl_[index] == CTRL_FULL) {
+            index = (index + 1) & mask_;
+        }
+        entries_[index].address = address;
+        entries_[index].segment = segment;
+        entries_[index].last_used_ns.store(now_ns, std::memory_order_relaxed);
+        ctrl_[index] = CTRL_FULL;
+        size_.fetch_add(1, std::memory_order_relaxed);
+    } else if (entries_[index].last_used_ns.load(std::memory_order_relaxed) < now_ns) {
+        entries_[index].last_used_ns.store(now_ns, std::memory_order_relaxed);
+    }
+    return static_cast<uint32_t>(index);
+}
+
+size_t AddressInterner::reclaim(uint64_t cutoff_ns) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    size_t freed = 0;
+    size_t empty = NOT_FOUND;
+    for (size_t i = 0; i <= mask_; ++i) {
+        if (ctrl_[i] == CTRL_FULL && entries_[i].last_used_ns.load(std::memory_order_relaxed) < cutoff_ns) {
+            ctrl_[i] = CTRL_DELETED;
+            ++freed;
+        }
+        if (ctrl_[i] == CTRL_EMPTY) {
+            empty = i;
+        }
+    }
+    size_.fetch_sub(freed, std::memory_order_relaxed);
+
+    // Turn tombstones that end a probe sequence back into empty slots, walking backwards
+    // from an empty slot, so that reclaimed entries don't lengthen later probes.
+    if (empty != NOT_FOUND) {
+        for (size_t step = 1; step <= mask_; ++step) {
+            size_t i = (empty - step) & mask_;
+            if (ctrl_[i] == CTRL_DELETED && ctrl_[(i + 1) & mask_] == CTRL_EMPTY) {
+                ctrl_[i] = CTRL_EMPTY;
+            }
+        }
+    }
+    return freed;
+}
+
+void AddressInterner::clear() {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    std::fill(ctrl_.begin(), ctrl_.end(), CTRL_EMPTY);
+    size_.store(0, std::memory_order_relaxed);
+}
+
+} // namespace dataplane
+} // namespace hqts
@@ -0,0 +1,116 @@
+#include "hqts/dataplane/dual_stack_classifier.h"
+
+#include <stdexcept> // For std::invalid_argument
+
+namespace hqts {
+namespace dataplane {
+
+namespace {
+
+// Extended flows start like FlowClassifier's new flows.
+constexpr core::QueueId DEFAULT_INITIAL_QUEUE_ID = 0;
+constexpr core::DropPolicy DEFAULT_INITIAL_DROP_POLICY = core::DropPolicy::TAIL_DROP;
+
+uint64_t segment_of(const ExtendedFlowKey& key) {
+    return (static_cast<uint64_t>(key.vni & 0xFFFFFFu) << 16) | key.vlan_id;
+}
+
+} // namespace
+
+DualStackFlowClassifier::DualStackFlowClassifier(core::FlowTable& ipv4_table, core::FlowTable& extended_table,
+                                                 size_t max_addresses, policy::PolicyId default_policy_id,
+                                                 const RuleClassifier* rules)
+    : ipv4_(ipv4_table, default_policy_id, rules),
+      ipv4_table_(ipv4_table),
+      extended_table_(extended_table),
+      default_policy_id_(default_policy_id),
+      addresses_(max_addresses) {
+    if (&ipv4_table == &extended_table) {
+        throw std::invalid_argument("DualStackFlowClassifier: the IPv4 and extended tables must differ.");
+    }
+}
+
+bool DualStackFlowClassifier::compress(const ExtendedFlowKey& key, uint64_t now_ns, FiveTuple& out) {
+    const uint64_t segment = segment_of(key);
+    uint32_t source = addresses_.intern(segment, key.source_ip, now_ns);
+    uint32_t dest = addresses_.intern(segment, key.dest_ip, now_ns);
+    if (source == AddressInterner::NO_HANDLE || dest == AddressInterner::NO_HANDLE) {
+        return false;
+    }
+    out = FiveTuple(source, dest, key.source_port, key.dest_port, key.protocol);
+    return true;
+}
+
+core::FlowContext* DualStackFlowClassifier::classify(const ExtendedFlowKey& key, uint64_t now_ns) {
+    if (key.is_plain_ipv4()) {
+        return ipv4_.classify(key.to_ipv4(), now_ns);
+    }
+    FiveTuple compressed;
+    if (!compress(key, now_ns, compressed)) {
+        return nullptr;
+    }
+    return extended_table_.find_or_insert(compressed, default_policy_id_, DEFAULT_INITIAL_QUEUE_ID,
+                                          DEFAULT_INITIAL_DROP_POLICY, now_ns).first;
+}
+
+void DualStackFlowClassifier::classify_burst(const ExtendedFlowKey* keys, size_t count, uint64_t now_ns,
+                                             core::FlowContext** contexts_out) {
+    constexpr size_t BATCH = core::FlowTable::LOOKUP_BATCH;
+    FiveTuple ipv4_keys[BATCH];
+    FiveTuple extended_keys[BATCH];
+    size_t ipv4_index[BATCH];
+    size_t extended_index[BATCH];
+    core::FlowContext* found[BATCH];
+    for (size_t begin = 0; begin < count; begin += BATCH) {
+        size_t n = count - begin < BATCH ? count - begin : BATCH;
+        size_t ipv4_count = 0;
+        size_t extended_count = 0;
+        for (size_t i = begin; i < begin + n; ++i) {
+            if (keys[i].is_plain_ipv4()) {
+                ipv4_keys[ipv4_count] = keys[i].to_ipv4();
+                ipv4_index[ipv4_count++] = i;
+            } else if (compress(keys[i], now_ns, extended_keys[extended_count])) {
+                extended_index[extended_count++] = i;
+            } else {
+                contexts_out[i] = nullptr; // Interner full
+            }
+        }
+        if (ipv4_count > 0) {
+            ipv4_.classify_burst(ipv4_keys, ipv4_count, now_ns, found);
+            for (size_t i = 0; i < ipv4_count; ++i) {
+                contexts_out[ipv4_index[i]] = found[i];
+            }
+        }
+        if (extended_count > 0) {
+            extended_table_.find_or_insert_burst(extended_keys, extended_count, default_policy_id_,
+                                                 DEFAULT_INITIAL_QUEUE_ID, DEFAULT_INITIAL_DROP_POLICY, now_ns,
+                                                 found);
+            for (size_t i = 0; i < extended_count; ++i) {
+                contexts_out[extended_index[i]] = found[i];
+            }
+        }
+    }
+}
+
+size_t DualStackFlowClassifier::age_flows(uint64_t now_ns) {
+    size_t expired = ipv4_table_.age(now_ns);
+
+    std::lock_guard<std::mutex> lock(aging_mutex_);
+    if (sweeps_in_pass_ == 0) {
+        pass_start_ns_ = now_ns;
+    }
+    expired += extended_table_.age(now_ns);
+    if (++sweeps_in_pass_ >= extended_table_.sweeps_per_pass()) {
+        // Every flow left in the table was swept at or after pass_start_ns_ and survived,
+        // so it was seen after pass_start_ns_ - idle_timeout, and so were its addresses.
+        sweeps_in_pass_ = 0;
+        const uint64_t idle_timeout = extended_table_.aging_config().idle_timeout_ns;
+        if (idle_timeout != 0 && pass_start_ns_ > idle_timeout) {
+            addresses_.reclaim(pass_start_ns_ - idle_timeout);
+        }
+    }
+    return expired;
+}
+
+} // namespace dataplane
+} // namespace hqts
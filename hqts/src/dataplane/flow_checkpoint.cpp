@@ -0,0 +1,333 @@
+#include "hqts/dataplane/flow_checkpoint.h"
+
+#include <algorithm> // For std::min
+#include <cerrno>
+#include <cstdio>    // For std::rename, std::remove
+#include <new>       // For placement new
+#include <stdexcept> // For std::runtime_error
+#include <string>    // For std::to_string in error messages
+#include <system_error>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>    // For open
+#include <sys/mman.h> // For mmap, msync
+#include <sys/stat.h> // For fstat
+#include <unistd.h>   // For ftruncate, close, fsync
+#define HQTS_HAVE_MMAP 1
+#endif
+
+namespace hqts {
+namespace core {
+
+namespace {
+
+constexpr uint64_t CACHE_LINE_BYTES = 64;
+
+uint64_t align_up(uint64_t bytes) {
+    return (bytes + CACHE_LINE_BYTES - 1) & ~(CACHE_LINE_BYTES - 1);
+}
+
+[[noreturn]] void throw_errno(const std::string& what) {
+    throw std::system_error(errno, std::generic_category(), "FlowCheckpoint: " + what);
+}
+
+template <typename Record>
+Record* records_at(void* mapping, uint64_t offset) {
+    return reinterpret_cast<Record*>(static_cast<unsigned char*>(mapping) + offset);
+}
+
+template <typename Record>
+const Record* records_at(const void* mapping, uint64_t offset) {
+    return reinterpret_cast<const Record*>(static_cast<const unsigned char*>(mapping) + offset);
+}
+
+// Makes a rename into the directory holding `path` durable.
+bool sync_parent_directory(const std::string& path) {
+#ifdef HQTS_HAVE_MMAP
+    const size_t slash = path.find_last_of('/');
+    const std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    int fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0) {
+        return false;
+    }
+    bool synced = fsync(fd) == 0;
+    int error = errno;
+    close(fd);
+    errno = error;
+    return synced;
+#else
+    (void)path;
+    return true;
+#endif
+}
+
+bool same_flow(const FlowRecord& a, const FlowRecord& b) {
+    if (a.live != b.live) {
+        return false;
+    }
+    return !a.live || (a.key == b.key && a.policy_id == b.policy_id && a.queue_id == b.queue_id &&
+                       a.drop_policy == b.drop_policy && a.sla_status == b.sla_status &&
+                       a.last_seen_ns == b.last_seen_ns);
+}
+
+} // namespace
+
+FlowCheckpointWriter::FlowCheckpointWriter(const std::string& path, const FlowTable& table, size_t max_policies)
+    : table_(table), path_(path), temporary_path_(path + ".tmp"), scratch_() {
+    const uint64_t flows_offset = align_up(sizeof(FlowCheckpointHeader));
+    const uint64_t policies_offset =
+        align_up(flows_offset + uint64_t{table.slot_count()} * sizeof(FlowCheckpointRecord));
+    const uint64_t file_bytes = align_up(policies_offset + uint64_t{max_policies} * sizeof(PolicyBucketRecord));
+
+#ifdef HQTS_HAVE_MMAP
+    // Built under a temporary name: `path` keeps the previous checkpoint until this
+    // one has completed a pass (see publish()).
+    int fd = open(temporary_path_.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw_errno("cannot create " + temporary_path_);
+    }
+    if (ftruncate(fd, static_cast<off_t>(file_bytes)) != 0) {
+        int error = errno;
+        close(fd);
+        std::remove(temporary_path_.c_str());
+        errno = error;
+        throw_errno("cannot size " + temporary_path_);
+    }
+    void* mapping = mmap(nullptr, file_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    int error = errno;
+    close(fd); // The mapping keeps the file open
+    if (mapping == MAP_FAILED) {
+        std::remove(temporary_path_.c_str());
+        errno = error;
+        throw_errno("cannot map " + temporary_path_);
+    }
+    mapping_ = mapping;
+    mapping_bytes_ = static_cast<size_t>(file_bytes);
+#else
+    throw std::runtime_error("FlowCheckpoint: memory-mapped files are not supported on this platform.");
+#endif
+
+    // ftruncate zero-filled the file: every record starts out as a free slot.
+    FlowCheckpointHeader* header = new (mapping_) FlowCheckpointHeader();
+    header->format_version = FLOW_CHECKPOINT_FORMAT_VERSION;
+    header->record_bytes = static_cast<uint32_t>(sizeof(FlowCheckpointRecord));
+    header->file_bytes = file_bytes;
+    header->slot_count = table.slot_count();
+    header->flows_offset = flows_offset;
+    header->policies_offset = policies_offset;
+    header->max_policies = static_cast<uint32_t>(max_policies);
+    header->num_policies = 0;
+    header->completed_passes.store(0, std::memory_order_relaxed);
+    header->policies_sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = FLOW_CHECKPOINT_MAGIC; // Last: a file with the magic has a complete header
+}
+
+FlowCheckpointWriter::~FlowCheckpointWriter() {
+#ifdef HQTS_HAVE_MMAP
+    if (mapping_ != nullptr) {
+        munmap(mapping_, mapping_bytes_); // A published file stays: it is the checkpoint
+        if (!published_) {
+            std::remove(temporary_path_.c_str()); // Incomplete: the previous checkpoint stands
+        }
+    }
+#endif
+}
+
+size_t FlowCheckpointWriter::save_flows(size_t max_slots) {
+    FlowCheckpointHeader* header = static_cast<FlowCheckpointHeader*>(mapping_);
+    const size_t slot_count = table_.slot_count();
+    size_t count = std::min(max_slots, slot_count - cursor_);
+    scratch_.resize(count);
+    table_.export_slots(cursor_, count, scratch_.data());
+
+    FlowCheckpointRecord* records = records_at<FlowCheckpointRecord>(mapping_, header->flows_offset);
+    size_t rewritten = 0;
+    for (size_t i = 0; i < count; ++i) {
+        FlowCheckpointRecord& record = records[cursor_ + i];
+        if (same_flow(record.flow, scratch_[i])) {
+            continue; // Unchanged: leave the page clean
+        }
+        uint64_t sequence = record.sequence.load(std::memory_order_relaxed);
+        record.sequence.store(sequence + 1, std::memory_order_relaxed); // Odd: being rewritten
+        std::atomic_thread_fence(std::memory_order_release);
+        record.flow = scratch_[i];
+        record.sequence.store(sequence + 2, std::memory_order_release);
+        ++rewritten;
+    }
+
+    cursor_ += count;
+    if (cursor_ == slot_count) {
+        cursor_ = 0;
+        header->completed_passes.fetch_add(1, std::memory_order_release);
+        if (!published_) {
+            publish();
+        }
+    }
+    return rewritten;
+}
+
+void FlowCheckpointWriter::publish() {
+    sync(); // The contents must be durable before the name points at them
+#ifdef HQTS_HAVE_MMAP
+    if (std::rename(temporary_path_.c_str(), path_.c_str()) != 0) {
+        throw_errno("cannot rename " + temporary_path_ + " to " + path_);
+    }
+    published_ = true;
+    if (!sync_parent_directory(path_)) {
+        throw_errno("cannot sync the directory of " + path_);
+    }
+#endif
+}
+
+size_t FlowCheckpointWriter::save_all_flows() {
+    size_t rewritten = 0;
+    uint64_t passes = completed_passes();
+    while (completed_passes() == passes) {
+        rewritten += save_flows(table_.slot_count());
+    }
+    return rewritten;
+}
+
+size_t FlowCheckpointWriter::save_policies(const policy::CompiledPolicies& policies, TimestampNs now_ns) {
+    FlowCheckpointHeader* header = static_cast<FlowCheckpointHeader*>(mapping_);
+    uint32_t count = static_cast<uint32_t>(std::min<size_t>(policies.size(), header->max_policies));
+
+    uint64_t sequence = header->policies_sequence.load(std::memory_order_relaxed);
+    header->policies_sequence.store(sequence + 1, std::memory_order_relaxed); // Odd: update in progress
+    std::atomic_thread_fence(std::memory_order_release);
+    PolicyBucketRecord* records = records_at<PolicyBucketRecord>(mapping_, header->policies_offset);
+    for (uint32_t i = 0; i < count; ++i) {
+        const policy::RuntimePolicy& policy = policies[i];
+        records[i].policy_id = policy.id;
+        records[i].cir_tokens = policy.cir_bucket.available_tokens(now_ns);
+        records[i].pir_tokens = policy.pir_bucket.available_tokens(now_ns);
+    }
+    header->num_policies = count;
+    header->policies_saved_ns = now_ns;
+    header->policies_sequence.store(sequence + 2, std::memory_order_release);
+    return count;
+}
+
+void FlowCheckpointWriter::sync() {
+#ifdef HQTS_HAVE_MMAP
+    if (msync(mapping_, mapping_bytes_, MS_SYNC) != 0) {
+        throw_errno("cannot sync " + (published_ ? path_ : temporary_path_));
+    }
+#endif
+}
+
+uint64_t FlowCheckpointWriter::completed_passes() const {
+    return static_cast<const FlowCheckpointHeader*>(mapping_)->completed_passes.load(std::memory_order_acquire);
+}
+
+namespace {
+
+// Whether the header's record arrays lie inside the first `bytes` bytes, in the order
+// the writer lays them out. Subtractions only: a corrupt header must not be able to
+// overflow its way past the checks.
+bool valid_layout(const FlowCheckpointHeader& header, size_t bytes) {
+    if (header.file_bytes > bytes || header.flows_offset < sizeof(FlowCheckpointHeader) ||
+        header.flows_offset % alignof(FlowCheckpointRecord) != 0 || header.policies_offset < header.flows_offset ||
+        header.policies_offset > header.file_bytes || header.policies_offset % alignof(PolicyBucketRecord) != 0) {
+        return false;
+    }
+    return header.slot_count <= (header.policies_offset - header.flows_offset) / sizeof(FlowCheckpointRecord) &&
+           header.max_policies <= (header.file_bytes - header.policies_offset) / sizeof(PolicyBucketRecord);
+}
+
+// Restores one bucket to `tokens` (capped at its capacity) from the full state it was
+// compiled in: drain() also sets the time base a fresh bucket lacks.
+void restore_level(TokenBucket& bucket, uint64_t tokens, TimestampNs now_ns) {
+    uint64_t level = std::min(tokens, bucket.capacity_bytes());
+    bucket.drain(bucket.capacity_bytes() - level, now_ns);
+}
+
+} // namespace
+
+FlowRestoreResult restore_flow_checkpoint(const std::string& path, FlowTable& table,
+                                          policy::CompiledPolicies* policies, TimestampNs now_ns) {
+    FlowRestoreResult result;
+#ifdef HQTS_HAVE_MMAP
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw_errno("cannot open " + path);
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        int error = errno;
+        close(fd);
+        errno = error;
+        throw_errno("cannot stat " + path);
+    }
+    size_t bytes = static_cast<size_t>(info.st_size);
+    if (bytes < sizeof(FlowCheckpointHeader)) {
+        close(fd);
+        throw std::runtime_error("FlowCheckpoint: " + path + " is too small to be a flow checkpoint.");
+    }
+    void* mapping = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    int error = errno;
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        errno = error;
+        throw_errno("cannot map " + path);
+    }
+
+    const FlowCheckpointHeader* header = static_cast<const FlowCheckpointHeader*>(mapping);
+    if (header->magic != FLOW_CHECKPOINT_MAGIC || header->format_version != FLOW_CHECKPOINT_FORMAT_VERSION ||
+        header->record_bytes != sizeof(FlowCheckpointRecord) || !valid_layout(*header, bytes)) {
+        munmap(mapping, bytes);
+        throw std::runtime_error("FlowCheckpoint: " + path + " is not a flow checkpoint of format version " +
+                                 std::to_string(FLOW_CHECKPOINT_FORMAT_VERSION) + ".");
+    }
+    std::atomic_thread_fence(std::memory_order_acquire); // Pairs with the writer's fence before magic
+
+    const FlowCheckpointRecord* records = records_at<FlowCheckpointRecord>(mapping, header->flows_offset);
+    for (uint64_t slot = 0; slot < header->slot_count; ++slot) {
+        const FlowCheckpointRecord& record = records[slot];
+        uint64_t sequence = record.sequence.load(std::memory_order_acquire);
+        if (!record.flow.live) {
+            continue;
+        }
+        FlowRecord flow = record.flow;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if ((sequence & 1) != 0 || record.sequence.load(std::memory_order_relaxed) != sequence) {
+            ++result.flows_rejected; // Torn by a crash mid-write
+            continue;
+        }
+        flow.last_seen_ns = std::min(flow.last_seen_ns, now_ns);
+        if (table.import_flow(flow).first == nullptr) {
+            ++result.flows_rejected;
+        } else {
+            ++result.flows_restored;
+        }
+    }
+
+    if (policies != nullptr) {
+        uint64_t sequence = header->policies_sequence.load(std::memory_order_acquire);
+        if ((sequence & 1) == 0) { // Otherwise the writer stopped mid-update: keep full buckets
+            uint32_t count = std::min(header->num_policies, header->max_policies);
+            const PolicyBucketRecord* saved = records_at<PolicyBucketRecord>(mapping, header->policies_offset);
+            for (uint32_t i = 0; i < count; ++i) {
+                policy::RuntimePolicy* policy = policies->find(saved[i].policy_id);
+                if (policy != nullptr) {
+                    restore_level(policy->cir_bucket, saved[i].cir_tokens, now_ns);
+                    restore_level(policy->pir_bucket, saved[i].pir_tokens, now_ns);
+                    ++result.policies_restored;
+                }
+            }
+        }
+    }
+    munmap(mapping, bytes);
+#else
+    (void)path;
+    (void)table;
+    (void)policies;
+    (void)now_ns;
+    throw std::runtime_error("FlowCheckpoint: memory-mapped files are not supported on this platform.");
+#endif
+    return result;
+}
+
+} // namespace core
+} // namespace hqts
@@ -1,16 +1,29 @@
 #include "hqts/dataplane/flow_classifier.h"
 // "hqts/core/flow_context.h" is included via "hqts/dataplane/flow_table.h" or directly by "flow_classifier.h"
 // "hqts/dataplane/flow_table.h" is included by "flow_classifier.h"
-#include <stdexcept> // For std::runtime_error (though not used in current version)
-#include <string>    // For std::to_string (not used in current version)
+#include "hqts/core/time_source.h" // For core::steady_now_ns
+
+#include <stdexcept> // For std::runtime_error
+#include <string>    // For std::to_string
 
 namespace hqts {
 namespace dataplane {
 
-FlowClassifier::FlowClassifier(core::FlowTable& ft, policy::PolicyId default_pid)
+namespace {
+
+// Default QueueId and DropPolicy for new flows. These might ideally come from
+// inspecting the default_policy_id_ in the PolicyTree, or be system-wide defaults.
+// For this implementation, we'll use simple placeholder defaults.
+constexpr core::QueueId DEFAULT_INITIAL_QUEUE_ID = 0;                                 // Placeholder - might be derived from policy
+constexpr core::DropPolicy DEFAULT_INITIAL_DROP_POLICY = core::DropPolicy::TAIL_DROP; // Placeholder
+
+} // namespace
+
+FlowClassifier::FlowClassifier(core::FlowTable& ft, policy::PolicyId default_pid,
+                               const RuleClassifier* rules)
     : flow_table_(ft),
       default_policy_id_(default_pid),
-      next_flow_id_(1) { // Start FlowIds from 1 (0 might be reserved)
+      rules_(rules) {
 
     // A check could be added here to ensure default_policy_id_ is valid,
     // but FlowClassifier doesn't have direct access to PolicyTree to verify.
@@ -21,44 +34,46 @@ FlowClassifier::FlowClassifier(core::FlowTable& ft, policy::PolicyId default_pid
     // }
 }
 
-core::FlowId FlowClassifier::get_or_create_flow(const FiveTuple& five_tuple) {
-    std::lock_guard<std::mutex> lock(mutex_); // Thread-safe access to shared members
+core::FlowContext* FlowClassifier::classify(const FiveTuple& five_tuple) {
+    return classify(five_tuple, core::steady_now_ns());
+}
 
-    // Check if FlowKey (FiveTuple) already exists in our map
-    auto it = flow_key_to_flow_id_map_.find(five_tuple);
-    if (it != flow_key_to_flow_id_map_.end()) {
-        // Found existing flow, return its FlowId
-        return it->second;
-    }
+core::FlowContext* FlowClassifier::classify(const FiveTuple& five_tuple, uint64_t now_ns) {
+    // One probe of the 5-tuple keyed table; a new flow gets its FlowId (never 0) from the table.
+    return flow_table_.find_or_insert(five_tuple, default_policy_id_,
+                                      DEFAULT_INITIAL_QUEUE_ID, DEFAULT_INITIAL_DROP_POLICY, now_ns,
+                                      rules_).first;
+}
 
-    // New flow detected
-    core::FlowId new_id = next_flow_id_++;
-    flow_key_to_flow_id_map_[five_tuple] = new_id; // Store mapping from FiveTuple to new FlowId
-
-    // Create a new FlowContext for this flow and add it to the global FlowTable.
-    // The FlowContext constructor needs: FlowId, PolicyId, QueueId, DropPolicy.
-    // For a new flow, we use the default_policy_id_.
-    // Default QueueId and DropPolicy need to be defined. These might ideally come from
-    // inspecting the default_policy_id_ in the PolicyTree, or be system-wide defaults.
-    // For this implementation, we'll use simple placeholder defaults.
-    core::QueueId default_initial_queue_id = 0; // Placeholder - might be derived from policy
-    core::DropPolicy default_initial_drop_policy = core::DropPolicy::TAIL_DROP; // Placeholder
-
-    core::FlowContext new_flow_context(new_id, default_policy_id_,
-                                       default_initial_queue_id, default_initial_drop_policy);
-
-    // Optionally, store the FlowKey (FiveTuple) in FlowContext if FlowContext is extended to hold it.
-    // Example: new_flow_context.flow_key = five_tuple;
-
-    auto emplace_result = flow_table_.emplace(new_id, new_flow_context);
-    if (!emplace_result.second) {
-        // This would be highly unusual if next_flow_id_ is strictly monotonic and unique.
-        // It implies a FlowId collision in the global flow_table_, which should not happen.
-        // Handle error: throw, log, or overwrite. For now, let's assume this won't fail.
-        // (Could happen if FlowTable keys are not managed solely by this classifier's next_flow_id_)
+void FlowClassifier::classify_burst(const FiveTuple* five_tuples, size_t count,
+                                    core::FlowContext** contexts_out) {
+    classify_burst(five_tuples, count, core::steady_now_ns(), contexts_out);
+}
+
+void FlowClassifier::classify_burst(const FiveTuple* five_tuples, size_t count, uint64_t now_ns,
+                                    core::FlowContext** contexts_out) {
+    flow_table_.find_or_insert_burst(five_tuples, count, default_policy_id_, DEFAULT_INITIAL_QUEUE_ID,
+                                     DEFAULT_INITIAL_DROP_POLICY, now_ns, contexts_out, rules_);
+}
+
+size_t FlowClassifier::age_flows() {
+    return flow_table_.age(core::steady_now_ns());
+}
+
+core::FlowId FlowClassifier::get_or_create_flow(const FiveTuple& five_tuple) {
+    core::FlowContext* context = classify(five_tuple);
+    if (context == nullptr) {
+        throw std::runtime_error("FlowClassifier: FlowTable is full (max_flows " +
+                                 std::to_string(flow_table_.max_flows()) + "), cannot create flow.");
     }
+    return context->flow_id;
+}
 
-    return new_id;
+void FlowClassifier::get_or_create_flows(const FiveTuple* five_tuples, size_t count,
+                                         core::FlowId* flow_ids_out) {
+    for (size_t i = 0; i < count; ++i) {
+        flow_ids_out[i] = get_or_create_flow(five_tuples[i]);
+    }
 }
 
 // Placeholder for PacketDescriptor overload - commented out in header
@@ -0,0 +1,590 @@
+#include "hqts/dataplane/flow_table.h"
+#include "hqts/core/prefetch.h"             // For prefetch_for_read
+#include "hqts/dataplane/rule_classifier.h" // For RuleClassifier::classify
+
+#include <algorithm>  // For std::min, std::max, std::find
+#include <mutex>      // For std::unique_lock
+#include <stdexcept>  // For std::invalid_argument, std::out_of_range
+#include <string>     // For std::to_string
+
+namespace hqts {
+namespace core {
+
+namespace {
+
+constexpr size_t NOT_FOUND = SIZE_MAX;
+
+constexpr uint64_t SLOT_BITS = 32;
+constexpr uint64_t SLOT_MASK = (uint64_t{1} << SLOT_BITS) - 1;
+
+// Shards are filled to at most 7/8 of their slots so probe sequences stay short and
+// always reach a free slot.
+constexpr size_t MAX_LOAD_NUMERATOR = 7;
+constexpr size_t MAX_LOAD_DENOMINATOR = 8;
+
+// Smallest shard: keeps tiny tables from degenerating into a handful of slots.
+constexpr size_t MIN_SLOTS_PER_SHARD = 16;
+
+// A shard purges its tombstones after gathering slots / TOMBSTONE_PURGE_DIVISOR new ones,
+// so each purge (one pass over the shard) is paid for by that many erases.
+constexpr size_t TOMBSTONE_PURGE_DIVISOR = 8;
+
+size_t next_power_of_two(size_t n) {
+    size_t p = 1;
+    while (p < n) {
+        p <<= 1;
+    }
+    return p;
+}
+
+// FlowId layout: upper 32 bits are the slot's generation, lower 32 bits the slot index + 1.
+// The +1 keeps 0 free as "no flow".
+FlowId make_flow_id(uint32_t generation, size_t slot_index) {
+    return (static_cast<uint64_t>(generation) << SLOT_BITS) | (static_cast<uint64_t>(slot_index) + 1);
+}
+
+uint32_t generation_of(FlowId flow_id) {
+    return static_cast<uint32_t>(flow_id >> SLOT_BITS);
+}
+
+} // namespace
+
+FlowTable::FlowTable(size_t max_flows, FlowAgingConfig aging)
+    : max_flows_(max_flows), aging_(aging) {
+    if (max_flows == 0) {
+        throw std::invalid_argument("FlowTable: max_flows must be greater than 0.");
+    }
+    if (aging.slots_per_sweep == 0) {
+        throw std::invalid_argument("FlowTable: aging.slots_per_sweep must be greater than 0.");
+    }
+    // Give each shard 25% headroom over an even split, since keys never spread perfectly,
+    // then apply the load factor.
+    size_t per_shard_flows = (max_flows + NUM_SHARDS - 1) / NUM_SHARDS;
+    per_shard_flows += (per_shard_flows + 3) / 4;
+    size_t per_shard_slots = (per_shard_flows * MAX_LOAD_DENOMINATOR + MAX_LOAD_NUMERATOR - 1) / MAX_LOAD_NUMERATOR;
+    slots_per_shard_ = next_power_of_two(per_shard_slots < MIN_SLOTS_PER_SHARD ? MIN_SLOTS_PER_SHARD : per_shard_slots);
+    shard_slot_mask_ = slots_per_shard_ - 1;
+
+    size_t total_slots = slots_per_shard_ * NUM_SHARDS;
+    if (total_slots >= SLOT_MASK) {
+        throw std::invalid_argument("FlowTable: max_flows " + std::to_string(max_flows) +
+                                    " is too large to index.");
+    }
+    slot_count_ = total_slots;
+    slots_.reset(new Slot[total_slots]);
+    ctrl_.assign(total_slots, CTRL_EMPTY);
+    cold_.resize(total_slots);
+    for (size_t i = 0; i < total_slots; ++i) {
+        slots_[i].context.flow_id = 0; // Generation 0: the first flow in each slot gets generation 1
+    }
+    for (Shard& shard : shards_) {
+        shard.purge_at = slots_per_shard_ / TOMBSTONE_PURGE_DIVISOR;
+    }
+}
+
+FlowTable::HashParts FlowTable::hash_key(const dataplane::FiveTuple& key) const {
+    // Shard and tag come from the top bits, the home slot from the bottom bits.
+    uint64_t h = dataplane::hash_five_tuple(key);
+    HashParts parts;
+    parts.shard = static_cast<size_t>(h >> 60) & (NUM_SHARDS - 1);
+    parts.tag = static_cast<uint8_t>((h >> 53) & 0x7F);
+    parts.home = static_cast<size_t>(h) & shard_slot_mask_;
+    return parts;
+}
+
+size_t FlowTable::find_slot_locked(const HashParts& parts, const dataplane::FiveTuple& key) const {
+    const size_t base = parts.shard * slots_per_shard_;
+    size_t local = parts.home;
+    for (size_t probes = 0; probes < slots_per_shard_; ++probes) {
+        uint8_t c = ctrl_[base + local];
+        if (c == CTRL_EMPTY) {
+            return NOT_FOUND;
+        }
+        if (c == parts.tag && slots_[base + local].key == key) {
+            return base + local;
+        }
+        local = (local + 1) & shard_slot_mask_;
+    }
+    return NOT_FOUND;
+}
+
+void FlowTable::prefetch_home(const HashParts& parts) const {
+    size_t slot_index = parts.shard * slots_per_shard_ + parts.home;
+    prefetch_for_read(&ctrl_[slot_index]);
+    prefetch_for_read(&slots_[slot_index]);
+}
+
+FlowContext* FlowTable::find(const dataplane::FiveTuple& key) {
+    HashParts parts = hash_key(key);
+    std::shared_lock<std::shared_mutex> lock(shards_[parts.shard].mutex);
+    size_t slot_index = find_slot_locked(parts, key);
+    return slot_index == NOT_FOUND ? nullptr : &slots_[slot_index].context;
+}
+
+const FlowContext* FlowTable::find(const dataplane::FiveTuple& key) const {
+    HashParts parts = hash_key(key);
+    std::shared_lock<std::shared_mutex> lock(shards_[parts.shard].mutex);
+    size_t slot_index = find_slot_locked(parts, key);
+    return slot_index == NOT_FOUND ? nullptr : &slots_[slot_index].context;
+}
+
+size_t FlowTable::find_or_reserve_slot_locked(const HashParts& parts, const dataplane::FiveTuple& key,
+                                              bool& found) const {
+    const size_t base = parts.shard * slots_per_shard_;
+    size_t insert_at = NOT_FOUND;
+    size_t local = parts.home;
+    found = false;
+    for (size_t probes = 0; probes < slots_per_shard_; ++probes) {
+        uint8_t c = ctrl_[base + local];
+        if (c == CTRL_EMPTY) {
+            return insert_at == NOT_FOUND ? base + local : insert_at;
+        }
+        if (c == CTRL_DELETED) {
+            if (insert_at == NOT_FOUND) {
+                insert_at = base + local; // Reuse the first tombstone, but keep looking for the key
+            }
+        } else if (c == parts.tag && slots_[base + local].key == key) {
+            found = true;
+            return base + local;
+        }
+        local = (local + 1) & shard_slot_mask_;
+    }
+    return insert_at;
+}
+
+void FlowTable::lookup_burst(const dataplane::FiveTuple* keys, size_t count, FlowContext** contexts_out) {
+    HashParts parts[LOOKUP_BATCH];
+    for (size_t begin = 0; begin < count; begin += LOOKUP_BATCH) {
+        size_t n = count - begin < LOOKUP_BATCH ? count - begin : LOOKUP_BATCH;
+        for (size_t i = 0; i < n; ++i) {
+            parts[i] = hash_key(keys[begin + i]);
+        }
+        for (size_t i = 0; i < n; ++i) {
+            prefetch_home(parts[i]);
+        }
+        for (size_t i = 0; i < n; ++i) {
+            std::shared_lock<std::shared_mutex> lock(shards_[parts[i].shard].mutex);
+            size_t slot_index = find_slot_locked(parts[i], keys[begin + i]);
+            contexts_out[begin + i] = slot_index == NOT_FOUND ? nullptr : &slots_[slot_index].context;
+        }
+    }
+}
+
+void FlowTable::find_or_insert_burst(const dataplane::FiveTuple* keys, size_t count,
+                                     policy::PolicyId policy_id, QueueId queue_id, DropPolicy drop_policy,
+                                     uint64_t now_ns, FlowContext** contexts_out,
+                                     const dataplane::RuleClassifier* rules) {
+    HashParts parts[LOOKUP_BATCH];
+    for (size_t begin = 0; begin < count; begin += LOOKUP_BATCH) {
+        size_t n = count - begin < LOOKUP_BATCH ? count - begin : LOOKUP_BATCH;
+        for (size_t i = 0; i < n; ++i) {
+            parts[i] = hash_key(keys[begin + i]);
+        }
+        for (size_t i = 0; i < n; ++i) {
+            prefetch_home(parts[i]);
+        }
+        for (size_t i = 0; i < n; ++i) {
+            // Contexts already returned are pinned: an eviction must not recycle them.
+            contexts_out[begin + i] = find_or_insert_hashed(parts[i], keys[begin + i], policy_id, queue_id,
+                                                            drop_policy, now_ns, rules, contexts_out,
+                                                            begin + i).first;
+        }
+    }
+}
+
+std::pair<FlowContext*, bool> FlowTable::find_or_insert(const dataplane::FiveTuple& key,
+                                                        policy::PolicyId policy_id,
+                                                        QueueId queue_id,
+                                                        DropPolicy drop_policy,
+                                                        uint64_t now_ns,
+                                                        const dataplane::RuleClassifier* rules) {
+    return find_or_insert_hashed(hash_key(key), key, policy_id, queue_id, drop_policy, now_ns, rules);
+}
+
+std::pair<FlowContext*, bool> FlowTable::find_or_insert_hashed(const HashParts& parts,
+                                                               const dataplane::FiveTuple& key,
+                                                               policy::PolicyId policy_id,
+                                                               QueueId queue_id,
+                                                               DropPolicy drop_policy,
+                                                               uint64_t now_ns,
+                                                               const dataplane::RuleClassifier* rules,
+                                                               FlowContext* const* pinned,
+                                                               size_t pinned_count) {
+    Shard& shard = shards_[parts.shard];
+    {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex); // Fast path: known flow
+        size_t slot_index = find_slot_locked(parts, key);
+        if (slot_index != NOT_FOUND) {
+            Slot& slot = slots_[slot_index];
+            // Skip the store when nothing changed, so that bursts of one flow on several
+            // cores don't keep stealing the line from each other.
+            if (slot.last_seen_ns.load(std::memory_order_relaxed) != now_ns) {
+                slot.last_seen_ns.store(now_ns, std::memory_order_relaxed);
+            }
+            return {&slot.context, false};
+        }
+    }
+
+    if (rules != nullptr) {
+        policy_id = rules->classify(key, policy_id); // New flow: classify before taking the lock exclusively
+    }
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    // Probe again: another thread may have inserted the key between the two locks.
+    bool found = false;
+    size_t insert_at = find_or_reserve_slot_locked(parts, key, found);
+    if (found) {
+        slots_[insert_at].last_seen_ns.store(now_ns, std::memory_order_relaxed);
+        return {&slots_[insert_at].context, false};
+    }
+
+    const bool may_evict = aging_.full_policy == FlowTableFullPolicy::EVICT_LRU;
+    if (insert_at == NOT_FOUND) {
+        // Shard completely full
+        if (!may_evict || !evict_lru_locked(parts.shard, pinned, pinned_count)) {
+            return {nullptr, false};
+        }
+        insert_at = find_or_reserve_slot_locked(parts, key, found);
+    }
+    while (size_.fetch_add(1, std::memory_order_relaxed) >= max_flows_) {
+        size_.fetch_sub(1, std::memory_order_relaxed);
+        // At the cap: make room in this shard (the only one whose lock we hold).
+        if (!may_evict || !evict_lru_locked(parts.shard, pinned, pinned_count)) {
+            return {nullptr, false};
+        }
+        insert_at = find_or_reserve_slot_locked(parts, key, found);
+    }
+
+    Slot& slot = slots_[insert_at];
+    uint32_t generation = generation_of(slot.context.flow_id) + 1;
+    slot.key = key;
+    slot.context = FlowContext(make_flow_id(generation, insert_at), policy_id, queue_id, drop_policy);
+    slot.last_seen_ns.store(now_ns, std::memory_order_relaxed);
+    cold_[insert_at] = FlowStatistics();
+    if (ctrl_[insert_at] == CTRL_DELETED) {
+        --shard.tombstones;
+    }
+    ctrl_[insert_at] = parts.tag;
+    return {&slot.context, true};
+}
+
+bool FlowTable::evict_lru_locked(size_t shard, FlowContext* const* pinned, size_t pinned_count) {
+    // Sampled LRU: look at the next few live flows after the shard's eviction cursor
+    // and evict the one seen least recently. Bounded work, approximates true LRU.
+    // Pinned flows are not candidates: the caller already handed out their contexts.
+    Shard& s = shards_[shard];
+    const size_t base = shard * slots_per_shard_;
+    const size_t max_probes = std::min(slots_per_shard_, LRU_MAX_PROBES);
+    size_t victim = NOT_FOUND;
+    uint64_t victim_last_seen = 0;
+    size_t sampled = 0;
+    size_t local = s.eviction_cursor;
+    for (size_t probes = 0; probes < max_probes && sampled < LRU_SAMPLE_SIZE; ++probes) {
+        size_t slot_index = base + local;
+        local = (local + 1) & shard_slot_mask_;
+        if (ctrl_[slot_index] >= CTRL_EMPTY ||
+            std::find(pinned, pinned + pinned_count, &slots_[slot_index].context) != pinned + pinned_count) {
+            continue;
+        }
+        uint64_t last_seen = slots_[slot_index].last_seen_ns.load(std::memory_order_relaxed);
+        if (victim == NOT_FOUND || last_seen < victim_last_seen) {
+            victim = slot_index;
+            victim_last_seen = last_seen;
+        }
+        ++sampled;
+    }
+    s.eviction_cursor = local;
+    if (victim == NOT_FOUND) {
+        return false;
+    }
+    erase_slot_locked(victim);
+    evicted_flows_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void FlowTable::erase_slot_locked(size_t slot_index) {
+    const size_t shard = slot_index / slots_per_shard_;
+    const size_t base = shard * slots_per_shard_;
+    size_t local = slot_index - base;
+    Shard& s = shards_[shard];
+
+    // A slot may go back to EMPTY only when its successor is EMPTY: then no probe
+    // sequence can run through it to a later key. Otherwise leave a tombstone.
+    size_t next = (local + 1) & shard_slot_mask_;
+    if (ctrl_[base + next] != CTRL_EMPTY) {
+        ctrl_[slot_index] = CTRL_DELETED;
+        ++s.tombstones;
+    } else {
+        ctrl_[slot_index] = CTRL_EMPTY;
+        // The same argument now holds for tombstones directly in front of this slot.
+        size_t prev = (local + slots_per_shard_ - 1) & shard_slot_mask_;
+        while (prev != local && ctrl_[base + prev] == CTRL_DELETED) {
+            ctrl_[base + prev] = CTRL_EMPTY;
+            --s.tombstones;
+            prev = (prev + slots_per_shard_ - 1) & shard_slot_mask_;
+        }
+    }
+    size_.fetch_sub(1, std::memory_order_relaxed);
+    if (s.tombstones >= s.purge_at) {
+        purge_tombstones_locked(shard);
+    }
+}
+
+void FlowTable::purge_tombstones_locked(size_t shard) {
+    // A tombstone is needed only between a live key's home slot and the slot it sits
+    // in. Walking the shard backwards, `cover` counts how many more slots some live key
+    // behind the current one still probes through. Coverage may wrap around the shard
+    // end, so the first pass only computes what enters the second, which clears.
+    Shard& s = shards_[shard];
+    const size_t base = shard * slots_per_shard_;
+    size_t cover = 0;
+    for (int pass = 0; pass < 2; ++pass) {
+        for (size_t local = slots_per_shard_; local-- > 0;) {
+            const size_t slot_index = base + local;
+            const bool covered = cover > 0;
+            if (covered) {
+                --cover;
+            }
+            const uint8_t c = ctrl_[slot_index];
+            if (c < CTRL_EMPTY) {
+                size_t displacement = (local - hash_key(slots_[slot_index].key).home) & shard_slot_mask_;
+                cover = std::max(cover, displacement);
+            } else if (pass == 1 && c == CTRL_DELETED && !covered) {
+                ctrl_[slot_index] = CTRL_EMPTY;
+                --s.tombstones;
+            }
+        }
+    }
+    s.purge_at = s.tombstones + std::max<size_t>(slots_per_shard_ / TOMBSTONE_PURGE_DIVISOR, 1);
+}
+
+bool FlowTable::erase(const dataplane::FiveTuple& key) {
+    HashParts parts = hash_key(key);
+    std::unique_lock<std::shared_mutex> lock(shards_[parts.shard].mutex);
+    size_t slot_index = find_slot_locked(parts, key);
+    if (slot_index == NOT_FOUND) {
+        return false;
+    }
+    erase_slot_locked(slot_index);
+    return true;
+}
+
+size_t FlowTable::shard_for_id(FlowId flow_id) const {
+    uint64_t slot_plus_one = flow_id & SLOT_MASK;
+    if (slot_plus_one == 0 || slot_plus_one > slot_count_) {
+        return NOT_FOUND;
+    }
+    return static_cast<size_t>(slot_plus_one - 1) / slots_per_shard_;
+}
+
+size_t FlowTable::live_slot_for_id_locked(FlowId flow_id) const {
+    size_t slot_index = static_cast<size_t>((flow_id & SLOT_MASK) - 1);
+    if (ctrl_[slot_index] >= CTRL_EMPTY || slots_[slot_index].context.flow_id != flow_id) {
+        return NOT_FOUND; // Slot free, or reused by a later flow
+    }
+    return slot_index;
+}
+
+FlowContext* FlowTable::find_by_id(FlowId flow_id) {
+    size_t shard = shard_for_id(flow_id);
+    if (shard == NOT_FOUND) {
+        return nullptr;
+    }
+    std::shared_lock<std::shared_mutex> lock(shards_[shard].mutex);
+    size_t slot_index = live_slot_for_id_locked(flow_id);
+    return slot_index == NOT_FOUND ? nullptr : &slots_[slot_index].context;
+}
+
+const FlowContext* FlowTable::find_by_id(FlowId flow_id) const {
+    size_t shard = shard_for_id(flow_id);
+    if (shard == NOT_FOUND) {
+        return nullptr;
+    }
+    std::shared_lock<std::shared_mutex> lock(shards_[shard].mutex);
+    size_t slot_index = live_slot_for_id_locked(flow_id);
+    return slot_index == NOT_FOUND ? nullptr : &slots_[slot_index].context;
+}
+
+FlowStatistics* FlowTable::statistics_by_id(FlowId flow_id) {
+    size_t shard = shard_for_id(flow_id);
+    if (shard == NOT_FOUND) {
+        return nullptr;
+    }
+    std::shared_lock<std::shared_mutex> lock(shards_[shard].mutex);
+    size_t slot_index = live_slot_for_id_locked(flow_id);
+    return slot_index == NOT_FOUND ? nullptr : &cold_[slot_index];
+}
+
+const FlowStatistics* FlowTable::statistics_by_id(FlowId flow_id) const {
+    size_t shard = shard_for_id(flow_id);
+    if (shard == NOT_FOUND) {
+        return nullptr;
+    }
+    std::shared_lock<std::shared_mutex> lock(shards_[shard].mutex);
+    size_t slot_index = live_slot_for_id_locked(flow_id);
+    return slot_index == NOT_FOUND ? nullptr : &cold_[slot_index];
+}
+
+const dataplane::FiveTuple* FlowTable::key_by_id(FlowId flow_id) const {
+    size_t shard = shard_for_id(flow_id);
+    if (shard == NOT_FOUND) {
+        return nullptr;
+    }
+    std::shared_lock<std::shared_mutex> lock(shards_[shard].mutex);
+    size_t slot_index = live_slot_for_id_locked(flow_id);
+    return slot_index == NOT_FOUND ? nullptr : &slots_[slot_index].key;
+}
+
+bool FlowTable::erase_by_id(FlowId flow_id) {
+    size_t shard = shard_for_id(flow_id);
+    if (shard == NOT_FOUND) {
+        return false;
+    }
+    std::unique_lock<std::shared_mutex> lock(shards_[shard].mutex);
+    size_t slot_index = live_slot_for_id_locked(flow_id);
+    if (slot_index == NOT_FOUND) {
+        return false;
+    }
+    erase_slot_locked(slot_index);
+    return true;
+}
+
+uint64_t FlowTable::last_seen_ns_by_id(FlowId flow_id) const {
+    size_t shard = shard_for_id(flow_id);
+    if (shard == NOT_FOUND) {
+        return 0;
+    }
+    std::shared_lock<std::shared_mutex> lock(shards_[shard].mutex);
+    size_t slot_index = live_slot_for_id_locked(flow_id);
+    return slot_index == NOT_FOUND ? 0 : slots_[slot_index].last_seen_ns.load(std::memory_order_relaxed);
+}
+
+size_t FlowTable::sweeps_per_pass() const {
+    return (slot_count_ + aging_.slots_per_sweep - 1) / aging_.slots_per_sweep;
+}
+
+size_t FlowTable::age_range(size_t shard, size_t begin, size_t end, uint64_t now_ns) {
+    size_t expired = 0;
+    std::unique_lock<std::shared_mutex> lock(shards_[shard].mutex);
+    for (size_t i = begin; i < end; ++i) {
+        if (ctrl_[i] >= CTRL_EMPTY) {
+            continue;
+        }
+        uint64_t last_seen = slots_[i].last_seen_ns.load(std::memory_order_relaxed);
+        if (now_ns >= last_seen && now_ns - last_seen >= aging_.idle_timeout_ns) {
+            erase_slot_locked(i);
+            ++expired;
+        }
+    }
+    return expired;
+}
+
+size_t FlowTable::age(uint64_t now_ns) {
+    if (aging_.idle_timeout_ns == 0) {
+        return 0;
+    }
+    // Claim the next range of slots; concurrent sweepers get disjoint ranges.
+    size_t remaining = aging_.slots_per_sweep < slot_count_ ? aging_.slots_per_sweep : slot_count_;
+    size_t cursor = age_cursor_.fetch_add(remaining, std::memory_order_relaxed) % slot_count_;
+
+    size_t expired = 0;
+    while (remaining > 0) {
+        // Split at shard ends so each piece is swept under a single shard lock.
+        size_t shard = cursor / slots_per_shard_;
+        size_t shard_end = (shard + 1) * slots_per_shard_;
+        size_t end = cursor + remaining < shard_end ? cursor + remaining : shard_end;
+        expired += age_range(shard, cursor, end, now_ns);
+        remaining -= end - cursor;
+        cursor = end == slot_count_ ? 0 : end;
+    }
+    expired_flows_.fetch_add(expired, std::memory_order_relaxed);
+    return expired;
+}
+
+void FlowTable::clear() {
+    for (size_t shard = 0; shard < NUM_SHARDS; ++shard) {
+        std::unique_lock<std::shared_mutex> lock(shards_[shard].mutex);
+        const size_t base = shard * slots_per_shard_;
+        for (size_t i = base; i < base + slots_per_shard_; ++i) {
+            if (ctrl_[i] < CTRL_EMPTY) {
+                size_.fetch_sub(1, std::memory_order_relaxed);
+            }
+            // Slot contents (and so their generations) are kept: ids issued before
+            // clear() can never match the next flow placed in the slot.
+            ctrl_[i] = CTRL_EMPTY;
+        }
+        shards_[shard].tombstones = 0;
+        shards_[shard].purge_at = slots_per_shard_ / TOMBSTONE_PURGE_DIVISOR;
+    }
+}
+
+size_t FlowTable::tombstone_count() const {
+    size_t tombstones = 0;
+    for (const Shard& shard : shards_) {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        tombstones += shard.tombstones;
+    }
+    return tombstones;
+}
+
+size_t FlowTable::probe_length(const dataplane::FiveTuple& key) const {
+    HashParts parts = hash_key(key);
+    std::shared_lock<std::shared_mutex> lock(shards_[parts.shard].mutex);
+    const size_t base = parts.shard * slots_per_shard_;
+    size_t local = parts.home;
+    size_t probes = 0;
+    while (probes < slots_per_shard_) {
+        uint8_t c = ctrl_[base + local];
+        ++probes;
+        if (c == CTRL_EMPTY || (c == parts.tag && slots_[base + local].key == key)) {
+            break;
+        }
+        local = (local + 1) & shard_slot_mask_;
+    }
+    return probes;
+}
+
+size_t FlowTable::export_slots(size_t first_slot, size_t count, FlowRecord* out) const {
+    if (first_slot > slot_count_ || count > slot_count_ - first_slot) {
+        throw std::out_of_range("FlowTable: slots " + std::to_string(first_slot) + "+" +
+                                std::to_string(count) + " exceed the " + std::to_string(slot_count_) +
+                                " slots of the table.");
+    }
+    size_t live = 0;
+    size_t slot_index = first_slot;
+    const size_t end = first_slot + count;
+    while (slot_index < end) {
+        // One shard at a time, under its lock.
+        size_t shard = slot_index / slots_per_shard_;
+        size_t shard_end = std::min((shard + 1) * slots_per_shard_, end);
+        std::shared_lock<std::shared_mutex> lock(shards_[shard].mutex);
+        for (; slot_index < shard_end; ++slot_index) {
+            FlowRecord& record = out[slot_index - first_slot];
+            if (ctrl_[slot_index] >= CTRL_EMPTY) {
+                record = FlowRecord();
+                continue;
+            }
+            const Slot& slot = slots_[slot_index];
+            record.key = slot.key;
+            record.policy_id = slot.context.policy_id;
+            record.queue_id = slot.context.queue_id;
+            record.drop_policy = slot.context.drop_policy;
+            record.sla_status = slot.context.sla_status;
+            record.live = true;
+            record.last_seen_ns = slot.last_seen_ns.load(std::memory_order_relaxed);
+            ++live;
+        }
+    }
+    return live;
+}
+
+std::pair<FlowContext*, bool> FlowTable::import_flow(const FlowRecord& record) {
+    auto result = find_or_insert(record.key, record.policy_id, record.queue_id, record.drop_policy,
+                                 record.last_seen_ns);
+    if (result.second) {
+        result.first->sla_status = record.sla_status;
+    }
+    return result;
+}
+
+} // namespace core
+} // namespace hqts
@@ -0,0 +1,169 @@
+#include "hqts/dataplane/rule_classifier.h"
+#include "hqts/dataplane/flow_hash.h" // For hash_key_words
+
+#include <algorithm> // For std::stable_sort
+#include <map>
+#include <stdexcept> // For std::invalid_argument, std::length_error
+#include <string>    // For std::to_string in error messages
+#include <utility>   // For std::move, std::pair
+
+namespace hqts {
+namespace dataplane {
+
+namespace {
+
+// Set in every Bucket::key_low of an occupied bucket, so an all-zero masked key (a
+// rule matching any address, port and protocol) is told apart from an empty bucket.
+constexpr uint64_t OCCUPIED = uint64_t{1} << 63;
+
+uint32_t prefix_mask(uint8_t length) {
+    return length == 0 ? 0u : ~0u << (32 - length);
+}
+
+bool exact_dest_port(const ClassificationRule& rule) {
+    return rule.dest_port_min == rule.dest_port_max;
+}
+
+uint64_t make_key_high(uint32_t source_ip, uint32_t dest_ip) {
+    return (static_cast<uint64_t>(source_ip) << 32) | dest_ip;
+}
+
+uint64_t make_key_low(uint8_t protocol, uint16_t dest_port) {
+    return OCCUPIED | (static_cast<uint64_t>(protocol) << 16) | dest_port;
+}
+
+bool port_ranges_match(const ClassificationRule& rule, const FiveTuple& key) {
+    return key.source_port >= rule.source_port_min && key.source_port <= rule.source_port_max &&
+           key.dest_port >= rule.dest_port_min && key.dest_port <= rule.dest_port_max;
+}
+
+size_t next_power_of_two(size_t n) {
+    size_t p = 1;
+    while (p < n) {
+        p <<= 1;
+    }
+    return p;
+}
+
+} // namespace
+
+RuleClassifier::RuleClassifier(std::vector<ClassificationRule> rules) : rules_(std::move(rules)) {
+    if (rules_.size() >= UINT32_MAX) {
+        throw std::length_error("RuleClassifier: too many rules.");
+    }
+    // Group the rules by mask shape. Rules are visited in priority order, so tuples are
+    // created in order of their best rule and each group lists its rules ascending.
+    std::map<uint32_t, size_t> tuple_of_shape;
+    std::vector<std::vector<uint32_t>> tuple_rules;
+    for (size_t i = 0; i < rules_.size(); ++i) {
+        const ClassificationRule& rule = rules_[i];
+        if (rule.source_prefix_length > 32 || rule.dest_prefix_length > 32) {
+            throw std::invalid_argument("RuleClassifier: rule " + std::to_string(i) +
+                                        " has a prefix longer than 32 bits.");
+        }
+        if (rule.source_port_min > rule.source_port_max || rule.dest_port_min > rule.dest_port_max) {
+            throw std::invalid_argument("RuleClassifier: rule " + std::to_string(i) + " has an empty port range.");
+        }
+        uint32_t shape = uint32_t{rule.source_prefix_length} | (uint32_t{rule.dest_prefix_length} << 8) |
+                         (rule.any_protocol ? 0u : 1u << 16) | (exact_dest_port(rule) ? 1u << 17 : 0u);
+        auto inserted = tuple_of_shape.emplace(shape, tuples_.size());
+        if (inserted.second) {
+            Tuple tuple;
+            tuple.source_mask = prefix_mask(rule.source_prefix_length);
+            tuple.dest_mask = prefix_mask(rule.dest_prefix_length);
+            tuple.exact_protocol = !rule.any_protocol;
+            tuple.exact_dest_port = exact_dest_port(rule);
+            tuple.best_rule = static_cast<uint32_t>(i);
+            tuples_.push_back(tuple);
+            tuple_rules.emplace_back();
+        }
+        tuple_rules[inserted.first->second].push_back(static_cast<uint32_t>(i));
+    }
+
+    // Build each tuple's hash table: one bucket per distinct masked key, holding the
+    // indices of the rules with that key. At most half the buckets are used.
+    for (size_t t = 0; t < tuples_.size(); ++t) {
+        Tuple& tuple = tuples_[t];
+        std::vector<std::pair<std::pair<uint64_t, uint64_t>, uint32_t>> keyed;
+        keyed.reserve(tuple_rules[t].size());
+        for (uint32_t r : tuple_rules[t]) {
+            const ClassificationRule& rule = rules_[r];
+            keyed.push_back({{make_key_high(rule.source_ip & tuple.source_mask, rule.dest_ip & tuple.dest_mask),
+                              make_key_low(tuple.exact_protocol ? rule.protocol : 0,
+                                           tuple.exact_dest_port ? rule.dest_port_min : 0)},
+                             r});
+        }
+        std::stable_sort(keyed.begin(), keyed.end(),
+                         [](const auto& a, const auto& b) { return a.first < b.first; });
+        size_t distinct = 0;
+        for (size_t i = 0; i < keyed.size(); ++i) {
+            if (i == 0 || keyed[i].first != keyed[i - 1].first) {
+                ++distinct;
+            }
+        }
+
+        size_t bucket_count = next_power_of_two(distinct * 2);
+        tuple.first_bucket = buckets_.size();
+        tuple.bucket_mask = bucket_count - 1;
+        buckets_.resize(buckets_.size() + bucket_count);
+        for (size_t i = 0; i < keyed.size();) {
+            Bucket bucket;
+            bucket.key_high = keyed[i].first.first;
+            bucket.key_low = keyed[i].first.second;
+            bucket.first_rule = static_cast<uint32_t>(bucket_rules_.size());
+            for (; i < keyed.size() && keyed[i].first.first == bucket.key_high &&
+                   keyed[i].first.second == bucket.key_low;
+                 ++i) {
+                bucket_rules_.push_back(keyed[i].second);
+                ++bucket.rule_count;
+            }
+            size_t index = hash_key_words(bucket.key_high, bucket.key_low) & tuple.bucket_mask;
+            while (buckets_[tuple.first_bucket + index].key_low != 0) {
+                index = (index + 1) & tuple.bucket_mask;
+            }
+            buckets_[tuple.first_bucket + index] = bucket;
+        }
+    }
+}
+
+size_t RuleClassifier::match(const FiveTuple& key) const {
+    size_t best = rules_.size();
+    for (const Tuple& tuple : tuples_) {
+        if (tuple.best_rule >= best) {
+            break; // Neither this tuple nor any later one holds an earlier rule
+        }
+        uint64_t key_high = make_key_high(key.source_ip & tuple.source_mask, key.dest_ip & tuple.dest_mask);
+        uint64_t key_low = make_key_low(tuple.exact_protocol ? key.protocol : 0,
+                                        tuple.exact_dest_port ? key.dest_port : 0);
+        size_t index = hash_key_words(key_high, key_low) & tuple.bucket_mask;
+        for (;;) {
+            const Bucket& bucket = buckets_[tuple.first_bucket + index];
+            if (bucket.key_low == 0) {
+                break; // Empty: no rule of this tuple has the key
+            }
+            if (bucket.key_high == key_high && bucket.key_low == key_low) {
+                for (uint32_t i = 0; i < bucket.rule_count; ++i) {
+                    uint32_t r = bucket_rules_[bucket.first_rule + i];
+                    if (r >= best) {
+                        break;
+                    }
+                    if (port_ranges_match(rules_[r], key)) {
+                        best = r;
+                        break;
+                    }
+                }
+                break;
+            }
+            index = (index + 1) & tuple.bucket_mask;
+        }
+    }
+    return best;
+}
+
+policy::PolicyId RuleClassifier::classify(const FiveTuple& key, policy::PolicyId default_policy_id) const {
+    size_t r = match(key);
+    return r == rules_.size() ? default_policy_id : rules_[r].policy_id;
+}
+
+} // namespace dataplane
+} // namespace hqts
@@ -1,21 +1,80 @@
-// Placeholder for main.cpp
-// This will be the main entry point for the HQTS application.
+// Main entry point for the HQTS application.
+//
+// Runs the sharded data path (core::ShardedRuntime) over synthetic traffic:
+//   hqts_app [num_workers] [num_packets]
+// Workers are pinned to CPUs 1..num_workers when the machine has that many; the
+// calling thread acts as the RX thread.
 
+#include "hqts/core/sharded_runtime.h"
+#include "hqts/policy/policy_tree.h"
+#include "hqts/scheduler/strict_priority_scheduler.h"
+#include "hqts/scheduler/aqm_queue.h" // For RedAqmParameters
+
+#include <chrono>
+#include <cstdlib>  // For std::strtoul
 #include <iostream>
-// #include "hqts/core/some_core_header.h" // Example include
+#include <memory>   // For std::make_unique
+#include <thread>   // For std::thread::hardware_concurrency
+#include <vector>
 
 int main(int argc, char* argv[]) {
+    using namespace hqts;
+
+    size_t num_workers = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2;
+    size_t num_packets = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1000000;
+    if (num_workers == 0) {
+        std::cerr << "usage: " << argv[0] << " [num_workers >= 1] [num_packets]" << std::endl;
+        return 1;
+    }
     std::cout << "HQTS Application starting..." << std::endl;
 
-    // Initialize modules (core, policy, scheduler, etc.)
-    // Parse command-line arguments
-    // Start the main application loop or service
+    policy::PolicyTree policies;
+    policies.insert(core::ShapingPolicy(1, policy::NO_PARENT_POLICY_ID, "default",
+                                        10000000000ull, 20000000000ull, 1000000, 2000000,
+                                        policy::SchedulingAlgorithm::STRICT_PRIORITY, 100, 0,
+                                        true, 0, 1, 1, 0, 0, 0));
+
+    core::ShardedRuntimeConfig config;
+    config.num_workers = num_workers;
+    config.default_policy_id = 1;
+    if (std::thread::hardware_concurrency() > num_workers) {
+        for (size_t i = 0; i < num_workers; ++i) {
+            config.worker_cpus.push_back(static_cast<int>(i + 1)); // CPU 0 left to RX and egress
+        }
+    }
+
+    std::vector<scheduler::RedAqmParameters> levels(2, scheduler::RedAqmParameters(1u << 20, 1u << 21, 0.1,
+                                                                                    0.002, 1u << 22));
+    uint64_t transmitted_bytes = 0;
+    core::ShardedRuntime runtime(config, policies, std::make_unique<scheduler::StrictPriorityScheduler>(levels),
+                                 [&transmitted_bytes](const scheduler::PacketDescriptor& packet) {
+                                     transmitted_bytes += packet.packet_length_bytes;
+                                 });
+
+    auto start = std::chrono::steady_clock::now();
+    runtime.start();
+    for (size_t i = 0; i < num_packets; ++i) {
+        uint32_t flow = static_cast<uint32_t>(i % 4096);
+        core::IncomingPacket packet(dataplane::FiveTuple(0x0A000000u + flow, 0x0B000001u,
+                                                         static_cast<uint16_t>(1024 + flow), 80, 6),
+                                    64 + static_cast<uint32_t>(i % 1400));
+        while (!runtime.dispatch(packet)) {
+            std::this_thread::yield();
+        }
+    }
+    runtime.stop();
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 
-    // Example:
-    // if (argc > 1 && std::string(argv[1]) == "--version") {
-    //     std::cout << "HQTS Version 0.1.0" << std::endl;
-    //     return 0;
-    // }
+    uint64_t forwarded = 0;
+    for (size_t w = 0; w < runtime.num_workers(); ++w) {
+        const core::WorkerCounters& counters = runtime.worker_counters(w);
+        forwarded += counters.packets_forwarded.load();
+        std::cout << "worker " << w << ": received " << counters.packets_received.load()
+                  << ", policed " << counters.packets_dropped.load() << std::endl;
+    }
+    std::cout << "port AQM dropped " << forwarded - runtime.packets_transmitted() << " packets" << std::endl;
+    std::cout << "transmitted " << runtime.packets_transmitted() << " packets (" << transmitted_bytes
+              << " bytes) in " << elapsed << " s" << std::endl;
 
     std::cout << "HQTS Application finished." << std::endl;
     return 0;
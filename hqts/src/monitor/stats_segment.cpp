@@ -0,0 +1,250 @@
+#include "hqts/monitor/stats_segment.h"
+
+#include <algorithm> // For std::min
+#include <cerrno>
+#include <cstring>   // For std::memcpy
+#include <new>       // For placement new
+#include <stdexcept> // For std::invalid_argument, std::runtime_error
+#include <system_error>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>    // For O_* flags
+#include <sys/mman.h> // For shm_open, mmap
+#include <sys/stat.h> // For fstat
+#include <unistd.h>   // For ftruncate, close
+#define HQTS_HAVE_POSIX_SHM 1
+#endif
+
+namespace hqts {
+namespace monitor {
+
+namespace {
+
+constexpr uint64_t CACHE_LINE_BYTES = 64;
+
+uint64_t align_up(uint64_t bytes) {
+    return (bytes + CACHE_LINE_BYTES - 1) & ~(CACHE_LINE_BYTES - 1);
+}
+
+[[noreturn]] void throw_errno(const std::string& what) {
+    throw std::system_error(errno, std::generic_category(), "StatsSegment: " + what);
+}
+
+// True if `count` records of `Record` starting `offset` bytes in lie within `bytes`
+// and are aligned for it. Written without sums that a corrupt header could overflow.
+template <typename Record>
+bool records_fit(uint64_t offset, uint32_t count, uint64_t bytes) {
+    return offset >= sizeof(StatsSegmentHeader) && offset <= bytes && offset % alignof(Record) == 0 &&
+           count <= (bytes - offset) / sizeof(Record);
+}
+
+template <typename Record>
+const Record* records_at(const void* mapping, uint64_t offset) {
+    return reinterpret_cast<const Record*>(static_cast<const unsigned char*>(mapping) + offset);
+}
+
+template <typename Record>
+Record* records_at(void* mapping, uint64_t offset) {
+    return reinterpret_cast<Record*>(static_cast<unsigned char*>(mapping) + offset);
+}
+
+// Copies min(records.size(), max) records; returns how many.
+template <typename Record>
+uint32_t copy_records(void* mapping, uint64_t offset, uint32_t max, const std::vector<Record>& records) {
+    uint32_t count = static_cast<uint32_t>(std::min<size_t>(records.size(), max));
+    if (count > 0) {
+        std::memcpy(records_at<Record>(mapping, offset), records.data(), count * sizeof(Record));
+    }
+    return count;
+}
+
+template <typename Record>
+void copy_out(const void* mapping, uint64_t offset, uint32_t count, std::vector<Record>& out) {
+    out.resize(count);
+    if (count > 0) {
+        std::memcpy(out.data(), records_at<Record>(mapping, offset), count * sizeof(Record));
+    }
+}
+
+} // namespace
+
+StatsSegmentWriter::StatsSegmentWriter(const std::string& name, const StatsSegmentLayout& layout)
+    : name_(name), layout_(layout) {
+    if (layout.max_policies == 0 || layout.max_queues == 0 || layout.max_workers == 0) {
+        throw std::invalid_argument("StatsSegment: every layout maximum must be at least 1.");
+    }
+    const uint64_t policies_offset = align_up(sizeof(StatsSegmentHeader));
+    const uint64_t queues_offset = align_up(policies_offset + uint64_t{layout.max_policies} * sizeof(PolicyStatsRecord));
+    const uint64_t workers_offset = align_up(queues_offset + uint64_t{layout.max_queues} * sizeof(QueueStatsRecord));
+    const uint64_t segment_bytes = align_up(workers_offset + uint64_t{layout.max_workers} * sizeof(WorkerStatsRecord));
+
+#ifdef HQTS_HAVE_POSIX_SHM
+    // A segment left behind by a writer that died is replaced, never reused: readers
+    // still mapping it keep their view, and this writer starts from a zero-filled one.
+    if (shm_unlink(name.c_str()) != 0 && errno != ENOENT) {
+        throw_errno("cannot unlink stale " + name);
+    }
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        throw_errno("cannot create " + name);
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || ftruncate(fd, static_cast<off_t>(segment_bytes)) != 0) {
+        int error = errno;
+        close(fd);
+        shm_unlink(name.c_str());
+        errno = error;
+        throw_errno("cannot size " + name);
+    }
+    void* mapping = mmap(nullptr, segment_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    int error = errno;
+    close(fd); // The mapping keeps the segment alive
+    if (mapping == MAP_FAILED) {
+        shm_unlink(name.c_str());
+        errno = error;
+        throw_errno("cannot map " + name);
+    }
+    mapping_ = mapping;
+    mapping_bytes_ = static_cast<size_t>(segment_bytes);
+    segment_device_ = static_cast<uint64_t>(info.st_dev);
+    segment_inode_ = static_cast<uint64_t>(info.st_ino);
+#else
+    throw std::runtime_error("StatsSegment: shared memory is not supported on this platform.");
+#endif
+
+    // ftruncate zero-filled the segment; only the fixed fields need writing.
+    StatsSegmentHeader* header = new (mapping_) StatsSegmentHeader();
+    header->layout_version = STATS_SEGMENT_LAYOUT_VERSION;
+    header->header_bytes = static_cast<uint32_t>(sizeof(StatsSegmentHeader));
+    header->segment_bytes = segment_bytes;
+    header->max_policies = layout.max_policies;
+    header->max_queues = layout.max_queues;
+    header->max_workers = layout.max_workers;
+    header->policies_offset = policies_offset;
+    header->queues_offset = queues_offset;
+    header->workers_offset = workers_offset;
+    header->sequence.store(0, std::memory_order_relaxed);
+    // Written last: a reader that sees the magic sees a complete header.
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = STATS_SEGMENT_MAGIC;
+}
+
+StatsSegmentWriter::~StatsSegmentWriter() {
+#ifdef HQTS_HAVE_POSIX_SHM
+    if (mapping_ != nullptr) {
+        munmap(mapping_, mapping_bytes_);
+        // Leave the name alone if a later writer has since replaced the segment.
+        int fd = shm_open(name_.c_str(), O_RDONLY, 0);
+        if (fd >= 0) {
+            struct stat info;
+            bool ours = fstat(fd, &info) == 0 && static_cast<uint64_t>(info.st_dev) == segment_device_ &&
+                        static_cast<uint64_t>(info.st_ino) == segment_inode_;
+            close(fd);
+            if (ours) {
+                shm_unlink(name_.c_str());
+            }
+        }
+    }
+#endif
+}
+
+void StatsSegmentWriter::update(core::TimestampNs now_ns,
+                                const std::vector<PolicyStatsRecord>& policies,
+                                const std::vector<QueueStatsRecord>& queues,
+                                const std::vector<WorkerStatsRecord>& workers) {
+    StatsSegmentHeader* header = static_cast<StatsSegmentHeader*>(mapping_);
+    uint64_t sequence = header->sequence.load(std::memory_order_relaxed);
+    header->sequence.store(sequence + 1, std::memory_order_relaxed); // Odd: update in progress
+    std::atomic_thread_fence(std::memory_order_release);
+
+    header->update_time_ns = now_ns;
+    header->num_policies = copy_records(mapping_, header->policies_offset, layout_.max_policies, policies);
+    header->num_queues = copy_records(mapping_, header->queues_offset, layout_.max_queues, queues);
+    header->num_workers = copy_records(mapping_, header->workers_offset, layout_.max_workers, workers);
+
+    header->sequence.store(sequence + 2, std::memory_order_release);
+    ++updates_;
+}
+
+StatsSegmentReader::StatsSegmentReader(const std::string& name) {
+#ifdef HQTS_HAVE_POSIX_SHM
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        throw_errno("cannot open " + name);
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        int error = errno;
+        close(fd);
+        errno = error;
+        throw_errno("cannot stat " + name);
+    }
+    size_t bytes = static_cast<size_t>(info.st_size);
+    if (bytes < sizeof(StatsSegmentHeader)) {
+        close(fd);
+        throw std::runtime_error("StatsSegment: " + name + " is too small to be a stats segment.");
+    }
+    void* mapping = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    int error = errno;
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        errno = error;
+        throw_errno("cannot map " + name);
+    }
+    mapping_ = mapping;
+    mapping_bytes_ = bytes;
+
+    const StatsSegmentHeader* header = static_cast<const StatsSegmentHeader*>(mapping_);
+    // read() copies from the offsets below, so they must be checked before it trusts them.
+    if (header->magic != STATS_SEGMENT_MAGIC || header->layout_version != STATS_SEGMENT_LAYOUT_VERSION ||
+        header->segment_bytes > mapping_bytes_ ||
+        !records_fit<PolicyStatsRecord>(header->policies_offset, header->max_policies, header->segment_bytes) ||
+        !records_fit<QueueStatsRecord>(header->queues_offset, header->max_queues, header->segment_bytes) ||
+        !records_fit<WorkerStatsRecord>(header->workers_offset, header->max_workers, header->segment_bytes)) {
+        munmap(mapping, bytes);
+        mapping_ = nullptr;
+        throw std::runtime_error("StatsSegment: " + name + " is not a stats segment of layout version " +
+                                 std::to_string(STATS_SEGMENT_LAYOUT_VERSION) + ".");
+    }
+    std::atomic_thread_fence(std::memory_order_acquire); // Pairs with the writer's fence before magic
+#else
+    (void)name;
+    throw std::runtime_error("StatsSegment: shared memory is not supported on this platform.");
+#endif
+}
+
+StatsSegmentReader::~StatsSegmentReader() {
+#ifdef HQTS_HAVE_POSIX_SHM
+    if (mapping_ != nullptr) {
+        munmap(const_cast<void*>(mapping_), mapping_bytes_);
+    }
+#endif
+}
+
+bool StatsSegmentReader::read(StatsView& view, unsigned max_attempts) const {
+    const StatsSegmentHeader* header = static_cast<const StatsSegmentHeader*>(mapping_);
+    for (unsigned attempt = 0; attempt < max_attempts; ++attempt) {
+        uint64_t before = header->sequence.load(std::memory_order_acquire);
+        if (before & 1) {
+            continue; // Update in progress
+        }
+        // Counts are clamped so a torn read can never copy past the arrays.
+        uint32_t num_policies = std::min(header->num_policies, header->max_policies);
+        uint32_t num_queues = std::min(header->num_queues, header->max_queues);
+        uint32_t num_workers = std::min(header->num_workers, header->max_workers);
+        view.update_time_ns = header->update_time_ns;
+        copy_out(mapping_, header->policies_offset, num_policies, view.policies);
+        copy_out(mapping_, header->queues_offset, num_queues, view.queues);
+        copy_out(mapping_, header->workers_offset, num_workers, view.workers);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (header->sequence.load(std::memory_order_relaxed) == before) {
+            view.sequence = before;
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace monitor
+} // namespace hqts
@@ -0,0 +1,260 @@
+#include "hqts/policy/policy_snapshot.h"
+
+#include <cerrno>
+#include <cstdio>    // For std::fopen, std::fwrite, std::fflush, std::rename
+#include <stdexcept> // For std::length_error, std::runtime_error
+#include <string>    // For std::to_string in error messages
+#include <system_error>
+#include <utility>   // For std::move
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>    // For O_RDONLY
+#include <sys/mman.h> // For mmap
+#include <sys/stat.h> // For fstat
+#include <unistd.h>   // For close, fsync
+#define HQTS_HAVE_MMAP 1
+#endif
+
+namespace hqts {
+namespace policy {
+
+namespace {
+
+constexpr uint64_t RECORD_ALIGNMENT = 8;
+
+uint64_t align_up(uint64_t bytes) {
+    return (bytes + RECORD_ALIGNMENT - 1) & ~(RECORD_ALIGNMENT - 1);
+}
+
+[[noreturn]] void throw_errno(const std::string& what) {
+    throw std::system_error(errno, std::generic_category(), "PolicySnapshot: " + what);
+}
+
+[[noreturn]] void throw_invalid(const std::string& path, const std::string& why) {
+    throw std::runtime_error("PolicySnapshot: " + path + " is not a valid policy snapshot: " + why + ".");
+}
+
+// Flushes `file` through to the disk, so a rename over the old snapshot cannot
+// outlive a crash that loses the new one's contents.
+bool sync_file(std::FILE* file) {
+    if (std::fflush(file) != 0) {
+        return false;
+    }
+#ifdef HQTS_HAVE_MMAP
+    return fsync(fileno(file)) == 0;
+#else
+    return true;
+#endif
+}
+
+// Makes a rename into the directory holding `path` durable.
+bool sync_parent_directory(const std::string& path) {
+#ifdef HQTS_HAVE_MMAP
+    const size_t slash = path.find_last_of('/');
+    const std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    int fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0) {
+        return false;
+    }
+    bool synced = fsync(fd) == 0;
+    int error = errno;
+    close(fd);
+    errno = error;
+    return synced;
+#else
+    (void)path;
+    return true;
+#endif
+}
+
+PolicySnapshotRecord make_record(const core::ShapingPolicy& policy, uint32_t name_offset) {
+    PolicySnapshotRecord record{};
+    record.id = policy.id;
+    record.parent_id = policy.parent_id;
+    record.committed_rate_bps = policy.committed_rate_bps;
+    record.peak_rate_bps = policy.peak_rate_bps;
+    record.committed_burst_bytes = policy.committed_burst_bytes;
+    record.excess_burst_bytes = policy.excess_burst_bytes;
+    record.max_shaping_delay_ns = policy.max_shaping_delay_ns;
+    record.name_offset = name_offset;
+    record.name_length = static_cast<uint32_t>(policy.name.size());
+    record.weight = policy.weight;
+    record.target_queue_id_green = policy.target_queue_id_green;
+    record.target_queue_id_yellow = policy.target_queue_id_yellow;
+    record.target_queue_id_red = policy.target_queue_id_red;
+    record.algorithm = static_cast<uint8_t>(policy.algorithm);
+    record.priority_level = policy.priority_level;
+    record.target_priority_green = policy.target_priority_green;
+    record.target_priority_yellow = policy.target_priority_yellow;
+    record.target_priority_red = policy.target_priority_red;
+    record.drop_on_red = policy.drop_on_red ? 1 : 0;
+    record.shape_to_cir = policy.shape_to_cir ? 1 : 0;
+    return record;
+}
+
+} // namespace
+
+void PolicySnapshot::write(const PolicyTree& tree, const std::string& path) {
+    const auto& id_index = tree.get<by_id>();
+    std::vector<PolicySnapshotRecord> records;
+    std::string names;
+    records.reserve(tree.size());
+    for (const core::ShapingPolicy& policy : id_index) {
+        if (names.size() + policy.name.size() > UINT32_MAX) {
+            throw std::length_error("PolicySnapshot: policy names exceed the 4 GB name table.");
+        }
+        records.push_back(make_record(policy, static_cast<uint32_t>(names.size())));
+        names += policy.name;
+    }
+
+    PolicySnapshotHeader header{};
+    header.magic = POLICY_SNAPSHOT_MAGIC;
+    header.format_version = POLICY_SNAPSHOT_FORMAT_VERSION;
+    header.record_bytes = static_cast<uint32_t>(sizeof(PolicySnapshotRecord));
+    header.count = records.size();
+    header.records_offset = align_up(sizeof(PolicySnapshotHeader));
+    header.names_offset = header.records_offset + records.size() * sizeof(PolicySnapshotRecord);
+    header.names_bytes = names.size();
+
+    const std::string temporary = path + ".tmp";
+    std::FILE* file = std::fopen(temporary.c_str(), "wb");
+    if (file == nullptr) {
+        throw_errno("cannot create " + temporary);
+    }
+    static const char padding[RECORD_ALIGNMENT] = {};
+    bool written = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+                   std::fwrite(padding, 1, header.records_offset - sizeof(header), file) ==
+                       header.records_offset - sizeof(header) &&
+                   (records.empty() ||
+                    std::fwrite(records.data(), sizeof(PolicySnapshotRecord), records.size(), file) == records.size()) &&
+                   (names.empty() || std::fwrite(names.data(), 1, names.size(), file) == names.size()) &&
+                   sync_file(file);
+    int error = errno;
+    if (std::fclose(file) != 0 && written) {
+        written = false;
+        error = errno;
+    }
+    if (written && std::rename(temporary.c_str(), path.c_str()) != 0) {
+        written = false;
+        error = errno;
+    }
+    if (!written) {
+        std::remove(temporary.c_str());
+        errno = error;
+        throw_errno("cannot write " + path);
+    }
+    if (!sync_parent_directory(path)) {
+        throw_errno("cannot sync the directory of " + path);
+    }
+}
+
+PolicySnapshot::PolicySnapshot(const std::string& path) {
+#ifdef HQTS_HAVE_MMAP
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw_errno("cannot open " + path);
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        int error = errno;
+        close(fd);
+        errno = error;
+        throw_errno("cannot stat " + path);
+    }
+    size_t bytes = static_cast<size_t>(info.st_size);
+    if (bytes < sizeof(PolicySnapshotHeader)) {
+        close(fd);
+        throw_invalid(path, "too small");
+    }
+    void* mapping = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    int error = errno;
+    close(fd); // The mapping keeps the file's pages reachable
+    if (mapping == MAP_FAILED) {
+        errno = error;
+        throw_errno("cannot map " + path);
+    }
+    mapping_ = mapping;
+    mapping_bytes_ = bytes;
+#else
+    throw std::runtime_error("PolicySnapshot: memory-mapped files are not supported on this platform.");
+#endif
+
+    // Validate everything the accessors rely on once, so they need no checks.
+    const unsigned char* base = static_cast<const unsigned char*>(mapping_);
+    const PolicySnapshotHeader* header = reinterpret_cast<const PolicySnapshotHeader*>(base);
+    std::string problem;
+    if (header->magic != POLICY_SNAPSHOT_MAGIC) {
+        problem = "bad magic";
+    } else if (header->format_version != POLICY_SNAPSHOT_FORMAT_VERSION ||
+               header->record_bytes != sizeof(PolicySnapshotRecord)) {
+        problem = "format version " + std::to_string(header->format_version) + ", expected " +
+                  std::to_string(POLICY_SNAPSHOT_FORMAT_VERSION);
+    } else if (header->records_offset % RECORD_ALIGNMENT != 0 || header->records_offset > bytes ||
+               header->count > (bytes - header->records_offset) / sizeof(PolicySnapshotRecord) ||
+               header->names_offset != header->records_offset + header->count * sizeof(PolicySnapshotRecord) ||
+               header->names_bytes > bytes - header->names_offset) {
+        problem = "truncated";
+    }
+    if (problem.empty()) {
+        records_ = reinterpret_cast<const PolicySnapshotRecord*>(base + header->records_offset);
+        names_ = reinterpret_cast<const char*>(base + header->names_offset);
+        count_ = static_cast<size_t>(header->count);
+        for (size_t i = 0; i < count_ && problem.empty(); ++i) {
+            const PolicySnapshotRecord& record = records_[i];
+            if (i > 0 && record.id <= records_[i - 1].id) {
+                problem = "ids not in ascending order at record " + std::to_string(i);
+            } else if (uint64_t{record.name_offset} + record.name_length > header->names_bytes) {
+                problem = "name of record " + std::to_string(i) + " out of bounds";
+            } else if (record.algorithm > static_cast<uint8_t>(SchedulingAlgorithm::HFSC)) {
+                problem = "unknown scheduling algorithm in record " + std::to_string(i);
+            }
+        }
+    }
+    if (!problem.empty()) {
+#ifdef HQTS_HAVE_MMAP
+        munmap(const_cast<void*>(mapping_), mapping_bytes_);
+#endif
+        mapping_ = nullptr;
+        throw_invalid(path, problem);
+    }
+}
+
+PolicySnapshot::~PolicySnapshot() {
+#ifdef HQTS_HAVE_MMAP
+    if (mapping_ != nullptr) {
+        munmap(const_cast<void*>(mapping_), mapping_bytes_);
+    }
+#endif
+}
+
+core::ShapingPolicy PolicySnapshot::to_policy(size_t index,
+                                              std::chrono::steady_clock::time_point last_updated) const {
+    const PolicySnapshotRecord& record = records_[index];
+    core::ShapingPolicy policy(record.id, record.parent_id, std::string(name(index)),
+                               record.committed_rate_bps, record.peak_rate_bps,
+                               record.committed_burst_bytes, record.excess_burst_bytes,
+                               static_cast<SchedulingAlgorithm>(record.algorithm), record.weight,
+                               record.priority_level, record.drop_on_red != 0,
+                               record.target_priority_green, record.target_priority_yellow,
+                               record.target_priority_red, record.target_queue_id_green,
+                               record.target_queue_id_yellow, record.target_queue_id_red, last_updated);
+    policy.shape_to_cir = record.shape_to_cir != 0;
+    policy.max_shaping_delay_ns = record.max_shaping_delay_ns;
+    return policy;
+}
+
+PolicyTree PolicySnapshot::to_tree() const {
+    const auto now = std::chrono::steady_clock::now(); // One clock read for the whole load
+    std::vector<core::ShapingPolicy> policies;
+    policies.reserve(count_);
+    for (size_t i = 0; i < count_; ++i) {
+        policies.push_back(to_policy(i, now));
+    }
+    PolicyTree tree;
+    bulk_insert(tree, std::move(policies)); // Already sorted: appended in id order
+    return tree;
+}
+
+} // namespace policy
+} // namespace hqts
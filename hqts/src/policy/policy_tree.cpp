@@ -0,0 +1,26 @@
+#include "hqts/policy/policy_tree.h"
+
+#include <algorithm> // For std::is_sorted, std::stable_sort
+#include <utility>   // For std::move
+
+namespace hqts {
+namespace policy {
+
+size_t bulk_insert(PolicyTree& tree, std::vector<core::ShapingPolicy> policies) {
+    auto by_policy_id = [](const core::ShapingPolicy& a, const core::ShapingPolicy& b) { return a.id < b.id; };
+    if (!std::is_sorted(policies.begin(), policies.end(), by_policy_id)) {
+        // Stable: of several policies with one id, the first is kept, as with insert().
+        std::stable_sort(policies.begin(), policies.end(), by_policy_id);
+    }
+    auto& id_index = tree.get<by_id>();
+    size_t inserted = 0;
+    for (core::ShapingPolicy& policy : policies) {
+        size_t before = id_index.size();
+        id_index.emplace_hint(id_index.end(), std::move(policy));
+        inserted += id_index.size() - before;
+    }
+    return inserted;
+}
+
+} // namespace policy
+} // namespace hqts
@@ -0,0 +1,213 @@
+#include "hqts/policy/runtime_policy_table.h"
+
+#include <algorithm> // For std::lower_bound
+#include <cstddef>   // For std::ptrdiff_t
+#include <stdexcept> // For std::invalid_argument
+#include <string>    // For std::to_string in error messages
+#include <utility>   // For std::move
+
+namespace hqts {
+namespace policy {
+
+RuntimePolicy::RuntimePolicy(const core::ShapingPolicy& policy)
+    : cir_bucket(policy.cir_bucket),
+      pir_bucket(policy.pir_bucket),
+      id(policy.id),
+      parent_index(NO_POLICY_INDEX),
+      target_queue_id_green(policy.target_queue_id_green),
+      target_queue_id_yellow(policy.target_queue_id_yellow),
+      target_queue_id_red(policy.target_queue_id_red),
+      max_shaping_delay_ns(policy.max_shaping_delay_ns),
+      target_priority_green(policy.target_priority_green),
+      target_priority_yellow(policy.target_priority_yellow),
+      target_priority_red(policy.target_priority_red),
+      drop_on_red(policy.drop_on_red),
+      shape_to_cir(policy.shape_to_cir),
+      has_peak_rate(policy.peak_rate_bps > 0),
+      stats_slot(UINT32_MAX) {}
+
+RuntimePolicy::RuntimePolicy(const PolicySnapshotRecord& record)
+    : cir_bucket(record.committed_rate_bps, record.committed_burst_bytes),
+      pir_bucket(record.peak_rate_bps, record.excess_burst_bytes),
+      id(record.id),
+      parent_index(NO_POLICY_INDEX),
+      target_queue_id_green(record.target_queue_id_green),
+      target_queue_id_yellow(record.target_queue_id_yellow),
+      target_queue_id_red(record.target_queue_id_red),
+      max_shaping_delay_ns(record.max_shaping_delay_ns),
+      target_priority_green(record.target_priority_green),
+      target_priority_yellow(record.target_priority_yellow),
+      target_priority_red(record.target_priority_red),
+      drop_on_red(record.drop_on_red != 0),
+      shape_to_cir(record.shape_to_cir != 0),
+      has_peak_rate(record.peak_rate_bps > 0),
+      stats_slot(UINT32_MAX) {}
+
+bool RuntimePolicy::same_buckets(const RuntimePolicy& other) const {
+    return cir_bucket.rate_bps() == other.cir_bucket.rate_bps() &&
+           cir_bucket.capacity_bytes() == other.cir_bucket.capacity_bytes() &&
+           pir_bucket.rate_bps() == other.pir_bucket.rate_bps() &&
+           pir_bucket.capacity_bytes() == other.pir_bucket.capacity_bytes();
+}
+
+CompiledPolicies::CompiledPolicies(const PolicyTree& tree, uint32_t version) : version_(version) {
+    // The by_id index iterates in ascending id order, which is the order lookups need.
+    const auto& id_index = tree.get<by_id>();
+    ids_.reserve(tree.size());
+    records_.reserve(tree.size());
+    std::vector<PolicyId> parent_ids;
+    parent_ids.reserve(tree.size());
+    for (const core::ShapingPolicy& policy : id_index) {
+        ids_.push_back(policy.id);
+        parent_ids.push_back(policy.parent_id);
+        records_.emplace_back(policy);
+    }
+    link_parents(parent_ids);
+}
+
+CompiledPolicies::CompiledPolicies(const PolicySnapshot& snapshot, uint32_t version) : version_(version) {
+    // Snapshot records are validated to be in ascending id order already.
+    ids_.reserve(snapshot.size());
+    records_.reserve(snapshot.size());
+    std::vector<PolicyId> parent_ids;
+    parent_ids.reserve(snapshot.size());
+    for (size_t i = 0; i < snapshot.size(); ++i) {
+        ids_.push_back(snapshot[i].id);
+        parent_ids.push_back(snapshot[i].parent_id);
+        records_.emplace_back(snapshot[i]);
+    }
+    link_parents(parent_ids);
+}
+
+void CompiledPolicies::link_parents(const std::vector<PolicyId>& parent_ids) {
+    // Link parents by index. A parent id that is not compiled makes a root, as
+    // NO_PARENT_POLICY_ID does.
+    for (size_t i = 0; i < records_.size(); ++i) {
+        if (parent_ids[i] != NO_PARENT_POLICY_ID) {
+            records_[i].parent_index = index_of(parent_ids[i]);
+        }
+    }
+
+    // Hierarchical charging walks parent links: reject cycles here, off the data path.
+    // A chain longer than the number of records must revisit one.
+    for (size_t start = 0; start < records_.size(); ++start) {
+        size_t depth = 0;
+        for (uint32_t index = records_[start].parent_index; index != NO_POLICY_INDEX;
+             index = records_[index].parent_index) {
+            if (++depth > records_.size()) {
+                throw std::invalid_argument("CompiledPolicies: parent links of policy " +
+                                            std::to_string(records_[start].id) + " form a cycle.");
+            }
+        }
+    }
+}
+
+uint32_t CompiledPolicies::index_of(PolicyId id) const {
+    auto it = std::lower_bound(ids_.begin(), ids_.end(), id);
+    if (it == ids_.end() || *it != id) {
+        return NO_POLICY_INDEX;
+    }
+    return static_cast<uint32_t>(it - ids_.begin());
+}
+
+RuntimePolicy* CompiledPolicies::find(PolicyId id) {
+    uint32_t index = index_of(id);
+    return index == NO_POLICY_INDEX ? nullptr : &records_[index];
+}
+
+size_t CompiledPolicies::carry_state_from(const CompiledPolicies& previous) {
+    size_t carried = 0;
+    size_t j = 0;
+    for (size_t i = 0; i < records_.size(); ++i) {
+        while (j < previous.ids_.size() && previous.ids_[j] < ids_[i]) {
+            ++j;
+        }
+        if (j == previous.ids_.size()) {
+            break;
+        }
+        if (previous.ids_[j] != ids_[i]) {
+            continue; // A policy the update added
+        }
+        RuntimePolicy& record = records_[i];
+        const RuntimePolicy& old_record = previous.records_[j];
+        record.stats_slot = old_record.stats_slot;
+        if (record.same_buckets(old_record)) {
+            record.cir_bucket = old_record.cir_bucket;
+            record.pir_bucket = old_record.pir_bucket;
+            ++carried;
+        }
+    }
+    return carried;
+}
+
+RuntimePolicyTable::RuntimePolicyTable() : RuntimePolicyTable(PolicyTree()) {}
+
+RuntimePolicyTable::RuntimePolicyTable(const PolicyTree& tree)
+    : current_(new CompiledPolicies(tree, 1)), version_(1), epochs_(MAX_READERS) {}
+
+RuntimePolicyTable::RuntimePolicyTable(const PolicySnapshot& snapshot)
+    : current_(new CompiledPolicies(snapshot, 1)), version_(1), epochs_(MAX_READERS) {}
+
+RuntimePolicyTable::~RuntimePolicyTable() {
+    delete current_.load(std::memory_order_relaxed); // Retired snapshots go with retired_
+}
+
+uint32_t RuntimePolicyTable::publish(const PolicyTree& tree) {
+    std::lock_guard<std::mutex> publish_lock(publish_mutex_);
+    // Compiled off to the side: readers keep using the current snapshot meanwhile.
+    return swap_in(std::make_unique<CompiledPolicies>(tree, next_version()));
+}
+
+uint32_t RuntimePolicyTable::publish(const PolicySnapshot& snapshot) {
+    std::lock_guard<std::mutex> publish_lock(publish_mutex_);
+    return swap_in(std::make_unique<CompiledPolicies>(snapshot, next_version()));
+}
+
+uint32_t RuntimePolicyTable::next_version() const {
+    uint32_t version = version_.load(std::memory_order_relaxed) + 1;
+    return version == 0 ? 1 : version; // 0 marks a flow that never resolved its policy
+}
+
+uint32_t RuntimePolicyTable::swap_in(std::unique_ptr<CompiledPolicies> compiled) {
+    uint32_t version = compiled->version();
+    std::unique_ptr<CompiledPolicies> replaced(current_.exchange(compiled.release()));
+    retired_.push_back(RetiredSnapshot{epochs_.advance(), std::move(replaced)});
+    version_.store(version, std::memory_order_release);
+    reclaim_locked();
+    return version;
+}
+
+CompiledPolicies* RuntimePolicyTable::refresh(size_t reader, CompiledPolicies* held) {
+    // The epoch is read before the pointer: a snapshot retired after this load is
+    // tagged with a later epoch than the one announced below.
+    uint64_t epoch = epochs_.epoch();
+    CompiledPolicies* latest = current_.load(std::memory_order_acquire);
+    if (held != nullptr && held != latest) {
+        latest->carry_state_from(*held);
+    }
+    epochs_.quiescent(reader, epoch);
+    return latest;
+}
+
+size_t RuntimePolicyTable::reclaim() {
+    std::lock_guard<std::mutex> publish_lock(publish_mutex_);
+    return reclaim_locked();
+}
+
+size_t RuntimePolicyTable::reclaim_locked() {
+    // Retired in epoch order, so the snapshots readers have moved past form a prefix.
+    size_t freed = 0;
+    while (freed < retired_.size() && epochs_.passed(retired_[freed].epoch)) {
+        ++freed;
+    }
+    retired_.erase(retired_.begin(), retired_.begin() + static_cast<std::ptrdiff_t>(freed));
+    return freed;
+}
+
+size_t RuntimePolicyTable::retired_snapshots() const {
+    std::lock_guard<std::mutex> publish_lock(publish_mutex_);
+    return retired_.size();
+}
+
+} // namespace policy
+} // namespace hqts
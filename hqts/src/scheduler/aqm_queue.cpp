@@ -1,51 +1,83 @@
 #include "hqts/scheduler/aqm_queue.h"
-#include <random>      // For std::mt19937, std::uniform_real_distribution
-#include <algorithm>   // For std::max, std::min
-#include <cmath>       // For std::pow, not strictly needed for linear prob
-#include <chrono>      // For seeding random generator
-#include <string>      // For std::to_string in error messages (though not used in this version)
+#include "hqts/core/stage_profiler.h" // For HQTS_PROFILE_STAGE
+#include <algorithm>   // For std::min
+#include <cmath>       // For std::log2, std::lround (construction only)
+#include <utility>     // For std::move
 
 namespace hqts {
 namespace scheduler {
 
 // Constructor
-RedAqmQueue::RedAqmQueue(const RedAqmParameters& params)
-    : params_(params),
-      average_queue_size_bytes_(0.0),
+RedAqmQueue::RedAqmQueue(const RedAqmParameters& params,
+                         std::shared_ptr<PacketDescriptorPool> descriptor_pool)
+    : packet_buffer_(descriptor_pool ? std::move(descriptor_pool)
+                                     : PacketDescriptorPool::create_for_bytes(params.queue_capacity_bytes)),
+      params_(params),
+      average_queue_size_(0),
       current_total_bytes_(0),
       packets_since_last_drop_(0),
-      // Seed the random number generator. Using system clock for non-deterministic behavior.
-      // For deterministic testing, a fixed seed could be used.
-      random_generator_(static_cast<unsigned int>(std::chrono::system_clock::now().time_since_epoch().count())),
-      probability_distribution_(0.0, 1.0) {}
+      // A fixed seed keeps drop decisions reproducible; xorshift needs a non-zero state.
+      random_state_(params.random_seed != 0 ? params.random_seed : RedAqmParameters::DEFAULT_RANDOM_SEED) {
+    // The weight becomes a shift: avg += (sample - avg) / 2^n.
+    long shift = std::lround(-std::log2(params_.ewma_weight));
+    ewma_shift_ = static_cast<unsigned>(std::min(shift, 31L));
+
+    for (size_t color = 0; color < RedAqmParameters::COLOR_COUNT; ++color) {
+        const RedDropProfile& source = params_.color_profiles[color];
+        CompiledProfile& profile = profiles_[color];
+        profile.min_avg = static_cast<uint64_t>(source.min_threshold_bytes) << AVG_SHIFT;
+        profile.max_avg = static_cast<uint64_t>(source.max_threshold_bytes) << AVG_SHIFT;
+        profile.max_p = static_cast<uint64_t>(std::lround(source.max_probability * static_cast<double>(PROBABILITY_ONE)));
+        // (avg - min_avg) * p_per_avg >> 32 rises linearly to max_p at max_avg; with
+        // avg - min_avg < the threshold range the product stays below max_p << 32.
+        uint64_t range_bytes = source.max_threshold_bytes - source.min_threshold_bytes;
+        profile.p_per_avg = (profile.max_p << (32 - AVG_SHIFT)) / range_bytes;
+    }
+}
+
+uint32_t RedAqmQueue::next_random() {
+    random_state_ ^= random_state_ >> 12;
+    random_state_ ^= random_state_ << 25;
+    random_state_ ^= random_state_ >> 27;
+    return static_cast<uint32_t>((random_state_ * 0x2545F4914F6CDD1DULL) >> 32);
+}
 
 // Private helper: Updates EWMA average queue size
 // This is called *before* a drop decision for an arriving packet, using current_total_bytes_ (state before arrival).
 // Or *after* a packet is dequeued, using current_total_bytes_ (state after departure).
 void RedAqmQueue::update_average_queue_size() {
-    // Standard EWMA: avg = (1-w)*avg + w*sample
-    // Sample is the current instantaneous queue size (current_total_bytes_)
-    average_queue_size_bytes_ = (1.0 - params_.ewma_weight) * average_queue_size_bytes_ +
-                                params_.ewma_weight * static_cast<double>(current_total_bytes_);
+    // Standard EWMA: avg = (1-w)*avg + w*sample with w = 2^-ewma_shift_, in fixed point.
+    uint64_t sample = static_cast<uint64_t>(current_total_bytes_) << AVG_SHIFT;
+    if (sample >= average_queue_size_) {
+        average_queue_size_ += (sample - average_queue_size_) >> ewma_shift_;
+    } else {
+        average_queue_size_ -= (average_queue_size_ - sample) >> ewma_shift_;
+    }
 }
 
-// Private helper: Calculates base drop probability (p_b)
-double RedAqmQueue::calculate_drop_probability() const {
-    if (average_queue_size_bytes_ < params_.min_threshold_bytes) {
-        return 0.0;
-    } else if (average_queue_size_bytes_ >= params_.max_threshold_bytes) {
-        // When avg is at or beyond max_th, base probability is max_p
-        return params_.max_probability;
-    } else {
-        // Linear interpolation between min_th and max_th
-        double factor = (average_queue_size_bytes_ - params_.min_threshold_bytes) /
-                        (params_.max_threshold_bytes - params_.min_threshold_bytes);
-        return factor * params_.max_probability;
+bool RedAqmQueue::early_drop(const CompiledProfile& profile) {
+    // Base probability p_b: linear between the thresholds, max_p at and above max.
+    uint64_t p_b = profile.max_p;
+    if (average_queue_size_ < profile.max_avg) {
+        p_b = ((average_queue_size_ - profile.min_avg) * profile.p_per_avg) >> 32;
+    }
+    if (p_b == 0) {
+        return false;
     }
+
+    // "Gentle" spacing of drops by the count since the last one: drop with probability
+    // p_b / (1 - count * p_b), i.e. when random * (1 - count * p_b) < p_b. A count that
+    // pushes the denominator to zero forces the drop.
+    uint64_t count_p = static_cast<uint64_t>(packets_since_last_drop_) * p_b;
+    if (count_p >= PROBABILITY_ONE || p_b >= PROBABILITY_ONE) {
+        return true;
+    }
+    return static_cast<uint64_t>(next_random()) * (PROBABILITY_ONE - count_p) < (p_b << 32);
 }
 
 // Public method: Enqueue
 bool RedAqmQueue::enqueue(PacketDescriptor packet) {
+    HQTS_PROFILE_STAGE(core::ProfileStage::AQM); // The drop decision and the append
     // 1. Update average queue size based on state *before* this packet arrives.
     update_average_queue_size();
 
@@ -54,43 +86,30 @@ bool RedAqmQueue::enqueue(PacketDescriptor packet) {
         // Physical queue overflow, packet is dropped.
         // RED counters (like packets_since_last_drop_) are typically not reset for physical drops,
         // as these are not probabilistic RED drops.
+        core::PacketBufferPool::release_any(packet.buffer);
         return false;
     }
 
-    // 3. Calculate base drop probability (p_b)
-    double p_b = calculate_drop_probability();
-    double final_drop_prob = 0.0;
-
-    if (p_b > 0.0) { // Only apply gentle RED if base probability is non-zero
-        // Apply "gentle" RED modification using packets_since_last_drop_
-        // dp = p_b / (1 - count * p_b)
-        // This increases drop probability as count increases.
-        double denominator = 1.0 - static_cast<double>(packets_since_last_drop_) * p_b;
-        if (denominator <= 1e-9) { // Avoid division by zero or very small numbers; effectively means prob is 1
-            final_drop_prob = 1.0;
-        } else {
-            final_drop_prob = p_b / denominator;
-        }
-        // Ensure probability does not exceed 1.0 due to formula artifacts, though max_p should cap p_b.
-        // The formula for p_b already caps it at params_.max_probability.
-        // However, the gentle RED adjustment can push it higher.
-        // Some RED variants cap the final_drop_prob at 1.0 or a slightly higher max_p (e.g. 2*max_p)
-        final_drop_prob = std::min(final_drop_prob, 1.0);
-    }
-    // If p_b is 0.0, final_drop_prob remains 0.0.
-
-
-    // 4. Probabilistic drop decision
-    if (final_drop_prob > 0.0 && probability_distribution_(random_generator_) < final_drop_prob) {
+    // 3. Probabilistic drop decision against the packet's color profile (WRED); below
+    //    its min threshold the decision is a single compare.
+    const CompiledProfile& profile = profiles_[static_cast<size_t>(packet.conformance)];
+    if (average_queue_size_ >= profile.min_avg && early_drop(profile)) {
         // Packet dropped by RED
         packets_since_last_drop_ = 0;
+        core::PacketBufferPool::release_any(packet.buffer);
         return false;
     }
 
-    // 5. If not dropped, enqueue the packet
-    packets_since_last_drop_++;
-    current_total_bytes_ += packet.packet_length_bytes; // Update before pushing for consistency if packet had 0 length
-    packet_buffer_.push_back(std::move(packet));
+    // 4. If not dropped, enqueue the packet
+    if (!packet_buffer_.push_back(packet)) {
+        // Shared descriptor pool exhausted: tail drop, not a RED decision.
+        core::PacketBufferPool::release_any(packet.buffer);
+        return false;
+    }
+    if (packets_since_last_drop_ != UINT32_MAX) {
+        packets_since_last_drop_++;
+    }
+    current_total_bytes_ += packet.packet_length_bytes;
     // Note: If EWMA was to be updated *after* enqueue reflecting the new size, it would be called here again.
     // However, RED typically uses avg queue size *seen by arriving packet*.
     return true;
@@ -102,8 +121,7 @@ PacketDescriptor RedAqmQueue::dequeue() {
         throw std::runtime_error("RedAqmQueue: Queue is empty, cannot dequeue.");
     }
 
-    PacketDescriptor packet = packet_buffer_.front();
-    packet_buffer_.pop_front();
+    PacketDescriptor packet = packet_buffer_.pop_front();
     current_total_bytes_ -= packet.packet_length_bytes;
 
     // Update average queue size after a packet departs.
@@ -132,7 +150,7 @@ uint32_t RedAqmQueue::get_current_byte_size() const {
 
 // Public method: get_average_queue_size_bytes
 double RedAqmQueue::get_average_queue_size_bytes() const {
-    return average_queue_size_bytes_;
+    return static_cast<double>(average_queue_size_) / static_cast<double>(uint64_t{1} << AVG_SHIFT);
 }
 
 // Public method: get_parameters
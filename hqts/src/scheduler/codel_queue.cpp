@@ -0,0 +1,324 @@
+#include "hqts/scheduler/codel_queue.h"
+#include "hqts/core/stage_profiler.h" // For HQTS_PROFILE_STAGE
+
+#include <initializer_list> // For iterating both flow lists
+#include <stdexcept> // For std::runtime_error
+#include <utility>   // For std::move
+
+namespace hqts {
+namespace scheduler {
+
+namespace {
+
+constexpr uint64_t Q32_ONE = uint64_t{1} << 32;
+constexpr uint64_t Q32_ALMOST_ONE = Q32_ONE - 1; // 1/sqrt(1), as close as Q0.32 gets
+
+constexpr uint8_t LIST_NONE = 0;
+constexpr uint8_t LIST_NEW_FLOWS = 1;
+constexpr uint8_t LIST_OLD_FLOWS = 2;
+
+} // namespace
+
+// --- CoDelControl ---
+
+void CoDelControl::newton_step() {
+    // x' = x * (3 - count * x^2) / 2 in Q0.32. A count that jumped far ahead of x (a
+    // resumed dropping state) would make 3 - count * x^2 negative: lower x first.
+    uint64_t x = rec_inv_sqrt_;
+    uint64_t count_x2 = static_cast<uint64_t>(count_) * ((x * x) >> 32);
+    while (count_x2 >= 3 * Q32_ONE) {
+        x >>= 1;
+        count_x2 = static_cast<uint64_t>(count_) * ((x * x) >> 32);
+    }
+    uint64_t factor = (3 * Q32_ONE - count_x2) >> 2;
+    rec_inv_sqrt_ = (x * factor) >> 31;
+    if (rec_inv_sqrt_ > Q32_ALMOST_ONE) {
+        rec_inv_sqrt_ = Q32_ALMOST_ONE;
+    }
+}
+
+core::TimestampNs CoDelControl::control_law(core::TimestampNs t, const CoDelParameters& params) const {
+    // t + interval / sqrt(count); interval <= 2^32 keeps the product within 64 bits.
+    return t + ((params.interval_ns * rec_inv_sqrt_) >> 32);
+}
+
+PacketDescriptor CoDelControl::pop_head(PacketQueue& fifo, uint32_t& queue_bytes, core::TimestampNs now_ns,
+                                        const CoDelParameters& params, uint32_t max_packet_bytes,
+                                        bool& ok_to_drop) {
+    PacketDescriptor packet = fifo.pop_front();
+    queue_bytes -= packet.packet_length_bytes;
+    ok_to_drop = false;
+
+    core::TimestampNs sojourn_ns = now_ns > packet.enqueue_time_ns ? now_ns - packet.enqueue_time_ns : 0;
+    if (sojourn_ns < params.target_ns || queue_bytes <= max_packet_bytes) {
+        // Delay is fine, or too little is queued for a drop to help.
+        first_above_time_ns_ = 0;
+    } else if (first_above_time_ns_ == 0) {
+        // Above target: start the interval the delay must stay above it for.
+        first_above_time_ns_ = now_ns + params.interval_ns;
+    } else if (now_ns >= first_above_time_ns_) {
+        ok_to_drop = true;
+    }
+    return packet;
+}
+
+PacketDescriptor CoDelControl::dequeue(PacketQueue& fifo, uint32_t& queue_bytes, core::TimestampNs now_ns,
+                                       const CoDelParameters& params, uint32_t max_packet_bytes,
+                                       uint64_t& dropped) {
+    HQTS_PROFILE_STAGE(core::ProfileStage::AQM); // The head pop and the drop decisions
+    bool ok_to_drop = false;
+    PacketDescriptor packet = pop_head(fifo, queue_bytes, now_ns, params, max_packet_bytes, ok_to_drop);
+    // ok_to_drop implies more than max_packet_bytes are still queued, so every drop
+    // below is followed by a packet to return.
+
+    if (dropping_) {
+        if (!ok_to_drop) {
+            dropping_ = false; // Sojourn time fell below target: leave the dropping state
+            return packet;
+        }
+        while (dropping_ && now_ns >= drop_next_ns_) {
+            core::PacketBufferPool::release_any(packet.buffer);
+            ++dropped;
+            ++count_;
+            newton_step();
+            packet = pop_head(fifo, queue_bytes, now_ns, params, max_packet_bytes, ok_to_drop);
+            if (!ok_to_drop) {
+                dropping_ = false;
+            } else {
+                drop_next_ns_ = control_law(drop_next_ns_, params);
+            }
+        }
+        return packet;
+    }
+
+    if (ok_to_drop) {
+        // Enter the dropping state with one drop.
+        core::PacketBufferPool::release_any(packet.buffer);
+        ++dropped;
+        packet = pop_head(fifo, queue_bytes, now_ns, params, max_packet_bytes, ok_to_drop);
+        dropping_ = true;
+
+        // Resuming soon after the last dropping state: continue near its drop rate.
+        uint32_t delta = count_ - last_count_;
+        bool recent = now_ns < drop_next_ns_ || now_ns - drop_next_ns_ < 16 * params.interval_ns;
+        if (delta > 1 && recent) {
+            count_ = delta;
+            newton_step();
+        } else {
+            count_ = 1;
+            rec_inv_sqrt_ = Q32_ALMOST_ONE;
+        }
+        last_count_ = count_;
+        drop_next_ns_ = control_law(now_ns, params);
+    }
+    return packet;
+}
+
+// --- CoDelQueue ---
+
+CoDelQueue::CoDelQueue(const CoDelParameters& params, std::shared_ptr<PacketDescriptorPool> descriptor_pool)
+    : packet_buffer_(descriptor_pool ? std::move(descriptor_pool)
+                                     : PacketDescriptorPool::create_for_bytes(params.queue_capacity_bytes)),
+      params_(params) {}
+
+bool CoDelQueue::enqueue(PacketDescriptor packet) {
+    return enqueue(packet, core::steady_now_ns());
+}
+
+bool CoDelQueue::enqueue(PacketDescriptor packet, core::TimestampNs now_ns) {
+    if (current_total_bytes_ + packet.packet_length_bytes > params_.queue_capacity_bytes) {
+        core::PacketBufferPool::release_any(packet.buffer);
+        ++dropped_packets_;
+        return false;
+    }
+    packet.enqueue_time_ns = now_ns;
+    if (!packet_buffer_.push_back(packet)) {
+        // Shared descriptor pool exhausted: tail drop.
+        core::PacketBufferPool::release_any(packet.buffer);
+        ++dropped_packets_;
+        return false;
+    }
+    current_total_bytes_ += packet.packet_length_bytes;
+    if (packet.packet_length_bytes > max_packet_bytes_) {
+        max_packet_bytes_ = packet.packet_length_bytes;
+    }
+    return true;
+}
+
+PacketDescriptor CoDelQueue::dequeue() {
+    return dequeue(core::steady_now_ns());
+}
+
+PacketDescriptor CoDelQueue::dequeue(core::TimestampNs now_ns) {
+    if (is_empty()) {
+        throw std::runtime_error("CoDelQueue: Queue is empty, cannot dequeue.");
+    }
+    return control_.dequeue(packet_buffer_, current_total_bytes_, now_ns, params_, max_packet_bytes_,
+                            dropped_packets_);
+}
+
+const PacketDescriptor& CoDelQueue::front() const {
+    if (is_empty()) {
+        throw std::runtime_error("CoDelQueue: front() called on empty queue.");
+    }
+    return packet_buffer_.front();
+}
+
+// --- FqCoDelQueue ---
+
+FqCoDelQueue::FqCoDelQueue(const FqCoDelParameters& params, std::shared_ptr<PacketDescriptorPool> descriptor_pool)
+    : params_(params) {
+    if (!descriptor_pool) {
+        descriptor_pool = PacketDescriptorPool::create_for_bytes(params.codel.queue_capacity_bytes);
+    }
+    flows_.reserve(params.flow_queues);
+    for (uint32_t i = 0; i < params.flow_queues; ++i) {
+        flows_.emplace_back();
+        flows_.back().packets = PacketQueue(descriptor_pool);
+    }
+}
+
+size_t FqCoDelQueue::flow_queue_index(core::FlowId flow_id) const {
+    // Multiplicative mix, then a multiply-shift range reduction (no modulo).
+    uint64_t mixed = (static_cast<uint64_t>(flow_id) * 0x9E3779B97F4A7C15ULL) >> 32;
+    return static_cast<size_t>((mixed * params_.flow_queues) >> 32);
+}
+
+void FqCoDelQueue::push_tail(FlowList& list, uint8_t list_id, uint32_t index) {
+    FlowQueue& flow = flows_[index];
+    flow.next = NO_FLOW;
+    flow.list = list_id;
+    if (list.tail == NO_FLOW) {
+        list.head = index;
+    } else {
+        flows_[list.tail].next = index;
+    }
+    list.tail = index;
+}
+
+uint32_t FqCoDelQueue::pop_head(FlowList& list) {
+    uint32_t index = list.head;
+    FlowQueue& flow = flows_[index];
+    list.head = flow.next;
+    if (list.head == NO_FLOW) {
+        list.tail = NO_FLOW;
+    }
+    flow.next = NO_FLOW;
+    flow.list = LIST_NONE;
+    return index;
+}
+
+void FqCoDelQueue::select_next() {
+    for (;;) {
+        bool from_new = !new_flows_.empty();
+        FlowList& list = from_new ? new_flows_ : old_flows_;
+        if (list.empty()) {
+            return;
+        }
+        FlowQueue& flow = flows_[list.head];
+        if (flow.deficit <= 0) {
+            // Turn over: a new quantum, and the flow joins the old flows.
+            flow.deficit += params_.quantum_bytes;
+            push_tail(old_flows_, LIST_OLD_FLOWS, pop_head(list));
+            continue;
+        }
+        if (flow.packets.empty()) {
+            // A new flow that emptied goes through the old list once, so that a flow
+            // cannot regain new-flow priority by sending one packet at a time.
+            uint32_t index = pop_head(list);
+            if (from_new && !old_flows_.empty()) {
+                push_tail(old_flows_, LIST_OLD_FLOWS, index);
+            }
+            continue;
+        }
+        return;
+    }
+}
+
+void FqCoDelQueue::drop_from_longest() {
+    uint32_t longest = NO_FLOW;
+    for (const FlowList* list : {&new_flows_, &old_flows_}) {
+        for (uint32_t index = list->head; index != NO_FLOW; index = flows_[index].next) {
+            if (longest == NO_FLOW || flows_[index].bytes > flows_[longest].bytes) {
+                longest = index;
+            }
+        }
+    }
+    FlowQueue& flow = flows_[longest];
+    PacketDescriptor packet = flow.packets.pop_front();
+    flow.bytes -= packet.packet_length_bytes;
+    current_total_bytes_ -= packet.packet_length_bytes;
+    --total_packets_;
+    ++dropped_packets_;
+    core::PacketBufferPool::release_any(packet.buffer);
+}
+
+bool FqCoDelQueue::enqueue(PacketDescriptor packet) {
+    return enqueue(packet, core::steady_now_ns());
+}
+
+bool FqCoDelQueue::enqueue(PacketDescriptor packet, core::TimestampNs now_ns) {
+    if (packet.packet_length_bytes > params_.codel.queue_capacity_bytes) {
+        core::PacketBufferPool::release_any(packet.buffer);
+        ++dropped_packets_;
+        return false;
+    }
+    // Make room at the expense of the flow occupying the most bytes.
+    while (current_total_bytes_ + packet.packet_length_bytes > params_.codel.queue_capacity_bytes) {
+        drop_from_longest();
+    }
+
+    uint32_t index = static_cast<uint32_t>(flow_queue_index(packet.flow_id));
+    FlowQueue& flow = flows_[index];
+    packet.enqueue_time_ns = now_ns;
+    if (!flow.packets.push_back(packet)) {
+        core::PacketBufferPool::release_any(packet.buffer); // Shared descriptor pool exhausted
+        ++dropped_packets_;
+        select_next();
+        return false;
+    }
+    flow.bytes += packet.packet_length_bytes;
+    current_total_bytes_ += packet.packet_length_bytes;
+    ++total_packets_;
+    if (packet.packet_length_bytes > max_packet_bytes_) {
+        max_packet_bytes_ = packet.packet_length_bytes;
+    }
+    if (flow.list == LIST_NONE) {
+        flow.deficit = params_.quantum_bytes;
+        push_tail(new_flows_, LIST_NEW_FLOWS, index);
+    }
+    select_next();
+    return true;
+}
+
+PacketDescriptor FqCoDelQueue::dequeue() {
+    return dequeue(core::steady_now_ns());
+}
+
+PacketDescriptor FqCoDelQueue::dequeue(core::TimestampNs now_ns) {
+    if (is_empty()) {
+        throw std::runtime_error("FqCoDelQueue: Queue is empty, cannot dequeue.");
+    }
+    // select_next() left a backlogged flow with a positive deficit at the head.
+    FlowQueue& flow = flows_[!new_flows_.empty() ? new_flows_.head : old_flows_.head];
+    size_t packets_before = flow.packets.size();
+    uint32_t bytes_before = flow.bytes;
+    PacketDescriptor packet = flow.control.dequeue(flow.packets, flow.bytes, now_ns, params_.codel,
+                                                   max_packet_bytes_, dropped_packets_);
+    total_packets_ -= packets_before - flow.packets.size();
+    current_total_bytes_ -= bytes_before - flow.bytes;
+    flow.deficit -= packet.packet_length_bytes;
+    select_next();
+    return packet;
+}
+
+const PacketDescriptor& FqCoDelQueue::front() const {
+    if (is_empty()) {
+        throw std::runtime_error("FqCoDelQueue: front() called on empty queue.");
+    }
+    const FlowQueue& flow = flows_[!new_flows_.empty() ? new_flows_.head : old_flows_.head];
+    return flow.packets.front();
+}
+
+} // namespace scheduler
+} // namespace hqts
@@ -1,17 +1,28 @@
 #include "hqts/scheduler/drr_scheduler.h"
-#include "hqts/scheduler/aqm_queue.h" // For RedAqmParameters
+#include "hqts/scheduler/any_aqm_queue.h" // For AqmParameters
+#include "hqts/core/packet_buffer_pool.h"  // For PacketBufferPool::release_any
 #include <string> // For std::to_string in error messages
 #include <stdexcept> // For exceptions
 
 namespace hqts {
 namespace scheduler {
 
-DrrScheduler::DrrScheduler(const std::vector<QueueConfig>& queue_configs)
-    : current_queue_index_(0), total_packets_(0), is_configured_(false) {
+DrrScheduler::DrrScheduler(const std::vector<QueueConfig>& queue_configs,
+                           std::shared_ptr<PacketDescriptorPool> descriptor_pool)
+    : active_head_(NO_QUEUE), active_tail_(NO_QUEUE), total_packets_(0) {
+    index_by_priority_.fill(NO_QUEUE);
     if (queue_configs.empty()) {
         throw std::invalid_argument("DRR Scheduler: queue_configs cannot be empty.");
     }
 
+    if (!descriptor_pool) {
+        uint64_t aggregate_capacity_bytes = 0;
+        for (const auto& qc : queue_configs) {
+            aggregate_capacity_bytes += aqm_queue_capacity_bytes(qc.aqm_params);
+        }
+        descriptor_pool = PacketDescriptorPool::create_for_bytes(aggregate_capacity_bytes);
+    }
+
     queues_.reserve(queue_configs.size());
     for (size_t i = 0; i < queue_configs.size(); ++i) {
         const auto& qc = queue_configs[i];
@@ -22,103 +33,126 @@ DrrScheduler::DrrScheduler(const std::vector<QueueConfig>& queue_configs)
             throw std::invalid_argument("DRR Scheduler: Duplicate QueueId " + std::to_string(qc.id) + " in configuration.");
         }
 
-        // Use the updated InternalQueueState constructor that takes RedAqmParameters
-        queues_.emplace_back(qc.id, qc.quantum_bytes, qc.aqm_params);
+        queues_.emplace_back(qc.id, qc.quantum_bytes, qc.aqm_params, descriptor_pool);
         // Deficit counter for each queue starts at 0 (handled by InternalQueueState constructor).
         queue_id_to_index_[qc.id] = i;
+        if (qc.id < index_by_priority_.size()) {
+            index_by_priority_[qc.id] = i; // Reachable from PacketDescriptor::priority
+        }
     }
-    is_configured_ = true;
 }
 
-void DrrScheduler::enqueue(PacketDescriptor packet) {
-    if (!is_configured_) {
-        throw std::logic_error("DRR Scheduler: Not configured. Call constructor with queue configurations.");
+EnqueueResult DrrScheduler::enqueue(PacketDescriptor packet) {
+    // PacketDescriptor::priority is the QueueId: a direct lookup, no map search.
+    size_t index = index_by_priority_[packet.priority];
+    if (index == NO_QUEUE) {
+        core::PacketBufferPool::release_any(packet.buffer);
+        return EnqueueResult::DROPPED_NO_QUEUE;
     }
 
-    core::QueueId target_queue_external_id = static_cast<core::QueueId>(packet.priority);
-
-    auto it = queue_id_to_index_.find(target_queue_external_id);
-    if (it == queue_id_to_index_.end()) {
-        throw std::out_of_range("DRR Scheduler: QueueId " + std::to_string(target_queue_external_id) +
-                                " (from packet.priority) not configured for this scheduler.");
+    // Enqueue into the AQM queue; increment total_packets_ only if successful
+    InternalQueueState& q_state = queues_[index];
+    if (!q_state.packet_queue.enqueue(std::move(packet))) {
+        return EnqueueResult::DROPPED_BY_QUEUE; // Dropped by AQM, total_packets_ not incremented
     }
-
-    // Enqueue into RedAqmQueue; increment total_packets_ only if successful
-    if (queues_[it->second].packet_queue.enqueue(std::move(packet))) {
-        total_packets_++;
+    total_packets_++;
+    if (!q_state.is_active) {
+        push_active(index); // Newly backlogged: joins the round at the tail
     }
-    // If RedAqmQueue::enqueue returns false, packet was dropped by AQM, total_packets_ not incremented.
+    return EnqueueResult::ENQUEUED;
 }
 
-PacketDescriptor DrrScheduler::dequeue() {
-    if (!is_configured_) {
-        throw std::logic_error("DRR Scheduler: Not configured.");
-    }
-    if (is_empty()) {
-        throw std::runtime_error("DRR Scheduler: Scheduler is empty, cannot dequeue.");
+std::optional<PacketDescriptor> DrrScheduler::try_dequeue() {
+    if (total_packets_ == 0) {
+        return std::nullopt;
     }
 
-    size_t num_queues = queues_.size();
-    size_t search_attempts = 0; // To prevent potential infinite loops in unforeseen edge cases
-
-    while (search_attempts < num_queues * 2) { // Allow cycling through queues multiple times if needed
-        InternalQueueState& current_q_state = queues_[current_queue_index_];
-
-        if (!current_q_state.packet_queue.is_empty()) {
-            // Add quantum for this service opportunity if it's the start of its "turn"
-            // or if its deficit was previously too low for the front packet.
-            // A common DRR adds quantum when the queue is selected and non-empty.
-            current_q_state.deficit_counter += static_cast<int64_t>(current_q_state.quantum_bytes);
-
-            // Service as many packets as current deficit allows from this queue
-            // (Standard DRR services one packet if deficit allows, then moves to next queue in active list.
-            //  More aggressive DRR might send multiple. This implementation sends one then moves.)
-            if (!current_q_state.packet_queue.is_empty() && // Re-check, could be empty if last packet just sent
-                current_q_state.deficit_counter >= current_q_state.packet_queue.front().packet_length_bytes) {
-
-                uint32_t packet_len = current_q_state.packet_queue.front().packet_length_bytes;
-                PacketDescriptor packet_to_send = current_q_state.packet_queue.dequeue(); // Dequeue also removes
-
-                current_q_state.deficit_counter -= packet_len;
-                total_packets_--;
+    // Every queue in the active list is backlogged, so each iteration either sends a packet
+    // or ends a turn that added a quantum; with quanta >= packet sizes it sends on the first.
+    for (;;) {
+        InternalQueueState& q_state = queues_[active_head_];
+        if (!q_state.quantum_granted) {
+            q_state.deficit_counter += static_cast<int64_t>(q_state.quantum_bytes);
+            q_state.quantum_granted = true;
+        }
 
-                current_queue_index_ = (current_queue_index_ + 1) % num_queues;
-                return packet_to_send;
+        uint32_t packet_len = q_state.packet_queue.front().packet_length_bytes;
+        if (q_state.deficit_counter >= static_cast<int64_t>(packet_len)) {
+            size_t queued_before = q_state.packet_queue.get_current_packet_count();
+            PacketDescriptor packet_to_send = q_state.packet_queue.dequeue();
+            // CoDel may drop the packet peeked at and send a later one: charge what is sent.
+            q_state.deficit_counter -= packet_to_send.packet_length_bytes;
+            total_packets_ -= queued_before - q_state.packet_queue.get_current_packet_count();
+            if (q_state.packet_queue.is_empty()) {
+                // Leaves the round; an idle queue does not keep its unused deficit.
+                pop_active();
+                q_state.deficit_counter = 0;
             }
+            // Otherwise the queue stays at the head and continues its turn on the next call.
+            return packet_to_send;
         }
 
-        // Move to the next queue
-        current_queue_index_ = (current_queue_index_ + 1) % num_queues;
-        search_attempts++;
+        // Deficit too small for the front packet: end of turn, deficit carries over.
+        size_t idx = pop_active();
+        push_active(idx);
+    }
+}
+
+void DrrScheduler::push_active(size_t internal_idx) {
+    InternalQueueState& q_state = queues_[internal_idx];
+    q_state.next_active = NO_QUEUE;
+    q_state.is_active = true;
+    q_state.quantum_granted = false;
+    if (active_tail_ == NO_QUEUE) {
+        active_head_ = internal_idx;
+    } else {
+        queues_[active_tail_].next_active = internal_idx;
     }
+    active_tail_ = internal_idx;
+}
 
-    // If this point is reached, it means after several full scans, no packet could be dequeued
-    // even though is_empty() was false. This implies all remaining packets are too large for
-    // their queues' deficit (even after adding quantum) or some other logic error.
-    // The deficit carries over, so subsequent calls should eventually allow sending.
-    // However, to break a potential live-lock in a test or unforeseen scenario:
-    if (total_packets_ > 0) { // Check again, as state might have changed for re-entrant calls (not expected here)
-         throw std::logic_error("DRR Scheduler: Exceeded search cycles. No suitable packet found despite scheduler not being empty. Possible issue with packet sizes vs quanta or internal state.");
+size_t DrrScheduler::pop_active() {
+    size_t idx = active_head_;
+    InternalQueueState& q_state = queues_[idx];
+    active_head_ = q_state.next_active;
+    if (active_head_ == NO_QUEUE) {
+        active_tail_ = NO_QUEUE;
     }
-    // If total_packets_ somehow became 0 during the loop (e.g. by another thread not an issue here)
-    // then throw the standard empty error.
-    throw std::runtime_error("DRR Scheduler: Scheduler became empty during dequeue search (unexpected).");
+    q_state.next_active = NO_QUEUE;
+    q_state.is_active = false;
+    return idx;
 }
 
 
 bool DrrScheduler::is_empty() const {
-    if (!is_configured_) {
-        // Consider if an unconfigured scheduler should be treated as empty or throw.
-        // Returning true if not configured prevents operations on an invalid state.
-        return true;
-    }
     return total_packets_ == 0;
 }
 
-size_t DrrScheduler::get_queue_size(core::QueueId queue_id) const {
-    if (!is_configured_) {
-        throw std::logic_error("DRR Scheduler: Not configured.");
+size_t DrrScheduler::enqueue_burst(PacketDescriptor* packets, size_t count) {
+    size_t enqueued = 0;
+    for (size_t i = 0; i < count; ++i) {
+        // Qualified call: no per-packet virtual dispatch
+        if (DrrScheduler::enqueue(std::move(packets[i])) == EnqueueResult::ENQUEUED) {
+            ++enqueued;
+        }
     }
+    return enqueued;
+}
+
+size_t DrrScheduler::dequeue_burst(std::vector<PacketDescriptor>& out, size_t max_packets) {
+    size_t dequeued = 0;
+    while (dequeued < max_packets) {
+        std::optional<PacketDescriptor> packet = DrrScheduler::try_dequeue();
+        if (!packet) {
+            break;
+        }
+        out.push_back(*packet);
+        ++dequeued;
+    }
+    return dequeued;
+}
+
+size_t DrrScheduler::get_queue_size(core::QueueId queue_id) const {
     auto it = queue_id_to_index_.find(queue_id);
     if (it == queue_id_to_index_.end()) {
         throw std::out_of_range("DRR Scheduler: QueueId " + std::to_string(queue_id) + " not configured.");
@@ -126,10 +160,29 @@ size_t DrrScheduler::get_queue_size(core::QueueId queue_id) const {
     return queues_[it->second].packet_queue.get_current_packet_count();
 }
 
-size_t DrrScheduler::get_num_queues() const {
-    if (!is_configured_) {
-        return 0; // Or throw std::logic_error("DRR Scheduler: Not configured.");
+void DrrScheduler::enable_latency_histograms() {
+    for (InternalQueueState& queue : queues_) {
+        queue.packet_queue.enable_latency_histogram();
     }
+}
+
+LatencySnapshot DrrScheduler::get_queue_latency(core::QueueId queue_id) const {
+    auto it = queue_id_to_index_.find(queue_id);
+    if (it == queue_id_to_index_.end()) {
+        throw std::out_of_range("DRR Scheduler: QueueId " + std::to_string(queue_id) + " not configured.");
+    }
+    const LatencyHistogram* histogram = queues_[it->second].packet_queue.latency_histogram();
+    return histogram != nullptr ? histogram->snapshot() : LatencySnapshot();
+}
+
+size_t DrrScheduler::collect_queue_stats(std::vector<QueueStatsSample>& out) const {
+    for (const InternalQueueState& queue : queues_) {
+        out.push_back(queue.packet_queue.stats_sample(queue.external_id));
+    }
+    return queues_.size();
+}
+
+size_t DrrScheduler::get_num_queues() const {
     return queues_.size();
 }
 
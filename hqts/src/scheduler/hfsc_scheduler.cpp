@@ -1,393 +1,493 @@
 #include "hqts/scheduler/hfsc_scheduler.h"
-#include <limits>  // For std::numeric_limits
 #include <string>  // For std::to_string in error messages
-#include <algorithm> // For std::max
+#include <algorithm> // For std::max, std::min
 
 namespace hqts {
 namespace scheduler {
 
-// Private helper method
-uint64_t HfscScheduler::calculate_packet_service_time_us(uint32_t packet_length_bytes, const ServiceCurve& sc) const { // Made const
-    if (sc.rate_bps == 0) {
-        return std::numeric_limits<uint64_t>::max();
-    }
-    return (static_cast<uint64_t>(packet_length_bytes) * 8 * 1000000) / sc.rate_bps;
-}
+namespace {
 
-// New private helper method for updating flow schedule
-void HfscScheduler::update_flow_schedule(core::FlowId flow_id, bool is_newly_active) {
-    HfscFlowState& flow_state = flow_states_.at(flow_id); // Assume flow_id is valid
-    if (flow_state.packet_queue.empty()) {
-        return; // Nothing to schedule
-    }
+constexpr uint64_t INFINITE_TIME = CurveSlope::INFINITE;
+constexpr uint64_t IMPLICIT_LINK_SHARE_BPS = 1000000000; // Used when the link rate is 0
 
-    uint32_t packet_len_bytes = flow_state.packet_queue.front().packet_length_bytes;
-    uint64_t base_eligible_time;
+} // namespace
 
-    if (is_newly_active) {
-        // For a newly active flow, eligibility is based on its previous (possibly 0) finish time
-        // or the current scheduler virtual time, whichever is later.
-        base_eligible_time = std::max(current_virtual_time_, flow_state.virtual_finish_time);
-    } else {
-        // For a flow that just had a packet dequeued, its next packet's eligibility
-        // starts from the current scheduler virtual time (which is the VFT of the dequeued packet).
-        base_eligible_time = current_virtual_time_;
-    }
+// --- HfscScheduler ---
 
-    // 1. Calculate RT/LS chosen eligible time and VFT for the flow itself
-    uint64_t chosen_eligible_time_self = 0;
-    uint64_t chosen_vft_self = std::numeric_limits<uint64_t>::max();
-    uint64_t service_time_self = std::numeric_limits<uint64_t>::max();
+HfscScheduler::HfscScheduler(const std::vector<FlowConfig>& flow_configs, uint64_t total_link_bandwidth_bps,
+                             std::shared_ptr<PacketDescriptorPool> descriptor_pool)
+    : total_link_bandwidth_bps_(total_link_bandwidth_bps),
+      link_slope_(total_link_bandwidth_bps),
+      link_time_ns_(0),
+      total_packets_(0) {
 
-    bool rt_self_valid = flow_state.real_time_sc.rate_bps > 0;
-    bool ls_self_valid = flow_state.link_share_sc.rate_bps > 0;
+    if (flow_configs.empty()) {
+        throw std::invalid_argument("HFSC Scheduler: flow_configs cannot be empty.");
+    }
 
-    uint64_t eligible_time_rt_self = base_eligible_time + flow_state.real_time_sc.delay_us;
-    uint64_t vft_rt_self = eligible_time_rt_self + calculate_packet_service_time_us(packet_len_bytes, flow_state.real_time_sc);
+    leaf_by_priority_.fill(NO_CLASS);
+    classes_.emplace_back(); // Root
+    children_by_vt_.emplace_back();
 
-    uint64_t eligible_time_ls_self = base_eligible_time + flow_state.link_share_sc.delay_us;
-    uint64_t vft_ls_self = eligible_time_ls_self + calculate_packet_service_time_us(packet_len_bytes, flow_state.link_share_sc);
+    classes_.reserve(flow_configs.size() + 1);
+    children_by_vt_.resize(flow_configs.size() + 1);
+    index_by_id_.reserve(flow_configs.size());
 
-    if (rt_self_valid && ls_self_valid) {
-        if (vft_rt_self <= vft_ls_self) {
-            chosen_vft_self = vft_rt_self;
-            chosen_eligible_time_self = eligible_time_rt_self;
-        } else {
-            chosen_vft_self = vft_ls_self;
-            chosen_eligible_time_self = eligible_time_ls_self;
+    for (const auto& fc : flow_configs) {
+        if (fc.id == fc.parent_id && fc.id != 0) { // Check for self-parenting, assuming 0 means no parent
+             throw std::invalid_argument("HFSC Scheduler: FlowId " + std::to_string(fc.id) + " cannot be its own parent.");
+        }
+        uint32_t index = static_cast<uint32_t>(classes_.size());
+        if (!index_by_id_.emplace(fc.id, index).second) {
+            throw std::invalid_argument("HFSC Scheduler: Duplicate FlowId " + std::to_string(fc.id) + " in configuration.");
         }
-    } else if (rt_self_valid) {
-        chosen_vft_self = vft_rt_self;
-        chosen_eligible_time_self = eligible_time_rt_self;
-    } else if (ls_self_valid) {
-        chosen_vft_self = vft_ls_self;
-        chosen_eligible_time_self = eligible_time_ls_self;
-    }
 
-    if (chosen_vft_self != std::numeric_limits<uint64_t>::max()) {
-        service_time_self = chosen_vft_self - chosen_eligible_time_self;
+        ClassState state;
+        state.id = fc.id;
+        state.queue_capacity_bytes = fc.queue_capacity_bytes;
+        state.real_time_sc = fc.real_time_sc;
+        state.link_share_sc = fc.link_share_sc;
+        state.upper_limit_sc = fc.upper_limit_sc;
+        classes_.push_back(std::move(state));
     }
 
-    // 2. Apply UL constraint for the flow itself
-    uint64_t final_eligible_time_self = chosen_eligible_time_self;
-    uint64_t final_vft_self = chosen_vft_self;
-
-    if (flow_state.upper_limit_sc.rate_bps > 0) {
-        uint64_t eligible_time_ul_self_candidate = std::max(base_eligible_time, flow_state.virtual_finish_time_ul) + flow_state.upper_limit_sc.delay_us;
-        final_eligible_time_self = std::max(chosen_eligible_time_self, eligible_time_ul_self_candidate);
-
-        if (chosen_vft_self != std::numeric_limits<uint64_t>::max()) {
-            final_vft_self = final_eligible_time_self + service_time_self;
-        } else { // No valid RT/LS, so only UL could apply if it could grant eligibility (not standard HFSC)
-            // For now, if RT/LS is not valid, this flow does not become eligible from its own curves.
-            // This means final_vft_self remains max unless RT/LS was valid.
+    // Resolve parent links, then validate that every chain reaches the root.
+    for (size_t i = 0; i < flow_configs.size(); ++i) {
+        const FlowConfig& fc = flow_configs[i];
+        uint32_t parent = ROOT_INDEX;
+        if (fc.parent_id != 0) { // Assuming 0 means no parent
+            auto parent_iter = index_by_id_.find(fc.parent_id);
+            if (parent_iter == index_by_id_.end()) {
+                throw std::invalid_argument("HFSC Scheduler: Parent FlowId " + std::to_string(fc.parent_id) + " not found in configuration.");
+            }
+            parent = parent_iter->second;
         }
+        classes_[i + 1].parent = parent;
+        classes_[parent].num_children++;
     }
-
-    // 3. Consider parent constraints (for a two-level hierarchy)
-    uint64_t final_eligible_time = final_eligible_time_self;
-    uint64_t final_vft = final_vft_self;
-
-    if (flow_state.parent_id != 0) { // Assuming 0 is NO_PARENT_HFSC_FLOW_ID
-        auto parent_iter = flow_states_.find(flow_state.parent_id);
-        if (parent_iter != flow_states_.end()) {
-            HfscFlowState& parent_state = parent_iter->second;
-
-            // Parent's eligibility for this child's packet. Parent doesn't have its own queue.
-            // Base eligibility for parent is also tricky: is it based on its own previous VFT for *any* child, or current_VT?
-            // Let's assume it's similar to a flow: max(current_VT, parent_state.virtual_finish_time for its own (agg) service)
-            uint64_t parent_base_eligible_time = std::max(current_virtual_time_, parent_state.virtual_finish_time);
-
-            uint64_t eligible_time_rt_parent = parent_base_eligible_time + parent_state.real_time_sc.delay_us;
-            uint64_t vft_rt_parent = eligible_time_rt_parent + calculate_packet_service_time_us(packet_len_bytes, parent_state.real_time_sc);
-
-            uint64_t eligible_time_ls_parent = parent_base_eligible_time + parent_state.link_share_sc.delay_us;
-            uint64_t vft_ls_parent = eligible_time_ls_parent + calculate_packet_service_time_us(packet_len_bytes, parent_state.link_share_sc);
-
-            uint64_t chosen_vft_parent = std::numeric_limits<uint64_t>::max();
-            uint64_t chosen_eligible_time_parent = 0;
-
-            bool rt_parent_valid = parent_state.real_time_sc.rate_bps > 0;
-            bool ls_parent_valid = parent_state.link_share_sc.rate_bps > 0;
-
-            if (rt_parent_valid && ls_parent_valid) {
-                if (vft_rt_parent <= vft_ls_parent) {
-                    chosen_vft_parent = vft_rt_parent; chosen_eligible_time_parent = eligible_time_rt_parent;
-                } else {
-                    chosen_vft_parent = vft_ls_parent; chosen_eligible_time_parent = eligible_time_ls_parent;
-                }
-            } else if (rt_parent_valid) {
-                chosen_vft_parent = vft_rt_parent; chosen_eligible_time_parent = eligible_time_rt_parent;
-            } else if (ls_parent_valid) {
-                chosen_vft_parent = vft_ls_parent; chosen_eligible_time_parent = eligible_time_ls_parent;
+    for (uint32_t i = 1; i < classes_.size(); ++i) {
+        uint32_t ancestor = classes_[i].parent;
+        for (size_t steps = 0; ancestor != ROOT_INDEX; ++steps) {
+            if (steps == classes_.size()) {
+                throw std::invalid_argument("HFSC Scheduler: FlowId " + std::to_string(classes_[i].id) +
+                                            " is part of a parent cycle.");
             }
+            ancestor = classes_[ancestor].parent;
+        }
+    }
 
-            uint64_t final_eligible_time_parent = chosen_eligible_time_parent;
-            if (parent_state.upper_limit_sc.rate_bps > 0) {
-                 uint64_t eligible_time_ul_parent_cand = std::max(parent_base_eligible_time, parent_state.virtual_finish_time_ul) + parent_state.upper_limit_sc.delay_us;
-                 final_eligible_time_parent = std::max(chosen_eligible_time_parent, eligible_time_ul_parent_cand);
+    if (!descriptor_pool) {
+        uint64_t aggregate_capacity_bytes = 0;
+        for (uint32_t i = 1; i < classes_.size(); ++i) {
+            if (classes_[i].is_leaf()) {
+                aggregate_capacity_bytes += classes_[i].queue_capacity_bytes;
             }
+        }
+        descriptor_pool = PacketDescriptorPool::create_for_bytes(aggregate_capacity_bytes);
+    }
 
-            // The child's final eligibility is constrained by parent's final eligibility for this packet
-            final_eligible_time = std::max(final_eligible_time_self, final_eligible_time_parent);
-            // The VFT is this new eligible time + the child's own service time (as parent doesn't add to service time, only start time)
-            if (service_time_self != std::numeric_limits<uint64_t>::max()) {
-                 final_vft = final_eligible_time + service_time_self;
-            } else { // Child itself has no valid curve, so it cannot be scheduled.
-                 final_vft = std::numeric_limits<uint64_t>::max();
+    const uint64_t implicit_ls_bps = total_link_bandwidth_bps_ > 0 ? total_link_bandwidth_bps_ : IMPLICIT_LINK_SHARE_BPS;
+    for (uint32_t i = 1; i < classes_.size(); ++i) {
+        ClassState& state = classes_[i];
+        if (state.is_leaf()) {
+            if (state.real_time_sc.rate_bps == 0 && state.link_share_sc.rate_bps == 0) {
+                // Such a leaf could never be served: reject it here instead of in dequeue.
+                throw std::invalid_argument("HFSC Scheduler: Leaf FlowId " + std::to_string(state.id) +
+                                            " has neither a real-time nor a link-share curve.");
             }
+            state.packet_queue = PacketQueue(descriptor_pool);
+            state.has_rt = state.real_time_sc.rate_bps > 0;
+            if (state.id <= UINT8_MAX) {
+                leaf_by_priority_[state.id] = i;
+            }
+        } else if (state.link_share_sc.rate_bps == 0) {
+            state.link_share_sc = ServiceCurve(implicit_ls_bps, 0);
         }
+        state.has_ls = state.link_share_sc.rate_bps > 0;
+        state.has_ul = state.upper_limit_sc.rate_bps > 0;
+        state.real_time_isc = InternalServiceCurve(state.real_time_sc);
+        state.link_share_isc = InternalServiceCurve(state.link_share_sc);
+        state.upper_limit_isc = InternalServiceCurve(state.upper_limit_sc);
     }
+}
 
-    // 4. Update flow state and add to eligible set
-    if (final_vft != std::numeric_limits<uint64_t>::max()) {
-        flow_state.virtual_start_time = final_eligible_time;
-        flow_state.virtual_finish_time = final_vft;
+uint64_t HfscScheduler::transmission_time_ns(uint32_t packet_length_bytes) const {
+    return total_link_bandwidth_bps_ == 0 ? 0 : link_slope_.time_for(packet_length_bytes);
+}
 
-        if (flow_state.upper_limit_sc.rate_bps > 0) {
-             // This update is for the UL VFT of the current packet being scheduled.
-             flow_state.virtual_finish_time_ul = final_eligible_time + calculate_packet_service_time_us(packet_len_bytes, flow_state.upper_limit_sc);
-        }
-        eligible_set_.push({final_vft, flow_id});
-    }
+uint32_t HfscScheduler::find_class_index(core::FlowId class_id) const {
+    auto it = index_by_id_.find(class_id);
+    return it == index_by_id_.end() ? NO_CLASS : it->second;
 }
 
+EnqueueResult HfscScheduler::enqueue(PacketDescriptor packet) {
+    // leaf_by_priority_ holds every leaf addressable by priority; anything else is an
+    // interior class or not configured at all.
+    return enqueue_to_index(leaf_by_priority_[packet.priority], std::move(packet));
+}
 
-HfscScheduler::HfscScheduler(const std::vector<FlowConfig>& flow_configs, uint64_t total_link_bandwidth_bps)
-    : total_link_bandwidth_bps_(total_link_bandwidth_bps),
-      current_virtual_time_(0),
-      total_packets_(0),
-      is_configured_(false) {
+EnqueueResult HfscScheduler::enqueue_to_class(core::FlowId class_id, PacketDescriptor packet) {
+    uint32_t index = find_class_index(class_id);
+    if (index != NO_CLASS && !classes_[index].is_leaf()) {
+        index = NO_CLASS; // Interior classes hold no packets
+    }
+    return enqueue_to_index(index, std::move(packet));
+}
 
-    if (total_link_bandwidth_bps_ == 0) {
-        // Allow, but scheduler won't do much.
+EnqueueResult HfscScheduler::enqueue_to_index(uint32_t index, PacketDescriptor&& packet) {
+    if (index == NO_CLASS) {
+        core::PacketBufferPool::release_any(packet.buffer);
+        return EnqueueResult::DROPPED_NO_QUEUE;
+    }
+    ClassState& leaf = classes_[index];
+    bool was_empty = leaf.packet_queue.empty();
+    if (leaf.latency) {
+        packet.enqueue_time_ns = link_time_ns_;
     }
 
-    if (flow_configs.empty()) {
-        is_configured_ = false;
-        return;
+    if (leaf.queued_bytes + packet.packet_length_bytes > leaf.queue_capacity_bytes ||
+        !leaf.packet_queue.push_back(packet)) {
+        // Tail drop: per-flow byte limit reached or shared descriptor pool exhausted.
+        core::PacketBufferPool::release_any(packet.buffer);
+        return EnqueueResult::DROPPED_BY_QUEUE;
+    }
+    leaf.queued_bytes += packet.packet_length_bytes;
+    total_packets_++;
+
+    if (was_empty) {
+        activate(index, packet.packet_length_bytes);
     }
+    return EnqueueResult::ENQUEUED;
+}
 
-    // Temporary map to build parent-child relationships
-    std::map<core::FlowId, std::vector<core::FlowId>> parent_to_children_map;
+void HfscScheduler::activate(uint32_t leaf_index, uint32_t packet_length_bytes) {
+    ClassState& leaf = classes_[leaf_index];
+    const uint64_t now = link_time_ns_;
 
-    for (const auto& fc : flow_configs) {
-        if (flow_states_.count(fc.id)) {
-            throw std::invalid_argument("HFSC Scheduler: Duplicate FlowId " + std::to_string(fc.id) + " in configuration.");
+    if (leaf.has_rt) {
+        // Deadlines follow the RT curve re-anchored at (now, cumul) unless the old one is lower.
+        if (leaf.rt_curves_initialized) {
+            leaf.deadline_curve.min_with(leaf.real_time_isc, now, leaf.cumul_bytes);
+        } else {
+            leaf.deadline_curve.init(leaf.real_time_isc, now, leaf.cumul_bytes);
+            leaf.rt_curves_initialized = true;
         }
-        if (fc.id == fc.parent_id && fc.id != 0) { // Check for self-parenting, assuming 0 means no parent
-             throw std::invalid_argument("HFSC Scheduler: FlowId " + std::to_string(fc.id) + " cannot be its own parent.");
+        leaf.eligible_curve = leaf.deadline_curve;
+        if (!leaf.real_time_isc.concave) {
+            // Convex curve: eligible as soon as the long-term rate allows.
+            leaf.eligible_curve.dx_ns = 0;
+            leaf.eligible_curve.dy_bytes = 0;
         }
+        leaf.eligible_ns = leaf.eligible_curve.y2x(leaf.cumul_bytes);
+        leaf.deadline_ns = leaf.deadline_curve.y2x(leaf.cumul_bytes + packet_length_bytes);
+        leaf.rt_ready = false;
+        pending_rt_.push(classes_, leaf_index);
+    }
 
-        HfscFlowState new_flow_state(fc.id, fc.parent_id);
-        new_flow_state.real_time_sc = fc.real_time_sc;
-        new_flow_state.link_share_sc = fc.link_share_sc;
-        new_flow_state.upper_limit_sc = fc.upper_limit_sc;
-        new_flow_state.virtual_finish_time = 0;
-        new_flow_state.eligible_time = 0;
-        new_flow_state.virtual_finish_time_ul = 0;
-
-        flow_states_.emplace(fc.id, new_flow_state);
-
-        if (fc.parent_id != 0) { // Assuming 0 means no parent
-            parent_to_children_map[fc.parent_id].push_back(fc.id);
+    if (!leaf.has_ls) {
+        return;
+    }
+    // Join link-sharing at every level that was idle, starting from the parent's virtual
+    // clock so an idle period earns no credit over the siblings that kept sending.
+    for (uint32_t index = leaf_index; index != ROOT_INDEX; index = classes_[index].parent) {
+        ClassState& cls = classes_[index];
+        bool activated = false;
+        if (!cls.ls_active) {
+            ClassState& parent = classes_[cls.parent];
+            uint64_t start_vt = std::max(parent.child_vt_clock, cls.vt);
+            if (cls.ls_curves_initialized) {
+                cls.virtual_curve.min_with(cls.link_share_isc, start_vt, cls.total_bytes);
+                if (cls.has_ul) {
+                    cls.upper_limit_curve.min_with(cls.upper_limit_isc, now, cls.total_bytes);
+                }
+            } else {
+                cls.virtual_curve.init(cls.link_share_isc, start_vt, cls.total_bytes);
+                if (cls.has_ul) {
+                    cls.upper_limit_curve.init(cls.upper_limit_isc, now, cls.total_bytes);
+                }
+                cls.ls_curves_initialized = true;
+            }
+            cls.vt = std::max(start_vt, cls.virtual_curve.y2x(cls.total_bytes));
+            if (cls.has_ul) {
+                cls.fit_time_ns = cls.upper_limit_curve.y2x(cls.total_bytes);
+            }
+            cls.ls_active = true;
+            parent.active_children++;
+            activated = true;
+        }
+        if (!sync_link_share(index) && !activated) {
+            break; // Nothing above this level changes
         }
     }
+}
 
-    // Populate children_ids and validate parent existence
-    for (const auto& pair : parent_to_children_map) {
-        core::FlowId parent_id = pair.first;
-        const std::vector<core::FlowId>& children = pair.second;
-
-        auto parent_iter = flow_states_.find(parent_id);
-        if (parent_iter == flow_states_.end()) {
-            throw std::invalid_argument("HFSC Scheduler: Parent FlowId " + std::to_string(parent_id) + " not found in configuration.");
+bool HfscScheduler::sync_link_share(uint32_t index) {
+    ClassState& cls = classes_[index];
+    const bool fits = !cls.has_ul || cls.fit_time_ns <= link_time_ns_;
+    const bool want_in_parent = cls.ls_active && fits && (cls.is_leaf() || !children_by_vt_[index].empty());
+    const bool want_ul_wait = cls.ls_active && !fits;
+
+    bool membership_changed = false;
+    VirtualTimeHeap& siblings = children_by_vt_[cls.parent];
+    if (want_in_parent) {
+        if (cls.ls_heap_pos == NOT_IN_HEAP) {
+            siblings.push(classes_, index);
+            membership_changed = true;
+        } else {
+            siblings.update(classes_, index);
         }
-        parent_iter->second.children_ids = children;
+    } else if (cls.ls_heap_pos != NOT_IN_HEAP) {
+        siblings.erase(classes_, index);
+        membership_changed = true;
     }
 
-    is_configured_ = !flow_configs.empty();
+    if (want_ul_wait) {
+        if (cls.ul_heap_pos == NOT_IN_HEAP) {
+            ul_wait_.push(classes_, index);
+        } else {
+            ul_wait_.update(classes_, index);
+        }
+    } else if (cls.ul_heap_pos != NOT_IN_HEAP) {
+        ul_wait_.erase(classes_, index);
+    }
+    return membership_changed;
 }
 
-void HfscScheduler::enqueue(PacketDescriptor packet) {
-    if (!is_configured_) {
-        throw std::logic_error("HFSC Scheduler: Not configured or no flows defined. Cannot enqueue.");
+void HfscScheduler::sync_path(uint32_t index) {
+    for (; index != ROOT_INDEX; index = classes_[index].parent) {
+        sync_link_share(index);
     }
+}
 
-    core::FlowId target_flow_id = static_cast<core::FlowId>(packet.priority);
-    auto flow_state_iter = flow_states_.find(target_flow_id);
-
-    if (flow_state_iter == flow_states_.end()) {
-        throw std::out_of_range("HFSC Scheduler: Flow ID " + std::to_string(target_flow_id) +
-                                " (from packet.priority) not found in HFSC configuration.");
+void HfscScheduler::wake_fitting_classes() {
+    while (!ul_wait_.empty() && classes_[ul_wait_.top()].fit_time_ns <= link_time_ns_) {
+        uint32_t index = ul_wait_.top();
+        // Re-entering its parent's heap may make the parent selectable too.
+        while (index != ROOT_INDEX && sync_link_share(index)) {
+            index = classes_[index].parent;
+        }
     }
+}
 
-    HfscFlowState& flow_state = flow_state_iter->second;
-    bool was_empty = flow_state.packet_queue.empty();
-
-    flow_state.packet_queue.push(std::move(packet));
-    total_packets_++;
-
-    if (was_empty) {
-        update_flow_schedule(target_flow_id, true);
+void HfscScheduler::promote_eligible_classes() {
+    while (!pending_rt_.empty() && classes_[pending_rt_.top()].eligible_ns <= link_time_ns_) {
+        uint32_t index = pending_rt_.top();
+        pending_rt_.erase(classes_, index);
+        classes_[index].rt_ready = true;
+        ready_rt_.push(classes_, index);
     }
 }
 
-PacketDescriptor HfscScheduler::dequeue() {
-    if (!is_configured_) {
-        throw std::logic_error("HFSC Scheduler: Not configured. Cannot dequeue.");
-    }
-    if (is_empty()) {
-        throw std::runtime_error("HFSC Scheduler: Scheduler is empty (total_packets is 0).");
+void HfscScheduler::charge_path(uint32_t leaf_index, uint32_t packet_length_bytes) {
+    for (uint32_t index = leaf_index; index != ROOT_INDEX; index = classes_[index].parent) {
+        ClassState& cls = classes_[index];
+        cls.total_bytes += packet_length_bytes;
+        if (!cls.ls_active) {
+            continue;
+        }
+        ClassState& parent = classes_[cls.parent];
+        parent.child_vt_clock = std::max(parent.child_vt_clock, cls.vt); // Start tag of this service
+        cls.vt = std::max(cls.vt, cls.virtual_curve.y2x(cls.total_bytes));
+        if (cls.has_ul) {
+            cls.fit_time_ns = cls.upper_limit_curve.y2x(cls.total_bytes);
+        }
     }
+}
 
-    if (eligible_set_.empty()) {
-        throw std::logic_error("HFSC Scheduler: Eligible set is empty, but packets exist. "
-                               "Needs advanced virtual time update logic (TODO).");
+void HfscScheduler::deactivate_path(uint32_t leaf_index) {
+    for (uint32_t index = leaf_index; index != ROOT_INDEX; index = classes_[index].parent) {
+        ClassState& cls = classes_[index];
+        if (!cls.ls_active) {
+            break;
+        }
+        cls.ls_active = false;
+        if (--classes_[cls.parent].active_children > 0) {
+            break; // Parent still has backlogged children
+        }
     }
+}
 
-    EligibleFlow next_to_service = eligible_set_.top();
-    eligible_set_.pop();
+void HfscScheduler::update_real_time(uint32_t leaf_index, bool served_by_rt) {
+    ClassState& leaf = classes_[leaf_index];
+    if (leaf.packet_queue.empty()) {
+        if (leaf.rt_ready) {
+            ready_rt_.erase(classes_, leaf_index);
+        } else {
+            pending_rt_.erase(classes_, leaf_index);
+        }
+        leaf.rt_ready = false;
+        return;
+    }
 
-    core::FlowId selected_flow_id = next_to_service.flow_id;
-    HfscFlowState& flow_state = flow_states_.at(selected_flow_id); // .at() throws if not found (consistency check)
+    uint32_t next_length = leaf.packet_queue.front().packet_length_bytes;
+    leaf.deadline_ns = leaf.deadline_curve.y2x(leaf.cumul_bytes + next_length);
+    if (served_by_rt) {
+        leaf.eligible_ns = leaf.eligible_curve.y2x(leaf.cumul_bytes);
+        if (leaf.rt_ready) {
+            ready_rt_.erase(classes_, leaf_index);
+        } else {
+            pending_rt_.erase(classes_, leaf_index);
+        }
+        leaf.rt_ready = false;
+        pending_rt_.push(classes_, leaf_index); // promote_eligible_classes() moves it back if due
+    } else if (leaf.rt_ready) {
+        ready_rt_.update(classes_, leaf_index);
+    }
+    // A pending leaf is keyed by its unchanged eligible time.
+}
 
-    if (flow_state.packet_queue.empty()) {
-        // This indicates an inconsistency: flow was in eligible_set_ but its queue is empty.
-        // This might happen if not properly removed when it became empty previously.
-        throw std::logic_error("HFSC Scheduler: Selected eligible flow has empty packet queue. Flow ID: " + std::to_string(selected_flow_id));
+std::optional<PacketDescriptor> HfscScheduler::try_dequeue() {
+    if (total_packets_ == 0) {
+        return std::nullopt;
     }
 
-    PacketDescriptor packet_to_send = flow_state.packet_queue.front();
-    flow_state.packet_queue.pop();
-    total_packets_--;
+    uint32_t selected = NO_CLASS;
+    bool served_by_rt = false;
+    for (;;) {
+        wake_fitting_classes();
+        promote_eligible_classes();
 
-    // Advance scheduler's virtual time to the virtual finish time of the serviced packet.
-    // This VFT was determined by RT/LS and potentially constrained by UL.
-    current_virtual_time_ = next_to_service.virtual_finish_time;
-
-    // Update the UL finish time state for this flow based on the packet that was JUST dequeued.
-    // The packet started service at its flow_state.virtual_start_time (which was the final_eligible_time).
-    // This should use the virtual_start_time that was determined when this packet (packet_to_send)
-    // was made eligible and added to the eligible_set.
-    // next_to_service.virtual_finish_time is the VFT from RT/LS/UL combination.
-    // The actual start time for UL calculation should be what its final_eligible_time was.
-    // flow_state.virtual_start_time currently holds the start time for the *next* packet if calculated.
-    // This is tricky. Let's assume next_to_service stored the final_eligible_time as its virtual_start_time.
-    // For now, we use the virtual_start_time that was set for the packet just dequeued.
-    // This means flow_state.virtual_start_time before this dequeue call was the start time of packet_to_send.
-    // This detail is subtle: virtual_start_time on flow_state is for the *next* packet.
-    // The one stored in EligibleFlow is what we need for the VFT that got it scheduled.
-    // The problem description implies `P_current.virtual_start_time` is available.
-    // Let's assume `next_to_service.virtual_finish_time - service_time_of_packet_to_send_on_governing_curve`
-    // was its start time. This is also complex.
-    // A simpler way: the UL VFT is updated based on when it *could* have started by UL rules.
-    // The `flow_state.virtual_start_time` that was used to put `next_to_service` into `eligible_set_` is key.
-    // For now, let's use the `current_virtual_time_` (which is `next_to_service.virtual_finish_time`)
-    // and subtract the service time of the packet *on the curve that governed its VFT in eligible_set*.
-    // This is still not quite right.
-    // Correct logic: When P_current is chosen, its chosen_eligible_time was flow_state.virtual_start_time.
-    // So, after dequeuing P_current:
-    if (flow_state.upper_limit_sc.rate_bps > 0) {
-         flow_state.virtual_finish_time_ul = flow_state.virtual_start_time + // This virtual_start_time was its actual scheduled start
-                                           calculate_packet_service_time_us(packet_to_send.packet_length_bytes, flow_state.upper_limit_sc);
-    }
-
-
-    if (!flow_state.packet_queue.empty()) {
-        // Flow has more packets, recalculate its eligibility and VFT for the new head packet, then re-add to eligible set.
-        uint64_t base_eligible_time_for_next_pkt = current_virtual_time_; // Next packet eligibility starts from current scheduler virtual time
-        uint32_t next_packet_len_bytes = flow_state.packet_queue.front().packet_length_bytes;
-
-        // 1. Calculate RT/LS chosen eligible time and VFT
-        uint64_t chosen_eligible_time_rt_ls = 0;
-        uint64_t chosen_vft_rt_ls = std::numeric_limits<uint64_t>::max();
-        uint64_t service_time_rt_ls = std::numeric_limits<uint64_t>::max();
-
-        bool rt_curve_valid = flow_state.real_time_sc.rate_bps > 0;
-        bool ls_curve_valid = flow_state.link_share_sc.rate_bps > 0;
-
-        uint64_t eligible_time_rt = base_eligible_time_for_next_pkt + flow_state.real_time_sc.delay_us;
-        uint64_t vft_rt = eligible_time_rt + calculate_packet_service_time_us(next_packet_len_bytes, flow_state.real_time_sc);
-
-        uint64_t eligible_time_ls = base_eligible_time_for_next_pkt + flow_state.link_share_sc.delay_us;
-        uint64_t vft_ls = eligible_time_ls + calculate_packet_service_time_us(next_packet_len_bytes, flow_state.link_share_sc);
-
-        if (rt_curve_valid && ls_curve_valid) {
-            if (vft_rt <= vft_ls) {
-                chosen_vft_rt_ls = vft_rt;
-                chosen_eligible_time_rt_ls = eligible_time_rt;
-            } else {
-                chosen_vft_rt_ls = vft_ls;
-                chosen_eligible_time_rt_ls = eligible_time_ls;
+        if (!ready_rt_.empty()) {
+            selected = ready_rt_.top();
+            served_by_rt = true;
+            break;
+        }
+        if (!children_by_vt_[ROOT_INDEX].empty()) {
+            selected = ROOT_INDEX;
+            while (!classes_[selected].is_leaf()) {
+                selected = children_by_vt_[selected].top();
             }
-        } else if (rt_curve_valid) {
-            chosen_vft_rt_ls = vft_rt;
-            chosen_eligible_time_rt_ls = eligible_time_rt;
-        } else if (ls_curve_valid) {
-            chosen_vft_rt_ls = vft_ls;
-            chosen_eligible_time_rt_ls = eligible_time_ls;
+            break;
         }
 
-        if (chosen_vft_rt_ls != std::numeric_limits<uint64_t>::max()) {
-            service_time_rt_ls = chosen_vft_rt_ls - chosen_eligible_time_rt_ls;
+        // Nothing may be served yet: let the link idle until the next class becomes eligible or fits.
+        uint64_t next_event = INFINITE_TIME;
+        if (!pending_rt_.empty()) {
+            next_event = classes_[pending_rt_.top()].eligible_ns;
         }
-
-        // 2. Apply UL constraint
-        uint64_t final_eligible_time = chosen_eligible_time_rt_ls;
-        uint64_t final_vft = chosen_vft_rt_ls;
-
-        if (flow_state.upper_limit_sc.rate_bps > 0) {
-            // UL eligibility is based on its own timeline (virtual_finish_time_ul)
-            uint64_t eligible_time_ul_candidate = std::max(current_virtual_time_, flow_state.virtual_finish_time_ul) + flow_state.upper_limit_sc.delay_us;
-            final_eligible_time = std::max(chosen_eligible_time_rt_ls, eligible_time_ul_candidate);
-
-            if (chosen_vft_rt_ls != std::numeric_limits<uint64_t>::max()) { // If RT/LS provided a valid schedule
-                final_vft = final_eligible_time + service_time_rt_ls; // VFT based on RT/LS service time but potentially delayed start
-            } else {
-                // Only UL is shaping this (e.g. RT/LS rates are 0). This case is less common for re-eval.
-                // If RT/LS are not valid, this flow shouldn't be scheduled unless UL alone can schedule it.
-                // This part of logic might need refinement if UL can independently make a flow eligible.
-                // For now, if no RT/LS path, it means chosen_vft_rt_ls is max, so final_vft remains max.
-            }
+        if (!ul_wait_.empty()) {
+            next_event = std::min(next_event, classes_[ul_wait_.top()].fit_time_ns);
         }
+        if (next_event == INFINITE_TIME) {
+            // Unreachable: every leaf has an RT or LS curve (checked at construction).
+            return std::nullopt;
+        }
+        link_time_ns_ = next_event;
+    }
 
-        // 3. Update flow state and re-add to eligible set
-        if (final_vft != std::numeric_limits<uint64_t>::max()) {
-            flow_state.virtual_start_time = final_eligible_time; // This is the actual start for the next packet
-            flow_state.virtual_finish_time = final_vft;      // This is its VFT for priority queue
+    ClassState& leaf = classes_[selected];
+    PacketDescriptor packet_to_send = leaf.packet_queue.pop_front();
+    leaf.queued_bytes -= packet_to_send.packet_length_bytes;
+    total_packets_--;
 
-            // The virtual_finish_time_ul for *this next packet* will be calculated when it's dequeued,
-            // based on its actual start_time (final_eligible_time).
-            // So, no update to flow_state.virtual_finish_time_ul here for P_next, only for P_current earlier.
-            eligible_set_.push({final_vft, flow_state.flow_id});
+    if (leaf.latency) {
+        leaf.latency->sojourn.record(link_time_ns_ > packet_to_send.enqueue_time_ns
+                                         ? link_time_ns_ - packet_to_send.enqueue_time_ns : 0);
+        if (served_by_rt && saturating_add(link_time_ns_, transmission_time_ns(packet_to_send.packet_length_bytes)) >
+                                leaf.deadline_ns) {
+            core::single_writer_add(leaf.latency->rt_deadline_misses, 1);
         }
     }
-    // If flow_state.packet_queue is now empty, it's implicitly not re-added to eligible_set_
-    // until a new packet arrives via enqueue().
+    if (served_by_rt) {
+        leaf.cumul_bytes += packet_to_send.packet_length_bytes;
+    }
+    charge_path(selected, packet_to_send.packet_length_bytes);
+    if (leaf.has_rt) {
+        update_real_time(selected, served_by_rt);
+    }
+    if (leaf.packet_queue.empty()) {
+        deactivate_path(selected);
+    }
+    sync_path(selected);
 
+    packet_to_send.transmit_time_ns = link_time_ns_;
+    link_time_ns_ = saturating_add(link_time_ns_, transmission_time_ns(packet_to_send.packet_length_bytes));
     return packet_to_send;
 }
 
 bool HfscScheduler::is_empty() const {
-    // If not configured, it's effectively empty of manageable packets.
-    if (!is_configured_) return true;
-    // is_configured_ check might be desired here too, or let callers handle.
-    // If not configured, is it "empty" or in an invalid state to ask?
-    // For now, if it holds no packets, it's empty.
     return total_packets_ == 0;
 }
 
+size_t HfscScheduler::enqueue_burst(PacketDescriptor* packets, size_t count) {
+    size_t enqueued = 0;
+    for (size_t i = 0; i < count; ++i) {
+        // Qualified call: no per-packet virtual dispatch
+        if (HfscScheduler::enqueue(std::move(packets[i])) == EnqueueResult::ENQUEUED) {
+            ++enqueued;
+        }
+    }
+    return enqueued;
+}
+
+size_t HfscScheduler::dequeue_burst(std::vector<PacketDescriptor>& out, size_t max_packets) {
+    size_t dequeued = 0;
+    while (dequeued < max_packets) {
+        std::optional<PacketDescriptor> packet = HfscScheduler::try_dequeue();
+        if (!packet) {
+            break;
+        }
+        out.push_back(*packet);
+        ++dequeued;
+    }
+    return dequeued;
+}
+
 size_t HfscScheduler::get_num_configured_flows() const {
-    return flow_states_.size();
+    return classes_.size() - 1; // Excludes the root
 }
 
 size_t HfscScheduler::get_flow_queue_size(core::FlowId flow_id) const {
-    auto it = flow_states_.find(flow_id);
-    if (it == flow_states_.end()) {
+    uint32_t index = find_class_index(flow_id);
+    if (index == NO_CLASS) {
         throw std::out_of_range("HFSC Scheduler: Flow ID " + std::to_string(flow_id) + " not configured.");
     }
-    return it->second.packet_queue.size();
+    return classes_[index].packet_queue.size();
+}
+
+void HfscScheduler::enable_latency_histograms() {
+    for (uint32_t index = ROOT_INDEX + 1; index < classes_.size(); ++index) {
+        ClassState& cls = classes_[index];
+        if (cls.is_leaf() && !cls.latency) {
+            cls.latency = std::make_unique<ClassLatency>();
+        }
+    }
+}
+
+LatencySnapshot HfscScheduler::get_flow_latency(core::FlowId flow_id) const {
+    uint32_t index = find_class_index(flow_id);
+    if (index == NO_CLASS) {
+        throw std::out_of_range("HFSC Scheduler: Flow ID " + std::to_string(flow_id) + " not configured.");
+    }
+    const ClassState& cls = classes_[index];
+    return cls.latency ? cls.latency->sojourn.snapshot() : LatencySnapshot();
+}
+
+uint64_t HfscScheduler::get_rt_deadline_misses(core::FlowId flow_id) const {
+    uint32_t index = find_class_index(flow_id);
+    if (index == NO_CLASS) {
+        throw std::out_of_range("HFSC Scheduler: Flow ID " + std::to_string(flow_id) + " not configured.");
+    }
+    const ClassState& cls = classes_[index];
+    return cls.latency ? cls.latency->rt_deadline_misses.load(std::memory_order_relaxed) : 0;
+}
+
+size_t HfscScheduler::collect_queue_stats(std::vector<QueueStatsSample>& out) const {
+    size_t appended = 0;
+    for (uint32_t index = ROOT_INDEX + 1; index < classes_.size(); ++index) {
+        const ClassState& cls = classes_[index];
+        if (!cls.is_leaf()) {
+            continue;
+        }
+        QueueStatsSample sample;
+        sample.queue_id = cls.id;
+        sample.packets_queued = cls.packet_queue.size();
+        sample.bytes_queued = cls.queued_bytes;
+        fill_latency_fields(sample, cls.latency ? &cls.latency->sojourn : nullptr);
+        out.push_back(sample);
+        ++appended;
+    }
+    return appended;
 }
 
 } // namespace scheduler
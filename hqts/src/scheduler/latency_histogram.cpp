@@ -0,0 +1,79 @@
+#include "hqts/scheduler/latency_histogram.h"
+
+namespace hqts {
+namespace scheduler {
+
+uint64_t LatencyHistogram::bucket_lower_bound(size_t bucket) {
+    constexpr size_t linear_buckets = size_t{2} << SUB_BUCKET_BITS;
+    if (bucket < linear_buckets) {
+        return bucket;
+    }
+    size_t shift = (bucket >> SUB_BUCKET_BITS) - 1;
+    uint64_t mantissa = bucket - (shift << SUB_BUCKET_BITS); // In [16, 32)
+    return mantissa << shift;
+}
+
+uint64_t LatencyHistogram::bucket_upper_bound(size_t bucket) {
+    if (bucket + 1 >= NUM_BUCKETS) {
+        return UINT64_MAX; // Also holds every clamped sample
+    }
+    return bucket_lower_bound(bucket + 1) - 1;
+}
+
+LatencySnapshot LatencyHistogram::snapshot() const {
+    LatencySnapshot snapshot;
+    snapshot.count = count_.load(std::memory_order_relaxed);
+    snapshot.sum_ns = sum_ns_.load(std::memory_order_relaxed);
+    snapshot.max_ns = max_ns_.load(std::memory_order_relaxed);
+    if (snapshot.count == 0) {
+        return snapshot;
+    }
+    snapshot.buckets.resize(NUM_BUCKETS);
+    for (size_t i = 0; i < NUM_BUCKETS; ++i) {
+        snapshot.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+    }
+    return snapshot;
+}
+
+void LatencyHistogram::reset() {
+    for (std::atomic<uint64_t>& bucket : buckets_) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    sum_ns_.store(0, std::memory_order_relaxed);
+    max_ns_.store(0, std::memory_order_relaxed);
+}
+
+uint64_t LatencySnapshot::percentile_ns(double fraction) const {
+    uint64_t total = 0;
+    for (uint64_t samples : buckets) {
+        total += samples; // Not `count`: a concurrent snapshot may disagree with its buckets
+    }
+    if (total == 0) {
+        return 0;
+    }
+    if (fraction < 0.0) {
+        fraction = 0.0;
+    }
+    // Rank of the wanted sample, 1-based: the smallest rank covering `fraction` of them.
+    double wanted = fraction * static_cast<double>(total);
+    uint64_t rank = static_cast<uint64_t>(wanted);
+    if (static_cast<double>(rank) < wanted || rank == 0) {
+        ++rank;
+    }
+    if (rank > total) {
+        rank = total;
+    }
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            uint64_t upper = LatencyHistogram::bucket_upper_bound(i);
+            return upper < max_ns ? upper : max_ns;
+        }
+    }
+    return max_ns;
+}
+
+} // namespace scheduler
+} // namespace hqts
@@ -0,0 +1,38 @@
+#include "hqts/scheduler/packet_descriptor_pool.h"
+
+#include <stdexcept> // For std::invalid_argument
+#include <string>    // For std::to_string
+
+namespace hqts {
+namespace scheduler {
+
+PacketDescriptorPool::PacketDescriptorPool(size_t capacity) {
+    if (capacity == 0 || capacity >= NIL) {
+        throw std::invalid_argument("PacketDescriptorPool: capacity must be in [1, " +
+                                    std::to_string(NIL - 1) + "], got " + std::to_string(capacity));
+    }
+    nodes_.resize(capacity);
+    // Thread the free list in index order so early packets land in adjacent nodes.
+    for (size_t i = 0; i + 1 < capacity; ++i) {
+        nodes_[i].next = static_cast<Index>(i + 1);
+    }
+    nodes_[capacity - 1].next = NIL;
+    free_head_ = 0;
+    available_ = capacity;
+}
+
+size_t PacketDescriptorPool::capacity_for_bytes(uint64_t total_capacity_bytes, uint32_t min_packet_bytes) {
+    if (min_packet_bytes == 0) {
+        throw std::invalid_argument("PacketDescriptorPool: min_packet_bytes must be greater than 0.");
+    }
+    uint64_t descriptors = (total_capacity_bytes + min_packet_bytes - 1) / min_packet_bytes;
+    return descriptors == 0 ? 1 : static_cast<size_t>(descriptors);
+}
+
+std::shared_ptr<PacketDescriptorPool> PacketDescriptorPool::create_for_bytes(
+    uint64_t total_capacity_bytes, uint32_t min_packet_bytes) {
+    return std::make_shared<PacketDescriptorPool>(capacity_for_bytes(total_capacity_bytes, min_packet_bytes));
+}
+
+} // namespace scheduler
+} // namespace hqts
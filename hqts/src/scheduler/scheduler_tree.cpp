@@ -0,0 +1,369 @@
+#include "hqts/scheduler/scheduler_tree.h"
+#include "hqts/scheduler/packet_descriptor_pool.h" // For PacketDescriptorPool
+#include "hqts/core/packet_buffer_pool.h"          // For PacketBufferPool::release_any
+#include "hqts/core/prefetch.h"                    // For prefetch_for_write, PREFETCH_DISTANCE
+
+#include <algorithm>  // For std::lower_bound, std::min, std::sort, std::push_heap, std::pop_heap
+#include <functional> // For std::greater
+#include <stdexcept>  // For std::invalid_argument, std::out_of_range
+#include <string>     // For std::to_string in error messages
+
+namespace hqts {
+namespace scheduler {
+
+namespace {
+
+// Fair-queueing tags advance by (length << TAG_SHIFT) / share: integer virtual time with
+// enough resolution for shares up to ~2^20 (weights, or rates in kbit/s).
+constexpr unsigned TAG_SHIFT = 20;
+
+using TagGreater = std::greater<std::pair<uint64_t, uint32_t>>;
+
+} // namespace
+
+SchedulerTree::SchedulerTree(const policy::PolicyTree& policies, const AqmParameters& leaf_queue_params,
+                             policy::SchedulingAlgorithm port_algorithm, uint32_t quantum_bytes_per_weight,
+                             std::shared_ptr<PacketDescriptorPool> descriptor_pool) {
+    if (policies.empty()) {
+        throw std::invalid_argument("SchedulerTree: the policy tree is empty.");
+    }
+    if (quantum_bytes_per_weight == 0) {
+        throw std::invalid_argument("SchedulerTree: quantum_bytes_per_weight must be greater than zero.");
+    }
+
+    // Nodes: the port, then one per policy in ascending PolicyId order.
+    std::vector<const core::ShapingPolicy*> policy_of_node(1, nullptr);
+    nodes_.reserve(policies.size() + 1);
+    sorted_ids_.reserve(policies.size());
+    nodes_.emplace_back(policy::NO_PARENT_POLICY_ID, NO_NODE, port_algorithm);
+    for (const core::ShapingPolicy& policy : policies.get<policy::by_id>()) {
+        if (policy.id == policy::NO_PARENT_POLICY_ID) {
+            throw std::invalid_argument("SchedulerTree: PolicyId 0 is reserved for 'no parent'.");
+        }
+        nodes_.emplace_back(policy.id, NO_NODE, policy.algorithm);
+        sorted_ids_.push_back(policy.id);
+        policy_of_node.push_back(&policy);
+    }
+
+    // Parent links; children stay in ascending PolicyId order.
+    for (uint32_t index = 1; index < nodes_.size(); ++index) {
+        policy::PolicyId parent_id = policy_of_node[index]->parent_id;
+        uint32_t parent = parent_id == policy::NO_PARENT_POLICY_ID ? PORT_NODE : find_node(parent_id);
+        if (parent == NO_NODE) {
+            throw std::invalid_argument("SchedulerTree: parent " + std::to_string(parent_id) + " of policy " +
+                                        std::to_string(nodes_[index].id) + " is not in the tree.");
+        }
+        nodes_[index].parent = parent;
+        nodes_[parent].children.push_back(index);
+    }
+
+    // Everything must hang off the port: policies on a parent cycle are unreachable.
+    size_t reachable = 0;
+    std::vector<uint32_t> pending(1, PORT_NODE);
+    while (!pending.empty()) {
+        uint32_t index = pending.back();
+        pending.pop_back();
+        ++reachable;
+        pending.insert(pending.end(), nodes_[index].children.begin(), nodes_[index].children.end());
+    }
+    if (reachable != nodes_.size()) {
+        throw std::invalid_argument("SchedulerTree: " + std::to_string(nodes_.size() - reachable) +
+                                    " policies are on a parent cycle.");
+    }
+
+    size_t num_leaves = 0;
+    for (const Node& node : nodes_) {
+        if (node.children.empty()) {
+            ++num_leaves;
+        }
+    }
+    if (!descriptor_pool) {
+        descriptor_pool = PacketDescriptorPool::create_for_bytes(
+            static_cast<uint64_t>(aqm_queue_capacity_bytes(leaf_queue_params)) * num_leaves);
+    }
+
+    for (Node& node : nodes_) {
+        if (node.children.empty()) {
+            node.queue = std::make_unique<AqmQueue>(leaf_queue_params, descriptor_pool);
+            continue;
+        }
+        const std::string where = "SchedulerTree: child of " +
+            (node.parent == NO_NODE ? std::string("the port") : "policy " + std::to_string(node.id));
+        switch (node.algorithm) {
+            case policy::SchedulingAlgorithm::STRICT_PRIORITY: {
+                if (node.children.size() > PriorityBitmap::MAX_LEVELS) {
+                    throw std::invalid_argument(where + ": more than " + std::to_string(PriorityBitmap::MAX_LEVELS) +
+                                                " strict-priority children.");
+                }
+                // Rank ascending by priority_level; among equals the lower PolicyId ranks higher.
+                node.child_by_rank = node.children;
+                std::sort(node.child_by_rank.begin(), node.child_by_rank.end(),
+                          [&policy_of_node](uint32_t a, uint32_t b) {
+                              const core::ShapingPolicy& pa = *policy_of_node[a];
+                              const core::ShapingPolicy& pb = *policy_of_node[b];
+                              return pa.priority_level != pb.priority_level ? pa.priority_level < pb.priority_level
+                                                                            : pa.id > pb.id;
+                          });
+                for (uint32_t rank = 0; rank < node.child_by_rank.size(); ++rank) {
+                    nodes_[node.child_by_rank[rank]].rank = rank;
+                }
+                node.backlogged_ranks = PriorityBitmap(node.children.size());
+                break;
+            }
+            case policy::SchedulingAlgorithm::DRR:
+            case policy::SchedulingAlgorithm::WRR:
+            case policy::SchedulingAlgorithm::WFQ:
+                for (uint32_t child : node.children) {
+                    uint32_t weight = policy_of_node[child]->weight;
+                    if (weight == 0) {
+                        throw std::invalid_argument(where + ": policy " + std::to_string(nodes_[child].id) +
+                                                    " has weight 0.");
+                    }
+                    nodes_[child].weight = weight;
+                    nodes_[child].share = weight;
+                    nodes_[child].quantum = static_cast<int64_t>(weight) * quantum_bytes_per_weight;
+                }
+                break;
+            case policy::SchedulingAlgorithm::HFSC:
+                for (uint32_t child : node.children) {
+                    uint64_t rate_bps = policy_of_node[child]->committed_rate_bps;
+                    if (rate_bps == 0) {
+                        throw std::invalid_argument(where + ": policy " + std::to_string(nodes_[child].id) +
+                                                    " has committed rate 0.");
+                    }
+                    uint64_t rate_kbps = rate_bps / 1000;
+                    nodes_[child].share = rate_kbps == 0 ? 1 : rate_kbps;
+                }
+                break;
+        }
+        node.tag_heap.reserve(node.children.size()); // Never grows on the data path
+    }
+}
+
+uint32_t SchedulerTree::find_node(policy::PolicyId id) const {
+    auto it = std::lower_bound(sorted_ids_.begin(), sorted_ids_.end(), id);
+    if (it == sorted_ids_.end() || *it != id) {
+        return NO_NODE;
+    }
+    return static_cast<uint32_t>(it - sorted_ids_.begin()) + 1;
+}
+
+EnqueueResult SchedulerTree::enqueue(PacketDescriptor packet) {
+    return enqueue_at(find_node(packet.policy_id), std::move(packet));
+}
+
+EnqueueResult SchedulerTree::enqueue_at(uint32_t leaf, PacketDescriptor packet) {
+    if (leaf == NO_NODE || !nodes_[leaf].queue) {
+        core::PacketBufferPool::release_any(packet.buffer);
+        return EnqueueResult::DROPPED_NO_QUEUE;
+    }
+    if (!nodes_[leaf].queue->enqueue(std::move(packet))) {
+        return EnqueueResult::DROPPED_BY_QUEUE; // The queue released the buffer
+    }
+    // Count the packet at every level, activating each node that was idle.
+    uint32_t index = leaf;
+    while (index != PORT_NODE) {
+        Node& node = nodes_[index];
+        if (node.backlog++ == 0) {
+            activate(nodes_[node.parent], index);
+        }
+        index = node.parent;
+    }
+    ++nodes_[PORT_NODE].backlog;
+    return EnqueueResult::ENQUEUED;
+}
+
+std::optional<PacketDescriptor> SchedulerTree::try_dequeue() {
+    if (nodes_[PORT_NODE].backlog == 0) {
+        return std::nullopt;
+    }
+    uint32_t index = PORT_NODE;
+    while (!nodes_[index].queue) {
+        index = select(nodes_[index]); // Only backlogged children are selectable
+    }
+
+    AqmQueue& queue = *nodes_[index].queue;
+    size_t queued_before = queue.get_current_packet_count();
+    PacketDescriptor packet = queue.dequeue();
+    size_t removed = queued_before - queue.get_current_packet_count(); // CoDel may drop on dequeue
+
+    // Charge every level on the way back up.
+    while (index != PORT_NODE) {
+        Node& node = nodes_[index];
+        node.backlog -= removed;
+        account(nodes_[node.parent], index, packet.packet_length_bytes);
+        index = node.parent;
+    }
+    nodes_[PORT_NODE].backlog -= removed;
+    return packet;
+}
+
+bool SchedulerTree::is_empty() const {
+    return nodes_[PORT_NODE].backlog == 0;
+}
+
+size_t SchedulerTree::enqueue_burst(PacketDescriptor* packets, size_t count) {
+    size_t enqueued = 0;
+    uint32_t leaves[ENQUEUE_BATCH];
+    for (size_t start = 0; start < count; start += ENQUEUE_BATCH) {
+        const size_t batch = std::min(ENQUEUE_BATCH, count - start);
+        for (size_t i = 0; i < batch; ++i) {
+            leaves[i] = find_node(packets[start + i].policy_id);
+            if (leaves[i] != NO_NODE) {
+                core::prefetch_for_write(&nodes_[leaves[i]]);
+            }
+        }
+        for (size_t i = 0; i < batch; ++i) {
+            const size_t ahead = i + core::PREFETCH_DISTANCE;
+            if (ahead < batch && leaves[ahead] != NO_NODE && nodes_[leaves[ahead]].queue) {
+                core::prefetch_for_write(nodes_[leaves[ahead]].queue.get());
+            }
+            if (enqueue_at(leaves[i], std::move(packets[start + i])) == EnqueueResult::ENQUEUED) {
+                ++enqueued;
+            }
+        }
+    }
+    return enqueued;
+}
+
+size_t SchedulerTree::dequeue_burst(std::vector<PacketDescriptor>& out, size_t max_packets) {
+    size_t dequeued = 0;
+    while (dequeued < max_packets) {
+        std::optional<PacketDescriptor> packet = SchedulerTree::try_dequeue();
+        if (!packet) {
+            break;
+        }
+        out.push_back(*packet);
+        ++dequeued;
+    }
+    return dequeued;
+}
+
+size_t SchedulerTree::get_backlog(policy::PolicyId id) const {
+    uint32_t index = find_node(id);
+    if (index == NO_NODE) {
+        throw std::out_of_range("SchedulerTree: policy " + std::to_string(id) + " is not in the tree.");
+    }
+    return nodes_[index].backlog;
+}
+
+bool SchedulerTree::is_leaf(policy::PolicyId id) const {
+    uint32_t index = find_node(id);
+    return index != NO_NODE && nodes_[index].queue != nullptr;
+}
+
+void SchedulerTree::activate(Node& parent, uint32_t child) {
+    Node& node = nodes_[child];
+    switch (parent.algorithm) {
+        case policy::SchedulingAlgorithm::STRICT_PRIORITY:
+            parent.backlogged_ranks.set(node.rank);
+            break;
+        case policy::SchedulingAlgorithm::DRR:
+            node.deficit = node.quantum; // A newly backlogged child may send right away
+            push_active(parent, child);
+            break;
+        case policy::SchedulingAlgorithm::WRR:
+            node.sent_in_turn = 0;
+            push_active(parent, child);
+            break;
+        case policy::SchedulingAlgorithm::WFQ:
+        case policy::SchedulingAlgorithm::HFSC: {
+            // Start tag: no credit for the time the child was idle.
+            uint64_t start = node.finish_tag > parent.virtual_time ? node.finish_tag : parent.virtual_time;
+            parent.tag_heap.emplace_back(start, child);
+            std::push_heap(parent.tag_heap.begin(), parent.tag_heap.end(), TagGreater());
+            break;
+        }
+    }
+}
+
+uint32_t SchedulerTree::select(Node& parent) {
+    switch (parent.algorithm) {
+        case policy::SchedulingAlgorithm::STRICT_PRIORITY:
+            return parent.child_by_rank[parent.backlogged_ranks.highest()];
+        case policy::SchedulingAlgorithm::DRR:
+            // Each rotation adds a positive quantum, so this ends within a few turns.
+            for (;;) {
+                uint32_t child = parent.active_head;
+                Node& node = nodes_[child];
+                if (node.deficit > 0) {
+                    return child;
+                }
+                node.deficit += node.quantum;
+                pop_active(parent);
+                push_active(parent, child);
+            }
+        case policy::SchedulingAlgorithm::WRR: {
+            uint32_t child = parent.active_head;
+            if (nodes_[child].sent_in_turn >= nodes_[child].weight) {
+                nodes_[child].sent_in_turn = 0; // Turn over: to the tail of the round
+                pop_active(parent);
+                push_active(parent, child);
+            }
+            return parent.active_head;
+        }
+        case policy::SchedulingAlgorithm::WFQ:
+        case policy::SchedulingAlgorithm::HFSC:
+            break;
+    }
+    return parent.tag_heap.front().second; // Smallest start tag
+}
+
+void SchedulerTree::account(Node& parent, uint32_t child, uint32_t length_bytes) {
+    Node& node = nodes_[child];
+    const bool idle = node.backlog == 0;
+    switch (parent.algorithm) {
+        case policy::SchedulingAlgorithm::STRICT_PRIORITY:
+            if (idle) {
+                parent.backlogged_ranks.clear(node.rank);
+            }
+            break;
+        case policy::SchedulingAlgorithm::DRR:
+            node.deficit -= length_bytes;
+            if (idle) {
+                pop_active(parent); // The served child is at the head
+                node.deficit = 0;
+            }
+            break;
+        case policy::SchedulingAlgorithm::WRR:
+            ++node.sent_in_turn;
+            if (idle) {
+                pop_active(parent);
+                node.sent_in_turn = 0;
+            }
+            break;
+        case policy::SchedulingAlgorithm::WFQ:
+        case policy::SchedulingAlgorithm::HFSC: {
+            std::pop_heap(parent.tag_heap.begin(), parent.tag_heap.end(), TagGreater()); // The served child
+            uint64_t start = parent.tag_heap.back().first;
+            parent.tag_heap.pop_back();
+            parent.virtual_time = start;
+            node.finish_tag = start + (static_cast<uint64_t>(length_bytes) << TAG_SHIFT) / node.share;
+            if (!idle) {
+                parent.tag_heap.emplace_back(node.finish_tag, child);
+                std::push_heap(parent.tag_heap.begin(), parent.tag_heap.end(), TagGreater());
+            }
+            break;
+        }
+    }
+}
+
+void SchedulerTree::push_active(Node& parent, uint32_t child) {
+    nodes_[child].next_active = NO_NODE;
+    if (parent.active_tail == NO_NODE) {
+        parent.active_head = child;
+    } else {
+        nodes_[parent.active_tail].next_active = child;
+    }
+    parent.active_tail = child;
+}
+
+void SchedulerTree::pop_active(Node& parent) {
+    parent.active_head = nodes_[parent.active_head].next_active;
+    if (parent.active_head == NO_NODE) {
+        parent.active_tail = NO_NODE;
+    }
+}
+
+} // namespace scheduler
+} // namespace hqts
@@ -1,62 +1,109 @@
 #include "hqts/scheduler/strict_priority_scheduler.h"
 #include <string> // Required for std::to_string in error messages
 
-#include "hqts/scheduler/aqm_queue.h" // Required for RedAqmParameters
+#include "hqts/scheduler/any_aqm_queue.h" // Required for AqmParameters
+#include "hqts/core/packet_buffer_pool.h"  // For PacketBufferPool::release_any
 
 namespace hqts {
 namespace scheduler {
 
-StrictPriorityScheduler::StrictPriorityScheduler(const std::vector<RedAqmParameters>& queue_params_list)
-    : num_levels_(queue_params_list.size()), total_packets_(0) {
+namespace {
+
+// PacketDescriptor::priority is 8 bits wide.
+constexpr size_t MAX_PRIORITY_LEVELS = 256;
+
+} // namespace
+
+StrictPriorityScheduler::StrictPriorityScheduler(const std::vector<RedAqmParameters>& queue_params_list,
+                                                 std::shared_ptr<PacketDescriptorPool> descriptor_pool)
+    : StrictPriorityScheduler(to_aqm_parameters(queue_params_list), std::move(descriptor_pool)) {}
+
+StrictPriorityScheduler::StrictPriorityScheduler(const std::vector<AqmParameters>& queue_params_list,
+                                                 std::shared_ptr<PacketDescriptorPool> descriptor_pool)
+    : num_levels_(queue_params_list.size()),
+      backlogged_levels_(MAX_PRIORITY_LEVELS), // 256 bits: no need to size it exactly
+      total_packets_(0) {
     if (num_levels_ == 0) {
         throw std::invalid_argument("StrictPriorityScheduler: queue_params_list cannot be empty.");
     }
+    if (num_levels_ > MAX_PRIORITY_LEVELS) {
+        throw std::invalid_argument("StrictPriorityScheduler: " + std::to_string(num_levels_) +
+                                    " priority levels requested, at most " +
+                                    std::to_string(MAX_PRIORITY_LEVELS) + " are addressable.");
+    }
+    if (!descriptor_pool) {
+        uint64_t aggregate_capacity_bytes = 0;
+        for (const auto& params : queue_params_list) {
+            aggregate_capacity_bytes += aqm_queue_capacity_bytes(params);
+        }
+        descriptor_pool = PacketDescriptorPool::create_for_bytes(aggregate_capacity_bytes);
+    }
     priority_queues_.reserve(num_levels_);
     for (const auto& params : queue_params_list) {
-        priority_queues_.emplace_back(params);
+        priority_queues_.emplace_back(params, descriptor_pool);
     }
 }
 
-void StrictPriorityScheduler::enqueue(PacketDescriptor packet) {
-    if (packet.priority >= num_levels_) {
-        throw std::out_of_range("StrictPriorityScheduler: Packet priority " + std::to_string(packet.priority) +
-                                " is out of range. Max allowed is " + std::to_string(num_levels_ - 1) + ".");
+EnqueueResult StrictPriorityScheduler::enqueue(PacketDescriptor packet) {
+    const uint8_t level = packet.priority;
+    if (level >= num_levels_) {
+        core::PacketBufferPool::release_any(packet.buffer);
+        return EnqueueResult::DROPPED_NO_QUEUE;
     }
-    // RedAqmQueue::enqueue returns true if packet is accepted, false if dropped by AQM or full.
-    if (priority_queues_[packet.priority].enqueue(std::move(packet))) {
-        total_packets_++;
+    // AqmQueue::enqueue returns false if the packet was dropped by the AQM or the queue is full.
+    if (!priority_queues_[level].enqueue(std::move(packet))) {
+        return EnqueueResult::DROPPED_BY_QUEUE;
     }
-    // If enqueue returns false, the packet was dropped by the AQM logic within RedAqmQueue,
-    // so we don't increment total_packets_.
+    total_packets_++;
+    backlogged_levels_.set(level);
+    return EnqueueResult::ENQUEUED;
 }
 
-PacketDescriptor StrictPriorityScheduler::dequeue() {
-    if (is_empty()) {
-        throw std::runtime_error("StrictPriorityScheduler: Scheduler is empty, cannot dequeue.");
+std::optional<PacketDescriptor> StrictPriorityScheduler::try_dequeue() {
+    // Numerically higher priority value means higher scheduling priority. The bitmap and
+    // total_packets_ are maintained together, so an empty bitmap means an empty scheduler.
+    size_t level = backlogged_levels_.highest();
+    if (level == PriorityBitmap::NO_LEVEL) {
+        return std::nullopt;
     }
-
-    // Iterate from the highest priority queue down to the lowest
-    // Numerically higher priority value means higher scheduling priority
-    for (size_t i = 0; i < num_levels_; ++i) {
-        // Highest priority is num_levels_ - 1, lowest is 0.
-        // Vector index matches priority level directly (e.g. priority_queues_[0] is prio 0)
-        // So, loop from (num_levels_ - 1) down to 0.
-        size_t current_priority_index = num_levels_ - 1 - i;
-        if (!priority_queues_[current_priority_index].is_empty()) {
-            PacketDescriptor packet = priority_queues_[current_priority_index].dequeue();
-            total_packets_--;
-            return packet;
-        }
+    AqmQueue& queue = priority_queues_[level];
+    size_t queued_before = queue.get_current_packet_count();
+    PacketDescriptor packet = queue.dequeue();
+    total_packets_ -= queued_before - queue.get_current_packet_count(); // CoDel may drop on dequeue
+    if (queue.is_empty()) {
+        backlogged_levels_.clear(level);
     }
-    // This part should ideally not be reached if total_packets_ is managed correctly
-    // and is_empty() is checked. If it is reached, it implies an inconsistency.
-    throw std::logic_error("StrictPriorityScheduler: State inconsistent. is_empty() was false, but no packet found.");
+    return packet;
 }
 
 bool StrictPriorityScheduler::is_empty() const {
     return total_packets_ == 0;
 }
 
+size_t StrictPriorityScheduler::enqueue_burst(PacketDescriptor* packets, size_t count) {
+    size_t enqueued = 0;
+    for (size_t i = 0; i < count; ++i) {
+        // Qualified call: no per-packet virtual dispatch
+        if (StrictPriorityScheduler::enqueue(std::move(packets[i])) == EnqueueResult::ENQUEUED) {
+            ++enqueued;
+        }
+    }
+    return enqueued;
+}
+
+size_t StrictPriorityScheduler::dequeue_burst(std::vector<PacketDescriptor>& out, size_t max_packets) {
+    size_t dequeued = 0;
+    while (dequeued < max_packets) {
+        std::optional<PacketDescriptor> packet = StrictPriorityScheduler::try_dequeue();
+        if (!packet) {
+            break;
+        }
+        out.push_back(*packet);
+        ++dequeued;
+    }
+    return dequeued;
+}
+
 size_t StrictPriorityScheduler::get_num_priority_levels() const {
     return num_levels_;
 }
@@ -69,5 +116,27 @@ size_t StrictPriorityScheduler::get_queue_size(uint8_t priority_level) const {
     return priority_queues_[priority_level].get_current_packet_count();
 }
 
+void StrictPriorityScheduler::enable_latency_histograms() {
+    for (AqmQueue& queue : priority_queues_) {
+        queue.enable_latency_histogram();
+    }
+}
+
+LatencySnapshot StrictPriorityScheduler::get_queue_latency(uint8_t priority_level) const {
+    if (priority_level >= num_levels_) {
+        throw std::out_of_range("StrictPriorityScheduler: Priority level " + std::to_string(priority_level) +
+                                " is out of range. Max allowed is " + std::to_string(num_levels_ - 1) + ".");
+    }
+    const LatencyHistogram* histogram = priority_queues_[priority_level].latency_histogram();
+    return histogram != nullptr ? histogram->snapshot() : LatencySnapshot();
+}
+
+size_t StrictPriorityScheduler::collect_queue_stats(std::vector<QueueStatsSample>& out) const {
+    for (size_t level = 0; level < num_levels_; ++level) {
+        out.push_back(priority_queues_[level].stats_sample(level));
+    }
+    return num_levels_;
+}
+
 } // namespace scheduler
 } // namespace hqts
@@ -0,0 +1,210 @@
+#include "hqts/scheduler/wfq_scheduler.h"
+#include "hqts/scheduler/any_aqm_queue.h" // For AqmParameters
+#include "hqts/core/packet_buffer_pool.h"  // For PacketBufferPool::release_any
+#include <algorithm> // For std::push_heap, std::pop_heap
+#include <string>    // For std::to_string in error messages
+#include <stdexcept> // For exceptions
+
+namespace hqts {
+namespace scheduler {
+
+namespace {
+
+/// Whether virtual time `a` is after `b`, modulo 2^64.
+inline bool tag_after(uint64_t a, uint64_t b) {
+    return static_cast<int64_t>(a - b) > 0;
+}
+
+} // namespace
+
+bool WfqScheduler::heap_later(const HeapEntry& a, const HeapEntry& b) {
+    // Ties go to the lower internal index, so service order is deterministic.
+    return tag_after(a.tag, b.tag) || (a.tag == b.tag && a.queue > b.queue);
+}
+
+WfqScheduler::WfqScheduler(const std::vector<QueueConfig>& queue_configs,
+                           std::shared_ptr<PacketDescriptorPool> descriptor_pool) {
+    index_by_priority_.fill(NO_QUEUE);
+    if (queue_configs.empty()) {
+        throw std::invalid_argument("WFQ Scheduler: queue_configs cannot be empty.");
+    }
+
+    if (!descriptor_pool) {
+        uint64_t aggregate_capacity_bytes = 0;
+        for (const auto& qc : queue_configs) {
+            aggregate_capacity_bytes += aqm_queue_capacity_bytes(qc.aqm_params);
+        }
+        descriptor_pool = PacketDescriptorPool::create_for_bytes(aggregate_capacity_bytes);
+    }
+
+    queues_.reserve(queue_configs.size());
+    for (size_t i = 0; i < queue_configs.size(); ++i) {
+        const auto& qc = queue_configs[i];
+        if (qc.weight == 0) {
+            throw std::invalid_argument("WFQ Scheduler: Queue weight for ID " + std::to_string(qc.id) + " must be greater than zero.");
+        }
+        if (queue_id_to_index_.count(qc.id)) {
+            throw std::invalid_argument("WFQ Scheduler: Duplicate QueueId " + std::to_string(qc.id) + " in configuration.");
+        }
+
+        queues_.emplace_back(qc.id, qc.weight, qc.aqm_params, descriptor_pool);
+        queue_id_to_index_[qc.id] = i;
+        if (qc.id < index_by_priority_.size()) {
+            index_by_priority_[qc.id] = i; // Reachable from PacketDescriptor::priority
+        }
+    }
+    // A queue is in at most one heap at a time.
+    eligible_.reserve(queues_.size());
+    ineligible_.reserve(queues_.size());
+}
+
+EnqueueResult WfqScheduler::enqueue(PacketDescriptor packet) {
+    // PacketDescriptor::priority is the QueueId: a direct lookup, no map search.
+    size_t index = index_by_priority_[packet.priority];
+    if (index == NO_QUEUE) {
+        core::PacketBufferPool::release_any(packet.buffer);
+        return EnqueueResult::DROPPED_NO_QUEUE;
+    }
+    return enqueue_at(index, std::move(packet));
+}
+
+EnqueueResult WfqScheduler::enqueue_to_queue(core::QueueId queue_id, PacketDescriptor packet) {
+    auto it = queue_id_to_index_.find(queue_id);
+    if (it == queue_id_to_index_.end()) {
+        core::PacketBufferPool::release_any(packet.buffer);
+        return EnqueueResult::DROPPED_NO_QUEUE;
+    }
+    return enqueue_at(it->second, std::move(packet));
+}
+
+EnqueueResult WfqScheduler::enqueue_at(size_t index, PacketDescriptor packet) {
+    InternalQueueState& q_state = queues_[index];
+    bool was_idle = q_state.packet_queue.is_empty();
+    if (!q_state.packet_queue.enqueue(std::move(packet))) {
+        return EnqueueResult::DROPPED_BY_QUEUE; // Dropped by AQM, total_packets_ not incremented
+    }
+    total_packets_++;
+    if (was_idle) {
+        // Newly backlogged: starts no earlier than now, nor before its last packet finished.
+        q_state.start_tag = tag_after(q_state.finish_tag, virtual_time_) ? q_state.finish_tag : virtual_time_;
+        backlogged_weight_ += q_state.weight;
+        schedule_head(index);
+    }
+    return EnqueueResult::ENQUEUED;
+}
+
+void WfqScheduler::schedule_head(size_t index) {
+    InternalQueueState& q_state = queues_[index];
+    uint64_t length = q_state.packet_queue.front().packet_length_bytes;
+    q_state.finish_tag = q_state.start_tag + (length << TAG_SHIFT) / q_state.weight;
+
+    if (tag_after(q_state.start_tag, virtual_time_)) {
+        ineligible_.push_back({q_state.start_tag, index});
+        std::push_heap(ineligible_.begin(), ineligible_.end(), heap_later);
+    } else {
+        eligible_.push_back({q_state.finish_tag, index});
+        std::push_heap(eligible_.begin(), eligible_.end(), heap_later);
+    }
+}
+
+std::optional<PacketDescriptor> WfqScheduler::try_dequeue() {
+    if (total_packets_ == 0) {
+        return std::nullopt;
+    }
+
+    // V never lags the smallest start tag: with nothing eligible it jumps to it.
+    if (eligible_.empty()) {
+        virtual_time_ = ineligible_.front().tag;
+    }
+    while (!ineligible_.empty() && !tag_after(ineligible_.front().tag, virtual_time_)) {
+        std::pop_heap(ineligible_.begin(), ineligible_.end(), heap_later);
+        size_t index = ineligible_.back().queue;
+        ineligible_.pop_back();
+        eligible_.push_back({queues_[index].finish_tag, index});
+        std::push_heap(eligible_.begin(), eligible_.end(), heap_later);
+    }
+
+    std::pop_heap(eligible_.begin(), eligible_.end(), heap_later);
+    size_t index = eligible_.back().queue;
+    eligible_.pop_back();
+
+    InternalQueueState& q_state = queues_[index];
+    size_t queued_before = q_state.packet_queue.get_current_packet_count();
+    PacketDescriptor packet_to_send = q_state.packet_queue.dequeue();
+    total_packets_ -= queued_before - q_state.packet_queue.get_current_packet_count();
+    // CoDel may drop the packet the tags were computed for: V advances by what is sent.
+    virtual_time_ += (static_cast<uint64_t>(packet_to_send.packet_length_bytes) << TAG_SHIFT) / backlogged_weight_;
+
+    if (q_state.packet_queue.is_empty()) {
+        backlogged_weight_ -= q_state.weight; // finish_tag is kept for the next activation
+    } else {
+        q_state.start_tag = q_state.finish_tag;
+        schedule_head(index);
+    }
+    return packet_to_send;
+}
+
+bool WfqScheduler::is_empty() const {
+    return total_packets_ == 0;
+}
+
+size_t WfqScheduler::enqueue_burst(PacketDescriptor* packets, size_t count) {
+    size_t enqueued = 0;
+    for (size_t i = 0; i < count; ++i) {
+        // Qualified call: no per-packet virtual dispatch
+        if (WfqScheduler::enqueue(std::move(packets[i])) == EnqueueResult::ENQUEUED) {
+            ++enqueued;
+        }
+    }
+    return enqueued;
+}
+
+size_t WfqScheduler::dequeue_burst(std::vector<PacketDescriptor>& out, size_t max_packets) {
+    size_t dequeued = 0;
+    while (dequeued < max_packets) {
+        std::optional<PacketDescriptor> packet = WfqScheduler::try_dequeue();
+        if (!packet) {
+            break;
+        }
+        out.push_back(*packet);
+        ++dequeued;
+    }
+    return dequeued;
+}
+
+size_t WfqScheduler::get_queue_size(core::QueueId queue_id) const {
+    auto it = queue_id_to_index_.find(queue_id);
+    if (it == queue_id_to_index_.end()) {
+        throw std::out_of_range("WFQ Scheduler: QueueId " + std::to_string(queue_id) + " not configured.");
+    }
+    return queues_[it->second].packet_queue.get_current_packet_count();
+}
+
+void WfqScheduler::enable_latency_histograms() {
+    for (InternalQueueState& queue : queues_) {
+        queue.packet_queue.enable_latency_histogram();
+    }
+}
+
+LatencySnapshot WfqScheduler::get_queue_latency(core::QueueId queue_id) const {
+    auto it = queue_id_to_index_.find(queue_id);
+    if (it == queue_id_to_index_.end()) {
+        throw std::out_of_range("WFQ Scheduler: QueueId " + std::to_string(queue_id) + " not configured.");
+    }
+    const LatencyHistogram* histogram = queues_[it->second].packet_queue.latency_histogram();
+    return histogram != nullptr ? histogram->snapshot() : LatencySnapshot();
+}
+
+size_t WfqScheduler::collect_queue_stats(std::vector<QueueStatsSample>& out) const {
+    for (const InternalQueueState& queue : queues_) {
+        out.push_back(queue.packet_queue.stats_sample(queue.external_id));
+    }
+    return queues_.size();
+}
+
+size_t WfqScheduler::get_num_queues() const {
+    return queues_.size();
+}
+
+} // namespace scheduler
+} // namespace hqts
@@ -1,16 +1,37 @@
 #include "hqts/scheduler/wrr_scheduler.h"
 #include <string> // For std::to_string in error messages
 #include <numeric> // For std::gcd if a more complex deficit scheme was used, not directly needed now.
+#include <utility> // For std::swap
+
+#include "hqts/core/packet_buffer_pool.h" // For PacketBufferPool::release_any
 
 namespace hqts {
 namespace scheduler {
 
-WrrScheduler::WrrScheduler(const std::vector<QueueConfig>& queue_configs)
-    : current_queue_index_(0), total_packets_(0), is_configured_(false) {
+WrrScheduler::WrrScheduler(const std::vector<QueueConfig>& queue_configs,
+                           std::shared_ptr<PacketDescriptorPool> descriptor_pool)
+    : WrrScheduler(queue_configs, WrrOptions(), std::move(descriptor_pool)) {}
+
+WrrScheduler::WrrScheduler(const std::vector<QueueConfig>& queue_configs,
+                           const WrrOptions& options,
+                           std::shared_ptr<PacketDescriptorPool> descriptor_pool)
+    : options_(options), total_packets_(0) {
+    index_by_priority_.fill(NO_QUEUE);
+    if (options_.mode == WrrMode::BYTE && options_.bytes_per_weight == 0) {
+        throw std::invalid_argument("WRR Scheduler: bytes_per_weight must be greater than zero.");
+    }
     if (queue_configs.empty()) {
         throw std::invalid_argument("WRR Scheduler: queue_configs cannot be empty.");
     }
 
+    if (!descriptor_pool) {
+        uint64_t aggregate_capacity_bytes = 0;
+        for (const auto& qc : queue_configs) {
+            aggregate_capacity_bytes += aqm_queue_capacity_bytes(qc.aqm_params);
+        }
+        descriptor_pool = PacketDescriptorPool::create_for_bytes(aggregate_capacity_bytes);
+    }
+
     queues_.reserve(queue_configs.size());
     for (size_t i = 0; i < queue_configs.size(); ++i) {
         const auto& qc = queue_configs[i];
@@ -21,112 +42,184 @@ WrrScheduler::WrrScheduler(const std::vector<QueueConfig>& queue_configs)
             throw std::invalid_argument("WRR Scheduler: Duplicate QueueId " + std::to_string(qc.id) + " in configuration.");
         }
 
-        // Use the new InternalQueueState constructor that takes RedAqmParameters
-        // and initializes current_deficit to weight.
-        queues_.emplace_back(qc.id, qc.weight, qc.aqm_params);
+        // Credit is granted when the queue's turn starts, not here.
+        queues_.emplace_back(qc.id, qc.weight, qc.aqm_params, descriptor_pool);
         queue_id_to_index_[qc.id] = i; // Map external ID to vector index
+        if (qc.id < index_by_priority_.size()) {
+            index_by_priority_[qc.id] = i; // Reachable from PacketDescriptor::priority
+        }
     }
-    is_configured_ = true;
 }
 
-void WrrScheduler::enqueue(PacketDescriptor packet) {
-    if (!is_configured_) {
-        throw std::logic_error("WRR Scheduler: Not configured. Call constructor with queue configurations.");
+EnqueueResult WrrScheduler::enqueue(PacketDescriptor packet) {
+    // PacketDescriptor::priority is the QueueId: a direct lookup, no map search.
+    size_t index = index_by_priority_[packet.priority];
+    if (index == NO_QUEUE) {
+        core::PacketBufferPool::release_any(packet.buffer);
+        return EnqueueResult::DROPPED_NO_QUEUE;
     }
 
-    core::QueueId target_queue_external_id = static_cast<core::QueueId>(packet.priority);
-
-    auto it = queue_id_to_index_.find(target_queue_external_id);
-    if (it == queue_id_to_index_.end()) {
-        throw std::out_of_range("WRR Scheduler: QueueId " + std::to_string(target_queue_external_id) +
-                                " (from packet.priority) not configured for this scheduler.");
+    // Enqueue into the AQM queue; increment total_packets_ only if successful
+    InternalQueueState& q_state = queues_[index];
+    if (!q_state.packet_queue.enqueue(std::move(packet))) {
+        return EnqueueResult::DROPPED_BY_QUEUE; // Dropped by AQM, total_packets_ not incremented
     }
-
-    // Enqueue into RedAqmQueue; increment total_packets_ only if successful
-    if (queues_[it->second].packet_queue.enqueue(std::move(packet))) {
-        total_packets_++;
+    total_packets_++;
+    if (!q_state.is_active) {
+        push_active(active_, index); // Newly backlogged: joins the current round at the tail
     }
-    // If RedAqmQueue::enqueue returns false, packet was dropped by AQM, total_packets_ not incremented.
+    return EnqueueResult::ENQUEUED;
 }
 
-void WrrScheduler::replenish_all_deficits() {
-    for (InternalQueueState& q_state : queues_) {
-        q_state.current_deficit += static_cast<int32_t>(q_state.weight);
+void WrrScheduler::push_active(ActiveList& list, size_t internal_idx) {
+    InternalQueueState& q_state = queues_[internal_idx];
+    q_state.next_active = NO_QUEUE;
+    q_state.is_active = true;
+    q_state.turn_started = false;
+    if (list.tail == NO_QUEUE) {
+        list.head = internal_idx;
+    } else {
+        queues_[list.tail].next_active = internal_idx;
     }
+    list.tail = internal_idx;
 }
 
-PacketDescriptor WrrScheduler::dequeue() {
-    if (!is_configured_) {
-        throw std::logic_error("WRR Scheduler: Not configured.");
+size_t WrrScheduler::pop_active(ActiveList& list) {
+    size_t idx = list.head;
+    InternalQueueState& q_state = queues_[idx];
+    list.head = q_state.next_active;
+    if (list.head == NO_QUEUE) {
+        list.tail = NO_QUEUE;
     }
-    if (is_empty()) {
-        throw std::runtime_error("WRR Scheduler: Scheduler is empty, cannot dequeue.");
+    q_state.next_active = NO_QUEUE;
+    q_state.is_active = false;
+    return idx;
+}
+
+std::optional<PacketDescriptor> WrrScheduler::try_dequeue() {
+    if (total_packets_ == 0) {
+        return std::nullopt;
     }
 
-    size_t num_queues = queues_.size();
-    size_t queues_checked_this_round = 0;
-    bool deficits_replenished_this_attempt = false;
+    switch (options_.mode) {
+        case WrrMode::BYTE:
+            return dequeue_byte_mode();
+        case WrrMode::INTERLEAVED:
+            return dequeue_interleaved_mode();
+        case WrrMode::PACKET:
+        default:
+            return dequeue_packet_mode();
+    }
+}
 
-    while (true) { // Loop indefinitely until a packet is dequeued or an error state is identified
-        queues_checked_this_round = 0;
-        bool can_service_any_queue_in_current_state = false;
+PacketDescriptor WrrScheduler::dequeue_packet_mode() {
+    // The head queue keeps the turn for `weight` packets, then goes to the back.
+    size_t idx = active_.head;
+    InternalQueueState& q_state = queues_[idx];
+    if (!q_state.turn_started) {
+        q_state.current_deficit = q_state.weight;
+        q_state.turn_started = true;
+    }
 
-        for (size_t i = 0; i < num_queues; ++i) {
-            // Start check from current_queue_index_ and wrap around
-            size_t actual_index = (current_queue_index_ + i) % num_queues;
-            InternalQueueState& current_q_state = queues_[actual_index];
+    size_t queued_before = q_state.packet_queue.get_current_packet_count();
+    PacketDescriptor packet = q_state.packet_queue.dequeue();
+    q_state.current_deficit--;
+    total_packets_ -= queued_before - q_state.packet_queue.get_current_packet_count(); // CoDel may drop on dequeue
 
-            if (!current_q_state.packet_queue.is_empty() && current_q_state.current_deficit > 0) {
-                can_service_any_queue_in_current_state = true;
+    if (q_state.packet_queue.is_empty()) {
+        pop_active(active_); // Leaves the round until its next packet arrives
+    } else if (q_state.current_deficit == 0) {
+        push_active(active_, pop_active(active_)); // Turn over
+    }
+    return packet;
+}
 
-                // Dequeue from RedAqmQueue
-                PacketDescriptor packet = current_q_state.packet_queue.dequeue();
-                current_q_state.current_deficit--;
-                total_packets_--;
+PacketDescriptor WrrScheduler::dequeue_byte_mode() {
+    // Same turn structure as DrrScheduler, with weight * bytes_per_weight as the quantum.
+    for (;;) {
+        size_t idx = active_.head;
+        InternalQueueState& q_state = queues_[idx];
+        if (!q_state.turn_started) {
+            q_state.current_deficit += static_cast<int64_t>(q_state.weight) * options_.bytes_per_weight;
+            q_state.turn_started = true;
+        }
 
-                // Advance current_queue_index_ to the next queue for the next dequeue operation.
-                // WRR typically advances after a packet is sent, or after a queue empties its deficit.
-                // For simple packet WRR, advance after each packet.
-                current_queue_index_ = (actual_index + 1) % num_queues;
-                return packet;
+        uint32_t packet_len = q_state.packet_queue.front().packet_length_bytes;
+        if (q_state.current_deficit >= static_cast<int64_t>(packet_len)) {
+            size_t queued_before = q_state.packet_queue.get_current_packet_count();
+            PacketDescriptor packet = q_state.packet_queue.dequeue();
+            q_state.current_deficit -= packet.packet_length_bytes; // The packet sent, should CoDel drop the peeked one
+            total_packets_ -= queued_before - q_state.packet_queue.get_current_packet_count();
+            if (q_state.packet_queue.is_empty()) {
+                pop_active(active_);
+                q_state.current_deficit = 0; // An idle queue does not bank credit
             }
+            return packet;
         }
+        push_active(active_, pop_active(active_)); // Turn over; the deficit carries to the next one
+    }
+}
 
-        // If we've gone through all queues and couldn't service any (e.g. all non-empty queues have 0 deficit)
-        if (!can_service_any_queue_in_current_state) {
-            if (deficits_replenished_this_attempt) {
-                // This should not happen if there are packets. It means deficits were replenished,
-                // but still no queue could be serviced (e.g. all queues became empty simultaneously,
-                // but total_packets_ > 0, which is an inconsistency).
-                 throw std::logic_error("WRR Scheduler: Inconsistent state. Deficits replenished but no packet dequeued while not empty.");
-            }
-            replenish_all_deficits();
-            deficits_replenished_this_attempt = true; // Mark that we've tried replenishing in this dequeue call
-            // Restart the scan from current_queue_index_ (or 0 if preferred for strict round start)
-            // current_queue_index_ remains, so the next iteration of the while(true) loop will retry.
+PacketDescriptor WrrScheduler::dequeue_interleaved_mode() {
+    // A round is a sequence of passes over active_; each visit sends one packet. Queues
+    // that used their `weight` turns wait in next_round_ until active_ runs dry.
+    if (active_.empty()) {
+        std::swap(active_, next_round_);
+    }
+    size_t idx = active_.head;
+    InternalQueueState& q_state = queues_[idx];
+    if (!q_state.turn_started) {
+        q_state.current_deficit = q_state.weight;
+        q_state.turn_started = true; // Turns for the whole round, not per visit
+    }
+
+    size_t queued_before = q_state.packet_queue.get_current_packet_count();
+    PacketDescriptor packet = q_state.packet_queue.dequeue();
+    q_state.current_deficit--;
+    total_packets_ -= queued_before - q_state.packet_queue.get_current_packet_count(); // CoDel may drop on dequeue
+
+    pop_active(active_);
+    if (!q_state.packet_queue.is_empty()) {
+        if (q_state.current_deficit > 0) {
+            push_active(active_, idx);
+            q_state.turn_started = true; // Still within this round
         } else {
-            // This case should ideally not be hit if the inner loop correctly services a queue.
-            // If can_service_any_queue_in_current_state is true, a packet should have been returned.
-            // If it's false, the block above should have been hit.
-            // This is a safeguard.
+            push_active(next_round_, idx);
         }
-         // The while(true) loop continues, either after replenishing or if some logic error prevented dequeue.
     }
+    return packet;
 }
 
 
 bool WrrScheduler::is_empty() const {
-    if (!is_configured_) {
-        // Or return true, or handle as per desired semantics for unconfigured state
-        throw std::logic_error("WRR Scheduler: Not configured.");
-    }
     return total_packets_ == 0;
 }
 
-size_t WrrScheduler::get_queue_size(core::QueueId queue_id) const {
-    if (!is_configured_) {
-        throw std::logic_error("WRR Scheduler: Not configured.");
+size_t WrrScheduler::enqueue_burst(PacketDescriptor* packets, size_t count) {
+    size_t enqueued = 0;
+    for (size_t i = 0; i < count; ++i) {
+        // Qualified call: no per-packet virtual dispatch
+        if (WrrScheduler::enqueue(std::move(packets[i])) == EnqueueResult::ENQUEUED) {
+            ++enqueued;
+        }
+    }
+    return enqueued;
+}
+
+size_t WrrScheduler::dequeue_burst(std::vector<PacketDescriptor>& out, size_t max_packets) {
+    size_t dequeued = 0;
+    while (dequeued < max_packets) {
+        std::optional<PacketDescriptor> packet = WrrScheduler::try_dequeue();
+        if (!packet) {
+            break;
+        }
+        out.push_back(*packet);
+        ++dequeued;
     }
+    return dequeued;
+}
+
+size_t WrrScheduler::get_queue_size(core::QueueId queue_id) const {
     auto it = queue_id_to_index_.find(queue_id);
     if (it == queue_id_to_index_.end()) {
         throw std::out_of_range("WRR Scheduler: QueueId " + std::to_string(queue_id) + " not configured.");
@@ -134,13 +227,31 @@ size_t WrrScheduler::get_queue_size(core::QueueId queue_id) const {
     return queues_[it->second].packet_queue.get_current_packet_count();
 }
 
-size_t WrrScheduler::get_num_queues() const {
-    if (!is_configured_) {
-        // Or return 0, or handle as per desired semantics for unconfigured state
-        throw std::logic_error("WRR Scheduler: Not configured.");
+void WrrScheduler::enable_latency_histograms() {
+    for (InternalQueueState& queue : queues_) {
+        queue.packet_queue.enable_latency_histogram();
+    }
+}
+
+LatencySnapshot WrrScheduler::get_queue_latency(core::QueueId queue_id) const {
+    auto it = queue_id_to_index_.find(queue_id);
+    if (it == queue_id_to_index_.end()) {
+        throw std::out_of_range("WRR Scheduler: QueueId " + std::to_string(queue_id) + " not configured.");
+    }
+    const LatencyHistogram* histogram = queues_[it->second].packet_queue.latency_histogram();
+    return histogram != nullptr ? histogram->snapshot() : LatencySnapshot();
+}
+
+size_t WrrScheduler::collect_queue_stats(std::vector<QueueStatsSample>& out) const {
+    for (const InternalQueueState& queue : queues_) {
+        out.push_back(queue.packet_queue.stats_sample(queue.external_id));
     }
     return queues_.size();
 }
 
+size_t WrrScheduler::get_num_queues() const {
+    return queues_.size();
+}
+
 } // namespace scheduler
 } // namespace hqts
@@ -0,0 +1,98 @@
+#include "benchmark/benchmark.h"
+#include "hqts/dataplane/flow_classifier.h"
+#include "hqts/core/flow_context.h" // For core::FlowTable, core::FlowId
+#include "benchmark_util.h"
+
+#include <cstddef> // For size_t
+#include <vector>
+
+namespace hqts {
+namespace benchmarks {
+
+namespace {
+
+constexpr policy::PolicyId BENCHMARK_DEFAULT_POLICY = 1;
+
+// Flow counts from a cache-resident table to one far larger than the LLC.
+void flowCounts(benchmark::internal::Benchmark* benchmark) {
+    for (int64_t flows : {1000, 100000, 1000000, 10000000}) {
+        benchmark->Arg(flows);
+    }
+}
+
+} // namespace
+
+// Every lookup finds an existing flow; flows are visited in a shuffled order.
+static void BM_FlowClassifierHit(benchmark::State& state) {
+    size_t num_flows = static_cast<size_t>(state.range(0));
+    core::FlowTable table(num_flows);
+    dataplane::FlowClassifier classifier(table, BENCHMARK_DEFAULT_POLICY);
+    std::vector<dataplane::FiveTuple> tuples = flow_tuples(num_flows);
+    for (const dataplane::FiveTuple& tuple : tuples) {
+        classifier.get_or_create_flow(tuple);
+    }
+
+    std::vector<size_t> order(1u << 16);
+    uint64_t seed = 0x9E3779B97F4A7C15ull;
+    for (size_t& index : order) {
+        index = static_cast<size_t>(next_random(seed) % num_flows);
+    }
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(classifier.get_or_create_flow(tuples[order[i]]));
+        i = (i + 1) & (order.size() - 1);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FlowClassifierHit)->Apply(flowCounts);
+
+// Every lookup inserts a new flow; the table is cleared (untimed) when full.
+static void BM_FlowClassifierMiss(benchmark::State& state) {
+    size_t num_flows = static_cast<size_t>(state.range(0));
+    core::FlowTable table(num_flows);
+    dataplane::FlowClassifier classifier(table, BENCHMARK_DEFAULT_POLICY);
+    std::vector<dataplane::FiveTuple> tuples = flow_tuples(num_flows);
+    size_t i = 0;
+    for (auto _ : state) {
+        if (i == num_flows) {
+            state.PauseTiming();
+            table.clear();
+            i = 0;
+            state.ResumeTiming();
+        }
+        benchmark::DoNotOptimize(classifier.get_or_create_flow(tuples[i++]));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FlowClassifierMiss)->Apply(flowCounts);
+
+// Burst lookups of existing flows (hashing and prefetching LOOKUP_BATCH keys at a time).
+static void BM_FlowClassifierHitBurst(benchmark::State& state) {
+    constexpr size_t BURST = 32;
+    size_t num_flows = static_cast<size_t>(state.range(0));
+    core::FlowTable table(num_flows);
+    dataplane::FlowClassifier classifier(table, BENCHMARK_DEFAULT_POLICY);
+    std::vector<dataplane::FiveTuple> tuples = flow_tuples(num_flows);
+    for (const dataplane::FiveTuple& tuple : tuples) {
+        classifier.get_or_create_flow(tuple);
+    }
+
+    // A shuffled lookup sequence, consumed BURST tuples at a time.
+    std::vector<dataplane::FiveTuple> lookups(1u << 16);
+    uint64_t seed = 0x2545F4914F6CDD1Dull;
+    for (dataplane::FiveTuple& tuple : lookups) {
+        tuple = tuples[static_cast<size_t>(next_random(seed) % num_flows)];
+    }
+    std::vector<core::FlowId> flow_ids(BURST);
+    size_t offset = 0;
+    for (auto _ : state) {
+        classifier.get_or_create_flows(lookups.data() + offset, BURST, flow_ids.data());
+        benchmark::DoNotOptimize(flow_ids.data());
+        offset = (offset + BURST) & (lookups.size() - 1);
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(BURST));
+}
+BENCHMARK(BM_FlowClassifierHitBurst)->Apply(flowCounts);
+
+} // namespace benchmarks
+} // namespace hqts
@@ -0,0 +1,102 @@
+#include "benchmark/benchmark.h"
+#include "hqts/core/packet_pipeline.h"
+#include "hqts/core/traffic_shaper.h"
+#include "hqts/core/shaping_policy.h"       // For ShapingPolicy
+#include "hqts/core/flow_context.h"         // For core::FlowTable
+#include "hqts/dataplane/flow_classifier.h"
+#include "hqts/policy/policy_tree.h"
+#include "hqts/scheduler/drr_scheduler.h"
+#include "hqts/scheduler/aqm_queue.h"       // For RedAqmParameters
+#include "benchmark_util.h"
+
+#include <algorithm> // For std::sort
+#include <chrono>
+#include <cstddef>   // For size_t
+#include <cstdint>
+#include <vector>
+
+namespace hqts {
+namespace benchmarks {
+
+namespace {
+
+constexpr policy::PolicyId PIPELINE_BENCHMARK_POLICY = 1;
+constexpr size_t PIPELINE_NUM_QUEUES = 8;
+
+/// Value at quantile q (0..1) of `samples`, which is sorted in place.
+double quantile(std::vector<int64_t>& samples, double q) {
+    if (samples.empty()) {
+        return 0.0;
+    }
+    std::sort(samples.begin(), samples.end());
+    size_t index = static_cast<size_t>(q * static_cast<double>(samples.size() - 1));
+    return static_cast<double>(samples[index]);
+}
+
+} // namespace
+
+/**
+ * End to end: a burst of range(2) packets over range(0) flows is classified, metered and
+ * enqueued, and the same number is dequeued. Reports packets per second and the
+ * p50/p99 wall time of one ingress-plus-egress burst, and in a profiling build the cycles
+ * per packet of each stage; run with --benchmark_out to track them as JSON.
+ */
+static void BM_PacketPipelineBurst(benchmark::State& state) {
+    size_t num_flows = static_cast<size_t>(state.range(0));
+    size_t burst_size = static_cast<size_t>(state.range(2));
+
+    policy::PolicyTree policies;
+    policies.insert(core::ShapingPolicy(PIPELINE_BENCHMARK_POLICY, policy::NO_PARENT_POLICY_ID, "benchmark",
+                                        100000000000ull, 200000000000ull, 1u << 30, 1u << 30,
+                                        policy::SchedulingAlgorithm::DRR, 100, 0, false, 2, 1, 0, 0, 0, 0));
+    core::FlowTable table(num_flows);
+    dataplane::FlowClassifier classifier(table, PIPELINE_BENCHMARK_POLICY);
+    core::TrafficShaper shaper(policies, classifier, table);
+    std::vector<scheduler::DrrScheduler::QueueConfig> queues;
+    for (size_t i = 0; i < PIPELINE_NUM_QUEUES; ++i) {
+        queues.emplace_back(static_cast<core::QueueId>(i), 1500, permissive_red(1u << 20));
+    }
+    scheduler::DrrScheduler scheduler(queues);
+    core::PacketPipeline pipeline(classifier, shaper, scheduler);
+
+    std::vector<dataplane::FiveTuple> tuples = flow_tuples(num_flows);
+    std::vector<uint32_t> lengths = packet_lengths(state.range(1));
+    std::vector<core::IncomingPacket> burst(burst_size);
+    std::vector<scheduler::PacketDescriptor> out;
+    out.reserve(burst_size);
+    std::vector<int64_t> burst_latency_ns;
+    burst_latency_ns.reserve(1u << 20);
+
+    uint64_t seed = 0x9E3779B97F4A7C15ull;
+    core::TimestampNs now_ns = 0;
+    size_t next_length = 0;
+    int64_t transmitted = 0;
+    core::StageCycleCounters stage_cycles; // Filled in HQTS_ENABLE_PROFILING builds
+    core::StageCycleCounters* unbound = core::bind_stage_counters(&stage_cycles);
+    for (auto _ : state) {
+        for (core::IncomingPacket& packet : burst) {
+            packet = core::IncomingPacket(tuples[static_cast<size_t>(next_random(seed) % num_flows)],
+                                          lengths[next_length++ % lengths.size()]);
+        }
+        now_ns += 1000;
+        auto start = std::chrono::steady_clock::now();
+        pipeline.handle_incoming_burst(burst, now_ns);
+        out.clear();
+        transmitted += static_cast<int64_t>(pipeline.get_next_burst(out, burst_size, now_ns));
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        if (burst_latency_ns.size() < burst_latency_ns.capacity()) {
+            burst_latency_ns.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        }
+    }
+    state.counters["pps"] = benchmark::Counter(static_cast<double>(transmitted), benchmark::Counter::kIsRate);
+    state.counters["burst_p50_ns"] = quantile(burst_latency_ns, 0.50);
+    state.counters["burst_p99_ns"] = quantile(burst_latency_ns, 0.99);
+    core::bind_stage_counters(unbound);
+    report_stage_cycles(state, stage_cycles);
+}
+BENCHMARK(BM_PacketPipelineBurst)
+    ->ArgNames({"flows", "size_mix", "burst"})
+    ->ArgsProduct({{1000, 100000}, {SIZE_MIX_SMALL, SIZE_MIX_IMIX}, {1, 32, 256}});
+
+} // namespace benchmarks
+} // namespace hqts
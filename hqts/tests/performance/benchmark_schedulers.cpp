@@ -0,0 +1,247 @@
+#include "benchmark/benchmark.h"
+#include "hqts/scheduler/strict_priority_scheduler.h"
+#include "hqts/scheduler/drr_scheduler.h"
+#include "hqts/scheduler/wrr_scheduler.h"
+#include "hqts/scheduler/hfsc_scheduler.h"
+#include "hqts/scheduler/wfq_scheduler.h"
+#include "hqts/scheduler/scheduler_tree.h"
+#include "hqts/scheduler/static_scheduler.h"
+#include "hqts/scheduler/aqm_queue.h"              // For RedAqmQueue, RedAqmParameters
+#include "hqts/scheduler/packet_descriptor_pool.h" // For PacketDescriptorPool
+#include "hqts/core/shaping_policy.h"              // For ShapingPolicy (SchedulerTree)
+#include "hqts/policy/policy_tree.h"
+#include "benchmark_util.h"
+
+#include <cstddef> // For size_t
+#include <cstdint>
+#include <memory>  // For std::make_shared
+#include <string>  // For std::to_string
+#include <vector>
+
+namespace hqts {
+namespace benchmarks {
+
+namespace {
+
+// Packets queued per queue before timing starts; every iteration then enqueues one
+// packet into a random queue and dequeues one, so the backlog stays constant.
+constexpr size_t PREFILL_PER_QUEUE = 8;
+
+std::shared_ptr<scheduler::PacketDescriptorPool> steadyStatePool(size_t num_queues) {
+    return std::make_shared<scheduler::PacketDescriptorPool>(num_queues * (PREFILL_PER_QUEUE + 2));
+}
+
+/**
+ * Runs the steady-state loop. `enqueue(queue_index, packet)` queues a packet for the
+ * queue_index-th configured queue; `dequeue()` returns whether a packet came out.
+ */
+template <typename Enqueue, typename Dequeue>
+void runSteadyState(benchmark::State& state, size_t num_queues, Enqueue enqueue, Dequeue dequeue) {
+    std::vector<uint32_t> lengths = packet_lengths(state.range(1));
+    size_t next_length = 0;
+    for (size_t queue = 0; queue < num_queues; ++queue) {
+        for (size_t i = 0; i < PREFILL_PER_QUEUE; ++i) {
+            enqueue(queue, scheduler::PacketDescriptor(queue, lengths[next_length++ % lengths.size()]));
+        }
+    }
+
+    uint64_t seed = 0x9E3779B97F4A7C15ull;
+    for (auto _ : state) {
+        size_t queue = static_cast<size_t>(next_random(seed) % num_queues);
+        enqueue(queue, scheduler::PacketDescriptor(queue, lengths[next_length++ % lengths.size()]));
+        benchmark::DoNotOptimize(dequeue());
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["queues"] = static_cast<double>(num_queues);
+}
+
+std::vector<scheduler::AqmParameters> permissiveLevels(size_t count) {
+    return std::vector<scheduler::AqmParameters>(count, permissive_red(1u << 16));
+}
+
+} // namespace
+
+static void BM_StrictPrioritySteadyState(benchmark::State& state) {
+    size_t num_queues = static_cast<size_t>(state.range(0));
+    scheduler::StrictPriorityScheduler scheduler(permissiveLevels(num_queues), steadyStatePool(num_queues));
+    runSteadyState(
+        state, num_queues,
+        [&](size_t queue, scheduler::PacketDescriptor packet) {
+            packet.priority = static_cast<uint8_t>(queue);
+            scheduler.enqueue(packet);
+        },
+        [&] { return scheduler.try_dequeue().has_value(); });
+}
+BENCHMARK(BM_StrictPrioritySteadyState)
+    ->ArgNames({"queues", "size_mix"})
+    ->ArgsProduct({{2, 8, 64}, {SIZE_MIX_SMALL, SIZE_MIX_IMIX}});
+
+static void BM_DrrSteadyState(benchmark::State& state) {
+    size_t num_queues = static_cast<size_t>(state.range(0));
+    std::vector<scheduler::DrrScheduler::QueueConfig> configs;
+    for (size_t i = 0; i < num_queues; ++i) {
+        configs.emplace_back(static_cast<core::QueueId>(i), 1500, permissive_red(1u << 16));
+    }
+    scheduler::DrrScheduler scheduler(configs, steadyStatePool(num_queues));
+    runSteadyState(
+        state, num_queues,
+        [&](size_t queue, scheduler::PacketDescriptor packet) {
+            packet.priority = static_cast<uint8_t>(queue);
+            scheduler.enqueue(packet);
+        },
+        [&] { return scheduler.try_dequeue().has_value(); });
+}
+BENCHMARK(BM_DrrSteadyState)
+    ->ArgNames({"queues", "size_mix"})
+    ->ArgsProduct({{8, 64, 256}, {SIZE_MIX_SMALL, SIZE_MIX_IMIX}});
+
+static void BM_WrrSteadyState(benchmark::State& state) {
+    size_t num_queues = static_cast<size_t>(state.range(0));
+    std::vector<scheduler::WrrScheduler::QueueConfig> configs;
+    for (size_t i = 0; i < num_queues; ++i) {
+        configs.emplace_back(static_cast<core::QueueId>(i), 1 + static_cast<uint32_t>(i % 4), permissive_red(1u << 16));
+    }
+    scheduler::WrrScheduler scheduler(configs, steadyStatePool(num_queues));
+    runSteadyState(
+        state, num_queues,
+        [&](size_t queue, scheduler::PacketDescriptor packet) {
+            packet.priority = static_cast<uint8_t>(queue);
+            scheduler.enqueue(packet);
+        },
+        [&] { return scheduler.try_dequeue().has_value(); });
+}
+BENCHMARK(BM_WrrSteadyState)
+    ->ArgNames({"queues", "size_mix"})
+    ->ArgsProduct({{8, 64, 256}, {SIZE_MIX_SMALL, SIZE_MIX_IMIX}});
+
+// WF2Q+ against DRR above; enqueue_to_queue() also reaches the larger queue counts.
+static void BM_WfqSteadyState(benchmark::State& state) {
+    size_t num_queues = static_cast<size_t>(state.range(0));
+    std::vector<scheduler::WfqScheduler::QueueConfig> configs;
+    for (size_t i = 0; i < num_queues; ++i) {
+        configs.emplace_back(static_cast<core::QueueId>(i), 1 + static_cast<uint32_t>(i % 4), permissive_red(1u << 16));
+    }
+    scheduler::WfqScheduler scheduler(configs, steadyStatePool(num_queues));
+    runSteadyState(
+        state, num_queues,
+        [&](size_t queue, scheduler::PacketDescriptor packet) {
+            scheduler.enqueue_to_queue(static_cast<core::QueueId>(queue), packet);
+        },
+        [&] { return scheduler.try_dequeue().has_value(); });
+}
+BENCHMARK(BM_WfqSteadyState)
+    ->ArgNames({"queues", "size_mix"})
+    ->ArgsProduct({{8, 64, 256, 1024, 16384}, {SIZE_MIX_SMALL, SIZE_MIX_IMIX}});
+
+static void BM_HfscSteadyState(benchmark::State& state) {
+    constexpr uint64_t LINK_BPS = 10000000000ull;
+    size_t num_queues = static_cast<size_t>(state.range(0));
+    std::vector<scheduler::HfscScheduler::FlowConfig> configs;
+    for (size_t i = 0; i < num_queues; ++i) {
+        // Half the link guaranteed in real time, the rest link-shared.
+        configs.emplace_back(static_cast<core::FlowId>(i + 1), 0, scheduler::ServiceCurve(LINK_BPS / 2 / num_queues, 0),
+                             scheduler::ServiceCurve(LINK_BPS / num_queues, 0));
+    }
+    scheduler::HfscScheduler scheduler(configs, LINK_BPS, steadyStatePool(num_queues));
+    runSteadyState(
+        state, num_queues,
+        [&](size_t queue, scheduler::PacketDescriptor packet) {
+            scheduler.enqueue_to_class(static_cast<core::FlowId>(queue + 1), packet);
+        },
+        [&] { return scheduler.try_dequeue().has_value(); });
+}
+BENCHMARK(BM_HfscSteadyState)
+    ->ArgNames({"queues", "size_mix"})
+    ->ArgsProduct({{8, 64, 1024}, {SIZE_MIX_SMALL, SIZE_MIX_IMIX}});
+
+// Two-level SchedulerTree: DRR port over 8 tenants, each a WFQ node over its leaves.
+static void BM_SchedulerTreeSteadyState(benchmark::State& state) {
+    constexpr policy::PolicyId TENANTS = 8;
+    size_t num_queues = static_cast<size_t>(state.range(0));
+    policy::PolicyTree policies;
+    for (policy::PolicyId tenant = 1; tenant <= TENANTS; ++tenant) {
+        policies.insert(core::ShapingPolicy(tenant, policy::NO_PARENT_POLICY_ID, "tenant_" + std::to_string(tenant),
+                                            1000000000ull, 0, 10000, 0, policy::SchedulingAlgorithm::WFQ, 100, 0));
+    }
+    std::vector<policy::PolicyId> leaves;
+    for (size_t i = 0; i < num_queues; ++i) {
+        policy::PolicyId leaf = TENANTS + 1 + static_cast<policy::PolicyId>(i);
+        policies.insert(core::ShapingPolicy(leaf, 1 + static_cast<policy::PolicyId>(i % TENANTS),
+                                            "leaf_" + std::to_string(leaf), 1000000ull, 0, 10000, 0,
+                                            policy::SchedulingAlgorithm::DRR, 1 + static_cast<uint32_t>(i % 4), 0));
+        leaves.push_back(leaf);
+    }
+    scheduler::SchedulerTree tree(policies, permissive_red(1u << 16), policy::SchedulingAlgorithm::DRR,
+                                  scheduler::SchedulerTree::DEFAULT_QUANTUM_BYTES_PER_WEIGHT,
+                                  steadyStatePool(num_queues));
+    runSteadyState(
+        state, num_queues,
+        [&](size_t queue, scheduler::PacketDescriptor packet) {
+            packet.policy_id = leaves[queue];
+            tree.enqueue(packet);
+        },
+        [&] { return tree.try_dequeue().has_value(); });
+}
+BENCHMARK(BM_SchedulerTreeSteadyState)
+    ->ArgNames({"queues", "size_mix"})
+    ->ArgsProduct({{8, 64, 1024}, {SIZE_MIX_SMALL, SIZE_MIX_IMIX}});
+
+// Compile-time counterpart of BM_StrictPrioritySteadyState/8: no virtual calls.
+static void BM_StaticStrictPrioritySteadyState(benchmark::State& state) {
+    using Levels = scheduler::StaticStrictPriority<scheduler::StaticQueue<scheduler::RedAqmQueue>, 8,
+                                                   scheduler::PriorityBits<0, 3>>;
+    Levels::Config levels = {{permissive_red(1u << 16), permissive_red(1u << 16), permissive_red(1u << 16),
+                              permissive_red(1u << 16), permissive_red(1u << 16), permissive_red(1u << 16),
+                              permissive_red(1u << 16), permissive_red(1u << 16)}};
+    scheduler::StaticScheduler<Levels> scheduler(levels);
+    runSteadyState(
+        state, 8,
+        [&](size_t queue, scheduler::PacketDescriptor packet) {
+            packet.priority = static_cast<uint8_t>(queue);
+            scheduler.enqueue(packet);
+        },
+        [&] { return scheduler.try_dequeue().has_value(); });
+}
+BENCHMARK(BM_StaticStrictPrioritySteadyState)
+    ->ArgNames({"queues", "size_mix"})
+    ->ArgsProduct({{8}, {SIZE_MIX_SMALL, SIZE_MIX_IMIX}});
+
+// One RED queue held at a fixed occupancy (range(0) packets); below min_threshold
+// every arrival is accepted after one compare.
+static void BM_RedAqmQueueSteadyState(benchmark::State& state) {
+    size_t occupancy = static_cast<size_t>(state.range(0));
+    std::vector<uint32_t> lengths = packet_lengths(state.range(1));
+    scheduler::RedAqmQueue queue(permissive_red(1u << 24),
+                                 std::make_shared<scheduler::PacketDescriptorPool>(occupancy + 2));
+    size_t next_length = 0;
+    for (size_t i = 0; i < occupancy; ++i) {
+        queue.enqueue(scheduler::PacketDescriptor(1, lengths[next_length++ % lengths.size()]));
+    }
+    for (auto _ : state) {
+        queue.enqueue(scheduler::PacketDescriptor(1, lengths[next_length++ % lengths.size()]));
+        benchmark::DoNotOptimize(queue.dequeue());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RedAqmQueueSteadyState)
+    ->ArgNames({"occupancy", "size_mix"})
+    ->ArgsProduct({{1, 64, 4096}, {SIZE_MIX_SMALL, SIZE_MIX_IMIX, SIZE_MIX_LARGE}});
+
+// A queue held between its thresholds: every arrival runs the drop-probability path.
+static void BM_RedAqmQueueInDropRegion(benchmark::State& state) {
+    scheduler::RedAqmParameters params(10000, 1000000, 0.01, 0.5, 2000000);
+    scheduler::RedAqmQueue queue(params, std::make_shared<scheduler::PacketDescriptorPool>(4096));
+    for (int i = 0; i < 200; ++i) {
+        queue.enqueue(scheduler::PacketDescriptor(1, 1000)); // 200 KB queued: above min_threshold
+    }
+    for (auto _ : state) {
+        if (queue.enqueue(scheduler::PacketDescriptor(1, 1000))) {
+            benchmark::DoNotOptimize(queue.dequeue());
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RedAqmQueueInDropRegion);
+
+} // namespace benchmarks
+} // namespace hqts
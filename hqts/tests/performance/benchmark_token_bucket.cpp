@@ -0,0 +1,45 @@
+#include "benchmark/benchmark.h"
+#include "hqts/core/token_bucket.h"
+#include "hqts/core/time_source.h" // For core::TimestampNs
+
+#include <cstdint>
+
+namespace hqts {
+namespace benchmarks {
+
+// Conforming traffic: the bucket never runs dry, every consume() succeeds.
+static void BM_TokenBucketConsumeConforming(benchmark::State& state) {
+    core::TokenBucket bucket(100000000000ull, 1u << 30, 0); // 100 Gbit/s, 1 GiB burst
+    core::TimestampNs now_ns = 0;
+    for (auto _ : state) {
+        now_ns += 100; // One 64-byte packet every 100 ns is well under the rate
+        benchmark::DoNotOptimize(bucket.consume(64, now_ns));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TokenBucketConsumeConforming);
+
+// Overloaded bucket: most consume() calls fail after the refill.
+static void BM_TokenBucketConsumeExceeding(benchmark::State& state) {
+    core::TokenBucket bucket(1000000, 1500, 0); // 1 Mbit/s, one MTU of burst
+    core::TimestampNs now_ns = 0;
+    for (auto _ : state) {
+        now_ns += 100;
+        benchmark::DoNotOptimize(bucket.consume(1500, now_ns));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TokenBucketConsumeExceeding);
+
+// Clock read inside consume() instead of a caller-supplied timestamp.
+static void BM_TokenBucketConsumeReadingClock(benchmark::State& state) {
+    core::TokenBucket bucket(100000000000ull, 1u << 30);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(bucket.consume(64));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TokenBucketConsumeReadingClock);
+
+} // namespace benchmarks
+} // namespace hqts
@@ -0,0 +1,87 @@
+#include "benchmark/benchmark.h"
+#include "hqts/core/traffic_shaper.h"
+#include "hqts/core/shaping_policy.h"       // For ShapingPolicy
+#include "hqts/core/flow_context.h"         // For core::FlowTable
+#include "hqts/dataplane/flow_classifier.h"
+#include "hqts/policy/policy_tree.h"
+#include "benchmark_util.h"
+
+#include <cstddef> // For size_t
+#include <vector>
+
+namespace hqts {
+namespace benchmarks {
+
+namespace {
+
+constexpr policy::PolicyId SHAPER_BENCHMARK_POLICY = 1;
+constexpr size_t SHAPER_BENCHMARK_BURST = 32;
+
+/// Classifier, shaper and pre-created flows, all metered against one 100 Gbit/s policy.
+struct ShaperFixture {
+    policy::PolicyTree policies;
+    core::FlowTable table;
+    dataplane::FlowClassifier classifier;
+    core::TrafficShaper shaper;
+    std::vector<dataplane::FiveTuple> tuples;
+
+    explicit ShaperFixture(size_t num_flows)
+        : policies(make_policies()), table(num_flows), classifier(table, SHAPER_BENCHMARK_POLICY),
+          shaper(policies, classifier, table), tuples(flow_tuples(num_flows)) {
+        for (const dataplane::FiveTuple& tuple : tuples) {
+            classifier.get_or_create_flow(tuple);
+        }
+    }
+
+    static policy::PolicyTree make_policies() {
+        policy::PolicyTree tree;
+        tree.insert(core::ShapingPolicy(SHAPER_BENCHMARK_POLICY, policy::NO_PARENT_POLICY_ID, "benchmark",
+                                        100000000000ull, 200000000000ull, 1u << 30, 1u << 30,
+                                        policy::SchedulingAlgorithm::DRR, 100, 0, false, 2, 1, 0, 0, 0, 0));
+        return tree;
+    }
+};
+
+} // namespace
+
+static void BM_TrafficShaperProcessPacket(benchmark::State& state) {
+    ShaperFixture fixture(static_cast<size_t>(state.range(0)));
+    std::vector<uint32_t> lengths = packet_lengths(state.range(1));
+    core::TimestampNs now_ns = 0;
+    size_t i = 0;
+    for (auto _ : state) {
+        scheduler::PacketDescriptor packet(0, lengths[i % lengths.size()], 0);
+        now_ns += 10;
+        benchmark::DoNotOptimize(fixture.shaper.process_packet(packet, fixture.tuples[i % fixture.tuples.size()], now_ns));
+        ++i;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TrafficShaperProcessPacket)
+    ->ArgNames({"flows", "size_mix"})
+    ->ArgsProduct({{1000, 100000, 1000000}, {SIZE_MIX_SMALL, SIZE_MIX_IMIX}});
+
+static void BM_TrafficShaperProcessBurst(benchmark::State& state) {
+    ShaperFixture fixture(static_cast<size_t>(state.range(0)));
+    std::vector<uint32_t> lengths = packet_lengths(state.range(1));
+    std::vector<scheduler::PacketDescriptor> packets(SHAPER_BENCHMARK_BURST);
+    std::vector<dataplane::FiveTuple> burst_tuples(SHAPER_BENCHMARK_BURST);
+    core::TimestampNs now_ns = 0;
+    size_t next = 0;
+    for (auto _ : state) {
+        for (size_t j = 0; j < SHAPER_BENCHMARK_BURST; ++j, ++next) {
+            packets[j] = scheduler::PacketDescriptor(0, lengths[next % lengths.size()], 0);
+            burst_tuples[j] = fixture.tuples[next % fixture.tuples.size()];
+        }
+        now_ns += 320;
+        benchmark::DoNotOptimize(
+            fixture.shaper.process_burst(packets.data(), burst_tuples.data(), SHAPER_BENCHMARK_BURST, now_ns));
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(SHAPER_BENCHMARK_BURST));
+}
+BENCHMARK(BM_TrafficShaperProcessBurst)
+    ->ArgNames({"flows", "size_mix"})
+    ->ArgsProduct({{1000, 100000, 1000000}, {SIZE_MIX_SMALL, SIZE_MIX_IMIX}});
+
+} // namespace benchmarks
+} // namespace hqts
@@ -0,0 +1,79 @@
+#ifndef HQTS_TESTS_PERFORMANCE_BENCHMARK_UTIL_H_
+#define HQTS_TESTS_PERFORMANCE_BENCHMARK_UTIL_H_
+
+#include "benchmark/benchmark.h"
+#include "hqts/core/stage_profiler.h"        // For StageCycleCounters
+#include "hqts/dataplane/flow_identifier.h"   // For dataplane::FiveTuple
+#include "hqts/scheduler/aqm_queue.h"         // For RedAqmParameters
+#include "hqts/scheduler/packet_descriptor.h" // For PacketDescriptor
+
+#include <cstddef> // For size_t
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace hqts {
+namespace benchmarks {
+
+/// Packet-size mixes selected by a benchmark's size-mix argument.
+enum SizeMix : int64_t {
+    SIZE_MIX_SMALL = 0, // 64-byte packets only
+    SIZE_MIX_IMIX = 1,  // Simple IMIX: 64, 576 and 1500 bytes in a 7:4:1 ratio
+    SIZE_MIX_LARGE = 2  // 1500-byte packets only
+};
+
+/// A repeating sequence of packet lengths following `mix`; its length is a multiple of 12.
+inline std::vector<uint32_t> packet_lengths(int64_t mix, size_t count = 1200) {
+    static const uint32_t IMIX_PATTERN[12] = {64, 576, 64, 64, 1500, 64, 576, 64, 64, 576, 64, 576};
+    std::vector<uint32_t> lengths(count);
+    for (size_t i = 0; i < count; ++i) {
+        switch (mix) {
+            case SIZE_MIX_SMALL: lengths[i] = 64; break;
+            case SIZE_MIX_LARGE: lengths[i] = 1500; break;
+            default: lengths[i] = IMIX_PATTERN[i % 12]; break;
+        }
+    }
+    return lengths;
+}
+
+/// Distinct 5-tuples for flows 0..count-1.
+inline std::vector<dataplane::FiveTuple> flow_tuples(size_t count) {
+    std::vector<dataplane::FiveTuple> tuples;
+    tuples.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t flow = static_cast<uint32_t>(i);
+        tuples.emplace_back(0x0A000000u + (flow >> 16), 0x0B000001u, static_cast<uint16_t>(1024 + (flow & 0xFFFF)),
+                            80, 6);
+    }
+    return tuples;
+}
+
+/// RED parameters that never drop below `capacity_bytes`, so benchmarks measure the fast path.
+inline scheduler::RedAqmParameters permissive_red(uint32_t capacity_bytes = 1u << 20) {
+    return scheduler::RedAqmParameters(capacity_bytes / 10 * 8, capacity_bytes / 10 * 9, 0.001, 0.002, capacity_bytes);
+}
+
+/// Deterministic xorshift sequence: benchmark inputs are reproducible run to run.
+inline uint64_t next_random(uint64_t& state) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+/// Reports "<stage>_cycles_per_pkt" for every stage that ran. Only an
+/// HQTS_ENABLE_PROFILING build fills the counters; otherwise nothing is reported.
+inline void report_stage_cycles(benchmark::State& state, const core::StageCycleCounters& counters) {
+    for (size_t i = 0; i < core::PROFILE_STAGE_COUNT; ++i) {
+        const auto stage = static_cast<core::ProfileStage>(i);
+        if (counters.packets[i].load(std::memory_order_relaxed) != 0) {
+            state.counters[std::string(core::profile_stage_name(stage)) + "_cycles_per_pkt"] =
+                counters.cycles_per_packet(stage);
+        }
+    }
+}
+
+} // namespace benchmarks
+} // namespace hqts
+
+#endif // HQTS_TESTS_PERFORMANCE_BENCHMARK_UTIL_H_
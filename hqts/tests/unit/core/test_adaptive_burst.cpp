@@ -0,0 +1,49 @@
+#include "gtest/gtest.h"
+#include "hqts/core/adaptive_burst.h"
+
+#include <stdexcept>
+
+namespace hqts {
+namespace core {
+
+TEST(AdaptiveBurstSizeTest, GrowsWhileFullAndShrinksWhenDrained) {
+    AdaptiveBurstSize burst(4, 32);
+    ASSERT_EQ(burst.current(), 4u);
+
+    burst.record(4);
+    ASSERT_EQ(burst.current(), 8u);
+    burst.record(8);
+    burst.record(16);
+    ASSERT_EQ(burst.current(), 32u);
+    burst.record(32);
+    ASSERT_EQ(burst.current(), 32u); // Capped
+
+    burst.record(10); // Between a quarter and full: unchanged
+    ASSERT_EQ(burst.current(), 32u);
+    burst.record(7);
+    ASSERT_EQ(burst.current(), 16u);
+    burst.record(0);
+    burst.record(0);
+    burst.record(0);
+    ASSERT_EQ(burst.current(), 4u); // Floored
+}
+
+TEST(AdaptiveBurstSizeTest, CapsAtMaximumThatIsNotAPowerOfTwo) {
+    AdaptiveBurstSize burst(3, 20);
+    burst.record(3);
+    burst.record(6);
+    ASSERT_EQ(burst.current(), 12u);
+    burst.record(12);
+    ASSERT_EQ(burst.current(), 20u);
+
+    AdaptiveBurstSize fixed(8, 8);
+    fixed.record(8);
+    fixed.record(0);
+    ASSERT_EQ(fixed.current(), 8u);
+
+    ASSERT_THROW(AdaptiveBurstSize(0, 8), std::invalid_argument);
+    ASSERT_THROW(AdaptiveBurstSize(9, 8), std::invalid_argument);
+}
+
+} // namespace core
+} // namespace hqts
@@ -0,0 +1,141 @@
+#include "gtest/gtest.h"
+#include "hqts/core/atomic_token_bucket.h"
+
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace hqts {
+namespace core {
+
+TEST(AtomicTokenBucketTest, ConsumeAndRefill) {
+    const TimestampNs t0 = 1000000000;
+    AtomicTokenBucket tb(8000, 1000, t0); // 1000 bytes/sec, 1000 bytes capacity
+    ASSERT_EQ(tb.available_tokens(t0), 1000);
+
+    ASSERT_TRUE(tb.consume(600, t0));
+    ASSERT_FALSE(tb.consume(401, t0)); // Rejected requests leave the bucket unchanged
+    ASSERT_TRUE(tb.consume(400, t0));
+    ASSERT_EQ(tb.available_tokens(t0), 0);
+
+    ASSERT_EQ(tb.available_tokens(t0 + 250000000), 250); // 250 ms
+    ASSERT_TRUE(tb.consume(250, t0 + 250000000));
+    ASSERT_FALSE(tb.consume(1, t0 + 250000000));
+
+    ASSERT_EQ(tb.available_tokens(t0 + 60ULL * 1000000000), 1000); // Capped at capacity
+    ASSERT_FALSE(tb.consume(1001, t0 + 60ULL * 1000000000));
+}
+
+TEST(AtomicTokenBucketTest, InvalidParameters) {
+    ASSERT_THROW(AtomicTokenBucket(0, 1000, 0), std::invalid_argument);
+    ASSERT_THROW(AtomicTokenBucket(8, UINT64_MAX / 2, 0), std::invalid_argument);
+}
+
+TEST(AtomicTokenBucketTest, HighRateIsPreciseOverManySmallCharges) {
+    // 100 Gbps = 12.5 bytes/ns; 64-byte packets every 5.12 ns would be exactly line rate.
+    const uint64_t rate_bps = 100ULL * 1000000000;
+    TimestampNs now_ns = 0;
+    AtomicTokenBucket tb(rate_bps, 64 * 32, now_ns);
+    uint64_t admitted_bytes = 0;
+    for (int i = 0; i < 1000000; ++i) {
+        now_ns += 4; // Offered load 16 bytes/ns, above the rate
+        if (tb.consume(64, now_ns)) {
+            admitted_bytes += 64;
+        }
+    }
+    // 4 ms at 12.5 bytes/ns = 50,000,000 bytes, plus the initial burst.
+    const uint64_t expected = 50000000 + 64 * 32;
+    ASSERT_LE(admitted_bytes, expected);
+    ASSERT_GE(admitted_bytes, expected - expected / 1000); // Within 0.1%
+}
+
+TEST(AtomicTokenBucketTest, SlightlyStaleTimestampsAreJudgedConservatively) {
+    const TimestampNs t0 = 5000000000;
+    AtomicTokenBucket tb(8000, 1000, t0);
+    ASSERT_TRUE(tb.consume(1000, t0 + 1000000)); // Another core, 1 ms ahead
+    ASSERT_FALSE(tb.consume(1, t0));             // This core's older timestamp sees no credit
+    ASSERT_EQ(tb.available_tokens(t0), 0);
+    ASSERT_TRUE(tb.consume(1, t0 + 2000000));
+}
+
+TEST(AtomicTokenBucketTest, IdleLongerThanTickRangeIsFull) {
+    const TimestampNs t0 = 0;
+    AtomicTokenBucket tb(8000, 1000, t0);
+    ASSERT_TRUE(tb.consume(1000, t0));
+    // 100 hours: past the ~78 hour wrap of the tick counter.
+    const TimestampNs later = t0 + 100ULL * 3600 * 1000000000;
+    ASSERT_EQ(tb.available_tokens(later), 1000);
+    ASSERT_TRUE(tb.consume(1000, later));
+}
+
+TEST(AtomicTokenBucketTest, RefundNeverExceedsCapacity) {
+    const TimestampNs t0 = 0;
+    AtomicTokenBucket tb(8000, 1000, t0);
+    ASSERT_TRUE(tb.consume(700, t0));
+    tb.refund(200, t0);
+    ASSERT_EQ(tb.available_tokens(t0), 500);
+    tb.refund(5000, t0);
+    ASSERT_EQ(tb.available_tokens(t0), 1000);
+}
+
+TEST(AtomicTokenBucketTest, ConcurrentConsumersNeverOversubscribe) {
+    const TimestampNs t0 = 1000;
+    AtomicTokenBucket tb(8000, 100000, t0);
+    std::atomic<uint64_t> admitted{0};
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&]() {
+            for (int i = 0; i < 1000; ++i) {
+                if (tb.consume(100, t0)) { // No time passes: exactly the capacity is available
+                    admitted.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    ASSERT_EQ(admitted.load(), 1000);
+    ASSERT_EQ(tb.available_tokens(t0), 0);
+}
+
+TEST(LocalTokenCacheTest, BorrowsInBatchesAndFlushesUnusedCredit) {
+    const TimestampNs t0 = 0;
+    AtomicTokenBucket shared(8000, 10000, t0);
+    LocalTokenCache cache(shared, 1500);
+
+    ASSERT_TRUE(cache.consume(100, t0)); // Borrows one batch
+    ASSERT_EQ(cache.cached_tokens(), 1400);
+    ASSERT_EQ(shared.available_tokens(t0), 8500);
+
+    for (int i = 0; i < 14; ++i) {
+        ASSERT_TRUE(cache.consume(100, t0)); // Served locally
+    }
+    ASSERT_EQ(cache.cached_tokens(), 0);
+    ASSERT_EQ(shared.available_tokens(t0), 8500);
+
+    ASSERT_TRUE(cache.consume(100, t0));
+    cache.flush(t0);
+    ASSERT_EQ(cache.cached_tokens(), 0);
+    ASSERT_EQ(shared.available_tokens(t0), 8400);
+}
+
+TEST(LocalTokenCacheTest, FallsBackToExactBorrowNearTheLimit) {
+    const TimestampNs t0 = 0;
+    AtomicTokenBucket shared(8000, 1000, t0);
+    LocalTokenCache a(shared, 600);
+    LocalTokenCache b(shared, 600);
+
+    ASSERT_TRUE(a.consume(100, t0));  // Borrows 600
+    ASSERT_TRUE(b.consume(100, t0));  // Only 400 left: borrows exactly 100
+    ASSERT_EQ(b.cached_tokens(), 0);
+    ASSERT_TRUE(b.consume(300, t0));
+    ASSERT_FALSE(b.consume(1, t0));   // Shared bucket is empty
+    ASSERT_TRUE(a.consume(500, t0));  // a still holds its borrowed credit
+    ASSERT_FALSE(a.consume(1, t0));
+}
+
+} // namespace core
+} // namespace hqts
@@ -0,0 +1,97 @@
+#include "gtest/gtest.h"
+#include "hqts/core/egress_pacer.h"
+#include "hqts/scheduler/hfsc_scheduler.h"
+#include "hqts/scheduler/strict_priority_scheduler.h"
+#include "hqts/scheduler/aqm_queue.h" // For RedAqmParameters
+
+#include <vector>
+
+namespace hqts {
+namespace core {
+
+namespace {
+
+constexpr TimestampNs START_NS = 1000000000;
+
+scheduler::StrictPriorityScheduler make_fifo() {
+    return scheduler::StrictPriorityScheduler(
+        std::vector<scheduler::RedAqmParameters>{scheduler::RedAqmParameters(1000000, 2000000, 0.01, 0.002, 4000000)});
+}
+
+} // namespace
+
+TEST(EgressPacerTest, RateModeSpacesPacketsAtTheRate) {
+    EgressPacingConfig config;
+    config.rate_bps = 8000000; // 1 byte per microsecond
+    config.horizon_ns = 2500000;
+    EgressPacer pacer(config);
+    scheduler::StrictPriorityScheduler fifo = make_fifo();
+    for (int i = 0; i < 5; ++i) {
+        fifo.enqueue(scheduler::PacketDescriptor(1, 1000));
+    }
+
+    std::vector<scheduler::PacketDescriptor> out;
+    // Departures at +0, +1, +2 ms are within the horizon; +3 ms is held back.
+    ASSERT_EQ(pacer.get_packets_due(fifo, out, 16, START_NS), 3u);
+    EXPECT_EQ(out[0].transmit_time_ns, START_NS);
+    EXPECT_EQ(out[1].transmit_time_ns, START_NS + 1000000);
+    EXPECT_EQ(out[2].transmit_time_ns, START_NS + 2000000);
+    ASSERT_TRUE(pacer.has_held_packet());
+    EXPECT_EQ(pacer.next_due_ns(START_NS), START_NS + 500000);
+
+    out.clear();
+    ASSERT_EQ(pacer.get_packets_due(fifo, out, 16, START_NS + 2000000), 2u);
+    EXPECT_EQ(out[0].transmit_time_ns, START_NS + 3000000);
+    EXPECT_EQ(out[1].transmit_time_ns, START_NS + 4000000);
+    EXPECT_FALSE(pacer.has_held_packet());
+
+    // After an idle period the next packet departs immediately, not at the old schedule.
+    fifo.enqueue(scheduler::PacketDescriptor(1, 1000));
+    out.clear();
+    ASSERT_EQ(pacer.get_packets_due(fifo, out, 16, START_NS + 10000000), 1u);
+    EXPECT_EQ(out[0].transmit_time_ns, START_NS + 10000000);
+}
+
+TEST(EgressPacerTest, MaxPacketsBoundsEachCall) {
+    EgressPacingConfig config;
+    config.rate_bps = 1000000000;
+    EgressPacer pacer(config);
+    scheduler::StrictPriorityScheduler fifo = make_fifo();
+    for (int i = 0; i < 10; ++i) {
+        fifo.enqueue(scheduler::PacketDescriptor(1, 100));
+    }
+    std::vector<scheduler::PacketDescriptor> out;
+    ASSERT_EQ(pacer.get_packets_due(fifo, out, 4, START_NS), 4u);
+    ASSERT_EQ(pacer.get_packets_due(fifo, out, 100, START_NS), 6u);
+    for (size_t i = 1; i < out.size(); ++i) {
+        EXPECT_EQ(out[i].transmit_time_ns - out[i - 1].transmit_time_ns, 800u); // 100 bytes at 1 Gbps
+    }
+}
+
+TEST(EgressPacerTest, LinkClockModeFollowsHfscRealTimeCurve) {
+    // One leaf guaranteed 8 Mbps on a 1 Gbps link, with no link-share curve: HFSC lets
+    // the link idle between packets, and the pacer turns those gaps into departure times.
+    std::vector<scheduler::HfscScheduler::FlowConfig> configs = {
+        {static_cast<FlowId>(1), 0, scheduler::ServiceCurve(8000000)}};
+    scheduler::HfscScheduler hfsc(configs, 1000000000);
+    for (int i = 0; i < 3; ++i) {
+        hfsc.enqueue(scheduler::PacketDescriptor(7, 1000, 1));
+    }
+    EgressPacingConfig config;
+    config.horizon_ns = 500000;
+    EgressPacer pacer(config);
+
+    std::vector<scheduler::PacketDescriptor> out;
+    ASSERT_EQ(pacer.get_packets_due(hfsc, out, 16, START_NS), 1u);
+    EXPECT_EQ(out[0].transmit_time_ns, START_NS);
+    const TimestampNs second = pacer.next_due_ns(START_NS) + config.horizon_ns;
+    EXPECT_NEAR(static_cast<double>(second - START_NS), 1000000.0, 1000.0);
+
+    ASSERT_EQ(pacer.get_packets_due(hfsc, out, 16, second - config.horizon_ns), 1u);
+    EXPECT_EQ(out[1].transmit_time_ns, second);
+    ASSERT_EQ(pacer.get_packets_due(hfsc, out, 16, second + 600000), 1u);
+    EXPECT_NEAR(static_cast<double>(out[2].transmit_time_ns - out[1].transmit_time_ns), 1000000.0, 1000.0);
+}
+
+} // namespace core
+} // namespace hqts
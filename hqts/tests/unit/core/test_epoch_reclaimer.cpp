@@ -0,0 +1,44 @@
+#include "gtest/gtest.h"
+#include "hqts/core/epoch_reclaimer.h"
+
+#include <stdexcept> // For std::invalid_argument, std::length_error
+
+namespace hqts {
+namespace core {
+
+TEST(EpochReclaimerTest, TagPassesOnceEveryReaderAnnouncedIt) {
+    EpochReclaimer epochs(2);
+    size_t a = epochs.register_reader();
+    size_t b = epochs.register_reader();
+    EXPECT_NE(a, b);
+
+    uint64_t before = epochs.epoch();
+    uint64_t tag = epochs.advance();
+    EXPECT_GT(tag, before);
+    EXPECT_FALSE(epochs.passed(tag)); // Both readers registered before the advance
+
+    epochs.quiescent(a, epochs.epoch());
+    EXPECT_FALSE(epochs.passed(tag));
+    epochs.quiescent(b, before); // An epoch read before the advance does not count
+    EXPECT_FALSE(epochs.passed(tag));
+    epochs.quiescent(b, epochs.epoch());
+    EXPECT_TRUE(epochs.passed(tag));
+}
+
+TEST(EpochReclaimerTest, UnregisteredSlotsNeitherBlockNorLeak) {
+    EpochReclaimer epochs(1);
+    EXPECT_TRUE(epochs.passed(epochs.advance())); // No readers: nothing can be held
+
+    size_t reader = epochs.register_reader();
+    EXPECT_THROW(epochs.register_reader(), std::length_error);
+    uint64_t tag = epochs.advance();
+    EXPECT_FALSE(epochs.passed(tag));
+    epochs.unregister_reader(reader);
+    EXPECT_TRUE(epochs.passed(tag));
+    EXPECT_EQ(epochs.register_reader(), reader); // The slot is free again
+
+    EXPECT_THROW(EpochReclaimer(0), std::invalid_argument);
+}
+
+} // namespace core
+} // namespace hqts
@@ -0,0 +1,116 @@
+#include "gtest/gtest.h"
+#include "hqts/core/mpsc_ring.h"
+#include "hqts/scheduler/strict_priority_scheduler.h" // For drain_ring() into a real scheduler
+#include "hqts/scheduler/aqm_queue.h"                 // For RedAqmParameters
+
+#include <cstdint>
+#include <stdexcept> // For std::invalid_argument
+#include <thread>
+#include <vector>
+
+namespace hqts {
+namespace core {
+
+TEST(MpscRingTest, RoundsCapacityAndReportsFullAndEmpty) {
+    EXPECT_THROW(MpscRing<int>(0), std::invalid_argument);
+    MpscRing<int> ring(3);
+    EXPECT_EQ(ring.capacity(), 4u);
+
+    int value = 0;
+    EXPECT_FALSE(ring.try_pop(value));
+    const int items[6] = {0, 1, 2, 3, 4, 5};
+    ASSERT_EQ(ring.push_burst(items, 6), 4u); // Partial: only what fits
+    EXPECT_FALSE(ring.try_push(9));
+    EXPECT_EQ(ring.size(), 4u);
+
+    ASSERT_TRUE(ring.try_pop(value));
+    EXPECT_EQ(value, 0);
+    ASSERT_TRUE(ring.try_push(4));
+    int out[8] = {};
+    ASSERT_EQ(ring.pop_burst(out, 8), 4u);
+    EXPECT_EQ(out[0], 1);
+    EXPECT_EQ(out[3], 4);
+    EXPECT_TRUE(ring.empty());
+}
+
+TEST(MpscRingTest, ProducersKeepTheirOwnOrder) {
+    constexpr uint32_t kProducers = 4;
+    constexpr uint32_t kPerProducer = 50000;
+    MpscRing<uint64_t> ring(256);
+
+    std::vector<std::thread> producers;
+    for (uint32_t p = 0; p < kProducers; ++p) {
+        producers.emplace_back([&ring, p] {
+            uint64_t burst[8];
+            uint32_t next = 0;
+            while (next < kPerProducer) {
+                size_t n = 0;
+                for (; n < 8 && next + n < kPerProducer; ++n) {
+                    burst[n] = (uint64_t{p} << 32) | (next + n);
+                }
+                size_t pushed = ring.push_burst(burst, n);
+                next += static_cast<uint32_t>(pushed);
+                if (pushed == 0) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    std::vector<uint32_t> expected(kProducers, 0);
+    bool in_order = true;
+    uint64_t received = 0;
+    uint64_t out[32];
+    while (received < uint64_t{kProducers} * kPerProducer) {
+        size_t count = ring.pop_burst(out, 32);
+        for (size_t i = 0; i < count; ++i) {
+            uint32_t producer = static_cast<uint32_t>(out[i] >> 32);
+            uint32_t seq = static_cast<uint32_t>(out[i]);
+            in_order = in_order && producer < kProducers && seq == expected[producer];
+            if (producer < kProducers) {
+                expected[producer] = seq + 1;
+            }
+        }
+        received += count;
+        if (count == 0) {
+            std::this_thread::yield();
+        }
+    }
+    for (std::thread& producer : producers) {
+        producer.join();
+    }
+
+    EXPECT_TRUE(in_order);
+    EXPECT_TRUE(ring.empty());
+    for (uint32_t count : expected) {
+        EXPECT_EQ(count, kPerProducer);
+    }
+}
+
+TEST(MpscRingTest, SchedulerDrainsRingIntoItsQueues) {
+    std::vector<scheduler::RedAqmParameters> params(2, scheduler::RedAqmParameters(100000, 200000, 0.01,
+                                                                                    0.002, 250000));
+    scheduler::StrictPriorityScheduler scheduler(params);
+    MpscRing<scheduler::PacketDescriptor> ring(128);
+    for (uint32_t i = 0; i < 100; ++i) {
+        ASSERT_TRUE(ring.try_push(scheduler::PacketDescriptor(i, 100, static_cast<uint8_t>(i % 2))));
+    }
+
+    EXPECT_EQ(scheduler.drain_ring(ring, 40), 40u); // Bounded by max_packets
+    EXPECT_EQ(ring.size(), 60u);
+    EXPECT_EQ(scheduler.drain_ring(ring, 1000), 60u); // Bounded by what is queued
+    EXPECT_TRUE(ring.empty());
+    EXPECT_EQ(scheduler.drain_ring(ring, 1000), 0u);
+
+    // Strict priority order: all odd (priority 1) flows first, each level FIFO.
+    for (uint32_t i = 1; i < 100; i += 2) {
+        ASSERT_EQ(scheduler.dequeue().flow_id, i);
+    }
+    for (uint32_t i = 0; i < 100; i += 2) {
+        ASSERT_EQ(scheduler.dequeue().flow_id, i);
+    }
+    EXPECT_TRUE(scheduler.is_empty());
+}
+
+} // namespace core
+} // namespace hqts
@@ -0,0 +1,154 @@
+#include "gtest/gtest.h"
+#include "hqts/core/packet_buffer_pool.h"
+
+#include <cstring>   // For std::memcpy, std::memcmp
+#include <memory>    // For std::unique_ptr
+#include <stdexcept>
+#include <thread>    // For std::thread
+#include <vector>
+
+namespace hqts {
+namespace core {
+
+TEST(PacketBufferPoolTest, ConstructorValidation) {
+    ASSERT_THROW(PacketBufferPool(0, 2048), std::invalid_argument);
+    ASSERT_THROW(PacketBufferPool(4, 0), std::invalid_argument);
+    ASSERT_THROW(PacketBufferPool(PacketBufferPool::MAX_BUFFERS_PER_POOL + 1, 64), std::invalid_argument);
+}
+
+TEST(PacketBufferPoolTest, AllocateUntilExhausted) {
+    PacketBufferPool pool(3, 2048);
+    ASSERT_EQ(pool.capacity(), 3);
+    ASSERT_EQ(pool.available(), 3);
+    ASSERT_EQ(pool.buffer_size(), 2048);
+
+    PacketBufferHandle h1 = pool.allocate();
+    PacketBufferHandle h2 = pool.allocate();
+    PacketBufferHandle h3 = pool.allocate();
+    ASSERT_NE(h1, INVALID_PACKET_BUFFER);
+    ASSERT_NE(h2, INVALID_PACKET_BUFFER);
+    ASSERT_NE(h3, INVALID_PACKET_BUFFER);
+    ASSERT_NE(h1, h2);
+    ASSERT_NE(h2, h3);
+    ASSERT_EQ(pool.available(), 0);
+    ASSERT_EQ(pool.allocate(), INVALID_PACKET_BUFFER);
+
+    pool.release(h2);
+    ASSERT_EQ(pool.available(), 1);
+    ASSERT_EQ(pool.allocate(), h2); // LIFO reuse of the most recently freed buffer
+}
+
+TEST(PacketBufferPoolTest, DataIsWrittenInPlace) {
+    PacketBufferPool pool(2, 64);
+    PacketBufferHandle h = pool.allocate();
+    ASSERT_EQ(pool.data_length(h), 0);
+
+    const char payload[] = "hello";
+    std::memcpy(pool.data(h), payload, sizeof(payload));
+    pool.set_data_length(h, sizeof(payload));
+
+    const PacketBufferPool& const_pool = pool;
+    ASSERT_EQ(const_pool.data_length(h), sizeof(payload));
+    ASSERT_EQ(std::memcmp(const_pool.data(h), payload, sizeof(payload)), 0);
+    ASSERT_EQ(const_pool.data(h), pool.data(h)); // Same storage, no copies
+
+    ASSERT_THROW(pool.set_data_length(h, 65), std::invalid_argument);
+}
+
+TEST(PacketBufferPoolTest, ReferenceCounting) {
+    PacketBufferPool pool(1, 128);
+    PacketBufferHandle h = pool.allocate();
+    ASSERT_EQ(pool.ref_count(h), 1);
+
+    pool.retain(h); // E.g. packet mirrored to a second port
+    ASSERT_EQ(pool.ref_count(h), 2);
+
+    pool.release(h);
+    ASSERT_EQ(pool.ref_count(h), 1);
+    ASSERT_EQ(pool.available(), 0);
+
+    pool.release(h);
+    ASSERT_EQ(pool.available(), 1);
+
+    // The buffer is free again; any further use of the stale handle is rejected.
+    ASSERT_THROW(pool.release(h), std::invalid_argument);
+    ASSERT_THROW(pool.data(h), std::invalid_argument);
+}
+
+TEST(PacketBufferPoolTest, HandlesIdentifyTheirPool) {
+    PacketBufferPool pool_a(2, 64);
+    PacketBufferPool pool_b(2, 64);
+
+    PacketBufferHandle ha = pool_a.allocate();
+    PacketBufferHandle hb = pool_b.allocate();
+    ASSERT_EQ(PacketBufferPool::owner_of(ha), &pool_a);
+    ASSERT_EQ(PacketBufferPool::owner_of(hb), &pool_b);
+    ASSERT_EQ(PacketBufferPool::owner_of(INVALID_PACKET_BUFFER), nullptr);
+
+    // A handle from another pool is rejected rather than aliasing a foreign buffer.
+    ASSERT_THROW(pool_a.release(hb), std::invalid_argument);
+
+    PacketBufferPool::release_any(ha);
+    PacketBufferPool::release_any(hb);
+    PacketBufferPool::release_any(INVALID_PACKET_BUFFER); // No-op
+    ASSERT_EQ(pool_a.available(), 2);
+    ASSERT_EQ(pool_b.available(), 2);
+}
+
+TEST(PacketBufferPoolTest, RegistrySlotsAreReused) {
+    PacketBufferHandle stale = INVALID_PACKET_BUFFER;
+    {
+        PacketBufferPool pool(1, 64);
+        stale = pool.allocate();
+    }
+    ASSERT_EQ(PacketBufferPool::owner_of(stale), nullptr);
+
+    // Creating and destroying many pools must not run out of registry slots.
+    for (size_t i = 0; i < 2 * PacketBufferPool::MAX_POOLS; ++i) {
+        PacketBufferPool pool(1, 64);
+        ASSERT_NE(pool.allocate(), INVALID_PACKET_BUFFER);
+    }
+}
+
+TEST(PacketBufferPoolTest, ReleasesFromOtherThreadsReturnThroughTheOwner) {
+    constexpr size_t kBuffers = 64;
+    PacketBufferPool pool(kBuffers, 64);
+    std::vector<PacketBufferHandle> handles;
+    for (size_t i = 0; i < kBuffers; ++i) {
+        handles.push_back(pool.allocate());
+        pool.retain(handles.back()); // One reference per releasing thread
+    }
+    ASSERT_EQ(pool.allocate(), INVALID_PACKET_BUFFER);
+
+    // Two foreign threads drop the two references of every buffer concurrently.
+    auto release_all = [&pool, &handles] {
+        for (PacketBufferHandle handle : handles) {
+            PacketBufferPool::release_any(handle);
+        }
+    };
+    std::thread first(release_all);
+    std::thread second(release_all);
+    first.join();
+    second.join();
+
+    ASSERT_EQ(pool.available(), kBuffers); // Waiting in the return ring
+    for (size_t i = 0; i < kBuffers; ++i) {
+        ASSERT_NE(pool.allocate(), INVALID_PACKET_BUFFER); // Reclaimed on demand
+    }
+    ASSERT_EQ(pool.allocate(), INVALID_PACKET_BUFFER);
+}
+
+TEST(PacketBufferPoolTest, BoundThreadReleasesToTheFreeList) {
+    PacketBufferPool pool(2, 64);
+    std::thread owner([&pool] {
+        pool.bind_to_current_thread();
+        PacketBufferHandle h = pool.allocate();
+        pool.release(h);
+        EXPECT_EQ(pool.reclaim_remote_releases(), 0u); // Went straight to the free list
+    });
+    owner.join();
+    ASSERT_EQ(pool.available(), 2);
+}
+
+} // namespace core
+} // namespace hqts
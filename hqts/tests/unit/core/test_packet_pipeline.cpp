@@ -8,10 +8,15 @@
 #include "hqts/core/flow_context.h" // For FlowTable, core::DropPolicy
 #include "hqts/dataplane/flow_identifier.h" // For FiveTuple
 #include "hqts/scheduler/packet_descriptor.h" // For PacketDescriptor, ConformanceLevel
+#include "hqts/core/packet_buffer_pool.h"     // For PacketBufferPool
+#include "hqts/core/timing_wheel.h"           // For TimingWheel
+#include "hqts/scheduler/static_scheduler.h" // For the statically composed pipeline
 
 #include <memory>   // For std::unique_ptr
 #include <vector>
 #include <map>      // For std::map in tests
+#include <cstring>  // For std::memcmp
+#include <stdexcept>
 
 namespace hqts {
 namespace core {
@@ -104,8 +109,8 @@ protected:
 
     void set_policy_for_flow_tuple(const dataplane::FiveTuple& five_tuple, policy::PolicyId policy_id) {
         core::FlowId flow_id = classifier_->get_or_create_flow(five_tuple);
-        ASSERT_TRUE(test_flow_table_.count(flow_id));
-        test_flow_table_.at(flow_id).policy_id = policy_id;
+        ASSERT_NE(test_flow_table_.find_by_id(flow_id), nullptr);
+        test_flow_table_.find_by_id(flow_id)->policy_id = policy_id;
     }
 };
 
@@ -206,5 +211,236 @@ TEST_F(PacketPipelineTest, NewFlowGetsDefaultPolicy) {
     ASSERT_EQ(packet_out.conformance, scheduler::ConformanceLevel::GREEN);
 }
 
+TEST_F(PacketPipelineTest, BurstPriorityOrderThroughPipeline) {
+    dataplane::FiveTuple tuple_high(1,1,1,1,6);
+    dataplane::FiveTuple tuple_mid(2,2,2,2,6);
+    dataplane::FiveTuple tuple_low(3,3,3,3,6);
+
+    set_policy_for_flow_tuple(tuple_high, POLICY_ID_HIGH_PRIO);
+    set_policy_for_flow_tuple(tuple_mid, POLICY_ID_MID_PRIO);
+    set_policy_for_flow_tuple(tuple_low, POLICY_ID_LOW_PRIO);
+
+    std::vector<IncomingPacket> burst = {
+        {tuple_low, 100}, {tuple_high, 100}, {tuple_mid, 100}, {tuple_high, 200}
+    };
+    ASSERT_EQ(pipeline_->handle_incoming_burst(burst), 4);
+
+    std::vector<scheduler::PacketDescriptor> out;
+    ASSERT_EQ(pipeline_->get_next_burst(out, 32), 4);
+    ASSERT_EQ(out.size(), 4);
+
+    core::FlowId fid_high = classifier_->get_or_create_flow(tuple_high);
+    ASSERT_EQ(out[0].flow_id, fid_high);
+    ASSERT_EQ(out[0].packet_length_bytes, 100);
+    ASSERT_EQ(out[1].flow_id, fid_high);
+    ASSERT_EQ(out[1].packet_length_bytes, 200); // FIFO within a priority level
+    ASSERT_EQ(out[2].priority, 4);
+    ASSERT_EQ(out[2].flow_id, classifier_->get_or_create_flow(tuple_mid));
+    ASSERT_EQ(out[3].priority, 1);
+    ASSERT_EQ(out[3].flow_id, classifier_->get_or_create_flow(tuple_low));
+
+    ASSERT_EQ(pipeline_->get_next_burst(out, 32), 0); // Empty scheduler appends nothing
+    ASSERT_EQ(out.size(), 4);
+}
+
+TEST_F(PacketPipelineTest, StaticSchedulerPipelineMatchesRuntimePipeline) {
+    // Same stages, but the scheduler is a compile-time hierarchy: no virtual calls.
+    using Levels = scheduler::StaticStrictPriority<scheduler::StaticQueue<scheduler::RedAqmQueue>, 8>;
+    const scheduler::RedAqmParameters level = createPermissiveSpsParams(1)[0];
+    Levels::Config levels = {{level, level, level, level, level, level, level, level}};
+    scheduler::StaticScheduler<Levels> static_scheduler(levels);
+    BasicPacketPipeline<dataplane::FlowClassifier, TrafficShaper, scheduler::StaticScheduler<Levels>>
+        static_pipeline(*classifier_, *shaper_, static_scheduler);
+
+    dataplane::FiveTuple tuple_high(1,1,1,1,6);
+    dataplane::FiveTuple tuple_mid(2,2,2,2,6);
+    dataplane::FiveTuple tuple_low(3,3,3,3,6);
+    set_policy_for_flow_tuple(tuple_high, POLICY_ID_HIGH_PRIO);
+    set_policy_for_flow_tuple(tuple_mid, POLICY_ID_MID_PRIO);
+    set_policy_for_flow_tuple(tuple_low, POLICY_ID_LOW_PRIO);
+
+    std::vector<IncomingPacket> burst = {
+        {tuple_low, 100}, {tuple_high, 100}, {tuple_mid, 100}, {tuple_high, 200}
+    };
+    ASSERT_EQ(static_pipeline.handle_incoming_burst(burst), 4);
+    static_pipeline.handle_incoming_packet(tuple_mid, 300);
+
+    std::vector<scheduler::PacketDescriptor> out;
+    ASSERT_EQ(static_pipeline.get_next_burst(out, 3), 3);
+    ASSERT_EQ(out[0].priority, 7);
+    ASSERT_EQ(out[1].priority, 7);
+    ASSERT_EQ(out[1].packet_length_bytes, 200);
+    ASSERT_EQ(out[2].priority, 4);
+    ASSERT_EQ(static_pipeline.get_next_packet_to_transmit().packet_length_bytes, 300);
+    ASSERT_EQ(static_pipeline.get_next_packet_to_transmit().priority, 1);
+    ASSERT_EQ(static_pipeline.get_next_packet_to_transmit().packet_length_bytes, 0); // Empty
+    ASSERT_TRUE(static_scheduler.is_empty());
+}
+
+TEST_F(PacketPipelineTest, BurstMatchesPerPacketShaping) {
+    // Same sequence as PacketDroppedByShaperPolicy, but interleaved with another flow
+    // so the burst path has to split it into several policy runs.
+    dataplane::FiveTuple tuple_drop(2, 2, 100, 200, 6);
+    dataplane::FiveTuple tuple_new(10, 10, 10, 10, 6); // Default policy
+    set_policy_for_flow_tuple(tuple_drop, POLICY_ID_DROP_RED_PACKETS);
+
+    std::vector<IncomingPacket> burst = {
+        {tuple_drop, 150}, // GREEN
+        {tuple_drop, 150}, // RED, dropped
+        {tuple_new, 64},   // GREEN, default policy
+        {tuple_drop, 10}   // GREEN
+    };
+    ASSERT_EQ(pipeline_->handle_incoming_burst(burst), 3);
+
+    std::vector<scheduler::PacketDescriptor> out;
+    ASSERT_EQ(pipeline_->get_next_burst(out, 2), 2); // Honors max_packets
+    ASSERT_EQ(pipeline_->get_next_burst(out, 2), 1);
+    ASSERT_TRUE(main_scheduler_->is_empty());
+
+    core::FlowId fid_drop = classifier_->get_or_create_flow(tuple_drop);
+    core::FlowId fid_new = classifier_->get_or_create_flow(tuple_new);
+    // Policy 4 targets priority 4 for GREEN, the default policy priority 0.
+    ASSERT_EQ(out[0].flow_id, fid_drop);
+    ASSERT_EQ(out[0].packet_length_bytes, 150);
+    ASSERT_EQ(out[1].flow_id, fid_drop);
+    ASSERT_EQ(out[1].packet_length_bytes, 10);
+    ASSERT_EQ(out[2].flow_id, fid_new);
+    for (const auto& packet : out) {
+        ASSERT_EQ(packet.conformance, scheduler::ConformanceLevel::GREEN);
+    }
+}
+
+TEST_F(PacketPipelineTest, EmptyBurstIsNoOp) {
+    ASSERT_EQ(pipeline_->handle_incoming_burst({}), 0);
+    ASSERT_TRUE(main_scheduler_->is_empty());
+    ASSERT_TRUE(test_flow_table_.empty());
+}
+
+TEST_F(PacketPipelineTest, PayloadTravelsByHandle) {
+    PacketBufferPool pool(4, 256);
+    PacketPipeline pooled_pipeline(*classifier_, *shaper_, *main_scheduler_, &pool);
+
+    dataplane::FiveTuple tuple1(1, 1, 100, 200, 6);
+    set_policy_for_flow_tuple(tuple1, POLICY_ID_HIGH_PRIO);
+
+    std::vector<std::byte> payload = {std::byte{0xde}, std::byte{0xad}, std::byte{0xbe}, std::byte{0xef}};
+    pooled_pipeline.handle_incoming_packet(tuple1, 100, payload);
+    ASSERT_EQ(pool.available(), 3);
+
+    scheduler::PacketDescriptor packet_out = pooled_pipeline.get_next_packet_to_transmit();
+    ASSERT_NE(packet_out.buffer, INVALID_PACKET_BUFFER);
+    ASSERT_EQ(pool.data_length(packet_out.buffer), payload.size());
+    ASSERT_EQ(std::memcmp(pool.data(packet_out.buffer), payload.data(), payload.size()), 0);
+
+    pool.release(packet_out.buffer); // Transmit side done with the payload
+    ASSERT_EQ(pool.available(), 4);
+}
+
+TEST_F(PacketPipelineTest, ShaperDropReleasesBuffer) {
+    PacketBufferPool pool(4, 256);
+    PacketPipeline pooled_pipeline(*classifier_, *shaper_, *main_scheduler_, &pool);
+
+    dataplane::FiveTuple tuple_drop(2, 2, 100, 200, 6);
+    set_policy_for_flow_tuple(tuple_drop, POLICY_ID_DROP_RED_PACKETS);
+
+    // Zero-copy ingress: the buffers are filled by the "driver" and handed over.
+    PacketBufferHandle h1 = pool.allocate();
+    PacketBufferHandle h2 = pool.allocate();
+    pooled_pipeline.handle_incoming_packet(tuple_drop, 150, h1); // GREEN
+    pooled_pipeline.handle_incoming_packet(tuple_drop, 150, h2); // RED, dropped
+    ASSERT_EQ(pool.available(), 3); // h2 went straight back to the pool
+
+    std::vector<IncomingPacket> burst = {{tuple_drop, 150, pool.allocate()}, {tuple_drop, 10, pool.allocate()}};
+    ASSERT_EQ(pooled_pipeline.handle_incoming_burst(burst), 1); // 150B RED and dropped, 10B GREEN
+    ASSERT_EQ(pool.available(), 2);
+
+    std::vector<scheduler::PacketDescriptor> out;
+    ASSERT_EQ(pooled_pipeline.get_next_burst(out, 8), 2);
+    ASSERT_EQ(out[0].buffer, h1);
+    for (const auto& packet : out) {
+        pool.release(packet.buffer);
+    }
+    ASSERT_EQ(pool.available(), 4);
+}
+
+TEST_F(PacketPipelineTest, PayloadWithoutPoolIsRejected) {
+    dataplane::FiveTuple tuple1(1, 1, 100, 200, 6);
+    std::vector<std::byte> payload(16);
+    ASSERT_THROW(pipeline_->handle_incoming_packet(tuple1, 100, payload), std::logic_error);
+}
+
+TEST_F(PacketPipelineTest, ShapingWheelDelaysExcessInsteadOfDropping) {
+    const policy::PolicyId POLICY_ID_SHAPED = 5;
+    ShapingPolicy shaped(POLICY_ID_SHAPED, NO_PARENT, "Shaped",
+                         8000000, 0, 1000, 0, // 1 byte/us, one 1000-byte burst
+                         policy::SchedulingAlgorithm::STRICT_PRIORITY, 100, 0,
+                         true, 6, 6, 6, 6, 6, 6);
+    shaped.shape_to_cir = true;
+    shaped.max_shaping_delay_ns = 2600000; // 2.6 ms
+    test_policy_tree_.insert(shaped);
+
+    TimingWheel wheel(64, 1000);
+    PacketPipeline shaping_pipeline(*classifier_, *shaper_, *main_scheduler_, nullptr, &wheel);
+    dataplane::FiveTuple tuple(7, 7, 100, 200, 17);
+    set_policy_for_flow_tuple(tuple, POLICY_ID_SHAPED);
+
+    // 8 x 500 bytes at t=0: two fit the burst, five are paced 500 us apart, the eighth
+    // would wait 3 ms and is dropped.
+    std::vector<IncomingPacket> burst(8, IncomingPacket(tuple, 500));
+    ASSERT_EQ(shaping_pipeline.handle_incoming_burst(burst, 0), 7);
+    ASSERT_EQ(wheel.size(), 5u);
+
+    std::vector<scheduler::PacketDescriptor> out;
+    ASSERT_EQ(shaping_pipeline.get_next_burst(out, 16, 0), 2);
+    ASSERT_EQ(shaping_pipeline.get_next_burst(out, 16, 499999), 0);
+    ASSERT_EQ(shaping_pipeline.get_next_burst(out, 16, 500000), 1);
+    ASSERT_EQ(shaping_pipeline.get_next_burst(out, 16, 2000000), 3);
+    for (const auto& packet : out) {
+        ASSERT_EQ(packet.conformance, scheduler::ConformanceLevel::GREEN);
+        ASSERT_EQ(packet.priority, 6);
+    }
+
+    // The single-packet path books behind the burst.
+    shaping_pipeline.handle_incoming_packet(tuple, 500, INVALID_PACKET_BUFFER, 2000000);
+    ASSERT_EQ(wheel.size(), 2u);
+    ASSERT_GT(wheel.next_event_ns(), 2000000u);
+    ASSERT_LE(wheel.next_event_ns(), 2500000u); // A lower bound: may be a cascade step
+    ASSERT_EQ(shaping_pipeline.get_next_packet_to_transmit(3000000).packet_length_bytes, 500u);
+    ASSERT_EQ(shaping_pipeline.get_next_packet_to_transmit(3000000).packet_length_bytes, 500u);
+    ASSERT_TRUE(wheel.empty());
+
+    // Without a wheel the same policy polices: excess is RED and dropped.
+    for (int i = 0; i < 4; ++i) {
+        pipeline_->handle_incoming_packet(tuple, 500, INVALID_PACKET_BUFFER, 10000000);
+    }
+    out.clear();
+    ASSERT_EQ(pipeline_->get_next_burst(out, 16), 2);
+}
+
+TEST_F(PacketPipelineTest, PacketsDueCarryDepartureTimes) {
+    std::vector<scheduler::PacketDescriptor> out;
+    ASSERT_THROW(pipeline_->get_packets_due(out, 8, 0), std::logic_error);
+
+    EgressPacingConfig pacing;
+    pacing.rate_bps = 8000000; // 1 byte per microsecond
+    pacing.horizon_ns = 150000;
+    EgressPacer pacer(pacing);
+    PacketPipeline paced(*classifier_, *shaper_, *main_scheduler_, nullptr, nullptr, &pacer);
+
+    dataplane::FiveTuple tuple(1, 1, 100, 200, 6);
+    set_policy_for_flow_tuple(tuple, POLICY_ID_HIGH_PRIO);
+    const TimestampNs now = 1000000000;
+    paced.handle_incoming_packet(tuple, 100, INVALID_PACKET_BUFFER, now);
+    paced.handle_incoming_packet(tuple, 100, INVALID_PACKET_BUFFER, now);
+    paced.handle_incoming_packet(tuple, 100, INVALID_PACKET_BUFFER, now);
+
+    ASSERT_EQ(paced.get_packets_due(out, 8, now), 2u); // +0 and +100 us; +200 us is beyond the horizon
+    EXPECT_EQ(out[0].transmit_time_ns, now);
+    EXPECT_EQ(out[1].transmit_time_ns, now + 100000);
+    ASSERT_EQ(pacer.next_due_ns(now), now + 50000);
+    ASSERT_EQ(paced.get_packets_due(out, 8, now + 50000), 1u);
+    EXPECT_EQ(out[2].transmit_time_ns, now + 200000);
+}
+
 } // namespace core
 } // namespace hqts
@@ -0,0 +1,99 @@
+#include "gtest/gtest.h"
+#include "hqts/core/per_core_statistics.h"
+
+#include <cstdint>
+#include <stdexcept> // For std::invalid_argument
+#include <thread>
+#include <vector>
+
+namespace hqts {
+namespace core {
+
+using scheduler::ConformanceLevel;
+
+TEST(PerCorePolicyStatisticsTest, InvalidParameters) {
+    EXPECT_THROW(PerCorePolicyStatistics(0, 8), std::invalid_argument);
+    EXPECT_THROW(PerCorePolicyStatistics(2, 0), std::invalid_argument);
+}
+
+TEST(PerCorePolicyStatisticsTest, SlotsAreStableAndBounded) {
+    PerCorePolicyStatistics stats(1, 2);
+    uint32_t first = stats.slot_of(10);
+    uint32_t second = stats.slot_of(20);
+    EXPECT_NE(first, second);
+    EXPECT_EQ(stats.slot_of(10), first);
+    EXPECT_EQ(stats.slot_of(30), PerCorePolicyStatistics::NO_SLOT); // Full
+    EXPECT_EQ(stats.slot_of(20), second);                           // Known policies still resolve
+
+    stats.record(0, PerCorePolicyStatistics::NO_SLOT, ConformanceLevel::GREEN, 100, false); // Ignored
+    EXPECT_EQ(stats.read(30).packets_processed, 0u);
+}
+
+TEST(PerCorePolicyStatisticsTest, ReadFoldsEveryCore) {
+    PerCorePolicyStatistics stats(3, 4);
+    uint32_t slot = stats.slot_of(7);
+    stats.record(0, slot, ConformanceLevel::GREEN, 100, false);
+    stats.record(1, slot, ConformanceLevel::YELLOW, 200, false);
+    stats.record(2, slot, ConformanceLevel::RED, 300, true);
+    stats.record(2, slot, ConformanceLevel::GREEN, 50, false);
+
+    PolicyStatistics totals = stats.read(7);
+    EXPECT_EQ(totals.packets_processed, 4u);
+    EXPECT_EQ(totals.bytes_processed, 650u);
+    EXPECT_EQ(totals.packets_dropped, 1u);
+    EXPECT_EQ(totals.bytes_dropped, 300u);
+    EXPECT_EQ(totals.packets_by_conformance[static_cast<size_t>(ConformanceLevel::GREEN)], 2u);
+    EXPECT_EQ(totals.packets_by_conformance[static_cast<size_t>(ConformanceLevel::YELLOW)], 1u);
+    EXPECT_EQ(totals.packets_by_conformance[static_cast<size_t>(ConformanceLevel::RED)], 1u);
+
+    EXPECT_EQ(stats.read(8).packets_processed, 0u); // Never given a slot
+}
+
+TEST(PerCorePolicyStatisticsTest, ReadAllListsPoliciesInSlotOrder) {
+    PerCorePolicyStatistics stats(2, 4);
+    uint32_t a = stats.slot_of(5);
+    uint32_t b = stats.slot_of(3);
+    stats.record(0, a, ConformanceLevel::GREEN, 10, false);
+    stats.record(1, b, ConformanceLevel::GREEN, 20, false);
+    stats.record(1, b, ConformanceLevel::GREEN, 20, false);
+
+    auto all = stats.read_all();
+    ASSERT_EQ(all.size(), 2u);
+    EXPECT_EQ(all[0].first, 5u);
+    EXPECT_EQ(all[0].second.bytes_processed, 10u);
+    EXPECT_EQ(all[1].first, 3u);
+    EXPECT_EQ(all[1].second.packets_processed, 2u);
+}
+
+TEST(PerCorePolicyStatisticsTest, ConcurrentCoresLoseNoUpdates) {
+    constexpr size_t kCores = 4;
+    constexpr uint64_t kPacketsPerCore = 200000;
+    PerCorePolicyStatistics stats(kCores, 1);
+    uint32_t slot = stats.slot_of(1);
+
+    std::vector<std::thread> writers;
+    for (size_t core = 0; core < kCores; ++core) {
+        writers.emplace_back([&stats, core, slot] {
+            for (uint64_t i = 0; i < kPacketsPerCore; ++i) {
+                stats.record(core, slot, ConformanceLevel::GREEN, 64, (i % 4) == 0);
+            }
+        });
+    }
+    uint64_t previous = 0;
+    for (int i = 0; i < 100; ++i) { // Folds taken while writing only ever grow
+        uint64_t now = stats.read(1).packets_processed;
+        EXPECT_GE(now, previous);
+        previous = now;
+    }
+    for (std::thread& writer : writers) {
+        writer.join();
+    }
+
+    PolicyStatistics totals = stats.read(1);
+    EXPECT_EQ(totals.packets_processed, kCores * kPacketsPerCore);
+    EXPECT_EQ(totals.bytes_processed, kCores * kPacketsPerCore * 64);
+    EXPECT_EQ(totals.packets_dropped, kCores * kPacketsPerCore / 4);
+}
+
+} // namespace core
+} // namespace hqts
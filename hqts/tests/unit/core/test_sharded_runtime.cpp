@@ -0,0 +1,377 @@
+#include "gtest/gtest.h"
+#include "hqts/core/sharded_runtime.h"
+#include "hqts/core/packet_buffer_pool.h"
+#include "hqts/scheduler/strict_priority_scheduler.h" // Port scheduler for the tests
+#include "hqts/scheduler/aqm_queue.h"                 // For RedAqmParameters
+#include "hqts/policy/policy_tree.h"
+
+#include <chrono>    // For std::chrono::steady_clock
+#include <cstdint>
+#include <memory>    // For std::unique_ptr
+#include <stdexcept> // For std::invalid_argument
+#include <thread>    // For std::this_thread::yield
+#include <string>    // For std::to_string
+#include <vector>
+
+#include <unistd.h>  // For getpid
+
+namespace hqts {
+namespace core {
+
+namespace {
+
+constexpr policy::PolicyId kRuntimePolicyId = 1;
+
+// One level, thresholds far above anything the tests queue.
+std::unique_ptr<scheduler::SchedulerInterface> makeRuntimeTestScheduler() {
+    std::vector<scheduler::RedAqmParameters> params;
+    params.emplace_back(1u << 22, 1u << 23, 0.01, 0.002, 1u << 24);
+    return std::make_unique<scheduler::StrictPriorityScheduler>(params);
+}
+
+policy::PolicyTree makeRuntimeTestTree(uint64_t rate_bps, uint64_t burst_bytes, uint8_t green_priority = 0) {
+    policy::PolicyTree tree;
+    tree.insert(ShapingPolicy(kRuntimePolicyId, policy::NO_PARENT_POLICY_ID, "runtime_test",
+                              rate_bps, 2 * rate_bps, burst_bytes, 2 * burst_bytes,
+                              policy::SchedulingAlgorithm::STRICT_PRIORITY, 100, 0,
+                              true, green_priority, 0, 0, 0, 0, 0));
+    return tree;
+}
+
+ShardedRuntimeConfig makeRuntimeTestConfig(size_t num_workers) {
+    ShardedRuntimeConfig config;
+    config.num_workers = num_workers;
+    config.flows_per_worker = 1024;
+    config.default_policy_id = kRuntimePolicyId;
+    return config;
+}
+
+dataplane::FiveTuple makeRuntimeTestTuple(uint32_t flow) {
+    return dataplane::FiveTuple(0x0A000000u + flow, 0x0B000001u, static_cast<uint16_t>(1000 + flow), 80, 6);
+}
+
+// Dispatches every packet, retrying while a worker's ingress ring is full.
+void dispatchAll(ShardedRuntime& runtime, const std::vector<IncomingPacket>& packets) {
+    for (const IncomingPacket& packet : packets) {
+        while (!runtime.dispatch(packet)) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+} // namespace
+
+TEST(ShardedRuntimeTest, ValidatesConfiguration) {
+    policy::PolicyTree tree = makeRuntimeTestTree(1000000000, 100000);
+    auto transmit = [](const scheduler::PacketDescriptor&) {};
+
+    ShardedRuntimeConfig no_workers = makeRuntimeTestConfig(0);
+    EXPECT_THROW(ShardedRuntime(no_workers, tree, makeRuntimeTestScheduler(), transmit), std::invalid_argument);
+
+    ShardedRuntimeConfig too_many_cpus = makeRuntimeTestConfig(1);
+    too_many_cpus.worker_cpus = {0, 1};
+    EXPECT_THROW(ShardedRuntime(too_many_cpus, tree, makeRuntimeTestScheduler(), transmit), std::invalid_argument);
+
+    EXPECT_THROW(ShardedRuntime(makeRuntimeTestConfig(1), tree, std::unique_ptr<scheduler::SchedulerInterface>(),
+                                transmit),
+                 std::invalid_argument);
+    EXPECT_THROW(ShardedRuntime(makeRuntimeTestConfig(1), tree, ShardedRuntime::SchedulerFactory(), transmit),
+                 std::invalid_argument);
+    ShardedRuntime::SchedulerFactory null_factory = [] { return std::unique_ptr<scheduler::SchedulerInterface>(); };
+    EXPECT_THROW(ShardedRuntime(makeRuntimeTestConfig(1), tree, null_factory, transmit), std::invalid_argument);
+
+    ShardedRuntimeConfig bad_min_burst = makeRuntimeTestConfig(1);
+    bad_min_burst.min_burst_size = bad_min_burst.burst_size + 1;
+    EXPECT_THROW(ShardedRuntime(bad_min_burst, tree, makeRuntimeTestScheduler(), transmit), std::invalid_argument);
+    EXPECT_THROW(ShardedRuntime(makeRuntimeTestConfig(1), tree, makeRuntimeTestScheduler(), nullptr),
+                 std::invalid_argument);
+
+    ShardedRuntime runtime(makeRuntimeTestConfig(2), tree, makeRuntimeTestScheduler(), transmit);
+    EXPECT_THROW(runtime.worker_counters(2), std::out_of_range);
+}
+
+TEST(ShardedRuntimeTest, DispatchIsStickyPerFlowAndSpreadsFlows) {
+    policy::PolicyTree tree = makeRuntimeTestTree(1000000000, 100000);
+    ShardedRuntime runtime(makeRuntimeTestConfig(4), tree, makeRuntimeTestScheduler(),
+                           [](const scheduler::PacketDescriptor&) {});
+
+    std::vector<size_t> flows_per_worker(4, 0);
+    for (uint32_t flow = 0; flow < 4000; ++flow) {
+        size_t worker = runtime.worker_for(makeRuntimeTestTuple(flow));
+        ASSERT_LT(worker, 4u);
+        EXPECT_EQ(runtime.worker_for(makeRuntimeTestTuple(flow)), worker);
+        ++flows_per_worker[worker];
+    }
+    for (size_t count : flows_per_worker) {
+        EXPECT_GT(count, 800u); // 1000 expected per worker
+        EXPECT_LT(count, 1200u);
+    }
+}
+
+TEST(ShardedRuntimeTest, TransmitsEveryPacketKeepingPerFlowOrder) {
+    constexpr uint32_t kFlows = 16;
+    constexpr uint32_t kPacketsPerFlow = 200;
+    policy::PolicyTree tree = makeRuntimeTestTree(1000000000000ull, 1000000); // Never limits
+
+    std::vector<scheduler::PacketDescriptor> transmitted; // Only touched by the egress thread
+    ShardedRuntime runtime(makeRuntimeTestConfig(4), tree, makeRuntimeTestScheduler(),
+                           [&transmitted](const scheduler::PacketDescriptor& packet) {
+                               transmitted.push_back(packet);
+                           });
+
+    // The buffer field carries (flow, sequence) through the data path; nothing is
+    // dropped, so the runtime never releases these fake handles.
+    std::vector<IncomingPacket> packets;
+    for (uint32_t seq = 0; seq < kPacketsPerFlow; ++seq) {
+        for (uint32_t flow = 0; flow < kFlows; ++flow) {
+            packets.emplace_back(makeRuntimeTestTuple(flow), 100, (flow << 16) | (seq + 1));
+        }
+    }
+
+    runtime.start();
+    EXPECT_TRUE(runtime.is_running());
+    EXPECT_THROW(runtime.start(), std::logic_error);
+    dispatchAll(runtime, packets);
+    runtime.stop();
+    EXPECT_FALSE(runtime.is_running());
+
+    ASSERT_EQ(transmitted.size(), packets.size());
+    EXPECT_EQ(runtime.packets_transmitted(), packets.size());
+    uint64_t received = 0;
+    for (size_t w = 0; w < runtime.num_workers(); ++w) {
+        received += runtime.worker_counters(w).packets_received.load();
+        EXPECT_EQ(runtime.worker_counters(w).packets_dropped.load(), 0u);
+    }
+    EXPECT_EQ(received, packets.size());
+
+    std::vector<uint32_t> next_seq(kFlows, 1);
+    for (const scheduler::PacketDescriptor& packet : transmitted) {
+        uint32_t flow = packet.buffer >> 16;
+        ASSERT_LT(flow, kFlows);
+        EXPECT_EQ(packet.buffer & 0xFFFFu, next_seq[flow]) << "flow " << flow;
+        next_seq[flow] = (packet.buffer & 0xFFFFu) + 1;
+    }
+}
+
+TEST(ShardedRuntimeTest, BuffersDroppedOnWorkersAndAtEgressReturnToThePool) {
+    constexpr size_t kPackets = 2000;
+    // The initial burst allowance passes each worker's policer, the rest is dropped there...
+    policy::PolicyTree tree = makeRuntimeTestTree(8000, 50000);
+    // ...and a port queue of four packets drops most of what passes.
+    auto make_scheduler = [] {
+        std::vector<scheduler::RedAqmParameters> params;
+        params.emplace_back(2000, 3000, 0.1, 0.002, 4000);
+        return std::make_unique<scheduler::StrictPriorityScheduler>(params);
+    };
+    PacketBufferPool pool(kPackets, 64); // Owned by this thread, the RX thread
+    ShardedRuntime runtime(makeRuntimeTestConfig(2), tree, make_scheduler(),
+                           [](const scheduler::PacketDescriptor& packet) {
+                               PacketBufferPool::release_any(packet.buffer);
+                           });
+
+    std::vector<IncomingPacket> packets;
+    for (size_t i = 0; i < kPackets; ++i) {
+        PacketBufferHandle buffer = pool.allocate();
+        ASSERT_NE(buffer, INVALID_PACKET_BUFFER);
+        packets.emplace_back(makeRuntimeTestTuple(static_cast<uint32_t>(i % 32)), 1000, buffer);
+    }
+    runtime.start();
+    dispatchAll(runtime, packets);
+    runtime.stop();
+
+    uint64_t dropped = 0;
+    uint64_t forwarded = 0;
+    for (size_t w = 0; w < runtime.num_workers(); ++w) {
+        dropped += runtime.worker_counters(w).packets_dropped.load();
+        forwarded += runtime.worker_counters(w).packets_forwarded.load();
+    }
+    EXPECT_GT(dropped, 0u);                           // Released on the worker threads
+    EXPECT_LT(runtime.packets_transmitted(), forwarded); // Released on the egress thread
+    EXPECT_EQ(pool.available(), pool.capacity());
+    EXPECT_EQ(pool.reclaim_remote_releases(), pool.capacity()); // All came back remotely
+}
+
+TEST(ShardedRuntimeTest, WorkersAgeIdleFlowsSoNewFlowsAreAdmitted) {
+    constexpr uint32_t kFlows = 16;
+    policy::PolicyTree tree = makeRuntimeTestTree(1000000000000ull, 1000000); // Never limits
+    // Runs one full table's worth of flows, then as many new ones once the first are idle.
+    auto dropped_after_idle = [&tree](uint64_t idle_timeout_ns) {
+        ShardedRuntimeConfig config = makeRuntimeTestConfig(1);
+        config.flows_per_worker = kFlows; // REJECT once full
+        config.flow_aging.idle_timeout_ns = idle_timeout_ns;
+        ShardedRuntime runtime(config, tree, makeRuntimeTestScheduler(), [](const scheduler::PacketDescriptor&) {});
+        auto run_flows = [&runtime](uint32_t first_flow) {
+            std::vector<IncomingPacket> packets;
+            for (uint32_t flow = first_flow; flow < first_flow + kFlows; ++flow) {
+                packets.emplace_back(makeRuntimeTestTuple(flow), 100);
+            }
+            uint64_t target = runtime.worker_counters(0).packets_received.load() + packets.size();
+            dispatchAll(runtime, packets);
+            while (runtime.worker_counters(0).packets_received.load() < target) {
+                std::this_thread::yield();
+            }
+        };
+
+        runtime.start();
+        run_flows(0);
+        EXPECT_EQ(runtime.worker_counters(0).packets_dropped.load(), 0u);
+        // Idle for a few timeouts (or 10 ms with aging off) while the worker sweeps.
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(10);
+        while (std::chrono::steady_clock::now() < deadline ||
+               (idle_timeout_ns != 0 && runtime.worker_counters(0).flows_expired.load() < kFlows)) {
+            std::this_thread::yield();
+        }
+        run_flows(kFlows);
+        runtime.stop();
+        return runtime.worker_counters(0).packets_dropped.load();
+    };
+
+    EXPECT_EQ(dropped_after_idle(0), kFlows);     // Without aging the full table refuses them
+    EXPECT_EQ(dropped_after_idle(1000000), 0u);   // 1 ms idle timeout frees the table
+}
+
+TEST(ShardedRuntimeTest, PolicersAreShardedPerWorker) {
+    // Tiny rates: only the initial burst allowance passes, the rest is RED and dropped.
+    policy::PolicyTree tree = makeRuntimeTestTree(8000, 1500);
+    auto forwarded_for = [&tree](const std::vector<uint32_t>& flows) {
+        ShardedRuntime runtime(makeRuntimeTestConfig(2), tree, makeRuntimeTestScheduler(),
+                               [](const scheduler::PacketDescriptor&) {});
+        std::vector<IncomingPacket> packets;
+        for (int i = 0; i < 10; ++i) {
+            for (uint32_t flow : flows) {
+                packets.emplace_back(makeRuntimeTestTuple(flow), 1000);
+            }
+        }
+        runtime.start();
+        dispatchAll(runtime, packets);
+        runtime.stop();
+        return runtime.packets_transmitted();
+    };
+
+    // Find a flow on the other worker than flow 0, and one on the same worker.
+    ShardedRuntime probe(makeRuntimeTestConfig(2), tree, makeRuntimeTestScheduler(),
+                         [](const scheduler::PacketDescriptor&) {});
+    size_t worker_of_0 = probe.worker_for(makeRuntimeTestTuple(0));
+    uint32_t same = 0;
+    uint32_t other = 0;
+    for (uint32_t flow = 1; same == 0 || other == 0; ++flow) {
+        uint32_t& slot = probe.worker_for(makeRuntimeTestTuple(flow)) == worker_of_0 ? same : other;
+        if (slot == 0) {
+            slot = flow;
+        }
+    }
+
+    uint64_t one_shard = forwarded_for({0});
+    ASSERT_GT(one_shard, 0u);
+    ASSERT_LT(one_shard, 10u);
+    EXPECT_EQ(forwarded_for({0, same}), one_shard);      // Both flows drain one shard's buckets
+    EXPECT_EQ(forwarded_for({0, other}), 2 * one_shard); // Each worker meters its own buckets
+}
+
+TEST(ShardedRuntimeTest, PublishedPoliciesReachEveryWorker) {
+    policy::PolicyTree tree = makeRuntimeTestTree(1000000000000ull, 1000000, 0);
+    std::vector<uint8_t> priorities;
+    std::vector<scheduler::RedAqmParameters> params(2, scheduler::RedAqmParameters(1u << 22, 1u << 23, 0.01,
+                                                                                    0.002, 1u << 24));
+    ShardedRuntime runtime(makeRuntimeTestConfig(3), tree,
+                           std::make_unique<scheduler::StrictPriorityScheduler>(params),
+                           [&priorities](const scheduler::PacketDescriptor& packet) {
+                               priorities.push_back(packet.priority);
+                           });
+
+    policy::PolicyTree updated = makeRuntimeTestTree(1000000000000ull, 1000000, 1);
+    runtime.publish_policies(updated);
+
+    std::vector<IncomingPacket> packets;
+    for (uint32_t flow = 0; flow < 30; ++flow) {
+        packets.emplace_back(makeRuntimeTestTuple(flow), 100);
+    }
+    runtime.start();
+    dispatchAll(runtime, packets);
+    runtime.stop();
+
+    ASSERT_EQ(priorities.size(), packets.size());
+    for (uint8_t priority : priorities) {
+        EXPECT_EQ(priority, 1);
+    }
+}
+
+TEST(ShardedRuntimeTest, PolicyStatisticsFoldAllWorkers) {
+    policy::PolicyTree tree = makeRuntimeTestTree(1000000000000ull, 1000000); // Never limits
+    ShardedRuntime runtime(makeRuntimeTestConfig(4), tree, makeRuntimeTestScheduler(),
+                           [](const scheduler::PacketDescriptor&) {});
+
+    std::vector<IncomingPacket> packets;
+    for (uint32_t flow = 0; flow < 64; ++flow) {
+        packets.emplace_back(makeRuntimeTestTuple(flow), 100);
+    }
+    runtime.start();
+    dispatchAll(runtime, packets);
+    runtime.stop();
+
+    PolicyStatistics totals = runtime.policy_statistics().read(kRuntimePolicyId);
+    EXPECT_EQ(totals.packets_processed, packets.size());
+    EXPECT_EQ(totals.bytes_processed, 100u * packets.size());
+    EXPECT_EQ(totals.packets_dropped, 0u);
+    EXPECT_EQ(totals.packets_by_conformance[static_cast<size_t>(scheduler::ConformanceLevel::GREEN)],
+              packets.size());
+}
+
+TEST(ShardedRuntimeTest, PinnedWorkersWithAdaptiveBurstsTransmitEverything) {
+    policy::PolicyTree tree = makeRuntimeTestTree(1000000000000ull, 1000000); // Never limits
+    ShardedRuntimeConfig config = makeRuntimeTestConfig(2);
+    config.worker_cpus = {0}; // Worker 0 and the scheduler are built on CPU 0, worker 1 anywhere
+    config.egress_cpu = 0;
+    config.burst_size = 64;
+    config.min_burst_size = 4;
+    uint64_t transmitted = 0;
+    ShardedRuntime runtime(config, tree, ShardedRuntime::SchedulerFactory(makeRuntimeTestScheduler),
+                           [&transmitted](const scheduler::PacketDescriptor&) { ++transmitted; });
+    runtime.publish_policies(tree);
+
+    std::vector<IncomingPacket> packets;
+    for (uint32_t i = 0; i < 2000; ++i) {
+        packets.emplace_back(makeRuntimeTestTuple(i % 50), 100);
+    }
+    runtime.start();
+    dispatchAll(runtime, packets);
+    runtime.stop();
+
+    EXPECT_EQ(transmitted, packets.size());
+    for (size_t w = 0; w < runtime.num_workers(); ++w) {
+        uint64_t burst = runtime.worker_counters(w).burst_size.load();
+        EXPECT_GE(burst, config.min_burst_size);
+        EXPECT_LE(burst, config.burst_size);
+    }
+}
+
+TEST(ShardedRuntimeTest, EgressThreadPublishesTheStatsSegment) {
+    policy::PolicyTree tree = makeRuntimeTestTree(1000000000000ull, 1000000); // Never limits
+    ShardedRuntimeConfig config = makeRuntimeTestConfig(2);
+    config.stats_segment_name = "/hqts-test-runtime-" + std::to_string(getpid());
+    ShardedRuntime runtime(config, tree, makeRuntimeTestScheduler(), [](const scheduler::PacketDescriptor&) {});
+    ASSERT_NE(runtime.stats_segment(), nullptr);
+    monitor::StatsSegmentReader reader(config.stats_segment_name);
+
+    std::vector<IncomingPacket> packets;
+    for (uint32_t flow = 0; flow < 40; ++flow) {
+        packets.emplace_back(makeRuntimeTestTuple(flow), 100);
+    }
+    runtime.start();
+    dispatchAll(runtime, packets);
+    runtime.stop(); // Publishes the final counts
+
+    monitor::StatsView view;
+    ASSERT_TRUE(reader.read(view));
+    ASSERT_EQ(view.policies.size(), 1u);
+    EXPECT_EQ(view.policies[0].policy_id, kRuntimePolicyId);
+    EXPECT_EQ(view.policies[0].packets_processed, packets.size());
+    ASSERT_EQ(view.workers.size(), 2u);
+    EXPECT_EQ(view.workers[0].packets_received + view.workers[1].packets_received, packets.size());
+    EXPECT_EQ(view.workers[0].active_flows + view.workers[1].active_flows, 40u);
+    ASSERT_EQ(view.queues.size(), 1u); // The scheduler's one priority level
+    EXPECT_EQ(view.queues[0].packets_queued, 0u);
+}
+
+} // namespace core
+} // namespace hqts
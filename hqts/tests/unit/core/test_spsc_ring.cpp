@@ -0,0 +1,102 @@
+#include "gtest/gtest.h"
+#include "hqts/core/spsc_ring.h"
+
+#include <cstdint>
+#include <stdexcept> // For std::invalid_argument
+#include <thread>
+#include <vector>
+
+namespace hqts {
+namespace core {
+
+TEST(SpscRingTest, RoundsCapacityUpToPowerOfTwo) {
+    EXPECT_EQ(SpscRing<int>(1).capacity(), 1u);
+    EXPECT_EQ(SpscRing<int>(5).capacity(), 8u);
+    EXPECT_EQ(SpscRing<int>(64).capacity(), 64u);
+    EXPECT_THROW(SpscRing<int>(0), std::invalid_argument);
+}
+
+TEST(SpscRingTest, FifoOrderAndFullEmptyReporting) {
+    SpscRing<int> ring(4);
+    int value = 0;
+    EXPECT_TRUE(ring.empty());
+    EXPECT_FALSE(ring.try_pop(value));
+
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_TRUE(ring.try_push(i));
+    }
+    EXPECT_FALSE(ring.try_push(4)); // Full
+    EXPECT_EQ(ring.size(), 4u);
+
+    ASSERT_TRUE(ring.try_pop(value));
+    EXPECT_EQ(value, 0);
+    ASSERT_TRUE(ring.try_push(4)); // The freed slot is reused, wrapping the index
+    for (int expected = 1; expected <= 4; ++expected) {
+        ASSERT_TRUE(ring.try_pop(value));
+        EXPECT_EQ(value, expected);
+    }
+    EXPECT_TRUE(ring.empty());
+}
+
+TEST(SpscRingTest, PopBurstReturnsAvailableElementsInOrder) {
+    SpscRing<int> ring(8);
+    for (int i = 0; i < 5; ++i) {
+        ASSERT_TRUE(ring.try_push(i));
+    }
+    int out[8] = {};
+    ASSERT_EQ(ring.pop_burst(out, 3), 3u);
+    EXPECT_EQ(out[0], 0);
+    EXPECT_EQ(out[2], 2);
+    ASSERT_EQ(ring.pop_burst(out, 8), 2u); // Fewer than asked for
+    EXPECT_EQ(out[0], 3);
+    EXPECT_EQ(out[1], 4);
+    EXPECT_EQ(ring.pop_burst(out, 8), 0u);
+}
+
+TEST(SpscRingTest, PushBurstStopsWhenFull) {
+    SpscRing<int> ring(4);
+    const int items[6] = {0, 1, 2, 3, 4, 5};
+    ASSERT_EQ(ring.push_burst(items, 3), 3u);
+    ASSERT_EQ(ring.push_burst(items + 3, 3), 1u); // Only one slot left
+    EXPECT_EQ(ring.push_burst(items, 1), 0u);
+
+    int out[4] = {};
+    ASSERT_EQ(ring.pop_burst(out, 4), 4u);
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_EQ(out[i], i);
+    }
+}
+
+TEST(SpscRingTest, TransfersSequenceBetweenThreads) {
+    constexpr uint64_t kCount = 200000;
+    SpscRing<uint64_t> ring(64);
+
+    std::thread producer([&ring] {
+        for (uint64_t i = 0; i < kCount; ++i) {
+            while (!ring.try_push(i)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    std::vector<uint64_t> burst(16);
+    uint64_t expected = 0;
+    bool in_order = true;
+    while (expected < kCount) {
+        size_t count = ring.pop_burst(burst.data(), burst.size());
+        for (size_t i = 0; i < count; ++i) {
+            in_order = in_order && burst[i] == expected;
+            ++expected;
+        }
+        if (count == 0) {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+
+    EXPECT_TRUE(in_order);
+    EXPECT_TRUE(ring.empty());
+}
+
+} // namespace core
+} // namespace hqts
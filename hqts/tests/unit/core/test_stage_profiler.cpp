@@ -0,0 +1,97 @@
+#include "gtest/gtest.h"
+#include "hqts/core/stage_profiler.h"
+#include "hqts/core/packet_pipeline.h"
+#include "hqts/core/traffic_shaper.h"
+#include "hqts/dataplane/flow_classifier.h"
+#include "hqts/policy/policy_tree.h"
+#include "hqts/scheduler/strict_priority_scheduler.h"
+#include "hqts/scheduler/aqm_queue.h" // For RedAqmParameters
+
+#include <cstddef> // For size_t
+#include <vector>
+
+namespace hqts {
+namespace core {
+
+namespace {
+
+uint64_t stagePackets(const StageCycleCounters& counters, ProfileStage stage) {
+    return counters.packets[static_cast<size_t>(stage)].load();
+}
+
+uint64_t stageSections(const StageCycleCounters& counters, ProfileStage stage) {
+    return counters.sections[static_cast<size_t>(stage)].load();
+}
+
+} // namespace
+
+TEST(StageProfilerTest, TimersAddToTheBoundCounters) {
+    StageCycleCounters counters;
+    {
+        StageTimer unbound(ProfileStage::METER); // Nothing bound: discarded
+    }
+    StageCycleCounters* previous = bind_stage_counters(&counters);
+    ASSERT_EQ(bound_stage_counters(), &counters);
+    {
+        StageTimer single(ProfileStage::CLASSIFY);
+    }
+    {
+        StageTimer burst(ProfileStage::CLASSIFY, 32);
+    }
+    size_t dequeued = 0;
+    {
+        StageTimer result(ProfileStage::DEQUEUE, &dequeued);
+        dequeued = 7; // Read when the scope ends
+    }
+    bind_stage_counters(previous);
+
+    EXPECT_EQ(stageSections(counters, ProfileStage::CLASSIFY), 2u);
+    EXPECT_EQ(stagePackets(counters, ProfileStage::CLASSIFY), 33u);
+    EXPECT_EQ(stagePackets(counters, ProfileStage::DEQUEUE), 7u);
+    EXPECT_EQ(stageSections(counters, ProfileStage::METER), 0u);
+    EXPECT_GE(counters.cycles_per_packet(ProfileStage::CLASSIFY), 0.0);
+    EXPECT_EQ(counters.cycles_per_packet(ProfileStage::METER), 0.0);
+    EXPECT_STREQ(profile_stage_name(ProfileStage::AQM), "aqm");
+
+    counters.reset();
+    EXPECT_EQ(stagePackets(counters, ProfileStage::CLASSIFY), 0u);
+}
+
+TEST(StageProfilerTest, PipelineStagesAreCountedOnlyWhenProfilingIsBuiltIn) {
+    policy::PolicyTree policies;
+    policies.insert(ShapingPolicy(1, 0, "profiled", 1000000000, 1000000000, 1000000, 1000000,
+                                  policy::SchedulingAlgorithm::STRICT_PRIORITY, 100, 0, false, 0, 0, 0, 0, 0, 0));
+    FlowTable table(64);
+    dataplane::FlowClassifier classifier(table, 1);
+    TrafficShaper shaper(policies, classifier, table);
+    scheduler::StrictPriorityScheduler scheduler(
+        std::vector<scheduler::RedAqmParameters>{scheduler::RedAqmParameters(100000, 200000, 0.01, 0.002, 250000)});
+    PacketPipeline pipeline(classifier, shaper, scheduler);
+
+    std::vector<IncomingPacket> burst;
+    for (uint32_t i = 0; i < 8; ++i) {
+        burst.emplace_back(dataplane::FiveTuple(0x0A000001, 0x0A000002, static_cast<uint16_t>(i), 80, 6), 100);
+    }
+    StageCycleCounters counters;
+    StageCycleCounters* previous = bind_stage_counters(&counters);
+    pipeline.handle_incoming_burst(burst, 1000);
+    std::vector<scheduler::PacketDescriptor> out;
+    ASSERT_EQ(pipeline.get_next_burst(out, 16), burst.size());
+    bind_stage_counters(previous);
+
+#if defined(HQTS_PROFILING)
+    EXPECT_EQ(stagePackets(counters, ProfileStage::CLASSIFY), burst.size());
+    EXPECT_EQ(stagePackets(counters, ProfileStage::METER), burst.size());
+    EXPECT_EQ(stagePackets(counters, ProfileStage::ENQUEUE), burst.size());
+    EXPECT_EQ(stagePackets(counters, ProfileStage::AQM), burst.size()); // One RED decision each
+    EXPECT_EQ(stagePackets(counters, ProfileStage::DEQUEUE), burst.size());
+    EXPECT_EQ(stageSections(counters, ProfileStage::DEQUEUE), 1u);
+#else
+    for (size_t stage = 0; stage < PROFILE_STAGE_COUNT; ++stage) {
+        EXPECT_EQ(counters.sections[stage].load(), 0u) << "stage " << stage; // Compiled out
+    }
+#endif
+}
+
+} // namespace core
+} // namespace hqts
@@ -0,0 +1,129 @@
+#include "gtest/gtest.h"
+#include "hqts/core/timing_wheel.h"
+
+#include <cstdint>
+#include <stdexcept> // For std::invalid_argument
+#include <vector>
+
+namespace hqts {
+namespace core {
+
+namespace {
+
+scheduler::PacketDescriptor make_packet(uint64_t flow_id) {
+    return scheduler::PacketDescriptor(flow_id, 100, 0);
+}
+
+std::vector<uint64_t> drain_flows(TimingWheel& wheel) {
+    std::vector<uint64_t> flows;
+    while (wheel.has_ready()) {
+        flows.push_back(wheel.pop_ready().flow_id);
+    }
+    return flows;
+}
+
+} // namespace
+
+TEST(TimingWheelTest, ConstructorValidatesArguments) {
+    ASSERT_THROW(TimingWheel(0), std::invalid_argument);
+    ASSERT_THROW(TimingWheel(16, 0), std::invalid_argument);
+    TimingWheel wheel(16, 500, 10000);
+    ASSERT_EQ(wheel.capacity(), 16u);
+    ASSERT_EQ(wheel.tick_ns(), 500u);
+    ASSERT_TRUE(wheel.empty());
+    ASSERT_EQ(wheel.next_event_ns(), UINT64_MAX);
+}
+
+TEST(TimingWheelTest, ReleasesInTimeOrder) {
+    TimingWheel wheel(16, 1000);
+    ASSERT_TRUE(wheel.schedule(make_packet(3), 30000));
+    ASSERT_TRUE(wheel.schedule(make_packet(1), 10000));
+    ASSERT_TRUE(wheel.schedule(make_packet(2), 20500));
+    ASSERT_EQ(wheel.size(), 3u);
+    ASSERT_EQ(wheel.next_event_ns(), 10000u);
+
+    ASSERT_EQ(wheel.advance(9999), 0u);
+    ASSERT_FALSE(wheel.has_ready());
+    ASSERT_EQ(wheel.advance(10000), 1u);
+    ASSERT_EQ(drain_flows(wheel), std::vector<uint64_t>({1}));
+    ASSERT_EQ(wheel.next_event_ns(), 20000u); // Tick granularity: 20500 falls in tick 20
+
+    ASSERT_EQ(wheel.advance(40000), 2u);
+    ASSERT_EQ(drain_flows(wheel), std::vector<uint64_t>({2, 3}));
+    ASSERT_TRUE(wheel.empty());
+}
+
+TEST(TimingWheelTest, SameTickKeepsScheduleOrder) {
+    TimingWheel wheel(16, 1000);
+    for (uint64_t flow = 1; flow <= 5; ++flow) {
+        ASSERT_TRUE(wheel.schedule(make_packet(flow), 70000 + flow * 100)); // All in tick 70
+    }
+    ASSERT_TRUE(wheel.schedule(make_packet(6), 0)); // Already due
+    ASSERT_EQ(wheel.ready_count(), 1u);
+    wheel.advance(70000);
+    ASSERT_EQ(drain_flows(wheel), std::vector<uint64_t>({6, 1, 2, 3, 4, 5}));
+}
+
+TEST(TimingWheelTest, CascadesFromUpperLevelsAndOverflow) {
+    TimingWheel wheel(16, 1);
+    const TimestampNs level1_ns = 300;               // Differs from tick 0 in digit 1
+    const TimestampNs level3_ns = (1ULL << 24) + 5;  // Digit 3
+    const TimestampNs overflow_ns = (1ULL << 33) + 7; // Beyond 2^32 ticks
+    ASSERT_TRUE(wheel.schedule(make_packet(3), overflow_ns));
+    ASSERT_TRUE(wheel.schedule(make_packet(2), level3_ns));
+    ASSERT_TRUE(wheel.schedule(make_packet(1), level1_ns));
+
+    ASSERT_EQ(wheel.advance(level1_ns - 1), 0u);
+    ASSERT_EQ(wheel.advance(level1_ns), 1u);
+    ASSERT_EQ(drain_flows(wheel), std::vector<uint64_t>({1}));
+
+    ASSERT_EQ(wheel.advance(level3_ns - 1), 0u);
+    ASSERT_EQ(wheel.next_event_ns(), level3_ns);
+    ASSERT_EQ(wheel.advance(level3_ns), 1u);
+    ASSERT_EQ(drain_flows(wheel), std::vector<uint64_t>({2}));
+
+    ASSERT_EQ(wheel.advance(overflow_ns - 1), 0u);
+    ASSERT_EQ(wheel.next_event_ns(), overflow_ns);
+    ASSERT_EQ(wheel.advance(overflow_ns), 1u);
+    ASSERT_EQ(drain_flows(wheel), std::vector<uint64_t>({3}));
+}
+
+TEST(TimingWheelTest, RejectsWhenFullAndReusesNodes) {
+    TimingWheel wheel(2, 1000);
+    ASSERT_TRUE(wheel.schedule(make_packet(1), 5000));
+    ASSERT_TRUE(wheel.schedule(make_packet(2), 6000));
+    ASSERT_FALSE(wheel.schedule(make_packet(3), 7000));
+
+    wheel.advance(5000);
+    ASSERT_EQ(wheel.pop_ready().flow_id, 1u);
+    ASSERT_TRUE(wheel.schedule(make_packet(3), 5500)); // Current tick: ready at once
+    ASSERT_EQ(wheel.size(), 2u);
+    ASSERT_EQ(drain_flows(wheel), std::vector<uint64_t>({3}));
+}
+
+TEST(TimingWheelTest, PacesManyPacketsAcrossLevels) {
+    const size_t count = 100000;
+    TimingWheel wheel(count, 100);
+    // Packets spaced 1.2 us apart in a shuffled order, spanning three wheel levels.
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t slot = (i * 7919) % count; // 7919 is coprime with count: a permutation
+        ASSERT_TRUE(wheel.schedule(make_packet(slot), slot * 1200));
+    }
+    uint64_t expected = 0;
+    for (TimestampNs now_ns = 0; expected < count; now_ns += 50000) {
+        wheel.advance(now_ns);
+        while (wheel.has_ready()) {
+            scheduler::PacketDescriptor packet = wheel.pop_ready();
+            ASSERT_EQ(packet.flow_id, expected); // Released in time order...
+            ASSERT_LE(packet.flow_id * 1200, now_ns); // ...and never early
+            ++expected;
+        }
+        if (!wheel.empty()) {
+            ASSERT_GT(wheel.next_event_ns(), now_ns); // Everything due was released
+        }
+    }
+    ASSERT_TRUE(wheel.empty());
+}
+
+} // namespace core
+} // namespace hqts
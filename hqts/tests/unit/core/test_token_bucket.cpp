@@ -244,22 +244,167 @@ TEST_F(TokenBucketTest, IsConformingNoSideEffects) {
     ASSERT_EQ(tb.available_tokens(), 800);
 }
 
-// Test with very high rate to check for overflow issues if any (though uint64_t should be fine)
+// Test with very high rate to check for overflow issues if any (though uint64_t should be fine).
+// Driven by virtual time: at 2000 bytes per microsecond even the gap between two clock
+// reads refills tokens, so the "empty right after consume" check needs a fixed timestamp.
 TEST_F(TokenBucketTest, HighRateRefill) {
     uint64_t high_rate_bps = 8ULL * 1000000 * 2000; // 2000 Bytes per microsecond effectively, or 2GB/s
     uint64_t capacity_bytes = 50000; // 50KB
-    TokenBucket tb(high_rate_bps, capacity_bytes);
+    TimestampNs now_ns = 1000000000;
+    TokenBucket tb(high_rate_bps, capacity_bytes, now_ns);
 
-    ASSERT_TRUE(tb.consume(capacity_bytes));
-    ASSERT_EQ(tb.available_tokens(), 0);
+    ASSERT_TRUE(tb.consume(capacity_bytes, now_ns));
+    ASSERT_EQ(tb.available_tokens(now_ns), 0);
 
-    sleep_ms(10); // 10 ms = 10000 microseconds
+    now_ns += 10 * 1000000; // 10 ms = 10000 microseconds
     // Expected: 10000 us * (high_rate_bps / (8 * 1000000))
     // = 10000 us * 2000 B/us = 20,000,000 Bytes. This will be capped by capacity.
     // So, after 10ms, it should be full (50000 bytes)
 
     // Refill happens on available_tokens()
-    expect_tokens_near(tb.available_tokens(), capacity_bytes);
+    ASSERT_EQ(tb.available_tokens(now_ns), capacity_bytes);
+}
+
+TEST_F(TokenBucketTest, CallerSuppliedTimestamps) {
+    TimestampNs now_ns = 5000000000;
+    TokenBucket tb(8000, 1000, now_ns); // 1000 bytes/sec, 1000 bytes capacity
+
+    ASSERT_TRUE(tb.consume(1000, now_ns));
+    ASSERT_FALSE(tb.is_conforming(1, now_ns));
+
+    now_ns += 250000000; // 250 ms -> 250 bytes
+    ASSERT_TRUE(tb.is_conforming(250, now_ns));
+    ASSERT_FALSE(tb.is_conforming(251, now_ns));
+    ASSERT_TRUE(tb.consume(200, now_ns));
+    ASSERT_EQ(tb.available_tokens(now_ns), 50);
+
+    // The same timestamp again (e.g. the next packet of a burst) adds nothing.
+    ASSERT_TRUE(tb.consume(50, now_ns));
+    ASSERT_FALSE(tb.consume(1, now_ns));
+
+    now_ns += 10000000000ULL; // Long idle period: capped at capacity
+    ASSERT_EQ(tb.available_tokens(now_ns), 1000);
+}
+
+TEST_F(TokenBucketTest, StaleTimestampAddsNoTokens) {
+    TimestampNs now_ns = 2000000000;
+    TokenBucket tb(8000, 1000, now_ns);
+    ASSERT_TRUE(tb.consume(1000, now_ns));
+
+    // A timestamp older than the last refill (e.g. taken before another core metered
+    // the same policy) must neither add tokens nor move the bucket's time base back.
+    ASSERT_EQ(tb.available_tokens(now_ns - 500000000), 0);
+    ASSERT_TRUE(tb.consume(0, now_ns - 500000000));
+    now_ns += 100000000; // 100 ms after the original refill -> 100 bytes
+    ASSERT_EQ(tb.available_tokens(now_ns), 100);
+}
+
+TEST_F(TokenBucketTest, FirstTimestampSetsTimeBaseOfLegacyBucket) {
+    // A bucket built without a timestamp can be driven by any monotonic clock:
+    // the first refill only establishes its time base.
+    TokenBucket tb(8000, 1000);
+    TimestampNs now_ns = 42;
+    ASSERT_TRUE(tb.consume(600, now_ns));
+    ASSERT_EQ(tb.available_tokens(now_ns), 400);
+
+    tb.set_rate(16000, now_ns + 100000000); // 100 ms at the old rate -> +100 bytes
+    ASSERT_EQ(tb.available_tokens(now_ns + 100000000), 500);
+    tb.set_capacity(800, now_ns + 200000000); // 100 ms at 2000 B/s -> +200 bytes
+    ASSERT_EQ(tb.available_tokens(now_ns + 200000000), 700);
+}
+
+TEST_F(TokenBucketTest, FrequentRefillsKeepFractionalTokens) {
+    // 8000 bps = 1 byte per millisecond. Refilling every 10 us adds 1/100 byte each time;
+    // discarding fractions would leave the bucket empty forever.
+    TimestampNs now_ns = 1000000;
+    TokenBucket tb(8000, 1000, now_ns);
+    ASSERT_TRUE(tb.consume(1000, now_ns));
+
+    for (int i = 0; i < 1000; ++i) { // 10 ms in 10 us steps
+        now_ns += 10000;
+        tb.consume(0, now_ns);
+    }
+    ASSERT_EQ(tb.available_tokens(now_ns), 10);
+
+    // Sub-nanosecond-per-byte rates: 1 byte every 3 ns at 8/3 Gbps is exact over time too.
+    TokenBucket fast(8000000000ULL / 3, 1000000, now_ns);
+    ASSERT_TRUE(fast.consume(1000000, now_ns));
+    for (int i = 0; i < 3000; ++i) {
+        fast.consume(0, ++now_ns);
+    }
+    ASSERT_EQ(fast.available_tokens(now_ns), 999); // 3000 ns * (8e9/3 bps, floored) < 1000 bytes
+}
+
+TEST_F(TokenBucketTest, LongIdleAtHighRateDoesNotOverflow) {
+    uint64_t rate_bps = 400ULL * 1000000000; // 400 Gbps
+    uint64_t capacity_bytes = 10000000;      // 10 MB burst
+    TimestampNs now_ns = 0;
+    TokenBucket tb(rate_bps, capacity_bytes, now_ns);
+    ASSERT_TRUE(tb.consume(capacity_bytes, now_ns));
+
+    now_ns += 3600ULL * 1000000000; // One hour: elapsed * rate would overflow 64 bits
+    ASSERT_EQ(tb.available_tokens(now_ns), capacity_bytes);
+
+    ASSERT_TRUE(tb.consume(capacity_bytes, now_ns));
+    now_ns += 100000; // 100 us at 50 bytes/ns
+    ASSERT_EQ(tb.available_tokens(now_ns), 5000000);
+}
+
+TEST_F(TokenBucketTest, OversizedRequestsAndCapacityAreBounded) {
+    TokenBucket tb(8000, 1000, 0);
+    ASSERT_FALSE(tb.is_conforming(UINT64_MAX, 0));
+    ASSERT_FALSE(tb.consume(UINT64_MAX, 0));
+    ASSERT_EQ(tb.available_tokens(0), 1000);
+
+    TokenBucket huge(8000, UINT64_MAX, 0);
+    ASSERT_EQ(huge.available_tokens(0), TokenBucket::MAX_CAPACITY_BYTES);
+}
+
+TEST_F(TokenBucketTest, ReserveBooksTokensAhead) {
+    TokenBucket tb(8000000, 1000, 0); // 1 byte per microsecond
+    ASSERT_EQ(tb.reserve(1000, 0, 1000000), 0u); // Available now: consumed at once
+
+    // Each reservation waits behind the previous one.
+    ASSERT_EQ(tb.reserve(100, 0, 1000000), 100000u);
+    ASSERT_EQ(tb.reserve(100, 50000, 1000000), 200000u);
+
+    // Too far out: refused without charging the bucket.
+    ASSERT_EQ(tb.reserve(1000, 50000, 1000000), TokenBucket::NEVER);
+    ASSERT_EQ(tb.reserve(10, 50000, 1000000), 210000u);
+
+    // Until the booked time passes, a policing check sees no tokens.
+    ASSERT_FALSE(tb.consume(1, 150000));
+    ASSERT_EQ(tb.available_tokens(210000), 0u);
+    ASSERT_EQ(tb.available_tokens(310000), 100u);
+
+    ASSERT_EQ(tb.reserve(1001, 310000, UINT64_MAX), TokenBucket::NEVER); // Above capacity
+    TokenBucket stopped(0, 1000, 0);
+    ASSERT_EQ(stopped.reserve(1000, 0, 0), 0u);
+    ASSERT_EQ(stopped.reserve(1, 0, UINT64_MAX), TokenBucket::NEVER); // Never refills
+}
+
+TEST_F(TokenBucketTest, ReserveKeepsSubByteRemainder) {
+    TokenBucket tb(8000000000ULL / 3, 1000, 0); // 1/3 byte per ns
+    ASSERT_EQ(tb.reserve(1000, 0, 0), 0u);
+    TimestampNs release_ns = 0;
+    for (int i = 0; i < 300; ++i) {
+        release_ns = tb.reserve(1, 0, UINT64_MAX);
+    }
+    // 300 bytes take 900 ns at exactly 1/3 byte per ns, plus the floored rate's shortfall
+    // of at most 1 ns: rounding up each reservation must not add up.
+    ASSERT_GE(release_ns, 900u);
+    ASSERT_LE(release_ns, 901u);
+}
+
+TEST_F(TokenBucketTest, DrainStopsAtEmpty) {
+    TokenBucket tb(8000, 1000, 0); // 1 byte per ms
+    tb.drain(400, 0);
+    ASSERT_EQ(tb.available_tokens(0), 600u);
+    tb.drain(900, 0); // More than available: the bucket empties, it does not go into debt
+    ASSERT_EQ(tb.available_tokens(0), 0u);
+    ASSERT_EQ(tb.available_tokens(5000000), 5u);
+    tb.drain(UINT64_MAX, 5000000);
+    ASSERT_EQ(tb.available_tokens(5000000), 0u);
 }
 
 TEST_F(TokenBucketTest, ConsumeZeroTokens) {
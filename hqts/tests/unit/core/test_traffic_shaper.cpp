@@ -11,6 +11,7 @@
 #include <vector>
 #include <iostream> // For potential debug
 #include <memory>   // For std::unique_ptr
+#include <stdexcept> // For std::out_of_range
 
 namespace hqts {
 namespace core {
@@ -18,7 +19,7 @@ namespace core {
 // Helper to create a PacketDescriptor for TrafficShaper tests
 scheduler::PacketDescriptor createShaperTestPacket(core::FlowId flow_id, uint32_t length) {
     // Initial priority and conformance will be overridden by TrafficShaper
-    return scheduler::PacketDescriptor(flow_id, length, 0, 0, scheduler::ConformanceLevel::GREEN);
+    return scheduler::PacketDescriptor(flow_id, length, 0, core::INVALID_PACKET_BUFFER, scheduler::ConformanceLevel::GREEN);
 }
 
 class TrafficShaperTest : public ::testing::Test {
@@ -104,9 +105,9 @@ protected:
     // Helper to set a specific policy for a given 5-tuple for testing
     void set_policy_for_flow(const dataplane::FiveTuple& five_tuple, policy::PolicyId policy_id) {
         core::FlowId flow_id = test_flow_classifier_->get_or_create_flow(five_tuple);
-        auto it = test_flow_table_.find(flow_id);
-        ASSERT_NE(it, test_flow_table_.end());
-        it->second.policy_id = policy_id;
+        core::FlowContext* ctx = test_flow_table_.find_by_id(flow_id);
+        ASSERT_NE(ctx, nullptr);
+        ctx->policy_id = policy_id;
     }
 };
 
@@ -123,6 +124,7 @@ TEST_F(TrafficShaperTest, ProcessPacketGreen) {
     ASSERT_TRUE(should_enqueue);
     ASSERT_EQ(packet.conformance, scheduler::ConformanceLevel::GREEN);
     ASSERT_EQ(packet.flow_id, test_flow_classifier_->get_or_create_flow(tuple_gyr)); // Check if flow_id was set
+    ASSERT_EQ(packet.policy_id, POLICY_ID_GREEN_YELLOW_RED); // Metered policy is recorded for SchedulerTree
     ASSERT_EQ(packet.priority, 7); // target_priority_green for Policy 1
 }
 
@@ -221,5 +223,265 @@ TEST_F(TrafficShaperTest, CirOnlyPolicy) {
     // this assertion can be removed. Given the failure, removing it aligns with the request.
 }
 
+TEST_F(TrafficShaperTest, CallerTimestampDrivesRefill) {
+    dataplane::FiveTuple tuple_cir_only(5,6,7,9,6);
+    set_policy_for_flow(tuple_cir_only, POLICY_ID_CIR_ONLY_GREEN);
+
+    // Policy 4: CIR = PIR = 1Mbps (125 bytes per ms), CBS = PBS = 1500B, drop RED.
+    const TimestampNs t0 = 1000000000;
+    scheduler::PacketDescriptor packets[3] = {createShaperTestPacket(0, 1000),
+                                              createShaperTestPacket(0, 500),
+                                              createShaperTestPacket(0, 100)};
+    dataplane::FiveTuple tuples[3] = {tuple_cir_only, tuple_cir_only, tuple_cir_only};
+    // The whole burst is metered at t0: the bucket empties and the third packet is RED.
+    ASSERT_EQ(shaper_->process_burst(packets, tuples, 3, t0), 2);
+
+    scheduler::PacketDescriptor packet = createShaperTestPacket(0, 100);
+    ASSERT_FALSE(shaper_->process_packet(packet, tuple_cir_only, t0)); // Same instant: no refill
+    ASSERT_TRUE(shaper_->process_packet(packet, tuple_cir_only, t0 + 1000000)); // +1ms: 125B
+    ASSERT_EQ(packet.conformance, scheduler::ConformanceLevel::GREEN);
+    ASSERT_EQ(test_flow_table_.last_seen_ns_by_id(packet.flow_id), t0 + 1000000);
+}
+
+TEST_F(TrafficShaperTest, FlowCachesItsPolicyHandle) {
+    dataplane::FiveTuple tuple(10,20,30,40,6);
+    set_policy_for_flow(tuple, POLICY_ID_GREEN_YELLOW_RED);
+    const TimestampNs t0 = 1000000000;
+
+    scheduler::PacketDescriptor packet = createShaperTestPacket(0, 100);
+    ASSERT_TRUE(shaper_->process_packet(packet, tuple, t0));
+    const core::FlowContext* ctx = test_flow_table_.find_by_id(packet.flow_id);
+    ASSERT_NE(ctx, nullptr);
+    ASSERT_NE(ctx->policy, nullptr);
+    ASSERT_EQ(ctx->policy->id, POLICY_ID_GREEN_YELLOW_RED);
+    const policy::RuntimePolicy* cached = ctx->policy;
+    ASSERT_EQ(packet.priority, 7);
+
+    // Changing the flow's policy_id re-resolves the handle without invalidation.
+    set_policy_for_flow(tuple, POLICY_ID_ALLOW_RED_LOW_PRIO);
+    ASSERT_TRUE(shaper_->process_packet(packet, tuple, t0));
+    ASSERT_EQ(ctx->policy->id, POLICY_ID_ALLOW_RED_LOW_PRIO);
+    ASSERT_EQ(packet.priority, 5);
+
+    // Back to the first policy: same snapshot, same record, bucket state kept.
+    set_policy_for_flow(tuple, POLICY_ID_GREEN_YELLOW_RED);
+    ASSERT_TRUE(shaper_->process_packet(packet, tuple, t0));
+    ASSERT_EQ(ctx->policy, cached);
+
+    // Replacing a policy requires recompiling, which invalidates the cached handles.
+    set_policy_for_flow(tuple, POLICY_ID_ALLOW_RED_LOW_PRIO);
+    test_policy_tree_.erase(POLICY_ID_ALLOW_RED_LOW_PRIO);
+    test_policy_tree_.insert(ShapingPolicy(
+        POLICY_ID_ALLOW_RED_LOW_PRIO, NO_PARENT, "Policy_AllowR_Replaced",
+        500000, 1000000, 1000, 2000,
+        policy::SchedulingAlgorithm::STRICT_PRIORITY, 100, 0,
+        false, 6, 2, 0, 30, 31, 32));
+    shaper_->invalidate_policy_cache();
+    ASSERT_TRUE(shaper_->process_packet(packet, tuple, t0));
+    ASSERT_EQ(packet.priority, 6);
+    ASSERT_EQ(ctx->policy->id, POLICY_ID_ALLOW_RED_LOW_PRIO);
+
+    // Policies inserted after compilation are found without invalidation.
+    const policy::PolicyId POLICY_ID_LATE = 77;
+    test_policy_tree_.insert(ShapingPolicy(
+        POLICY_ID_LATE, NO_PARENT, "Policy_Late",
+        500000, 1000000, 1000, 2000,
+        policy::SchedulingAlgorithm::STRICT_PRIORITY, 100, 0,
+        false, 3, 2, 1, 30, 31, 32));
+    set_policy_for_flow(tuple, POLICY_ID_LATE);
+    ASSERT_TRUE(shaper_->process_packet(packet, tuple, t0));
+    ASSERT_EQ(packet.priority, 3);
+
+    // Swapping one policy for another keeps the tree's size; the new one is still found.
+    const policy::PolicyId POLICY_ID_SWAPPED_IN = 78;
+    test_policy_tree_.erase(POLICY_ID_LATE);
+    test_policy_tree_.insert(ShapingPolicy(
+        POLICY_ID_SWAPPED_IN, NO_PARENT, "Policy_SwappedIn",
+        500000, 1000000, 1000, 2000,
+        policy::SchedulingAlgorithm::STRICT_PRIORITY, 100, 0,
+        false, 4, 2, 1, 30, 31, 32));
+    set_policy_for_flow(tuple, POLICY_ID_SWAPPED_IN);
+    ASSERT_TRUE(shaper_->process_packet(packet, tuple, t0));
+    ASSERT_EQ(packet.priority, 4);
+    ASSERT_EQ(ctx->policy->id, POLICY_ID_SWAPPED_IN);
+
+    // A policy that disappears is noticed once the cache is invalidated.
+    set_policy_for_flow(tuple, POLICY_ID_ALLOW_RED_LOW_PRIO);
+    test_policy_tree_.erase(POLICY_ID_ALLOW_RED_LOW_PRIO);
+    shaper_->invalidate_policy_cache();
+    ASSERT_FALSE(shaper_->process_packet(packet, tuple, t0));
+    ASSERT_EQ(packet.conformance, scheduler::ConformanceLevel::RED);
+}
+
+TEST_F(TrafficShaperTest, AggregatePeakRateCapsSumOfChildren) {
+    // Tenant aggregate: 2000 B of peak burst shared by two children of 1500 B CIR each.
+    const policy::PolicyId TENANT = 100, CHILD_A = 101, CHILD_B = 102;
+    test_policy_tree_.insert(ShapingPolicy(TENANT, NO_PARENT, "Tenant", 1000000, 1000000, 1000, 2000,
+                                           policy::SchedulingAlgorithm::STRICT_PRIORITY, 100, 0));
+    for (policy::PolicyId child : {CHILD_A, CHILD_B}) {
+        test_policy_tree_.insert(ShapingPolicy(child, TENANT, "Child", 1000000, 2000000, 1500, 3000,
+                                               policy::SchedulingAlgorithm::STRICT_PRIORITY, 100, 0,
+                                               false, 7, 4, 1));
+    }
+    dataplane::FiveTuple tuple_a(1,1,1,1,6), tuple_b(2,2,2,2,6);
+    set_policy_for_flow(tuple_a, CHILD_A);
+    set_policy_for_flow(tuple_b, CHILD_B);
+    const TimestampNs t0 = 1000000000;
+
+    scheduler::PacketDescriptor packet = createShaperTestPacket(0, 1500);
+    ASSERT_TRUE(shaper_->process_packet(packet, tuple_a, t0));
+    EXPECT_EQ(packet.conformance, scheduler::ConformanceLevel::GREEN);
+
+    // B is within its own CIR, but the tenant has only 500 B of its cap left.
+    packet = createShaperTestPacket(0, 1000);
+    ASSERT_TRUE(shaper_->process_packet(packet, tuple_b, t0));
+    EXPECT_EQ(packet.conformance, scheduler::ConformanceLevel::RED);
+    packet = createShaperTestPacket(0, 500);
+    ASSERT_TRUE(shaper_->process_packet(packet, tuple_b, t0));
+    EXPECT_EQ(packet.conformance, scheduler::ConformanceLevel::GREEN);
+
+    // The RED packet charged nothing: after 1 ms (125 B of tenant cap) B's CIR still has 1000 B.
+    packet = createShaperTestPacket(0, 125);
+    ASSERT_TRUE(shaper_->process_packet(packet, tuple_b, t0 + 1000000));
+    EXPECT_EQ(packet.conformance, scheduler::ConformanceLevel::GREEN);
+}
+
+TEST_F(TrafficShaperTest, ShapedChildrenWaitForTheAggregatesPeakRate) {
+    // Tenant capped at 1 B/us with one 1000 B burst; shaped children of 10 B/us each.
+    const policy::PolicyId TENANT = 300, CHILD_A = 301, CHILD_B = 302;
+    test_policy_tree_.insert(ShapingPolicy(TENANT, NO_PARENT, "Tenant", 8000000, 8000000, 1000, 1000,
+                                           policy::SchedulingAlgorithm::STRICT_PRIORITY, 100, 0));
+    for (policy::PolicyId child : {CHILD_A, CHILD_B}) {
+        ShapingPolicy shaped(child, TENANT, "Shaped", 80000000, 0, 1000, 0,
+                             policy::SchedulingAlgorithm::STRICT_PRIORITY, 100, 0, true, 6, 6, 6);
+        shaped.shape_to_cir = true;
+        shaped.max_shaping_delay_ns = 2000000; // 2 ms
+        test_policy_tree_.insert(shaped);
+    }
+    dataplane::FiveTuple tuple_a(5,5,5,5,6), tuple_b(6,6,6,6,6);
+    set_policy_for_flow(tuple_a, CHILD_A);
+    set_policy_for_flow(tuple_b, CHILD_B);
+    const TimestampNs t0 = 1000000000;
+    TimestampNs release_ns = 0;
+
+    scheduler::PacketDescriptor packet = createShaperTestPacket(0, 1000);
+    ASSERT_TRUE(shaper_->process_packet(packet, tuple_a, t0, &release_ns));
+    EXPECT_EQ(release_ns, t0);
+
+    // B's own CIR is full, but the tenant's cap is spent: B waits for 1000 B of it.
+    packet = createShaperTestPacket(0, 1000);
+    ASSERT_TRUE(shaper_->process_packet(packet, tuple_b, t0, &release_ns));
+    EXPECT_EQ(packet.conformance, scheduler::ConformanceLevel::GREEN);
+    EXPECT_EQ(release_ns, t0 + 1000000);
+
+    // A's CIR would grant 500 B after 50 us; the cap queues it behind B's booking.
+    packet = createShaperTestPacket(0, 500);
+    ASSERT_TRUE(shaper_->process_packet(packet, tuple_a, t0, &release_ns));
+    EXPECT_EQ(release_ns, t0 + 1500000);
+
+    // Beyond the shaping delay, or sent at once, the packet is RED and books nothing.
+    packet = createShaperTestPacket(0, 1000);
+    EXPECT_FALSE(shaper_->process_packet(packet, tuple_a, t0, &release_ns));
+    EXPECT_EQ(packet.conformance, scheduler::ConformanceLevel::RED);
+    packet = createShaperTestPacket(0, 100);
+    EXPECT_FALSE(shaper_->process_packet(packet, tuple_b, t0));
+    packet = createShaperTestPacket(0, 400);
+    ASSERT_TRUE(shaper_->process_packet(packet, tuple_b, t0, &release_ns));
+    EXPECT_EQ(release_ns, t0 + 1900000);
+}
+
+TEST_F(TrafficShaperTest, ChildBorrowsParentsSpareCommittedRate) {
+    // Parent: 3000 B committed, no cap. Child: 1000 B committed, no peak rate.
+    const policy::PolicyId PARENT = 200, CHILD = 201, SIBLING = 202;
+    test_policy_tree_.insert(ShapingPolicy(PARENT, NO_PARENT, "Parent", 1000000, 0, 3000, 0,
+                                           policy::SchedulingAlgorithm::STRICT_PRIORITY, 100, 0));
+    test_policy_tree_.insert(ShapingPolicy(CHILD, PARENT, "Child", 1000000, 0, 1000, 0,
+                                           policy::SchedulingAlgorithm::STRICT_PRIORITY, 100, 0,
+                                           false, 7, 4, 1));
+    test_policy_tree_.insert(ShapingPolicy(SIBLING, PARENT, "Sibling", 1000000, 0, 1000, 0,
+                                           policy::SchedulingAlgorithm::STRICT_PRIORITY, 100, 0,
+                                           false, 7, 4, 1));
+    dataplane::FiveTuple tuple(3,3,3,3,6), sibling_tuple(4,4,4,4,6);
+    set_policy_for_flow(tuple, CHILD);
+    set_policy_for_flow(sibling_tuple, SIBLING);
+    const TimestampNs t0 = 1000000000;
+
+    // Own CIR, then two borrowed packets: the child's own traffic also used up 1000 B of
+    // the parent's committed tokens, so only 2000 B are left to lend.
+    for (int i = 0; i < 3; ++i) {
+        scheduler::PacketDescriptor packet = createShaperTestPacket(0, 1000);
+        ASSERT_TRUE(shaper_->process_packet(packet, tuple, t0));
+        EXPECT_EQ(packet.conformance, scheduler::ConformanceLevel::GREEN) << "packet " << i;
+        EXPECT_EQ(packet.priority, 7);
+    }
+    scheduler::PacketDescriptor packet = createShaperTestPacket(0, 1000);
+    ASSERT_TRUE(shaper_->process_packet(packet, tuple, t0));
+    EXPECT_EQ(packet.conformance, scheduler::ConformanceLevel::RED); // Nothing left to borrow
+    EXPECT_EQ(packet.priority, 1);
+
+    // The sibling's own CIR is untouched by the borrowing.
+    packet = createShaperTestPacket(0, 1000);
+    ASSERT_TRUE(shaper_->process_packet(packet, sibling_tuple, t0));
+    EXPECT_EQ(packet.conformance, scheduler::ConformanceLevel::GREEN);
+}
+
+TEST_F(TrafficShaperTest, AttachedStatisticsCountMeteredPackets) {
+    PerCorePolicyStatistics stats(2, 8);
+    shaper_->attach_statistics(&stats, 1);
+    EXPECT_THROW(shaper_->attach_statistics(&stats, 2), std::out_of_range);
+
+    dataplane::FiveTuple tuple_drop_r(3,4,5,6,6);
+    set_policy_for_flow(tuple_drop_r, POLICY_ID_DROP_RED); // CBS 1000, PBS 2000, drops RED
+    for (int i = 0; i < 4; ++i) {
+        scheduler::PacketDescriptor packet = createShaperTestPacket(0, 800);
+        shaper_->process_packet(packet, tuple_drop_r, 0);
+    }
+
+    PolicyStatistics totals = stats.read(POLICY_ID_DROP_RED);
+    EXPECT_EQ(totals.packets_processed, 4u);
+    EXPECT_EQ(totals.bytes_processed, 3200u);
+    EXPECT_EQ(totals.packets_by_conformance[static_cast<size_t>(scheduler::ConformanceLevel::GREEN)], 1u);
+    EXPECT_EQ(totals.packets_by_conformance[static_cast<size_t>(scheduler::ConformanceLevel::YELLOW)], 1u);
+    EXPECT_EQ(totals.packets_by_conformance[static_cast<size_t>(scheduler::ConformanceLevel::RED)], 2u);
+    EXPECT_EQ(totals.packets_dropped, 2u);
+    EXPECT_EQ(totals.bytes_dropped, 1600u);
+
+    shaper_->attach_statistics(nullptr, 0);
+    scheduler::PacketDescriptor packet = createShaperTestPacket(0, 800);
+    shaper_->process_packet(packet, tuple_drop_r, 0);
+    EXPECT_EQ(stats.read(POLICY_ID_DROP_RED).packets_processed, 4u);
+}
+
+TEST_F(TrafficShaperTest, PipelinedBurstMetersAndCountsEveryPacket) {
+    PerCorePolicyStatistics stats(1, 8);
+    shaper_->attach_statistics(&stats, 0);
+    const policy::PolicyId policy_ids[3] = {POLICY_ID_GREEN_YELLOW_RED, POLICY_ID_ALLOW_RED_LOW_PRIO,
+                                            POLICY_ID_DEFAULT};
+    std::vector<dataplane::FiveTuple> flows;
+    for (uint16_t f = 0; f < 3; ++f) {
+        flows.emplace_back(100 + f, 200, 1000, 80, 6);
+        set_policy_for_flow(flows.back(), policy_ids[f]);
+    }
+
+    // Two bursts longer than the prefetch distance: the first resolves the flows'
+    // policy handles, the second meters through the prefetched cached handles.
+    const size_t burst = 20;
+    for (int round = 0; round < 2; ++round) {
+        std::vector<scheduler::PacketDescriptor> packets;
+        std::vector<dataplane::FiveTuple> tuples;
+        for (size_t i = 0; i < burst; ++i) {
+            packets.push_back(createShaperTestPacket(0, 10));
+            tuples.push_back(flows[i % 3]);
+        }
+        ASSERT_EQ(shaper_->process_burst(packets.data(), tuples.data(), burst, 0), burst);
+        for (size_t i = 0; i < burst; ++i) {
+            ASSERT_EQ(packets[i].policy_id, policy_ids[i % 3]) << "packet " << i;
+        }
+    }
+    EXPECT_EQ(stats.read(POLICY_ID_GREEN_YELLOW_RED).packets_processed, 14u);
+    EXPECT_EQ(stats.read(POLICY_ID_ALLOW_RED_LOW_PRIO).packets_processed, 14u);
+    EXPECT_EQ(stats.read(POLICY_ID_DEFAULT).packets_processed, 12u);
+}
+
 } // namespace core
 } // namespace hqts
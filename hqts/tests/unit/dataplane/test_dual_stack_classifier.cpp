@@ -0,0 +1,144 @@
+#include "gtest/gtest.h"
+#include "hqts/dataplane/dual_stack_classifier.h"
+#include "hqts/dataplane/address_interner.h"
+
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+namespace hqts {
+namespace dataplane {
+
+namespace {
+
+ExtendedFlowKey ipv6_key(uint8_t source_low, uint8_t dest_low, uint16_t source_port, uint32_t vni = 0) {
+    ExtendedFlowKey key;
+    key.source_ip = {0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, source_low};
+    key.dest_ip = {0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, dest_low};
+    key.source_port = source_port;
+    key.dest_port = 443;
+    key.protocol = 6;
+    key.vni = vni;
+    return key;
+}
+
+} // namespace
+
+TEST(ExtendedFlowKeyTest, MapsIpv4Addresses) {
+    FiveTuple tuple(0x0A000001, 0xC0A80102, 1234, 80, 6);
+    ExtendedFlowKey key = ExtendedFlowKey::from_ipv4(tuple);
+    std::array<uint8_t, 16> expected = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff, 192, 168, 1, 2};
+    ASSERT_EQ(key.dest_ip, expected);
+    ASSERT_TRUE(key.is_plain_ipv4());
+    ASSERT_EQ(key.to_ipv4(), tuple);
+
+    ASSERT_FALSE(ExtendedFlowKey::from_ipv4(tuple, 100).is_plain_ipv4());
+    ASSERT_TRUE(ExtendedFlowKey::from_ipv4(tuple, 0, 5000).is_ipv4());
+    ASSERT_FALSE(ipv6_key(1, 2, 3).is_ipv4());
+}
+
+TEST(AddressInternerTest, HandlesAreStableAndReclaimed) {
+    AddressInterner interner(4);
+    std::array<uint8_t, 16> a{};
+    std::array<uint8_t, 16> b{};
+    b[15] = 1;
+    uint32_t a1 = interner.intern(1, a, 100);
+    uint32_t a2 = interner.intern(2, a, 100); // Same address, other segment
+    uint32_t b1 = interner.intern(1, b, 200);
+    ASSERT_NE(a1, a2);
+    ASSERT_NE(a1, b1);
+    ASSERT_EQ(interner.intern(1, a, 150), a1);
+    ASSERT_EQ(interner.size(), 3u);
+
+    // Entries last used before the cutoff are freed; the others keep their handles.
+    ASSERT_EQ(interner.reclaim(120), 1u); // (2, a), last used at 100
+    ASSERT_EQ(interner.size(), 2u);
+    ASSERT_EQ(interner.intern(1, a, 300), a1);
+    ASSERT_EQ(interner.intern(1, b, 300), b1);
+
+    // Full: new pairs are refused until room is made.
+    std::array<uint8_t, 16> c = b;
+    for (uint8_t i = 2; i < 4; ++i) {
+        c[15] = i;
+        ASSERT_NE(interner.intern(1, c, 300), AddressInterner::NO_HANDLE);
+    }
+    c[15] = 9;
+    ASSERT_EQ(interner.intern(1, c, 300), AddressInterner::NO_HANDLE);
+    interner.clear();
+    ASSERT_NE(interner.intern(1, c, 300), AddressInterner::NO_HANDLE);
+
+    ASSERT_THROW(AddressInterner(0), std::invalid_argument);
+}
+
+TEST(DualStackFlowClassifierTest, PicksTheTableByHeaderType) {
+    core::FlowTable ipv4_table(64);
+    core::FlowTable extended_table(64);
+    DualStackFlowClassifier classifier(ipv4_table, extended_table, 64, 7);
+
+    FiveTuple tuple(0x0A000001, 0x0A000002, 1000, 80, 6);
+    core::FlowContext* plain = classifier.classify(ExtendedFlowKey::from_ipv4(tuple), 1);
+    ASSERT_EQ(plain, ipv4_table.find(tuple));
+    ASSERT_EQ(classifier.classify(tuple, 2), plain);
+
+    // The same IPv4 flow inside a VLAN or a VXLAN segment is another flow.
+    core::FlowContext* tagged = classifier.classify(ExtendedFlowKey::from_ipv4(tuple, 10), 3);
+    core::FlowContext* tunnelled = classifier.classify(ExtendedFlowKey::from_ipv4(tuple, 0, 5000), 3);
+    core::FlowContext* v6 = classifier.classify(ipv6_key(1, 2, 1000), 3);
+    core::FlowContext* v6_tunnelled = classifier.classify(ipv6_key(1, 2, 1000, 5000), 3);
+    ASSERT_NE(tagged, nullptr);
+    ASSERT_NE(tagged, tunnelled);
+    ASSERT_NE(v6, v6_tunnelled);
+    ASSERT_EQ(ipv4_table.size(), 1u);
+    ASSERT_EQ(extended_table.size(), 4u);
+    ASSERT_EQ(v6->policy_id, 7u);
+    ASSERT_EQ(classifier.classify(ipv6_key(1, 2, 1000), 4), v6);
+    ASSERT_EQ(classifier.addresses().size(), 8u); // Two per segment in each of four segments
+
+    ASSERT_THROW(DualStackFlowClassifier(ipv4_table, ipv4_table, 64, 7), std::invalid_argument);
+}
+
+TEST(DualStackFlowClassifierTest, BurstMatchesSingleLookups) {
+    core::FlowTable ipv4_table(256);
+    core::FlowTable extended_table(256);
+    DualStackFlowClassifier classifier(ipv4_table, extended_table, 256, 7);
+
+    std::vector<ExtendedFlowKey> keys;
+    for (uint16_t i = 0; i < 50; ++i) {
+        FiveTuple tuple(0x0A000001, 0x0A000002, static_cast<uint16_t>(i % 20), 80, 17);
+        switch (i % 3) {
+        case 0: keys.push_back(ExtendedFlowKey::from_ipv4(tuple)); break;
+        case 1: keys.push_back(ExtendedFlowKey::from_ipv4(tuple, 42)); break;
+        default: keys.push_back(ipv6_key(static_cast<uint8_t>(i % 5), 9, i)); break;
+        }
+    }
+    std::vector<core::FlowContext*> contexts(keys.size());
+    classifier.classify_burst(keys.data(), keys.size(), 5, contexts.data());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        ASSERT_NE(contexts[i], nullptr);
+        ASSERT_EQ(contexts[i], classifier.classify(keys[i], 6)) << "key " << i;
+    }
+}
+
+TEST(DualStackFlowClassifierTest, AgingReclaimsAddressesOfExpiredFlows) {
+    core::FlowAgingConfig aging;
+    aging.idle_timeout_ns = 1000;
+    aging.slots_per_sweep = 1 << 20; // One sweep is a whole pass
+    core::FlowTable ipv4_table(64, aging);
+    core::FlowTable extended_table(64, aging);
+    DualStackFlowClassifier classifier(ipv4_table, extended_table, 64, 7);
+
+    classifier.classify(ipv6_key(1, 2, 1000), 100);  // Goes idle
+    classifier.classify(ipv6_key(3, 2, 1000), 100);
+    classifier.classify(ipv6_key(3, 2, 1000), 2500); // Stays active, keeps 3 and 2
+    ASSERT_EQ(classifier.addresses().size(), 3u);
+
+    ASSERT_EQ(classifier.age_flows(3000), 1u);
+    ASSERT_EQ(extended_table.size(), 1u);
+    ASSERT_EQ(classifier.addresses().size(), 2u); // Address 1 was only used by the expired flow
+    ASSERT_NE(classifier.classify(ipv6_key(3, 2, 1000), 3100), nullptr);
+    ASSERT_EQ(extended_table.size(), 1u);
+}
+
+} // namespace dataplane
+} // namespace hqts
@@ -0,0 +1,213 @@
+#include "gtest/gtest.h"
+#include "hqts/dataplane/flow_checkpoint.h"
+
+#include <cstdint>
+#include <cstdio>    // For std::remove
+#include <functional> // For std::function
+#include <stdexcept> // For std::runtime_error
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>    // For open
+#include <sys/mman.h> // For mmap
+#include <unistd.h>   // For getpid, access
+
+namespace hqts {
+namespace dataplane {
+
+namespace {
+
+// Unique per test process, so parallel test runs do not share files.
+std::string testCheckpointPath(const char* suffix) {
+    return "/tmp/hqts-test-" + std::to_string(getpid()) + "-" + suffix + ".flows";
+}
+
+core::ShapingPolicy makeCheckpointTestPolicy(policy::PolicyId id) {
+    return core::ShapingPolicy(id, policy::NO_PARENT_POLICY_ID, "policy_" + std::to_string(id),
+                               1000000, 2000000, 1500, 3000,
+                               policy::SchedulingAlgorithm::STRICT_PRIORITY, 100, 0);
+}
+
+} // namespace
+
+TEST(FlowCheckpointTest, RestoresFlowsAndBucketLevels) {
+    const std::string path = testCheckpointPath("restore");
+    const core::TimestampNs t0 = 1000000000;
+    {
+        core::FlowTable table(1024);
+        for (uint32_t i = 1; i <= 100; ++i) {
+            auto result = table.find_or_insert(FiveTuple(i, 2, 3, 4, 6), 10 + i % 3, i, core::DropPolicy::RED, t0 + i);
+            result.first->sla_status = core::SLAStatus::CONFORMING;
+        }
+        table.erase(FiveTuple(50, 2, 3, 4, 6));
+
+        policy::PolicyTree tree;
+        tree.insert(makeCheckpointTestPolicy(10));
+        tree.insert(makeCheckpointTestPolicy(11));
+        policy::CompiledPolicies policies(tree, 1);
+        ASSERT_TRUE(policies.find(10)->cir_bucket.consume(1000, t0));
+
+        core::FlowCheckpointWriter writer(path, table, 16);
+        EXPECT_EQ(writer.save_all_flows(), 99u);
+        EXPECT_EQ(writer.completed_passes(), 1u);
+        EXPECT_EQ(writer.save_all_flows(), 0u); // Nothing changed: nothing rewritten
+        EXPECT_EQ(writer.save_policies(policies, t0), 2u);
+
+        // Incremental: a changed flow is picked up by the pass over its slot.
+        table.find(FiveTuple(7, 2, 3, 4, 6))->policy_id = 12;
+        size_t rewritten = 0;
+        for (size_t step = 0; step < table.slot_count() / 64; ++step) {
+            rewritten += writer.save_flows(64);
+        }
+        EXPECT_EQ(rewritten, 1u);
+        writer.sync();
+    }
+
+    core::FlowTable restored(1024);
+    policy::PolicyTree tree;
+    tree.insert(makeCheckpointTestPolicy(10));
+    tree.insert(makeCheckpointTestPolicy(11));
+    policy::CompiledPolicies policies(tree, 1);
+    core::FlowRestoreResult result = core::restore_flow_checkpoint(path, restored, &policies, t0 + 50);
+    EXPECT_EQ(result.flows_restored, 99u);
+    EXPECT_EQ(result.flows_rejected, 0u);
+    EXPECT_EQ(result.policies_restored, 2u);
+    EXPECT_EQ(restored.size(), 99u);
+
+    EXPECT_EQ(restored.find(FiveTuple(50, 2, 3, 4, 6)), nullptr);
+    const core::FlowContext* flow = restored.find(FiveTuple(7, 2, 3, 4, 6));
+    ASSERT_NE(flow, nullptr);
+    EXPECT_EQ(flow->policy_id, 12u);
+    EXPECT_EQ(flow->queue_id, 7u);
+    EXPECT_EQ(flow->drop_policy, core::DropPolicy::RED);
+    EXPECT_EQ(flow->sla_status, core::SLAStatus::CONFORMING);
+    EXPECT_EQ(restored.last_seen_ns_by_id(flow->flow_id), t0 + 7);
+    // Seen "after" the restore time: clamped, so aging still works.
+    EXPECT_EQ(restored.last_seen_ns_by_id(restored.find(FiveTuple(80, 2, 3, 4, 6))->flow_id), t0 + 50);
+
+    EXPECT_EQ(policies.find(10)->cir_bucket.available_tokens(t0 + 50), 500u);
+    EXPECT_EQ(policies.find(11)->cir_bucket.available_tokens(t0 + 50), 1500u);
+    std::remove(path.c_str());
+}
+
+TEST(FlowCheckpointTest, SkipsTornRecordsAndRejectsOtherFiles) {
+    const std::string path = testCheckpointPath("torn");
+    core::FlowTable table(64);
+    table.find_or_insert(FiveTuple(1, 2, 3, 4, 6), 1, 0, core::DropPolicy::TAIL_DROP, 0);
+    table.find_or_insert(FiveTuple(5, 6, 7, 8, 6), 1, 0, core::DropPolicy::TAIL_DROP, 0);
+    {
+        core::FlowCheckpointWriter writer(path, table, 1);
+        writer.save_all_flows();
+    }
+
+    // Leave one record as a crash mid-write would: odd sequence.
+    int fd = open(path.c_str(), O_RDWR);
+    ASSERT_GE(fd, 0);
+    off_t bytes = lseek(fd, 0, SEEK_END);
+    void* mapping = mmap(nullptr, static_cast<size_t>(bytes), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    ASSERT_NE(mapping, MAP_FAILED);
+    auto* header = static_cast<core::FlowCheckpointHeader*>(mapping);
+    auto* records = reinterpret_cast<core::FlowCheckpointRecord*>(static_cast<unsigned char*>(mapping) +
+                                                                  header->flows_offset);
+    for (uint64_t slot = 0; slot < header->slot_count; ++slot) {
+        if (records[slot].flow.live) {
+            records[slot].sequence.fetch_add(1);
+            break;
+        }
+    }
+    munmap(mapping, static_cast<size_t>(bytes));
+
+    core::FlowTable restored(64);
+    core::FlowRestoreResult result = core::restore_flow_checkpoint(path, restored, nullptr, 0);
+    EXPECT_EQ(result.flows_restored, 1u);
+    EXPECT_EQ(result.flows_rejected, 1u);
+
+    EXPECT_THROW(core::restore_flow_checkpoint(testCheckpointPath("missing"), restored, nullptr, 0),
+                 std::system_error);
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    ASSERT_NE(file, nullptr);
+    const char garbage[256] = "not a checkpoint";
+    std::fwrite(garbage, 1, sizeof(garbage), file);
+    std::fclose(file);
+    EXPECT_THROW(core::restore_flow_checkpoint(path, restored, nullptr, 0), std::runtime_error);
+    std::remove(path.c_str());
+}
+
+TEST(FlowCheckpointTest, ReplacesThePreviousCheckpointOnlyOnceComplete) {
+    const std::string path = testCheckpointPath("replace");
+    const std::string temporary = path + ".tmp";
+    core::FlowTable table(64);
+    table.find_or_insert(FiveTuple(1, 2, 3, 4, 6), 1, 0, core::DropPolicy::TAIL_DROP, 0);
+    {
+        core::FlowCheckpointWriter writer(path, table, 1);
+        writer.save_all_flows();
+    }
+    auto restored_flows = [&path] {
+        core::FlowTable restored(64);
+        return core::restore_flow_checkpoint(path, restored, nullptr, 0).flows_restored;
+    };
+    ASSERT_EQ(restored_flows(), 1u);
+
+    // A writer that dies mid-pass leaves the previous checkpoint intact.
+    table.find_or_insert(FiveTuple(5, 6, 7, 8, 6), 1, 0, core::DropPolicy::TAIL_DROP, 0);
+    {
+        core::FlowCheckpointWriter writer(path, table, 1);
+        writer.save_flows(table.slot_count() / 2);
+        EXPECT_EQ(writer.completed_passes(), 0u);
+        EXPECT_EQ(restored_flows(), 1u);
+        EXPECT_EQ(access(temporary.c_str(), F_OK), 0);
+    }
+    EXPECT_EQ(restored_flows(), 1u);
+    EXPECT_NE(access(temporary.c_str(), F_OK), 0);
+
+    // Completing a pass publishes the new one, which later passes keep updating.
+    core::FlowCheckpointWriter writer(path, table, 1);
+    writer.save_all_flows();
+    EXPECT_EQ(restored_flows(), 2u);
+    EXPECT_NE(access(temporary.c_str(), F_OK), 0);
+    table.find_or_insert(FiveTuple(9, 10, 11, 12, 6), 1, 0, core::DropPolicy::TAIL_DROP, 0);
+    writer.save_all_flows();
+    EXPECT_EQ(restored_flows(), 3u);
+    std::remove(path.c_str());
+}
+
+TEST(FlowCheckpointTest, RejectsHeadersPointingOutsideTheFile) {
+    const std::string path = testCheckpointPath("corrupt");
+    core::FlowTable table(64);
+    table.find_or_insert(FiveTuple(1, 2, 3, 4, 6), 1, 0, core::DropPolicy::TAIL_DROP, 0);
+
+    // Each corruption keeps the magic, so only the layout checks can catch it.
+    const std::vector<std::function<void(core::FlowCheckpointHeader&)>> corruptions = {
+        // slot_count * record size wraps around to a small number
+        [](core::FlowCheckpointHeader& h) { h.slot_count = UINT64_MAX / sizeof(core::FlowCheckpointRecord) + 2; },
+        [](core::FlowCheckpointHeader& h) { h.slot_count += 1; },
+        [](core::FlowCheckpointHeader& h) { h.flows_offset = 0; }, // Records over the header
+        [](core::FlowCheckpointHeader& h) { h.policies_offset = UINT64_MAX - 8; },
+        [](core::FlowCheckpointHeader& h) { h.max_policies = UINT32_MAX; },
+        [](core::FlowCheckpointHeader& h) { h.file_bytes += 64; }, // Truncated file
+    };
+    for (size_t i = 0; i < corruptions.size(); ++i) {
+        {
+            core::FlowCheckpointWriter writer(path, table, 1);
+            writer.save_all_flows();
+        }
+        int fd = open(path.c_str(), O_RDWR);
+        ASSERT_GE(fd, 0);
+        void* mapping = mmap(nullptr, sizeof(core::FlowCheckpointHeader), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        ASSERT_NE(mapping, MAP_FAILED);
+        corruptions[i](*static_cast<core::FlowCheckpointHeader*>(mapping));
+        munmap(mapping, sizeof(core::FlowCheckpointHeader));
+
+        core::FlowTable restored(64);
+        EXPECT_THROW(core::restore_flow_checkpoint(path, restored, nullptr, 0), std::runtime_error)
+            << "corruption " << i;
+        EXPECT_TRUE(restored.empty());
+    }
+    std::remove(path.c_str());
+}
+
+} // namespace dataplane
+} // namespace hqts
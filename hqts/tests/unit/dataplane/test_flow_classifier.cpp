@@ -8,6 +8,7 @@
 #include <vector>
 #include <set>    // For checking uniqueness of FlowIds
 #include <memory> // For std::unique_ptr
+#include <stdexcept>
 
 namespace hqts {
 namespace dataplane {
@@ -21,7 +22,6 @@ protected:
 
     void SetUp() override {
         test_flow_table_.clear();
-        // A new classifier instance for each test ensures next_flow_id_ starts fresh (from 1).
         classifier_ = std::make_unique<FlowClassifier>(test_flow_table_, DEFAULT_POLICY_ID);
     }
 
@@ -39,9 +39,9 @@ TEST_F(FlowClassifierTest, CreateNewFlow) {
 
     core::FlowId fid1 = classifier_->get_or_create_flow(tuple1);
     ASSERT_NE(fid1, 0); // Assuming FlowId 0 is invalid or reserved
-    ASSERT_EQ(test_flow_table_.count(fid1), 1);
+    ASSERT_EQ(test_flow_table_.find_by_id(fid1) != nullptr, true);
 
-    const core::FlowContext& ctx1 = test_flow_table_.at(fid1);
+    const core::FlowContext& ctx1 = *test_flow_table_.find_by_id(fid1);
     ASSERT_EQ(ctx1.flow_id, fid1);
     ASSERT_EQ(ctx1.policy_id, DEFAULT_POLICY_ID);
     // Check default queue_id and drop_policy as set by FlowClassifier's current implementation
@@ -75,9 +75,9 @@ TEST_F(FlowClassifierTest, MultipleDistinctFlows) {
     ASSERT_NE(fid2, fid3);
 
     ASSERT_EQ(test_flow_table_.size(), 3);
-    ASSERT_TRUE(test_flow_table_.count(fid1));
-    ASSERT_TRUE(test_flow_table_.count(fid2));
-    ASSERT_TRUE(test_flow_table_.count(fid3));
+    ASSERT_NE(test_flow_table_.find_by_id(fid1), nullptr);
+    ASSERT_NE(test_flow_table_.find_by_id(fid2), nullptr);
+    ASSERT_NE(test_flow_table_.find_by_id(fid3), nullptr);
 }
 
 TEST_F(FlowClassifierTest, FlowIdUniqueness) {
@@ -158,5 +158,104 @@ TEST_F(FlowClassifierTest, ThreadSafety) {
     ASSERT_EQ(test_flow_table_.size(), expected_unique_flows);
 }
 
+TEST_F(FlowClassifierTest, ConcurrentLookupsAgreeOnFlowIds) {
+    // All threads resolve the same tuples in different orders; every tuple must end up
+    // with exactly one FlowId no matter which thread's creation won the race.
+    const int num_threads = 8;
+    const int num_tuples = 2000;
+    std::vector<std::vector<core::FlowId>> ids(num_threads, std::vector<core::FlowId>(num_tuples));
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&, t]() {
+            for (int k = 0; k < num_tuples; ++k) {
+                int j = (t % 2 == 0) ? k : num_tuples - 1 - k;
+                FiveTuple tuple(10, 20, static_cast<uint16_t>(j), 443, 6);
+                ids[t][j] = classifier_->get_or_create_flow(tuple);
+            }
+        });
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+
+    std::set<core::FlowId> distinct;
+    for (int j = 0; j < num_tuples; ++j) {
+        for (int t = 1; t < num_threads; ++t) {
+            ASSERT_EQ(ids[t][j], ids[0][j]) << "tuple " << j;
+        }
+        distinct.insert(ids[0][j]);
+    }
+    ASSERT_EQ(distinct.size(), static_cast<size_t>(num_tuples));
+    ASSERT_EQ(test_flow_table_.size(), static_cast<size_t>(num_tuples));
+}
+
+TEST_F(FlowClassifierTest, BurstMatchesSingleLookups) {
+    std::vector<FiveTuple> burst;
+    for (int i = 0; i < 64; ++i) {
+        burst.emplace_back(1, 2, static_cast<uint16_t>(i % 40), 80, 17); // Includes repeats
+    }
+    FiveTuple known(1, 2, 5, 80, 17);
+    core::FlowId known_id = classifier_->get_or_create_flow(known);
+
+    std::vector<core::FlowId> out(burst.size());
+    classifier_->get_or_create_flows(burst.data(), burst.size(), out.data());
+
+    for (size_t i = 0; i < burst.size(); ++i) {
+        ASSERT_EQ(out[i], classifier_->get_or_create_flow(burst[i]));
+    }
+    ASSERT_EQ(out[5], known_id);
+    ASSERT_EQ(out[45], known_id);
+    ASSERT_EQ(test_flow_table_.size(), 40);
+}
+
+TEST_F(FlowClassifierTest, ClassifyReturnsTableContext) {
+    FiveTuple tuple(7, 8, 9, 53, 17);
+    core::FlowContext* ctx = classifier_->classify(tuple);
+    ASSERT_NE(ctx, nullptr);
+    ASSERT_EQ(ctx, test_flow_table_.find(tuple));
+    ASSERT_EQ(ctx->flow_id, classifier_->get_or_create_flow(tuple));
+    ASSERT_EQ(ctx->policy_id, DEFAULT_POLICY_ID);
+}
+
+TEST_F(FlowClassifierTest, FullTableIsReported) {
+    core::FlowTable small_table(4);
+    FlowClassifier small_classifier(small_table, DEFAULT_POLICY_ID);
+    for (uint16_t i = 0; i < 4; ++i) {
+        small_classifier.get_or_create_flow(FiveTuple(1, 2, i, 80, 6));
+    }
+    FiveTuple overflow(1, 2, 99, 80, 6);
+    ASSERT_EQ(small_classifier.classify(overflow), nullptr);
+    ASSERT_THROW(small_classifier.get_or_create_flow(overflow), std::runtime_error);
+    // Known flows are still classified.
+    ASSERT_NE(small_classifier.classify(FiveTuple(1, 2, 0, 80, 6)), nullptr);
+}
+
+TEST_F(FlowClassifierTest, NewFlowsArePolicedByTheirRule) {
+    ClassificationRule tenant;
+    tenant.source_ip = 0x0A010000; // 10.1.0.0/16
+    tenant.source_prefix_length = 16;
+    tenant.policy_id = 42;
+    RuleClassifier rules({tenant});
+    FlowClassifier rule_classifier(test_flow_table_, DEFAULT_POLICY_ID, &rules);
+
+    core::FlowContext* matched = rule_classifier.classify(FiveTuple(0x0A010203, 2, 10, 80, 6));
+    core::FlowContext* unmatched = rule_classifier.classify(FiveTuple(0x0A020203, 2, 10, 80, 6));
+    ASSERT_NE(matched, nullptr);
+    ASSERT_NE(unmatched, nullptr);
+    ASSERT_EQ(matched->policy_id, 42u);
+    ASSERT_EQ(unmatched->policy_id, DEFAULT_POLICY_ID);
+
+    // The policy is kept in the flow: a later lookup returns it unchanged.
+    matched->policy_id = 43;
+    ASSERT_EQ(rule_classifier.classify(FiveTuple(0x0A010203, 2, 10, 80, 6))->policy_id, 43u);
+
+    FiveTuple burst[2] = {FiveTuple(0x0A01FFFF, 2, 10, 80, 6), FiveTuple(0x0B000000, 2, 10, 80, 6)};
+    core::FlowContext* contexts[2];
+    rule_classifier.classify_burst(burst, 2, 0, contexts);
+    ASSERT_EQ(contexts[0]->policy_id, 42u);
+    ASSERT_EQ(contexts[1]->policy_id, DEFAULT_POLICY_ID);
+}
+
 } // namespace dataplane
 } // namespace hqts
@@ -0,0 +1,68 @@
+#include "gtest/gtest.h"
+#include "hqts/dataplane/flow_hash.h"
+#include "hqts/dataplane/flow_identifier.h"
+
+#include <array>
+#include <cstring>    // For std::memcmp
+#include <functional> // For std::hash
+#include <set>
+
+namespace hqts {
+namespace dataplane {
+
+TEST(FlowHashTest, FiveTupleIsPacked16ByteKey) {
+    ASSERT_EQ(sizeof(FiveTuple), 16);
+
+    FiveTuple a(0x0A000001, 0x0A000002, 1234, 80, 6);
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&a);
+    ASSERT_EQ(bytes[13], 0);
+    ASSERT_EQ(bytes[14], 0);
+    ASSERT_EQ(bytes[15], 0);
+
+    FiveTuple b = a;
+    ASSERT_EQ(std::memcmp(&a, &b, sizeof(FiveTuple)), 0);
+    ASSERT_TRUE(a == b);
+    b.protocol = 17;
+    ASSERT_FALSE(a == b);
+}
+
+TEST(FlowHashTest, HashIsDeterministicAndMatchesStdHash) {
+    FiveTuple a(1, 2, 3, 4, 6);
+    FiveTuple b(1, 2, 3, 4, 6);
+    ASSERT_EQ(hash_five_tuple(a), hash_five_tuple(b));
+    ASSERT_EQ(std::hash<FiveTuple>{}(a), static_cast<size_t>(hash_five_tuple(a)));
+    ASSERT_NE(hash_five_tuple(a), hash_five_tuple(FiveTuple(1, 2, 3, 4, 17)));
+}
+
+TEST(FlowHashTest, SpreadsKeysFromOneAddressRange) {
+    // 64K flows from a single /24 to one server: only the low address byte and the
+    // source port vary. Both the top bits (shard/tag selection) and the low bits (home
+    // slot) must still be close to uniform.
+    constexpr size_t BUCKETS = 64;
+    std::array<size_t, BUCKETS> high_counts{};
+    std::array<size_t, BUCKETS> low_counts{};
+    std::set<uint64_t> distinct;
+    size_t total = 0;
+    for (uint32_t host = 0; host < 256; ++host) {
+        for (uint32_t port = 0; port < 256; ++port) {
+            uint64_t h = hash_five_tuple(FiveTuple(0xC0A80100 | host, 0x0A000001,
+                                                   static_cast<uint16_t>(1024 + port), 443, 6));
+            ++high_counts[h >> 58];
+            ++low_counts[h & (BUCKETS - 1)];
+            distinct.insert(h);
+            ++total;
+        }
+    }
+    ASSERT_EQ(distinct.size(), total); // No full collisions
+
+    const size_t expected = total / BUCKETS;
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        EXPECT_GT(high_counts[i], expected * 8 / 10) << "high bucket " << i;
+        EXPECT_LT(high_counts[i], expected * 12 / 10) << "high bucket " << i;
+        EXPECT_GT(low_counts[i], expected * 8 / 10) << "low bucket " << i;
+        EXPECT_LT(low_counts[i], expected * 12 / 10) << "low bucket " << i;
+    }
+}
+
+} // namespace dataplane
+} // namespace hqts
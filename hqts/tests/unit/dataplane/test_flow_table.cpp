@@ -2,142 +2,397 @@
 #include "hqts/dataplane/flow_table.h" // Includes hqts/core/flow_context.h
 #include "hqts/core/flow_context.h"    // For direct use of core types like FlowId, PolicyId etc.
 #include "hqts/policy/policy_types.h"  // For policy::PolicyId if needed (though flow_context includes it)
-#include <string>                      // Not strictly needed for FlowId=uint64_t but good for general context
+
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
 
 namespace hqts {
 namespace dataplane {
 
-// Helper to create a FlowContext for tests
-// Uses types from hqts::core
-core::FlowContext createTestFlowContext(core::FlowId id, policy::PolicyId policy_id = 1, core::QueueId queue_id = 0, core::DropPolicy dp = core::DropPolicy::TAIL_DROP) {
-    // The FlowContext constructor defined previously will set initial timestamps etc.
-    return core::FlowContext(id, policy_id, queue_id, dp);
-}
-
 class FlowTableTest : public ::testing::Test {
 protected:
-    core::FlowTable flow_table_; // Instance of std::unordered_map<core::FlowId, core::FlowContext>
+    core::FlowTable flow_table_;
+
+    core::FlowContext* insert(const FiveTuple& key, policy::PolicyId policy_id = 1) {
+        auto result = flow_table_.find_or_insert(key, policy_id, 0, core::DropPolicy::TAIL_DROP, 0);
+        EXPECT_TRUE(result.second);
+        return result.first;
+    }
 };
 
 TEST_F(FlowTableTest, EmptyTable) {
     ASSERT_TRUE(flow_table_.empty());
     ASSERT_EQ(flow_table_.size(), 0);
+    ASSERT_EQ(flow_table_.max_flows(), core::FlowTable::DEFAULT_MAX_FLOWS);
+    ASSERT_GE(flow_table_.slot_count(), flow_table_.max_flows());
+    ASSERT_EQ(flow_table_.find(FiveTuple(1, 2, 3, 4, 6)), nullptr);
+    ASSERT_EQ(flow_table_.find_by_id(0), nullptr);
+    ASSERT_THROW(core::FlowTable(0), std::invalid_argument);
 }
 
 TEST_F(FlowTableTest, AddAndFindFlow) {
-    core::FlowId id1 = 12345;
-    core::FlowContext context1 = createTestFlowContext(id1, 101);
-
-    // Add using operator[]
-    flow_table_[id1] = context1;
+    FiveTuple key(10, 20, 1000, 80, 6);
+    core::FlowContext* inserted = insert(key, 101);
+    ASSERT_NE(inserted, nullptr);
+    ASSERT_NE(inserted->flow_id, 0);
+    ASSERT_EQ(inserted->policy_id, 101);
     ASSERT_EQ(flow_table_.size(), 1);
     ASSERT_FALSE(flow_table_.empty());
 
-    // Find using find()
-    auto it = flow_table_.find(id1);
-    ASSERT_NE(it, flow_table_.end());
-    ASSERT_EQ(it->first, id1); // Key is FlowId
-    ASSERT_EQ(it->second.flow_id, id1); // Check context's own ID
-    ASSERT_EQ(it->second.policy_id, 101);
+    // By key and by id, both resolve to the same in-table context.
+    ASSERT_EQ(flow_table_.find(key), inserted);
+    ASSERT_EQ(flow_table_.find_by_id(inserted->flow_id), inserted);
+    ASSERT_NE(flow_table_.key_by_id(inserted->flow_id), nullptr);
+    ASSERT_EQ(*flow_table_.key_by_id(inserted->flow_id), key);
+
+    // A second find_or_insert finds the existing flow and leaves it untouched.
+    auto again = flow_table_.find_or_insert(key, 202, 5, core::DropPolicy::RED, 0);
+    ASSERT_FALSE(again.second);
+    ASSERT_EQ(again.first, inserted);
+    ASSERT_EQ(again.first->policy_id, 101);
+    ASSERT_EQ(flow_table_.size(), 1);
 
     // Find non-existent flow
-    core::FlowId id_non_existent = 99999;
-    auto it_non_existent = flow_table_.find(id_non_existent);
-    ASSERT_EQ(it_non_existent, flow_table_.end());
+    ASSERT_EQ(flow_table_.find(FiveTuple(10, 20, 1001, 80, 6)), nullptr);
+    ASSERT_EQ(flow_table_.find_by_id(inserted->flow_id + 1), nullptr);
 }
 
-TEST_F(FlowTableTest, AddMultipleFlows) {
-    core::FlowId id1 = 1;
-    core::FlowId id2 = 2;
-    flow_table_[id1] = createTestFlowContext(id1);
-    flow_table_[id2] = createTestFlowContext(id2, 202);
+TEST_F(FlowTableTest, UpdateFlowContextInPlace) {
+    FiveTuple key(1, 2, 3, 4, 17);
+    core::FlowContext* ctx = insert(key, 10);
+    ctx->policy_id = 20;
+    ctx->current_queue_depth_bytes = 1500;
+
+    const core::FlowContext* found = flow_table_.find(key);
+    ASSERT_EQ(found->policy_id, 20);
+    ASSERT_EQ(found->current_queue_depth_bytes, 1500);
+}
+
+TEST_F(FlowTableTest, ColdStatisticsAreSeparateAndReset) {
+    FiveTuple key(1, 2, 3, 4, 17);
+    core::FlowId id = insert(key)->flow_id;
+
+    core::FlowStatistics* stats = flow_table_.statistics_by_id(id);
+    ASSERT_NE(stats, nullptr);
+    ASSERT_EQ(stats->packets_processed, 0);
+    stats->packets_processed = 7;
+    stats->current_rate_bps = 1000;
+    ASSERT_EQ(flow_table_.statistics_by_id(id)->packets_processed, 7);
+
+    // The next flow placed in the slot starts with fresh statistics.
+    ASSERT_TRUE(flow_table_.erase(key));
+    ASSERT_EQ(flow_table_.statistics_by_id(id), nullptr);
+    core::FlowId reinserted = insert(key)->flow_id;
+    ASSERT_EQ(flow_table_.statistics_by_id(reinserted)->packets_processed, 0);
+    ASSERT_EQ(flow_table_.statistics_by_id(reinserted)->current_rate_bps, 0);
+}
 
+TEST_F(FlowTableTest, EraseFlow) {
+    FiveTuple key1(1, 1, 1, 1, 6);
+    FiveTuple key2(2, 2, 2, 2, 6);
+    core::FlowId id1 = insert(key1)->flow_id;
+    core::FlowId id2 = insert(key2)->flow_id;
     ASSERT_EQ(flow_table_.size(), 2);
 
-    auto it1 = flow_table_.find(id1);
-    ASSERT_NE(it1, flow_table_.end());
-    ASSERT_EQ(it1->second.flow_id, id1);
+    ASSERT_TRUE(flow_table_.erase(key1));
+    ASSERT_EQ(flow_table_.size(), 1);
+    ASSERT_EQ(flow_table_.find(key1), nullptr);
+    ASSERT_EQ(flow_table_.find_by_id(id1), nullptr);
+    ASSERT_NE(flow_table_.find(key2), nullptr);
+
+    // Try erasing non-existent flows
+    ASSERT_FALSE(flow_table_.erase(key1));
+    ASSERT_FALSE(flow_table_.erase_by_id(id1));
+    ASSERT_EQ(flow_table_.size(), 1);
 
-    auto it2 = flow_table_.find(id2);
-    ASSERT_NE(it2, flow_table_.end());
-    ASSERT_EQ(it2->second.flow_id, id2);
-    ASSERT_EQ(it2->second.policy_id, 202);
+    ASSERT_TRUE(flow_table_.erase_by_id(id2));
+    ASSERT_TRUE(flow_table_.empty());
 }
 
-TEST_F(FlowTableTest, UpdateFlowContext) {
-    core::FlowId id1 = 100;
-    flow_table_[id1] = createTestFlowContext(id1, 10, 1, core::DropPolicy::TAIL_DROP);
+TEST_F(FlowTableTest, StaleIdsDoNotMatchReusedSlots) {
+    FiveTuple key(9, 9, 9, 9, 6);
+    core::FlowId old_id = insert(key)->flow_id;
+    ASSERT_TRUE(flow_table_.erase(key));
 
-    // Retrieve and modify
-    auto it = flow_table_.find(id1);
-    ASSERT_NE(it, flow_table_.end());
+    core::FlowId new_id = insert(key)->flow_id;
+    ASSERT_NE(new_id, old_id);
+    ASSERT_EQ(flow_table_.find_by_id(old_id), nullptr);
+    ASSERT_NE(flow_table_.find_by_id(new_id), nullptr);
 
-    it->second.policy_id = 20; // Modify policy_id
-    it->second.current_rate_bps = 500000; // Modify some state
-    // No need to re-insert for std::unordered_map if modifying value in place via iterator
+    flow_table_.clear();
+    ASSERT_TRUE(flow_table_.empty());
+    ASSERT_EQ(flow_table_.find(key), nullptr);
+    ASSERT_EQ(flow_table_.find_by_id(new_id), nullptr);
+    ASSERT_NE(insert(key)->flow_id, new_id);
+}
 
-    // Verify update
-    auto it_updated = flow_table_.find(id1);
-    ASSERT_NE(it_updated, flow_table_.end());
-    ASSERT_EQ(it_updated->second.policy_id, 20);
-    ASSERT_EQ(it_updated->second.current_rate_bps, 500000);
+TEST_F(FlowTableTest, ChurnKeepsLookupsCorrect) {
+    // Repeated insert/erase exercises tombstone reuse and reclamation.
+    core::FlowTable table(256);
+    std::vector<FiveTuple> live;
+    for (uint16_t round = 0; round < 50; ++round) {
+        for (uint16_t i = 0; i < 100; ++i) {
+            FiveTuple key(round, 1, i, 80, 6);
+            ASSERT_TRUE(table.find_or_insert(key, 1, 0, core::DropPolicy::TAIL_DROP, 0).second);
+            live.push_back(key);
+        }
+        // Erase every other flow, keep the rest for one more round.
+        std::vector<FiveTuple> survivors;
+        for (size_t i = 0; i < live.size(); ++i) {
+            if (i % 2 == 0) {
+                ASSERT_TRUE(table.erase(live[i]));
+            } else {
+                survivors.push_back(live[i]);
+            }
+        }
+        live.swap(survivors);
+        ASSERT_EQ(table.size(), live.size());
+        for (const FiveTuple& key : live) {
+            ASSERT_NE(table.find(key), nullptr);
+        }
+    }
+}
 
-    // Alternative: replace object
-    core::FlowContext new_context = createTestFlowContext(id1, 30, 2, core::DropPolicy::RED);
-    flow_table_[id1] = new_context; // Replaces existing or inserts if not present
+TEST_F(FlowTableTest, RejectsInsertsBeyondMaxFlows) {
+    core::FlowTable table(100);
+    size_t inserted = 0;
+    for (uint16_t i = 0; i < 200; ++i) {
+        auto result = table.find_or_insert(FiveTuple(1, 2, i, 80, 17), 1, 0, core::DropPolicy::TAIL_DROP, 0);
+        if (result.first != nullptr) {
+            ++inserted;
+        }
+    }
+    ASSERT_EQ(inserted, 100);
+    ASSERT_EQ(table.size(), 100);
 
-    it_updated = flow_table_.find(id1);
-    ASSERT_NE(it_updated, flow_table_.end());
-    ASSERT_EQ(it_updated->second.policy_id, 30);
-    ASSERT_EQ(it_updated->second.queue_id, 2);
-    ASSERT_EQ(it_updated->second.drop_policy, core::DropPolicy::RED);
+    // Existing flows are still found; freeing one admits a new flow.
+    ASSERT_NE(table.find(FiveTuple(1, 2, 0, 80, 17)), nullptr);
+    ASSERT_TRUE(table.erase(FiveTuple(1, 2, 0, 80, 17)));
+    ASSERT_TRUE(table.find_or_insert(FiveTuple(1, 2, 150, 80, 17), 1, 0, core::DropPolicy::TAIL_DROP, 0).second);
 }
 
-TEST_F(FlowTableTest, EraseFlow) {
-    core::FlowId id1 = 1;
-    core::FlowId id2 = 2;
-    flow_table_[id1] = createTestFlowContext(id1);
-    flow_table_[id2] = createTestFlowContext(id2);
-    ASSERT_EQ(flow_table_.size(), 2);
+TEST_F(FlowTableTest, ConcurrentInsertsOfSameKeysAgree) {
+    const int num_threads = 4;
+    const int num_keys = 1000;
+    std::vector<std::vector<core::FlowId>> ids(num_threads, std::vector<core::FlowId>(num_keys));
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&, t]() {
+            for (int k = 0; k < num_keys; ++k) {
+                auto result = flow_table_.find_or_insert(FiveTuple(5, 6, static_cast<uint16_t>(k), 80, 6),
+                                                         1, 0, core::DropPolicy::TAIL_DROP, 0);
+                ids[t][k] = result.first->flow_id;
+            }
+        });
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+    std::set<core::FlowId> distinct(ids[0].begin(), ids[0].end());
+    ASSERT_EQ(distinct.size(), static_cast<size_t>(num_keys));
+    for (int t = 1; t < num_threads; ++t) {
+        ASSERT_EQ(ids[t], ids[0]);
+    }
+    ASSERT_EQ(flow_table_.size(), static_cast<size_t>(num_keys));
+}
 
-    // Erase by key
-    size_t erased_count = flow_table_.erase(id1);
-    ASSERT_EQ(erased_count, 1);
-    ASSERT_EQ(flow_table_.size(), 1);
-    ASSERT_EQ(flow_table_.find(id1), flow_table_.end()); // Verify it's gone
-    ASSERT_NE(flow_table_.find(id2), flow_table_.end()); // Verify other is still there
+TEST_F(FlowTableTest, AgingExpiresIdleFlowsWithinOnePass) {
+    core::FlowAgingConfig aging;
+    aging.idle_timeout_ns = 1000;
+    aging.slots_per_sweep = 64;
+    core::FlowTable table(512, aging);
 
-    // Try erasing non-existent key
-    erased_count = flow_table_.erase(999);
-    ASSERT_EQ(erased_count, 0);
-    ASSERT_EQ(flow_table_.size(), 1);
+    std::vector<core::FlowId> idle_ids;
+    std::vector<FiveTuple> active_keys;
+    for (uint16_t i = 0; i < 200; ++i) {
+        FiveTuple key(1, 2, i, 80, 6);
+        core::FlowContext* ctx = table.find_or_insert(key, 1, 0, core::DropPolicy::TAIL_DROP, 100).first;
+        if (i % 4 == 0) {
+            active_keys.push_back(key);
+        } else {
+            idle_ids.push_back(ctx->flow_id);
+        }
+    }
+    // Active flows see traffic at t=900; idle flows were last seen at t=100.
+    for (const FiveTuple& key : active_keys) {
+        table.find_or_insert(key, 1, 0, core::DropPolicy::TAIL_DROP, 900);
+    }
+    ASSERT_EQ(table.last_seen_ns_by_id(table.find(active_keys[0])->flow_id), 900);
+
+    // Not yet expired at t=1099; every sweep does bounded work.
+    ASSERT_EQ(table.age(1099), 0);
+
+    size_t expired = 0;
+    for (size_t sweep = 0; sweep < table.sweeps_per_pass(); ++sweep) {
+        expired += table.age(1100);
+    }
+    ASSERT_EQ(expired, idle_ids.size());
+    ASSERT_EQ(table.expired_flow_count(), idle_ids.size());
+    ASSERT_EQ(table.size(), active_keys.size());
+    for (core::FlowId id : idle_ids) {
+        ASSERT_EQ(table.find_by_id(id), nullptr);
+    }
+    for (const FiveTuple& key : active_keys) {
+        ASSERT_NE(table.find(key), nullptr);
+    }
 }
 
-TEST_F(FlowTableTest, AddUsingInsert) {
-    core::FlowId id1 = 777;
-    core::FlowContext context1 = createTestFlowContext(id1, 303);
+TEST_F(FlowTableTest, AgingDisabledByDefault) {
+    core::FlowId id = insert(FiveTuple(1, 2, 3, 4, 6))->flow_id;
+    for (size_t sweep = 0; sweep < flow_table_.sweeps_per_pass(); ++sweep) {
+        ASSERT_EQ(flow_table_.age(UINT64_MAX), 0);
+    }
+    ASSERT_NE(flow_table_.find_by_id(id), nullptr);
 
-    // Using insert method
-    // std::unordered_map::insert returns std::pair<iterator, bool>
-    auto result = flow_table_.insert({id1, context1});
-    ASSERT_TRUE(result.second); // bool part of pair is true if insertion took place
-    ASSERT_EQ(flow_table_.size(), 1);
-    ASSERT_NE(result.first, flow_table_.end()); // iterator should be valid
-    ASSERT_EQ(result.first->second.policy_id, 303); // iterator points to inserted element
-
-    // Try inserting duplicate FlowId
-    core::FlowContext context2_dup = createTestFlowContext(id1, 404);
-    auto result_dup = flow_table_.insert({id1, context2_dup});
-    ASSERT_FALSE(result_dup.second); // Insertion should not happen for duplicate key
-    ASSERT_EQ(flow_table_.size(), 1); // Size should remain 1
-    ASSERT_NE(result_dup.first, flow_table_.end()); // iterator should point to existing element
-    ASSERT_EQ(result_dup.first->second.policy_id, 303); // Check that it's the original element
-}
-
-// If FlowId were a complex struct, specific tests for hash/equality functionality
-// in the context of std::unordered_map would be important.
-// For FlowId = uint64_t, these are implicitly handled by the standard library's
-// std::hash<uint64_t> and operator== for uint64_t.
+    core::FlowAgingConfig bad;
+    bad.slots_per_sweep = 0;
+    ASSERT_THROW(core::FlowTable(16, bad), std::invalid_argument);
+}
+
+TEST_F(FlowTableTest, ChurnAtCapacityKeepsTombstonesBounded) {
+    constexpr uint32_t kFlows = 4096;
+    core::FlowTable table(kFlows);
+    auto key_of = [](uint32_t n) {
+        return FiveTuple(0x0A000000u + n, 0x0B000001u, static_cast<uint16_t>(n), 80, 6);
+    };
+    for (uint32_t n = 0; n < kFlows; ++n) {
+        ASSERT_NE(table.find_or_insert(key_of(n), 1, 0, core::DropPolicy::TAIL_DROP, 0).first, nullptr);
+    }
+
+    // Mean number of slots examined by lookups of keys that were never inserted.
+    auto mean_miss_probes = [&table, &key_of] {
+        size_t probes = 0;
+        for (uint32_t n = 0; n < 1000; ++n) {
+            probes += table.probe_length(key_of(0xF0000000u + n));
+        }
+        return static_cast<double>(probes) / 1000.0;
+    };
+    const double fresh_miss_probes = mean_miss_probes();
+
+    // FIFO churn: the oldest flow leaves as a new one arrives, 40 times over the table.
+    uint32_t oldest = 0;
+    for (uint32_t round = 0; round < 40; ++round) {
+        for (uint32_t i = 0; i < kFlows; ++i, ++oldest) {
+            ASSERT_TRUE(table.erase(key_of(oldest)));
+            ASSERT_NE(table.find_or_insert(key_of(oldest + kFlows), 1, 0, core::DropPolicy::TAIL_DROP, 0).first,
+                      nullptr);
+        }
+        // Tombstones are purged, so misses still stop after a few probes (without the
+        // purge they scan whole shards within a few rounds)...
+        ASSERT_LE(mean_miss_probes(), 4 * fresh_miss_probes + 4) << "round " << round;
+        // ...and purging never cut a live flow off from its home slot.
+        for (uint32_t n = oldest; n < oldest + kFlows; ++n) {
+            ASSERT_NE(table.find(key_of(n)), nullptr) << "round " << round << ", flow " << n;
+        }
+    }
+    ASSERT_EQ(table.size(), kFlows);
+}
+
+TEST_F(FlowTableTest, FullTableEvictsLeastRecentlySeenFlows) {
+    core::FlowAgingConfig aging;
+    aging.full_policy = core::FlowTableFullPolicy::EVICT_LRU;
+    core::FlowTable table(1024, aging);
+
+    // Fill the table; flow i is last seen at time i.
+    for (uint16_t i = 0; i < 1024; ++i) {
+        ASSERT_TRUE(table.find_or_insert(FiveTuple(1, 2, i, 80, 6), 1, 0, core::DropPolicy::TAIL_DROP, i).second);
+    }
+    ASSERT_EQ(table.size(), 1024);
+
+    // New flows keep being admitted at the cap, each by evicting an older one.
+    const uint16_t num_new = 256;
+    for (uint16_t i = 1024; i < 1024 + num_new; ++i) {
+        auto result = table.find_or_insert(FiveTuple(1, 2, i, 80, 6), 1, 0, core::DropPolicy::TAIL_DROP, 10000 + i);
+        ASSERT_TRUE(result.second);
+        ASSERT_NE(result.first, nullptr);
+    }
+    ASSERT_EQ(table.size(), 1024);
+    ASSERT_EQ(table.evicted_flow_count(), num_new);
+
+    // Eviction is sampled LRU within a shard, so it is approximate: victims should
+    // overwhelmingly come from the old generation rather than the flows just added.
+    size_t new_survivors = 0;
+    for (uint16_t i = 1024; i < 1024 + num_new; ++i) {
+        if (table.find(FiveTuple(1, 2, i, 80, 6)) != nullptr) {
+            ++new_survivors;
+        }
+    }
+    ASSERT_GE(new_survivors, num_new * 9 / 10);
+}
+
+TEST_F(FlowTableTest, BurstInsertsNeverEvictFlowsOfTheSameBurst) {
+    core::FlowAgingConfig aging;
+    aging.full_policy = core::FlowTableFullPolicy::EVICT_LRU;
+    core::FlowTable table(16, aging);
+    for (uint16_t i = 0; i < 16; ++i) {
+        ASSERT_NE(table.find_or_insert(FiveTuple(1, 2, i, 80, 6), 1, 0, core::DropPolicy::TAIL_DROP, 1).first,
+                  nullptr);
+    }
+
+    // Twice as many new flows as fit: the first ones evict the old flows, the later
+    // ones must not evict them in turn, so they fall back to REJECT (nullptr).
+    std::vector<FiveTuple> keys;
+    for (uint16_t i = 100; i < 132; ++i) {
+        keys.emplace_back(1, 2, i, 80, 6);
+    }
+    std::vector<core::FlowContext*> out(keys.size());
+    table.find_or_insert_burst(keys.data(), keys.size(), 1, 0, core::DropPolicy::TAIL_DROP, 2, out.data());
+
+    size_t admitted = 0;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        if (out[i] != nullptr) {
+            ASSERT_EQ(table.find(keys[i]), out[i]) << "key " << i; // Still the flow it was handed out for
+            ++admitted;
+        }
+    }
+    ASSERT_GT(admitted, 0u);
+    ASSERT_LE(admitted, 16u);
+    ASSERT_EQ(table.evicted_flow_count(), admitted);
+}
+
+TEST_F(FlowTableTest, FlowsSharingATimestampAreStillEvicted) {
+    // A coarse clock (or one timestamp per burst) gives many flows the same last-seen
+    // time; that alone must not stop EVICT_LRU from making room.
+    core::FlowAgingConfig aging;
+    aging.full_policy = core::FlowTableFullPolicy::EVICT_LRU;
+    core::FlowTable table(512, aging); // Every shard holds flows once full
+    for (uint16_t i = 0; i < 2048; ++i) {
+        auto result = table.find_or_insert(FiveTuple(1, 2, i, 80, 6), 1, 0, core::DropPolicy::TAIL_DROP, 7);
+        ASSERT_TRUE(result.second) << "flow " << i;
+        ASSERT_EQ(table.find(FiveTuple(1, 2, i, 80, 6)), result.first);
+    }
+    ASSERT_EQ(table.size(), 512u);
+    ASSERT_EQ(table.evicted_flow_count(), 1536u);
+}
+
+TEST_F(FlowTableTest, BurstLookupsMatchSingleLookups) {
+    std::vector<FiveTuple> keys;
+    for (uint16_t i = 0; i < 40; ++i) {
+        keys.emplace_back(3, 4, static_cast<uint16_t>(i % 30), 443, 6); // Includes repeats
+    }
+
+    std::vector<core::FlowContext*> looked_up(keys.size());
+    flow_table_.lookup_burst(keys.data(), keys.size(), looked_up.data());
+    for (core::FlowContext* ctx : looked_up) {
+        ASSERT_EQ(ctx, nullptr); // Nothing inserted yet
+    }
+
+    std::vector<core::FlowContext*> inserted(keys.size());
+    flow_table_.find_or_insert_burst(keys.data(), keys.size(), 7, 0, core::DropPolicy::TAIL_DROP, 5,
+                                     inserted.data());
+    ASSERT_EQ(flow_table_.size(), 30);
+
+    flow_table_.lookup_burst(keys.data(), keys.size(), looked_up.data());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        ASSERT_NE(inserted[i], nullptr);
+        ASSERT_EQ(inserted[i], flow_table_.find(keys[i]));
+        ASSERT_EQ(looked_up[i], inserted[i]);
+        ASSERT_EQ(inserted[i]->policy_id, 7);
+    }
+    ASSERT_EQ(inserted[0], inserted[30]);
+}
 
 } // namespace dataplane
 } // namespace hqts
@@ -0,0 +1,144 @@
+#include "gtest/gtest.h"
+#include "hqts/dataplane/rule_classifier.h"
+
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+namespace hqts {
+namespace dataplane {
+
+namespace {
+
+constexpr uint32_t ip(uint32_t a, uint32_t b, uint32_t c, uint32_t d) {
+    return (a << 24) | (b << 16) | (c << 8) | d;
+}
+
+ClassificationRule make_rule(uint32_t source_ip, uint8_t source_length, uint32_t dest_ip, uint8_t dest_length,
+                             policy::PolicyId policy_id) {
+    ClassificationRule rule;
+    rule.source_ip = source_ip;
+    rule.source_prefix_length = source_length;
+    rule.dest_ip = dest_ip;
+    rule.dest_prefix_length = dest_length;
+    rule.policy_id = policy_id;
+    return rule;
+}
+
+// First match by a linear scan: the reference the tuple space search must agree with.
+size_t linear_match(const std::vector<ClassificationRule>& rules, const FiveTuple& key) {
+    for (size_t i = 0; i < rules.size(); ++i) {
+        const ClassificationRule& r = rules[i];
+        uint32_t source_mask = r.source_prefix_length == 0 ? 0u : ~0u << (32 - r.source_prefix_length);
+        uint32_t dest_mask = r.dest_prefix_length == 0 ? 0u : ~0u << (32 - r.dest_prefix_length);
+        if ((key.source_ip & source_mask) == (r.source_ip & source_mask) &&
+            (key.dest_ip & dest_mask) == (r.dest_ip & dest_mask) &&
+            key.source_port >= r.source_port_min && key.source_port <= r.source_port_max &&
+            key.dest_port >= r.dest_port_min && key.dest_port <= r.dest_port_max &&
+            (r.any_protocol || key.protocol == r.protocol)) {
+            return i;
+        }
+    }
+    return rules.size();
+}
+
+} // namespace
+
+TEST(RuleClassifierTest, FirstMatchingRuleWins) {
+    std::vector<ClassificationRule> rules;
+    ClassificationRule web = make_rule(0, 0, ip(10, 1, 0, 0), 16, 20);
+    web.dest_port_min = web.dest_port_max = 443;
+    web.protocol = 6;
+    web.any_protocol = false;
+    rules.push_back(web);                                          // 0: TCP/443 to 10.1/16
+    rules.push_back(make_rule(ip(192, 168, 1, 0), 24, 0, 0, 30));  // 1: from 192.168.1/24
+    rules.push_back(make_rule(0, 0, ip(10, 1, 2, 0), 24, 40));     // 2: to 10.1.2/24
+    ClassificationRule high_ports = make_rule(0, 0, 0, 0, 50);
+    high_ports.source_port_min = 1024;
+    rules.push_back(high_ports);                                   // 3: any, source port >= 1024
+    RuleClassifier classifier(rules);
+
+    ASSERT_EQ(classifier.rule_count(), 4u);
+    ASSERT_EQ(classifier.tuple_count(), 4u);
+    ASSERT_EQ(classifier.classify(FiveTuple(ip(192, 168, 1, 7), ip(10, 1, 2, 3), 1000, 443, 6), 1), 20u);
+    ASSERT_EQ(classifier.classify(FiveTuple(ip(192, 168, 1, 7), ip(10, 1, 2, 3), 1000, 443, 17), 1), 30u);
+    ASSERT_EQ(classifier.classify(FiveTuple(ip(172, 16, 0, 1), ip(10, 1, 2, 3), 1000, 80, 6), 1), 40u);
+    ASSERT_EQ(classifier.classify(FiveTuple(ip(172, 16, 0, 1), ip(10, 9, 0, 1), 5000, 80, 6), 1), 50u);
+    // No rule: the default.
+    ASSERT_EQ(classifier.match(FiveTuple(ip(172, 16, 0, 1), ip(10, 9, 0, 1), 80, 80, 6)), 4u);
+    ASSERT_EQ(classifier.classify(FiveTuple(ip(172, 16, 0, 1), ip(10, 9, 0, 1), 80, 80, 6), 1), 1u);
+}
+
+TEST(RuleClassifierTest, RulesSharingAKeyAreCheckedInOrder) {
+    // Same prefixes and protocol, different source port ranges: one bucket, three rules.
+    std::vector<ClassificationRule> rules;
+    for (uint16_t i = 0; i < 3; ++i) {
+        ClassificationRule rule = make_rule(ip(10, 0, 0, 0), 8, 0, 0, 100 + i);
+        rule.source_port_min = static_cast<uint16_t>(i * 100);
+        rule.source_port_max = static_cast<uint16_t>(i * 100 + 199);
+        rules.push_back(rule);
+    }
+    RuleClassifier classifier(rules);
+    ASSERT_EQ(classifier.tuple_count(), 1u);
+    ASSERT_EQ(classifier.match(FiveTuple(ip(10, 2, 3, 4), 0, 150, 80, 6)), 0u);
+    ASSERT_EQ(classifier.match(FiveTuple(ip(10, 2, 3, 4), 0, 250, 80, 6)), 1u);
+    ASSERT_EQ(classifier.match(FiveTuple(ip(10, 2, 3, 4), 0, 399, 80, 6)), 2u);
+    ASSERT_EQ(classifier.match(FiveTuple(ip(10, 2, 3, 4), 0, 400, 80, 6)), 3u);
+    ASSERT_EQ(classifier.match(FiveTuple(ip(11, 2, 3, 4), 0, 150, 80, 6)), 3u);
+}
+
+TEST(RuleClassifierTest, MatchesLinearScanOnRandomRules) {
+    std::mt19937 rng(7);
+    const uint8_t lengths[] = {0, 8, 16, 24, 32};
+    std::vector<ClassificationRule> rules;
+    for (uint32_t i = 0; i < 3000; ++i) {
+        // Addresses from a small pool so that rules overlap and lookups hit.
+        ClassificationRule rule = make_rule(ip(10, rng() % 4, rng() % 4, rng() % 4), lengths[rng() % 5],
+                                            ip(20, rng() % 4, rng() % 4, rng() % 4), lengths[rng() % 5], i + 1);
+        if (rng() % 2 == 0) {
+            rule.protocol = rng() % 2 == 0 ? 6 : 17;
+            rule.any_protocol = false;
+        }
+        switch (rng() % 3) {
+        case 0:
+            rule.dest_port_min = rule.dest_port_max = static_cast<uint16_t>(rng() % 8);
+            break;
+        case 1:
+            rule.dest_port_min = static_cast<uint16_t>(rng() % 4);
+            rule.dest_port_max = static_cast<uint16_t>(rule.dest_port_min + rng() % 4);
+            break;
+        default:
+            break;
+        }
+        if (rng() % 4 == 0) {
+            rule.source_port_min = static_cast<uint16_t>(rng() % 8);
+            rule.source_port_max = static_cast<uint16_t>(rule.source_port_min + rng() % 8);
+        }
+        rules.push_back(rule);
+    }
+    RuleClassifier classifier(rules);
+    ASSERT_LT(classifier.tuple_count(), 150u); // 5 x 5 prefixes x protocol x port shape
+
+    for (int n = 0; n < 20000; ++n) {
+        FiveTuple key(ip(10, rng() % 4, rng() % 4, rng() % 4), ip(20, rng() % 4, rng() % 4, rng() % 4),
+                      static_cast<uint16_t>(rng() % 16), static_cast<uint16_t>(rng() % 8),
+                      static_cast<uint8_t>(rng() % 2 == 0 ? 6 : 17));
+        ASSERT_EQ(classifier.match(key), linear_match(rules, key)) << "lookup " << n;
+    }
+}
+
+TEST(RuleClassifierTest, InvalidRulesAreRejected) {
+    ClassificationRule long_prefix = make_rule(0, 33, 0, 0, 1);
+    ASSERT_THROW(RuleClassifier({long_prefix}), std::invalid_argument);
+    ClassificationRule empty_range = make_rule(0, 0, 0, 0, 1);
+    empty_range.dest_port_min = 100;
+    empty_range.dest_port_max = 99;
+    ASSERT_THROW(RuleClassifier({empty_range}), std::invalid_argument);
+
+    RuleClassifier no_rules({});
+    ASSERT_EQ(no_rules.classify(FiveTuple(1, 2, 3, 4, 6), 9), 9u);
+}
+
+} // namespace dataplane
+} // namespace hqts
@@ -0,0 +1,168 @@
+#include "gtest/gtest.h"
+#include "hqts/monitor/stats_segment.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>     // For std::unique_ptr
+#include <stdexcept>    // For std::invalid_argument, std::runtime_error
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>    // For O_RDWR
+#include <sys/mman.h> // For shm_open, mmap
+#include <unistd.h>   // For getpid, close
+
+namespace hqts {
+namespace monitor {
+
+namespace {
+
+// Unique per test process, so parallel test runs do not share segments.
+std::string testSegmentName(const char* suffix) {
+    return "/hqts-test-" + std::to_string(getpid()) + "-" + suffix;
+}
+
+PolicyStatsRecord makePolicyRecord(uint64_t id, uint64_t packets) {
+    PolicyStatsRecord record{};
+    record.policy_id = id;
+    record.packets_processed = packets;
+    record.bytes_processed = packets * 100;
+    return record;
+}
+
+// Maps `name` read-write behind the writer's back and lets `corrupt` edit its header.
+void corruptHeader(const std::string& name, const std::function<void(StatsSegmentHeader&)>& corrupt) {
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    ASSERT_GE(fd, 0);
+    void* mapping = mmap(nullptr, sizeof(StatsSegmentHeader), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    ASSERT_NE(mapping, MAP_FAILED);
+    corrupt(*static_cast<StatsSegmentHeader*>(mapping));
+    munmap(mapping, sizeof(StatsSegmentHeader));
+}
+
+} // namespace
+
+TEST(StatsSegmentTest, InvalidLayoutAndMissingSegment) {
+    StatsSegmentLayout layout;
+    layout.max_queues = 0;
+    EXPECT_THROW(StatsSegmentWriter(testSegmentName("invalid"), layout), std::invalid_argument);
+    EXPECT_THROW(StatsSegmentReader(testSegmentName("missing")), std::system_error);
+}
+
+TEST(StatsSegmentTest, ReaderSeesLatestUpdate) {
+    StatsSegmentLayout layout;
+    layout.max_policies = 2;
+    StatsSegmentWriter writer(testSegmentName("roundtrip"), layout);
+    StatsSegmentReader reader(writer.name());
+
+    StatsView view;
+    ASSERT_TRUE(reader.read(view));
+    EXPECT_EQ(view.sequence, 0u);
+    EXPECT_TRUE(view.policies.empty());
+
+    std::vector<PolicyStatsRecord> policies = {makePolicyRecord(1, 10), makePolicyRecord(2, 20),
+                                               makePolicyRecord(3, 30)}; // One more than fits
+    std::vector<QueueStatsRecord> queues(1, QueueStatsRecord{});
+    queues[0].queue_id = 7;
+    queues[0].latency_p99_ns = 1234;
+    std::vector<WorkerStatsRecord> workers = {{5, 1, 4, 2}};
+    writer.update(1000, policies, queues, workers);
+
+    ASSERT_TRUE(reader.read(view));
+    EXPECT_EQ(view.sequence, 2u);
+    EXPECT_EQ(view.update_time_ns, 1000u);
+    ASSERT_EQ(view.policies.size(), 2u);
+    EXPECT_EQ(view.policies[1].policy_id, 2u);
+    EXPECT_EQ(view.policies[1].bytes_processed, 2000u);
+    ASSERT_EQ(view.queues.size(), 1u);
+    EXPECT_EQ(view.queues[0].queue_id, 7u);
+    EXPECT_EQ(view.queues[0].latency_p99_ns, 1234u);
+    ASSERT_EQ(view.workers.size(), 1u);
+    EXPECT_EQ(view.workers[0].packets_forwarded, 4u);
+    EXPECT_EQ(writer.updates(), 1u);
+}
+
+TEST(StatsSegmentTest, ConcurrentReadsAreNeverTorn) {
+    StatsSegmentLayout layout;
+    layout.max_policies = 64;
+    StatsSegmentWriter writer(testSegmentName("torn"), layout);
+    StatsSegmentReader reader(writer.name());
+
+    std::atomic<bool> done{false};
+    std::thread writer_thread([&writer, &done] {
+        std::vector<PolicyStatsRecord> policies(64);
+        for (uint64_t round = 1; round <= 20000; ++round) {
+            for (size_t i = 0; i < policies.size(); ++i) {
+                policies[i] = makePolicyRecord(i, round); // Every record of an update carries the round
+            }
+            writer.update(round, policies, {}, {});
+        }
+        done.store(true, std::memory_order_release);
+    });
+
+    StatsView view;
+    uint64_t last_sequence = 0;
+    while (!done.load(std::memory_order_acquire)) {
+        if (!reader.read(view)) {
+            continue;
+        }
+        EXPECT_GE(view.sequence, last_sequence);
+        last_sequence = view.sequence;
+        for (const PolicyStatsRecord& record : view.policies) {
+            ASSERT_EQ(record.packets_processed, view.update_time_ns);
+        }
+    }
+    writer_thread.join();
+    ASSERT_TRUE(reader.read(view));
+    EXPECT_EQ(view.update_time_ns, 20000u);
+}
+
+TEST(StatsSegmentTest, RejectsHeadersPointingOutsideTheSegment) {
+    const std::vector<std::function<void(StatsSegmentHeader&)>> corruptions = {
+        [](StatsSegmentHeader& h) { h.max_policies = UINT32_MAX; },
+        [](StatsSegmentHeader& h) { h.policies_offset = UINT64_MAX - 7; }, // Offset + size wraps
+        [](StatsSegmentHeader& h) { h.queues_offset = h.segment_bytes; },
+        [](StatsSegmentHeader& h) { h.workers_offset = h.segment_bytes - sizeof(WorkerStatsRecord); },
+        [](StatsSegmentHeader& h) { h.workers_offset = 0; }, // Overlaps the header
+        [](StatsSegmentHeader& h) { h.queues_offset += 1; }, // Misaligned
+    };
+    StatsSegmentLayout layout;
+    layout.max_workers = 4;
+    for (size_t i = 0; i < corruptions.size(); ++i) {
+        StatsSegmentWriter writer(testSegmentName("corrupt"), layout);
+        ASSERT_NO_THROW(StatsSegmentReader reader(writer.name()));
+        corruptHeader(writer.name(), corruptions[i]);
+        EXPECT_THROW(StatsSegmentReader reader(writer.name()), std::runtime_error) << "corruption " << i;
+    }
+}
+
+TEST(StatsSegmentTest, WriterReplacesAnExistingSegment) {
+    StatsSegmentLayout layout;
+    auto first = std::make_unique<StatsSegmentWriter>(testSegmentName("replaced"), layout);
+    StatsSegmentReader first_reader(first->name());
+    first->update(1000, {}, {}, {});
+
+    // A second writer must not attach to, truncate or keep writing into the first's segment.
+    StatsSegmentWriter second(first->name(), layout);
+    second.update(5000, {}, {}, {});
+    second.update(6000, {}, {}, {});
+
+    StatsView view;
+    ASSERT_TRUE(first_reader.read(view));
+    EXPECT_EQ(view.sequence, 2u);
+    EXPECT_EQ(view.update_time_ns, 1000u);
+
+    // The first writer going away leaves the second's segment in place.
+    first.reset();
+    StatsSegmentReader second_reader(second.name());
+    ASSERT_TRUE(second_reader.read(view));
+    EXPECT_EQ(view.sequence, 4u);
+    EXPECT_EQ(view.update_time_ns, 6000u);
+}
+
+} // namespace monitor
+} // namespace hqts
@@ -0,0 +1,124 @@
+#include "gtest/gtest.h"
+#include "hqts/policy/policy_snapshot.h"
+#include "hqts/policy/runtime_policy_table.h"
+
+#include <cstdio>    // For std::fopen, std::remove
+#include <stdexcept> // For std::runtime_error
+#include <string>
+#include <system_error>
+
+#include <unistd.h> // For getpid
+
+namespace hqts {
+namespace policy {
+
+namespace {
+
+// Unique per test process, so parallel test runs do not share files.
+std::string testSnapshotPath(const char* suffix) {
+    return "/tmp/hqts-test-" + std::to_string(getpid()) + "-" + suffix + ".policies";
+}
+
+core::ShapingPolicy makeSnapshotTestPolicy(PolicyId id, PolicyId parent_id) {
+    core::ShapingPolicy policy(id, parent_id, "policy_" + std::to_string(id),
+                               1000000 * id, 2000000 * id, 1500, 3000,
+                               SchedulingAlgorithm::DRR, static_cast<uint32_t>(10 * id),
+                               static_cast<Priority>(id % 8), id % 2 == 0, 6, 3, 1,
+                               static_cast<core::QueueId>(id), 20, 30);
+    return policy;
+}
+
+} // namespace
+
+TEST(PolicySnapshotTest, RoundTripsTreeConfiguration) {
+    PolicyTree tree;
+    tree.insert(makeSnapshotTestPolicy(10, NO_PARENT_POLICY_ID));
+    tree.insert(makeSnapshotTestPolicy(3, 10));
+    core::ShapingPolicy shaped = makeSnapshotTestPolicy(7, 10);
+    shaped.shape_to_cir = true;
+    shaped.max_shaping_delay_ns = 123456;
+    shaped.name.clear(); // Empty names are kept as such
+    tree.insert(shaped);
+
+    const std::string path = testSnapshotPath("roundtrip");
+    PolicySnapshot::write(tree, path);
+    PolicySnapshot snapshot(path);
+    ASSERT_EQ(snapshot.size(), 3u);
+    EXPECT_EQ(snapshot[0].id, 3u); // Sorted by id
+    EXPECT_EQ(snapshot.name(0), "policy_3");
+    EXPECT_EQ(snapshot.name(1), "");
+
+    PolicyTree loaded = snapshot.to_tree();
+    ASSERT_EQ(loaded.size(), 3u);
+    for (const core::ShapingPolicy& original : tree) {
+        auto it = loaded.get<by_id>().find(original.id);
+        ASSERT_NE(it, loaded.get<by_id>().end());
+        EXPECT_EQ(it->parent_id, original.parent_id);
+        EXPECT_EQ(it->name, original.name);
+        EXPECT_EQ(it->committed_rate_bps, original.committed_rate_bps);
+        EXPECT_EQ(it->peak_rate_bps, original.peak_rate_bps);
+        EXPECT_EQ(it->excess_burst_bytes, original.excess_burst_bytes);
+        EXPECT_EQ(it->algorithm, original.algorithm);
+        EXPECT_EQ(it->weight, original.weight);
+        EXPECT_EQ(it->priority_level, original.priority_level);
+        EXPECT_EQ(it->drop_on_red, original.drop_on_red);
+        EXPECT_EQ(it->target_priority_yellow, original.target_priority_yellow);
+        EXPECT_EQ(it->target_queue_id_green, original.target_queue_id_green);
+        EXPECT_EQ(it->shape_to_cir, original.shape_to_cir);
+        EXPECT_EQ(it->max_shaping_delay_ns, original.max_shaping_delay_ns);
+        EXPECT_EQ(it->cir_bucket.available_tokens(0), 1500u);
+    }
+    std::remove(path.c_str());
+}
+
+TEST(PolicySnapshotTest, CompilesWithoutATree) {
+    PolicyTree tree;
+    tree.insert(makeSnapshotTestPolicy(1, NO_PARENT_POLICY_ID));
+    tree.insert(makeSnapshotTestPolicy(2, 1));
+    tree.insert(makeSnapshotTestPolicy(3, 2));
+    const std::string path = testSnapshotPath("compile");
+    PolicySnapshot::write(tree, path);
+    PolicySnapshot snapshot(path);
+
+    CompiledPolicies from_tree(tree, 1);
+    CompiledPolicies from_snapshot(snapshot, 1);
+    ASSERT_EQ(from_snapshot.size(), from_tree.size());
+    for (uint32_t i = 0; i < from_tree.size(); ++i) {
+        EXPECT_EQ(from_snapshot[i].id, from_tree[i].id);
+        EXPECT_EQ(from_snapshot[i].parent_index, from_tree[i].parent_index);
+        EXPECT_TRUE(from_snapshot[i].same_buckets(from_tree[i]));
+        EXPECT_EQ(from_snapshot[i].drop_on_red, from_tree[i].drop_on_red);
+        EXPECT_EQ(from_snapshot[i].target_queue_id_green, from_tree[i].target_queue_id_green);
+        EXPECT_EQ(from_snapshot[i].has_peak_rate, from_tree[i].has_peak_rate);
+    }
+
+    RuntimePolicyTable table(snapshot);
+    EXPECT_EQ(table.current()->size(), 3u);
+    uint32_t version = table.publish(snapshot);
+    EXPECT_EQ(table.current()->version(), version);
+    std::remove(path.c_str());
+}
+
+TEST(PolicySnapshotTest, RejectsMissingAndInvalidFiles) {
+    EXPECT_THROW(PolicySnapshot(testSnapshotPath("missing")), std::system_error);
+
+    const std::string path = testSnapshotPath("invalid");
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    ASSERT_NE(file, nullptr);
+    const char garbage[128] = "not a policy snapshot";
+    std::fwrite(garbage, 1, sizeof(garbage), file);
+    std::fclose(file);
+    EXPECT_THROW(PolicySnapshot(path.c_str()), std::runtime_error);
+
+    // A valid snapshot cut short is rejected, not read past its end.
+    PolicyTree tree;
+    tree.insert(makeSnapshotTestPolicy(1, NO_PARENT_POLICY_ID));
+    tree.insert(makeSnapshotTestPolicy(2, 1));
+    PolicySnapshot::write(tree, path);
+    ASSERT_EQ(truncate(path.c_str(), 100), 0);
+    EXPECT_THROW(PolicySnapshot(path.c_str()), std::runtime_error);
+    std::remove(path.c_str());
+}
+
+} // namespace policy
+} // namespace hqts
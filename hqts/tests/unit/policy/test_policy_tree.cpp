@@ -255,5 +255,25 @@ TEST_F(PolicyTreeTest, RootPoliciesHaveNoParent) {
     ASSERT_NE(std::find(root_ids.begin(), root_ids.end(), 3), root_ids.end());
 }
 
+TEST_F(PolicyTreeTest, BulkInsertSortsAndSkipsDuplicates) {
+    addPolicyToTree(createTestPolicy(5, NO_PARENT_POLICY_ID, "existing"));
+
+    std::vector<core::ShapingPolicy> batch;
+    batch.push_back(createTestPolicy(9, 5, "p9"));
+    batch.push_back(createTestPolicy(3, NO_PARENT_POLICY_ID, "p3", 2));
+    batch.push_back(createTestPolicy(5, NO_PARENT_POLICY_ID, "dup_of_existing"));
+    batch.push_back(createTestPolicy(7, 5, "p7_first"));
+    batch.push_back(createTestPolicy(7, 5, "p7_second"));
+    ASSERT_EQ(bulk_insert(tree, std::move(batch)), 3u);
+    ASSERT_EQ(tree.size(), 4u);
+
+    auto& id_idx = tree.get<by_id>();
+    ASSERT_EQ(id_idx.find(5)->name, "existing");
+    ASSERT_EQ(id_idx.find(7)->name, "p7_first"); // As with insert(): the first one stays
+    ASSERT_EQ(tree.get<by_parent_id>().count(5), 2u); // Every index sees the new policies
+    ASSERT_EQ(tree.get<by_priority_level>().count(2), 1u);
+    ASSERT_EQ(tree.get<by_name>().count("p9"), 1u);
+}
+
 } // namespace policy
 } // namespace hqts
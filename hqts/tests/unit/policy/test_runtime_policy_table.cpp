@@ -0,0 +1,201 @@
+#include "gtest/gtest.h"
+#include "hqts/policy/runtime_policy_table.h"
+#include "hqts/core/traffic_shaper.h"
+#include "hqts/dataplane/flow_classifier.h"
+
+#include <stdexcept> // For std::invalid_argument
+#include <string>
+
+namespace hqts {
+namespace policy {
+
+namespace {
+
+core::ShapingPolicy makeRuntimeTestPolicy(PolicyId id, PolicyId parent_id, uint8_t green_priority = 7) {
+    return core::ShapingPolicy(id, parent_id, "policy_" + std::to_string(id),
+                               1000000, 2000000, 1500, 3000, // 1 Mbps / 1500 B, 2 Mbps / 3000 B
+                               SchedulingAlgorithm::STRICT_PRIORITY, 100, 0,
+                               true, green_priority, 4, 1, 10, 11, 12);
+}
+
+} // namespace
+
+static_assert(alignof(RuntimePolicy) == 64 && sizeof(RuntimePolicy) % 64 == 0,
+              "RuntimePolicy records must occupy whole cache lines");
+
+TEST(RuntimePolicyTableTest, CompilesTreeIntoSortedRecordsWithParentIndexes) {
+    PolicyTree tree;
+    tree.insert(makeRuntimeTestPolicy(30, 10));
+    tree.insert(makeRuntimeTestPolicy(10, NO_PARENT_POLICY_ID));
+    tree.insert(makeRuntimeTestPolicy(20, 10));
+    tree.insert(makeRuntimeTestPolicy(40, 999)); // Unknown parent: compiled as a root
+
+    CompiledPolicies compiled(tree, 5);
+    EXPECT_EQ(compiled.version(), 5u);
+    ASSERT_EQ(compiled.size(), 4u);
+    EXPECT_EQ(compiled[0].id, 10u);
+    EXPECT_EQ(compiled[3].id, 40u);
+
+    EXPECT_EQ(compiled.index_of(20), 1u);
+    EXPECT_EQ(compiled.index_of(25), NO_POLICY_INDEX);
+    EXPECT_EQ(compiled.find(25), nullptr);
+    EXPECT_EQ(compiled[compiled.index_of(10)].parent_index, NO_POLICY_INDEX);
+    EXPECT_EQ(compiled[compiled.index_of(20)].parent_index, compiled.index_of(10));
+    EXPECT_EQ(compiled[compiled.index_of(30)].parent_index, compiled.index_of(10));
+    EXPECT_EQ(compiled[compiled.index_of(40)].parent_index, NO_POLICY_INDEX);
+
+    const RuntimePolicy* record = compiled.find(30);
+    ASSERT_NE(record, nullptr);
+    EXPECT_EQ(record->target_priority_green, 7);
+    EXPECT_EQ(record->target_queue_id_red, 12u);
+    EXPECT_TRUE(record->drop_on_red);
+    EXPECT_EQ(record->cir_bucket.available_tokens(0), 1500u); // Starts full, as in the tree
+}
+
+TEST(RuntimePolicyTableTest, RejectsParentCycles) {
+    PolicyTree tree;
+    tree.insert(makeRuntimeTestPolicy(1, 3));
+    tree.insert(makeRuntimeTestPolicy(2, 1));
+    tree.insert(makeRuntimeTestPolicy(3, 2));
+    ASSERT_THROW(CompiledPolicies(tree, 1), std::invalid_argument);
+
+    RuntimePolicyTable table;
+    uint32_t version = table.version();
+    ASSERT_THROW(table.publish(tree), std::invalid_argument);
+    EXPECT_EQ(table.version(), version); // The current snapshot stays in place
+    EXPECT_EQ(table.current()->size(), 0u);
+}
+
+TEST(RuntimePolicyTableTest, PublishSwapsSnapshotWhileReadersKeepTheirs) {
+    PolicyTree tree;
+    tree.insert(makeRuntimeTestPolicy(1, NO_PARENT_POLICY_ID, 7));
+    RuntimePolicyTable table(tree);
+    EXPECT_NE(table.version(), 0u);
+
+    size_t reader = table.register_reader();
+    CompiledPolicies* reader_snapshot = table.refresh(reader, nullptr);
+    ASSERT_NE(reader_snapshot->find(1), nullptr);
+
+    tree.erase(1);
+    tree.insert(makeRuntimeTestPolicy(1, NO_PARENT_POLICY_ID, 5));
+    tree.insert(makeRuntimeTestPolicy(2, NO_PARENT_POLICY_ID));
+    uint32_t new_version = table.publish(tree);
+    EXPECT_EQ(table.version(), new_version);
+    EXPECT_NE(new_version, reader_snapshot->version());
+
+    // The old snapshot is untouched and still usable by its reader.
+    EXPECT_EQ(table.retired_snapshots(), 1u);
+    EXPECT_EQ(reader_snapshot->size(), 1u);
+    EXPECT_EQ(reader_snapshot->find(1)->target_priority_green, 7);
+    EXPECT_EQ(table.reclaim(), 0u);
+
+    // Moving on is the reader's quiescent point: the old snapshot can then be freed.
+    CompiledPolicies* latest = table.refresh(reader, reader_snapshot);
+    EXPECT_EQ(latest->version(), new_version);
+    EXPECT_EQ(latest->size(), 2u);
+    EXPECT_EQ(latest->find(1)->target_priority_green, 5);
+    EXPECT_EQ(table.reclaim(), 1u);
+    EXPECT_EQ(table.retired_snapshots(), 0u);
+    table.unregister_reader(reader);
+}
+
+TEST(RuntimePolicyTableTest, SnapshotsAreFreedOnlyOnceEveryReaderMovedPast) {
+    PolicyTree tree;
+    tree.insert(makeRuntimeTestPolicy(1, NO_PARENT_POLICY_ID));
+    RuntimePolicyTable table(tree);
+    size_t fast = table.register_reader();
+    size_t slow = table.register_reader();
+    CompiledPolicies* fast_snapshot = table.refresh(fast, nullptr);
+    table.refresh(slow, nullptr);
+
+    table.publish(tree);
+    fast_snapshot = table.refresh(fast, fast_snapshot);
+    table.publish(tree);
+    fast_snapshot = table.refresh(fast, fast_snapshot);
+    EXPECT_EQ(table.reclaim(), 0u); // `slow` may still hold the first snapshot
+    EXPECT_EQ(table.retired_snapshots(), 2u);
+
+    table.unregister_reader(slow); // An unregistered reader holds nothing
+    EXPECT_EQ(table.reclaim(), 2u);
+
+    // Without registered readers, a publish frees the snapshot it replaces.
+    table.unregister_reader(fast);
+    table.publish(tree);
+    EXPECT_EQ(table.retired_snapshots(), 0u);
+}
+
+TEST(RuntimePolicyTableTest, UnchangedPoliciesKeepTheirBucketState) {
+    PolicyTree tree;
+    tree.insert(makeRuntimeTestPolicy(1, NO_PARENT_POLICY_ID));
+    tree.insert(makeRuntimeTestPolicy(2, NO_PARENT_POLICY_ID));
+    tree.insert(makeRuntimeTestPolicy(3, NO_PARENT_POLICY_ID));
+    RuntimePolicyTable table(tree);
+    size_t reader = table.register_reader();
+    CompiledPolicies* snapshot = table.refresh(reader, nullptr);
+
+    const core::TimestampNs t0 = 1000000000;
+    for (PolicyId id : {PolicyId{1}, PolicyId{2}, PolicyId{3}}) {
+        RuntimePolicy* record = snapshot->find(id);
+        record->stats_slot = static_cast<uint32_t>(id);
+        ASSERT_TRUE(record->cir_bucket.consume(1000, t0));
+    }
+
+    // Policy 1 only changes its marking, 2 its committed rate; 3 goes away and 4 is new.
+    tree.erase(1);
+    tree.insert(makeRuntimeTestPolicy(1, NO_PARENT_POLICY_ID, 2));
+    tree.erase(2);
+    tree.insert(core::ShapingPolicy(2, NO_PARENT_POLICY_ID, "policy_2", 500000, 2000000, 1500, 3000,
+                                    SchedulingAlgorithm::STRICT_PRIORITY, 100, 0));
+    tree.erase(3);
+    tree.insert(makeRuntimeTestPolicy(4, NO_PARENT_POLICY_ID));
+    table.publish(tree);
+
+    CompiledPolicies* latest = table.refresh(reader, snapshot);
+    EXPECT_EQ(latest->find(1)->target_priority_green, 2);
+    EXPECT_EQ(latest->find(1)->cir_bucket.available_tokens(t0), 500u); // Carried over
+    EXPECT_EQ(latest->find(2)->cir_bucket.available_tokens(t0), 1500u); // Reconfigured: restarts
+    EXPECT_EQ(latest->find(4)->cir_bucket.available_tokens(t0), 1500u);
+    EXPECT_EQ(latest->find(1)->stats_slot, 1u);
+    EXPECT_EQ(latest->find(2)->stats_slot, 2u); // Same policy, same statistics
+    EXPECT_EQ(latest->find(4)->stats_slot, UINT32_MAX);
+    table.unregister_reader(reader);
+}
+
+TEST(RuntimePolicyTableTest, LargeUpdateCarriesEveryUnchangedPolicy) {
+    constexpr PolicyId num_policies = 100000;
+    PolicyTree tree;
+    for (PolicyId id = 1; id <= num_policies; ++id) {
+        tree.insert(makeRuntimeTestPolicy(id, NO_PARENT_POLICY_ID));
+    }
+    CompiledPolicies previous(tree, 1);
+    tree.erase(num_policies);
+    CompiledPolicies next(tree, 2);
+    EXPECT_EQ(next.carry_state_from(previous), num_policies - 1);
+}
+
+TEST(RuntimePolicyTableTest, ShaperPicksUpPublishedSnapshots) {
+    PolicyTree tree;
+    tree.insert(makeRuntimeTestPolicy(1, NO_PARENT_POLICY_ID, 7));
+    RuntimePolicyTable table(tree);
+    core::FlowTable flow_table;
+    dataplane::FlowClassifier classifier(flow_table, 1);
+    core::TrafficShaper shaper(table, classifier, flow_table);
+
+    dataplane::FiveTuple tuple(1, 2, 3, 4, 6);
+    scheduler::PacketDescriptor packet(0, 100, 0);
+    const core::TimestampNs t0 = 1000000000;
+    ASSERT_TRUE(shaper.process_packet(packet, tuple, t0));
+    EXPECT_EQ(packet.priority, 7);
+
+    // Changes to the tree reach the data path only when published.
+    tree.erase(1);
+    tree.insert(makeRuntimeTestPolicy(1, NO_PARENT_POLICY_ID, 3));
+    ASSERT_TRUE(shaper.process_packet(packet, tuple, t0));
+    EXPECT_EQ(packet.priority, 7);
+    table.publish(tree);
+    ASSERT_TRUE(shaper.process_packet(packet, tuple, t0));
+    EXPECT_EQ(packet.priority, 3);
+}
+
+} // namespace policy
+} // namespace hqts
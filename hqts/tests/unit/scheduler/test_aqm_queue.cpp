@@ -2,6 +2,7 @@
 #include "hqts/scheduler/aqm_queue.h"
 #include "hqts/scheduler/packet_descriptor.h" // For PacketDescriptor
 #include "hqts/core/flow_context.h"          // For core::FlowId (used in PacketDescriptor)
+#include "hqts/scheduler/packet_descriptor_pool.h" // For PacketDescriptorPool
 
 #include <vector>
 #include <numeric>   // For std::accumulate
@@ -12,8 +13,8 @@ namespace hqts {
 namespace scheduler {
 
 // Helper to create a PacketDescriptor for AQM tests. Priority field is not used by RedAqmQueue.
-PacketDescriptor createAqmTestPacket(core::FlowId flow_id, uint32_t length, size_t payload_size = 0) {
-    return PacketDescriptor(flow_id, length, 0 /* priority unused */, payload_size);
+PacketDescriptor createAqmTestPacket(core::FlowId flow_id, uint32_t length, core::PacketBufferHandle buffer = core::INVALID_PACKET_BUFFER) {
+    return PacketDescriptor(flow_id, length, 0 /* priority unused */, buffer);
 }
 
 // Default parameters for many tests, can be overridden
@@ -213,7 +214,8 @@ TEST(RedAqmQueueTest, RedDropsAtOrAboveMaxThreshold) {
 TEST(RedAqmQueueTest, RedDropsBetweenMinMaxThreshold) {
     // min=200, max=800 (range 600), max_p=0.1, capacity=1000. weight=1.0 (avg = current)
     RedAqmParameters params(200, 800, 0.1, 1.0, 1000);
-    RedAqmQueue queue(params);
+    // The probes below are 1-byte runts: a descriptor per byte so the pool never limits them.
+    RedAqmQueue queue(params, PacketDescriptorPool::create_for_bytes(params.queue_capacity_bytes, 1));
 
     // Fill queue to current_total_bytes = 500. Avg for next packet decision will be 500.
     for(int i=0; i<5; ++i) queue.enqueue(createAqmTestPacket(i,100)); // current_total_bytes = 500
@@ -243,6 +245,20 @@ TEST(RedAqmQueueTest, RedDropsBetweenMinMaxThreshold) {
     ASSERT_LT(drops, attempts * 0.2); // And not excessively high, very roughly < 2 * escalated prob
 }
 
+TEST(RedAqmQueueTest, PrivatePoolHoldsMinimumSizePackets) {
+    // Thresholds out of reach: only the descriptor pool limits the queue.
+    RedAqmParameters params(900, 950, 0.1, 1.0, 1000);
+    RedAqmQueue queue(params);
+    const size_t descriptors = PacketDescriptorPool::capacity_for_bytes(params.queue_capacity_bytes);
+    ASSERT_EQ(descriptors, 16u); // One per DEFAULT_MIN_PACKET_BYTES, not one per byte
+
+    for (size_t i = 0; i < descriptors; ++i) {
+        ASSERT_TRUE(queue.enqueue(createAqmTestPacket(1, 1)));
+    }
+    ASSERT_FALSE(queue.enqueue(createAqmTestPacket(1, 1))); // Runts exhaust the pool first: tail drop
+    ASSERT_EQ(queue.get_current_byte_size(), descriptors);
+}
+
 TEST(RedAqmQueueTest, GentleRedEffectOfCount) {
     // min=100, max=1100 (range 1000), max_p=0.1, capacity=2000. weight=1.0
     RedAqmParameters params(100, 1100, 0.1, 1.0, 2000);
@@ -291,5 +307,84 @@ TEST(RedAqmQueueTest, GentleRedEffectOfCount) {
 }
 
 
+TEST(RedAqmQueueTest, EwmaWeightIsRoundedToPowerOfTwo) {
+    ASSERT_EQ(RedAqmQueue(RedAqmParameters(200, 800, 0.1, 1.0, 1000)).get_ewma_weight_shift(), 0u);
+    ASSERT_EQ(RedAqmQueue(RedAqmParameters(200, 800, 0.1, 0.5, 1000)).get_ewma_weight_shift(), 1u);
+    ASSERT_EQ(RedAqmQueue(RedAqmParameters(200, 800, 0.1, 0.002, 1000)).get_ewma_weight_shift(), 9u); // 1/512
+    ASSERT_EQ(RedAqmQueue(RedAqmParameters(200, 800, 0.1, 1e-12, 1000)).get_ewma_weight_shift(), 31u); // Clamped
+}
+
+TEST(RedAqmQueueTest, DropRateMatchesGentleRedProbability) {
+    // Queue held at a constant 500 bytes with weight 1: p_b = 0.1 * 300 / 600 = 0.05.
+    // Dropping with p_b / (1 - count * p_b) spaces drops uniformly over 1..1/p_b
+    // packets, so on average one packet in (1/p_b + 1) / 2 = 10.5 is dropped.
+    RedAqmParameters params(200, 800, 0.1, 1.0, 1000);
+    RedAqmQueue queue(params);
+    while (queue.get_current_byte_size() < 500) {
+        queue.enqueue(createAqmTestPacket(1, 100));
+    }
+    const int attempts = 100000;
+    int drops = 0;
+    for (int i = 0; i < attempts; ++i) {
+        // A dequeue after each accepted packet holds the sample seen by the next arrival at 500 bytes.
+        if (queue.enqueue(createAqmTestPacket(2, 100))) {
+            queue.dequeue();
+        } else {
+            ++drops;
+        }
+    }
+    EXPECT_NEAR(static_cast<double>(drops) / attempts, 1.0 / 10.5, 0.01);
+}
+
+TEST(RedAqmQueueTest, SameSeedGivesSameDrops) {
+    RedAqmParameters params(100, 900, 0.2, 1.0, 1000);
+    params.random_seed = 12345;
+    RedAqmQueue first(params);
+    RedAqmQueue second(params);
+    for (int i = 0; i < 500; ++i) {
+        ASSERT_EQ(first.enqueue(createAqmTestPacket(1, 5)), second.enqueue(createAqmTestPacket(1, 5)));
+        if (first.get_current_byte_size() > 600) {
+            first.dequeue();
+            second.dequeue();
+        }
+    }
+}
+
+TEST(RedAqmQueueTest, WredDropsOutOfProfileColorsFirst) {
+    // GREEN is only early-dropped above 600 bytes; YELLOW from 100 and RED always beyond 50.
+    RedAqmParameters params(600, 900, 0.1, 1.0, 1000);
+    params.set_color_profile(ConformanceLevel::YELLOW, 100, 300, 0.5)
+          .set_color_profile(ConformanceLevel::RED, 50, 100, 1.0);
+    ASSERT_THROW(params.set_color_profile(ConformanceLevel::RED, 100, 100, 0.5), std::invalid_argument);
+    ASSERT_THROW(params.set_color_profile(ConformanceLevel::RED, 100, 1001, 0.5), std::invalid_argument);
+    ASSERT_EQ(params.profile_for(ConformanceLevel::GREEN).min_threshold_bytes, 600u);
+
+    RedAqmQueue queue(params, PacketDescriptorPool::create_for_bytes(params.queue_capacity_bytes, 1)); // 1-byte probes
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_TRUE(queue.enqueue(createAqmTestPacket(1, 100))); // Average stays below 600
+    }
+    PacketDescriptor red = createAqmTestPacket(2, 10);
+    red.conformance = ConformanceLevel::RED;
+    ASSERT_FALSE(queue.enqueue(red)); // Average 400 >= RED max threshold: p = 1
+
+    int green_drops = 0;
+    int yellow_drops = 0;
+    for (int i = 0; i < 200; ++i) {
+        PacketDescriptor yellow = createAqmTestPacket(3, 1);
+        yellow.conformance = ConformanceLevel::YELLOW;
+        if (!queue.enqueue(yellow)) {
+            ++yellow_drops;
+        }
+        if (!queue.enqueue(createAqmTestPacket(4, 1))) {
+            ++green_drops;
+        }
+        while (queue.get_current_byte_size() > 400) {
+            queue.dequeue();
+        }
+    }
+    ASSERT_EQ(green_drops, 0);
+    ASSERT_GT(yellow_drops, 50); // p_b = 0.5 at an average of 400 >= YELLOW max threshold
+}
+
 } // namespace scheduler
 } // namespace hqts
@@ -0,0 +1,255 @@
+#include "gtest/gtest.h"
+#include "hqts/scheduler/codel_queue.h"
+#include "hqts/scheduler/any_aqm_queue.h"           // For AqmQueue, AqmParameters
+#include "hqts/scheduler/drr_scheduler.h"
+#include "hqts/scheduler/strict_priority_scheduler.h"
+
+#include <vector>
+#include <stdexcept> // For std::invalid_argument, std::runtime_error
+
+namespace hqts {
+namespace scheduler {
+
+namespace {
+
+constexpr core::TimestampNs MS = 1000000;
+constexpr uint32_t PACKET_BYTES = 100;
+
+PacketDescriptor createCoDelTestPacket(core::FlowId flow_id, uint32_t length = PACKET_BYTES) {
+    return PacketDescriptor(flow_id, length, 0 /* priority unused */);
+}
+
+} // namespace
+
+TEST(CoDelQueueTest, ParameterValidation) {
+    ASSERT_NO_THROW(CoDelParameters(10000));
+    ASSERT_NO_THROW(CoDelParameters(10000, 1 * MS, 20 * MS));
+    ASSERT_THROW(CoDelParameters(0), std::invalid_argument);
+    ASSERT_THROW(CoDelParameters(10000, 0, 100 * MS), std::invalid_argument);
+    ASSERT_THROW(CoDelParameters(10000, 100 * MS, 100 * MS), std::invalid_argument); // target >= interval
+    ASSERT_THROW(CoDelParameters(10000, 5 * MS, 0), std::invalid_argument);
+
+    ASSERT_NO_THROW(FqCoDelParameters(CoDelParameters(10000)));
+    ASSERT_THROW(FqCoDelParameters(CoDelParameters(10000), 0), std::invalid_argument);
+    ASSERT_THROW(FqCoDelParameters(CoDelParameters(10000), 16, 0), std::invalid_argument);
+}
+
+TEST(CoDelQueueTest, TailDropsBeyondCapacity) {
+    CoDelQueue queue(CoDelParameters(3 * PACKET_BYTES));
+    EXPECT_TRUE(queue.enqueue(createCoDelTestPacket(1), 0));
+    EXPECT_TRUE(queue.enqueue(createCoDelTestPacket(1), 0));
+    EXPECT_TRUE(queue.enqueue(createCoDelTestPacket(1), 0));
+    EXPECT_FALSE(queue.enqueue(createCoDelTestPacket(1), 0));
+    EXPECT_EQ(queue.get_current_packet_count(), 3);
+    EXPECT_EQ(queue.get_current_byte_size(), 3 * PACKET_BYTES);
+    EXPECT_EQ(queue.get_dropped_packet_count(), 1);
+
+    EXPECT_EQ(queue.front().enqueue_time_ns, 0);
+    queue.dequeue(1 * MS);
+    EXPECT_EQ(queue.get_current_byte_size(), 2 * PACKET_BYTES);
+    ASSERT_THROW(CoDelQueue(CoDelParameters(PACKET_BYTES)).dequeue(0), std::runtime_error);
+}
+
+TEST(CoDelQueueTest, NoDropsWhileDelayBelowTarget) {
+    CoDelQueue queue(CoDelParameters(1000 * PACKET_BYTES));
+    // Arrivals and departures every 1 ms with 2 packets queued: sojourn stays at 2 ms.
+    ASSERT_TRUE(queue.enqueue(createCoDelTestPacket(1), 0));
+    ASSERT_TRUE(queue.enqueue(createCoDelTestPacket(1), 1 * MS));
+    for (core::TimestampNs t = 2 * MS; t < 1000 * MS; t += MS) {
+        ASSERT_TRUE(queue.enqueue(createCoDelTestPacket(1), t));
+        queue.dequeue(t);
+    }
+    EXPECT_EQ(queue.get_dropped_packet_count(), 0);
+    EXPECT_FALSE(queue.control().is_dropping());
+}
+
+TEST(CoDelQueueTest, StandingQueueIsDroppedAtIncreasingRate) {
+    CoDelParameters params(1000 * PACKET_BYTES); // 5 ms target, 100 ms interval
+    CoDelQueue queue(params);
+    for (int i = 0; i < 400; ++i) {
+        ASSERT_TRUE(queue.enqueue(createCoDelTestPacket(1), 0));
+    }
+
+    // Drain one packet per ms starting at 10 ms: every sojourn time is above target.
+    std::vector<core::TimestampNs> drop_times;
+    uint64_t dropped = 0;
+    for (core::TimestampNs t = 10 * MS; !queue.is_empty(); t += MS) {
+        queue.dequeue(t);
+        if (queue.get_dropped_packet_count() != dropped) {
+            dropped = queue.get_dropped_packet_count();
+            drop_times.push_back(t);
+        }
+    }
+
+    ASSERT_GE(drop_times.size(), 4u);
+    // The first drop waits for the delay to stay above target for a whole interval.
+    EXPECT_EQ(drop_times[0], 10 * MS + params.interval_ns);
+    // Then drops follow interval / sqrt(count): the gaps shrink. 1/sqrt(count) is refined
+    // by one Newton step per drop, so single gaps may deviate while the trend holds.
+    EXPECT_EQ(drop_times[1] - drop_times[0], params.interval_ns);
+    for (size_t i = 2; i < drop_times.size(); ++i) {
+        EXPECT_LT(drop_times[i] - drop_times[i - 1], params.interval_ns) << "drop " << i;
+    }
+    EXPECT_LT(drop_times.back() - drop_times[drop_times.size() - 2], drop_times[3] - drop_times[2]);
+}
+
+TEST(CoDelQueueTest, LeavesDroppingStateWhenDelayFalls) {
+    CoDelQueue queue(CoDelParameters(1000 * PACKET_BYTES));
+    for (int i = 0; i < 200; ++i) {
+        ASSERT_TRUE(queue.enqueue(createCoDelTestPacket(1), 0));
+    }
+    core::TimestampNs t = 10 * MS;
+    while (!queue.control().is_dropping()) {
+        ASSERT_FALSE(queue.is_empty());
+        queue.dequeue(t);
+        t += MS;
+    }
+
+    // Drain the backlog at once, then serve fresh packets right away.
+    while (!queue.is_empty()) {
+        queue.dequeue(t);
+    }
+    ASSERT_TRUE(queue.enqueue(createCoDelTestPacket(1), t));
+    ASSERT_TRUE(queue.enqueue(createCoDelTestPacket(1), t));
+    queue.dequeue(t + 1 * MS);
+    EXPECT_FALSE(queue.control().is_dropping());
+}
+
+TEST(CoDelQueueTest, NeverDropsTheLastPacket) {
+    CoDelQueue queue(CoDelParameters(1000 * PACKET_BYTES));
+    // A lone packet with a huge sojourn time is still delivered, every time.
+    for (core::TimestampNs t = 0; t < 2000 * MS; t += 200 * MS) {
+        ASSERT_TRUE(queue.enqueue(createCoDelTestPacket(7), t));
+        PacketDescriptor packet = queue.dequeue(t + 150 * MS);
+        EXPECT_EQ(packet.flow_id, 7u);
+    }
+    EXPECT_EQ(queue.get_dropped_packet_count(), 0);
+}
+
+TEST(FqCoDelQueueTest, SparseFlowOvertakesBulkFlow) {
+    FqCoDelQueue queue(FqCoDelParameters(CoDelParameters(1000 * PACKET_BYTES), 64, 1000));
+    const core::FlowId bulk = 1;
+    core::FlowId sparse = 2;
+    while (queue.flow_queue_index(sparse) == queue.flow_queue_index(bulk)) {
+        ++sparse;
+    }
+
+    for (int i = 0; i < 50; ++i) {
+        ASSERT_TRUE(queue.enqueue(createCoDelTestPacket(bulk, 500), 0));
+    }
+    for (int i = 0; i < 5; ++i) {
+        EXPECT_EQ(queue.dequeue(1 * MS).flow_id, bulk);
+    }
+
+    // The sparse flow's first packet goes to the new-flow list and is served next.
+    ASSERT_TRUE(queue.enqueue(createCoDelTestPacket(sparse, 100), 1 * MS));
+    EXPECT_EQ(queue.front().flow_id, sparse);
+    EXPECT_EQ(queue.dequeue(1 * MS).flow_id, sparse);
+    EXPECT_EQ(queue.dequeue(1 * MS).flow_id, bulk);
+    EXPECT_EQ(queue.get_current_packet_count(), 44);
+    EXPECT_EQ(queue.get_current_byte_size(), 44 * 500);
+}
+
+TEST(FqCoDelQueueTest, BackloggedFlowsShareByQuantum) {
+    FqCoDelQueue queue(FqCoDelParameters(CoDelParameters(1000 * PACKET_BYTES), 64, 300));
+    const core::FlowId big = 1;
+    core::FlowId small = 2;
+    while (queue.flow_queue_index(small) == queue.flow_queue_index(big)) {
+        ++small;
+    }
+    for (int i = 0; i < 20; ++i) {
+        ASSERT_TRUE(queue.enqueue(createCoDelTestPacket(big, 300), 0));
+        ASSERT_TRUE(queue.enqueue(createCoDelTestPacket(small, 100), 0));
+        ASSERT_TRUE(queue.enqueue(createCoDelTestPacket(small, 100), 0));
+        ASSERT_TRUE(queue.enqueue(createCoDelTestPacket(small, 100), 0));
+    }
+
+    uint32_t big_bytes = 0;
+    uint32_t small_bytes = 0;
+    for (int i = 0; i < 40; ++i) {
+        PacketDescriptor packet = queue.dequeue(1 * MS);
+        (packet.flow_id == big ? big_bytes : small_bytes) += packet.packet_length_bytes;
+    }
+    // Equal quanta: both flows get the same bytes, give or take one packet.
+    EXPECT_NEAR(static_cast<double>(big_bytes), static_cast<double>(small_bytes), 300.0);
+}
+
+TEST(FqCoDelQueueTest, OverflowDropsFromLongestFlow) {
+    FqCoDelQueue queue(FqCoDelParameters(CoDelParameters(10 * PACKET_BYTES), 64));
+    const core::FlowId hog = 1;
+    core::FlowId light = 2;
+    while (queue.flow_queue_index(light) == queue.flow_queue_index(hog)) {
+        ++light;
+    }
+    for (int i = 0; i < 9; ++i) {
+        ASSERT_TRUE(queue.enqueue(createCoDelTestPacket(hog), 0));
+    }
+    ASSERT_TRUE(queue.enqueue(createCoDelTestPacket(light), 0));
+
+    // Full: the arrival is accepted and the hog loses a packet instead.
+    EXPECT_TRUE(queue.enqueue(createCoDelTestPacket(light), 0));
+    EXPECT_EQ(queue.get_dropped_packet_count(), 1);
+    EXPECT_EQ(queue.get_current_byte_size(), 10 * PACKET_BYTES);
+
+    int hog_packets = 0;
+    int light_packets = 0;
+    while (!queue.is_empty()) {
+        (queue.dequeue(1 * MS).flow_id == hog ? hog_packets : light_packets)++;
+    }
+    EXPECT_EQ(hog_packets, 8);
+    EXPECT_EQ(light_packets, 2);
+
+    // A packet larger than the whole queue is refused.
+    EXPECT_FALSE(queue.enqueue(createCoDelTestPacket(hog, 11 * PACKET_BYTES), 0));
+}
+
+TEST(AqmQueueTest, WrapsSelectedQueueType) {
+    AqmQueue red(RedAqmParameters(1000, 2000, 0.1, 0.002, 3000));
+    AqmQueue codel(CoDelParameters(3000));
+    AqmQueue fq_codel(FqCoDelParameters(CoDelParameters(3000), 8));
+    EXPECT_NE(red.get_if<RedAqmQueue>(), nullptr);
+    EXPECT_EQ(red.get_if<CoDelQueue>(), nullptr);
+    EXPECT_NE(codel.get_if<CoDelQueue>(), nullptr);
+    EXPECT_NE(fq_codel.get_if<FqCoDelQueue>(), nullptr);
+
+    EXPECT_EQ(aqm_queue_capacity_bytes(AqmParameters(CoDelParameters(3000))), 3000u);
+    EXPECT_EQ(aqm_queue_capacity_bytes(AqmParameters(FqCoDelParameters(CoDelParameters(4000)))), 4000u);
+
+    for (AqmQueue* queue : {&red, &codel, &fq_codel}) {
+        ASSERT_TRUE(queue->enqueue(createCoDelTestPacket(3)));
+        EXPECT_EQ(queue->get_current_packet_count(), 1);
+        EXPECT_EQ(queue->get_current_byte_size(), PACKET_BYTES);
+        EXPECT_EQ(queue->front().flow_id, 3u);
+        EXPECT_EQ(queue->dequeue().flow_id, 3u);
+        EXPECT_TRUE(queue->is_empty());
+    }
+}
+
+TEST(AqmQueueTest, SchedulersAcceptCoDelQueues) {
+    std::vector<AqmParameters> levels = {RedAqmParameters(1000, 2000, 0.1, 0.002, 3000),
+                                         CoDelParameters(3000)};
+    StrictPriorityScheduler sps(levels);
+    sps.enqueue(PacketDescriptor(1, PACKET_BYTES, 0));
+    sps.enqueue(PacketDescriptor(2, PACKET_BYTES, 1));
+    EXPECT_EQ(sps.get_queue_size(1), 1);
+    EXPECT_EQ(sps.dequeue().flow_id, 2u);
+    EXPECT_EQ(sps.dequeue().flow_id, 1u);
+    EXPECT_TRUE(sps.is_empty());
+
+    std::vector<DrrScheduler::QueueConfig> configs;
+    configs.emplace_back(0, 1500, FqCoDelParameters(CoDelParameters(30000), 16));
+    configs.emplace_back(1, 1500, CoDelParameters(30000));
+    DrrScheduler drr(configs);
+    for (core::FlowId flow = 0; flow < 6; ++flow) {
+        drr.enqueue(PacketDescriptor(flow, PACKET_BYTES, static_cast<uint8_t>(flow % 2)));
+    }
+    int dequeued = 0;
+    while (!drr.is_empty()) {
+        drr.dequeue();
+        ++dequeued;
+    }
+    EXPECT_EQ(dequeued, 6);
+}
+
+} // namespace scheduler
+} // namespace hqts
@@ -102,7 +102,7 @@ TEST(DrrSchedulerTest, EnqueueInvalidQueueId) {
     PacketDescriptor p_invalid_q_id = createDrrTestPacket(2, 100, 2);
 
     ASSERT_NO_THROW(scheduler.enqueue(p_valid));
-    ASSERT_THROW(scheduler.enqueue(p_invalid_q_id), std::out_of_range);
+    EXPECT_EQ(scheduler.enqueue(p_invalid_q_id), EnqueueResult::DROPPED_NO_QUEUE); // Released, not thrown
 }
 
 TEST(DrrSchedulerTest, BasicFairnessEqualSizePackets) {
@@ -173,13 +173,42 @@ TEST(DrrSchedulerTest, DeficitHandlingLargePacket) {
     scheduler.enqueue(createDrrTestPacket(102, 10, 2));
     scheduler.enqueue(createDrrTestPacket(103, 10, 2));
 
+    // Queue 1's turn ends at once (100 < 250) with its deficit carried over; queue 2 then
+    // sends all three packets within its 100-byte quantum; queue 1 sends on its third turn.
     ASSERT_EQ(scheduler.dequeue().flow_id, 101);
     ASSERT_EQ(scheduler.dequeue().flow_id, 102);
-    ASSERT_EQ(scheduler.dequeue().flow_id, 1);
     ASSERT_EQ(scheduler.dequeue().flow_id, 103);
+    ASSERT_EQ(scheduler.dequeue().flow_id, 1);
     ASSERT_TRUE(scheduler.is_empty());
 }
 
+TEST(DrrSchedulerTest, IdleQueuesAreSkippedAndDeficitResetsWhenEmpty) {
+    std::vector<std::pair<core::QueueId, uint32_t>> ids_quanta;
+    for (uint16_t id = 0; id < 256; ++id) { // Every queue a packet's 8-bit priority can address
+        ids_quanta.emplace_back(static_cast<core::QueueId>(id), 300);
+    }
+    DrrScheduler scheduler(createDrrConfigsWithPermissiveAqm(ids_quanta, 10000));
+
+    // Only two of 256 queues are backlogged; they alternate per quantum.
+    for (int i = 0; i < 4; ++i) scheduler.enqueue(createDrrTestPacket(10 + i, 100, 7));
+    for (int i = 0; i < 4; ++i) scheduler.enqueue(createDrrTestPacket(20 + i, 100, 200));
+
+    std::vector<core::FlowId> order;
+    while (!scheduler.is_empty()) {
+        order.push_back(scheduler.dequeue().flow_id);
+    }
+    std::vector<core::FlowId> expected = {10, 11, 12, 20, 21, 22, 13, 23};
+    ASSERT_EQ(order, expected);
+
+    // Queue 7 left the round with 200 bytes of unused deficit; it restarts from zero.
+    scheduler.enqueue(createDrrTestPacket(30, 250, 7));
+    scheduler.enqueue(createDrrTestPacket(31, 250, 7));
+    scheduler.enqueue(createDrrTestPacket(40, 250, 200));
+    ASSERT_EQ(scheduler.dequeue().flow_id, 30);  // 300 - 250 = 50 left
+    ASSERT_EQ(scheduler.dequeue().flow_id, 40);  // Queue 7's turn ended
+    ASSERT_EQ(scheduler.dequeue().flow_id, 31);
+}
+
 // --- New Tests for AQM Behavior with DRR ---
 
 TEST(DrrSchedulerAqmTest, AqmDropInDrrQueue) {
@@ -259,6 +288,27 @@ TEST(DrrSchedulerAqmTest, AqmPhysicalCapacityDropInDrrQueue) {
     ASSERT_EQ(scheduler.get_queue_size(qid_normal_cap), 1);
 }
 
+TEST(DrrSchedulerTest, LatencyHistogramsRecordEveryDequeue) {
+    auto configs = createDrrConfigsWithPermissiveAqm({{1, 1500}, {2, 1500}});
+    DrrScheduler scheduler(configs);
+    ASSERT_EQ(scheduler.get_queue_latency(1).count, 0u); // Not enabled yet
+    ASSERT_THROW(scheduler.get_queue_latency(3), std::out_of_range);
+
+    scheduler.enable_latency_histograms();
+    for (uint32_t i = 0; i < 4; ++i) {
+        scheduler.enqueue(createDrrTestPacket(i, 100, 1));
+    }
+    scheduler.enqueue(createDrrTestPacket(9, 100, 2));
+    while (!scheduler.is_empty()) {
+        PacketDescriptor packet = scheduler.dequeue();
+        EXPECT_NE(packet.enqueue_time_ns, 0u); // Stamped on enqueue
+    }
+
+    LatencySnapshot queue1 = scheduler.get_queue_latency(1);
+    EXPECT_EQ(queue1.count, 4u);
+    EXPECT_LE(queue1.percentile_ns(0.5), queue1.max_ns);
+    EXPECT_EQ(scheduler.get_queue_latency(2).count, 1u);
+}
 
 } // namespace scheduler
 } // namespace hqts
@@ -7,6 +7,7 @@
 #include <stdexcept> // For std::logic_error, std::invalid_argument, std::out_of_range
 #include <map>       // For std::map in tests
 #include <numeric>   // For std::accumulate etc. if needed
+#include <memory>    // For std::make_shared
 
 namespace hqts {
 namespace scheduler {
@@ -36,16 +37,8 @@ ServiceCurve defaultUlSc() { return ServiceCurve(2000000, 0); } // 2 Mbps, 0 del
 
 TEST(HfscSchedulerTest, ConstructorEmptyConfig) {
     std::vector<HfscScheduler::FlowConfig> empty_configs;
-    // Constructor with empty config sets is_configured_ to false
-    HfscScheduler scheduler(empty_configs, 1000000000); // 1 Gbps link
-
-    ASSERT_TRUE(scheduler.is_empty()); // is_empty checks total_packets_ which is 0
-    ASSERT_EQ(scheduler.get_num_configured_flows(), 0);
-
-    // Enqueue/Dequeue on a scheduler constructed with empty config should throw std::logic_error
-    // because its is_configured_ flag will be false.
-    ASSERT_THROW(scheduler.enqueue(createHfscTestPacket(1, 100)), std::logic_error);
-    ASSERT_THROW(scheduler.dequeue(), std::logic_error);
+    // Configuration is validated once, at construction, so enqueue never has to check it.
+    ASSERT_THROW(HfscScheduler scheduler(empty_configs, 1000000000), std::invalid_argument);
 }
 
 TEST(HfscSchedulerTest, ConstructorValidConfig) {
@@ -101,7 +94,8 @@ TEST(HfscSchedulerTest, EnqueueToUnconfiguredFlowId_PlaceholderLogic) {
     HfscScheduler scheduler(configs, 1000000000);
 
     PacketDescriptor p_unconfigured_flow = createHfscTestPacket(2, 100);
-    ASSERT_THROW(scheduler.enqueue(p_unconfigured_flow), std::out_of_range);
+    EXPECT_EQ(scheduler.enqueue(p_unconfigured_flow), EnqueueResult::DROPPED_NO_QUEUE);
+    EXPECT_TRUE(scheduler.is_empty());
 }
 
 TEST(HfscSchedulerTest, MultipleFlowsSimple_PlaceholderLogic) {
@@ -214,7 +208,10 @@ TEST(HfscSchedulerRtTest, VirtualFinishTimeOrderingAndMonotonicity) {
     flow_id_sequence.push_back(scheduler.dequeue().flow_id);
     flow_id_sequence.push_back(scheduler.dequeue().flow_id);
     ASSERT_TRUE(scheduler.is_empty());
-    std::vector<core::FlowId> expected_flow_order = {f2, f1, f1, f3};
+    // Deadlines: f2 5 ms, f1 8 ms, f3 16 ms. Each packet takes 0.8 ms on the 10 Mbps link, and
+    // f1's second packet is not eligible before its 1 Mbps curve reaches 1000 bytes (8 ms), so
+    // f3 goes ahead of it.
+    std::vector<core::FlowId> expected_flow_order = {f2, f1, f3, f1};
     ASSERT_EQ(flow_id_sequence, expected_flow_order);
 }
 
@@ -248,15 +245,13 @@ TEST(HfscSchedulerRtTest, FlowBecomesActiveReEligibility) {
     ASSERT_TRUE(scheduler.is_empty());
 }
 
-TEST(HfscSchedulerRtTest, ErrorOnEmptyEligibleSetWithPackets) {
+TEST(HfscSchedulerRtTest, RejectsLeafWithoutAnyCurve) {
     core::FlowId flowA_id = 1;
     std::vector<HfscScheduler::FlowConfig> configs = {
         {flowA_id, 0, ServiceCurve(0, 0)}
     };
-    HfscScheduler scheduler(configs, 10000000);
-    scheduler.enqueue(createHfscTestPacket(flowA_id, 100));
-    ASSERT_FALSE(scheduler.is_empty());
-    ASSERT_THROW(scheduler.dequeue(), std::logic_error);
+    // Such a leaf could never be served; refusing it up front keeps dequeue branch-free.
+    ASSERT_THROW(HfscScheduler scheduler(configs, 10000000), std::invalid_argument);
 }
 
 
@@ -319,7 +314,10 @@ TEST(HfscSchedulerLsTest, RTFlowExhaustsThenLinkShares) {
     for(int i=0; i < num_rt_packets_A && i < dequeued_packets.size(); ++i) {
         if (dequeued_packets[i].flow_id == flowA_id) initial_A_packets++;
     }
-    ASSERT_GE(initial_A_packets, num_rt_packets_A -1 );
+    // A is RT-eligible at once, so it sends first; link-sharing then splits the rest equally
+    // (RT service counts against A's share), leaving A at least its half of the opening packets.
+    ASSERT_EQ(dequeued_packets[0].flow_id, flowA_id);
+    ASSERT_GE(initial_A_packets, 3);
     ASSERT_EQ(packet_counts[flowA_id], num_rt_packets_A + num_ls_packets_A);
     ASSERT_EQ(packet_counts[flowB_id], num_ls_packets_B);
 }
@@ -471,5 +469,168 @@ TEST(HfscSchedulerUlTest, ULDelayEffect) {
     ASSERT_EQ(p.flow_id, flowA_id);
 }
 
+// --- Tests for hierarchy and scale ---
+
+TEST(HfscSchedulerHierarchyTest, ThreeLevelLinkSharingFollowsCurves) {
+    // root -> A (6M) -> A1 (2M)
+    //                -> A2 (4M) -> A2a (1M), A2b (3M)
+    //      -> B (4M)
+    core::FlowId A = 10, A2 = 20, A1 = 1, A2a = 2, A2b = 3, B = 4;
+    std::vector<HfscScheduler::FlowConfig> configs = {
+        {A, 0, ServiceCurve(), ServiceCurve(6000000, 0)},
+        {A1, A, ServiceCurve(), ServiceCurve(2000000, 0)},
+        {A2, A, ServiceCurve(), ServiceCurve(4000000, 0)},
+        {A2a, A2, ServiceCurve(), ServiceCurve(1000000, 0)},
+        {A2b, A2, ServiceCurve(), ServiceCurve(3000000, 0)},
+        {B, 0, ServiceCurve(), ServiceCurve(4000000, 0)}
+    };
+    HfscScheduler scheduler(configs, 10000000);
+    EXPECT_EQ(scheduler.enqueue(createHfscTestPacket(A2, 500)), EnqueueResult::DROPPED_NO_QUEUE); // Interior class
+
+    const int packets_per_leaf = 2000;
+    for (int i = 0; i < packets_per_leaf; ++i) {
+        for (core::FlowId leaf : {A1, A2a, A2b, B}) {
+            scheduler.enqueue(createHfscTestPacket(leaf, 500));
+        }
+    }
+
+    const int sample = 2000;
+    std::map<core::FlowId, int> counts;
+    for (int i = 0; i < sample; ++i) {
+        counts[scheduler.dequeue().flow_id]++;
+    }
+    // Shares of the link: B 40%, A1 6/10 * 2/6 = 20%, A2a 4/10 * 1/4 = 10%, A2b 30%.
+    EXPECT_NEAR(counts[B], sample * 0.4, sample * 0.01);
+    EXPECT_NEAR(counts[A1], sample * 0.2, sample * 0.01);
+    EXPECT_NEAR(counts[A2a], sample * 0.1, sample * 0.01);
+    EXPECT_NEAR(counts[A2b], sample * 0.3, sample * 0.01);
+}
+
+TEST(HfscSchedulerHierarchyTest, NeverStallsWhileServiceablePacketsAreQueued) {
+    // RT leaves that are not yet eligible, UL-capped link-sharing and an idle-then-busy
+    // hierarchy: dequeue must always find a packet while any is queued.
+    core::FlowId parent = 50, rt_leaf = 1, ul_leaf = 2, ls_leaf = 3;
+    std::vector<HfscScheduler::FlowConfig> configs = {
+        {parent, 0, ServiceCurve(), ServiceCurve(2000000, 0), ServiceCurve(3000000, 0)},
+        {rt_leaf, 0, ServiceCurve(500000, 2000)},
+        {ul_leaf, parent, ServiceCurve(), ServiceCurve(1000000, 0), ServiceCurve(500000, 0)},
+        {ls_leaf, parent, ServiceCurve(), ServiceCurve(1000000, 1000)}
+    };
+    HfscScheduler scheduler(configs, 100000000);
+
+    size_t enqueued = 0;
+    size_t dequeued = 0;
+    for (int round = 0; round < 50; ++round) {
+        for (core::FlowId leaf : {rt_leaf, ul_leaf, ls_leaf}) {
+            if ((round + leaf) % 3 != 0) {
+                scheduler.enqueue(createHfscTestPacket(leaf, 200 + 100 * leaf));
+                ++enqueued;
+            }
+        }
+        for (int i = 0; i < 2 && !scheduler.is_empty(); ++i) {
+            ASSERT_NO_THROW(scheduler.dequeue());
+            ++dequeued;
+        }
+    }
+    while (!scheduler.is_empty()) {
+        ASSERT_NO_THROW(scheduler.dequeue());
+        ++dequeued;
+    }
+    ASSERT_EQ(dequeued, enqueued);
+}
+
+TEST(HfscSchedulerHierarchyTest, ConcaveRealTimeCurveGrantsInitialBurst) {
+    core::FlowId bursty = 1, steady = 2;
+    std::vector<HfscScheduler::FlowConfig> configs = {
+        {bursty, 0, ServiceCurve(1000000, 1000, 8000000)}, // 8 Mbps for 1 ms, then 1 Mbps
+        {steady, 0, ServiceCurve(2000000, 0)}
+    };
+    HfscScheduler scheduler(configs, 10000000);
+    scheduler.enqueue(createHfscTestPacket(bursty, 1000));
+    scheduler.enqueue(createHfscTestPacket(steady, 1000));
+
+    // Deadlines: bursty 1 ms (within the 8 Mbps segment), steady 4 ms. At 1 Mbps alone the
+    // bursty class's deadline would be 8 ms.
+    ASSERT_EQ(scheduler.dequeue().flow_id, bursty);
+    ASSERT_EQ(scheduler.dequeue().flow_id, steady);
+}
+
+TEST(HfscSchedulerHierarchyTest, HundredThousandClasses) {
+    // 1000 interior classes with 100 leaves each.
+    const core::FlowId interior_base = 1000000;
+    const int num_interior = 1000;
+    const int leaves_per_interior = 100;
+    std::vector<HfscScheduler::FlowConfig> configs;
+    configs.reserve(num_interior * (leaves_per_interior + 1));
+    for (int i = 0; i < num_interior; ++i) {
+        configs.emplace_back(interior_base + i, 0, ServiceCurve(), ServiceCurve(1000000, 0));
+    }
+    for (int i = 0; i < num_interior; ++i) {
+        for (int j = 0; j < leaves_per_interior; ++j) {
+            core::FlowId leaf = static_cast<core::FlowId>(i * leaves_per_interior + j + 1);
+            ServiceCurve rt = (j % 10 == 0) ? ServiceCurve(100000, 0) : ServiceCurve();
+            configs.emplace_back(leaf, interior_base + i, rt, ServiceCurve(100000 + j * 1000, 0));
+        }
+    }
+    auto pool = std::make_shared<PacketDescriptorPool>(20000);
+    HfscScheduler scheduler(configs, 10000000000ULL, pool);
+    ASSERT_EQ(scheduler.get_num_configured_flows(), configs.size());
+
+    size_t enqueued = 0;
+    for (core::FlowId leaf = 1; leaf <= num_interior * leaves_per_interior; leaf += 7) {
+        scheduler.enqueue_to_class(leaf, PacketDescriptor(leaf, 1000));
+        ++enqueued;
+    }
+    EXPECT_EQ(scheduler.enqueue_to_class(interior_base, PacketDescriptor(1, 1000)),
+              EnqueueResult::DROPPED_NO_QUEUE); // Interior class
+    EXPECT_EQ(scheduler.enqueue_to_class(interior_base - 1, PacketDescriptor(1, 1000)),
+              EnqueueResult::DROPPED_NO_QUEUE); // Unknown class
+
+    size_t dequeued = 0;
+    while (!scheduler.is_empty()) {
+        scheduler.dequeue();
+        ++dequeued;
+    }
+    ASSERT_EQ(dequeued, enqueued);
+    ASSERT_EQ(pool->available(), pool->capacity());
+}
+
+TEST(HfscSchedulerLatencyTest, SojournIsMeasuredOnTheLinkClock) {
+    // 1250-byte packets: 10 ms apart at the 1 Mbps RT rate, 1 ms to send at 10 Mbps.
+    std::vector<HfscScheduler::FlowConfig> configs = {{1, 0, ServiceCurve(1000000, 0)}};
+    HfscScheduler scheduler(configs, 10000000);
+    scheduler.enable_latency_histograms();
+    for (int i = 0; i < 3; ++i) {
+        scheduler.enqueue(createHfscTestPacket(1, 1250));
+    }
+    while (!scheduler.is_empty()) {
+        scheduler.dequeue();
+    }
+
+    LatencySnapshot latency = scheduler.get_flow_latency(1);
+    ASSERT_EQ(latency.count, 3u);
+    EXPECT_NEAR(static_cast<double>(latency.max_ns), 20000000.0, 100000.0); // Third packet waits 20 ms
+    EXPECT_EQ(scheduler.get_rt_deadline_misses(1), 0u);
+    EXPECT_THROW(scheduler.get_flow_latency(2), std::out_of_range);
+}
+
+TEST(HfscSchedulerLatencyTest, OvercommittedRealTimeCurvesMissDeadlines) {
+    // Two 9 Mbps RT guarantees on a 10 Mbps link cannot both be honoured.
+    std::vector<HfscScheduler::FlowConfig> configs = {
+        {1, 0, ServiceCurve(9000000, 0)},
+        {2, 0, ServiceCurve(9000000, 0)}
+    };
+    HfscScheduler scheduler(configs, 10000000);
+    scheduler.enable_latency_histograms();
+    for (int i = 0; i < 20; ++i) {
+        scheduler.enqueue(createHfscTestPacket(1, 1250));
+        scheduler.enqueue(createHfscTestPacket(2, 1250));
+    }
+    while (!scheduler.is_empty()) {
+        scheduler.dequeue();
+    }
+    EXPECT_GT(scheduler.get_rt_deadline_misses(1) + scheduler.get_rt_deadline_misses(2), 0u);
+}
+
 } // namespace scheduler
 } // namespace hqts
@@ -0,0 +1,51 @@
+#include "gtest/gtest.h"
+#include "hqts/scheduler/latency_histogram.h"
+
+#include <cstdint>
+#include <memory> // For std::make_unique
+
+namespace hqts {
+namespace scheduler {
+
+TEST(LatencyHistogramTest, BucketsCoverValuesContiguously) {
+    for (uint64_t ns = 0; ns < 32; ++ns) {
+        EXPECT_EQ(LatencyHistogram::bucket_of(ns), ns); // Exact at small values
+    }
+    for (size_t bucket = 0; bucket + 1 < LatencyHistogram::NUM_BUCKETS; ++bucket) {
+        uint64_t lower = LatencyHistogram::bucket_lower_bound(bucket);
+        uint64_t upper = LatencyHistogram::bucket_upper_bound(bucket);
+        ASSERT_EQ(LatencyHistogram::bucket_of(lower), bucket);
+        ASSERT_EQ(LatencyHistogram::bucket_of(upper), bucket);
+        ASSERT_EQ(LatencyHistogram::bucket_lower_bound(bucket + 1), upper + 1);
+        ASSERT_LE(upper - lower, lower / 16); // Relative width at most 1/16
+    }
+    EXPECT_EQ(LatencyHistogram::bucket_of(UINT64_MAX), LatencyHistogram::NUM_BUCKETS - 1); // Clamped
+}
+
+TEST(LatencyHistogramTest, SnapshotReportsCountsAndPercentiles) {
+    auto histogram = std::make_unique<LatencyHistogram>();
+    EXPECT_EQ(histogram->snapshot().percentile_ns(0.99), 0u);
+
+    for (uint64_t i = 1; i <= 1000; ++i) {
+        histogram->record(i * 1000); // 1 us .. 1 ms
+    }
+    LatencySnapshot snapshot = histogram->snapshot();
+    EXPECT_EQ(snapshot.count, 1000u);
+    EXPECT_EQ(snapshot.max_ns, 1000000u);
+    EXPECT_EQ(snapshot.mean_ns(), 500500u);
+
+    uint64_t p50 = snapshot.percentile_ns(0.5);
+    EXPECT_GE(p50, 500000u);
+    EXPECT_LE(p50, 500000u + 500000u / 16);
+    uint64_t p99 = snapshot.percentile_ns(0.99);
+    EXPECT_GE(p99, 990000u);
+    EXPECT_LE(p99, 1000000u); // Capped at the maximum
+    EXPECT_EQ(snapshot.percentile_ns(1.0), 1000000u);
+
+    histogram->reset();
+    EXPECT_EQ(histogram->count(), 0u);
+    EXPECT_TRUE(histogram->snapshot().buckets.empty());
+}
+
+} // namespace scheduler
+} // namespace hqts
@@ -0,0 +1,120 @@
+#include "gtest/gtest.h"
+#include "hqts/scheduler/packet_descriptor_pool.h"
+#include "hqts/scheduler/aqm_queue.h"
+#include "hqts/scheduler/strict_priority_scheduler.h"
+
+#include <memory>
+#include <stdexcept>
+#include <utility> // For std::move
+#include <vector>
+
+namespace hqts {
+namespace scheduler {
+
+TEST(PacketDescriptorPoolTest, CapacityForBytes) {
+    ASSERT_EQ(PacketDescriptorPool::capacity_for_bytes(6400), 100);
+    ASSERT_EQ(PacketDescriptorPool::capacity_for_bytes(6401), 101); // Rounds up
+    ASSERT_EQ(PacketDescriptorPool::capacity_for_bytes(0), 1);
+    ASSERT_EQ(PacketDescriptorPool::capacity_for_bytes(1000, 1), 1000);
+    ASSERT_THROW(PacketDescriptorPool::capacity_for_bytes(1000, 0), std::invalid_argument);
+    ASSERT_THROW(PacketDescriptorPool(0), std::invalid_argument);
+}
+
+TEST(PacketDescriptorPoolTest, FifoOrderAndNodeRecycling) {
+    auto pool = std::make_shared<PacketDescriptorPool>(3);
+    PacketFifo fifo(pool);
+    ASSERT_TRUE(fifo.empty());
+
+    ASSERT_TRUE(fifo.push_back(PacketDescriptor(1, 100)));
+    ASSERT_TRUE(fifo.push_back(PacketDescriptor(2, 200)));
+    ASSERT_TRUE(fifo.push_back(PacketDescriptor(3, 300)));
+    ASSERT_EQ(fifo.size(), 3);
+    ASSERT_EQ(pool->available(), 0);
+    ASSERT_FALSE(fifo.push_back(PacketDescriptor(4, 400))); // Pool exhausted
+    ASSERT_EQ(fifo.size(), 3);
+
+    ASSERT_EQ(fifo.front().flow_id, 1);
+    ASSERT_EQ(fifo.pop_front().flow_id, 1);
+    ASSERT_EQ(pool->available(), 1);
+    ASSERT_TRUE(fifo.push_back(PacketDescriptor(4, 400))); // Reuses the freed node
+
+    ASSERT_EQ(fifo.pop_front().flow_id, 2);
+    ASSERT_EQ(fifo.pop_front().flow_id, 3);
+    ASSERT_EQ(fifo.pop_front().flow_id, 4);
+    ASSERT_TRUE(fifo.empty());
+    ASSERT_EQ(pool->available(), 3);
+}
+
+TEST(PacketDescriptorPoolTest, FifosShareOnePool) {
+    auto pool = std::make_shared<PacketDescriptorPool>(4);
+    PacketFifo a(pool);
+    PacketFifo b(pool);
+
+    ASSERT_TRUE(a.push_back(PacketDescriptor(1, 64)));
+    ASSERT_TRUE(b.push_back(PacketDescriptor(2, 64)));
+    ASSERT_TRUE(a.push_back(PacketDescriptor(3, 64)));
+    ASSERT_TRUE(b.push_back(PacketDescriptor(4, 64)));
+    ASSERT_FALSE(a.push_back(PacketDescriptor(5, 64)));
+
+    ASSERT_EQ(a.pop_front().flow_id, 1);
+    ASSERT_EQ(b.pop_front().flow_id, 2);
+    ASSERT_EQ(a.pop_front().flow_id, 3);
+    ASSERT_EQ(b.pop_front().flow_id, 4);
+    ASSERT_EQ(pool->available(), 4);
+}
+
+TEST(PacketDescriptorPoolTest, DestroyAndMoveReturnNodes) {
+    auto pool = std::make_shared<PacketDescriptorPool>(4);
+    {
+        PacketFifo fifo(pool);
+        ASSERT_TRUE(fifo.push_back(PacketDescriptor(1, 64)));
+        ASSERT_TRUE(fifo.push_back(PacketDescriptor(2, 64)));
+        ASSERT_EQ(pool->available(), 2);
+
+        PacketFifo moved(std::move(fifo));
+        ASSERT_TRUE(fifo.empty());
+        ASSERT_EQ(moved.size(), 2);
+        ASSERT_EQ(moved.front().flow_id, 1);
+
+        PacketFifo other(pool);
+        ASSERT_TRUE(other.push_back(PacketDescriptor(3, 64)));
+        other = std::move(moved); // Node held by `other` goes back to the pool first
+        ASSERT_EQ(pool->available(), 2);
+        ASSERT_EQ(other.pop_front().flow_id, 1);
+    }
+    ASSERT_EQ(pool->available(), 4);
+}
+
+TEST(PacketDescriptorPoolTest, SharedPoolExhaustionTailDropsInAqmQueue) {
+    RedAqmParameters params(100000, 200000, 0.1, 0.002, 250000);
+    auto pool = std::make_shared<PacketDescriptorPool>(2);
+    RedAqmQueue q1(params, pool);
+    RedAqmQueue q2(params, pool);
+
+    ASSERT_TRUE(q1.enqueue(PacketDescriptor(1, 100)));
+    ASSERT_TRUE(q2.enqueue(PacketDescriptor(2, 100)));
+    ASSERT_FALSE(q1.enqueue(PacketDescriptor(3, 100))); // Byte room left, but no descriptor
+    ASSERT_EQ(q1.get_current_packet_count(), 1);
+    ASSERT_EQ(q1.get_current_byte_size(), 100);
+
+    q2.dequeue();
+    ASSERT_TRUE(q1.enqueue(PacketDescriptor(3, 100)));
+    ASSERT_EQ(q1.get_current_packet_count(), 2);
+}
+
+TEST(PacketDescriptorPoolTest, SchedulerSizesPoolFromAggregateCapacity) {
+    // Two levels of 640 bytes: 1280 / 64 = 20 descriptors shared by both levels.
+    std::vector<RedAqmParameters> levels(2, RedAqmParameters(320, 640, 0.1, 0.002, 640));
+    StrictPriorityScheduler scheduler(levels);
+
+    size_t accepted = 0;
+    for (int i = 0; i < 40; ++i) {
+        // 1-byte packets: byte limits never bind, the descriptor budget does.
+        scheduler.enqueue(PacketDescriptor(static_cast<core::FlowId>(i), 1, static_cast<uint8_t>(i % 2)));
+    }
+    accepted = scheduler.get_queue_size(0) + scheduler.get_queue_size(1);
+    ASSERT_EQ(accepted, 20);
+}
+
+} // namespace scheduler
+} // namespace hqts
@@ -0,0 +1,41 @@
+#include "gtest/gtest.h"
+#include "hqts/scheduler/priority_bitmap.h"
+
+#include <stdexcept>
+
+namespace hqts {
+namespace scheduler {
+
+TEST(PriorityBitmapTest, HighestSetBit) {
+    ASSERT_EQ(highest_set_bit(1), 0u);
+    ASSERT_EQ(highest_set_bit(0x90), 7u);
+    ASSERT_EQ(highest_set_bit(~uint64_t{0}), 63u);
+}
+
+TEST(PriorityBitmapTest, SetClearAndHighestAcrossWords) {
+    ASSERT_THROW(PriorityBitmap(0), std::invalid_argument);
+    ASSERT_THROW(PriorityBitmap(PriorityBitmap::MAX_LEVELS + 1), std::invalid_argument);
+
+    PriorityBitmap bitmap(PriorityBitmap::MAX_LEVELS);
+    ASSERT_FALSE(bitmap.any());
+    ASSERT_EQ(bitmap.highest(), PriorityBitmap::NO_LEVEL);
+
+    bitmap.set(0);
+    bitmap.set(63);
+    bitmap.set(64);
+    bitmap.set(4095);
+    ASSERT_EQ(bitmap.highest(), 4095);
+    bitmap.clear(4095);
+    ASSERT_EQ(bitmap.highest(), 64);
+    bitmap.clear(64);
+    ASSERT_EQ(bitmap.highest(), 63); // Summary bit of word 1 cleared with its last level
+    bitmap.clear(63);
+    bitmap.clear(63); // Idempotent
+    ASSERT_EQ(bitmap.highest(), 0);
+    ASSERT_TRUE(bitmap.test(0));
+    bitmap.clear(0);
+    ASSERT_FALSE(bitmap.any());
+}
+
+} // namespace scheduler
+} // namespace hqts
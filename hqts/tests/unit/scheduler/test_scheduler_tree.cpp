@@ -0,0 +1,229 @@
+#include "gtest/gtest.h"
+#include "hqts/scheduler/scheduler_tree.h"
+#include "hqts/scheduler/aqm_queue.h" // For RedAqmParameters
+#include "hqts/policy/policy_tree.h"
+
+#include <map>
+#include <optional>
+#include <stdexcept> // For std::invalid_argument, std::out_of_range
+#include <string>
+#include <vector>
+
+namespace hqts {
+namespace scheduler {
+
+namespace {
+
+using policy::SchedulingAlgorithm;
+
+// Large enough that no test packet is dropped by the AQM.
+RedAqmParameters permissiveTreeLeafParams() {
+    return RedAqmParameters(800000, 900000, 0.001, 0.002, 1000000);
+}
+
+void addTreePolicy(policy::PolicyTree& tree, policy::PolicyId id, policy::PolicyId parent,
+                   SchedulingAlgorithm algorithm, uint32_t weight, policy::Priority priority_level = 0,
+                   uint64_t rate_bps = 1000000) {
+    tree.insert(core::ShapingPolicy(id, parent, "node_" + std::to_string(id), rate_bps, 0, 10000, 0,
+                                    algorithm, weight, priority_level));
+}
+
+PacketDescriptor treeTestPacket(policy::PolicyId leaf, uint32_t length, core::FlowId flow_id = 0) {
+    PacketDescriptor packet(flow_id, length);
+    packet.policy_id = leaf;
+    return packet;
+}
+
+// Dequeues `count` packets and sums the bytes sent per leaf policy.
+std::map<policy::PolicyId, uint64_t> bytesPerLeaf(SchedulerTree& tree, int count) {
+    std::map<policy::PolicyId, uint64_t> bytes;
+    for (int i = 0; i < count; ++i) {
+        std::optional<PacketDescriptor> packet = tree.try_dequeue();
+        if (!packet) {
+            break;
+        }
+        bytes[packet->policy_id] += packet->packet_length_bytes;
+    }
+    return bytes;
+}
+
+} // namespace
+
+TEST(SchedulerTreeTest, RejectsInvalidTrees) {
+    policy::PolicyTree empty;
+    EXPECT_THROW(SchedulerTree(empty, permissiveTreeLeafParams()), std::invalid_argument);
+
+    policy::PolicyTree orphan;
+    addTreePolicy(orphan, 2, 1, SchedulingAlgorithm::DRR, 100); // Parent 1 missing
+    EXPECT_THROW(SchedulerTree(orphan, permissiveTreeLeafParams()), std::invalid_argument);
+
+    policy::PolicyTree cycle;
+    addTreePolicy(cycle, 1, 0, SchedulingAlgorithm::DRR, 100);
+    addTreePolicy(cycle, 2, 3, SchedulingAlgorithm::DRR, 100);
+    addTreePolicy(cycle, 3, 2, SchedulingAlgorithm::DRR, 100);
+    EXPECT_THROW(SchedulerTree(cycle, permissiveTreeLeafParams()), std::invalid_argument);
+
+    policy::PolicyTree zero_weight;
+    addTreePolicy(zero_weight, 1, 0, SchedulingAlgorithm::DRR, 100);
+    addTreePolicy(zero_weight, 2, 1, SchedulingAlgorithm::DRR, 0); // Weight 0 under a DRR parent
+    EXPECT_THROW(SchedulerTree(zero_weight, permissiveTreeLeafParams()), std::invalid_argument);
+
+    policy::PolicyTree zero_rate;
+    addTreePolicy(zero_rate, 1, 0, SchedulingAlgorithm::HFSC, 100);
+    addTreePolicy(zero_rate, 2, 1, SchedulingAlgorithm::DRR, 100, 0, 0); // Rate 0 under HFSC
+    EXPECT_THROW(SchedulerTree(zero_rate, permissiveTreeLeafParams()), std::invalid_argument);
+
+    policy::PolicyTree valid;
+    addTreePolicy(valid, 1, 0, SchedulingAlgorithm::DRR, 100);
+    EXPECT_THROW(SchedulerTree(valid, permissiveTreeLeafParams(), SchedulingAlgorithm::DRR, 0),
+                 std::invalid_argument);
+    SchedulerTree tree(valid, permissiveTreeLeafParams());
+    EXPECT_EQ(tree.get_num_nodes(), 1u);
+    EXPECT_TRUE(tree.is_leaf(1));
+}
+
+TEST(SchedulerTreeTest, QueuesOnlyAtLeavesAndTracksBacklogPerSubtree) {
+    policy::PolicyTree policies;
+    addTreePolicy(policies, 1, 0, SchedulingAlgorithm::DRR, 100);  // Tenant
+    addTreePolicy(policies, 11, 1, SchedulingAlgorithm::DRR, 100); // Its classes
+    addTreePolicy(policies, 12, 1, SchedulingAlgorithm::DRR, 100);
+    addTreePolicy(policies, 2, 0, SchedulingAlgorithm::DRR, 100);  // Leaf tenant
+    SchedulerTree tree(policies, permissiveTreeLeafParams());
+
+    EXPECT_TRUE(tree.is_empty());
+    EXPECT_FALSE(tree.try_dequeue().has_value());
+    EXPECT_FALSE(tree.is_leaf(1));
+    EXPECT_EQ(tree.enqueue(treeTestPacket(1, 100)), EnqueueResult::DROPPED_NO_QUEUE);  // Interior
+    EXPECT_EQ(tree.enqueue(treeTestPacket(99, 100)), EnqueueResult::DROPPED_NO_QUEUE); // Unknown
+    EXPECT_TRUE(tree.is_empty());
+
+    ASSERT_EQ(tree.enqueue(treeTestPacket(11, 100)), EnqueueResult::ENQUEUED);
+    ASSERT_EQ(tree.enqueue(treeTestPacket(11, 100)), EnqueueResult::ENQUEUED);
+    ASSERT_EQ(tree.enqueue(treeTestPacket(2, 100)), EnqueueResult::ENQUEUED);
+    EXPECT_EQ(tree.get_backlog(1), 2u);
+    EXPECT_EQ(tree.get_backlog(11), 2u);
+    EXPECT_EQ(tree.get_backlog(12), 0u);
+    EXPECT_EQ(tree.get_backlog(2), 1u);
+    EXPECT_THROW(tree.get_backlog(99), std::out_of_range);
+
+    std::vector<PacketDescriptor> out;
+    EXPECT_EQ(tree.dequeue_burst(out, 8), 3u);
+    EXPECT_TRUE(tree.is_empty());
+    EXPECT_EQ(tree.get_backlog(1), 0u);
+}
+
+TEST(SchedulerTreeTest, BurstEnqueueSpanningBatchesMatchesSingleEnqueues) {
+    policy::PolicyTree policies;
+    addTreePolicy(policies, 1, 0, SchedulingAlgorithm::DRR, 100);
+    for (policy::PolicyId leaf = 10; leaf < 50; ++leaf) {
+        addTreePolicy(policies, leaf, 1, SchedulingAlgorithm::DRR, 100);
+    }
+    SchedulerTree tree(policies, permissiveTreeLeafParams());
+
+    // More than two batches, with interior and unknown policies in between.
+    std::vector<PacketDescriptor> burst;
+    size_t expected = 0;
+    for (uint32_t i = 0; i < 2 * SchedulerTree::ENQUEUE_BATCH + 7; ++i) {
+        policy::PolicyId leaf = (i % 9 == 0) ? 1 : (i % 11 == 0) ? 99 : 10 + i % 40;
+        burst.push_back(treeTestPacket(leaf, 100, i));
+        expected += tree.is_leaf(leaf) ? 1 : 0;
+    }
+    ASSERT_EQ(tree.enqueue_burst(burst.data(), burst.size()), expected);
+    EXPECT_EQ(tree.get_backlog(1), expected);
+    EXPECT_EQ(tree.get_backlog(10 + 1), 2u); // Packets 1 and 41
+}
+
+TEST(SchedulerTreeTest, DropsRefusedByTheLeafQueueAreReported) {
+    policy::PolicyTree policies;
+    addTreePolicy(policies, 1, 0, SchedulingAlgorithm::DRR, 100);
+    SchedulerTree tree(policies, RedAqmParameters(100, 150, 1.0, 1.0, 150)); // One 100-byte packet fits
+    EXPECT_EQ(tree.enqueue(treeTestPacket(1, 100)), EnqueueResult::ENQUEUED);
+    EXPECT_EQ(tree.enqueue(treeTestPacket(1, 100)), EnqueueResult::DROPPED_BY_QUEUE);
+    EXPECT_EQ(tree.get_backlog(1), 1u);
+}
+
+TEST(SchedulerTreeTest, StrictPriorityPortServesHigherLevelsFirst) {
+    policy::PolicyTree policies;
+    addTreePolicy(policies, 1, 0, SchedulingAlgorithm::DRR, 100, 2);
+    addTreePolicy(policies, 2, 0, SchedulingAlgorithm::DRR, 100, 5);
+    addTreePolicy(policies, 3, 0, SchedulingAlgorithm::DRR, 100, 2); // Ties with 1: 1 goes first
+    SchedulerTree tree(policies, permissiveTreeLeafParams(), SchedulingAlgorithm::STRICT_PRIORITY);
+
+    ASSERT_EQ(tree.enqueue(treeTestPacket(3, 100)), EnqueueResult::ENQUEUED);
+    ASSERT_EQ(tree.enqueue(treeTestPacket(1, 100)), EnqueueResult::ENQUEUED);
+    ASSERT_EQ(tree.enqueue(treeTestPacket(2, 100)), EnqueueResult::ENQUEUED);
+    ASSERT_EQ(tree.enqueue(treeTestPacket(1, 100)), EnqueueResult::ENQUEUED);
+
+    std::vector<policy::PolicyId> order;
+    while (std::optional<PacketDescriptor> packet = tree.try_dequeue()) {
+        order.push_back(packet->policy_id);
+    }
+    EXPECT_EQ(order, (std::vector<policy::PolicyId>{2, 1, 1, 3}));
+}
+
+TEST(SchedulerTreeTest, NestedDisciplinesShareEachLevelIndependently) {
+    // Port (DRR) -> tenants A (weight 200) and B (weight 100).
+    // A (WRR)  -> classes A1 (weight 1) and A2 (weight 3), packet-count shares.
+    // B (WFQ)  -> classes B1 (weight 1) and B2 (weight 1), byte shares.
+    policy::PolicyTree policies;
+    addTreePolicy(policies, 10, 0, SchedulingAlgorithm::WRR, 200);
+    addTreePolicy(policies, 20, 0, SchedulingAlgorithm::WFQ, 100);
+    addTreePolicy(policies, 11, 10, SchedulingAlgorithm::DRR, 1);
+    addTreePolicy(policies, 12, 10, SchedulingAlgorithm::DRR, 3);
+    addTreePolicy(policies, 21, 20, SchedulingAlgorithm::DRR, 1);
+    addTreePolicy(policies, 22, 20, SchedulingAlgorithm::DRR, 1);
+    SchedulerTree tree(policies, permissiveTreeLeafParams());
+
+    for (int i = 0; i < 600; ++i) {
+        ASSERT_EQ(tree.enqueue(treeTestPacket(11, 500)), EnqueueResult::ENQUEUED);
+        ASSERT_EQ(tree.enqueue(treeTestPacket(12, 500)), EnqueueResult::ENQUEUED);
+        ASSERT_EQ(tree.enqueue(treeTestPacket(21, 250)), EnqueueResult::ENQUEUED); // Half-size packets
+        ASSERT_EQ(tree.enqueue(treeTestPacket(22, 500)), EnqueueResult::ENQUEUED);
+    }
+
+    std::map<policy::PolicyId, uint64_t> bytes = bytesPerLeaf(tree, 1200); // All leaves stay backlogged
+    uint64_t tenant_a = bytes[11] + bytes[12];
+    uint64_t tenant_b = bytes[21] + bytes[22];
+    EXPECT_NEAR(static_cast<double>(tenant_a) / static_cast<double>(tenant_b), 2.0, 0.05);
+    EXPECT_NEAR(static_cast<double>(bytes[12]) / static_cast<double>(bytes[11]), 3.0, 0.05);
+    EXPECT_NEAR(static_cast<double>(bytes[21]) / static_cast<double>(bytes[22]), 1.0, 0.05);
+}
+
+TEST(SchedulerTreeTest, IdleSubtreeDoesNotKeepItsShare) {
+    policy::PolicyTree policies;
+    addTreePolicy(policies, 1, 0, SchedulingAlgorithm::DRR, 100);
+    addTreePolicy(policies, 2, 0, SchedulingAlgorithm::DRR, 100);
+    SchedulerTree tree(policies, permissiveTreeLeafParams());
+
+    for (int i = 0; i < 10; ++i) {
+        ASSERT_EQ(tree.enqueue(treeTestPacket(1, 1000)), EnqueueResult::ENQUEUED);
+    }
+    std::map<policy::PolicyId, uint64_t> bytes = bytesPerLeaf(tree, 10);
+    EXPECT_EQ(bytes[1], 10000u); // Policy 2 is idle: policy 1 gets the whole port
+
+    // Policy 2 becoming backlogged later takes its share at once.
+    for (int i = 0; i < 10; ++i) {
+        ASSERT_EQ(tree.enqueue(treeTestPacket(1, 1000)), EnqueueResult::ENQUEUED);
+        ASSERT_EQ(tree.enqueue(treeTestPacket(2, 1000)), EnqueueResult::ENQUEUED);
+    }
+    bytes = bytesPerLeaf(tree, 6); // Two DRR rounds: a 1500-byte quantum sends 2 then 1 packets
+    EXPECT_EQ(bytes[1], bytes[2]);
+}
+
+TEST(SchedulerTreeTest, HfscNodeSharesByCommittedRate) {
+    policy::PolicyTree policies;
+    addTreePolicy(policies, 1, 0, SchedulingAlgorithm::HFSC, 100);
+    addTreePolicy(policies, 2, 1, SchedulingAlgorithm::DRR, 100, 0, 30000000); // 30 Mbit/s
+    addTreePolicy(policies, 3, 1, SchedulingAlgorithm::DRR, 100, 0, 10000000); // 10 Mbit/s
+    SchedulerTree tree(policies, permissiveTreeLeafParams());
+
+    for (int i = 0; i < 400; ++i) {
+        ASSERT_EQ(tree.enqueue(treeTestPacket(2, 1000)), EnqueueResult::ENQUEUED);
+        ASSERT_EQ(tree.enqueue(treeTestPacket(3, 1000)), EnqueueResult::ENQUEUED);
+    }
+    std::map<policy::PolicyId, uint64_t> bytes = bytesPerLeaf(tree, 400);
+    EXPECT_NEAR(static_cast<double>(bytes[2]) / static_cast<double>(bytes[3]), 3.0, 0.05);
+}
+
+} // namespace scheduler
+} // namespace hqts
@@ -0,0 +1,126 @@
+#include "gtest/gtest.h"
+#include "hqts/scheduler/service_curve.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace hqts {
+namespace scheduler {
+
+namespace {
+
+constexpr uint64_t BIT_NS = CurveSlope::BIT_NS_PER_BYTE_SECOND;
+
+// Reference results computed with exact 128-bit division.
+uint64_t exact_time_for(uint64_t bytes, uint64_t rate_bps) {
+    u128 result = static_cast<u128>(bytes) * BIT_NS / rate_bps;
+    return result > CurveSlope::INFINITE ? CurveSlope::INFINITE : static_cast<uint64_t>(result);
+}
+
+uint64_t exact_bytes_in(uint64_t ns, uint64_t rate_bps) {
+    return static_cast<uint64_t>(static_cast<u128>(ns) * rate_bps / BIT_NS);
+}
+
+const std::vector<uint64_t> kRates = {2, 1000, 56000, 1000000, 2500000, 10000000, 1000000000, 10000000000ULL,
+                                      400000000000ULL};
+const std::vector<uint64_t> kAmounts = {0, 1, 64, 1500, 9000, 1000000, 1000000000ULL, 1000000000000ULL};
+
+} // namespace
+
+TEST(ServiceCurveTest, TimeForMatchesExactDivision) {
+    for (uint64_t rate : kRates) {
+        CurveSlope slope(rate);
+        for (uint64_t bytes : kAmounts) {
+            uint64_t exact = exact_time_for(bytes, rate);
+            uint64_t approx = slope.time_for(bytes);
+            // Both roundings are downward; the reciprocal loses < 1 ns per 2^TIME_SHIFT bytes.
+            ASSERT_LE(approx, exact) << "rate " << rate << " bytes " << bytes;
+            ASSERT_LE(exact - approx, 1 + (bytes >> CurveSlope::TIME_SHIFT)) << "rate " << rate << " bytes " << bytes;
+        }
+    }
+}
+
+TEST(ServiceCurveTest, BytesInMatchesExactDivision) {
+    for (uint64_t rate : kRates) {
+        CurveSlope slope(rate);
+        for (uint64_t ns : kAmounts) {
+            uint64_t exact = exact_bytes_in(ns, rate);
+            uint64_t approx = slope.bytes_in(ns);
+            ASSERT_LE(approx, exact) << "rate " << rate << " ns " << ns;
+            ASSERT_LE(exact - approx, 1 + (ns >> CurveSlope::BYTES_SHIFT)) << "rate " << rate << " ns " << ns;
+        }
+    }
+}
+
+TEST(ServiceCurveTest, ZeroRateNeverDelivers) {
+    CurveSlope slope(0);
+    ASSERT_TRUE(slope.is_zero());
+    ASSERT_EQ(slope.bytes_in(1000000000), 0);
+    ASSERT_EQ(slope.time_for(0), 0);
+    ASSERT_EQ(slope.time_for(1), CurveSlope::INFINITE);
+}
+
+TEST(ServiceCurveTest, RuntimeCurveMatchesExactTwoPieceFormula) {
+    const std::vector<ServiceCurve> curves = {
+        ServiceCurve(1000000, 0),             // Linear (single-segment path)
+        ServiceCurve(2000000, 1000),          // Pure delay, then 2 Mbps
+        ServiceCurve(1000000, 1000, 8000000), // Concave: 8 Mbps burst for 1 ms
+        ServiceCurve(10000000, 500, 1000000)  // Convex two-piece
+    };
+    const uint64_t x0 = 123456789;
+    const uint64_t y0 = 987654;
+    for (const ServiceCurve& sc : curves) {
+        RuntimeCurve curve;
+        curve.init(InternalServiceCurve(sc), x0, y0);
+        const uint64_t dx = sc.delay_us * 1000;
+        const uint64_t dy = exact_bytes_in(dx, sc.initial_rate_bps);
+
+        for (uint64_t served : {uint64_t{1}, uint64_t{500}, uint64_t{1000}, uint64_t{1500}, uint64_t{100000}}) {
+            uint64_t expected;
+            if (served <= dy) {
+                expected = x0 + exact_time_for(served, sc.initial_rate_bps);
+            } else {
+                expected = x0 + dx + exact_time_for(served - dy, sc.rate_bps);
+            }
+            uint64_t actual = curve.y2x(y0 + served);
+            ASSERT_LE(actual > expected ? actual - expected : expected - actual, 2)
+                << "rate " << sc.rate_bps << " served " << served;
+        }
+        for (uint64_t elapsed : {uint64_t{1000}, uint64_t{400000}, uint64_t{2000000}, uint64_t{1000000000}}) {
+            uint64_t expected = elapsed <= dx
+                ? y0 + exact_bytes_in(elapsed, sc.initial_rate_bps)
+                : y0 + dy + exact_bytes_in(elapsed - dx, sc.rate_bps);
+            uint64_t actual = curve.x2y(x0 + elapsed);
+            ASSERT_LE(actual > expected ? actual - expected : expected - actual, 1)
+                << "rate " << sc.rate_bps << " elapsed " << elapsed;
+        }
+    }
+}
+
+TEST(ServiceCurveTest, MinWithKeepsTheLowerCurve) {
+    InternalServiceCurve concave(ServiceCurve(1000000, 1000, 8000000));
+    RuntimeCurve curve;
+    curve.init(concave, 0, 0);
+
+    // Re-anchoring far below the old curve replaces it entirely.
+    curve.min_with(concave, 10000000, 100);
+    ASSERT_EQ(curve.x_ns, 10000000);
+    ASSERT_EQ(curve.y_bytes, 100);
+    ASSERT_EQ(curve.dy_bytes, concave.dy_bytes);
+
+    // Re-anchoring above the current curve leaves it unchanged.
+    RuntimeCurve before = curve;
+    curve.min_with(concave, 10000000, 5000);
+    ASSERT_EQ(curve.x_ns, before.x_ns);
+    ASSERT_EQ(curve.y_bytes, before.y_bytes);
+
+    // Re-anchoring just below it intersects inside the burst: a shorter first segment.
+    curve.min_with(concave, 10500000, before.x2y(10500000) - 100);
+    ASSERT_EQ(curve.x_ns, 10500000);
+    ASSERT_LT(curve.dx_ns, concave.dx_ns);
+    const uint64_t later = curve.x_ns + curve.dx_ns + 1000000; // Past the intersection both curves coincide
+    ASSERT_NEAR(static_cast<double>(curve.x2y(later)), static_cast<double>(before.x2y(later)), 2.0);
+}
+
+} // namespace scheduler
+} // namespace hqts
@@ -0,0 +1,128 @@
+#include "gtest/gtest.h"
+#include "hqts/scheduler/static_scheduler.h"
+#include "hqts/scheduler/strict_priority_scheduler.h" // Runtime counterpart for comparison
+#include "hqts/scheduler/aqm_queue.h"                 // For RedAqmQueue, RedAqmParameters
+
+#include <array>
+#include <map>
+#include <memory>    // For std::unique_ptr
+#include <optional>
+#include <stdexcept> // For std::invalid_argument, std::runtime_error
+#include <vector>
+
+namespace hqts {
+namespace scheduler {
+
+namespace {
+
+using RedLeaf = StaticQueue<RedAqmQueue>;
+using FourLevels = StaticStrictPriority<RedLeaf, 4, PriorityBits<0, 2>>;
+// Two DRR classes (priority bit 2), each with four strict-priority levels (bits 0..1).
+using ClassesOfLevels = StaticDrr<FourLevels, 2, PriorityBits<2, 1>>;
+
+RedAqmParameters permissiveStaticParams() {
+    return RedAqmParameters(800000, 900000, 0.001, 0.002, 1000000);
+}
+
+FourLevels::Config fourPermissiveLevels() {
+    FourLevels::Config config = {{permissiveStaticParams(), permissiveStaticParams(),
+                                  permissiveStaticParams(), permissiveStaticParams()}};
+    return config;
+}
+
+ClassesOfLevels::Config twoClasses(uint32_t quantum_0, uint32_t quantum_1) {
+    ClassesOfLevels::Config config = {{{quantum_0, quantum_1}}, {{fourPermissiveLevels(), fourPermissiveLevels()}}};
+    return config;
+}
+
+PacketDescriptor staticTestPacket(core::FlowId flow_id, uint32_t length, uint8_t priority) {
+    return PacketDescriptor(flow_id, length, priority);
+}
+
+} // namespace
+
+TEST(StaticSchedulerTest, StrictPriorityMatchesRuntimeScheduler) {
+    StaticScheduler<FourLevels> static_scheduler(fourPermissiveLevels());
+    StrictPriorityScheduler runtime_scheduler(std::vector<RedAqmParameters>(4, permissiveStaticParams()));
+
+    const uint8_t priorities[] = {0, 2, 1, 3, 2, 0, 3, 1};
+    for (core::FlowId flow = 0; flow < 8; ++flow) {
+        ASSERT_EQ(static_scheduler.enqueue(staticTestPacket(flow, 100, priorities[flow])), EnqueueResult::ENQUEUED);
+        ASSERT_EQ(runtime_scheduler.enqueue(staticTestPacket(flow, 100, priorities[flow])), EnqueueResult::ENQUEUED);
+    }
+    for (int i = 0; i < 8; ++i) {
+        std::optional<PacketDescriptor> expected = runtime_scheduler.try_dequeue();
+        std::optional<PacketDescriptor> actual = static_scheduler.try_dequeue();
+        ASSERT_TRUE(expected.has_value());
+        ASSERT_TRUE(actual.has_value());
+        EXPECT_EQ(actual->flow_id, expected->flow_id);
+    }
+    EXPECT_TRUE(static_scheduler.is_empty());
+    EXPECT_FALSE(static_scheduler.try_dequeue().has_value());
+    EXPECT_THROW(static_scheduler.dequeue(), std::runtime_error);
+}
+
+TEST(StaticSchedulerTest, ReportsDropReasons) {
+    StaticScheduler<FourLevels> scheduler(fourPermissiveLevels());
+    // PriorityBits<0, 2> selects up to level 3: with three levels, priority 3 has no queue.
+    using ThreeOfFour = StaticStrictPriority<RedLeaf, 3, PriorityBits<0, 2>>;
+    ThreeOfFour::Config three = {{permissiveStaticParams(), permissiveStaticParams(),
+                                  RedAqmParameters(100, 150, 1.0, 1.0, 150)}}; // Level 2 holds one packet
+    StaticScheduler<ThreeOfFour> small(three);
+
+    EXPECT_EQ(small.enqueue(staticTestPacket(1, 100, 3)), EnqueueResult::DROPPED_NO_QUEUE);
+    EXPECT_EQ(small.enqueue(staticTestPacket(2, 100, 2)), EnqueueResult::ENQUEUED);
+    EXPECT_EQ(small.enqueue(staticTestPacket(3, 100, 2)), EnqueueResult::DROPPED_BY_QUEUE);
+    EXPECT_EQ(small.root().child(2).queue().get_current_packet_count(), 1u);
+    EXPECT_THROW(small.root().child(3), std::out_of_range);
+
+    std::vector<PacketDescriptor> burst = {staticTestPacket(4, 100, 0), staticTestPacket(5, 100, 3),
+                                           staticTestPacket(6, 100, 1)};
+    EXPECT_EQ(scheduler.enqueue_burst(burst.data(), burst.size()), 3u);
+    std::vector<PacketDescriptor> out;
+    EXPECT_EQ(scheduler.dequeue_burst(out, 8), 3u);
+    ASSERT_EQ(out.size(), 3u);
+    EXPECT_EQ(out[0].flow_id, 5u);
+    EXPECT_EQ(out[1].flow_id, 6u);
+    EXPECT_EQ(out[2].flow_id, 4u);
+}
+
+TEST(StaticSchedulerTest, DrrRejectsZeroQuantum) {
+    EXPECT_THROW(StaticScheduler<ClassesOfLevels>(twoClasses(1500, 0)), std::invalid_argument);
+}
+
+TEST(StaticSchedulerTest, DrrSharesBytesByQuantumAndKeepsPriorityWithinClass) {
+    StaticScheduler<ClassesOfLevels> scheduler(twoClasses(3000, 1000));
+    // Class 0: levels 3 and 0 (priority 3, 0); class 1: level 1 (priority 4 | 1 = 5).
+    for (core::FlowId i = 0; i < 200; ++i) {
+        ASSERT_EQ(scheduler.enqueue(staticTestPacket(1, 500, 3)), EnqueueResult::ENQUEUED);
+        ASSERT_EQ(scheduler.enqueue(staticTestPacket(2, 500, 0)), EnqueueResult::ENQUEUED);
+        ASSERT_EQ(scheduler.enqueue(staticTestPacket(3, 500, 5)), EnqueueResult::ENQUEUED);
+    }
+
+    std::map<core::FlowId, uint64_t> bytes;
+    for (int i = 0; i < 240; ++i) { // Both classes stay backlogged throughout
+        std::optional<PacketDescriptor> packet = scheduler.try_dequeue();
+        ASSERT_TRUE(packet.has_value());
+        bytes[packet->flow_id] += packet->packet_length_bytes;
+    }
+    EXPECT_EQ(bytes[2], 0u); // Strict priority inside class 0: level 3 is not yet drained
+    EXPECT_EQ(bytes[1], 3 * bytes[3]); // 3000 : 1000 quanta
+}
+
+TEST(StaticSchedulerTest, AdapterServesThroughSchedulerInterface) {
+    std::unique_ptr<SchedulerInterface> scheduler =
+        std::make_unique<StaticSchedulerAdapter<ClassesOfLevels>>(twoClasses(1500, 1500));
+    EXPECT_TRUE(scheduler->is_empty());
+    EXPECT_EQ(scheduler->enqueue(staticTestPacket(1, 100, 0)), EnqueueResult::ENQUEUED);
+    EXPECT_EQ(scheduler->enqueue(staticTestPacket(2, 100, 4)), EnqueueResult::ENQUEUED);
+
+    std::vector<PacketDescriptor> out;
+    EXPECT_EQ(scheduler->dequeue_burst(out, 4), 2u);
+    EXPECT_EQ(out[0].flow_id, 1u); // Class 0 became active first
+    EXPECT_EQ(out[1].flow_id, 2u);
+    EXPECT_THROW(scheduler->dequeue(), std::runtime_error);
+}
+
+} // namespace scheduler
+} // namespace hqts
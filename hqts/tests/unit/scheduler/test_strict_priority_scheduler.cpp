@@ -7,13 +7,14 @@
 #include <vector>
 #include <stdexcept> // For std::invalid_argument, std::out_of_range, std::runtime_error
 #include <numeric>   // For std::iota if needed
+#include <optional>  // For std::optional
 
 namespace hqts {
 namespace scheduler {
 
 // Helper to create a PacketDescriptor for tests
-PacketDescriptor createTestPacket(core::FlowId flow_id, uint32_t length, uint8_t priority, size_t payload_size = 0) {
-    return PacketDescriptor(flow_id, length, priority, payload_size);
+PacketDescriptor createTestPacket(core::FlowId flow_id, uint32_t length, uint8_t priority, core::PacketBufferHandle buffer = core::INVALID_PACKET_BUFFER) {
+    return PacketDescriptor(flow_id, length, priority, buffer);
 }
 
 // Helper to create a vector of permissive RedAqmParameters for multiple queues
@@ -77,6 +78,21 @@ TEST(StrictPrioritySchedulerTest, DequeueFromEmpty) {
     StrictPriorityScheduler scheduler(createPermissiveParamsList(8));
     ASSERT_TRUE(scheduler.is_empty());
     ASSERT_THROW(scheduler.dequeue(), std::runtime_error);
+    EXPECT_FALSE(scheduler.try_dequeue().has_value()); // The non-throwing hot-path form
+}
+
+TEST(StrictPrioritySchedulerTest, TryDequeueFollowsPriorityOrder) {
+    StrictPriorityScheduler scheduler(createPermissiveParamsList(4));
+    ASSERT_EQ(scheduler.enqueue(createTestPacket(1, 100, 1)), EnqueueResult::ENQUEUED);
+    ASSERT_EQ(scheduler.enqueue(createTestPacket(2, 100, 3)), EnqueueResult::ENQUEUED);
+
+    std::optional<PacketDescriptor> first = scheduler.try_dequeue();
+    ASSERT_TRUE(first.has_value());
+    EXPECT_EQ(first->flow_id, 2u);
+    std::optional<PacketDescriptor> second = scheduler.try_dequeue();
+    ASSERT_TRUE(second.has_value());
+    EXPECT_EQ(second->flow_id, 1u);
+    EXPECT_FALSE(scheduler.try_dequeue().has_value());
 }
 
 TEST(StrictPrioritySchedulerTest, EnqueueInvalidPriority) {
@@ -85,7 +101,8 @@ TEST(StrictPrioritySchedulerTest, EnqueueInvalidPriority) {
     PacketDescriptor p_invalid_too_high = createTestPacket(2, 100, 4);
 
     ASSERT_NO_THROW(scheduler.enqueue(p_valid_high));
-    ASSERT_THROW(scheduler.enqueue(p_invalid_too_high), std::out_of_range);
+    EXPECT_EQ(scheduler.enqueue(p_invalid_too_high), EnqueueResult::DROPPED_NO_QUEUE); // Released, not thrown
+    EXPECT_EQ(scheduler.get_queue_size(3), 1u);
 }
 
 TEST(StrictPrioritySchedulerTest, GetQueueSizeInvalidPriority) {
@@ -164,6 +181,33 @@ TEST(StrictPrioritySchedulerTest, FillAndEmptyMultipleLevels) {
     ASSERT_TRUE(scheduler.is_empty());
 }
 
+TEST(StrictPrioritySchedulerTest, BacklogBitmapTracksNonEmptyLevels) {
+    // All 256 addressable levels; 257 are rejected.
+    ASSERT_THROW(StrictPriorityScheduler(createPermissiveParamsList(257, 6400)), std::invalid_argument);
+    StrictPriorityScheduler scheduler(createPermissiveParamsList(256, 6400));
+    ASSERT_FALSE(scheduler.backlog_bitmap().any());
+    ASSERT_EQ(scheduler.highest_backlogged_level(), PriorityBitmap::NO_LEVEL);
+
+    scheduler.enqueue(createTestPacket(1, 100, 3));
+    scheduler.enqueue(createTestPacket(2, 100, 200));
+    scheduler.enqueue(createTestPacket(3, 100, 200));
+    scheduler.enqueue(createTestPacket(4, 100, 64));
+    ASSERT_TRUE(scheduler.backlog_bitmap().test(3));
+    ASSERT_TRUE(scheduler.backlog_bitmap().test(64));
+    ASSERT_TRUE(scheduler.backlog_bitmap().test(200));
+    ASSERT_FALSE(scheduler.backlog_bitmap().test(199));
+    ASSERT_EQ(scheduler.highest_backlogged_level(), 200);
+
+    ASSERT_EQ(scheduler.dequeue().flow_id, 2);
+    ASSERT_TRUE(scheduler.backlog_bitmap().test(200)); // Still one packet at level 200
+    ASSERT_EQ(scheduler.dequeue().flow_id, 3);
+    ASSERT_FALSE(scheduler.backlog_bitmap().test(200));
+    ASSERT_EQ(scheduler.highest_backlogged_level(), 64);
+    ASSERT_EQ(scheduler.dequeue().flow_id, 4);
+    ASSERT_EQ(scheduler.dequeue().flow_id, 1);
+    ASSERT_FALSE(scheduler.backlog_bitmap().any());
+}
+
 // --- New Tests for AQM Behavior ---
 
 TEST(StrictPrioritySchedulerAqmTest, AqmDropInSpecificQueue) {
@@ -257,9 +301,15 @@ TEST(StrictPrioritySchedulerAqmTest, AqmInteractionAcrossPriorities) {
     StrictPriorityScheduler scheduler(params_list);
 
     // Cause P1 to start dropping
-    for(int i=0; i<10; ++i) scheduler.enqueue(createTestPacket(100+i, 20, 1)); // Fill P1
+    size_t p1_refused = 0;
+    for(int i=0; i<10; ++i) {
+        if (scheduler.enqueue(createTestPacket(100+i, 20, 1)) == EnqueueResult::DROPPED_BY_QUEUE) { // Fill P1
+            ++p1_refused;
+        }
+    }
     size_t p1_initial_count = scheduler.get_queue_size(1);
     ASSERT_LT(p1_initial_count, 10u); // Expect some drops
+    EXPECT_EQ(p1_refused, 10u - p1_initial_count); // Every drop is reported as an AQM drop
 
     // Enqueue to P0, should all be accepted
     for(int i=0; i<5; ++i) scheduler.enqueue(createTestPacket(i, 100, 0));
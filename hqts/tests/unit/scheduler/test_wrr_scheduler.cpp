@@ -107,7 +107,7 @@ TEST(WrrSchedulerTest, EnqueueInvalidQueueId) {
     PacketDescriptor p_invalid_q_id = createWrrTestPacket(2, 100, 2);
 
     ASSERT_NO_THROW(scheduler.enqueue(p_valid));
-    ASSERT_THROW(scheduler.enqueue(p_invalid_q_id), std::out_of_range);
+    EXPECT_EQ(scheduler.enqueue(p_invalid_q_id), EnqueueResult::DROPPED_NO_QUEUE); // Released, not thrown
 }
 
 TEST(WrrSchedulerTest, GetQueueSizeInvalidQueueId) {
@@ -202,6 +202,67 @@ TEST(WrrSchedulerTest, ComplexDistributionMultipleRounds) {
     ASSERT_EQ(dequeued_counts[static_cast<core::QueueId>(3)], 6);
 }
 
+TEST(WrrSchedulerTest, ByteModeSharesBytesNotPackets) {
+    auto configs = createWrrConfigsWithPermissiveAqm({
+        {static_cast<core::QueueId>(1), 1}, {static_cast<core::QueueId>(2), 1}
+    });
+    WrrOptions options;
+    options.mode = WrrMode::BYTE;
+    options.bytes_per_weight = 1500;
+    ASSERT_THROW(WrrScheduler(configs, WrrOptions{WrrMode::BYTE, 0}), std::invalid_argument);
+    WrrScheduler scheduler(configs, options);
+    ASSERT_EQ(scheduler.get_mode(), WrrMode::BYTE);
+
+    // Equal weights, 1500-byte packets against 100-byte packets: equal bytes,
+    // so 15 small packets per large one.
+    for (int i = 0; i < 10; ++i) scheduler.enqueue(createWrrTestPacket(100 + i, 1500, 1));
+    for (int i = 0; i < 300; ++i) scheduler.enqueue(createWrrTestPacket(1000 + i, 100, 2));
+
+    std::map<core::QueueId, uint64_t> bytes;
+    for (int i = 0; i < 10 * 16; ++i) { // Ten rounds
+        PacketDescriptor p = scheduler.dequeue();
+        bytes[static_cast<core::QueueId>(p.priority)] += p.packet_length_bytes;
+    }
+    ASSERT_EQ(bytes[1], 15000);
+    ASSERT_EQ(bytes[2], 15000);
+}
+
+TEST(WrrSchedulerTest, InterleavedModeSpreadsTurnsAcrossTheRound) {
+    auto configs = createWrrConfigsWithPermissiveAqm({
+        {static_cast<core::QueueId>(1), 3}, {static_cast<core::QueueId>(2), 1}, {static_cast<core::QueueId>(3), 2}
+    });
+    WrrScheduler scheduler(configs, WrrOptions{WrrMode::INTERLEAVED, 1500});
+    for (int i = 0; i < 6; ++i) scheduler.enqueue(createWrrTestPacket(10 + i, 100, 1));
+    for (int i = 0; i < 2; ++i) scheduler.enqueue(createWrrTestPacket(20 + i, 100, 2));
+    for (int i = 0; i < 4; ++i) scheduler.enqueue(createWrrTestPacket(30 + i, 100, 3));
+
+    std::vector<core::QueueId> order;
+    while (!scheduler.is_empty()) {
+        order.push_back(static_cast<core::QueueId>(scheduler.dequeue().priority));
+    }
+    // Round one is passes {1,2,3}, {1,3}, {1}: queue 2 never waits for queue 1's whole
+    // share. Round two visits queues in the order they finished round one.
+    std::vector<core::QueueId> expected = {1, 2, 3, 1, 3, 1, 2, 3, 1, 3, 1, 1};
+    ASSERT_EQ(order, expected);
+}
+
+TEST(WrrSchedulerTest, PacketModeServesOnlyBackloggedQueues) {
+    std::vector<WrrScheduler::QueueConfig> configs;
+    for (uint16_t id = 0; id < 256; ++id) { // Every queue a packet's 8-bit priority can address
+        configs.emplace_back(static_cast<core::QueueId>(id), 2, createPermissiveAqmParams(10000));
+    }
+    WrrScheduler scheduler(configs);
+    for (int i = 0; i < 3; ++i) scheduler.enqueue(createWrrTestPacket(10 + i, 100, 250));
+    for (int i = 0; i < 3; ++i) scheduler.enqueue(createWrrTestPacket(20 + i, 100, 5));
+
+    std::vector<core::FlowId> order;
+    while (!scheduler.is_empty()) {
+        order.push_back(scheduler.dequeue().flow_id);
+    }
+    std::vector<core::FlowId> expected = {10, 11, 20, 21, 12, 22};
+    ASSERT_EQ(order, expected);
+}
+
 // --- New Tests for AQM Behavior with WRR ---
 
 TEST(WrrSchedulerAqmTest, AqmDropInWrrQueue) {
@@ -0,0 +1,252 @@
+#include "load_generator.h"
+
+#include "hqts/core/time_source.h"            // For core::steady_now_ns
+#include "hqts/scheduler/packet_descriptor.h" // For PacketDescriptor, ConformanceLevel
+
+#include <algorithm> // For std::max, std::nth_element
+#include <iomanip>   // For std::setw, std::setprecision
+#include <limits>
+#include <stdexcept> // For std::invalid_argument
+
+namespace hqts {
+namespace trafficgen {
+
+namespace {
+
+const char* const CONFORMANCE_NAMES[3] = {"green", "yellow", "red"};
+
+size_t conformance_index(scheduler::ConformanceLevel level) {
+    return static_cast<size_t>(level);
+}
+
+} // namespace
+
+// --- LoadReport ---
+
+double LoadReport::mpps() const {
+    uint64_t wall_ns = ingress.wall_ns + dequeue.wall_ns;
+    return wall_ns == 0 ? 0.0 : static_cast<double>(packets_offered) * 1e3 / static_cast<double>(wall_ns);
+}
+
+uint64_t LoadReport::latency_quantile(double q) {
+    if (latency_ns.empty()) {
+        return 0;
+    }
+    size_t index = static_cast<size_t>(q * static_cast<double>(latency_ns.size() - 1));
+    std::nth_element(latency_ns.begin(), latency_ns.begin() + static_cast<std::ptrdiff_t>(index), latency_ns.end());
+    return latency_ns[index];
+}
+
+void print_report(LoadReport& report, std::ostream& out, bool json) {
+    const double quantiles[] = {0.5, 0.9, 0.99, 0.999, 1.0};
+    const char* const quantile_names[] = {"p50", "p90", "p99", "p999", "max"};
+    uint64_t latency[5];
+    for (size_t i = 0; i < 5; ++i) {
+        latency[i] = report.latency_quantile(quantiles[i]);
+    }
+    double seconds = static_cast<double>(report.virtual_duration_ns) / 1e9;
+    double offered_gbps = seconds > 0 ? static_cast<double>(report.bytes_offered) * 8 / seconds / 1e9 : 0.0;
+    double delivered_gbps = seconds > 0 ? static_cast<double>(report.bytes_transmitted) * 8 / seconds / 1e9 : 0.0;
+    const StageStats* stages[] = {&report.classify_meter, &report.enqueue, &report.dequeue, &report.ingress};
+    const char* const stage_names[] = {"classify_meter", "enqueue", "dequeue", "ingress_total"};
+
+    if (json) {
+        out << "{\"packets_offered\":" << report.packets_offered << ",\"packets_transmitted\":"
+            << report.packets_transmitted << ",\"virtual_seconds\":" << seconds << ",\"offered_gbps\":"
+            << offered_gbps << ",\"delivered_gbps\":" << delivered_gbps << ",\"mpps\":" << report.mpps()
+            << ",\"ns_per_packet\":{";
+        for (size_t i = 0; i < 4; ++i) {
+            out << (i ? "," : "") << '"' << stage_names[i] << "\":" << stages[i]->ns_per_packet();
+        }
+        out << "},\"conformance\":{";
+        for (size_t c = 0; c < 3; ++c) {
+            const ConformanceStats& stats = report.by_conformance[c];
+            out << (c ? "," : "") << '"' << CONFORMANCE_NAMES[c] << "\":{\"offered\":" << stats.offered
+                << ",\"policed\":" << stats.policed << ",\"aqm_dropped\":" << stats.aqm_dropped
+                << ",\"transmitted\":" << stats.transmitted << ",\"drop_rate\":" << stats.drop_rate() << '}';
+        }
+        out << "},\"latency_ns\":{";
+        for (size_t i = 0; i < 5; ++i) {
+            out << (i ? "," : "") << '"' << quantile_names[i] << "\":" << latency[i];
+        }
+        out << "}}" << std::endl;
+        return;
+    }
+
+    out << std::fixed << std::setprecision(2);
+    out << "offered      " << report.packets_offered << " packets, " << offered_gbps << " Gbit/s over " << seconds
+        << " s (virtual)\n";
+    out << "transmitted  " << report.packets_transmitted << " packets, " << delivered_gbps << " Gbit/s\n";
+    out << "throughput   " << report.mpps() << " Mpps (data path, wall clock)\n";
+    out << "ns/packet   ";
+    for (size_t i = 0; i < 4; ++i) {
+        out << ' ' << stage_names[i] << '=' << stages[i]->ns_per_packet();
+    }
+    out << '\n';
+    for (size_t c = 0; c < 3; ++c) {
+        const ConformanceStats& stats = report.by_conformance[c];
+        out << std::setw(7) << CONFORMANCE_NAMES[c] << "      offered " << stats.offered << ", policed "
+            << stats.policed << ", aqm " << stats.aqm_dropped << ", sent " << stats.transmitted << ", dropped "
+            << stats.drop_rate() * 100 << "%\n";
+    }
+    out << "latency us  ";
+    for (size_t i = 0; i < 5; ++i) {
+        out << ' ' << quantile_names[i] << '=' << static_cast<double>(latency[i]) / 1e3;
+    }
+    out << std::endl;
+}
+
+// --- Timed stages ---
+
+bool LoadGenerator::TimedShaper::process_packet(scheduler::PacketDescriptor& packet,
+                                                const dataplane::FiveTuple& five_tuple, core::TimestampNs now_ns,
+                                                core::TimestampNs* release_ns) {
+    uint64_t start = core::steady_now_ns();
+    bool keep = shaper_.process_packet(packet, five_tuple, now_ns, release_ns);
+    report_->classify_meter.wall_ns += core::steady_now_ns() - start;
+    report_->classify_meter.packets += 1;
+
+    ConformanceStats& stats = report_->by_conformance[conformance_index(packet.conformance)];
+    ++stats.offered;
+    stats.policed += keep ? 0 : 1;
+    return keep;
+}
+
+size_t LoadGenerator::TimedShaper::process_burst(scheduler::PacketDescriptor* packets,
+                                                 const dataplane::FiveTuple* five_tuples, size_t count,
+                                                 core::TimestampNs now_ns, core::TimestampNs* release_ns) {
+    uint64_t start = core::steady_now_ns();
+    size_t kept = shaper_.process_burst(packets, five_tuples, count, now_ns, release_ns);
+    report_->classify_meter.wall_ns += core::steady_now_ns() - start;
+    report_->classify_meter.packets += count;
+
+    for (size_t i = 0; i < count; ++i) {
+        ConformanceStats& stats = report_->by_conformance[conformance_index(packets[i].conformance)];
+        ++stats.offered;
+        stats.policed += i < kept ? 0 : 1; // Dropped packets are compacted behind the kept ones
+    }
+    return kept;
+}
+
+scheduler::EnqueueResult LoadGenerator::TimedScheduler::enqueue_untimed(scheduler::PacketDescriptor packet) {
+    packet.enqueue_time_ns = now_ns_;
+    size_t level = conformance_index(packet.conformance);
+    scheduler::EnqueueResult result = scheduler_.enqueue(packet);
+    if (result != scheduler::EnqueueResult::ENQUEUED) {
+        ++report_->by_conformance[level].aqm_dropped;
+    }
+    return result;
+}
+
+scheduler::EnqueueResult LoadGenerator::TimedScheduler::enqueue(scheduler::PacketDescriptor packet) {
+    uint64_t start = core::steady_now_ns();
+    scheduler::EnqueueResult result = enqueue_untimed(packet);
+    report_->enqueue.wall_ns += core::steady_now_ns() - start;
+    report_->enqueue.packets += 1;
+    return result;
+}
+
+size_t LoadGenerator::TimedScheduler::enqueue_burst(scheduler::PacketDescriptor* packets, size_t count) {
+    // One enqueue() per packet (not enqueue_burst) so drops can be attributed to their level.
+    uint64_t start = core::steady_now_ns();
+    size_t enqueued = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (enqueue_untimed(packets[i]) == scheduler::EnqueueResult::ENQUEUED) {
+            ++enqueued;
+        }
+    }
+    report_->enqueue.wall_ns += core::steady_now_ns() - start;
+    report_->enqueue.packets += count;
+    return enqueued;
+}
+
+// --- LoadGenerator ---
+
+LoadGenerator::LoadGenerator(policy::PolicyTree& policies, policy::PolicyId default_policy_id,
+                             scheduler::SchedulerInterface& scheduler, const GeneratorConfig& config)
+    : config_(config),
+      flow_table_(config.max_flows,
+                  core::FlowAgingConfig{config.flow_idle_timeout_ns, 1024, core::FlowTableFullPolicy::EVICT_LRU}),
+      classifier_(flow_table_, default_policy_id), shaper_(policies, classifier_, flow_table_),
+      timed_shaper_(shaper_, report_), timed_scheduler_(scheduler, report_, now_ns_) {
+    if (config.link_rate_bps == 0 || config.burst_size == 0) {
+        throw std::invalid_argument("LoadGenerator: link_rate_bps and burst_size must be greater than zero.");
+    }
+    pipeline_ = std::make_unique<Pipeline>(classifier_, timed_shaper_, timed_scheduler_);
+}
+
+core::TimestampNs LoadGenerator::transmission_ns(uint32_t length_bytes) const {
+    uint64_t wire_bits = (static_cast<uint64_t>(length_bytes) + config_.wire_overhead_bytes) * 8;
+    return (wire_bits * 1000000000ull + config_.link_rate_bps - 1) / config_.link_rate_bps;
+}
+
+void LoadGenerator::drain_until(core::TimestampNs until_ns, LoadReport& report) {
+    uint64_t start = core::steady_now_ns();
+    uint64_t sent = 0;
+    while (link_free_ns_ <= until_ns) {
+        scheduler::PacketDescriptor packet = pipeline_->get_next_packet_to_transmit(link_free_ns_);
+        if (packet.packet_length_bytes == 0) {
+            break; // Scheduler empty: the link idles until the next arrival
+        }
+        core::TimestampNs start_ns = std::max(link_free_ns_, packet.enqueue_time_ns);
+        report.latency_ns.push_back(start_ns - packet.enqueue_time_ns);
+        link_free_ns_ = start_ns + transmission_ns(packet.packet_length_bytes);
+        ++report.by_conformance[conformance_index(packet.conformance)].transmitted;
+        report.bytes_transmitted += packet.packet_length_bytes;
+        ++sent;
+    }
+    report.dequeue.wall_ns += core::steady_now_ns() - start;
+    report.dequeue.packets += sent;
+    report.packets_transmitted += sent;
+}
+
+LoadReport LoadGenerator::run(PacketSource& source) {
+    LoadReport report;
+    report_ = &report;
+    link_free_ns_ = 0;
+
+    std::vector<core::IncomingPacket> burst;
+    burst.reserve(config_.burst_size);
+    core::TimestampNs first_arrival_ns = 0;
+    TracePacket arrival;
+    bool more = source.next(arrival);
+    if (more) {
+        first_arrival_ns = arrival.time_ns;
+    }
+    while (more) {
+        // A burst holds the arrivals up to burst_size and is handed over at its last arrival's time.
+        burst.clear();
+        core::TimestampNs burst_time_ns = arrival.time_ns;
+        while (more && burst.size() < config_.burst_size) {
+            burst.emplace_back(arrival.five_tuple, arrival.length_bytes);
+            burst_time_ns = arrival.time_ns;
+            report.bytes_offered += arrival.length_bytes;
+            more = source.next(arrival);
+        }
+        report.packets_offered += burst.size();
+
+        drain_until(burst_time_ns, report);
+        if (config_.flow_idle_timeout_ns != 0) {
+            flow_table_.age(burst_time_ns);
+        }
+
+        now_ns_ = burst_time_ns;
+        uint64_t start = core::steady_now_ns();
+        if (config_.burst_size == 1) {
+            pipeline_->handle_incoming_packet(burst[0].five_tuple, burst[0].packet_length_bytes,
+                                              core::INVALID_PACKET_BUFFER, burst_time_ns);
+        } else {
+            pipeline_->handle_incoming_burst(burst, burst_time_ns);
+        }
+        report.ingress.wall_ns += core::steady_now_ns() - start;
+        report.ingress.packets += burst.size();
+    }
+    drain_until(std::numeric_limits<core::TimestampNs>::max(), report);
+
+    report.virtual_duration_ns = link_free_ns_ > first_arrival_ns ? link_free_ns_ - first_arrival_ns : 0;
+    report_ = nullptr;
+    return report;
+}
+
+} // namespace trafficgen
+} // namespace hqts
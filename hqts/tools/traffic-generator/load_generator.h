@@ -0,0 +1,181 @@
+#ifndef HQTS_TOOLS_TRAFFIC_GENERATOR_LOAD_GENERATOR_H_
+#define HQTS_TOOLS_TRAFFIC_GENERATOR_LOAD_GENERATOR_H_
+
+#include "workload.h"
+
+#include "hqts/core/packet_pipeline.h"            // For BasicPacketPipeline, IncomingPacket
+#include "hqts/core/traffic_shaper.h"
+#include "hqts/dataplane/flow_table.h"            // For core::FlowTable
+#include "hqts/dataplane/flow_classifier.h"
+#include "hqts/policy/policy_tree.h"
+#include "hqts/scheduler/scheduler_interface.h"   // For SchedulerInterface, EnqueueResult
+
+#include <array>
+#include <cstddef> // For size_t
+#include <cstdint>
+#include <memory>  // For std::unique_ptr
+#include <optional>
+#include <ostream>
+#include <vector>
+
+namespace hqts {
+namespace trafficgen {
+
+/**
+ * @brief Port model and data-path parameters of a LoadGenerator run.
+ */
+struct GeneratorConfig {
+    uint64_t link_rate_bps = 10000000000ull; // Egress port rate on the virtual clock
+    uint32_t wire_overhead_bytes = 20;       // Preamble and inter-frame gap per packet
+    size_t burst_size = 32;                  // Arrivals per handle_incoming_burst(); 1 uses handle_incoming_packet()
+    size_t max_flows = 1u << 20;             // FlowTable capacity
+    uint64_t flow_idle_timeout_ns = 0;       // Virtual idle time after which flows expire; 0 disables aging
+};
+
+/**
+ * @brief Wall time spent in one data-path stage.
+ */
+struct StageStats {
+    uint64_t packets = 0;
+    uint64_t wall_ns = 0;
+
+    double ns_per_packet() const { return packets == 0 ? 0.0 : static_cast<double>(wall_ns) / static_cast<double>(packets); }
+};
+
+/**
+ * @brief Packet fates for one ConformanceLevel.
+ */
+struct ConformanceStats {
+    uint64_t offered = 0;     // Packets the shaper marked with this level
+    uint64_t policed = 0;     // Dropped by the shaper
+    uint64_t aqm_dropped = 0; // Refused by the scheduler's queues
+    uint64_t transmitted = 0;
+
+    /** @brief Fraction of offered packets dropped, by shaper or AQM. */
+    double drop_rate() const {
+        return offered == 0 ? 0.0 : static_cast<double>(policed + aqm_dropped) / static_cast<double>(offered);
+    }
+};
+
+/**
+ * @brief Results of one LoadGenerator run.
+ */
+struct LoadReport {
+    uint64_t packets_offered = 0;
+    uint64_t bytes_offered = 0;
+    uint64_t packets_transmitted = 0;
+    uint64_t bytes_transmitted = 0;
+    core::TimestampNs virtual_duration_ns = 0; // First arrival to last transmission end
+
+    StageStats ingress;       // Whole handle_incoming_packet/burst calls
+    StageStats classify_meter; // TrafficShaper: classification and metering
+    StageStats enqueue;       // Scheduler enqueue
+    StageStats dequeue;       // Scheduler dequeue, through the pipeline
+
+    std::array<ConformanceStats, 3> by_conformance; // Indexed by ConformanceLevel
+
+    // Queueing delay (virtual ns from arrival to transmission start) of every transmitted packet.
+    std::vector<uint64_t> latency_ns;
+
+    /** @brief Data-path throughput: offered packets over the wall time of ingress and dequeue. */
+    double mpps() const;
+
+    /** @brief The q-quantile (0..1) of latency_ns; sorts latency_ns. 0 if nothing was sent. */
+    uint64_t latency_quantile(double q);
+};
+
+/** @brief Prints `report` as text (json = false) or as one JSON object. */
+void print_report(LoadReport& report, std::ostream& out, bool json);
+
+/**
+ * @brief Drives a PacketPipeline built on the library's classifier, shaper and a caller's
+ *        scheduler with a PacketSource, on a virtual clock.
+ *
+ * Every arrival's timestamp is the `now_ns` handed to the pipeline, and so to the
+ * TrafficShaper's TokenBucket refills and the FlowTable's last-seen times: a given source
+ * produces the same conformance marks, drops and latencies on every run, whatever the
+ * machine. Egress is a port of GeneratorConfig::link_rate_bps draining the scheduler
+ * through get_next_packet_to_transmit() whenever the link is free before the next
+ * arrival, so queues build up exactly as they would at that rate.
+ *
+ * Only the wall-clock stage timings depend on the machine. The shaper and scheduler are
+ * wrapped to time their calls, which adds a clock read per call (per burst when
+ * burst_size > 1).
+ */
+class LoadGenerator {
+public:
+    /**
+     * @param policies Policy tree the shaper meters against.
+     * @param default_policy_id Policy of flows the classifier has no rule for.
+     * @param scheduler Port scheduler; the shaper's target priorities select its queues.
+     * @param config Port model and data-path parameters.
+     * @throws std::invalid_argument if link_rate_bps or burst_size is 0.
+     */
+    LoadGenerator(policy::PolicyTree& policies, policy::PolicyId default_policy_id,
+                  scheduler::SchedulerInterface& scheduler, const GeneratorConfig& config);
+
+    LoadGenerator(const LoadGenerator&) = delete;
+    LoadGenerator& operator=(const LoadGenerator&) = delete;
+
+    /** @brief Runs `source` to exhaustion and drains the scheduler. */
+    LoadReport run(PacketSource& source);
+
+private:
+    /// TrafficShaper stand-in for the pipeline: times calls and counts marks and drops.
+    class TimedShaper {
+    public:
+        TimedShaper(core::TrafficShaper& shaper, LoadReport*& report) : shaper_(shaper), report_(report) {}
+
+        bool process_packet(scheduler::PacketDescriptor& packet, const dataplane::FiveTuple& five_tuple,
+                            core::TimestampNs now_ns, core::TimestampNs* release_ns);
+        size_t process_burst(scheduler::PacketDescriptor* packets, const dataplane::FiveTuple* five_tuples,
+                             size_t count, core::TimestampNs now_ns, core::TimestampNs* release_ns);
+
+    private:
+        core::TrafficShaper& shaper_;
+        LoadReport*& report_;
+    };
+
+    /// SchedulerInterface stand-in for the pipeline: times enqueues and stamps arrival times.
+    class TimedScheduler {
+    public:
+        TimedScheduler(scheduler::SchedulerInterface& scheduler, LoadReport*& report, const core::TimestampNs& now_ns)
+            : scheduler_(scheduler), report_(report), now_ns_(now_ns) {}
+
+        scheduler::EnqueueResult enqueue(scheduler::PacketDescriptor packet);
+        size_t enqueue_burst(scheduler::PacketDescriptor* packets, size_t count);
+        std::optional<scheduler::PacketDescriptor> try_dequeue() { return scheduler_.try_dequeue(); }
+        size_t dequeue_burst(std::vector<scheduler::PacketDescriptor>& out, size_t max_packets) {
+            return scheduler_.dequeue_burst(out, max_packets);
+        }
+
+    private:
+        scheduler::EnqueueResult enqueue_untimed(scheduler::PacketDescriptor packet);
+
+        scheduler::SchedulerInterface& scheduler_;
+        LoadReport*& report_;
+        const core::TimestampNs& now_ns_; // Arrival time of the packets being enqueued
+    };
+
+    using Pipeline = core::BasicPacketPipeline<dataplane::FlowClassifier, TimedShaper, TimedScheduler>;
+
+    /// Transmits queued packets while the link becomes free no later than `until_ns`.
+    void drain_until(core::TimestampNs until_ns, LoadReport& report);
+    core::TimestampNs transmission_ns(uint32_t length_bytes) const;
+
+    GeneratorConfig config_;
+    core::FlowTable flow_table_;
+    dataplane::FlowClassifier classifier_;
+    core::TrafficShaper shaper_;
+    LoadReport* report_ = nullptr; // Report of the run in progress
+    core::TimestampNs now_ns_ = 0;
+    TimedShaper timed_shaper_;
+    TimedScheduler timed_scheduler_;
+    std::unique_ptr<Pipeline> pipeline_;
+    core::TimestampNs link_free_ns_ = 0;
+};
+
+} // namespace trafficgen
+} // namespace hqts
+
+#endif // HQTS_TOOLS_TRAFFIC_GENERATOR_LOAD_GENERATOR_H_
@@ -0,0 +1,213 @@
+// hqts_traffic_generator: drives a PacketPipeline with synthetic or recorded traffic on a
+// virtual clock and reports throughput, per-stage cost, drops and queueing latency.
+//
+//   hqts_traffic_generator [options]
+//
+// Run with --help for the options. The same options and seed always produce the same
+// marks, drops and latencies; only the wall-clock figures vary between machines.
+
+#include "load_generator.h"
+#include "workload.h"
+
+#include "hqts/core/shaping_policy.h"                 // For ShapingPolicy
+#include "hqts/policy/policy_tree.h"
+#include "hqts/scheduler/aqm_queue.h"                 // For RedAqmParameters
+#include "hqts/scheduler/drr_scheduler.h"
+#include "hqts/scheduler/strict_priority_scheduler.h"
+#include "hqts/scheduler/wfq_scheduler.h"
+
+#include <cstdlib> // For std::strtod, std::strtoull
+#include <cstring> // For std::strcmp
+#include <exception>
+#include <iostream>
+#include <memory>  // For std::unique_ptr
+#include <stdexcept> // For std::invalid_argument
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace hqts;
+
+constexpr policy::PolicyId GENERATOR_POLICY_ID = 1;
+constexpr size_t NUM_QUEUES = 3;                     // One per ConformanceLevel: green, yellow, red
+constexpr uint32_t QUEUE_WEIGHTS[NUM_QUEUES] = {4, 2, 1}; // DRR quanta (x MTU) and WFQ weights
+
+struct Options {
+    trafficgen::WorkloadConfig workload;
+    trafficgen::GeneratorConfig generator;
+    std::string trace_path;
+    double speedup = 1.0;
+    double cir_mbps = 5000;
+    double pir_mbps = 8000;
+    uint32_t cbs_bytes = 1000000;
+    uint32_t ebs_bytes = 1000000;
+    bool drop_red = false;
+    std::string scheduler = "sp";
+    uint32_t queue_bytes = 1u << 20;
+    bool json = false;
+};
+
+void print_usage(const char* program) {
+    std::cerr
+        << "usage: " << program << " [options]\n"
+        << "workload:\n"
+        << "  --flows N            active flows (10000)\n"
+        << "  --zipf S             Zipf popularity exponent, 0 = uniform (1.0)\n"
+        << "  --sizes imix|BYTES   packet lengths (imix)\n"
+        << "  --pps R              offered packets per second, virtual (1e6)\n"
+        << "  --constant           evenly spaced arrivals instead of Poisson\n"
+        << "  --churn R            flows replaced per second (0)\n"
+        << "  --packets N          packets to generate (1000000)\n"
+        << "  --seed N             random seed (1)\n"
+        << "  --trace FILE         replay a pcap or CSV trace instead\n"
+        << "  --speedup X          replay the trace X times faster (1)\n"
+        << "port and data path:\n"
+        << "  --link-gbps G        egress link rate (10)\n"
+        << "  --burst N            packets per ingress burst, 1 = per-packet path (32)\n"
+        << "  --max-flows N        flow table capacity (1048576)\n"
+        << "  --flow-timeout-ms T  idle flow expiry, 0 = never (0)\n"
+        << "policy:\n"
+        << "  --cir-mbps R --pir-mbps R --cbs-bytes B --ebs-bytes B   (5000, 8000, 1e6, 1e6)\n"
+        << "  --drop-red           police red packets instead of queueing them\n"
+        << "scheduler:\n"
+        << "  --scheduler sp|drr|wfq   (sp)\n"
+        << "  --queue-bytes B      capacity of each queue (1048576)\n"
+        << "output:\n"
+        << "  --json               print one JSON object\n";
+}
+
+/// Parses argv into `options`; false (after printing usage) on an unknown or incomplete option.
+bool parse_options(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        auto value = [&]() -> const char* {
+            if (i + 1 >= argc) {
+                throw std::invalid_argument(std::string("missing value for ") + arg);
+            }
+            return argv[++i];
+        };
+        auto number = [&]() { return std::strtod(value(), nullptr); };
+        auto integer = [&]() { return static_cast<uint64_t>(std::strtoull(value(), nullptr, 10)); };
+
+        if (std::strcmp(arg, "--flows") == 0) {
+            options.workload.num_flows = static_cast<size_t>(integer());
+        } else if (std::strcmp(arg, "--zipf") == 0) {
+            options.workload.zipf_exponent = number();
+        } else if (std::strcmp(arg, "--sizes") == 0) {
+            const char* sizes = value();
+            if (std::strcmp(sizes, "imix") == 0) {
+                options.workload.sizes = trafficgen::SizeDistribution::IMIX;
+            } else {
+                options.workload.sizes = trafficgen::SizeDistribution::FIXED;
+                options.workload.fixed_length_bytes = static_cast<uint32_t>(std::strtoul(sizes, nullptr, 10));
+            }
+        } else if (std::strcmp(arg, "--pps") == 0) {
+            options.workload.offered_pps = number();
+        } else if (std::strcmp(arg, "--constant") == 0) {
+            options.workload.poisson_arrivals = false;
+        } else if (std::strcmp(arg, "--churn") == 0) {
+            options.workload.churn_flows_per_second = number();
+        } else if (std::strcmp(arg, "--packets") == 0) {
+            options.workload.num_packets = integer();
+        } else if (std::strcmp(arg, "--seed") == 0) {
+            options.workload.seed = integer();
+        } else if (std::strcmp(arg, "--trace") == 0) {
+            options.trace_path = value();
+        } else if (std::strcmp(arg, "--speedup") == 0) {
+            options.speedup = number();
+        } else if (std::strcmp(arg, "--link-gbps") == 0) {
+            options.generator.link_rate_bps = static_cast<uint64_t>(number() * 1e9);
+        } else if (std::strcmp(arg, "--burst") == 0) {
+            options.generator.burst_size = static_cast<size_t>(integer());
+        } else if (std::strcmp(arg, "--max-flows") == 0) {
+            options.generator.max_flows = static_cast<size_t>(integer());
+        } else if (std::strcmp(arg, "--flow-timeout-ms") == 0) {
+            options.generator.flow_idle_timeout_ns = static_cast<uint64_t>(number() * 1e6);
+        } else if (std::strcmp(arg, "--cir-mbps") == 0) {
+            options.cir_mbps = number();
+        } else if (std::strcmp(arg, "--pir-mbps") == 0) {
+            options.pir_mbps = number();
+        } else if (std::strcmp(arg, "--cbs-bytes") == 0) {
+            options.cbs_bytes = static_cast<uint32_t>(integer());
+        } else if (std::strcmp(arg, "--ebs-bytes") == 0) {
+            options.ebs_bytes = static_cast<uint32_t>(integer());
+        } else if (std::strcmp(arg, "--drop-red") == 0) {
+            options.drop_red = true;
+        } else if (std::strcmp(arg, "--scheduler") == 0) {
+            options.scheduler = value();
+        } else if (std::strcmp(arg, "--queue-bytes") == 0) {
+            options.queue_bytes = static_cast<uint32_t>(integer());
+        } else if (std::strcmp(arg, "--json") == 0) {
+            options.json = true;
+        } else {
+            print_usage(argv[0]);
+            return false;
+        }
+    }
+    return true;
+}
+
+/// RED that only drops close to a full queue: drops measure overload, not early congestion signals.
+scheduler::RedAqmParameters queue_red(uint32_t capacity_bytes) {
+    return scheduler::RedAqmParameters(capacity_bytes / 10 * 8, capacity_bytes / 10 * 9, 0.1, 0.002, capacity_bytes);
+}
+
+std::unique_ptr<scheduler::SchedulerInterface> make_scheduler(const Options& options) {
+    if (options.scheduler == "sp") {
+        return std::make_unique<scheduler::StrictPriorityScheduler>(
+            std::vector<scheduler::RedAqmParameters>(NUM_QUEUES, queue_red(options.queue_bytes)));
+    }
+    if (options.scheduler == "drr") {
+        std::vector<scheduler::DrrScheduler::QueueConfig> queues;
+        for (size_t i = 0; i < NUM_QUEUES; ++i) {
+            queues.emplace_back(static_cast<core::QueueId>(i), 1500 * QUEUE_WEIGHTS[i], queue_red(options.queue_bytes));
+        }
+        return std::make_unique<scheduler::DrrScheduler>(queues);
+    }
+    if (options.scheduler == "wfq") {
+        std::vector<scheduler::WfqScheduler::QueueConfig> queues;
+        for (size_t i = 0; i < NUM_QUEUES; ++i) {
+            queues.emplace_back(static_cast<core::QueueId>(i), QUEUE_WEIGHTS[i], queue_red(options.queue_bytes));
+        }
+        return std::make_unique<scheduler::WfqScheduler>(queues);
+    }
+    throw std::invalid_argument("unknown scheduler '" + options.scheduler + "' (expected sp, drr or wfq)");
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    try {
+        if (!parse_options(argc, argv, options)) {
+            return 1;
+        }
+
+        // One policy for all traffic: green, yellow and red go to queues 0, 1, 2 (DRR/WFQ)
+        // and to priorities 2, 1, 0 (strict priority).
+        policy::PolicyTree policies;
+        policies.insert(core::ShapingPolicy(GENERATOR_POLICY_ID, policy::NO_PARENT_POLICY_ID, "generator",
+                                            static_cast<uint64_t>(options.cir_mbps * 1e6),
+                                            static_cast<uint64_t>(options.pir_mbps * 1e6), options.cbs_bytes,
+                                            options.ebs_bytes, policy::SchedulingAlgorithm::STRICT_PRIORITY, 100, 0,
+                                            options.drop_red, 2, 1, 0, 0, 1, 2));
+        std::unique_ptr<scheduler::SchedulerInterface> scheduler = make_scheduler(options);
+
+        std::unique_ptr<trafficgen::PacketSource> source;
+        if (!options.trace_path.empty()) {
+            source = std::make_unique<trafficgen::TraceReplay>(trafficgen::load_trace(options.trace_path.c_str()),
+                                                               options.speedup);
+        } else {
+            source = std::make_unique<trafficgen::SyntheticWorkload>(options.workload);
+        }
+
+        trafficgen::LoadGenerator generator(policies, GENERATOR_POLICY_ID, *scheduler, options.generator);
+        trafficgen::LoadReport report = generator.run(*source);
+        trafficgen::print_report(report, std::cout, options.json);
+    } catch (const std::exception& e) {
+        std::cerr << argv[0] << ": " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,310 @@
+#include "workload.h"
+
+#include <algorithm> // For std::lower_bound, std::stable_sort
+#include <cmath>     // For std::pow, std::log
+#include <cstdio>    // For std::sscanf
+#include <cstring>   // For std::memcpy
+#include <fstream>
+#include <iterator>  // For std::istreambuf_iterator
+#include <stdexcept> // For std::invalid_argument, std::runtime_error
+#include <string>
+#include <utility>   // For std::move
+
+namespace hqts {
+namespace trafficgen {
+
+namespace {
+
+constexpr uint32_t IMIX_PATTERN[12] = {64, 576, 64, 64, 1500, 64, 576, 64, 64, 576, 64, 576};
+
+} // namespace
+
+// --- SyntheticWorkload ---
+
+SyntheticWorkload::SyntheticWorkload(const WorkloadConfig& config)
+    : config_(config), rank_generation_(config.num_flows, 0),
+      rng_state_(config.seed != 0 ? config.seed : 0x9E3779B97F4A7C15ull) {
+    if (config.num_flows == 0) {
+        throw std::invalid_argument("SyntheticWorkload: num_flows must be greater than zero.");
+    }
+    if (!(config.offered_pps > 0.0)) {
+        throw std::invalid_argument("SyntheticWorkload: offered_pps must be positive.");
+    }
+    if (config.zipf_exponent < 0.0 || config.churn_flows_per_second < 0.0) {
+        throw std::invalid_argument("SyntheticWorkload: zipf_exponent and churn rate must not be negative.");
+    }
+    if (config.sizes == SizeDistribution::FIXED && config.fixed_length_bytes == 0) {
+        throw std::invalid_argument("SyntheticWorkload: fixed_length_bytes must be greater than zero.");
+    }
+
+    popularity_cdf_.resize(config.num_flows);
+    double total = 0.0;
+    for (size_t k = 0; k < config.num_flows; ++k) {
+        total += 1.0 / std::pow(static_cast<double>(k + 1), config.zipf_exponent);
+        popularity_cdf_[k] = total;
+    }
+    for (double& p : popularity_cdf_) {
+        p /= total;
+    }
+    popularity_cdf_.back() = 1.0; // No rounding gap above the last rank
+
+    if (config.churn_flows_per_second > 0.0) {
+        next_churn_ns_ = 1e9 / config.churn_flows_per_second;
+    }
+}
+
+uint64_t SyntheticWorkload::next_random() {
+    // xorshift64*: fast, and reproducible across platforms for a given seed.
+    rng_state_ ^= rng_state_ >> 12;
+    rng_state_ ^= rng_state_ << 25;
+    rng_state_ ^= rng_state_ >> 27;
+    return rng_state_ * 0x2545F4914F6CDD1Dull;
+}
+
+double SyntheticWorkload::next_unit() {
+    return static_cast<double>((next_random() >> 11) + 1) * (1.0 / 9007199254740992.0); // 2^53
+}
+
+dataplane::FiveTuple SyntheticWorkload::tuple_for(size_t rank) const {
+    uint32_t flow = static_cast<uint32_t>(rank);
+    uint32_t generation = rank_generation_[rank];
+    // Rank in the source address and port, churn generation in the destination.
+    return dataplane::FiveTuple(0x0A000000u | (flow >> 8), 0xC0000000u | (generation & 0x00FFFFFFu),
+                                static_cast<uint16_t>(1024 + (flow & 0xFF)),
+                                static_cast<uint16_t>(80 + (generation >> 24)), 17);
+}
+
+bool SyntheticWorkload::next(TracePacket& packet) {
+    if (produced_ == config_.num_packets) {
+        return false;
+    }
+    double mean_gap_ns = 1e9 / config_.offered_pps;
+    now_ns_ += config_.poisson_arrivals ? -std::log(next_unit()) * mean_gap_ns : mean_gap_ns;
+
+    while (config_.churn_flows_per_second > 0.0 && next_churn_ns_ <= now_ns_) {
+        ++rank_generation_[static_cast<size_t>(next_random() % config_.num_flows)];
+        ++flows_churned_;
+        next_churn_ns_ += 1e9 / config_.churn_flows_per_second;
+    }
+
+    double u = next_unit();
+    size_t rank = static_cast<size_t>(std::lower_bound(popularity_cdf_.begin(), popularity_cdf_.end(), u) -
+                                      popularity_cdf_.begin());
+    if (rank >= config_.num_flows) {
+        rank = config_.num_flows - 1;
+    }
+
+    packet.time_ns = static_cast<core::TimestampNs>(now_ns_);
+    packet.five_tuple = tuple_for(rank);
+    packet.length_bytes = config_.sizes == SizeDistribution::FIXED ? config_.fixed_length_bytes
+                                                                   : IMIX_PATTERN[next_random() % 12];
+    ++produced_;
+    return true;
+}
+
+// --- TraceReplay ---
+
+TraceReplay::TraceReplay(std::vector<TracePacket> packets, double speedup)
+    : packets_(std::move(packets)), speedup_(speedup) {
+    if (!(speedup > 0.0)) {
+        throw std::invalid_argument("TraceReplay: speedup must be positive.");
+    }
+}
+
+bool TraceReplay::next(TracePacket& packet) {
+    if (position_ == packets_.size()) {
+        return false;
+    }
+    packet = packets_[position_];
+    packet.time_ns = static_cast<core::TimestampNs>(
+        static_cast<double>(packets_[position_].time_ns - packets_.front().time_ns) / speedup_);
+    ++position_;
+    return true;
+}
+
+// --- Trace files ---
+
+namespace {
+
+constexpr uint32_t PCAP_MAGIC_US = 0xA1B2C3D4u;
+constexpr uint32_t PCAP_MAGIC_NS = 0xA1B23C4Du;
+constexpr uint32_t PCAP_LINKTYPE_ETHERNET = 1;
+constexpr uint32_t PCAP_LINKTYPE_RAW = 101;
+constexpr uint16_t ETHERTYPE_IPV4 = 0x0800;
+constexpr uint16_t ETHERTYPE_VLAN = 0x8100;
+constexpr uint16_t ETHERTYPE_QINQ = 0x88A8;
+
+uint32_t swap32(uint32_t v) {
+    return (v >> 24) | ((v >> 8) & 0xFF00u) | ((v << 8) & 0xFF0000u) | (v << 24);
+}
+
+uint16_t load_be16(const unsigned char* p) {
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+uint32_t load_be32(const unsigned char* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+/// Parses an IPv4 header (and TCP/UDP ports) at `ip`; false if it is not a usable IPv4 packet.
+bool parse_ipv4(const unsigned char* ip, size_t available, dataplane::FiveTuple& tuple) {
+    if (available < 20 || (ip[0] >> 4) != 4) {
+        return false;
+    }
+    size_t header_bytes = static_cast<size_t>(ip[0] & 0x0F) * 4;
+    if (header_bytes < 20 || available < header_bytes) {
+        return false;
+    }
+    uint8_t protocol = ip[9];
+    uint16_t src_port = 0;
+    uint16_t dst_port = 0;
+    bool first_fragment = (load_be16(ip + 6) & 0x1FFF) == 0;
+    if ((protocol == 6 || protocol == 17) && first_fragment && available >= header_bytes + 4) {
+        src_port = load_be16(ip + header_bytes);
+        dst_port = load_be16(ip + header_bytes + 2);
+    }
+    tuple = dataplane::FiveTuple(load_be32(ip + 12), load_be32(ip + 16), src_port, dst_port, protocol);
+    return true;
+}
+
+std::vector<TracePacket> parse_pcap(const std::string& data, const char* path) {
+    auto bytes = reinterpret_cast<const unsigned char*>(data.data());
+    uint32_t magic;
+    std::memcpy(&magic, bytes, 4);
+    bool swapped = magic == swap32(PCAP_MAGIC_US) || magic == swap32(PCAP_MAGIC_NS);
+    bool nanoseconds = magic == PCAP_MAGIC_NS || magic == swap32(PCAP_MAGIC_NS);
+    auto field = [&](size_t offset) {
+        uint32_t v;
+        std::memcpy(&v, bytes + offset, 4);
+        return swapped ? swap32(v) : v;
+    };
+    if (data.size() < 24) {
+        throw std::runtime_error(std::string("load_trace: truncated pcap header in ") + path);
+    }
+    uint32_t linktype = field(20);
+    if (linktype != PCAP_LINKTYPE_ETHERNET && linktype != PCAP_LINKTYPE_RAW) {
+        throw std::runtime_error("load_trace: unsupported pcap link type " + std::to_string(linktype) + " in " + path);
+    }
+
+    std::vector<TracePacket> packets;
+    size_t offset = 24;
+    while (offset + 16 <= data.size()) {
+        uint64_t seconds = field(offset);
+        uint64_t fraction = field(offset + 4);
+        size_t captured = field(offset + 8);
+        uint32_t original = field(offset + 12);
+        offset += 16;
+        if (offset + captured > data.size()) {
+            break; // Truncated last record
+        }
+        const unsigned char* frame = bytes + offset;
+        offset += captured;
+
+        size_t l3 = 0;
+        if (linktype == PCAP_LINKTYPE_ETHERNET) {
+            if (captured < 14) {
+                continue;
+            }
+            uint16_t ethertype = load_be16(frame + 12);
+            l3 = 14;
+            while ((ethertype == ETHERTYPE_VLAN || ethertype == ETHERTYPE_QINQ) && captured >= l3 + 4) {
+                ethertype = load_be16(frame + l3 + 2);
+                l3 += 4;
+            }
+            if (ethertype != ETHERTYPE_IPV4) {
+                continue;
+            }
+        }
+        TracePacket packet;
+        if (!parse_ipv4(frame + l3, captured - l3, packet.five_tuple)) {
+            continue;
+        }
+        packet.time_ns = seconds * 1000000000ull + (nanoseconds ? fraction : fraction * 1000);
+        packet.length_bytes = original;
+        packets.push_back(packet);
+    }
+    return packets;
+}
+
+bool parse_address(const char* text, uint32_t& address) {
+    unsigned a, b, c, d;
+    char tail;
+    if (std::sscanf(text, "%u.%u.%u.%u%c", &a, &b, &c, &d, &tail) == 4) {
+        if (a > 255 || b > 255 || c > 255 || d > 255) {
+            return false;
+        }
+        address = (a << 24) | (b << 16) | (c << 8) | d;
+        return true;
+    }
+    unsigned long long value;
+    if (std::sscanf(text, "%llu%c", &value, &tail) == 1 && value <= UINT32_MAX) {
+        address = static_cast<uint32_t>(value);
+        return true;
+    }
+    return false;
+}
+
+std::vector<TracePacket> parse_csv(const std::string& data, const char* path) {
+    std::vector<TracePacket> packets;
+    size_t line_number = 0;
+    size_t start = 0;
+    while (start < data.size()) {
+        size_t end = data.find('\n', start);
+        if (end == std::string::npos) {
+            end = data.size();
+        }
+        std::string line = data.substr(start, end - start);
+        start = end + 1;
+        ++line_number;
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        unsigned long long time_ns;
+        char src[64], dst[64];
+        unsigned src_port, dst_port, protocol, length;
+        uint32_t src_ip, dst_ip;
+        if (std::sscanf(line.c_str(), "%llu,%63[^,],%63[^,],%u,%u,%u,%u", &time_ns, src, dst, &src_port, &dst_port,
+                        &protocol, &length) != 7 ||
+            !parse_address(src, src_ip) || !parse_address(dst, dst_ip) || src_port > 65535 || dst_port > 65535 ||
+            protocol > 255 || length == 0) {
+            throw std::runtime_error(std::string("load_trace: malformed line ") + std::to_string(line_number) +
+                                     " in " + path);
+        }
+        TracePacket packet;
+        packet.time_ns = time_ns;
+        packet.five_tuple = dataplane::FiveTuple(src_ip, dst_ip, static_cast<uint16_t>(src_port),
+                                                 static_cast<uint16_t>(dst_port), static_cast<uint8_t>(protocol));
+        packet.length_bytes = length;
+        packets.push_back(packet);
+    }
+    return packets;
+}
+
+} // namespace
+
+std::vector<TracePacket> load_trace(const char* path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error(std::string("load_trace: cannot open ") + path);
+    }
+    std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    uint32_t magic = 0;
+    if (data.size() >= 4) {
+        std::memcpy(&magic, data.data(), 4);
+    }
+    bool pcap = magic == PCAP_MAGIC_US || magic == PCAP_MAGIC_NS || magic == swap32(PCAP_MAGIC_US) ||
+                magic == swap32(PCAP_MAGIC_NS);
+    std::vector<TracePacket> packets = pcap ? parse_pcap(data, path) : parse_csv(data, path);
+    std::stable_sort(packets.begin(), packets.end(),
+                     [](const TracePacket& a, const TracePacket& b) { return a.time_ns < b.time_ns; });
+    return packets;
+}
+
+} // namespace trafficgen
+} // namespace hqts
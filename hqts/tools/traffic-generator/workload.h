@@ -0,0 +1,132 @@
+#ifndef HQTS_TOOLS_TRAFFIC_GENERATOR_WORKLOAD_H_
+#define HQTS_TOOLS_TRAFFIC_GENERATOR_WORKLOAD_H_
+
+#include "hqts/dataplane/flow_identifier.h" // For dataplane::FiveTuple
+#include "hqts/core/time_source.h"          // For core::TimestampNs
+
+#include <cstddef> // For size_t
+#include <cstdint>
+#include <vector>
+
+namespace hqts {
+namespace trafficgen {
+
+/**
+ * @brief One packet arrival: when (on the virtual clock), which flow, how long.
+ */
+struct TracePacket {
+    core::TimestampNs time_ns = 0;
+    dataplane::FiveTuple five_tuple;
+    uint32_t length_bytes = 0;
+};
+
+/**
+ * @brief A source of packet arrivals in non-decreasing time order.
+ */
+class PacketSource {
+public:
+    virtual ~PacketSource() = default;
+
+    /**
+     * @brief Produces the next arrival.
+     * @return False once the source is exhausted.
+     */
+    virtual bool next(TracePacket& packet) = 0;
+};
+
+/// Packet-length distributions of SyntheticWorkload.
+enum class SizeDistribution {
+    FIXED, // Every packet is WorkloadConfig::fixed_length_bytes
+    IMIX   // Simple IMIX: 64, 576 and 1500 bytes in a 7:4:1 ratio
+};
+
+/**
+ * @brief Parameters of a synthetic workload.
+ */
+struct WorkloadConfig {
+    size_t num_flows = 10000;          // Active flows at any time
+    double zipf_exponent = 1.0;        // Flow popularity: P(rank k) ~ 1 / k^s; 0 is uniform
+    SizeDistribution sizes = SizeDistribution::IMIX;
+    uint32_t fixed_length_bytes = 64;
+    double offered_pps = 1e6;          // Mean arrival rate on the virtual clock
+    bool poisson_arrivals = true;      // Exponential inter-arrival times, else evenly spaced
+    double churn_flows_per_second = 0; // Rate at which an active flow is replaced by a new one
+    uint64_t num_packets = 1000000;
+    uint64_t seed = 1;                 // Same seed, same arrivals
+};
+
+/**
+ * @brief Generates arrivals following a WorkloadConfig, deterministically from its seed.
+ *
+ * Flows are ranked 0..num_flows-1 and drawn with Zipf popularity through a precomputed
+ * CDF (one binary search per packet). Churn retires the flow at a random rank and gives
+ * the rank a fresh 5-tuple, so the set of active flows turns over at the configured
+ * rate while the popularity distribution stays the same.
+ */
+class SyntheticWorkload : public PacketSource {
+public:
+    /**
+     * @throws std::invalid_argument if num_flows is 0, offered_pps is not positive,
+     *         zipf_exponent or churn_flows_per_second is negative, or a FIXED size is 0.
+     */
+    explicit SyntheticWorkload(const WorkloadConfig& config);
+
+    bool next(TracePacket& packet) override;
+
+    /** @brief Number of flows retired by churn so far. */
+    uint64_t get_flows_churned() const { return flows_churned_; }
+
+private:
+    uint64_t next_random();
+    double next_unit(); // Uniform in (0, 1]
+    dataplane::FiveTuple tuple_for(size_t rank) const;
+
+    WorkloadConfig config_;
+    std::vector<double> popularity_cdf_;    // popularity_cdf_[k] = P(rank <= k)
+    std::vector<uint32_t> rank_generation_; // Bumped when churn replaces the rank's flow
+    uint64_t rng_state_;
+    uint64_t produced_ = 0;
+    double now_ns_ = 0.0;
+    double next_churn_ns_ = 0.0;
+    uint64_t flows_churned_ = 0;
+};
+
+/**
+ * @brief Replays a recorded trace, with timestamps rebased to 0 and divided by `speedup`.
+ */
+class TraceReplay : public PacketSource {
+public:
+    /**
+     * @throws std::invalid_argument if speedup is not positive.
+     */
+    TraceReplay(std::vector<TracePacket> packets, double speedup = 1.0);
+
+    bool next(TracePacket& packet) override;
+
+private:
+    std::vector<TracePacket> packets_;
+    double speedup_;
+    size_t position_ = 0;
+};
+
+/**
+ * @brief Loads a trace from `path`.
+ *
+ * A classic libpcap file (microsecond or nanosecond timestamps, either byte order,
+ * Ethernet with optional 802.1Q tags or raw IPv4 link types) is recognized by its magic
+ * number; IPv4 packets become arrivals with their original length, and other packets
+ * are skipped. Any other file is read as CSV text, one packet per line:
+ *
+ *   time_ns,src_ip,dst_ip,src_port,dst_port,protocol,length_bytes
+ *
+ * with dotted-quad or integer addresses. Blank lines and lines starting with '#' are
+ * ignored. Arrivals are sorted by time.
+ *
+ * @throws std::runtime_error if the file cannot be read or a line is malformed.
+ */
+std::vector<TracePacket> load_trace(const char* path);
+
+} // namespace trafficgen
+} // namespace hqts
+
+#endif // HQTS_TOOLS_TRAFFIC_GENERATOR_WORKLOAD_H_